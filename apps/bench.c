@@ -0,0 +1,324 @@
+/**
+ * @brief bench - Microbenchmark suite for regression tracking
+ *
+ * Runs a set of small performance measurements - pipe throughput and
+ * latency, fork and exec rates, syscall round trips, malloc churn,
+ * graphics blits and blurs, TCP loopback streaming, file metadata
+ * operations - and prints one stable "name value unit" line per result
+ * so runs can be diffed across commits.
+ *
+ * Run with no arguments for the whole suite, or name the benchmarks
+ * to run: bench pipe syscall ...
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+
+#include <toaru/graphics.h>
+
+static double now(void) {
+	struct timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void report(const char * name, double value, const char * unit) {
+	printf("%-18s %14.2f %s\n", name, value, unit);
+	fflush(stdout);
+}
+
+#define PIPE_BLOCK (64 * 1024)
+#define PIPE_TOTAL (64 * 1024 * 1024)
+
+static void bench_pipe(void) {
+	char * block = malloc(PIPE_BLOCK);
+	memset(block, 0x2a, PIPE_BLOCK);
+
+	int fds[2];
+	pipe(fds);
+
+	pid_t pid = fork();
+	if (!pid) {
+		close(fds[0]);
+		for (size_t sent = 0; sent < PIPE_TOTAL; sent += PIPE_BLOCK) {
+			write(fds[1], block, PIPE_BLOCK);
+		}
+		exit(0);
+	}
+	close(fds[1]);
+
+	double start = now();
+	size_t received = 0;
+	while (received < PIPE_TOTAL) {
+		ssize_t r = read(fds[0], block, PIPE_BLOCK);
+		if (r <= 0) break;
+		received += r;
+	}
+	double elapsed = now() - start;
+	close(fds[0]);
+	waitpid(pid, NULL, 0);
+
+	report("pipe-throughput", received / elapsed / (1024.0 * 1024.0), "MB/s");
+
+	/* Latency: ping-pong one byte between parent and child. */
+	int ping[2], pong[2];
+	pipe(ping);
+	pipe(pong);
+
+	const int rounds = 10000;
+	pid = fork();
+	if (!pid) {
+		char c;
+		for (int i = 0; i < rounds; ++i) {
+			read(ping[0], &c, 1);
+			write(pong[1], &c, 1);
+		}
+		exit(0);
+	}
+
+	start = now();
+	char c = '!';
+	for (int i = 0; i < rounds; ++i) {
+		write(ping[1], &c, 1);
+		read(pong[0], &c, 1);
+	}
+	elapsed = now() - start;
+	waitpid(pid, NULL, 0);
+	close(ping[0]); close(ping[1]);
+	close(pong[0]); close(pong[1]);
+
+	report("pipe-latency", elapsed / rounds * 1000000.0, "us/roundtrip");
+	free(block);
+}
+
+static void bench_fork(void) {
+	const int rounds = 500;
+
+	double start = now();
+	for (int i = 0; i < rounds; ++i) {
+		pid_t pid = fork();
+		if (!pid) exit(0);
+		waitpid(pid, NULL, 0);
+	}
+	report("fork-rate", rounds / (now() - start), "forks/s");
+
+	start = now();
+	for (int i = 0; i < rounds; ++i) {
+		pid_t pid = fork();
+		if (!pid) {
+			char * args[] = {"/bin/true", NULL};
+			execv(args[0], args);
+			exit(1);
+		}
+		waitpid(pid, NULL, 0);
+	}
+	report("exec-rate", rounds / (now() - start), "execs/s");
+}
+
+static void bench_syscall(void) {
+	const int rounds = 200000;
+
+	double start = now();
+	for (int i = 0; i < rounds; ++i) {
+		getpid();
+	}
+	report("syscall-roundtrip", (now() - start) / rounds * 1000000000.0, "ns");
+}
+
+#define MALLOC_SLOTS 1024
+
+static void bench_malloc(void) {
+	const int rounds = 500000;
+	void * slots[MALLOC_SLOTS] = {NULL};
+	unsigned int seed = 0x12345678;
+
+	double start = now();
+	for (int i = 0; i < rounds; ++i) {
+		seed = seed * 1103515245 + 12345;
+		int slot = (seed >> 8) % MALLOC_SLOTS;
+		size_t size = 16 << ((seed >> 20) % 9); /* 16 bytes to 4KB */
+		if (slots[slot]) free(slots[slot]);
+		slots[slot] = malloc(size);
+	}
+	double elapsed = now() - start;
+	for (int i = 0; i < MALLOC_SLOTS; ++i) {
+		if (slots[i]) free(slots[i]);
+	}
+
+	report("malloc-churn", rounds / elapsed / 1000.0, "kops/s");
+}
+
+static void bench_graphics(void) {
+	sprite_t * dest = create_sprite(512, 512, ALPHA_OPAQUE);
+	sprite_t * src  = create_sprite(512, 512, ALPHA_EMBEDDED);
+	gfx_context_t * ctx = init_graphics_sprite(dest);
+	gfx_context_t * sctx = init_graphics_sprite(src);
+
+	draw_fill(sctx, rgba(120, 88, 255, 200));
+
+	const int blits = 200;
+	double start = now();
+	for (int i = 0; i < blits; ++i) {
+		draw_sprite(ctx, src, 0, 0);
+	}
+	double elapsed = now() - start;
+	report("gfx-blit", blits * 512.0 * 512.0 / elapsed / 1000000.0, "Mpx/s");
+
+	const int blurs = 10;
+	start = now();
+	for (int i = 0; i < blurs; ++i) {
+		blur_context_box(ctx, 8);
+	}
+	elapsed = now() - start;
+	report("gfx-blur", blurs * 512.0 * 512.0 / elapsed / 1000000.0, "Mpx/s");
+
+	free(ctx);
+	free(sctx);
+	sprite_free(dest);
+	sprite_free(src);
+}
+
+#define TCP_BLOCK (64 * 1024)
+#define TCP_TOTAL (16 * 1024 * 1024)
+#define TCP_PORT  19992
+
+static void bench_tcp(void) {
+	char * block = malloc(TCP_BLOCK);
+	memset(block, 0x2a, TCP_BLOCK);
+
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port   = htons(TCP_PORT),
+		.sin_addr   = { .s_addr = inet_addr("127.0.0.1") },
+	};
+	if (bind(server, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, 1) < 0) {
+		fprintf(stderr, "bench: tcp: loopback unavailable, skipping\n");
+		close(server);
+		free(block);
+		return;
+	}
+
+	pid_t pid = fork();
+	if (!pid) {
+		int conn = accept(server, NULL, NULL);
+		size_t received = 0;
+		while (received < TCP_TOTAL) {
+			ssize_t r = recv(conn, block, TCP_BLOCK, 0);
+			if (r <= 0) break;
+			received += r;
+		}
+		close(conn);
+		exit(0);
+	}
+
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+	if (connect(client, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "bench: tcp: connect failed, skipping\n");
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		close(client);
+		close(server);
+		free(block);
+		return;
+	}
+
+	double start = now();
+	for (size_t sent = 0; sent < TCP_TOTAL; sent += TCP_BLOCK) {
+		send(client, block, TCP_BLOCK, 0);
+	}
+	waitpid(pid, NULL, 0);
+	double elapsed = now() - start;
+	close(client);
+	close(server);
+	free(block);
+
+	report("tcp-loopback", TCP_TOTAL / elapsed / (1024.0 * 1024.0), "MB/s");
+}
+
+static void bench_meta(void) {
+	const char * dir = "/tmp/.bench-meta";
+	const int files = 500;
+	char path[64];
+
+	mkdir(dir, 0755);
+
+	double start = now();
+	for (int i = 0; i < files; ++i) {
+		snprintf(path, sizeof(path), "%s/f%d", dir, i);
+		int fd = open(path, O_WRONLY | O_CREAT, 0644);
+		if (fd >= 0) close(fd);
+	}
+	report("meta-create", files / (now() - start), "files/s");
+
+	struct stat st;
+	const int stats = 20000;
+	start = now();
+	for (int i = 0; i < stats; ++i) {
+		snprintf(path, sizeof(path), "%s/f%d", dir, i % files);
+		stat(path, &st);
+	}
+	report("meta-stat", stats / (now() - start), "stats/s");
+
+	start = now();
+	for (int i = 0; i < files; ++i) {
+		snprintf(path, sizeof(path), "%s/f%d", dir, i);
+		unlink(path);
+	}
+	report("meta-unlink", files / (now() - start), "files/s");
+
+	rmdir(dir);
+}
+
+static struct benchmark {
+	const char * name;
+	void (*func)(void);
+} benchmarks[] = {
+	{"pipe",     bench_pipe},
+	{"fork",     bench_fork},
+	{"syscall",  bench_syscall},
+	{"malloc",   bench_malloc},
+	{"graphics", bench_graphics},
+	{"tcp",      bench_tcp},
+	{"meta",     bench_meta},
+	{NULL, NULL},
+};
+
+int main(int argc, char * argv[]) {
+	if (argc < 2) {
+		for (struct benchmark * b = benchmarks; b->name; ++b) {
+			b->func();
+		}
+		return 0;
+	}
+
+	int status = 0;
+	for (int i = 1; i < argc; ++i) {
+		struct benchmark * b = benchmarks;
+		for (; b->name; ++b) {
+			if (!strcmp(b->name, argv[i])) {
+				b->func();
+				break;
+			}
+		}
+		if (!b->name) {
+			fprintf(stderr, "%s: no such benchmark: %s\n", argv[0], argv[i]);
+			status = 1;
+		}
+	}
+	return status;
+}
@@ -950,6 +950,27 @@ void redraw_all(void);
  */
 void recalculate_syntax(line_t * line, int line_no) {
 	if (env->slowop) return;
+
+	if (!env->syntax) {
+		for (int i = 0; i < line->actual; ++i) {
+			line->text[i].flags = line->text[i].flags & (3 << 5);
+		}
+		if (line_no != -1) rehighlight_search(line);
+		return;
+	}
+
+	/*
+	 * One state instance and one terminal-mode switch cover the whole
+	 * recalculation, however many lines the state change cascades over;
+	 * both used to happen per highlighter call, which made every
+	 * keystroke pay for a pair of TCSAFLUSH ioctls and an allocation.
+	 */
+	struct SyntaxState * s = (void*)krk_newInstance(env->syntax->krkClass);
+	struct termios old, new;
+	tcgetattr(global_config.tty_in, &old);
+	new = old; new.c_lflag |= ISIG;
+	tcsetattr(global_config.tty_in, TCSAFLUSH, &new);
+
 	/* Clear syntax for this line first */
 	int is_original = 1;
 	while (1) {
@@ -957,13 +978,7 @@ void recalculate_syntax(line_t * line, int line_no) {
 			line->text[i].flags = line->text[i].flags & (3 << 5);
 		}
 
-		if (!env->syntax) {
-			if (line_no != -1) rehighlight_search(line);
-			return;
-		}
-
 		/* Start from the line's stored in initial state */
-		struct SyntaxState * s = (void*)krk_newInstance(env->syntax->krkClass);
 		s->state.env = env;
 		s->state.line = line;
 		s->state.line_no = line_no;
@@ -971,15 +986,10 @@ void recalculate_syntax(line_t * line, int line_no) {
 		s->state.i = 0;
 
 		while (1) {
-			struct termios old, new;
-			tcgetattr(global_config.tty_in, &old);
-			new = old; new.c_lflag |= ISIG;
-			tcsetattr(global_config.tty_in, TCSAFLUSH, &new);
 			ptrdiff_t before = krk_currentThread.stackTop - krk_currentThread.stack;
 			krk_push(OBJECT_VAL(env->syntax->krkFunc));
 			krk_push(OBJECT_VAL(s));
 			KrkValue result = krk_callStack(1);
-			tcsetattr(global_config.tty_in, TCSAFLUSH, &old);
 			krk_currentThread.stackTop = krk_currentThread.stack + before;
 			if (IS_NONE(result) && (krk_currentThread.flags & KRK_THREAD_HAS_EXCEPTION)) {
 				render_error("Exception occurred in plugin: %s", AS_INSTANCE(krk_currentThread.currentException)->_class->name->chars);
@@ -994,7 +1004,7 @@ void recalculate_syntax(line_t * line, int line_no) {
 			s->state.state = IS_NONE(result) ? -1 : AS_INTEGER(result);
 
 			if (s->state.state != 0) {
-				if (line_no == -1) return;
+				if (line_no == -1) goto _done;
 				rehighlight_search(line);
 				if (!is_original) {
 					redraw_line(line_no);
@@ -1003,18 +1013,23 @@ void recalculate_syntax(line_t * line, int line_no) {
 					line_no++;
 					line = env->lines[line_no];
 					line->istate = s->state.state;
-					if (env->loading) return;
+					if (env->loading) goto _done;
 					is_original = 0;
 					goto _next;
 				}
-				return;
+				goto _done;
 			}
 		}
 _next:
 		(void)0;
 	}
 
+_done:
+	tcsetattr(global_config.tty_in, TCSAFLUSH, &old);
+	return;
+
 _syntaxError:
+	tcsetattr(global_config.tty_in, TCSAFLUSH, &old);
 	krk_resetStack();
 	fprintf(stderr,"This syntax highlighter will be disabled in this environment.");
 	env->syntax = NULL;
@@ -1277,7 +1292,7 @@ line_t ** remove_line(line_t ** lines, int offset) {
 
 	/* Move other lines up */
 	if (offset < env->line_count-1) {
-		memmove(&lines[offset], &lines[offset+1], sizeof(line_t *) * (env->line_count - (offset - 1)));
+		memmove(&lines[offset], &lines[offset+1], sizeof(line_t *) * (env->line_count - offset - 1));
 		lines[env->line_count-1] = NULL;
 	}
 
@@ -0,0 +1,71 @@
+/**
+ * @brief boottrace - Render the kernel boot timeline as a waterfall
+ *
+ * Reads /proc/boottrace (microsecond offsets from the first boot event)
+ * and draws each phase as a bar spanning from its event to the next one,
+ * so the expensive parts of the boot stand out at a glance.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_EVENTS 256
+#define BAR_WIDTH  50
+
+struct event {
+	unsigned long long usec;
+	char label[64];
+};
+
+int main(int argc, char * argv[]) {
+	FILE * f = fopen("/proc/boottrace", "r");
+	if (!f) {
+		fprintf(stderr, "%s: /proc/boottrace: not available\n", argv[0]);
+		return 1;
+	}
+
+	static struct event events[MAX_EVENTS];
+	int count = 0;
+
+	char line[256];
+	while (count < MAX_EVENTS && fgets(line, sizeof(line), f)) {
+		char * nl = strstr(line, "\n");
+		if (nl) *nl = '\0';
+		char * label;
+		events[count].usec = strtoull(line, &label, 10);
+		while (*label == ' ') label++;
+		snprintf(events[count].label, sizeof(events[count].label), "%s", label);
+		count++;
+	}
+	fclose(f);
+
+	if (!count) {
+		fprintf(stderr, "%s: no boot events recorded\n", argv[0]);
+		return 1;
+	}
+
+	unsigned long long total = events[count-1].usec;
+	if (!total) total = 1;
+
+	for (int i = 0; i < count; ++i) {
+		unsigned long long start = events[i].usec;
+		unsigned long long end   = (i + 1 < count) ? events[i+1].usec : total;
+		int left  = start * BAR_WIDTH / total;
+		int width = end * BAR_WIDTH / total - left;
+		if (width < 1) width = 1;
+
+		printf("%10.3f ms ", start / 1000.0);
+		for (int c = 0; c < left; ++c) fputc(' ', stdout);
+		for (int c = 0; c < width; ++c) fputc('#', stdout);
+		for (int c = left + width; c < BAR_WIDTH; ++c) fputc(' ', stdout);
+		printf(" %s (%.3f ms)\n", events[i].label, (end - start) / 1000.0);
+	}
+
+	printf("%10.3f ms total\n", total / 1000.0);
+	return 0;
+}
@@ -32,8 +32,11 @@
 #include <sys/fswait.h>
 #include <sys/sysfunc.h>
 #include <sys/shm.h>
+#include <sys/ioctl.h>
+#include <kernel/video.h>
 #include <pthread.h>
 #include <dlfcn.h>
+#include <syscall.h>
 
 #include <toaru/graphics.h>
 #include <toaru/mouse.h>
@@ -44,6 +47,7 @@
 #include <toaru/yutani-server.h>
 #include <toaru/hashmap.h>
 #include <toaru/list.h>
+#include <toaru/text.h>
 
 #define _DEBUG_YUTANI
 #ifdef _DEBUG_YUTANI
@@ -58,6 +62,11 @@ static void mark_window(yutani_globals_t * yg, yutani_server_window_t * window);
 static void window_actually_close(yutani_globals_t * yg, yutani_server_window_t * w);
 static void notify_subscribers(yutani_globals_t * yg);
 static void mouse_stop_drag(yutani_globals_t * yg);
+static void window_opaque_realloc(yutani_server_window_t * win);
+static void window_update_opaque_region(yutani_server_window_t * win, int32_t x, int32_t y, int32_t width, int32_t height);
+
+/* Guards windows_to_remove, which render workers may append to. */
+static pthread_mutex_t windows_to_remove_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * Print usage information.
@@ -163,6 +172,14 @@ uint64_t yutani_time_since(yutani_globals_t * yg, uint64_t start_time) {
 	return diff;
 }
 
+/* Microsecond clock for frame instrumentation */
+static uint64_t yutani_current_time_us(yutani_globals_t * yg) {
+	struct timeval t;
+	gettimeofday(&t, NULL);
+
+	return (uint64_t)((int64_t)(t.tv_sec - yg->start_time) * 1000000 + (t.tv_usec - yg->start_subtime));
+}
+
 /**
  * Translate and transform coordinate from screen-relative to window-relative.
  */
@@ -400,15 +417,24 @@ static yutani_server_window_t * server_window_create(yutani_globals_t * yg, int
 	win->server_flags = flags;
 	win->opacity = 255;
 	win->hidden = 1;
+	win->opaque_tiles = NULL;
+	win->opaque_w = 0;
+	win->opaque_h = 0;
+	win->frame_requested = 0;
+	/* Start on the second half so the client's first flip lands on the first */
+	win->front = 1;
 
 	char key[1024];
 	YUTANI_SHMKEY(yg->server_ident, key, 1024, win);
 
-	size_t size = (width * height * 4);
+	size_t size = (width * height * 4) * ((flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED) ? 2 : 1);
 
 	win->buffer = shm_obtain(key, &size);
 	memset(win->buffer, 0, size);
 
+	/* The buffer starts out fully transparent, so no scan is needed. */
+	window_opaque_realloc(win);
+
 	list_insert(yg->mid_zs, win);
 
 	return win;
@@ -451,7 +477,7 @@ static uint32_t server_window_resize(yutani_globals_t * yg, yutani_server_window
 		char key[1024];
 		YUTANI_SHMKEY_EXP(yg->server_ident, key, 1024, win->newbufid);
 
-		size_t size = (width * height * 4);
+		size_t size = (width * height * 4) * ((win->server_flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED) ? 2 : 1);
 		win->newbuffer = shm_obtain(key, &size);
 	}
 
@@ -482,12 +508,18 @@ static void server_window_resize_finish(yutani_globals_t * yg, yutani_server_win
 	win->newbuffer = NULL;
 	win->newbufid = 0;
 
+	/* The client drew the resized content into the first half */
+	win->front = 0;
+
 	{
 		char key[1024];
 		YUTANI_SHMKEY_EXP(yg->server_ident, key, 1024, oldbufid);
 		shm_release(key);
 	}
 
+	window_opaque_realloc(win);
+	window_update_opaque_region(win, 0, 0, width, height);
+
 	mark_window(yg, win);
 }
 
@@ -505,12 +537,188 @@ static void mark_screen(yutani_globals_t * yg, int32_t x, int32_t y, int32_t wid
 	list_insert(yg->update_list, rect);
 }
 
+/*
+ * The screen is carved into a grid of 64x64 tiles; damage rects mark
+ * tiles dirty, only dirty tiles are recomposited, and a content hash
+ * per tile lets us skip the (slow, on real hardware) copy to video
+ * memory when a recomposited tile came out identical.
+ */
+#define TILE_SIZE 64
+
 /**
- * Draw the cursor sprite.
+ * (Re)allocate the tile grid to match the current display size.
+ * Everything starts dirty with unknown hashes.
  */
-static void draw_cursor(yutani_globals_t * yg, int x, int y, int cursor) {
+static void yutani_tiles_resize(yutani_globals_t * yg) {
+	yg->tiles_x = (yg->width + TILE_SIZE - 1) / TILE_SIZE;
+	yg->tiles_y = (yg->height + TILE_SIZE - 1) / TILE_SIZE;
+	yg->tile_dirty = realloc(yg->tile_dirty, yg->tiles_x * yg->tiles_y);
+	yg->tile_hashes = realloc(yg->tile_hashes, yg->tiles_x * yg->tiles_y * sizeof(uint32_t));
+	memset(yg->tile_dirty, 1, yg->tiles_x * yg->tiles_y);
+	memset(yg->tile_hashes, 0, yg->tiles_x * yg->tiles_y * sizeof(uint32_t));
+}
+
+/**
+ * Mark the tiles covered by a damage rect as dirty.
+ */
+static void mark_tiles(yutani_globals_t * yg, int32_t x, int32_t y, int32_t width, int32_t height) {
+	if (!yg->tile_dirty) return;
+
+	int32_t x0 = max(x, 0);
+	int32_t y0 = max(y, 0);
+	int32_t x1 = min(x + width, yg->width);
+	int32_t y1 = min(y + height, yg->height);
+	if (x1 <= x0 || y1 <= y0) return;
+
+	for (int ty = y0 / TILE_SIZE; ty <= (y1 - 1) / TILE_SIZE; ++ty) {
+		for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; ++tx) {
+			yg->tile_dirty[ty * yg->tiles_x + tx] = 1;
+		}
+	}
+}
+
+/**
+ * FNV-1a over the composited contents of a tile. Never returns 0,
+ * which is reserved for "unknown".
+ */
+static uint32_t yutani_tile_hash(gfx_context_t * ctx, int x0, int y0, int w, int h) {
+	uint32_t hash = 0x811c9dc5UL;
+	for (int y = y0; y < y0 + h; ++y) {
+		uint32_t * row = (uint32_t *)&ctx->backbuffer[y * GFX_S(ctx) + x0 * 4];
+		for (int x = 0; x < w; ++x) {
+			hash ^= row[x];
+			hash *= 0x01000193UL;
+		}
+	}
+	return hash ? hash : 1;
+}
+
+/**
+ * Copy dirty tiles from the backbuffer to the framebuffer, skipping
+ * any whose contents are unchanged since they were last flipped.
+ */
+static void yutani_flip_tiles(yutani_globals_t * yg) {
+	gfx_context_t * ctx = yg->backend_ctx;
+	for (int ty = 0; ty < yg->tiles_y; ++ty) {
+		for (int tx = 0; tx < yg->tiles_x; ++tx) {
+			int i = ty * yg->tiles_x + tx;
+			if (!yg->tile_dirty[i]) continue;
+			yg->tile_dirty[i] = 0;
+
+			int x0 = tx * TILE_SIZE;
+			int y0 = ty * TILE_SIZE;
+			int w = min(x0 + TILE_SIZE, yg->width) - x0;
+			int h = min(y0 + TILE_SIZE, yg->height) - y0;
+
+			uint32_t hash = yutani_tile_hash(ctx, x0, y0, w, h);
+			if (hash == yg->tile_hashes[i]) continue;
+			yg->tile_hashes[i] = hash;
+
+			for (int y = y0; y < y0 + h; ++y) {
+				memcpy(&ctx->buffer[y * GFX_S(ctx) + x0 * 4], &ctx->backbuffer[y * GFX_S(ctx) + x0 * 4], w * 4);
+			}
+		}
+	}
+}
+
+/**
+ * (Re)allocate a window's opaque-tile map to match its current size.
+ *
+ * Windows are carved into the same 64x64 tiles as the screen; a tile is
+ * marked when every pixel in it is fully opaque. All tiles start unmarked,
+ * which is the conservative (never occludes) state.
+ */
+static void window_opaque_realloc(yutani_server_window_t * win) {
+	free(win->opaque_tiles);
+	win->opaque_w = (win->width + TILE_SIZE - 1) / TILE_SIZE;
+	win->opaque_h = (win->height + TILE_SIZE - 1) / TILE_SIZE;
+	win->opaque_tiles = calloc(1, win->opaque_w * win->opaque_h);
+}
+
+/**
+ * Pointer to the half of the canvas currently on display.
+ * Single-buffered windows only have the one.
+ */
+static uint8_t * window_front_buffer(yutani_server_window_t * win) {
+	if (!(win->server_flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED)) return win->buffer;
+	return win->buffer + (win->front ? (win->width * win->height * 4) : 0);
+}
+
+/**
+ * Rescan the opaque-tile map for the part of a window's canvas touched
+ * by a flip, so the scan cost is bounded by how much the client drew.
+ */
+static void window_update_opaque_region(yutani_server_window_t * win, int32_t x, int32_t y, int32_t width, int32_t height) {
+	if (!win->opaque_tiles || !win->buffer) return;
+
+	int32_t x0 = max(x, 0);
+	int32_t y0 = max(y, 0);
+	int32_t x1 = min(x + width, win->width);
+	int32_t y1 = min(y + height, win->height);
+	if (x1 <= x0 || y1 <= y0) return;
+
+	for (int ty = y0 / TILE_SIZE; ty <= (y1 - 1) / TILE_SIZE; ++ty) {
+		int py0 = ty * TILE_SIZE;
+		int py1 = min(py0 + TILE_SIZE, win->height);
+		for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; ++tx) {
+			int px0 = tx * TILE_SIZE;
+			int px1 = min(px0 + TILE_SIZE, win->width);
+			uint8_t opaque = 1;
+			for (int py = py0; py < py1 && opaque; ++py) {
+				uint32_t * row = &((uint32_t *)window_front_buffer(win))[py * win->width + px0];
+				for (int px = px0; px < px1; ++px, ++row) {
+					if ((*row >> 24) != 0xFF) {
+						opaque = 0;
+						break;
+					}
+				}
+			}
+			win->opaque_tiles[ty * win->opaque_w + tx] = opaque;
+		}
+	}
+}
+
+/**
+ * Does this window completely and opaquely cover the given screen rect?
+ *
+ * Windows that are being transformed (rotated, animated, interactively
+ * resized) or that have whole-window translucency never occlude.
+ */
+static int window_occludes_rect(yutani_globals_t * yg, yutani_server_window_t * w, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+	if (w->hidden || !w->opaque_tiles) return 0;
+	if (w->opacity != 255) return 0;
+	if (w->rotation || w->anim_mode || w == yg->resizing_window) return 0;
+	if (x0 < w->x || y0 < w->y) return 0;
+	if (x1 > w->x + w->width || y1 > w->y + w->height) return 0;
+
+	int32_t wx0 = x0 - w->x;
+	int32_t wy0 = y0 - w->y;
+	int32_t wx1 = x1 - w->x;
+	int32_t wy1 = y1 - w->y;
+
+	for (int ty = wy0 / TILE_SIZE; ty <= (wy1 - 1) / TILE_SIZE; ++ty) {
+		for (int tx = wx0 / TILE_SIZE; tx <= (wx1 - 1) / TILE_SIZE; ++tx) {
+			if (!w->opaque_tiles[ty * w->opaque_w + tx]) return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Kernel cursor plane (IO_VID_CURSOR_*): when available, the video driver
+ * overlays the cursor itself and mouse movement costs no compositing at
+ * all. Set up in main() for non-nested servers without a VirtualBox pointer.
+ */
+static int cursor_fd = -1;
+static sprite_t * cursor_uploaded = NULL;
+static int cursor_lifted = 0;
+
+/**
+ * Select which cursor sprite to show for the current mouse state.
+ */
+static sprite_t * cursor_sprite(yutani_globals_t * yg, int cursor) {
 	sprite_t * sprite = &yg->mouse_sprite;
-	static sprite_t * previous = NULL;
 	if (yg->resizing_window) {
 		switch (yg->resizing_direction) {
 			case SCALE_UP:
@@ -545,6 +753,15 @@ static void draw_cursor(yutani_globals_t * yg, int x, int y, int cursor) {
 			case YUTANI_CURSOR_TYPE_IBEAM:             sprite = &yg->mouse_sprite_ibeam; break;
 		}
 	}
+	return sprite;
+}
+
+/**
+ * Draw the cursor sprite.
+ */
+static void draw_cursor(yutani_globals_t * yg, int x, int y, int cursor) {
+	sprite_t * sprite = cursor_sprite(yg, cursor);
+	static sprite_t * previous = NULL;
 	if (sprite != previous) {
 		mark_screen(yg, x / MOUSE_SCALE - MOUSE_OFFSET_X, y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
 		previous = sprite;
@@ -575,7 +792,7 @@ static yutani_server_window_t * check_top_at(yutani_globals_t * yg, yutani_serve
 	int32_t _x = -1, _y = -1;
 	yutani_device_to_window(w, x, y, &_x, &_y);
 	if (_x < 0 || _x >= w->width || _y < 0 || _y >= w->height) return NULL;
-	uint32_t c = ((uint32_t *)w->buffer)[(w->width * _y + _x)];
+	uint32_t c = ((uint32_t *)window_front_buffer(w))[(w->width * _y + _x)];
 	uint8_t a = _ALP(c);
 	if (a >= w->alpha_threshold) {
 		return w;
@@ -609,6 +826,70 @@ static yutani_server_window_t * top_at(yutani_globals_t * yg, uint16_t x, uint16
 	return NULL;
 }
 
+/**
+ * Get the cursor plane out of the way of a framebuffer flip that would
+ * overlap it, so the driver neither flips over the cursor nor saves
+ * stale pixels as what's underneath it.
+ */
+static void cursor_plane_lift(yutani_globals_t * yg) {
+	if (cursor_fd < 0) return;
+	int cx = yg->mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X;
+	int cy = yg->mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y;
+	for (int ty = max(0, cy / TILE_SIZE); ty <= (cy + MOUSE_HEIGHT - 1) / TILE_SIZE && ty < yg->tiles_y; ++ty) {
+		for (int tx = max(0, cx / TILE_SIZE); tx <= (cx + MOUSE_WIDTH - 1) / TILE_SIZE && tx < yg->tiles_x; ++tx) {
+			if (!yg->tile_dirty[ty * yg->tiles_x + tx]) continue;
+			struct vid_cursor_pos pos = { cx, cy, VID_CURSOR_HIDE };
+			ioctl(cursor_fd, IO_VID_CURSOR_POS, &pos);
+			cursor_lifted = 1;
+			return;
+		}
+	}
+}
+
+/**
+ * Push the current cursor shape and position to the kernel cursor plane.
+ */
+static void update_cursor_plane(yutani_globals_t * yg, int x, int y) {
+	static int32_t pushed_x = 0;
+	static int32_t pushed_y = 0;
+	static uint32_t pushed_flags = VID_CURSOR_HIDE;
+
+	yutani_server_window_t * tmp_window = top_at(yg, x / MOUSE_SCALE, y / MOUSE_SCALE);
+	int show = !tmp_window || tmp_window->show_mouse;
+	sprite_t * sprite = cursor_sprite(yg, tmp_window ? tmp_window->show_mouse : 1);
+
+	if (sprite != cursor_uploaded) {
+		static char upload_buf[sizeof(struct vid_cursor) + VID_CURSOR_MAX * VID_CURSOR_MAX * 4];
+		struct vid_cursor * upload = (void *)upload_buf;
+		if (sprite->width > VID_CURSOR_MAX || sprite->height > VID_CURSOR_MAX) {
+			show = 0;
+		} else {
+			upload->width = sprite->width;
+			upload->height = sprite->height;
+			memcpy(upload->bitmap, sprite->bitmap, sprite->width * sprite->height * 4);
+			if (ioctl(cursor_fd, IO_VID_CURSOR_SET, upload) < 0) {
+				/* No cursor plane after all; go back to compositing it */
+				cursor_fd = -1;
+				return;
+			}
+			cursor_uploaded = sprite;
+			cursor_lifted = 1; /* force a reposition with the new shape */
+		}
+	}
+
+	struct vid_cursor_pos pos = {
+		.x = x / MOUSE_SCALE - MOUSE_OFFSET_X,
+		.y = y / MOUSE_SCALE - MOUSE_OFFSET_Y,
+		.flags = show ? 0 : VID_CURSOR_HIDE,
+	};
+	if (!cursor_lifted && pos.x == pushed_x && pos.y == pushed_y && pos.flags == pushed_flags) return;
+	ioctl(cursor_fd, IO_VID_CURSOR_POS, &pos);
+	pushed_x = pos.x;
+	pushed_y = pos.y;
+	pushed_flags = pos.flags;
+	cursor_lifted = 0;
+}
+
 /**
  * Get the window at a coordinate and focus it.
  *
@@ -676,7 +957,7 @@ static inline int matrix_is_translation(gfx_matrix_t m) {
  * Applies transformations (rotation, animations) and then renders
  * the window through alpha blitting.
  */
-static int yutani_blit_window(yutani_globals_t * yg, yutani_server_window_t * window, int x, int y) {
+static int yutani_blit_window(yutani_globals_t * yg, gfx_context_t * ctx, yutani_server_window_t * window, int x, int y) {
 
 	if (window->hidden) {
 		return 0;
@@ -685,7 +966,7 @@ static int yutani_blit_window(yutani_globals_t * yg, yutani_server_window_t * wi
 	sprite_t _win_sprite;
 	_win_sprite.width = window->width;
 	_win_sprite.height = window->height;
-	_win_sprite.bitmap = (uint32_t *)window->buffer;
+	_win_sprite.bitmap = (uint32_t *)window_front_buffer(window);
 	_win_sprite.masks = NULL;
 	_win_sprite.blank = 0;
 	_win_sprite.alpha = ALPHA_EMBEDDED;
@@ -722,7 +1003,14 @@ static int yutani_blit_window(yutani_globals_t * yg, yutani_server_window_t * wi
 			if (frame >= yutani_animation_lengths[window->anim_mode]) {
 				/* XXX handle animation-end things like cleanup of closing windows */
 				if (yutani_is_closing_animation[window->anim_mode]) {
-					list_insert(yg->windows_to_remove, window);
+					/* We may be called several times a frame (once per
+					 * tile span, possibly from several render workers),
+					 * so don't queue the window twice. */
+					pthread_mutex_lock(&windows_to_remove_lock);
+					if (!list_find(yg->windows_to_remove, window)) {
+						list_insert(yg->windows_to_remove, window);
+					}
+					pthread_mutex_unlock(&windows_to_remove_lock);
 					return 0;
 				}
 				window->anim_mode = 0;
@@ -762,14 +1050,14 @@ static int yutani_blit_window(yutani_globals_t * yg, yutani_server_window_t * wi
 			}
 		}
 		if (matrix_is_translation(m)) {
-			draw_sprite_alpha(yg->backend_ctx, &_win_sprite, window->x, window->y, opacity);
+			draw_sprite_alpha(ctx, &_win_sprite, x, y, opacity);
 		} else {
-			draw_sprite_transform(yg->backend_ctx, &_win_sprite, m, opacity);
+			draw_sprite_transform(ctx, &_win_sprite, m, opacity);
 		}
 	} else if (window->opacity != 255) {
-		draw_sprite_alpha(yg->backend_ctx, &_win_sprite, window->x, window->y, opacity);
+		draw_sprite_alpha(ctx, &_win_sprite, x, y, opacity);
 	} else {
-		draw_sprite(yg->backend_ctx, &_win_sprite, window->x, window->y);
+		draw_sprite(ctx, &_win_sprite, x, y);
 	}
 
 	return 0;
@@ -845,29 +1133,431 @@ static void yutani_post_vbox_rects(yutani_globals_t * yg) {
 	write(yg->vbox_rects, tmp, sizeof(tmp));
 }
 
+/*
+ * Per-frame statistics: collected for every composited frame (cheaply -
+ * two timestamps and a few counters) and served to clients through
+ * YUTANI_MSG_QUERY_FRAME_STATS. Per-window blit timing is only taken
+ * while the HUD is up, since it adds a clock read around every blit.
+ */
+static struct yutani_msg_frame_stats frame_stats = {0};
+static volatile uint32_t frame_windows_blitted = 0;
+
+/**
+ * Record statistics for the frame that was just displayed.
+ */
+static void frame_stats_record(uint32_t us, uint32_t damage, uint32_t tiles, uint32_t windows) {
+	frame_stats.frame_us[frame_stats.frames % YUTANI_FRAME_STATS_COUNT] = us;
+	frame_stats.frames++;
+	frame_stats.last_frame_us = us;
+	frame_stats.last_damage = damage;
+	frame_stats.last_tiles = tiles;
+	frame_stats.last_windows = windows;
+}
+
+/*
+ * Saved-under fast path for window drags, resizes and rotations.
+ * While a window is being manipulated with the mouse, the stack below
+ * it can only change appearance through explicit damage, so it is
+ * composited once into the underlay; each motion event then costs one
+ * copy of the damaged area plus a blit of the manipulated window (and
+ * whatever sits above it), instead of a walk of the whole stack.
+ */
+static sprite_t underlay_sprite = {0};
+static gfx_context_t * underlay_ctx = NULL;
+static yutani_server_window_t * underlay_window = NULL;
+static int underlay_building = 0;
+
 /**
  * Blit all windows into the given context.
  *
- * This is called for rendering and for screenshots.
+ * @p off_x and @p off_y translate screen coordinates into the target
+ * context, so this can render into a subregion covering only part of
+ * the screen (a run of dirty tiles) as well as the whole backbuffer.
  */
-static void yutani_blit_windows(yutani_globals_t * yg) {
-	if (!yg->bottom_z || yg->bottom_z->anim_mode) {
-		draw_fill(yg->backend_ctx, rgb(0,0,0));
-	}
-	if (yg->bottom_z) yutani_blit_window(yg, yg->bottom_z, yg->bottom_z->x, yg->bottom_z->y);
+static void yutani_blit_windows(yutani_globals_t * yg, gfx_context_t * ctx, int off_x, int off_y) {
+	/* The screen-space rectangle this context covers. */
+	int32_t sx0 = -off_x;
+	int32_t sy0 = -off_y;
+	int32_t sx1 = sx0 + ctx->width;
+	int32_t sy1 = sy0 + ctx->height;
+
+	/* Flatten the stacking order, bottom to top. */
+	yutani_server_window_t * stack[yg->windows->length + 2];
+	int count = 0;
+	if (yg->bottom_z) stack[count++] = yg->bottom_z;
 	foreach (node, yg->mid_zs) {
-		yutani_server_window_t * w = node->value;
-		if (w) yutani_blit_window(yg, w, w->x, w->y);
+		if (node->value) stack[count++] = node->value;
 	}
 	foreach (node, yg->overlay_zs) {
-		yutani_server_window_t * w = node->value;
-		if (w) yutani_blit_window(yg, w, w->x, w->y);
+		if (node->value) stack[count++] = node->value;
 	}
 	foreach (node, yg->menu_zs) {
-		yutani_server_window_t * w = node->value;
-		if (w) yutani_blit_window(yg, w, w->x, w->y);
+		if (node->value) stack[count++] = node->value;
+	}
+	if (yg->top_z) stack[count++] = yg->top_z;
+
+	int first = 0;
+	int from_underlay = 0;
+
+	if (underlay_window) {
+		if (underlay_building) {
+			/* The underlay is everything strictly below the manipulated window */
+			for (int i = 0; i < count; ++i) {
+				if (stack[i] == underlay_window) {
+					count = i;
+					break;
+				}
+			}
+		} else {
+			for (int i = 0; i < count; ++i) {
+				if (stack[i] == underlay_window) {
+					first = i;
+					from_underlay = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	if (from_underlay) {
+		/* Everything below the manipulated window comes out of the underlay
+		 * in one copy, so a drag costs O(window area), not O(stack depth). */
+		draw_sprite(ctx, &underlay_sprite, off_x, off_y);
+	} else {
+		/*
+		 * Find the topmost window that opaquely covers the whole rect;
+		 * nothing below it - including the background fill - can show
+		 * through, so start compositing there instead of at the bottom.
+		 */
+		for (int i = count - 1; i > 0; --i) {
+			if (window_occludes_rect(yg, stack[i], sx0, sy0, sx1, sy1)) {
+				first = i;
+				break;
+			}
+		}
+
+		if (first == 0 && (!yg->bottom_z || yg->bottom_z->anim_mode)) {
+			draw_fill(ctx, rgb(0,0,0));
+		}
+
+		/* Occluded windows may still need their closing animations reaped. */
+		for (int i = 0; i < first; ++i) {
+			yutani_server_window_t * w = stack[i];
+			if (w->anim_mode && yutani_is_closing_animation[w->anim_mode] &&
+			    (int)yutani_time_since(yg, w->anim_start) >= yutani_animation_lengths[w->anim_mode]) {
+				pthread_mutex_lock(&windows_to_remove_lock);
+				if (!list_find(yg->windows_to_remove, w)) {
+					list_insert(yg->windows_to_remove, w);
+				}
+				pthread_mutex_unlock(&windows_to_remove_lock);
+			}
+		}
+	}
+
+	for (int i = first; i < count; ++i) {
+#if YUTANI_DEBUG_FRAME_HUD
+		if (yg->debug_hud) {
+			uint64_t blit_start = yutani_current_time_us(yg);
+			yutani_blit_window(yg, ctx, stack[i], stack[i]->x + off_x, stack[i]->y + off_y);
+			__sync_fetch_and_add(&stack[i]->blit_us, yutani_current_time_us(yg) - blit_start);
+			__sync_fetch_and_add(&frame_windows_blitted, 1);
+			continue;
+		}
+#endif
+		yutani_blit_window(yg, ctx, stack[i], stack[i]->x + off_x, stack[i]->y + off_y);
+		__sync_fetch_and_add(&frame_windows_blitted, 1);
+	}
+}
+
+/**
+ * (Re)composite the stack below the manipulated window into a region
+ * of the underlay. Only ever called between frames, with the render
+ * workers parked.
+ */
+static void underlay_refresh(yutani_globals_t * yg, int32_t x, int32_t y, int32_t w, int32_t h) {
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if (x + w > (int32_t)yg->width)  w = yg->width - x;
+	if (y + h > (int32_t)yg->height) h = yg->height - y;
+	if (w <= 0 || h <= 0) return;
+
+	gfx_context_t * sub = init_graphics_subregion(underlay_ctx, x, y, w, h);
+	underlay_building = 1;
+	yutani_blit_windows(yg, sub, -x, -y);
+	underlay_building = 0;
+	gfx_no_clip(sub);
+	free(sub);
+}
+
+/**
+ * Start or stop the saved-under fast path to match the current mouse
+ * state; called once per frame before compositing. Starting pays for
+ * one composite of the screen without the window; after that, motion
+ * is cheap.
+ */
+static void underlay_update(yutani_globals_t * yg) {
+	yutani_server_window_t * target = NULL;
+	switch (yg->mouse_state) {
+		case YUTANI_MOUSE_STATE_MOVING:
+		case YUTANI_MOUSE_STATE_RESIZING:
+		case YUTANI_MOUSE_STATE_ROTATING:
+			target = yg->mouse_window;
+			break;
+		default:
+			break;
+	}
+
+	/* A display resize under an active drag invalidates the underlay */
+	if (underlay_window && (underlay_sprite.width != yg->width || underlay_sprite.height != yg->height)) {
+		underlay_window = NULL;
+	}
+
+	if (target == underlay_window) return;
+
+	if (!target) {
+		underlay_window = NULL;
+		return;
+	}
+
+	/* (Re)allocate the underlay for the current resolution */
+	if (!underlay_ctx || underlay_sprite.width != yg->width || underlay_sprite.height != yg->height) {
+		free(underlay_ctx);
+		free(underlay_sprite.bitmap);
+		underlay_sprite.width = yg->width;
+		underlay_sprite.height = yg->height;
+		underlay_sprite.bitmap = malloc(yg->width * yg->height * sizeof(uint32_t));
+		underlay_sprite.masks = NULL;
+		underlay_sprite.alpha = ALPHA_OPAQUE;
+		underlay_ctx = init_graphics_sprite(&underlay_sprite);
+	}
+
+	underlay_window = target;
+	underlay_refresh(yg, 0, 0, yg->width, yg->height);
+}
+
+/*
+ * Parallel compositing: the dirty tile spans for a frame are queued
+ * and claimed atomically by a small pool of worker threads (plus the
+ * main thread, which handles protocol between frames). Spans target
+ * disjoint subregions of the backbuffer, so workers never touch the
+ * same pixels. Each frame is a strict barrier: the main thread waits
+ * for every worker before flipping, so workers are always idle while
+ * window state is being mutated.
+ */
+#define RENDER_MAX_WORKERS 7
+
+struct render_span {
+	int x0;
+	int y0;
+	int w;
+	int h;
+};
+
+static struct render_span * render_spans = NULL;
+static int render_span_alloc = 0;
+static int render_span_count = 0;
+static volatile int render_next_span = 0;
+static volatile int render_workers_done = 0;
+static volatile unsigned int render_generation = 0;
+static int render_worker_count = 0;
+static yutani_globals_t * render_yg = NULL;
+
+/**
+ * Queue a span for this frame's composite. Only the main thread
+ * appends, and only while the workers are parked.
+ */
+static void render_span_add(int x0, int y0, int w, int h) {
+	if (render_span_count == render_span_alloc) {
+		render_span_alloc = render_span_alloc ? render_span_alloc * 2 : 64;
+		render_spans = realloc(render_spans, render_span_alloc * sizeof(struct render_span));
+	}
+	render_spans[render_span_count].x0 = x0;
+	render_spans[render_span_count].y0 = y0;
+	render_spans[render_span_count].w = w;
+	render_spans[render_span_count].h = h;
+	render_span_count++;
+}
+
+/**
+ * Claim and composite spans until none are left. Called by workers
+ * and by the main thread, which participates in its own frame.
+ */
+static void render_spans_run(yutani_globals_t * yg) {
+	while (1) {
+		int i = __sync_fetch_and_add(&render_next_span, 1);
+		if (i >= render_span_count) return;
+		struct render_span * span = &render_spans[i];
+		gfx_context_t * sub = init_graphics_subregion(yg->backend_ctx, span->x0, span->y0, span->w, span->h);
+		yutani_blit_windows(yg, sub, -span->x0, -span->y0);
+		gfx_no_clip(sub);
+		free(sub);
+	}
+}
+
+/**
+ * Worker thread body: sleep on the frame generation word, then help
+ * drain the span queue and report in.
+ */
+static void * render_worker(void * arg) {
+	unsigned int seen = 0;
+	while (1) {
+		while (render_generation == seen) {
+			syscall_futex_wait((unsigned int *)&render_generation, seen, 0);
+		}
+		seen = render_generation;
+		render_spans_run(render_yg);
+		__sync_fetch_and_add(&render_workers_done, 1);
+	}
+	return NULL;
+}
+
+/**
+ * Composite all queued spans, across the worker pool if we have one.
+ */
+static void render_spans_flush(yutani_globals_t * yg) {
+	if (render_worker_count && render_span_count > 1) {
+		render_workers_done = 0;
+		render_next_span = 0;
+		__sync_synchronize();
+		__sync_fetch_and_add(&render_generation, 1);
+		syscall_futex_wake((unsigned int *)&render_generation, render_worker_count);
+		render_spans_run(yg);
+		/* Wait for the workers so they are parked before we flip and
+		 * before any window state changes under them. */
+		while (render_workers_done != render_worker_count) {
+			syscall_yield();
+		}
+	} else {
+		render_next_span = 0;
+		render_spans_run(yg);
+	}
+	render_span_count = 0;
+}
+
+/**
+ * Spin up one render worker per spare core.
+ */
+static void render_workers_init(yutani_globals_t * yg) {
+	static pthread_t render_threads[RENDER_MAX_WORKERS];
+	render_yg = yg;
+	int nproc = sysfunc(TOARU_SYS_FUNC_NPROC, NULL);
+	render_worker_count = min(nproc - 1, RENDER_MAX_WORKERS);
+	if (render_worker_count < 0) render_worker_count = 0;
+	for (int i = 0; i < render_worker_count; ++i) {
+		pthread_create(&render_threads[i], NULL, render_worker, NULL);
+	}
+	TRACE("Composing with %d render worker(s).", render_worker_count);
+}
+
+/**
+ * Create the shared-memory capture buffer and prime it with the
+ * current contents of the screen, so the first thing a recorder
+ * sees is a complete frame rather than whatever happens to get
+ * damaged next.
+ */
+static void capture_create(yutani_globals_t * yg) {
+	yg->capture_bufid = next_buf_id();
+
+	char key[1024];
+	YUTANI_SHMKEY_EXP(yg->server_ident, key, 1024, yg->capture_bufid);
+
+	size_t size = sizeof(struct yutani_capture) + yg->width * yg->height * 4;
+	struct yutani_capture * capture = shm_obtain(key, &size);
+	if (!capture) return;
+
+	memset(capture, 0, sizeof(struct yutani_capture));
+	capture->active = 1;
+	capture->bufid = yg->capture_bufid;
+	capture->width = yg->width;
+	capture->height = yg->height;
+	capture->stride = yg->width * 4;
+
+	for (int y = 0; y < (int)yg->height; ++y) {
+		memcpy((uint8_t *)capture->data + y * capture->stride,
+			&yg->backend_ctx->backbuffer[y * GFX_S(yg->backend_ctx)], capture->stride);
+	}
+
+	capture->damage[0].seq = 1;
+	capture->damage[0].x = 0;
+	capture->damage[0].y = 0;
+	capture->damage[0].width = yg->width;
+	capture->damage[0].height = yg->height;
+	capture->damage_next = 1;
+	__sync_synchronize();
+	capture->seq = 1;
+
+	yg->capture = capture;
+}
+
+/**
+ * Abandon the capture buffer. Recorders still holding a mapping see
+ * @c active drop to 0; our reference goes away with the release.
+ */
+static void capture_destroy(yutani_globals_t * yg) {
+	if (!yg->capture) return;
+
+	yg->capture->active = 0;
+	yg->capture = NULL;
+
+	char key[1024];
+	YUTANI_SHMKEY_EXP(yg->server_ident, key, 1024, yg->capture_bufid);
+	shm_release(key);
+}
+
+/**
+ * Mirror this frame's composited tiles into the capture buffer.
+ *
+ * Runs right before the flip, while the dirty tile set still
+ * describes everything that changed, so the copy covers exactly the
+ * pixels that were re-rendered. The bounding box of the copied tiles
+ * goes into the damage ring and the sequence counter is bumped last.
+ */
+static void yutani_capture_frame(yutani_globals_t * yg) {
+	struct yutani_capture * capture = yg->capture;
+	if (!capture) return;
+
+	int x0 = yg->width;
+	int y0 = yg->height;
+	int x1 = 0;
+	int y1 = 0;
+
+	for (int ty = 0; ty < yg->tiles_y; ++ty) {
+		for (int tx = 0; tx < yg->tiles_x; ) {
+			if (!yg->tile_dirty[ty * yg->tiles_x + tx]) {
+				tx++;
+				continue;
+			}
+			int start = tx;
+			while (tx < yg->tiles_x && yg->tile_dirty[ty * yg->tiles_x + tx]) tx++;
+
+			int rx = start * TILE_SIZE;
+			int ry = ty * TILE_SIZE;
+			int rw = min(tx * TILE_SIZE, (int)yg->width) - rx;
+			int rh = min(ry + TILE_SIZE, (int)yg->height) - ry;
+
+			for (int y = ry; y < ry + rh; ++y) {
+				memcpy((uint8_t *)capture->data + y * capture->stride + rx * 4,
+					&yg->backend_ctx->backbuffer[y * GFX_S(yg->backend_ctx) + rx * 4], rw * 4);
+			}
+
+			x0 = min(x0, rx);
+			y0 = min(y0, ry);
+			x1 = max(x1, rx + rw);
+			y1 = max(y1, ry + rh);
+		}
 	}
-	if (yg->top_z) yutani_blit_window(yg, yg->top_z, yg->top_z->x, yg->top_z->y);
+
+	if (x1 <= x0 || y1 <= y0) return;
+
+	struct yutani_capture_damage * d = &capture->damage[capture->damage_next % YUTANI_CAPTURE_DAMAGE_COUNT];
+	d->seq = capture->seq + 1;
+	d->x = x0;
+	d->y = y0;
+	d->width = x1 - x0;
+	d->height = y1 - y0;
+	capture->damage_next++;
+	__sync_synchronize();
+	capture->seq++;
 }
 
 /**
@@ -895,7 +1585,7 @@ static void yutani_screenshot(yutani_globals_t * yg) {
 		alpha = 0;
 	} else if (task == YUTANI_SCREENSHOT_WINDOW) {
 		yutani_server_window_t * window = yg->focused_window;
-		buffer = (void *)window->buffer;
+		buffer = (void *)window_front_buffer(window);
 		width = window->width;
 		height = window->height;
 		alpha = 1;
@@ -958,6 +1648,16 @@ static void resize_display(yutani_globals_t * yg) {
 	yg->height = yg->backend_ctx->height;
 	yg->backend_framebuffer = yg->backend_ctx->backbuffer;
 
+	/* The capture buffer no longer fits the display; abandon it and
+	 * let recorders restart capture at the new size. */
+	if (yg->capture) {
+		capture_destroy(yg);
+		while (yg->capture_clients->length) {
+			node_t * node = list_pop(yg->capture_clients);
+			free(node);
+		}
+	}
+
 	TRACE("Marking...");
 	yg->resize_on_next = 0;
 	mark_screen(yg, 0, 0, yg->width, yg->height);
@@ -969,6 +1669,79 @@ static void resize_display(yutani_globals_t * yg) {
 	TRACE("Done.");
 }
 
+#if YUTANI_DEBUG_FRAME_HUD
+#define FRAME_HUD_WIDTH        200
+#define FRAME_HUD_GRAPH_HEIGHT 32
+#define FRAME_HUD_MAX_HEIGHT   (58 + 8 * 14)
+
+/**
+ * Draw the frame timing HUD in the top-left corner of the screen.
+ *
+ * Shows the previous frame's composite time, damage area and tile
+ * count, a strip chart of recent frame times against the frame budget,
+ * and per-window blit costs. Toggled with super-shift-f.
+ */
+static void draw_frame_hud(yutani_globals_t * yg) {
+	static struct TT_Font * hud_font = NULL;
+	if (!hud_font) {
+		hud_font = tt_font_from_shm("monospace");
+		if (!hud_font) return;
+	}
+	if ((int)yg->width < FRAME_HUD_WIDTH || (int)yg->height < FRAME_HUD_MAX_HEIGHT) return;
+	tt_set_size(hud_font, 11);
+
+	char line[100];
+	int rows = 0;
+	foreach (node, yg->windows) {
+		yutani_server_window_t * w = node->value;
+		if (w && w->blit_us) rows++;
+		if (rows == 8) break;
+	}
+
+	/* Translucent backdrop */
+	int height = 58 + rows * 14;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < FRAME_HUD_WIDTH; ++x) {
+			GFX(yg->backend_ctx, x, y) = alpha_blend_rgba(GFX(yg->backend_ctx, x, y), premultiply(rgba(0,0,0,200)));
+		}
+	}
+
+	snprintf(line, 100, "%uus %upx %ut %uw",
+		frame_stats.last_frame_us, frame_stats.last_damage,
+		frame_stats.last_tiles, frame_stats.last_windows);
+	tt_draw_string(yg->backend_ctx, hud_font, 4, 14, line, rgb(255,255,255));
+
+	/* Strip chart of recent frame times; full height is the frame budget */
+	uint32_t budget = yg->frame_interval * 1000;
+	for (int i = 0; i < YUTANI_FRAME_STATS_COUNT; ++i) {
+		uint32_t us = frame_stats.frame_us[(frame_stats.frames + i) % YUTANI_FRAME_STATS_COUNT];
+		int h = us * FRAME_HUD_GRAPH_HEIGHT / budget;
+		uint32_t color = rgb(100,255,100);
+		if (h > FRAME_HUD_GRAPH_HEIGHT) {
+			h = FRAME_HUD_GRAPH_HEIGHT;
+			color = rgb(255,100,100);
+		} else if (us * 2 > budget) {
+			color = rgb(255,255,100);
+		}
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < 3; ++x) {
+				GFX(yg->backend_ctx, 4 + i * 3 + x, 20 + FRAME_HUD_GRAPH_HEIGHT - y) = color;
+			}
+		}
+	}
+
+	/* Per-window blit times, in stacking order */
+	int row = 0;
+	foreach (node, yg->windows) {
+		yutani_server_window_t * w = node->value;
+		if (!w || !w->blit_us) continue;
+		snprintf(line, 100, "wid %u: %uus", (unsigned int)w->wid, (unsigned int)w->blit_us);
+		tt_draw_string(yg->backend_ctx, hud_font, 4, 52 + 14 + row * 14, line, rgb(255,255,255));
+		if (++row == 8) break;
+	}
+}
+#endif
+
 /**
  * Redraw all windows, as well as the mouse cursor.
  *
@@ -981,17 +1754,48 @@ static void redraw_windows(yutani_globals_t * yg) {
 	int tmp_mouse_x = yg->mouse_x;
 	int tmp_mouse_y = yg->mouse_y;
 
+	/* Frame instrumentation */
+	uint64_t frame_start_us = yutani_current_time_us(yg);
+	uint32_t damage_area = 0;
+	uint32_t tiles_touched = 0;
+	frame_windows_blitted = 0;
+
 	if (yg->resize_on_next) {
 		resize_display(yg);
 	}
 
-	gfx_clear_clip(yg->backend_ctx);
-
-	/* If the mouse has moved, that counts as two damage regions */
-	if ((yg->last_mouse_x != tmp_mouse_x) || (yg->last_mouse_y != tmp_mouse_y)) {
-		has_updates = 2;
-		gfx_add_clip(yg->backend_ctx, yg->last_mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, yg->last_mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
-		gfx_add_clip(yg->backend_ctx, tmp_mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, tmp_mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
+#if YUTANI_DEBUG_FRAME_HUD
+	if (yg->debug_hud) {
+		/* Reset per-window blit timers and keep the HUD area fresh */
+		foreach (node, yg->windows) {
+			yutani_server_window_t * w = node->value;
+			if (w) w->blit_us = 0;
+		}
+		mark_screen(yg, 0, 0, FRAME_HUD_WIDTH, FRAME_HUD_MAX_HEIGHT);
+	}
+#endif
+
+	if (!yg->tile_dirty ||
+		yg->tiles_x != (int)(yg->width + TILE_SIZE - 1) / TILE_SIZE ||
+		yg->tiles_y != (int)(yg->height + TILE_SIZE - 1) / TILE_SIZE) {
+		yutani_tiles_resize(yg);
+	}
+
+	/* Engage or retire the saved-under drag fast path */
+	underlay_update(yg);
+
+	gfx_clear_clip(yg->backend_ctx);
+
+	/* If the mouse has moved, that counts as two damage regions -
+	 * unless the cursor plane is handling it, in which case moving
+	 * the mouse doesn't damage anything at all. */
+	if (cursor_fd < 0 && ((yg->last_mouse_x != tmp_mouse_x) || (yg->last_mouse_y != tmp_mouse_y))) {
+		has_updates = 2;
+		damage_area += 2 * MOUSE_WIDTH * MOUSE_HEIGHT;
+		gfx_add_clip(yg->backend_ctx, yg->last_mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, yg->last_mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
+		gfx_add_clip(yg->backend_ctx, tmp_mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, tmp_mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
+		mark_tiles(yg, yg->last_mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, yg->last_mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
+		mark_tiles(yg, tmp_mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, tmp_mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
 	}
 
 	yg->last_mouse_x = tmp_mouse_x;
@@ -1019,7 +1823,9 @@ static void redraw_windows(yutani_globals_t * yg) {
 
 		/* We add a clip region for each window in the update queue */
 		has_updates = 1;
+		damage_area += rect->width * rect->height;
 		gfx_add_clip(yg->backend_ctx, rect->x, rect->y, rect->width, rect->height);
+		mark_tiles(yg, rect->x, rect->y, rect->width, rect->height);
 		free(rect);
 		free(win);
 	}
@@ -1027,15 +1833,41 @@ static void redraw_windows(yutani_globals_t * yg) {
 	/* Render */
 	if (has_updates) {
 		/*
-		 * In theory, we should restrict this to windows within the clip region,
-		 * but calculating that may be more trouble than it's worth;
-		 * we also need to render windows in stacking order...
+		 * Composite only the dirty tiles: horizontal runs of dirty
+		 * tiles become subregion contexts and the window stack is
+		 * blitted into each. The subregion inherits the row clips,
+		 * so undamaged rows inside a dirty tile are still skipped.
+		 * Spans are distributed across the render worker pool.
 		 */
-		yutani_blit_windows(yg);
+		for (int ty = 0; ty < yg->tiles_y; ++ty) {
+			for (int tx = 0; tx < yg->tiles_x; ) {
+				if (!yg->tile_dirty[ty * yg->tiles_x + tx]) {
+					tx++;
+					continue;
+				}
+				int start = tx;
+				while (tx < yg->tiles_x && yg->tile_dirty[ty * yg->tiles_x + tx]) tx++;
+				tiles_touched += tx - start;
+
+				int x0 = start * TILE_SIZE;
+				int y0 = ty * TILE_SIZE;
+				int w = min(tx * TILE_SIZE, (int)yg->width) - x0;
+				int h = min(y0 + TILE_SIZE, (int)yg->height) - y0;
+
+				render_span_add(x0, y0, w, h);
+			}
+		}
+		render_spans_flush(yg);
 
 		/* Send VirtualBox rects */
 		yutani_post_vbox_rects(yg);
 
+#if YUTANI_DEBUG_FRAME_HUD
+		if (yg->debug_hud) {
+			draw_frame_hud(yg);
+		}
+#endif
+
 #if YUTANI_DEBUG_WINDOW_SHAPES
 #define WINDOW_SHAPE_VIEWER_SIZE 20
 		/*
@@ -1057,7 +1889,9 @@ static void redraw_windows(yutani_globals_t * yg) {
 #endif
 
 		if (yutani_options.nested) {
+			yutani_capture_frame(yg);
 			flip(yg->backend_ctx);
+			memset(yg->tile_dirty, 0, yg->tiles_x * yg->tiles_y);
 			/*
 			 * We should be able to flip only the places we need to flip, but
 			 * instead we're going to flip the whole thing.
@@ -1079,10 +1913,17 @@ static void redraw_windows(yutani_globals_t * yg) {
 			 * can also go in the stack order of the windows.
 			 */
 			yutani_server_window_t * tmp_window = top_at(yg, yg->mouse_x / MOUSE_SCALE, yg->mouse_y / MOUSE_SCALE);
-			if (!tmp_window || tmp_window->show_mouse) {
+			if (cursor_fd < 0 && (!tmp_window || tmp_window->show_mouse)) {
 				draw_cursor(yg, tmp_mouse_x, tmp_mouse_y, tmp_window ? tmp_window->show_mouse : 1);
 			}
 
+			/* If we're about to flip under the cursor plane, lift it first */
+			cursor_plane_lift(yg);
+
+			/* Mirror the composited regions for capture clients before
+			 * the flip retires the dirty tile set. */
+			yutani_capture_frame(yg);
+
 			/*
 			 * Flip the updated areas. This minimizes writes to video memory,
 			 * which is very important on real hardware where these writes are slow.
@@ -1090,8 +1931,25 @@ static void redraw_windows(yutani_globals_t * yg) {
 			if (yg->backend_ctx->size == 0) {
 				extern void gfx_flip_24bit(gfx_context_t * ctx);
 				gfx_flip_24bit(yg->backend_ctx);
+				memset(yg->tile_dirty, 0, yg->tiles_x * yg->tiles_y);
 			} else {
-				flip(yg->backend_ctx);
+				yutani_flip_tiles(yg);
+			}
+		}
+
+		/* Record what this frame cost for the HUD and stats clients */
+		frame_stats_record((uint32_t)(yutani_current_time_us(yg) - frame_start_us),
+			damage_area, tiles_touched, frame_windows_blitted);
+
+		/* A frame has been displayed; deliver pending frame callbacks. */
+		uint32_t frame_ts = (uint32_t)yutani_current_time(yg);
+		foreach (node, yg->windows) {
+			yutani_server_window_t * w = node->value;
+			if (w && w->frame_requested) {
+				w->frame_requested = 0;
+				yutani_msg_buildx_frame_complete_alloc(response);
+				yutani_msg_buildx_frame_complete(response, w->wid, frame_ts);
+				pex_send(yg->server, w->owner, response->size, (char *)response);
 			}
 		}
 
@@ -1116,6 +1974,11 @@ static void redraw_windows(yutani_globals_t * yg) {
 
 	}
 
+	/* The cursor plane moves even on frames where nothing was composited */
+	if (cursor_fd >= 0) {
+		update_cursor_plane(yg, tmp_mouse_x, tmp_mouse_y);
+	}
+
 	if (yg->screenshot_frame) {
 		yutani_screenshot(yg);
 	}
@@ -1184,6 +2047,11 @@ static void mark_window_relative(yutani_globals_t * yg, yutani_server_window_t *
 		rect->height = bottom_bound - top_bound;
 	}
 
+	/* Damage from any other window invalidates that part of the underlay */
+	if (underlay_window && window != underlay_window) {
+		underlay_refresh(yg, rect->x, rect->y, rect->width, rect->height);
+	}
+
 	list_insert(yg->update_list, rect);
 }
 
@@ -1259,6 +2127,14 @@ static void window_actually_close(yutani_globals_t * yg, yutani_server_window_t
 		shm_release(key);
 	}
 
+	free(w->opaque_tiles);
+	w->opaque_tiles = NULL;
+
+	/* If this was the window being dragged, the fast path dies with it */
+	if (w == underlay_window) {
+		underlay_window = NULL;
+	}
+
 	/* Notify subscribers that there are changes to windows */
 	notify_subscribers(yg);
 }
@@ -1491,6 +2367,17 @@ static void handle_key_event(yutani_globals_t * yg, struct yutani_msg_key_event
 			yg->debug_bounds = (1-yg->debug_bounds);
 			return;
 		}
+#endif
+#if YUTANI_DEBUG_FRAME_HUD
+		if ((ke->event.action == KEY_ACTION_DOWN) &&
+			(ke->event.modifiers & KEY_MOD_LEFT_SUPER) &&
+			(ke->event.modifiers & KEY_MOD_LEFT_SHIFT) &&
+			(ke->event.keycode == 'f')) {
+			yg->debug_hud = (1-yg->debug_hud);
+			/* Repaint the HUD area, whichever way it was toggled */
+			mark_screen(yg, 0, 0, FRAME_HUD_WIDTH, FRAME_HUD_MAX_HEIGHT);
+			return;
+		}
 #endif
 		/* Screenshot key */
 		if ((ke->event.action == KEY_ACTION_DOWN) &&
@@ -2088,6 +2975,438 @@ static void load_fonts(yutani_globals_t * yg) {
 	}
 }
 
+/*
+ * Process a single message from a client. One PEX packet may carry
+ * several messages back to back (see yutani_flush in the client
+ * library), so the server loop below calls this once per message.
+ */
+static void handle_client_message(yutani_globals_t * yg, uintptr_t source, yutani_msg_t * m) {
+	FILE * server = yg->server;
+	switch(m->type) {
+		case YUTANI_MSG_HELLO:
+			{
+				TRACE("And hello to you, %p!", source);
+				list_t * client_list = hashmap_get(yg->clients_to_windows, (void *)source);
+				if (!client_list) {
+					TRACE("Client is new: %p", source);
+					client_list = list_create();
+					hashmap_set(yg->clients_to_windows, (void *)source, client_list);
+				}
+				yutani_msg_buildx_welcome_alloc(response);
+				yutani_msg_buildx_welcome(response,yg->width, yg->height);
+				pex_send(server, source, response->size, (char *)response);
+			}
+			break;
+		case YUTANI_MSG_WINDOW_NEW:
+		case YUTANI_MSG_WINDOW_NEW_FLAGS:
+			{
+				struct yutani_msg_window_new_flags * wn = (void *)m->data;
+				TRACE("Client %p requested a new window (%dx%d).", source, wn->width, wn->height);
+				yutani_server_window_t * w = server_window_create(yg, wn->width, wn->height, source, m->type != YUTANI_MSG_WINDOW_NEW ? wn->flags : 0);
+				yutani_msg_buildx_window_init_alloc(response);
+				yutani_msg_buildx_window_init(response,w->wid, w->width, w->height, w->bufid);
+				pex_send(server, source, response->size, (char *)response);
+
+				if (!(w->server_flags & YUTANI_WINDOW_FLAG_NO_STEAL_FOCUS)) {
+					set_focused_window(yg, w);
+				}
+
+				notify_subscribers(yg);
+			}
+			break;
+		case YUTANI_MSG_FLIP:
+			{
+				struct yutani_msg_flip * wf = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wf->wid);
+				if (w) {
+					window_reveal(yg, w);
+					if (w->server_flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED) w->front = !w->front;
+					window_update_opaque_region(w, 0, 0, w->width, w->height);
+					mark_window(yg, w);
+				}
+			}
+			break;
+		case YUTANI_MSG_FLIP_REGION:
+			{
+				struct yutani_msg_flip_region * wf = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wf->wid);
+				if (w) {
+					window_reveal(yg, w);
+					if (w->server_flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED) w->front = !w->front;
+					window_update_opaque_region(w, wf->x, wf->y, wf->width, wf->height);
+					mark_window_relative(yg, w, wf->x, wf->y, wf->width, wf->height);
+				}
+			}
+			break;
+		case YUTANI_MSG_FLIP_REGIONS:
+			{
+				struct yutani_msg_flip_regions * wf = (void *)m->data;
+				if (wf->count > YUTANI_MAX_FLIP_REGIONS ||
+					m->size < sizeof(struct yutani_message) + sizeof(struct yutani_msg_flip_regions) + wf->count * sizeof(struct yutani_damage_rect)) {
+					TRACE("Rejecting malformed flip_regions message.");
+					break;
+				}
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wf->wid);
+				if (w) {
+					window_reveal(yg, w);
+					if (w->server_flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED) w->front = !w->front;
+					for (uint32_t i = 0; i < wf->count; ++i) {
+						struct yutani_damage_rect * r = &wf->rects[i];
+						window_update_opaque_region(w, r->x, r->y, r->width, r->height);
+						mark_window_relative(yg, w, r->x, r->y, r->width, r->height);
+					}
+				}
+			}
+			break;
+		case YUTANI_MSG_KEY_EVENT:
+			{
+				/* XXX Verify this is from a valid device client */
+				struct yutani_msg_key_event * ke = (void *)m->data;
+				handle_key_event(yg, ke);
+			}
+			break;
+		case YUTANI_MSG_MOUSE_EVENT:
+			{
+				/* XXX Verify this is from a valid device client */
+				struct yutani_msg_mouse_event * me = (void *)m->data;
+				handle_mouse_event(yg, me);
+			}
+			break;
+		case YUTANI_MSG_WINDOW_MOVE:
+			{
+				struct yutani_msg_window_move * wm = (void *)m->data;
+				//TRACE("%08x wanted to move window %d to %d, %d", source, wm->wid, (int)wm->x, (int)wm->y);
+				if (wm->x > (int)yg->width + 100 || wm->x < -(int)yg->width || wm->y > (int)yg->height + 100 || wm->y < -(int)yg->height) {
+					TRACE("Refusing to move window to these coordinates.");
+					break;
+				}
+				yutani_server_window_t * win = hashmap_get(yg->wids_to_windows, (void*)(uintptr_t)wm->wid);
+				if (win) {
+					window_move(yg, win, wm->x, wm->y);
+				} else {
+					TRACE("%08x wanted to move window %d, but I can't find it?", source, wm->wid);
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_MOVE_RELATIVE:
+			{
+				struct yutani_msg_window_move_relative * wm = (void *)m->data;
+
+				yutani_server_window_t * movee = hashmap_get(yg->wids_to_windows, (void*)(uintptr_t)wm->wid_to_move);
+				yutani_server_window_t * base  = hashmap_get(yg->wids_to_windows, (void*)(uintptr_t)wm->wid_base);
+
+				if (!movee || !base) break;
+
+				/* Map coordinate to new origin location */
+				int32_t nx, ny;
+				yutani_window_to_device(base, wm->x + movee->width / 2, wm->y + movee->height / 2, &nx, &ny);
+				window_move(yg, movee, nx - movee->width / 2, ny - movee->height / 2);
+
+				/* Match window rotation to base window */
+				movee->rotation = base->rotation;
+			}
+			break;
+		case YUTANI_MSG_WINDOW_CLOSE:
+			{
+				struct yutani_msg_window_close * wc = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wc->wid);
+				if (w) {
+					window_mark_for_close(yg, w);
+					window_remove_from_client(yg, w);
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_STACK:
+			{
+				struct yutani_msg_window_stack * ws = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)ws->wid);
+				if (w) {
+					reorder_window(yg, w, ws->z);
+				}
+			}
+			break;
+		case YUTANI_MSG_RESIZE_REQUEST:
+			{
+				struct yutani_msg_window_resize * wr = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
+				if (w) {
+					yutani_msg_buildx_window_resize_alloc(response);
+					yutani_msg_buildx_window_resize(response,YUTANI_MSG_RESIZE_OFFER, w->wid, wr->width, wr->height, 0, w->tiled);
+					pex_send(server, source, response->size, (char *)response);
+				}
+			}
+			break;
+		case YUTANI_MSG_RESIZE_OFFER:
+			{
+				struct yutani_msg_window_resize * wr = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
+				if (w) {
+					yutani_msg_buildx_window_resize_alloc(response);
+					yutani_msg_buildx_window_resize(response,YUTANI_MSG_RESIZE_OFFER, w->wid, wr->width, wr->height, 0, w->tiled);
+					pex_send(server, source, response->size, (char *)response);
+				}
+			}
+			break;
+		case YUTANI_MSG_RESIZE_ACCEPT:
+			{
+				struct yutani_msg_window_resize * wr = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
+				if (w) {
+					uint32_t newbufid = server_window_resize(yg, w, wr->width, wr->height);
+					yutani_msg_buildx_window_resize_alloc(response);
+					yutani_msg_buildx_window_resize(response,YUTANI_MSG_RESIZE_BUFID, w->wid, wr->width, wr->height, newbufid, 0);
+					pex_send(server, source, response->size, (char *)response);
+				}
+			}
+			break;
+		case YUTANI_MSG_RESIZE_DONE:
+			{
+				struct yutani_msg_window_resize * wr = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
+				if (w) {
+					server_window_resize_finish(yg, w, wr->width, wr->height);
+				}
+			}
+			break;
+		case YUTANI_MSG_QUERY_WINDOWS:
+			{
+				yutani_query_result(yg, source, yg->bottom_z);
+				foreach (node, yg->mid_zs) {
+					yutani_query_result(yg, source, node->value);
+				}
+				/* Exclude menus, overlay windows, top and bottom. */
+				yutani_query_result(yg, source, yg->top_z);
+				yutani_msg_buildx_window_advertise_alloc(response, 0);
+				yutani_msg_buildx_window_advertise(response,0, 0, 0, 0, 0, 0, 0, NULL);
+				pex_send(server, source, response->size, (char *)response);
+			}
+			break;
+		case YUTANI_MSG_QUERY_FRAME_STATS:
+			{
+				/* Rotate the sample ring so the oldest frame comes first */
+				struct yutani_msg_frame_stats out = frame_stats;
+				for (int i = 0; i < YUTANI_FRAME_STATS_COUNT; ++i) {
+					out.frame_us[i] = frame_stats.frame_us[(frame_stats.frames + i) % YUTANI_FRAME_STATS_COUNT];
+				}
+				yutani_msg_buildx_frame_stats_alloc(response);
+				yutani_msg_buildx_frame_stats(response, &out);
+				pex_send(server, source, response->size, (char *)response);
+			}
+			break;
+		case YUTANI_MSG_SUBSCRIBE:
+			{
+				foreach(node, yg->window_subscribers) {
+					if ((uintptr_t)node->value == source) {
+						break;
+					}
+				}
+				list_insert(yg->window_subscribers, (void*)source);
+			}
+			break;
+		case YUTANI_MSG_UNSUBSCRIBE:
+			{
+				node_t * node = list_find(yg->window_subscribers, (void*)source);
+				if (node) {
+					list_delete(yg->window_subscribers, node);
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_ADVERTISE:
+			{
+				struct yutani_msg_window_advertise * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					if (w->client_strings) free(w->client_strings);
+
+					w->client_icon    = wa->icon;
+					w->client_flags   = wa->flags;
+					w->client_length  = wa->size;
+					w->client_strings = malloc(wa->size);
+					memcpy(w->client_strings, wa->strings, wa->size);
+
+					notify_subscribers(yg);
+				}
+			}
+			break;
+		case YUTANI_MSG_SESSION_END:
+			{
+				yutani_msg_buildx_session_end_alloc(response);
+				yutani_msg_buildx_session_end(response);
+				pex_broadcast(server, response->size, (char *)response);
+			}
+			break;
+		case YUTANI_MSG_WINDOW_FOCUS:
+			{
+				struct yutani_msg_window_focus * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					set_focused_window(yg, w);
+				}
+			}
+			break;
+		case YUTANI_MSG_KEY_BIND:
+			{
+				struct yutani_msg_key_bind * wa = (void *)m->data;
+				add_key_bind(yg, wa, source);
+			}
+			break;
+		case YUTANI_MSG_WINDOW_DRAG_START:
+			{
+				struct yutani_msg_window_drag_start * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					/* Start dragging */
+					mouse_start_drag(yg, w);
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_UPDATE_SHAPE:
+			{
+				struct yutani_msg_window_update_shape * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					/* Set shape parameter */
+					server_window_update_shape(yg, w, wa->set_shape);
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_WARP_MOUSE:
+			{
+				struct yutani_msg_window_warp_mouse * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					if (yg->focused_window == w) {
+						int32_t x, y;
+						yutani_window_to_device(w, wa->x, wa->y, &x, &y);
+
+						struct yutani_msg_mouse_event me;
+						me.event.x_difference = x;
+						me.event.y_difference = y;
+						me.event.buttons = yg->last_mouse_buttons;
+						me.type = YUTANI_MOUSE_EVENT_TYPE_ABSOLUTE;
+						me.wid = wa->wid;
+
+						handle_mouse_event(yg, &me);
+					}
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_SHOW_MOUSE:
+			{
+				struct yutani_msg_window_show_mouse * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					if (wa->show_mouse == -1) {
+						w->show_mouse = w->default_mouse;
+					} else if (wa->show_mouse < 2) {
+						w->default_mouse = wa->show_mouse;
+						w->show_mouse = wa->show_mouse;
+					} else {
+						w->show_mouse = wa->show_mouse;
+					}
+					if (yg->focused_window == w) {
+						mark_screen(yg, yg->mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, yg->mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
+					}
+				}
+			}
+			break;
+		case YUTANI_MSG_WINDOW_RESIZE_START:
+			{
+				struct yutani_msg_window_resize_start * wa = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
+				if (w) {
+					if (yg->focused_window == w && !yg->resizing_window) {
+						yg->resizing_window = w;
+						yg->resizing_button = YUTANI_MOUSE_BUTTON_LEFT; /* XXX Uh, what if we used something else */
+						mouse_start_resize(yg, wa->direction);
+					}
+				}
+			}
+			break;
+		case YUTANI_MSG_SPECIAL_REQUEST:
+			{
+				struct yutani_msg_special_request * sr = (void *)m->data;
+				yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)sr->wid);
+				switch (sr->request) {
+					case YUTANI_SPECIAL_REQUEST_MAXIMIZE:
+						if (w) {
+							if (w->tiled) {
+								window_untile(yg,w);
+								window_move(yg,w,w->untiled_left,w->untiled_top);
+							} else {
+								window_tile(yg, w, 1, 1, 0, 0);
+							}
+						}
+						break;
+					case YUTANI_SPECIAL_REQUEST_PLEASE_CLOSE:
+						if (w) {
+							yutani_msg_buildx_window_close_alloc(response);
+							yutani_msg_buildx_window_close(response, w->wid);
+							pex_send(yg->server, w->owner, response->size, (char *)response);
+						}
+						break;
+					case YUTANI_SPECIAL_REQUEST_FRAME_NEXT:
+					if (w) {
+						w->frame_requested = 1;
+					}
+					break;
+					case YUTANI_SPECIAL_REQUEST_CAPTURE_START:
+						{
+							if (!yg->capture) {
+								capture_create(yg);
+							}
+							if (yg->capture && !list_find(yg->capture_clients, (void *)source)) {
+								list_insert(yg->capture_clients, (void *)source);
+							}
+							yutani_msg_buildx_capture_init_alloc(response);
+							yutani_msg_buildx_capture_init(response,
+								yg->capture ? yg->capture_bufid : 0, yg->width, yg->height);
+							pex_send(server, source, response->size, (char *)response);
+						}
+						break;
+					case YUTANI_SPECIAL_REQUEST_CAPTURE_STOP:
+						{
+							node_t * node = list_find(yg->capture_clients, (void *)source);
+							if (node) {
+								list_delete(yg->capture_clients, node);
+								free(node);
+							}
+							if (!yg->capture_clients->length) {
+								capture_destroy(yg);
+							}
+						}
+						break;
+				case YUTANI_SPECIAL_REQUEST_CLIPBOARD:
+						{
+							yutani_msg_buildx_clipboard_alloc(response, yg->clipboard_size);
+							yutani_msg_buildx_clipboard(response, yg->clipboard);
+							pex_send(server, source, response->size, (char *)response);
+						}
+						break;
+					default:
+						TRACE("Unknown special request type: 0x%x", sr->request);
+						break;
+				}
+
+			}
+			break;
+		case YUTANI_MSG_CLIPBOARD:
+			{
+				struct yutani_msg_clipboard * cb = (void *)m->data;
+				yg->clipboard_size = min(cb->size, 511);
+				memcpy(yg->clipboard, cb->content, yg->clipboard_size);
+				yg->clipboard[yg->clipboard_size] = '\0';
+				TRACE("Copied text to clipbard (size=%d)", yg->clipboard_size);
+			}
+			break;
+		default:
+			{
+				TRACE("Unknown type: 0x%8x", m->type);
+			}
+			break;
+	}
+}
+
 /**
  * main
  */
@@ -2182,8 +3501,16 @@ int main(int argc, char * argv[]) {
 	yg->windows_to_remove = list_create();
 
 	yg->window_subscribers = list_create();
+	yg->capture_clients = list_create();
 
 	yg->last_mouse_buttons = 0;
+
+	/* Pace composites to the display's nominal refresh rate. */
+	yg->frame_interval = 1000 / (yutani_options.nested ? 60 : framebuffer_refresh_rate());
+	if (yg->frame_interval < 1) yg->frame_interval = 1;
+
+	render_workers_init(yg);
+
 	TRACE("Done.");
 
 	yutani_clip_init(yg);
@@ -2224,6 +3551,12 @@ int main(int argc, char * argv[]) {
 		yg->vbox_rects = open("/dev/vboxrects", O_WRONLY);
 		yg->vbox_pointer = open("/dev/vboxpointer", O_WRONLY);
 
+		/* Without a VirtualBox host pointer, try the kernel cursor plane;
+		 * if the driver rejects it we fall back to compositing the cursor. */
+		if (yg->vbox_pointer < 0) {
+			cursor_fd = open("/dev/fb0", O_RDONLY);
+		}
+
 		fds[1] = mfd;
 		fds[2] = kfd;
 		fds[3] = amfd;
@@ -2234,14 +3567,14 @@ int main(int argc, char * argv[]) {
 	while (1) {
 
 		unsigned long frameTime = yutani_time_since(yg, last_redraw);
-		if (frameTime > 15) {
+		if (frameTime >= (unsigned long)yg->frame_interval) {
 			redraw_windows(yg);
 			last_redraw = yutani_current_time(yg);
 			frameTime = 0;
 		}
 
 		if (yutani_options.nested) {
-			int index = fswait2(2, fds, 16 - frameTime);
+			int index = fswait2(2, fds, yg->frame_interval - frameTime);
 
 			if (index == 1) {
 				yutani_msg_t * m = yutani_poll(yg->host_context);
@@ -2300,7 +3633,7 @@ int main(int argc, char * argv[]) {
 				continue;
 			}
 		} else {
-			int index = fswait2(amfd == -1 ? 3 : 4, fds, 16 - frameTime);
+			int index = fswait2(amfd == -1 ? 3 : 4, fds, yg->frame_interval - frameTime);
 
 			if (index == 2) {
 				unsigned char buf[1];
@@ -2343,8 +3676,6 @@ int main(int argc, char * argv[]) {
 		pex_packet_t * p = calloc(PACKET_SIZE, 1);
 		pex_listen(server, p);
 
-		yutani_msg_t * m = (yutani_msg_t *)p->data;
-
 		if (p->size == 0) {
 			/* Connection closed for client */
 			TRACE("Connection closed for client  %x", p->source);
@@ -2361,6 +3692,15 @@ int main(int argc, char * argv[]) {
 				free(client_list);
 			}
 
+			node_t * capture_node = list_find(yg->capture_clients, (void *)p->source);
+			if (capture_node) {
+				list_delete(yg->capture_clients, capture_node);
+				free(capture_node);
+				if (!yg->capture_clients->length) {
+					capture_destroy(yg);
+				}
+			}
+
 			if (hashmap_is_empty(yg->clients_to_windows)) {
 				TRACE("Last compositor client disconnected, exiting.");
 				yg->server = NULL;
@@ -2371,367 +3711,21 @@ int main(int argc, char * argv[]) {
 			continue;
 		}
 
-		if (m->magic != YUTANI_MSG__MAGIC) {
-			TRACE("Message has bad magic. (Should eject client, but will instead skip this message.) 0x%x", m->magic);
-			free(p);
-			continue;
-		}
-
-		switch(m->type) {
-			case YUTANI_MSG_HELLO:
-				{
-					TRACE("And hello to you, %p!", p->source);
-					list_t * client_list = hashmap_get(yg->clients_to_windows, (void *)p->source);
-					if (!client_list) {
-						TRACE("Client is new: %p", p->source);
-						client_list = list_create();
-						hashmap_set(yg->clients_to_windows, (void *)p->source, client_list);
-					}
-					yutani_msg_buildx_welcome_alloc(response);
-					yutani_msg_buildx_welcome(response,yg->width, yg->height);
-					pex_send(server, p->source, response->size, (char *)response);
-				}
-				break;
-			case YUTANI_MSG_WINDOW_NEW:
-			case YUTANI_MSG_WINDOW_NEW_FLAGS:
-				{
-					struct yutani_msg_window_new_flags * wn = (void *)m->data;
-					TRACE("Client %p requested a new window (%dx%d).", p->source, wn->width, wn->height);
-					yutani_server_window_t * w = server_window_create(yg, wn->width, wn->height, p->source, m->type != YUTANI_MSG_WINDOW_NEW ? wn->flags : 0);
-					yutani_msg_buildx_window_init_alloc(response);
-					yutani_msg_buildx_window_init(response,w->wid, w->width, w->height, w->bufid);
-					pex_send(server, p->source, response->size, (char *)response);
-
-					if (!(w->server_flags & YUTANI_WINDOW_FLAG_NO_STEAL_FOCUS)) {
-						set_focused_window(yg, w);
-					}
-
-					notify_subscribers(yg);
-				}
-				break;
-			case YUTANI_MSG_FLIP:
-				{
-					struct yutani_msg_flip * wf = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wf->wid);
-					if (w) {
-						window_reveal(yg, w);
-						mark_window(yg, w);
-					}
-				}
-				break;
-			case YUTANI_MSG_FLIP_REGION:
-				{
-					struct yutani_msg_flip_region * wf = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wf->wid);
-					if (w) {
-						window_reveal(yg, w);
-						mark_window_relative(yg, w, wf->x, wf->y, wf->width, wf->height);
-					}
-				}
-				break;
-			case YUTANI_MSG_KEY_EVENT:
-				{
-					/* XXX Verify this is from a valid device client */
-					struct yutani_msg_key_event * ke = (void *)m->data;
-					handle_key_event(yg, ke);
-				}
-				break;
-			case YUTANI_MSG_MOUSE_EVENT:
-				{
-					/* XXX Verify this is from a valid device client */
-					struct yutani_msg_mouse_event * me = (void *)m->data;
-					handle_mouse_event(yg, me);
-				}
-				break;
-			case YUTANI_MSG_WINDOW_MOVE:
-				{
-					struct yutani_msg_window_move * wm = (void *)m->data;
-					//TRACE("%08x wanted to move window %d to %d, %d", p->source, wm->wid, (int)wm->x, (int)wm->y);
-					if (wm->x > (int)yg->width + 100 || wm->x < -(int)yg->width || wm->y > (int)yg->height + 100 || wm->y < -(int)yg->height) {
-						TRACE("Refusing to move window to these coordinates.");
-						break;
-					}
-					yutani_server_window_t * win = hashmap_get(yg->wids_to_windows, (void*)(uintptr_t)wm->wid);
-					if (win) {
-						window_move(yg, win, wm->x, wm->y);
-					} else {
-						TRACE("%08x wanted to move window %d, but I can't find it?", p->source, wm->wid);
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_MOVE_RELATIVE:
-				{
-					struct yutani_msg_window_move_relative * wm = (void *)m->data;
-
-					yutani_server_window_t * movee = hashmap_get(yg->wids_to_windows, (void*)(uintptr_t)wm->wid_to_move);
-					yutani_server_window_t * base  = hashmap_get(yg->wids_to_windows, (void*)(uintptr_t)wm->wid_base);
-
-					if (!movee || !base) break;
-
-					/* Map coordinate to new origin location */
-					int32_t nx, ny;
-					yutani_window_to_device(base, wm->x + movee->width / 2, wm->y + movee->height / 2, &nx, &ny);
-					window_move(yg, movee, nx - movee->width / 2, ny - movee->height / 2);
-
-					/* Match window rotation to base window */
-					movee->rotation = base->rotation;
-				}
-				break;
-			case YUTANI_MSG_WINDOW_CLOSE:
-				{
-					struct yutani_msg_window_close * wc = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wc->wid);
-					if (w) {
-						window_mark_for_close(yg, w);
-						window_remove_from_client(yg, w);
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_STACK:
-				{
-					struct yutani_msg_window_stack * ws = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)ws->wid);
-					if (w) {
-						reorder_window(yg, w, ws->z);
-					}
-				}
-				break;
-			case YUTANI_MSG_RESIZE_REQUEST:
-				{
-					struct yutani_msg_window_resize * wr = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
-					if (w) {
-						yutani_msg_buildx_window_resize_alloc(response);
-						yutani_msg_buildx_window_resize(response,YUTANI_MSG_RESIZE_OFFER, w->wid, wr->width, wr->height, 0, w->tiled);
-						pex_send(server, p->source, response->size, (char *)response);
-					}
-				}
-				break;
-			case YUTANI_MSG_RESIZE_OFFER:
-				{
-					struct yutani_msg_window_resize * wr = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
-					if (w) {
-						yutani_msg_buildx_window_resize_alloc(response);
-						yutani_msg_buildx_window_resize(response,YUTANI_MSG_RESIZE_OFFER, w->wid, wr->width, wr->height, 0, w->tiled);
-						pex_send(server, p->source, response->size, (char *)response);
-					}
-				}
+		/* A packet may carry several messages batched by the client;
+		 * each is framed by its own magic and size. */
+		size_t offset = 0;
+		while (offset + sizeof(struct yutani_message) <= p->size) {
+			yutani_msg_t * m = (yutani_msg_t *)(p->data + offset);
+			if (m->magic != YUTANI_MSG__MAGIC) {
+				TRACE("Message has bad magic. (Should eject client, but will instead skip this message.) 0x%x", m->magic);
 				break;
-			case YUTANI_MSG_RESIZE_ACCEPT:
-				{
-					struct yutani_msg_window_resize * wr = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
-					if (w) {
-						uint32_t newbufid = server_window_resize(yg, w, wr->width, wr->height);
-						yutani_msg_buildx_window_resize_alloc(response);
-						yutani_msg_buildx_window_resize(response,YUTANI_MSG_RESIZE_BUFID, w->wid, wr->width, wr->height, newbufid, 0);
-						pex_send(server, p->source, response->size, (char *)response);
-					}
-				}
-				break;
-			case YUTANI_MSG_RESIZE_DONE:
-				{
-					struct yutani_msg_window_resize * wr = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wr->wid);
-					if (w) {
-						server_window_resize_finish(yg, w, wr->width, wr->height);
-					}
-				}
-				break;
-			case YUTANI_MSG_QUERY_WINDOWS:
-				{
-					yutani_query_result(yg, p->source, yg->bottom_z);
-					foreach (node, yg->mid_zs) {
-						yutani_query_result(yg, p->source, node->value);
-					}
-					/* Exclude menus, overlay windows, top and bottom. */
-					yutani_query_result(yg, p->source, yg->top_z);
-					yutani_msg_buildx_window_advertise_alloc(response, 0);
-					yutani_msg_buildx_window_advertise(response,0, 0, 0, 0, 0, 0, 0, NULL);
-					pex_send(server, p->source, response->size, (char *)response);
-				}
-				break;
-			case YUTANI_MSG_SUBSCRIBE:
-				{
-					foreach(node, yg->window_subscribers) {
-						if ((uintptr_t)node->value == p->source) {
-							break;
-						}
-					}
-					list_insert(yg->window_subscribers, (void*)p->source);
-				}
-				break;
-			case YUTANI_MSG_UNSUBSCRIBE:
-				{
-					node_t * node = list_find(yg->window_subscribers, (void*)p->source);
-					if (node) {
-						list_delete(yg->window_subscribers, node);
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_ADVERTISE:
-				{
-					struct yutani_msg_window_advertise * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						if (w->client_strings) free(w->client_strings);
-
-						w->client_icon    = wa->icon;
-						w->client_flags   = wa->flags;
-						w->client_length  = wa->size;
-						w->client_strings = malloc(wa->size);
-						memcpy(w->client_strings, wa->strings, wa->size);
-
-						notify_subscribers(yg);
-					}
-				}
-				break;
-			case YUTANI_MSG_SESSION_END:
-				{
-					yutani_msg_buildx_session_end_alloc(response);
-					yutani_msg_buildx_session_end(response);
-					pex_broadcast(server, response->size, (char *)response);
-				}
-				break;
-			case YUTANI_MSG_WINDOW_FOCUS:
-				{
-					struct yutani_msg_window_focus * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						set_focused_window(yg, w);
-					}
-				}
-				break;
-			case YUTANI_MSG_KEY_BIND:
-				{
-					struct yutani_msg_key_bind * wa = (void *)m->data;
-					add_key_bind(yg, wa, p->source);
-				}
-				break;
-			case YUTANI_MSG_WINDOW_DRAG_START:
-				{
-					struct yutani_msg_window_drag_start * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						/* Start dragging */
-						mouse_start_drag(yg, w);
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_UPDATE_SHAPE:
-				{
-					struct yutani_msg_window_update_shape * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						/* Set shape parameter */
-						server_window_update_shape(yg, w, wa->set_shape);
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_WARP_MOUSE:
-				{
-					struct yutani_msg_window_warp_mouse * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						if (yg->focused_window == w) {
-							int32_t x, y;
-							yutani_window_to_device(w, wa->x, wa->y, &x, &y);
-
-							struct yutani_msg_mouse_event me;
-							me.event.x_difference = x;
-							me.event.y_difference = y;
-							me.event.buttons = yg->last_mouse_buttons;
-							me.type = YUTANI_MOUSE_EVENT_TYPE_ABSOLUTE;
-							me.wid = wa->wid;
-
-							handle_mouse_event(yg, &me);
-						}
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_SHOW_MOUSE:
-				{
-					struct yutani_msg_window_show_mouse * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						if (wa->show_mouse == -1) {
-							w->show_mouse = w->default_mouse;
-						} else if (wa->show_mouse < 2) {
-							w->default_mouse = wa->show_mouse;
-							w->show_mouse = wa->show_mouse;
-						} else {
-							w->show_mouse = wa->show_mouse;
-						}
-						if (yg->focused_window == w) {
-							mark_screen(yg, yg->mouse_x / MOUSE_SCALE - MOUSE_OFFSET_X, yg->mouse_y / MOUSE_SCALE - MOUSE_OFFSET_Y, MOUSE_WIDTH, MOUSE_HEIGHT);
-						}
-					}
-				}
-				break;
-			case YUTANI_MSG_WINDOW_RESIZE_START:
-				{
-					struct yutani_msg_window_resize_start * wa = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)wa->wid);
-					if (w) {
-						if (yg->focused_window == w && !yg->resizing_window) {
-							yg->resizing_window = w;
-							yg->resizing_button = YUTANI_MOUSE_BUTTON_LEFT; /* XXX Uh, what if we used something else */
-							mouse_start_resize(yg, wa->direction);
-						}
-					}
-				}
-				break;
-			case YUTANI_MSG_SPECIAL_REQUEST:
-				{
-					struct yutani_msg_special_request * sr = (void *)m->data;
-					yutani_server_window_t * w = hashmap_get(yg->wids_to_windows, (void *)(uintptr_t)sr->wid);
-					switch (sr->request) {
-						case YUTANI_SPECIAL_REQUEST_MAXIMIZE:
-							if (w) {
-								if (w->tiled) {
-									window_untile(yg,w);
-									window_move(yg,w,w->untiled_left,w->untiled_top);
-								} else {
-									window_tile(yg, w, 1, 1, 0, 0);
-								}
-							}
-							break;
-						case YUTANI_SPECIAL_REQUEST_PLEASE_CLOSE:
-							if (w) {
-								yutani_msg_buildx_window_close_alloc(response);
-								yutani_msg_buildx_window_close(response, w->wid);
-								pex_send(yg->server, w->owner, response->size, (char *)response);
-							}
-							break;
-						case YUTANI_SPECIAL_REQUEST_CLIPBOARD:
-							{
-								yutani_msg_buildx_clipboard_alloc(response, yg->clipboard_size);
-								yutani_msg_buildx_clipboard(response, yg->clipboard);
-								pex_send(server, p->source, response->size, (char *)response);
-							}
-							break;
-						default:
-							TRACE("Unknown special request type: 0x%x", sr->request);
-							break;
-					}
-
-				}
-				break;
-			case YUTANI_MSG_CLIPBOARD:
-				{
-					struct yutani_msg_clipboard * cb = (void *)m->data;
-					yg->clipboard_size = min(cb->size, 511);
-					memcpy(yg->clipboard, cb->content, yg->clipboard_size);
-					yg->clipboard[yg->clipboard_size] = '\0';
-					TRACE("Copied text to clipbard (size=%d)", yg->clipboard_size);
-				}
-				break;
-			default:
-				{
-					TRACE("Unknown type: 0x%8x", m->type);
-				}
+			}
+			if (m->size < sizeof(struct yutani_message) || offset + m->size > p->size) {
+				TRACE("Message has bad size. Skipping the rest of this packet.");
 				break;
+			}
+			handle_client_message(yg, p->source, m);
+			offset += m->size;
 		}
 		free(p);
 	}
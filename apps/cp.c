@@ -15,6 +15,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
 
 #define CHUNK_SIZE 4096
 
@@ -46,14 +47,23 @@ static int copy_file(char * source, char * dest, int mode,int uid, int gid) {
 
 	//fprintf(stderr, "%d bytes to copy\n", length);
 
-	char buf[CHUNK_SIZE];
-
+	/* Copy in the kernel: the data moves through one kernel staging
+	 * buffer instead of bouncing every byte through userspace. */
 	while (length > 0) {
-		size_t r = read(s_fd, buf, length < CHUNK_SIZE ? length : CHUNK_SIZE);
-		//fprintf(stderr, "copying %d bytes from %s to %s\n", r, source, dest);
-		write(d_fd, buf, r);
-		length -= r;
-		//fprintf(stderr, "%d bytes remaining\n", length);
+		ssize_t w = sendfile(d_fd, s_fd, NULL, length);
+		if (w < 0) {
+			/* Pipes and other things that can't sendfile. */
+			char buf[CHUNK_SIZE];
+			while (length > 0) {
+				ssize_t r = read(s_fd, buf, length < CHUNK_SIZE ? length : CHUNK_SIZE);
+				if (r <= 0) break;
+				write(d_fd, buf, r);
+				length -= r;
+			}
+			break;
+		}
+		if (w == 0) break;
+		length -= w;
 	}
 
 	close(s_fd);
@@ -392,6 +392,45 @@ static void attempt_backtrace(pid_t pid, struct regs * regs) {
 }
 
 
+/* What each hardware breakpoint slot is being used for, so we can
+ * list them and pick a free one; the kernel holds the real state. */
+static struct {
+	int used;
+	uintptr_t addr;
+	const char * kind;
+} hw_slots[4];
+
+/* Widest DR7 length encoding the address's alignment allows */
+static int watch_length(uintptr_t addr) {
+	if (!(addr & 7)) return PTRACE_HWBREAK_LEN_8;
+	if (!(addr & 3)) return PTRACE_HWBREAK_LEN_4;
+	if (!(addr & 1)) return PTRACE_HWBREAK_LEN_2;
+	return PTRACE_HWBREAK_LEN_1;
+}
+
+static void set_hw_break(pid_t pid, uintptr_t addr, int condition, const char * kind) {
+	int slot = -1;
+	for (int i = 0; i < 4; ++i) {
+		if (!hw_slots[i].used) { slot = i; break; }
+	}
+	if (slot == -1) {
+		fprintf(stderr, "All four hardware breakpoint slots are in use; 'delete' one first.\n");
+		return;
+	}
+
+	int len = (condition == PTRACE_HWBREAK_EXEC) ? PTRACE_HWBREAK_LEN_1 : watch_length(addr);
+	if (ptrace(PTRACE_SETHWBREAK, pid, (void*)addr,
+	           (void*)(uintptr_t)(PTRACE_HWBREAK_SLOT(slot) | condition | len))) {
+		fprintf(stderr, "hardware breakpoint: %s\n", strerror(errno));
+		return;
+	}
+
+	hw_slots[slot].used = 1;
+	hw_slots[slot].addr = addr;
+	hw_slots[slot].kind = kind;
+	fprintf(stderr, "Slot %d: %s at %#zx\n", slot, kind, addr);
+}
+
 static void show_commandline(pid_t pid, int status, struct regs * regs) {
 
 	fprintf(stderr, "[Process %d, $rip=%#zx]\n",
@@ -444,6 +483,7 @@ static void show_commandline(pid_t pid, int status, struct regs * regs) {
 				fprintf(stderr, "Things that can be shown:\n");
 				fprintf(stderr, "   regs\n");
 				fprintf(stderr, "   libs\n");
+				fprintf(stderr, "   watch\n");
 				continue;
 			}
 
@@ -451,6 +491,12 @@ static void show_commandline(pid_t pid, int status, struct regs * regs) {
 				dump_regs(regs);
 			} else if (!strcmp(arg, "libs")) {
 				show_libs(pid);
+			} else if (!strcmp(arg, "watch")) {
+				for (int i = 0; i < 4; ++i) {
+					if (hw_slots[i].used) {
+						fprintf(stderr, "Slot %d: %s at %#zx\n", i, hw_slots[i].kind, hw_slots[i].addr);
+					}
+				}
 			} else {
 				fprintf(stderr, "Don't know how to show '%s'\n", arg);
 			}
@@ -483,6 +529,34 @@ static void show_commandline(pid_t pid, int status, struct regs * regs) {
 				continue;
 			}
 
+		} else if (!strcmp(buf, "watch") || !strcmp(buf, "rwatch") || !strcmp(buf, "hbreak")) {
+			if (!arg) {
+				fprintf(stderr, "usage: %s addr\n", buf);
+				continue;
+			}
+			uintptr_t addr = strtoul(arg, NULL, 0);
+			if (!strcmp(buf, "watch")) {
+				set_hw_break(pid, addr, PTRACE_HWBREAK_WRITE, "watch (write)");
+			} else if (!strcmp(buf, "rwatch")) {
+				set_hw_break(pid, addr, PTRACE_HWBREAK_RW, "watch (read/write)");
+			} else {
+				set_hw_break(pid, addr, PTRACE_HWBREAK_EXEC, "breakpoint");
+			}
+		} else if (!strcmp(buf, "delete")) {
+			if (!arg) {
+				fprintf(stderr, "usage: delete slot\n");
+				continue;
+			}
+			int slot = atoi(arg);
+			if (slot < 0 || slot > 3 || !hw_slots[slot].used) {
+				fprintf(stderr, "No such slot.\n");
+				continue;
+			}
+			if (ptrace(PTRACE_CLEARHWBREAK, pid, NULL, (void*)(uintptr_t)slot)) {
+				fprintf(stderr, "delete: %s\n", strerror(errno));
+				continue;
+			}
+			hw_slots[slot].used = 0;
 		} else if (!strcmp(buf, "print") || !strcmp(buf,"p")) {
 			char * fmt = arg;
 			char * sp = strstr(arg, " ");
@@ -692,6 +766,13 @@ int main(int argc, char * argv[]) {
 								show_commandline(res, status, &regs);
 							}
 							break;
+						case PTRACE_EVENT_HWBREAK: {
+								struct regs regs;
+								ptrace(PTRACE_GETREGS, res, NULL, &regs);
+								printf("Hardware breakpoint reached.\n");
+								show_commandline(res, status, &regs);
+							}
+							break;
 						default:
 							//ptrace(PTRACE_SIGNALS_ONLY_PLZ, p, NULL, NULL);
 							ptrace(PTRACE_CONT, res, NULL, NULL);
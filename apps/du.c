@@ -9,21 +9,19 @@
  * Copyright (C) 2018 K. Lange
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
-#include <dirent.h>
 
-#include <fcntl.h>
 #include <sys/stat.h>
-#include <sys/ioctl.h>
+
+#include <toaru/walker.h>
 
 static int show_total = 0;
 static int human = 0;
 static int all = 1;
-static int is_arg = 0;
-
-static uint64_t count_thing(char * tmp);
+static int jobs = 1;
 
 static int print_human_readable_size(char * _out, size_t s) {
 	if (s >= 1<<20) {
@@ -37,7 +35,7 @@ static int print_human_readable_size(char * _out, size_t s) {
 	}
 }
 
-static void print_size(uint64_t size, char * name) {
+static void print_size(uint64_t size, const char * name) {
 	char sizes[30];
 	if (!human) {
 		sprintf(sizes, "%-7llu", size/1024LLU);
@@ -50,55 +48,62 @@ static void print_size(uint64_t size, char * name) {
 	fprintf(stdout, "%7s %s\n", sizes, name);
 }
 
-static uint64_t count_directory(char * source) {
-	DIR * dirp = opendir(source);
-	if (dirp == NULL) {
-		//fprintf(stderr, "could not open %s\n", source);
-		return 0;
-	}
-
-	int was_arg = is_arg;
-	is_arg = 0;
-
-	uint64_t total = 0;
-
-	struct dirent * ent = readdir(dirp);
-	while (ent != NULL) {
-		if (!strcmp(ent->d_name,".") || !strcmp(ent->d_name,"..")) {
-			ent = readdir(dirp);
-			continue;
+/* Running totals for the directories we are inside of; directory
+ * sizes print on the way back out, as the walker leaves them. */
+struct totals {
+	uint64_t * stack;
+	int depth;
+	int space;
+	uint64_t result;
+};
+
+static int count_callback(int event, const char * path, struct stat * st, void * extra) {
+	struct totals * t = extra;
+	switch (event) {
+		case WALKER_DIR_ENTER:
+			if (t->depth == t->space) {
+				t->space *= 2;
+				t->stack = realloc(t->stack, t->space * sizeof(uint64_t));
+			}
+			t->stack[t->depth++] = 0;
+			break;
+		case WALKER_FILE:
+			if (t->depth) {
+				t->stack[t->depth-1] += st->st_size;
+			} else {
+				/* The argument itself was a file. */
+				print_size(st->st_size, path);
+				t->result += st->st_size;
+			}
+			break;
+		case WALKER_DIR_LEAVE: {
+			uint64_t total = t->stack[--t->depth];
+			if (all || t->depth == 0) {
+				print_size(total, path);
+			}
+			if (t->depth) {
+				t->stack[t->depth-1] += total;
+			} else {
+				t->result += total;
+			}
+			break;
 		}
-		char tmp[strlen(source)+strlen(ent->d_name)+2];
-		sprintf(tmp, "%s/%s", source, ent->d_name);
-		total += count_thing(tmp);
-		ent = readdir(dirp);
-	}
-	closedir(dirp);
-
-	if (all || was_arg) {
-		print_size(total, source);
 	}
-
-	return total;
+	return WALKER_CONTINUE;
 }
 
-static uint64_t count_thing(char * tmp) {
-	struct stat statbuf;
-	lstat(tmp,&statbuf);
-	if (S_ISDIR(statbuf.st_mode)) {
-		return count_directory(tmp);
-	} else {
-		if (is_arg) {
-			print_size(statbuf.st_size, tmp);
-		}
-		return statbuf.st_size;
+/* With -j the walker runs subtrees on several threads, so there is no
+ * per-directory ordering to print; just sum everything. */
+static int sum_callback(int event, const char * path, struct stat * st, void * extra) {
+	if (event == WALKER_FILE) {
+		__sync_fetch_and_add((uint64_t *)extra, st->st_size);
 	}
+	return WALKER_CONTINUE;
 }
 
-
 int main(int argc, char * argv[]) {
 	int opt;
-	while ((opt = getopt(argc, argv, "hsc")) != -1) {
+	while ((opt = getopt(argc, argv, "hscj:")) != -1) {
 		switch (opt) {
 			case 'h': /* human readable */
 				human = 1;
@@ -109,8 +114,12 @@ int main(int argc, char * argv[]) {
 			case 's': /* summary */
 				all = 0;
 				break;
+			case 'j': /* walker threads; implies -s */
+				jobs = atoi(optarg);
+				all = 0;
+				break;
 			default:
-				fprintf(stderr, "rm: unrecognized option '%c'\n", opt);
+				fprintf(stderr, "du: unrecognized option '%c'\n", opt);
 				break;
 		}
 	}
@@ -119,8 +128,17 @@ int main(int argc, char * argv[]) {
 	uint64_t total = 0;
 
 	for (int i = optind; i < argc; ++i) {
-		is_arg = 1;
-		total += count_thing(argv[i]);
+		if (jobs > 1) {
+			uint64_t sum = 0;
+			walker_walk_threaded(argv[i], jobs, sum_callback, &sum);
+			print_size(sum, argv[i]);
+			total += sum;
+		} else {
+			struct totals t = { malloc(64 * sizeof(uint64_t)), 0, 64, 0 };
+			walker_walk(argv[i], count_callback, &t);
+			total += t.result;
+			free(t.stack);
+		}
 	}
 
 	if (show_total) {
@@ -129,4 +147,3 @@ int main(int argc, char * argv[]) {
 
 	return ret;
 }
-
@@ -4,43 +4,255 @@
  * Locates strings in files and prints the lines containing them,
  * with extra color identification if stdout is a tty.
  *
+ * Searches block-at-a-time rather than line-at-a-time: input is read
+ * in 64K chunks and scanned with a memchr-driven first-byte filter
+ * (plus a last-byte check before the full compare), or a
+ * Boyer-Moore-Horspool skip loop for longer needles. Multiple fixed
+ * patterns (-e) go through an Aho-Corasick automaton so the input is
+ * still scanned once. Newlines are counted during the same pass,
+ * which is what backs -n.
+ *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
  * Copyright (C) 2014-2018 K. Lange
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 
-#define LINE_SIZE 4096
+#define BLOCK_SIZE 0x10000
+#define BMH_THRESHOLD 8 /* Needles at least this long use the skip loop. */
 
-int main(int argc, char ** argv) {
-	if (argc < 2) {
-		fprintf(stderr, "usage: %s thing-to-grep-for\n", argv[0]);
-		return 1;
-	}
-
-	char * needle = argv[1];
-	char buf[LINE_SIZE];
-	int ret = 1;
-	int is_tty = isatty(STDOUT_FILENO);
-
-	while (fgets(buf, LINE_SIZE, stdin)) {
-		char * found = strstr(buf, needle);
-		if (found) {
-			if (is_tty) {
-				*found = '\0';
-				found += strlen(needle);
-				fprintf(stdout, "%s\033[1;31m%s\033[0m%s", buf, needle, found);
+static char ** patterns = NULL;
+static size_t * pattern_lens = NULL;
+static int pattern_count = 0;
+static int is_tty = 0;
+static int line_numbers = 0;
+static size_t line_no = 1;
+static int found_any = 0;
+
+static size_t bmh_skip[256];
+
+/* Aho-Corasick automaton for multiple patterns, built as a DFA so the
+ * scan is one table step per byte. */
+struct ac_node {
+	uint16_t next[256];
+	int16_t match; /* Pattern index ending here, or -1. */
+};
+static struct ac_node * ac = NULL;
+static int ac_states = 0;
+
+static void ac_build(void) {
+	size_t total = 1;
+	for (int i = 0; i < pattern_count; ++i) total += pattern_lens[i];
+	ac = calloc(total, sizeof(struct ac_node));
+
+	/* Trie */
+	ac_states = 1;
+	ac[0].match = -1;
+	for (int i = 0; i < pattern_count; ++i) {
+		int state = 0;
+		for (size_t j = 0; j < pattern_lens[i]; ++j) {
+			unsigned char c = patterns[i][j];
+			if (!ac[state].next[c]) {
+				ac[ac_states].match = -1;
+				ac[state].next[c] = ac_states++;
+			}
+			state = ac[state].next[c];
+		}
+		ac[state].match = i;
+	}
+
+	/* Failure links, breadth-first, folded straight into the
+	 * transition table; 'match' inherits the longest suffix match. */
+	uint16_t * fail = calloc(ac_states, sizeof(uint16_t));
+	uint16_t * queue = malloc(ac_states * sizeof(uint16_t));
+	int qh = 0, qt = 0;
+	for (int c = 0; c < 256; ++c) {
+		if (ac[0].next[c]) queue[qt++] = ac[0].next[c];
+	}
+	while (qh < qt) {
+		int state = queue[qh++];
+		if (ac[state].match < 0 && ac[fail[state]].match >= 0) {
+			ac[state].match = ac[fail[state]].match;
+		}
+		for (int c = 0; c < 256; ++c) {
+			int t = ac[state].next[c];
+			if (t) {
+				fail[t] = ac[fail[state]].next[c];
+				queue[qt++] = t;
 			} else {
-				fprintf(stdout, "%s", buf);
+				ac[state].next[c] = ac[fail[state]].next[c];
 			}
-			ret = 0;
 		}
 	}
+	free(queue);
+	free(fail);
+}
+
+/* Print the line containing a match that starts at @p match; returns
+ * the end of the printed line so later matches on the same line can
+ * be skipped. */
+static const char * print_match(const char * match, int which,
+		const char * block, const char * search_end, const char ** count_pos) {
+	const char * ls = match;
+	while (ls > block && ls[-1] != '\n') ls--;
+	const char * le = memchr(match, '\n', search_end - match);
+	le = le ? le + 1 : search_end;
+
+	if (line_numbers) {
+		for (const char * p = *count_pos; (p = memchr(p, '\n', ls - p)); line_no++) p++;
+		*count_pos = ls;
+		fprintf(stdout, "%zu:", line_no);
+	}
+
+	if (is_tty) {
+		fwrite(ls, 1, match - ls, stdout);
+		fprintf(stdout, "\033[1;31m");
+		fwrite(match, 1, pattern_lens[which], stdout);
+		fprintf(stdout, "\033[0m");
+		fwrite(match + pattern_lens[which], 1, le - match - pattern_lens[which], stdout);
+	} else {
+		fwrite(ls, 1, le - ls, stdout);
+	}
 
-	return ret;
+	found_any = 1;
+	return le;
 }
 
+static void scan_block(const char * block, size_t len) {
+	const char * end = block + len;
+	const char * count_pos = block;
+	const char * p = block;
+
+	if (pattern_count > 1) {
+		int state = 0;
+		while (p < end) {
+			state = ac[state].next[(unsigned char)*p++];
+			if (ac[state].match >= 0) {
+				int which = ac[state].match;
+				const char * le = print_match(p - pattern_lens[which], which, block, end, &count_pos);
+				if (le > p) p = le;
+				state = 0;
+			}
+		}
+	} else if (pattern_lens[0] >= BMH_THRESHOLD) {
+		size_t nlen = pattern_lens[0];
+		unsigned char last = patterns[0][nlen - 1];
+		while (p + nlen <= end) {
+			unsigned char c = p[nlen - 1];
+			if (c == last && !memcmp(p, patterns[0], nlen)) {
+				p = print_match(p, 0, block, end, &count_pos);
+				continue;
+			}
+			p += bmh_skip[c];
+		}
+	} else {
+		char first = patterns[0][0];
+		char last = patterns[0][pattern_lens[0] - 1];
+		size_t nlen = pattern_lens[0];
+		while (p + nlen <= end && (p = memchr(p, first, end - p - nlen + 1))) {
+			if (p[nlen - 1] == last && !memcmp(p, patterns[0], nlen)) {
+				p = print_match(p, 0, block, end, &count_pos);
+			} else {
+				p++;
+			}
+		}
+	}
+
+	if (line_numbers) {
+		for (const char * q = count_pos; (q = memchr(q, '\n', end - q)); line_no++) q++;
+	}
+}
+
+int main(int argc, char ** argv) {
+	int opt;
+	while ((opt = getopt(argc, argv, "e:n")) != -1) {
+		switch (opt) {
+			case 'e':
+				patterns = realloc(patterns, (pattern_count + 1) * sizeof(char *));
+				pattern_lens = realloc(pattern_lens, (pattern_count + 1) * sizeof(size_t));
+				patterns[pattern_count] = optarg;
+				pattern_lens[pattern_count] = strlen(optarg);
+				pattern_count++;
+				break;
+			case 'n':
+				line_numbers = 1;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-n] [-e pattern]... [pattern]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if (!pattern_count) {
+		if (optind >= argc) {
+			fprintf(stderr, "usage: %s [-n] [-e pattern]... [pattern]\n", argv[0]);
+			return 1;
+		}
+		patterns = malloc(sizeof(char *));
+		pattern_lens = malloc(sizeof(size_t));
+		patterns[0] = argv[optind];
+		pattern_lens[0] = strlen(argv[optind]);
+		pattern_count = 1;
+	}
+
+	for (int i = 0; i < pattern_count; ++i) {
+		if (!pattern_lens[i]) {
+			fprintf(stderr, "%s: empty pattern\n", argv[0]);
+			return 1;
+		}
+	}
+
+	is_tty = isatty(STDOUT_FILENO);
+
+	if (pattern_count > 1) {
+		ac_build();
+	} else if (pattern_lens[0] >= BMH_THRESHOLD) {
+		/* Horspool bad-character table over all but the last byte. */
+		for (int i = 0; i < 256; ++i) bmh_skip[i] = pattern_lens[0];
+		for (size_t i = 0; i + 1 < pattern_lens[0]; ++i) {
+			bmh_skip[(unsigned char)patterns[0][i]] = pattern_lens[0] - 1 - i;
+		}
+	}
+
+	size_t space = BLOCK_SIZE;
+	char * buf = malloc(space);
+	size_t held = 0;
+
+	while (1) {
+		ssize_t r = read(STDIN_FILENO, buf + held, space - held);
+		if (r < 0) break;
+		held += r;
+
+		if (r == 0) {
+			/* Whatever is left is the final (unterminated) line. */
+			if (held) scan_block(buf, held);
+			break;
+		}
+
+		/* Search everything up to the last complete line; the tail is
+		 * carried over so no match straddles a read boundary. */
+		char * last_nl = memrchr(buf, '\n', held);
+		if (!last_nl) {
+			if (held == space) {
+				/* One line bigger than the buffer; grow and keep reading. */
+				space *= 2;
+				buf = realloc(buf, space);
+			}
+			continue;
+		}
+
+		size_t search = last_nl + 1 - buf;
+		scan_block(buf, search);
+		memmove(buf, buf + search, held - search);
+		held -= search;
+	}
+
+	free(buf);
+	return found_any ? 0 : 1;
+}
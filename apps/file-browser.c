@@ -76,6 +76,7 @@ static char * current_directory = NULL; /* Current directory path */
 static int hilighted_offset = -1; /* Which file is hovered by the mouse */
 static struct File ** file_pointers = NULL; /* List of file pointers */
 static ssize_t file_pointers_len = 0; /* How many files are in the current list */
+static DIR * pending_directory = NULL; /* Directory stream for a scan still in progress */
 static uint64_t last_click = 0; /* For double click */
 static int last_click_offset = -1; /* So that clicking two different things quickly doesn't count as a double click */
 static struct TT_Font * tt_font_thin = NULL;
@@ -458,7 +459,8 @@ static void update_status(void) {
 	char tmp_size[50];
 	if (selected_count == 0) {
 		print_human_readable_size(tmp_size, total_size);
-		sprintf(window_status, "%zd item%s (%s)", file_pointers_len, file_pointers_len == 1 ? "" : "s", tmp_size);
+		sprintf(window_status, "%zd item%s (%s)%s", file_pointers_len, file_pointers_len == 1 ? "" : "s", tmp_size,
+			pending_directory ? ", scanning..." : "");
 	} else if (selected_count == 1) {
 		print_human_readable_size(tmp_size, selected->size);
 		sprintf(window_status, "\"%s\" (%s) %s", selected->name, tmp_size, selected->filetype);
@@ -468,6 +470,390 @@ static void update_status(void) {
 	}
 }
 
+
+/**
+ * Cached directory listings.
+ *
+ * Scanning a directory costs an lstat() for every entry, which hurts on
+ * large directories and slow media, so once a scan completes we dump the
+ * finished listing under ~/.cache/file-browser, keyed by a hash of the
+ * directory path and validated against the directory's mtime. Creating,
+ * deleting, or renaming entries bumps the mtime and invalidates the
+ * cache; modifying a file in place does not, which is what Refresh is
+ * for - it drops the cache entry before rescanning.
+ */
+#define CACHE_VERSION 1
+struct cache_header {
+	uint32_t version;    /* CACHE_VERSION when the listing was written */
+	uint32_t flags;      /* show_hidden when the listing was written */
+	uint64_t mtime;      /* Directory mtime when the listing was written */
+	uint32_t count;      /* How many struct Files follow the path */
+	uint32_t path_len;   /* Length of the verification path, including nil */
+};
+
+/**
+ * Calculate the cache file name for a directory, using the same sdbm
+ * hash the hashmap library uses for string keys; the path itself is
+ * stored in the cache file to disambiguate collisions.
+ */
+static char * cache_file_for(const char * path) {
+	char * home = getenv("HOME");
+	if (!home) return NULL;
+	unsigned int hash = 0;
+	for (const char * c = path; *c; ++c) {
+		hash = *c + (hash << 6) + (hash << 16) - hash;
+	}
+	static char out[1024];
+	sprintf(out, "%s/.cache/file-browser/%08x", home, hash);
+	return out;
+}
+
+/**
+ * Try to fill the file view from the listing cache. Returns 0 if there
+ * is no cache entry for this directory or it is out of date.
+ */
+static int load_directory_from_cache(const char * path) {
+	if (is_desktop_background) return 0; /* launchers are parsed from file contents */
+
+	char * cpath = cache_file_for(path);
+	if (!cpath) return 0;
+
+	struct stat dirstat;
+	if (stat(path, &dirstat)) return 0;
+
+	FILE * c = fopen(cpath, "r");
+	if (!c) return 0;
+
+	struct cache_header hdr;
+	char stored[1024];
+	if (fread(&hdr, sizeof(struct cache_header), 1, c) != 1 ||
+	    hdr.version != CACHE_VERSION ||
+	    hdr.flags != (uint32_t)show_hidden ||
+	    hdr.mtime != (uint64_t)dirstat.st_mtime ||
+	    hdr.path_len != strlen(path) + 1 ||
+	    hdr.path_len > sizeof(stored) ||
+	    fread(stored, 1, hdr.path_len, c) != hdr.path_len ||
+	    strcmp(stored, path)) {
+		fclose(c);
+		return 0;
+	}
+
+	struct File ** out = malloc(sizeof(struct File *) * hdr.count);
+	for (uint32_t i = 0; i < hdr.count; ++i) {
+		struct File * f = malloc(sizeof(struct File));
+		if (fread(f, sizeof(struct File), 1, c) != 1) {
+			/* Truncated cache; throw the whole thing out */
+			free(f);
+			for (uint32_t j = 0; j < i; ++j) free(out[j]);
+			free(out);
+			fclose(c);
+			return 0;
+		}
+		f->selected = 0;
+		out[i] = f;
+	}
+	fclose(c);
+
+	file_pointers = out;
+	file_pointers_len = hdr.count;
+	update_status();
+	return 1;
+}
+
+/**
+ * Write the current (complete, sorted) listing to the cache.
+ */
+static void save_directory_to_cache(void) {
+	if (is_desktop_background) return;
+
+	char * cpath = cache_file_for(current_directory);
+	if (!cpath) return;
+
+	struct stat dirstat;
+	if (stat(current_directory, &dirstat)) return;
+
+	/* Make sure the cache directory exists */
+	char tmp[1024];
+	sprintf(tmp, "%s/.cache", getenv("HOME"));
+	mkdir(tmp, 0755);
+	strcat(tmp, "/file-browser");
+	mkdir(tmp, 0755);
+
+	FILE * c = fopen(cpath, "w");
+	if (!c) return;
+
+	struct cache_header hdr = {
+		.version  = CACHE_VERSION,
+		.flags    = (uint32_t)show_hidden,
+		.mtime    = (uint64_t)dirstat.st_mtime,
+		.count    = (uint32_t)file_pointers_len,
+		.path_len = (uint32_t)strlen(current_directory) + 1,
+	};
+	fwrite(&hdr, sizeof(struct cache_header), 1, c);
+	fwrite(current_directory, 1, hdr.path_len, c);
+	for (ssize_t i = 0; i < file_pointers_len; ++i) {
+		fwrite(file_pointers[i], sizeof(struct File), 1, c);
+	}
+	fclose(c);
+}
+
+/**
+ * Build a display entry for one directory entry: figure out its icon,
+ * type description, and what launching it should do. Returns NULL for
+ * entries that shouldn't be shown.
+ */
+static struct File * file_from_dirent(const char * path, struct dirent * ent) {
+	if (ent->d_name[0] == '.' &&
+		(ent->d_name[1] == '\0' ||
+		 (ent->d_name[1] == '.' &&
+		  ent->d_name[2] == '\0'))) {
+		/* skip . and .. */
+		return NULL;
+	}
+	if (!show_hidden && ent->d_name[0] == '.') return NULL;
+
+	/* Set display name from file name */
+	struct File * f = malloc(sizeof(struct File));
+	sprintf(f->name, "%s", ent->d_name); /* snprintf? copy min()? */
+
+	struct stat statbuf;
+	struct stat statbufl;
+
+	/* Calculate absolute path to file */
+	char tmp[strlen(path)+strlen(ent->d_name)+2];
+	sprintf(tmp, "%s/%s", path, ent->d_name);
+	lstat(tmp, &statbuf);
+
+	f->size = statbuf.st_size;
+
+	/* Read link target for symlinks */
+	if (S_ISLNK(statbuf.st_mode)) {
+		memcpy(&statbufl, &statbuf, sizeof(struct stat));
+		stat(tmp, &statbuf);
+		readlink(tmp, f->link, 256);
+	} else {
+		f->link[0] = '\0';
+	}
+
+	f->launcher[0] = '\0';
+	f->filetype[0] = '\0';
+	f->selected = 0;
+
+	if (S_ISDIR(statbuf.st_mode)) {
+		/* Is this /cdrom? */
+		if (!strcmp(tmp,"//cdrom")) {
+			sprintf(f->icon, "cd");
+		} else {
+			sprintf(f->icon, "folder");
+		}
+		sprintf(f->filetype, "Directory");
+		f->type = 1;
+	} else {
+		/* Regular file */
+
+		/* Default regular files to open in bim */
+		sprintf(f->launcher, "exec terminal bim");
+
+		if (is_desktop_background && has_extension(f, ".launcher")) {
+			/* In desktop mode, read launchers specially */
+			FILE * file = fopen(tmp,"r");
+			char tbuf[1024];
+			while (!feof(file)) {
+				fgets(tbuf, 1024, file);
+				char * nl = strchr(tbuf,'\n');
+				if (nl) *nl = '\0';
+				char * eq = strchr(tbuf,'=');
+				if (!eq) continue;
+				*eq = '\0'; eq++;
+
+				if (!strcmp(tbuf, "icon")) {
+					sprintf(f->icon, "%s", eq);
+				} else if (!strcmp(tbuf, "run")) {
+					sprintf(f->launcher, "%s #", eq);
+				} else if (!strcmp(tbuf, "title")) {
+					sprintf(f->name, eq);
+				}
+			}
+			sprintf(f->filetype, "Launcher");
+			sprintf(f->filename, "%s", ent->d_name);
+			f->type = 2;
+		} else {
+			/* Handle various file types */
+			if (has_extension(f, ".c")) {
+				sprintf(f->icon, "c");
+				sprintf(f->filetype, "C Source");
+			} else if (has_extension(f, ".h")) {
+				sprintf(f->icon, "h");
+				sprintf(f->filetype, "C Header");
+			} else if (has_extension(f, ".bmp")) {
+				sprintf(f->icon, "image");
+				sprintf(f->launcher, "exec imgviewer");
+				sprintf(f->filetype, "Bitmap Image");
+			} else if (has_extension(f, ".tga")) {
+				sprintf(f->icon, "image");
+				sprintf(f->launcher, "exec imgviewer");
+				sprintf(f->filetype, "Targa Image");
+			} else if (has_extension(f, ".jpg") || has_extension(f,".jpeg")) {
+				sprintf(f->icon, "image");
+				sprintf(f->launcher, "exec imgviewer");
+				sprintf(f->filetype, "JPEG Image");
+			} else if (has_extension(f, ".png")) {
+				sprintf(f->icon, "image");
+				sprintf(f->launcher, "exec imgviewer");
+				sprintf(f->filetype, "Portable Network Graphics Image");
+			} else if (has_extension(f, ".sdf")) {
+				sprintf(f->icon, "font");
+				sprintf(f->filetype, "Legacy SDF Font");
+			} else if (has_extension(f, ".ttf")) {
+				sprintf(f->icon, "font");
+				sprintf(f->launcher,"exec font-preview");
+				sprintf(f->filetype, "TrueType Font");
+			} else if (has_extension(f, ".pdf")) {
+				sprintf(f->icon, "pdf");
+				sprintf(f->launcher,"exec maybe-pdfviewer.krk");
+				sprintf(f->filetype, "Portable Document Format");
+			} else if (has_extension(f, ".tgz") || has_extension(f, ".tar.gz")) {
+				sprintf(f->icon, "package_targz");
+				sprintf(f->filetype, "Compressed Archive File");
+				/* TODO: Archive viewer */
+			} else if (has_extension(f, ".tar")) {
+				sprintf(f->icon, "package_tar");
+				sprintf(f->filetype, "Archive File");
+			} else if (has_extension(f, ".a")) {
+				sprintf(f->icon, "package_a");
+				sprintf(f->filetype, "Archive File");
+			} else if (has_extension(f, ".zip")) {
+				sprintf(f->icon, "package_zip");
+				sprintf(f->filetype, "ZIP Archive File");
+			} else if (has_extension(f, ".sh")) {
+				sprintf(f->icon, "sh");
+				if (statbuf.st_mode & 0111) {
+					/* Make executable */
+					sprintf(f->launcher, "SELF");
+					sprintf(f->filetype, "Executable Shell Script");
+				} else {
+					sprintf(f->filetype, "Shell Script");
+				}
+			} else if (has_extension(f, ".krk")) {
+				sprintf(f->icon, "krk");
+				if (statbuf.st_mode & 0111) {
+					/* Make executable */
+					sprintf(f->launcher, "SELF");
+					sprintf(f->filetype, "Executable Kuroko Script");
+				} else {
+					sprintf(f->filetype, "Kuroko Script");
+				}
+			} else if (has_extension(f, ".py")) {
+				sprintf(f->icon, "py");
+				if (statbuf.st_mode & 0111) {
+					/* Make executable */
+					sprintf(f->launcher, "SELF");
+					sprintf(f->filetype, "Executable Python Script");
+				} else {
+					sprintf(f->filetype, "Python Script");
+				}
+			} else if (has_extension(f, ".ko")) {
+				sprintf(f->icon, "so");
+				sprintf(f->filetype, "Kernel Module");
+			} else if (has_extension(f, ".o")) {
+				sprintf(f->icon, "so");
+				sprintf(f->filetype, "Object File");
+			} else if (has_extension(f, ".so")) {
+				sprintf(f->icon, "so");
+				sprintf(f->filetype, "Shared Object File");
+			} else if (has_extension(f, ".S")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Assembly Source");
+			} else if (has_extension(f, ".ld")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Linker Script");
+			} else if (has_extension(f, ".md")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Markdown Text Document");
+			} else if (has_extension(f, ".eshrc")) {
+				sprintf(f->icon, "sh");
+				sprintf(f->filetype, "Shell Configuration");
+			} else if (has_extension(f, ".bim3rc")) {
+				sprintf(f->icon, "krk");
+				sprintf(f->filetype, "Bim Configuration");
+			} else if (has_extension(f, ".biminfo")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Bim Status Cache");
+			} else if (has_extension(f, ".conf")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Configuration File");
+			} else if (has_extension(f, ".launcher")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Application Launcher");
+			} else if (has_extension(f, ".trt")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "Toaru Rich Text Document");
+				sprintf(f->launcher, "exec help-browser");
+			} else if (has_extension(f, ".json")) {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "JavaScript Object Notation File");
+			} else if (statbuf.st_mode & 0111) {
+				/* Executable files - use their name for their icon, and launch themselves. */
+				sprintf(f->icon, "%s", f->name);
+				sprintf(f->launcher, "SELF");
+				sprintf(f->filetype, "Executable");
+			} else {
+				sprintf(f->icon, "file");
+				sprintf(f->filetype, "File");
+			}
+			f->type = 0;
+		}
+	}
+
+
+	return f;
+}
+
+/* Launchers sort before directories before files, then by name. */
+static int file_comparator(const void * c1, const void * c2) {
+	const struct File * f1 = *(const struct File **)(c1);
+	const struct File * f2 = *(const struct File **)(c2);
+	if (f1->type > f2->type) return -1;
+	if (f2->type > f1->type) return 1;
+	/* Launchers sorted by filename, not by display name */
+	if (f1->type == 2 && f2->type == 2) {
+		return strcmp(f1->filename, f2->filename);
+	}
+	/* Files sorted by name */
+	return strcmp(f1->name, f2->name);
+}
+
+#define SCAN_CHUNK 64
+
+/**
+ * Pull the next batch of entries from an in-progress directory scan,
+ * keeping the flat array sorted as it grows. Returns nonzero while
+ * entries remain, so the main loop knows to keep pumping.
+ */
+static int load_directory_pump(void) {
+	if (!pending_directory) return 0;
+
+	struct dirent * ent = NULL;
+	for (int count = 0; count < SCAN_CHUNK && (ent = readdir(pending_directory)); count++) {
+		struct File * f = file_from_dirent(current_directory, ent);
+		if (!f) continue;
+		file_pointers = realloc(file_pointers, sizeof(struct File *) * (file_pointers_len + 1));
+		file_pointers[file_pointers_len] = f;
+		file_pointers_len++;
+	}
+
+	qsort(file_pointers, file_pointers_len, sizeof(struct File *), file_comparator);
+
+	if (!ent) {
+		/* That was everything; remember the listing for next time. */
+		closedir(pending_directory);
+		pending_directory = NULL;
+		save_directory_to_cache();
+	}
+
+	update_status();
+	return !!pending_directory;
+}
 /**
  * Read the contents of a directory into the icon view.
  */
@@ -492,12 +878,20 @@ static void load_directory(const char * path, int modifies_history) {
 		return;
 	}
 
+	/* If a previous scan is still in progress, abandon it. */
+	if (pending_directory) {
+		closedir(pending_directory);
+		pending_directory = NULL;
+	}
+
 	/* Free the previously loaded directory */
 	if (file_pointers) {
 		for (int i = 0; i < file_pointers_len; ++i) {
 			free(file_pointers[i]);
 		}
 		free(file_pointers);
+		file_pointers = NULL;
+		file_pointers_len = 0;
 	}
 
 	if (modifies_history) {
@@ -559,252 +953,19 @@ static void load_directory(const char * path, int modifies_history) {
 	int this_year = timeinfo->tm_year;
 #endif
 
-	list_t * file_list = list_create();
-
-	struct dirent * ent = readdir(dirp);
-	while (ent != NULL) {
-		if (ent->d_name[0] == '.' &&
-			(ent->d_name[1] == '\0' || 
-			 (ent->d_name[1] == '.' &&
-			  ent->d_name[2] == '\0'))) {
-			/* skip . and .. */
-			ent = readdir(dirp);
-			continue;
-		}
-		if (show_hidden || (ent->d_name[0] != '.')) {
-
-			/* Set display name from file name */
-			struct File * f = malloc(sizeof(struct File));
-			sprintf(f->name, "%s", ent->d_name); /* snprintf? copy min()? */
-
-			struct stat statbuf;
-			struct stat statbufl;
-
-			/* Calculate absolute path to file */
-			char tmp[strlen(path)+strlen(ent->d_name)+2];
-			sprintf(tmp, "%s/%s", path, ent->d_name);
-			lstat(tmp, &statbuf);
-
-			f->size = statbuf.st_size;
-
-			/* Read link target for symlinks */
-			if (S_ISLNK(statbuf.st_mode)) {
-				memcpy(&statbufl, &statbuf, sizeof(struct stat));
-				stat(tmp, &statbuf);
-				readlink(tmp, f->link, 256);
-			} else {
-				f->link[0] = '\0';
-			}
-
-			f->launcher[0] = '\0';
-			f->filetype[0] = '\0';
-			f->selected = 0;
-
-			if (S_ISDIR(statbuf.st_mode)) {
-				/* Is this /cdrom? */
-				if (!strcmp(tmp,"//cdrom")) {
-					sprintf(f->icon, "cd");
-				} else {
-					sprintf(f->icon, "folder");
-				}
-				sprintf(f->filetype, "Directory");
-				f->type = 1;
-			} else {
-				/* Regular file */
-
-				/* Default regular files to open in bim */
-				sprintf(f->launcher, "exec terminal bim");
-
-				if (is_desktop_background && has_extension(f, ".launcher")) {
-					/* In desktop mode, read launchers specially */
-					FILE * file = fopen(tmp,"r");
-					char tbuf[1024];
-					while (!feof(file)) {
-						fgets(tbuf, 1024, file);
-						char * nl = strchr(tbuf,'\n');
-						if (nl) *nl = '\0';
-						char * eq = strchr(tbuf,'=');
-						if (!eq) continue;
-						*eq = '\0'; eq++;
-
-						if (!strcmp(tbuf, "icon")) {
-							sprintf(f->icon, "%s", eq);
-						} else if (!strcmp(tbuf, "run")) {
-							sprintf(f->launcher, "%s #", eq);
-						} else if (!strcmp(tbuf, "title")) {
-							sprintf(f->name, eq);
-						}
-					}
-					sprintf(f->filetype, "Launcher");
-					sprintf(f->filename, "%s", ent->d_name);
-					f->type = 2;
-				} else {
-					/* Handle various file types */
-					if (has_extension(f, ".c")) {
-						sprintf(f->icon, "c");
-						sprintf(f->filetype, "C Source");
-					} else if (has_extension(f, ".h")) {
-						sprintf(f->icon, "h");
-						sprintf(f->filetype, "C Header");
-					} else if (has_extension(f, ".bmp")) {
-						sprintf(f->icon, "image");
-						sprintf(f->launcher, "exec imgviewer");
-						sprintf(f->filetype, "Bitmap Image");
-					} else if (has_extension(f, ".tga")) {
-						sprintf(f->icon, "image");
-						sprintf(f->launcher, "exec imgviewer");
-						sprintf(f->filetype, "Targa Image");
-					} else if (has_extension(f, ".jpg") || has_extension(f,".jpeg")) {
-						sprintf(f->icon, "image");
-						sprintf(f->launcher, "exec imgviewer");
-						sprintf(f->filetype, "JPEG Image");
-					} else if (has_extension(f, ".png")) {
-						sprintf(f->icon, "image");
-						sprintf(f->launcher, "exec imgviewer");
-						sprintf(f->filetype, "Portable Network Graphics Image");
-					} else if (has_extension(f, ".sdf")) {
-						sprintf(f->icon, "font");
-						sprintf(f->filetype, "Legacy SDF Font");
-					} else if (has_extension(f, ".ttf")) {
-						sprintf(f->icon, "font");
-						sprintf(f->launcher,"exec font-preview");
-						sprintf(f->filetype, "TrueType Font");
-					} else if (has_extension(f, ".pdf")) {
-						sprintf(f->icon, "pdf");
-						sprintf(f->launcher,"exec maybe-pdfviewer.krk");
-						sprintf(f->filetype, "Portable Document Format");
-					} else if (has_extension(f, ".tgz") || has_extension(f, ".tar.gz")) {
-						sprintf(f->icon, "package_targz");
-						sprintf(f->filetype, "Compressed Archive File");
-						/* TODO: Archive viewer */
-					} else if (has_extension(f, ".tar")) {
-						sprintf(f->icon, "package_tar");
-						sprintf(f->filetype, "Archive File");
-					} else if (has_extension(f, ".a")) {
-						sprintf(f->icon, "package_a");
-						sprintf(f->filetype, "Archive File");
-					} else if (has_extension(f, ".zip")) {
-						sprintf(f->icon, "package_zip");
-						sprintf(f->filetype, "ZIP Archive File");
-					} else if (has_extension(f, ".sh")) {
-						sprintf(f->icon, "sh");
-						if (statbuf.st_mode & 0111) {
-							/* Make executable */
-							sprintf(f->launcher, "SELF");
-							sprintf(f->filetype, "Executable Shell Script");
-						} else {
-							sprintf(f->filetype, "Shell Script");
-						}
-					} else if (has_extension(f, ".krk")) {
-						sprintf(f->icon, "krk");
-						if (statbuf.st_mode & 0111) {
-							/* Make executable */
-							sprintf(f->launcher, "SELF");
-							sprintf(f->filetype, "Executable Kuroko Script");
-						} else {
-							sprintf(f->filetype, "Kuroko Script");
-						}
-					} else if (has_extension(f, ".py")) {
-						sprintf(f->icon, "py");
-						if (statbuf.st_mode & 0111) {
-							/* Make executable */
-							sprintf(f->launcher, "SELF");
-							sprintf(f->filetype, "Executable Python Script");
-						} else {
-							sprintf(f->filetype, "Python Script");
-						}
-					} else if (has_extension(f, ".ko")) {
-						sprintf(f->icon, "so");
-						sprintf(f->filetype, "Kernel Module");
-					} else if (has_extension(f, ".o")) {
-						sprintf(f->icon, "so");
-						sprintf(f->filetype, "Object File");
-					} else if (has_extension(f, ".so")) {
-						sprintf(f->icon, "so");
-						sprintf(f->filetype, "Shared Object File");
-					} else if (has_extension(f, ".S")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Assembly Source");
-					} else if (has_extension(f, ".ld")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Linker Script");
-					} else if (has_extension(f, ".md")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Markdown Text Document");
-					} else if (has_extension(f, ".eshrc")) {
-						sprintf(f->icon, "sh");
-						sprintf(f->filetype, "Shell Configuration");
-					} else if (has_extension(f, ".bim3rc")) {
-						sprintf(f->icon, "krk");
-						sprintf(f->filetype, "Bim Configuration");
-					} else if (has_extension(f, ".biminfo")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Bim Status Cache");
-					} else if (has_extension(f, ".conf")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Configuration File");
-					} else if (has_extension(f, ".launcher")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Application Launcher");
-					} else if (has_extension(f, ".trt")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "Toaru Rich Text Document");
-						sprintf(f->launcher, "exec help-browser");
-					} else if (has_extension(f, ".json")) {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "JavaScript Object Notation File");
-					} else if (statbuf.st_mode & 0111) {
-						/* Executable files - use their name for their icon, and launch themselves. */
-						sprintf(f->icon, "%s", f->name);
-						sprintf(f->launcher, "SELF");
-						sprintf(f->filetype, "Executable");
-					} else {
-						sprintf(f->icon, "file");
-						sprintf(f->filetype, "File");
-					}
-					f->type = 0;
-				}
-			}
-
-			list_insert(file_list, f);
-		}
-		ent = readdir(dirp);
-	}
-	closedir(dirp);
-
-	/* Store the entries in a flat array. */
-	file_pointers = malloc(sizeof(struct File *) * file_list->length);
-	file_pointers_len = file_list->length;
-	int i = 0;
-	foreach (node, file_list) {
-		file_pointers[i] = node->value;
-		i++;
-	}
-
-	update_status();
-
-	/* Free our temporary linked list */
-	list_free(file_list);
-	free(file_list);
-
-	/* Sort files */
-	int comparator(const void * c1, const void * c2) {
-		const struct File * f1 = *(const struct File **)(c1);
-		const struct File * f2 = *(const struct File **)(c2);
-		/* Launchers before directories before files */
-		if (f1->type > f2->type) return -1;
-		if (f2->type > f1->type) return 1;
-		/* Launchers sorted by filename, not by display name */
-		if (f1->type == 2 && f2->type == 2) {
-			return strcmp(f1->filename, f2->filename);
-		}
-		/* Files sorted by name */
-		return strcmp(f1->name, f2->name);
+	/* If this directory hasn't changed since we last cached it, skip the scan. */
+	if (load_directory_from_cache(current_directory)) {
+		closedir(dirp);
+		scroll_offset = 0;
+		return;
 	}
-	qsort(file_pointers, file_pointers_len, sizeof(struct File *), comparator);
 
-	/* Reset scroll offset when navigating */
+	/* Otherwise scan it incrementally: read the first batch now, so small
+	 * directories show up just as they always have, and leave the stream
+	 * open for the main loop to pump between events. */
+	pending_directory = dirp;
 	scroll_offset = 0;
+	load_directory_pump();
 }
 
 /**
@@ -1392,6 +1553,9 @@ static void _menu_action_up(struct MenuEntry * entry) {
 /* [Context] > Refresh */
 static void _menu_action_refresh(struct MenuEntry * entry) {
 	char * tmp = strdup(current_directory);
+	/* Force a real rescan, even if the directory mtime hasn't changed. */
+	char * cpath = cache_file_for(tmp);
+	if (cpath) unlink(cpath);
 	load_directory(tmp, 0);
 	reinitialize_contents();
 	redraw_window();
@@ -2022,12 +2186,17 @@ int main(int argc, char * argv[]) {
 	while (application_running) {
 		waitpid(-1, NULL, WNOHANG);
 		int fds[1] = {fileno(yctx->sock)};
-		int index = fswait2(1,fds,wallpaper_old ? 10 : 200);
+		int index = fswait2(1,fds,(wallpaper_old || pending_directory) ? 10 : 200);
 
 		maybe_blink_cursor();
 
 		if (index == 1) {
-			if (wallpaper_old) {
+			if (pending_directory) {
+				/* Pull in the next batch from the ongoing scan. */
+				load_directory_pump();
+				reinitialize_contents();
+				redraw_window();
+			} else if (wallpaper_old) {
 				redraw_window();
 			}
 			continue;
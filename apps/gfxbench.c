@@ -0,0 +1,194 @@
+/**
+ * @brief gfxbench - Benchmark harness for libtoaru_graphics primitives
+ *
+ * Times the hot loops of lib/graphics.c - draw_sprite in its alpha
+ * variants, draw_sprite_transform, blur_context_box, flip, and text
+ * rendering - against offscreen sprite contexts, across a spread of
+ * sizes and alpha modes. Output is one tab-separated line per case:
+ *
+ *    primitive<TAB>case<TAB>size<TAB>rate
+ *
+ * where rate is megapixels per second for pixel primitives and glyphs
+ * per second for text, so runs can be diffed or graphed across
+ * changes to the library.
+ * Nothing touches the framebuffer; this runs headless.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <toaru/graphics.h>
+#include <toaru/text.h>
+
+#define TARGET_SECONDS 0.25 /* Per case; calibrated by doubling. */
+
+static const int sizes[] = {64, 256, 512, 0};
+
+static double now(void) {
+	struct timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void report(const char * primitive, const char * variant, int size, double pixels, double elapsed) {
+	printf("%s\t%s\t%d\t%.2f\n", primitive, variant, size, pixels / elapsed / 1000000.0);
+	fflush(stdout);
+}
+
+/**
+ * @brief Time one case: run it with doubling iteration counts until it
+ * takes long enough to trust the clock, then report the final run.
+ */
+static void time_case(const char * primitive, const char * variant, int size,
+		void (*func)(gfx_context_t *, sprite_t *, int), gfx_context_t * ctx, sprite_t * src) {
+	int iters = 1;
+	while (1) {
+		double start = now();
+		for (int i = 0; i < iters; ++i) func(ctx, src, i);
+		double elapsed = now() - start;
+		if (elapsed >= TARGET_SECONDS || iters >= (1 << 20)) {
+			report(primitive, variant, size, (double)iters * size * size, elapsed);
+			return;
+		}
+		iters *= 2;
+	}
+}
+
+static void case_blit(gfx_context_t * ctx, sprite_t * src, int i) {
+	draw_sprite(ctx, src, 0, 0);
+}
+
+static void case_blit_alpha(gfx_context_t * ctx, sprite_t * src, int i) {
+	draw_sprite_alpha(ctx, src, 0, 0, 0.7);
+}
+
+static void case_scaled(gfx_context_t * ctx, sprite_t * src, int i) {
+	draw_sprite_scaled(ctx, src, 0, 0, src->width * 3 / 4, src->height * 3 / 4);
+}
+
+static void case_transform(gfx_context_t * ctx, sprite_t * src, int i) {
+	gfx_matrix_t m;
+	gfx_matrix_identity(m);
+	gfx_matrix_translate(m, src->width / 2, src->height / 2);
+	gfx_matrix_rotate(m, 0.3);
+	gfx_matrix_translate(m, -src->width / 2, -src->height / 2);
+	draw_sprite_transform(ctx, src, m, 1.0);
+}
+
+static void case_blur(gfx_context_t * ctx, sprite_t * src, int i) {
+	blur_context_box(ctx, 8);
+}
+
+static void case_fill(gfx_context_t * ctx, sprite_t * src, int i) {
+	draw_fill(ctx, rgba(i & 0xFF, 120, 200, 255));
+}
+
+static void case_flip(gfx_context_t * ctx, sprite_t * src, int i) {
+	/* Touch one pixel so the damage region isn't empty. */
+	GFX(ctx, i % ctx->width, 0) = 0xFFFFFFFF;
+	flip(ctx);
+}
+
+static struct prim {
+	const char * name;
+	void (*func)(gfx_context_t *, sprite_t *, int);
+	int needs_alpha_modes; /* Repeat with opaque, mask, embedded sources */
+} prims[] = {
+	{"blit",      case_blit,      1},
+	{"blit-a0.7", case_blit_alpha, 1},
+	{"scaled",    case_scaled,    1},
+	{"transform", case_transform, 1},
+	{"blur",      case_blur,      0},
+	{"fill",      case_fill,      0},
+	{"flip",      case_flip,      0},
+	{NULL, NULL, 0},
+};
+
+static const struct { const char * name; int mode; } alpha_modes[] = {
+	{"opaque",   ALPHA_OPAQUE},
+	{"mask",     ALPHA_MASK},
+	{"embedded", ALPHA_EMBEDDED},
+	{NULL, 0},
+};
+
+static sprite_t * make_source(int size, int alpha) {
+	sprite_t * src = create_sprite(size, size, alpha);
+	gfx_context_t * sctx = init_graphics_sprite(src);
+	/* Not a flat fill; give the alpha paths varied pixels to chew on. */
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			GFX(sctx, x, y) = rgba(x & 0xFF, y & 0xFF, (x ^ y) & 0xFF, 128 + ((x + y) & 0x7F));
+		}
+	}
+	free(sctx);
+	return src;
+}
+
+static void bench_text(void) {
+	struct TT_Font * font = tt_font_from_file("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
+	if (!font) {
+		fprintf(stderr, "gfxbench: no font, skipping text\n");
+		return;
+	}
+	const char * line = "The quick brown fox jumps over the lazy dog, 0123456789.";
+
+	for (const int * fsize = (const int[]){13, 24, 48, 0}; *fsize; ++fsize) {
+		sprite_t * dest = create_sprite(512, 64, ALPHA_OPAQUE);
+		gfx_context_t * ctx = init_graphics_sprite(dest);
+		draw_fill(ctx, rgba(255, 255, 255, 255));
+		tt_set_size(font, *fsize);
+
+		int iters = 1;
+		while (1) {
+			double start = now();
+			for (int i = 0; i < iters; ++i) {
+				tt_draw_string(ctx, font, 2, *fsize + 2, line, rgba(0, 0, 0, 255));
+			}
+			double elapsed = now() - start;
+			if (elapsed >= TARGET_SECONDS || iters >= (1 << 20)) {
+				printf("text\tsize-%d\t%zu\t%.0f\n", *fsize, strlen(line),
+					(double)iters * strlen(line) / elapsed);
+				fflush(stdout);
+				break;
+			}
+			iters *= 2;
+		}
+
+		free(ctx);
+		sprite_free(dest);
+	}
+}
+
+int main(int argc, char * argv[]) {
+	printf("primitive\tcase\tsize\trate\n");
+
+	for (struct prim * p = prims; p->name; ++p) {
+		for (const int * size = sizes; *size; ++size) {
+			sprite_t * dest = create_sprite(*size, *size, ALPHA_OPAQUE);
+			gfx_context_t * ctx = init_graphics_sprite(dest);
+			draw_fill(ctx, rgba(40, 40, 40, 255));
+
+			if (p->needs_alpha_modes) {
+				for (int m = 0; alpha_modes[m].name; ++m) {
+					sprite_t * src = make_source(*size, alpha_modes[m].mode);
+					time_case(p->name, alpha_modes[m].name, *size, p->func, ctx, src);
+					sprite_free(src);
+				}
+			} else {
+				time_case(p->name, "-", *size, p->func, ctx, NULL);
+			}
+
+			free(ctx);
+			sprite_free(dest);
+		}
+	}
+
+	bench_text();
+	return 0;
+}
@@ -20,204 +20,33 @@
 #include <toaru/graphics.h>
 #include <toaru/decorations.h>
 #include <toaru/menu.h>
-#include <toaru/text.h>
-#include <toaru/markup.h>
+#include <toaru/markup_text.h>
 
 #define APPLICATION_TITLE "Help Browser"
 #define HELP_DIR "/usr/share/help"
 
+#define BASE_X 2
+#define BASE_Y 2
+
 static yutani_t * yctx;
 static yutani_window_t * main_window;
 static gfx_context_t * ctx;
 
 static int application_running = 1;
 
-static gfx_context_t * contents = NULL;
-static sprite_t * contents_sprite = NULL;
+/* The current document, parsed and measured once per navigation;
+ * resizes reflow the cached runs and scrolling just re-renders the
+ * visible line range. */
+static struct MarkupLayout * layout = NULL;
 static int contents_width = 0;
 
 static char * current_topic = NULL;
 static int scroll_offset;
 
-/* Markup Renderer { */
-#define BASE_X 2
-#define BASE_Y 2
-#define LINE_HEIGHT 20
-#define HEAD_HEIGHT 28
-
-static int cursor_y = 0;
-static int cursor_x = 0;
-static list_t * state = NULL;
-static int current_state = 0;
-
-static struct TT_Font * tt_font_thin = NULL;
-static struct TT_Font * tt_font_bold = NULL;
-static struct TT_Font * tt_font_oblique = NULL;
-static struct TT_Font * tt_font_bold_oblique = NULL;
-static struct TT_Font * tt_font_mono = NULL;
-
-struct Char {
-	char c; /* TODO: unicode */
-	char state;
-};
-
-//static list_t * lines = NULL;
-static list_t * buffer = NULL;
-
-static struct TT_Font * state_to_font(int current_state) {
-	if (current_state & (1 << 3)) {
-		return tt_font_mono;
-	}
-	if (current_state & (1 << 0 | 1 << 2) ) {
-		if (current_state & (1 << 1)) {
-			return tt_font_bold_oblique;
-		}
-		return tt_font_bold;
-	} else if (current_state & (1 << 1)) {
-		return tt_font_oblique;
-	}
-	return tt_font_thin;
-}
-
-static int current_size(void) {
-	if (current_state & (1 << 2)) {
-		return 22;
-	}
-	return 13;
-}
-
-static int buffer_width(list_t * buffer) {
-	int out = 0;
-	foreach(node, buffer) {
-		struct Char * c = node->value;
-
-		char tmp[2] = {c->c, '\0'};
-
-		tt_set_size(state_to_font(c->state), current_size());
-		out += tt_string_width(state_to_font(c->state), tmp);
-	}
-	return out;
-}
-
-static int draw_buffer(list_t * buffer) {
-	int x = 0;
-	while (buffer->length) {
-		node_t * node = list_dequeue(buffer);
-		struct Char * c = node->value;
-		char tmp[2] = { c->c, '\0' };
-		tt_set_size(state_to_font(c->state), current_size());
-		if (contents) {
-			x += tt_draw_string(contents, state_to_font(c->state), cursor_x + x, cursor_y + current_size(), tmp, 0xFF000000);
-		} else {
-			x += tt_string_width(state_to_font(c->state), tmp);
-		}
-		free(c);
-		free(node);
-	}
-	x += 4;
-	return x;
-}
-
-static int current_line_height(void) {
-	if (current_state & (1 << 2)) {
-		return HEAD_HEIGHT;
-	} else {
-		return LINE_HEIGHT;
-	}
-}
-
-static void write_buffer(void) {
-	if (buffer_width(buffer) + cursor_x > contents_width) {
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-	}
-	cursor_x += draw_buffer(buffer);
-}
-
-static int parser_open(struct markup_state * self, void * user, struct markup_tag * tag) {
-	if (!strcmp(tag->name, "b")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 0);
-	} else if (!strcmp(tag->name, "i")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 1);
-	} else if (!strcmp(tag->name, "h1")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 2);
-	} else if (!strcmp(tag->name, "mono")) {
-		list_insert(state, (void*)(uintptr_t)current_state);
-		current_state |= (1 << 3);
-	} else if (!strcmp(tag->name, "br")) {
-		write_buffer();
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-	}
-	markup_free_tag(tag);
-	return 0;
+static int contents_height(void) {
+	return layout ? markup_layout_height(layout) + 2 * BASE_Y : 0;
 }
 
-static int parser_close(struct markup_state * self, void * user, char * tag_name) {
-	if (!strcmp(tag_name, "b")) {
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	} else if (!strcmp(tag_name, "i")) {
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	} else if (!strcmp(tag_name, "mono")) {
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	} else if (!strcmp(tag_name, "h1")) {
-		write_buffer();
-		cursor_x = BASE_X;
-		cursor_y += current_line_height();
-		node_t * nstate = list_pop(state);
-		current_state = (int)(uintptr_t)nstate->value;
-		free(nstate);
-	}
-	return 0;
-}
-
-static int parser_data(struct markup_state * self, void * user, char * data) {
-	char * c = data;
-	while (*c) {
-		if (*c == ' ' && !(current_state & (1 << 3))) {
-			if (buffer->length) {
-				write_buffer();
-			}
-		} else if (*c == '\n') {
-			if (buffer->length) {
-				write_buffer();
-			}
-			if (current_state & (1 << 3)) {
-				cursor_x = BASE_X;
-				cursor_y += current_line_height();
-			}
-		} else {
-			int chr = *c;
-			if (*c == '&') {
-				if (c[1] == 'l' && c[2] == 't' && c[3] == ';') {
-					c += 3;
-					chr = '<';
-				} else if (c[1] == 'g' && c[2] == 't' && c[3] == ';') {
-					c += 3;
-					chr = '>';
-				}
-			}
-			struct Char * ch = malloc(sizeof(struct Char));
-			ch->c = chr;
-			ch->state = current_state;
-			list_insert(buffer, ch);
-		}
-		c++;
-	}
-	return 0;
-}
-
-/* } End Markup Renderer */
-
 static struct menu_bar menu_bar = {0};
 static struct menu_bar_entries menu_entries[] = {
 	{"File", "file"},
@@ -231,66 +60,19 @@ static void _menu_action_exit(struct MenuEntry * entry) {
 }
 
 static void reinitialize_contents(void) {
-	if (contents) {
-		free(contents);
-	}
-
-	if (contents_sprite) {
-		sprite_free(contents_sprite);
-	}
-
 	struct decor_bounds bounds;
 	decor_get_bounds(main_window, &bounds);
-	contents = NULL;
 	contents_width = main_window->width - bounds.width;
 
-	{
-		struct markup_state * parser = markup_init(NULL, parser_open, parser_close, parser_data);
-		cursor_y = BASE_Y;
-		cursor_x = BASE_X;
-		state = list_create();
-		buffer = list_create();
-
-		char * str = current_topic;
-		while (*str) {
-			if (markup_parse(parser, *str++)) {
-				fprintf(stderr,"There was an error.\n");
-				return;
-			}
-		}
+	markup_layout_reflow(layout, contents_width - 2 * BASE_X);
 
-		markup_finish(parser);
-		write_buffer();
-		list_free(state);
-		free(state);
-		free(buffer);
+	/* Keep the scroll position in range if the document got shorter */
+	int available_height = main_window->height - bounds.height - MENU_BAR_HEIGHT;
+	if (scroll_offset > contents_height() - available_height) {
+		scroll_offset = contents_height() - available_height;
 	}
-
-	contents_sprite = create_sprite(contents_width, cursor_y + current_size() + 20, ALPHA_EMBEDDED);
-	contents = init_graphics_sprite(contents_sprite);
-
-	draw_fill(contents, rgb(255,255,255));
-
-	{
-		struct markup_state * parser = markup_init(NULL, parser_open, parser_close, parser_data);
-		cursor_y = BASE_Y;
-		cursor_x = BASE_X;
-		state = list_create();
-		buffer = list_create();
-
-		char * str = current_topic;
-		while (*str) {
-			if (markup_parse(parser, *str++)) {
-				fprintf(stderr,"There was an error.\n");
-				return;
-			}
-		}
-
-		markup_finish(parser);
-		write_buffer();
-		list_free(state);
-		free(state);
-		free(buffer);
+	if (scroll_offset < 0) {
+		scroll_offset = 0;
 	}
 }
 
@@ -308,9 +90,15 @@ static void redraw_window(void) {
 	menu_bar.window = main_window;
 	menu_bar_render(&menu_bar, ctx);
 
+	int content_top = bounds.top_height + MENU_BAR_HEIGHT;
+	int available_height = ctx->height - content_top - bounds.height;
+
 	gfx_clear_clip(ctx);
-	gfx_add_clip(ctx, bounds.left_width, bounds.top_height + MENU_BAR_HEIGHT, ctx->width - bounds.width, ctx->height - MENU_BAR_HEIGHT - bounds.height);
-	draw_sprite(ctx, contents_sprite, bounds.left_width, bounds.top_height + MENU_BAR_HEIGHT - scroll_offset);
+	gfx_add_clip(ctx, bounds.left_width, content_top, ctx->width - bounds.width, available_height);
+	markup_layout_render(ctx, layout,
+		bounds.left_width + BASE_X, content_top + BASE_Y - scroll_offset,
+		scroll_offset - BASE_Y, scroll_offset - BASE_Y + available_height,
+		rgb(0,0,0));
 	gfx_clear_clip(ctx);
 	gfx_add_clip(ctx, 0, 0, ctx->width, ctx->height);
 
@@ -319,14 +107,11 @@ static void redraw_window(void) {
 }
 
 static void resize_finish(int w, int h) {
-	int height_changed = (main_window->width != (unsigned int)w);
-
 	yutani_window_resize_accept(yctx, main_window, w, h);
 	reinit_graphics_yutani(ctx, main_window);
 
-	if (height_changed) {
-		reinitialize_contents();
-	}
+	/* Reflow is a no-op if the width didn't change */
+	reinitialize_contents();
 
 	redraw_window();
 	yutani_window_resize_done(yctx, main_window);
@@ -418,6 +203,10 @@ static void navigate(const char * t) {
 		}
 	}
 
+	if (layout) markup_layout_free(layout);
+	layout = markup_layout_create(current_topic);
+	scroll_offset = 0;
+
 	reinitialize_contents();
 	redraw_window();
 
@@ -436,12 +225,12 @@ static void _scroll_down(void) {
 	decor_get_bounds(main_window, &bounds);
 	int available_height = main_window->height - bounds.height - MENU_BAR_HEIGHT;
 
-	if (available_height > contents->height) {
+	if (available_height > contents_height()) {
 		scroll_offset = 0;
 	} else {
 		scroll_offset += SCROLL_AMOUNT;
-		if (scroll_offset > contents->height - available_height) {
-			scroll_offset = contents->height - available_height;
+		if (scroll_offset > contents_height() - available_height) {
+			scroll_offset = contents_height() - available_height;
 		}
 	}
 }
@@ -487,11 +276,7 @@ int main(int argc, char * argv[]) {
 	yutani_window_move(yctx, main_window, yctx->display_width / 2 - main_window->width / 2, yctx->display_height / 2 - main_window->height / 2);
 	ctx = init_graphics_yutani_double_buffer(main_window);
 
-	tt_font_thin         = tt_font_from_shm("sans-serif");
-	tt_font_bold         = tt_font_from_shm("sans-serif.bold");
-	tt_font_oblique      = tt_font_from_shm("sans-serif.italic");
-	tt_font_bold_oblique = tt_font_from_shm("sans-serif.bolditalic");
-	tt_font_mono         = tt_font_from_shm("monospace");
+	markup_text_init();
 
 	yutani_window_advertise_icon(yctx, main_window, APPLICATION_TITLE, "help");
 
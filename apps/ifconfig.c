@@ -121,13 +121,14 @@ static int configure_interface(const char * if_name) {
 	if (!ioctl(netdev, SIOCGIFCOUNTS, &counts)) {
 		char _buf[100];
 		print_human_readable_size(_buf, counts.rx_bytes);
-		fprintf(stdout,"        RX packets %zu  bytes %zu (%s)\n", counts.rx_count, counts.rx_bytes, _buf);
+		fprintf(stdout,"        RX packets %zu  bytes %zu (%s)  dropped %zu\n", counts.rx_count, counts.rx_bytes, _buf, counts.rx_dropped);
 		print_human_readable_size(_buf, counts.tx_bytes);
-		fprintf(stdout,"        TX packets %zu  bytes %zu (%s)\n", counts.tx_count, counts.tx_bytes, _buf);
+		fprintf(stdout,"        TX packets %zu  bytes %zu (%s)  dropped %zu\n", counts.tx_count, counts.tx_bytes, _buf, counts.tx_dropped);
+		if (counts.tx_ring_size) {
+			fprintf(stdout,"        TX ring %zu/%zu descriptors in flight\n", counts.tx_ring_used, counts.tx_ring_size);
+		}
 	}
 
-	/* TODO stats */
-
 	fprintf(stdout,"\n");
 
 	return 0;
@@ -26,6 +26,8 @@
 #include <toaru/graphics.h>
 #include <toaru/decorations.h>
 #include <toaru/menu.h>
+#include <toaru/png.h>
+#include <toaru/jpeg.h>
 
 /* Pointer to graphics memory */
 static yutani_t * yctx;
@@ -71,7 +73,7 @@ static void decors() {
 	}
 }
 
-void redraw() {
+static void draw_background(void) {
 	uint32_t dark  = rgb(107,107,107);
 	uint32_t light = rgb(147,147,147);
 	uint32_t black = rgb(0,0,0);
@@ -91,6 +93,16 @@ void redraw() {
 			GFX(ctx,x+decor_left_width,y+decor_top_height) = color;
 		}
 	}
+}
+
+void redraw() {
+	int calc_width = img.width * (current_scale / 100.0);
+	int calc_height = img.height * (current_scale / 100.0);
+
+	int image_left  = width / 2 - calc_width / 2;
+	int image_top   = height / 2 - calc_height / 2;
+
+	draw_background();
 
 	if (current_scale != 100) {
 		draw_sprite_scaled(ctx, &img, decor_left_width + image_left, decor_top_height + image_top, calc_width, calc_height);
@@ -130,6 +142,59 @@ static int one_fifth(int scale) {
 	return 1;
 }
 
+/**
+ * Create the viewer window sized to the (possibly still decoding)
+ * image; a no-op once it exists.
+ */
+static void create_window(void) {
+	if (window) return;
+
+	width  = img.width  < 300 ? 300 : img.width;
+	height = img.height < 300 ? 300 : img.height;
+
+	window = yutani_window_create(yctx, width + decor_width, height + decor_height);
+	yutani_window_move(yctx, window, left, top);
+	yutani_window_advertise_icon(yctx, window, window_title, "image");
+	ctx = init_graphics_yutani_double_buffer(window);
+}
+
+static int rows_flushed = 0;
+
+/**
+ * Paint scanlines as the PNG decoder hands them over, so something is
+ * on screen long before a large image finishes decoding. Rows arrive
+ * premultiplied and final; they get blitted into place at 100% and
+ * flushed to the compositor in bands.
+ */
+static void png_row_ready(sprite_t * sprite, int row, void * extra) {
+	if (!window) {
+		/* Dimensions are known before the first row */
+		create_window();
+		draw_background();
+		decors();
+		flip(ctx);
+		yutani_flip(yctx, window);
+		rows_flushed = 0;
+	}
+
+	int image_left = width / 2 - sprite->width / 2;
+	int image_top  = height / 2 - sprite->height / 2;
+
+	sprite_t strip = *sprite;
+	strip.height = 1;
+	strip.bitmap = &SPRITE(sprite, 0, row);
+	draw_sprite(ctx, &strip, decor_left_width + image_left, decor_top_height + image_top + row);
+
+	if (row - rows_flushed >= 32 || row == sprite->height - 1) {
+		flip(ctx);
+		yutani_flip_region(yctx, window,
+			decor_left_width + image_left,
+			decor_top_height + image_top + rows_flushed,
+			sprite->width, row - rows_flushed + 1);
+		rows_flushed = row + 1;
+	}
+}
+
 int main(int argc, char * argv[]) {
 
 	static struct option long_opts[] = {
@@ -179,23 +244,25 @@ int main(int argc, char * argv[]) {
 	decor_width = bounds.width;
 	decor_height = bounds.height;
 
-	int status = load_sprite(&img, argv[optind]);
+	snprintf(window_title, 1023, "%s - " APPLICATION_TITLE, basename(argv[1]));
+
+	char * ext = strrchr(argv[optind], '.');
+	int status;
+	if (ext && (!strcmp(ext, ".jpg") || !strcmp(ext, ".jpeg"))) {
+		/* Downscale in the decoder: never produce more pixels than the display can show */
+		status = load_sprite_jpg_fit(&img, argv[optind], yctx->display_width, yctx->display_height);
+	} else if (ext && !strcmp(ext, ".png")) {
+		/* Show rows as they decode */
+		status = load_sprite_png_stream(&img, argv[optind], png_row_ready, NULL);
+	} else {
+		status = load_sprite(&img, argv[optind]);
+	}
 	if (status) {
 		fprintf(stderr, "%s: failed to open image %s\n", argv[0], argv[optind]);
 		return 1;
 	}
 
-	width  = img.width  < 300 ? 300 : img.width;
-	height = img.height < 300 ? 300 : img.height;
-
-	window = yutani_window_create(yctx, width + decor_width, height + decor_height);
-	yutani_window_move(yctx, window, left, top);
-
-	snprintf(window_title, 1023, "%s - " APPLICATION_TITLE, basename(argv[1]));
-
-	yutani_window_advertise_icon(yctx, window, window_title, "image");
-
-	ctx = init_graphics_yutani_double_buffer(window);
+	create_window();
 
 	redraw();
 	yutani_flip(yctx, window);
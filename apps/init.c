@@ -8,20 +8,33 @@
  * is worthwhile as it reduces to the total size of init itself, which
  * remains in memory throughout the entire lifetime of the OS.
  *
- * Startup scripts for init are stored in /etc/startup.d and are run
- * in sorted alphabetical order. It is generally recommended that these
- * startup scripts be named with numbers at the front to ensure easy
- * ordering. This system of running a set of scripts on startup is
- * somewhat similar to how sysvinit worked, but no claims of
- * compatibility are made.
+ * Startup scripts for init are stored in /etc/startup.d. Each script
+ * is a unit; scripts can declare how they relate to each other with
+ * comment directives near the top of the file:
+ *
+ *    #:provides NAME    Name other units can depend on. Defaults to
+ *                       the file name with its number prefix and .sh
+ *                       suffix stripped (40_dhcp.sh provides "dhcp").
+ *    #:needs A B ...    Run only after the named units are ready.
+ *                       May be given with no names to declare a unit
+ *                       has no dependencies at all.
+ *    #:notify           The unit is ready when it writes a byte to
+ *                       the pipe named by READY_FD in its environment,
+ *                       rather than when its initial process exits.
+ *
+ * A script with no `#:needs` directive implicitly depends on the
+ * script before it in sorted alphabetical order, which preserves the
+ * old strictly-sequential behavior for unannotated scripts. Units
+ * whose dependencies are all ready are launched concurrently, so
+ * slow, independent services (network setup, the compositor) no
+ * longer serialize the boot.
  *
  * Startup scripts can be any executable binary. Shell scripts are
  * generally used to allow easy editing, but you could also use
  * a binary (even a dynamically linked one) as a startup script.
- * `init` will wait for each startup script (that is, it will wait for
- * the original process it started to exit) before running the next one.
- * So if you wish to run daemons, be sure to fork them off and then
- * exit so that the rest of the startup process can continue.
+ * If you wish to run daemons, be sure to fork them off and then
+ * exit (or use `#:notify`) so that the rest of the startup process
+ * can continue.
  *
  * When the last startup script finishes, `init` will reboot the system.
  *
@@ -43,6 +56,25 @@
 
 #define INITD_PATH "/etc/startup.d"
 
+#define MAX_UNITS 64
+#define MAX_DEPS  8
+#define NAME_LEN  64
+
+struct unit {
+	char name[NAME_LEN];
+	char path[256];
+	char deps[MAX_DEPS][NAME_LEN];
+	int  dep_count;
+	int  notify;    /* Readiness comes from a byte on READY_FD */
+	int  started;
+	int  ready;
+	int  pid;
+	int  ready_fd;  /* Read end of the notification pipe, or -1 */
+};
+
+static struct unit units[MAX_UNITS];
+static int unit_count = 0;
+
 /* Initialize fd 0, 1, 2 */
 void set_console(void) {
 	syscall_open("/dev/null", 0, 0);
@@ -50,43 +82,201 @@ void set_console(void) {
 	syscall_open("/dev/null", 1, 0);
 }
 
-/* Run a startup script and wait for it to finish */
-int start_options(char * args[]) {
+/* Derive a unit name from a script name: 40_dhcp.sh -> dhcp */
+static void default_name(const char * file, char * out) {
+	while (*file >= '0' && *file <= '9') file++;
+	if (*file == '_') file++;
+	if (!*file) file = "unit"; /* Name was all digits, somehow */
+	size_t len = strlen(file);
+	if (len > 3 && !strcmp(file + len - 3, ".sh")) len -= 3;
+	if (len >= NAME_LEN) len = NAME_LEN - 1;
+	memcpy(out, file, len);
+	out[len] = '\0';
+}
+
+/* Copy the next whitespace-delimited token out of a directive line */
+static const char * next_token(const char * s, char * out) {
+	while (*s == ' ' || *s == '\t') s++;
+	if (!*s || *s == '\n') return NULL;
+	int i = 0;
+	while (*s && *s != ' ' && *s != '\t' && *s != '\n' && i < NAME_LEN - 1) {
+		out[i++] = *s++;
+	}
+	out[i] = '\0';
+	return s;
+}
+
+/*
+ * Scan the head of a startup script for #: directives. Returns
+ * whether a #:needs directive was seen, so the caller can fall
+ * back to the implicit sequential dependency.
+ */
+static int parse_directives(struct unit * unit) {
+	char buf[1025];
+	int fd = syscall_open(unit->path, 0, 0);
+	if (fd < 0) return 0;
+	long r = syscall_read(fd, buf, 1024);
+	syscall_close(fd);
+	if (r <= 0) return 0;
+	buf[r] = '\0';
+
+	int has_needs = 0;
+	char * line = buf;
+	while (line) {
+		char * next = strchr(line, '\n');
+		if (next) next++;
+		if (!strncmp(line, "#:provides ", 11)) {
+			next_token(line + 11, unit->name);
+		} else if (!strncmp(line, "#:needs", 7) && (line[7] == ' ' || line[7] == '\n' || line[7] == '\0')) {
+			has_needs = 1;
+			const char * s = line + 7;
+			while (unit->dep_count < MAX_DEPS && (s = next_token(s, unit->deps[unit->dep_count]))) {
+				unit->dep_count++;
+			}
+		} else if (!strncmp(line, "#:notify", 8)) {
+			unit->notify = 1;
+		}
+		line = next;
+	}
+	return has_needs;
+}
+
+static struct unit * find_unit(const char * name) {
+	for (int i = 0; i < unit_count; ++i) {
+		if (!strcmp(units[i].name, name)) return &units[i];
+	}
+	return NULL;
+}
+
+/*
+ * A dependency on a unit that does not exist is considered met, so a
+ * missing optional service can not deadlock the boot.
+ */
+static int deps_met(struct unit * unit) {
+	for (int i = 0; i < unit->dep_count; ++i) {
+		struct unit * dep = find_unit(unit->deps[i]);
+		if (dep && !dep->ready) return 0;
+	}
+	return 1;
+}
+
+static void launch_unit(struct unit * unit) {
+	int fds[2] = {-1, -1};
+	if (unit->notify) {
+		if (syscall_pipe(fds) < 0) unit->notify = 0;
+	}
 
-	/* Fork child to run script */
-	int cpid = syscall_fork();
+	unit->started = 1;
+	unit->pid = syscall_fork();
 
 	/* Child process... */
-	if (!cpid) {
-		/* Pass environment from init to child */
-		syscall_execve(args[0], args, environ);
+	if (!unit->pid) {
+		char * args[] = {unit->path, NULL};
+		if (unit->notify) {
+			/* Tell the service where to signal readiness */
+			static char ready_var[32];
+			static char * env[64];
+			int i = 0;
+			while (environ[i] && i < 62) { env[i] = environ[i]; i++; }
+			sprintf(ready_var, "READY_FD=%d", fds[1]);
+			env[i++] = ready_var;
+			env[i] = NULL;
+			syscall_close(fds[0]);
+			syscall_execve(args[0], args, env);
+		} else {
+			/* Pass environment from init to child */
+			syscall_execve(args[0], args, environ);
+		}
 		/* exec failed, exit this subprocess */
 		syscall_exit(0);
 	}
 
-	/* Wait for the child process to finish */
-	int pid = 0;
-	do {
-		/*
-		 * Wait, ignoring kernel threads
-		 * (which also end up as children to init)
-		 */
-		pid = waitpid(-1, NULL, WNOKERN);
-
-		if (pid == -1 && errno == ECHILD) {
-			/* There are no more children */
-			break;
+	if (unit->notify) {
+		syscall_close(fds[1]);
+		unit->ready_fd = fds[0];
+	}
+}
+
+static void mark_ready(struct unit * unit) {
+	unit->ready = 1;
+	if (unit->ready_fd != -1) {
+		syscall_close(unit->ready_fd);
+		unit->ready_fd = -1;
+	}
+}
+
+static void mark_exited(int pid) {
+	for (int i = 0; i < unit_count; ++i) {
+		/* Exit counts as readiness even for notify units */
+		if (units[i].pid == pid) mark_ready(&units[i]);
+	}
+}
+
+/* Launch every unit whose dependencies are satisfied, then wait for
+ * children to exit and notify pipes to become readable, until every
+ * unit has been run to readiness. */
+static void run_units(void) {
+	for (;;) {
+		int launched = 0, running = 0, pending = 0;
+		for (int i = 0; i < unit_count; ++i) {
+			if (!units[i].started && deps_met(&units[i])) {
+				launch_unit(&units[i]);
+				launched = 1;
+			}
+			if (units[i].started && !units[i].ready) running++;
+			else if (!units[i].started) pending++;
 		}
 
-		if (pid == cpid) {
-			/* The child process finished */
-			break;
+		if (!running && !pending) break;
+
+		if (!running && !launched) {
+			/* Dependency cycle; force the first stuck unit to run */
+			for (int i = 0; i < unit_count; ++i) {
+				if (!units[i].started) { launch_unit(&units[i]); break; }
+			}
+			continue;
 		}
 
-		/* Continue while no error (or error was "interrupted") */
-	} while ((pid > 0) || (pid == -1 && errno == EINTR));
+		/* Collect notification pipes of running notify units */
+		int fds[MAX_UNITS];
+		struct unit * waiters[MAX_UNITS];
+		int nfds = 0;
+		for (int i = 0; i < unit_count; ++i) {
+			if (units[i].started && !units[i].ready && units[i].ready_fd != -1) {
+				fds[nfds] = units[i].ready_fd;
+				waiters[nfds] = &units[i];
+				nfds++;
+			}
+		}
 
-	return cpid;
+		if (nfds) {
+			/* Watch the pipes, polling for exits as we go */
+			long index = syscall_fswait2(nfds, fds, 200);
+			if (index >= 0 && index < nfds) {
+				char b;
+				syscall_read(fds[index], &b, 1);
+				mark_ready(waiters[index]);
+			}
+			int pid;
+			while ((pid = waitpid(-1, NULL, WNOHANG | WNOKERN)) > 0) {
+				mark_exited(pid);
+			}
+		} else {
+			/*
+			 * Wait, ignoring kernel threads
+			 * (which also end up as children to init)
+			 */
+			int pid = waitpid(-1, NULL, WNOKERN);
+			if (pid > 0) {
+				mark_exited(pid);
+			} else if (pid == -1 && errno == ECHILD) {
+				/* There are no more children; nothing left to wait on */
+				for (int i = 0; i < unit_count; ++i) {
+					if (units[i].started) mark_ready(&units[i]);
+				}
+			}
+		}
+	}
 }
 
 int main(int argc, char * argv[]) {
@@ -97,7 +287,11 @@ int main(int argc, char * argv[]) {
 	int initd_dir = syscall_open(INITD_PATH, 0, 0);
 	if (initd_dir < 0) {
 		/* No init scripts; try to start getty as a fallback */
-		start_options((char *[]){"/bin/getty",NULL});
+		units[0].ready_fd = -1;
+		strcpy(units[0].name, "getty");
+		strcpy(units[0].path, "/bin/getty");
+		unit_count = 1;
+		run_units();
 	} else {
 		int count = 0, i = 0, ret = 0;
 
@@ -122,14 +316,23 @@ int main(int argc, char * argv[]) {
 		}
 		qsort(entries, count, sizeof(struct dirent), comparator);
 
-		/* Run scripts */
-		for (int i = 0; i < count; ++i) {
-			if (entries[i].d_name[0] != '.') {
-				char path[256];
-				sprintf(path, "/etc/startup.d/%s", entries[i].d_name);
-				start_options((char *[]){path, NULL});
+		/* Build units from the scripts, in sorted order */
+		for (int i = 0; i < count && unit_count < MAX_UNITS; ++i) {
+			if (entries[i].d_name[0] == '.') continue;
+			struct unit * unit = &units[unit_count];
+			memset(unit, 0, sizeof(struct unit));
+			unit->ready_fd = -1;
+			sprintf(unit->path, INITD_PATH "/%s", entries[i].d_name);
+			default_name(entries[i].d_name, unit->name);
+			if (!parse_directives(unit) && unit_count > 0) {
+				/* No #:needs - stay sequential behind the previous script */
+				strcpy(unit->deps[0], units[unit_count-1].name);
+				unit->dep_count = 1;
 			}
+			unit_count++;
 		}
+
+		run_units();
 	}
 
 	/* Self-explanatory */
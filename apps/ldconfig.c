@@ -0,0 +1,149 @@
+/**
+ * @brief ldconfig - Build the dynamic linker's library cache
+ *
+ * Scans the library directories and writes /etc/ld.so.cache, a
+ * hash-indexed map from library names to full paths, so that ld.so
+ * can satisfy DT_NEEDED entries without probing each directory in
+ * its search path with failed open() attempts.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2022 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <toaru/ldcache.h>
+
+static const char * default_dirs[] = {"/lib", "/usr/lib", NULL};
+
+struct lib {
+	char * name;
+	char * path;
+	uint32_t name_off;
+	uint32_t path_off;
+	uint32_t next;
+};
+
+static struct lib * libs = NULL;
+static size_t lib_count = 0;
+static size_t lib_space = 0;
+
+static unsigned int sdbm_hash(const char * key) {
+	unsigned int hash = 0;
+	int c;
+	while ((c = *key++)) {
+		hash = c + (hash << 6) + (hash << 16) - hash;
+	}
+	return hash;
+}
+
+static int have_lib(const char * name) {
+	for (size_t i = 0; i < lib_count; ++i) {
+		if (!strcmp(libs[i].name, name)) return 1;
+	}
+	return 0;
+}
+
+static void scan_dir(const char * dir) {
+	DIR * dirp = opendir(dir);
+	if (!dirp) return;
+
+	struct dirent * ent;
+	while ((ent = readdir(dirp))) {
+		if (ent->d_name[0] == '.') continue;
+		if (!strstr(ent->d_name, ".so")) continue;
+
+		char path[1024];
+		snprintf(path, 1024, "%s/%s", dir, ent->d_name);
+
+		struct stat statbuf;
+		if (stat(path, &statbuf) || !S_ISREG(statbuf.st_mode)) continue;
+
+		/* Earlier directories in the search order win. */
+		if (have_lib(ent->d_name)) continue;
+
+		if (lib_count == lib_space) {
+			lib_space = lib_space ? lib_space * 2 : 64;
+			libs = realloc(libs, lib_space * sizeof(struct lib));
+		}
+		libs[lib_count].name = strdup(ent->d_name);
+		libs[lib_count].path = strdup(path);
+		lib_count++;
+	}
+
+	closedir(dirp);
+}
+
+int main(int argc, char * argv[]) {
+	int verbose = 0;
+	int arg = 1;
+
+	if (arg < argc && !strcmp(argv[arg], "-v")) {
+		verbose = 1;
+		arg++;
+	}
+
+	if (arg < argc) {
+		for (; arg < argc; ++arg) scan_dir(argv[arg]);
+	} else {
+		for (const char ** dir = default_dirs; *dir; dir++) scan_dir(*dir);
+	}
+
+	/* Lay out the string blob and hash chains */
+	uint32_t nbuckets = 64;
+	while (nbuckets < lib_count) nbuckets *= 2;
+
+	uint32_t * buckets = malloc(nbuckets * sizeof(uint32_t));
+	for (uint32_t i = 0; i < nbuckets; ++i) buckets[i] = LD_CACHE_NONE;
+
+	uint32_t strings_size = 0;
+	for (size_t i = 0; i < lib_count; ++i) {
+		libs[i].name_off = strings_size;
+		strings_size += strlen(libs[i].name) + 1;
+		libs[i].path_off = strings_size;
+		strings_size += strlen(libs[i].path) + 1;
+
+		uint32_t bucket = sdbm_hash(libs[i].name) % nbuckets;
+		libs[i].next = buckets[bucket];
+		buckets[bucket] = i;
+	}
+
+	struct ld_cache_header header;
+	memcpy(header.magic, LD_CACHE_MAGIC, 8);
+	header.version = LD_CACHE_VERSION;
+	header.nbuckets = nbuckets;
+	header.nentries = lib_count;
+	header.strings_size = strings_size;
+
+	FILE * out = fopen(LD_CACHE_PATH, "w");
+	if (!out) {
+		fprintf(stderr, "%s: %s: could not write cache\n", argv[0], LD_CACHE_PATH);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(buckets, sizeof(uint32_t), nbuckets, out);
+	for (size_t i = 0; i < lib_count; ++i) {
+		struct ld_cache_entry entry = {libs[i].next, libs[i].name_off, libs[i].path_off};
+		fwrite(&entry, sizeof(entry), 1, out);
+	}
+	for (size_t i = 0; i < lib_count; ++i) {
+		fwrite(libs[i].name, strlen(libs[i].name) + 1, 1, out);
+		fwrite(libs[i].path, strlen(libs[i].path) + 1, 1, out);
+	}
+	fclose(out);
+
+	if (verbose) {
+		for (size_t i = 0; i < lib_count; ++i) {
+			fprintf(stdout, "%s => %s\n", libs[i].name, libs[i].path);
+		}
+		fprintf(stdout, "%zu librar%s cached.\n", lib_count, lib_count == 1 ? "y" : "ies");
+	}
+
+	return 0;
+}
@@ -14,18 +14,26 @@
  * Copyright (C) 2018 K. Lange
  */
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 #include <toaru/confreader.h>
 #include <toaru/list.h>
 #include <toaru/hashmap.h>
 
-#define MSK_VERSION "1.0.0"
+#define MSK_VERSION "1.1.0"
 #define VAR_PATH "/var/msk"
 #define LOCK_PATH "/var/run/msk.lock"
+#define INDEX_PATH VAR_PATH "/manifest.idx"
+
+/* How many `fetch` children to run at once */
+#define MAX_PARALLEL_FETCH 4
 
 static confreader_t * msk_config = NULL;
 static confreader_t * msk_manifest = NULL;
@@ -138,6 +146,160 @@ static void read_installed(void) {
 	}
 }
 
+/**
+ * Binary package index.
+ *
+ * `msk update` writes a hash-indexed summary of the manifest next to
+ * it, so read-only commands (list, count) can mmap the index and look
+ * packages up directly instead of parsing the whole manifest as text.
+ * Layout is a header, bucket heads, chained entries, and a string
+ * blob; buckets are indexed by the sdbm hash of the package name.
+ */
+#define INDEX_MAGIC "mskindex"
+#define INDEX_VERSION 1
+#define INDEX_NONE 0xFFFFFFFF
+
+struct index_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t nbuckets;
+	uint32_t nentries;
+	uint32_t strings_size;
+};
+
+struct index_entry {
+	uint32_t next;        /* Next entry in this bucket, or INDEX_NONE */
+	uint32_t name;        /* String blob offsets... */
+	uint32_t pkg_version;
+	uint32_t description;
+};
+
+static struct index_header * msk_index = NULL;
+
+static unsigned int sdbm_hash(const char * key) {
+	unsigned int hash = 0;
+	int c;
+	while ((c = *key++)) {
+		hash = c + (hash << 6) + (hash << 16) - hash;
+	}
+	return hash;
+}
+
+static int write_index(confreader_t * manifest) {
+	list_t * packages = hashmap_keys(manifest->sections);
+	uint32_t nentries = 0;
+	foreach(node, packages) {
+		if (strlen((char*)node->value)) nentries++;
+	}
+
+	uint32_t nbuckets = 64;
+	while (nbuckets < nentries) nbuckets *= 2;
+
+	uint32_t * buckets = malloc(nbuckets * sizeof(uint32_t));
+	for (uint32_t i = 0; i < nbuckets; ++i) buckets[i] = INDEX_NONE;
+	struct index_entry * entries = malloc(nentries * sizeof(struct index_entry));
+
+	FILE * out = fopen(INDEX_PATH, "w");
+	if (!out) return 1;
+
+	/* Lay out the string blob and hash chains */
+	uint32_t strings_size = 0;
+	uint32_t i = 0;
+	foreach(node, packages) {
+		char * name = node->value;
+		if (!strlen(name)) continue;
+		char * pkg_version = confreader_getd(manifest, name, "version", "");
+		char * description = confreader_getd(manifest, name, "description", "");
+
+		entries[i].name = strings_size;
+		strings_size += strlen(name) + 1;
+		entries[i].pkg_version = strings_size;
+		strings_size += strlen(pkg_version) + 1;
+		entries[i].description = strings_size;
+		strings_size += strlen(description) + 1;
+
+		uint32_t bucket = sdbm_hash(name) % nbuckets;
+		entries[i].next = buckets[bucket];
+		buckets[bucket] = i;
+		i++;
+	}
+
+	struct index_header header;
+	memcpy(header.magic, INDEX_MAGIC, 8);
+	header.version = INDEX_VERSION;
+	header.nbuckets = nbuckets;
+	header.nentries = nentries;
+	header.strings_size = strings_size;
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(buckets, sizeof(uint32_t), nbuckets, out);
+	fwrite(entries, sizeof(struct index_entry), nentries, out);
+	foreach(node, packages) {
+		char * name = node->value;
+		if (!strlen(name)) continue;
+		fwrite(name, strlen(name) + 1, 1, out);
+		char * s = confreader_getd(manifest, name, "version", "");
+		fwrite(s, strlen(s) + 1, 1, out);
+		s = confreader_getd(manifest, name, "description", "");
+		fwrite(s, strlen(s) + 1, 1, out);
+	}
+	fclose(out);
+
+	free(buckets);
+	free(entries);
+	return 0;
+}
+
+static int load_index(void) {
+	if (msk_index) return 1;
+
+	FILE * f = fopen(INDEX_PATH, "r");
+	if (!f) return 0;
+
+	fseek(f, 0, SEEK_END);
+	size_t size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (size < sizeof(struct index_header)) {
+		fclose(f);
+		return 0;
+	}
+
+	struct index_header * header = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(f), 0);
+	fclose(f);
+	if (header == MAP_FAILED) return 0;
+
+	if (memcmp(header->magic, INDEX_MAGIC, 8) || header->version != INDEX_VERSION) return 0;
+	if (sizeof(struct index_header) + header->nbuckets * sizeof(uint32_t) +
+	    header->nentries * sizeof(struct index_entry) + header->strings_size > size) return 0;
+
+	msk_index = header;
+	return 1;
+}
+
+static struct index_entry * index_entries(void) {
+	return (struct index_entry *)((char *)msk_index + sizeof(struct index_header) +
+		msk_index->nbuckets * sizeof(uint32_t));
+}
+
+static const char * index_string(uint32_t offset) {
+	return (char *)msk_index + sizeof(struct index_header) +
+		msk_index->nbuckets * sizeof(uint32_t) +
+		msk_index->nentries * sizeof(struct index_entry) + offset;
+}
+
+static struct index_entry * index_lookup(const char * name) {
+	if (!msk_index) return NULL;
+	uint32_t * buckets = (uint32_t *)((char *)msk_index + sizeof(struct index_header));
+	struct index_entry * entries = index_entries();
+	uint32_t i = buckets[sdbm_hash(name) % msk_index->nbuckets];
+	while (i != INDEX_NONE) {
+		if (!strcmp(index_string(entries[i].name), name)) return &entries[i];
+		i = entries[i].next;
+	}
+	return NULL;
+}
+
 static void make_var(void) {
 	struct stat buf;
 	if (stat(VAR_PATH, &buf)) {
@@ -160,10 +322,13 @@ static int usage(int argc, char * argv[]) {
 			"\n"
 			"usage: %s update\n"
 			"       %s install [PACKAGE...]\n"
+			"       %s upgrade\n"
 			"\n"
 			" update  " _IT "update local manifest from remote" _END
 			" install " _IT "install packages" _END
-			"\n", argv[0], argv[0], argv[0]);
+			" upgrade " _IT "reinstall packages with newer versions" _END
+			" info    " _IT "describe a package" _END
+			"\n", argv[0], argv[0], argv[0], argv[0]);
 	return 1;
 }
 
@@ -184,9 +349,43 @@ static int update_stores(int argc, char * argv[]) {
 
 	int one_success = 0;
 
+	/* Start every remote manifest download at once... */
+	hashmap_t * fetch_pids = hashmap_create_int(10);
+	int outstanding = 0;
 	char * order = strdup(confreader_getd(msk_config, "", "remote_order", ""));
 	char * save;
 	char * tok = strtok_r(order, ",", &save);
+	do {
+		char * remote_path = hashmap_get(remotes, tok);
+		if (!remote_path || remote_path[0] == '/') continue;
+		char cmd[512];
+		sprintf(cmd, "fetch -o /tmp/.msk_remote_%s %s/manifest", tok, remote_path);
+		fprintf(stderr, "Downloading remote manifest '%s'...\n", tok);
+		int pid = fork();
+		if (!pid) {
+			exit(system(cmd) ? 1 : 0);
+		}
+		hashmap_set(fetch_pids, (void*)(uintptr_t)pid, strdup(tok));
+		outstanding++;
+	} while ((tok = strtok_r(NULL, ",", &save)));
+	free(order);
+
+	/* ...and wait for all of them before merging */
+	hashmap_t * fetch_failed = hashmap_create(10);
+	while (outstanding) {
+		int status = 0;
+		int pid = waitpid(-1, &status, 0);
+		if (pid < 0) break;
+		char * remote_name = hashmap_get(fetch_pids, (void*)(uintptr_t)pid);
+		if (!remote_name) continue;
+		if (WEXITSTATUS(status)) {
+			hashmap_set(fetch_failed, remote_name, remote_name);
+		}
+		outstanding--;
+	}
+
+	order = strdup(confreader_getd(msk_config, "", "remote_order", ""));
+	tok = strtok_r(order, ",", &save);
 	do {
 		char * remote_name = strdup(tok);
 		char * remote_path = hashmap_get(remotes, remote_name);
@@ -206,15 +405,17 @@ static int update_stores(int argc, char * argv[]) {
 				goto _next;
 			}
 		} else {
-			char cmd[512];
-			sprintf(cmd, "fetch -vo /tmp/.msk_remote_%s %s/manifest", remote_name, remote_path);
-			fprintf(stderr, "Downloading remote manifest '%s'...\n", remote_name);
-			if (system(cmd)) {
+			if (hashmap_has(fetch_failed, remote_name)) {
 				fprintf(stderr, "Skipping unavailable remote manifest '%s' (%s).\n", remote_name, remote_path);
 				goto _next;
 			}
-			sprintf(cmd, "/tmp/.msk_remote_%s", remote_name);
-			manifest = confreader_load(cmd);
+			char path[512];
+			sprintf(path, "/tmp/.msk_remote_%s", remote_name);
+			manifest = confreader_load(path);
+			if (!manifest) {
+				fprintf(stderr, "Skipping unreadable remote manifest '%s'.\n", remote_name);
+				goto _next;
+			}
 		}
 
 		list_t * packages = hashmap_keys(manifest->sections);
@@ -252,7 +453,8 @@ _next:
 		return 1;
 	}
 
-	return confreader_write(manifest_out, VAR_PATH "/manifest");
+	if (confreader_write(manifest_out, VAR_PATH "/manifest")) return 1;
+	return write_index(manifest_out);
 }
 
 static int list_contains(list_t * list, char * key) {
@@ -296,18 +498,7 @@ static int install_package(char * pkg) {
 	char * msk_remote = confreader_get(msk_manifest, pkg, "remote_path");
 
 	if (strstr(msk_remote, "http:") == msk_remote || strstr(msk_remote, "https:") == msk_remote) {
-		char * source = confreader_get(msk_manifest, pkg, "source");
-		if (source) {
-			fprintf(stderr, "Download %s...\n", pkg);
-			char cmd[1024];
-			sprintf(cmd, "fetch -o /tmp/msk.file -v %s/%s", msk_remote,
-					source);
-			int status;
-			if ((status = system(cmd))) {
-				return status;
-			}
-			hashmap_set(hashmap_get(msk_manifest->sections, pkg), "source", "/tmp/msk.file");
-		}
+		/* prefetch_packages has already downloaded this into /tmp */
 	} else if (msk_remote[0] == '/') {
 		char * source = confreader_get(msk_manifest, pkg, "source");
 		if (source) {
@@ -391,7 +582,7 @@ static int install_package(char * pkg) {
 	}
 
 	char * source = confreader_get(msk_manifest, pkg, "source");
-	if (source && !strcmp(source, "/tmp/msk.file")) {
+	if (source && strstr(source, "/tmp/msk.file") == source) {
 		char cmd[1024];
 		sprintf(cmd, "rm %s", source);
 		int status;
@@ -418,6 +609,82 @@ static int install_package(char * pkg) {
 	return 0;
 }
 
+/**
+ * Download every remote package in the list, up to MAX_PARALLEL_FETCH
+ * at a time, before any of them are installed. Each download lands in
+ * its own /tmp/msk.file.N and the package's source is pointed at it.
+ */
+static int prefetch_packages(list_t * ordered) {
+	hashmap_t * fetch_pids = hashmap_create_int(10);
+	int outstanding = 0;
+	int failed = 0;
+	int index = 0;
+
+	foreach(node, ordered) {
+		char * pkg = node->value;
+		char * msk_remote = confreader_get(msk_manifest, pkg, "remote_path");
+		char * source = confreader_get(msk_manifest, pkg, "source");
+		if (!source) continue;
+		if (strstr(msk_remote, "http:") != msk_remote && strstr(msk_remote, "https:") != msk_remote) continue;
+
+		if (outstanding == MAX_PARALLEL_FETCH) {
+			int status = 0;
+			int pid = waitpid(-1, &status, 0);
+			if (pid > 0 && hashmap_has(fetch_pids, (void*)(uintptr_t)pid)) {
+				if (WEXITSTATUS(status)) {
+					fprintf(stderr, "Download of %s failed.\n", (char*)hashmap_get(fetch_pids, (void*)(uintptr_t)pid));
+					failed = 1;
+				}
+				outstanding--;
+			}
+		}
+
+		char * dest = malloc(32);
+		sprintf(dest, "/tmp/msk.file.%d", index++);
+
+		fprintf(stderr, "Download %s...\n", pkg);
+		int pid = fork();
+		if (!pid) {
+			char cmd[1024];
+			sprintf(cmd, "fetch -o %s %s/%s", dest, msk_remote, source);
+			exit(system(cmd) ? 1 : 0);
+		}
+		hashmap_set(fetch_pids, (void*)(uintptr_t)pid, pkg);
+		hashmap_set(hashmap_get(msk_manifest->sections, pkg), "source", dest);
+		outstanding++;
+	}
+
+	while (outstanding) {
+		int status = 0;
+		int pid = waitpid(-1, &status, 0);
+		if (pid < 0) break;
+		if (!hashmap_has(fetch_pids, (void*)(uintptr_t)pid)) continue;
+		if (WEXITSTATUS(status)) {
+			fprintf(stderr, "Download of %s failed.\n", (char*)hashmap_get(fetch_pids, (void*)(uintptr_t)pid));
+			failed = 1;
+		}
+		outstanding--;
+	}
+
+	hashmap_free(fetch_pids);
+	return failed;
+}
+
+static int download_and_install(list_t * ordered) {
+	if (prefetch_packages(ordered)) {
+		fprintf(stderr, "Not installing anything; a download failed.\n");
+		return 1;
+	}
+
+	foreach(node, ordered) {
+		if (install_package(node->value)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static int install_packages(int argc, char * argv[]) {
 	needs_root();
 	needs_lock();
@@ -453,19 +720,55 @@ static int install_packages(int argc, char * argv[]) {
 		}
 	}
 
-	foreach(node, ordered) {
-		if (install_package(node->value)) {
-			return 1;
+	return download_and_install(ordered);
+}
+
+static int upgrade_packages(int argc, char * argv[]) {
+	needs_root();
+	needs_lock();
+	read_config();
+	read_manifest(1);
+	read_installed();
+
+	/* Only packages whose manifest version is newer than what is
+	 * installed get downloaded; everything else stays untouched. */
+	list_t * ordered = list_create();
+	list_t * installed_list = hashmap_keys(msk_installed);
+	foreach(node, installed_list) {
+		char * name = node->value;
+		if (!hashmap_has(msk_manifest->sections, name)) continue;
+		char * current = hashmap_get(msk_installed, name);
+		char * candidate = confreader_getd(msk_manifest, name, "version", "");
+		if (compare_version_strings(current, candidate) > 0) {
+			fprintf(stderr, "%s %s -> %s\n", name, current, candidate);
+			list_insert(ordered, strdup(name));
 		}
 	}
 
-	return 0;
+	if (!ordered->length) {
+		fprintf(stderr, "All packages are up to date.\n");
+		return 0;
+	}
+
+	return download_and_install(ordered);
 }
 
 static int list_packages(int argc, char * argv[]) {
+	read_installed();
+
+	if (load_index()) {
+		/* Fast path: everything we need is in the binary index */
+		struct index_entry * entries = index_entries();
+		for (uint32_t i = 0; i < msk_index->nentries; ++i) {
+			const char * name = index_string(entries[i].name);
+			fprintf(stderr, " %c %20s %s\n", hashmap_has(msk_installed, (void*)name) ? 'I' : ' ',
+					name, index_string(entries[i].description));
+		}
+		return 0;
+	}
+
 	read_config();
 	read_manifest(0);
-	read_installed();
 
 	/* Go through sections */
 	list_t * packages = hashmap_keys(msk_manifest->sections);
@@ -481,13 +784,24 @@ static int list_packages(int argc, char * argv[]) {
 }
 
 static int count_packages(int argc, char * argv[]) {
-	read_config();
-	read_manifest(0);
 	read_installed();
 
 	int installed = 0;
 	int available = 0;
 
+	if (load_index()) {
+		struct index_entry * entries = index_entries();
+		for (uint32_t i = 0; i < msk_index->nentries; ++i) {
+			available++;
+			if (hashmap_has(msk_installed, (void*)index_string(entries[i].name))) installed++;
+		}
+		fprintf(stdout, "%d installed; %d available\n", installed, available);
+		return 0;
+	}
+
+	read_config();
+	read_manifest(0);
+
 	/* Go through sections */
 	list_t * packages = hashmap_keys(msk_manifest->sections);
 	foreach(node, packages) {
@@ -503,6 +817,39 @@ static int count_packages(int argc, char * argv[]) {
 	return 0;
 }
 
+static int info_package(int argc, char * argv[]) {
+	if (argc < 3) {
+		fprintf(stderr, "%s: info: expected package name\n", argv[0]);
+		return 1;
+	}
+
+	read_installed();
+
+	if (load_index()) {
+		struct index_entry * entry = index_lookup(argv[2]);
+		if (!entry) {
+			fprintf(stderr, "%s: no package '%s'\n", argv[0], argv[2]);
+			return 1;
+		}
+		fprintf(stdout, "%s %s - %s%s\n", index_string(entry->name), index_string(entry->pkg_version),
+				index_string(entry->description),
+				hashmap_has(msk_installed, (void*)index_string(entry->name)) ? " (installed)" : "");
+		return 0;
+	}
+
+	read_config();
+	read_manifest(1);
+
+	if (!hashmap_has(msk_manifest->sections, argv[2])) {
+		fprintf(stderr, "%s: no package '%s'\n", argv[0], argv[2]);
+		return 1;
+	}
+	fprintf(stdout, "%s %s - %s%s\n", argv[2], confreader_getd(msk_manifest, argv[2], "version", ""),
+			confreader_getd(msk_manifest, argv[2], "description", ""),
+			hashmap_has(msk_installed, argv[2]) ? " (installed)" : "");
+	return 0;
+}
+
 static int version(void) {
 	fprintf(stderr, "msk " MSK_VERSION "\n");
 	return 0;
@@ -518,6 +865,10 @@ int main(int argc, char * argv[]) {
 		return update_stores(argc,argv);
 	} else if (!strcmp(argv[1], "install")) {
 		return install_packages(argc,argv);
+	} else if (!strcmp(argv[1], "upgrade")) {
+		return upgrade_packages(argc,argv);
+	} else if (!strcmp(argv[1], "info")) {
+		return info_package(argc,argv);
 	} else if (!strcmp(argv[1], "list")) {
 		return list_packages(argc, argv);
 	} else if (!strcmp(argv[1], "count")) {
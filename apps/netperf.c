@@ -0,0 +1,245 @@
+/**
+ * @brief netperf - On-target network benchmark and probe tool
+ *
+ * Measures the network stack from inside the system instead of
+ * inferring from host-side tools. One binary is both ends:
+ *
+ *    netperf -s [-u] [-p port]           server (discard or echo)
+ *    netperf -c host [-t sec] [-l len]   TCP stream throughput
+ *    netperf -c host -r                  request-response latency
+ *    netperf -c host -u [-l len]         UDP stream / packet rate
+ *    netperf -c host -u -r               UDP round-trip latency
+ *
+ * Stream modes report throughput and packet rate; -r modes report
+ * average, p50, and p99 round-trip latency. Every client run dumps
+ * the kernel's /proc/net counters before and after so driver drops
+ * and TCP retransmits during the run are visible next to the result.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+#define DEFAULT_PORT 5201
+#define MAX_SAMPLES 100000
+
+/* Mode byte sent by TCP clients at connect. */
+#define MODE_DISCARD 'D'
+#define MODE_ECHO    'E'
+
+static int udp = 0;
+static int rr = 0;
+static int port = DEFAULT_PORT;
+static int duration = 5;
+static int length = 0; /* 0: per-mode default */
+
+static double now(void) {
+	struct timeval t;
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec / 1000000.0;
+}
+
+static void dump_counters(const char * label) {
+	const char * files[] = {"/proc/net/netif", "/proc/net/tcp", NULL};
+	printf("--- kernel counters (%s) ---\n", label);
+	for (const char ** f = files; *f; ++f) {
+		FILE * p = fopen(*f, "r");
+		if (!p) continue;
+		printf("%s:\n", *f);
+		char line[256];
+		while (fgets(line, sizeof(line), p)) {
+			printf("  %s", line);
+		}
+		fclose(p);
+	}
+}
+
+static int cmp_ull(const void * a, const void * b) {
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+	return (x > y) - (x < y);
+}
+
+static void report_latency(unsigned long long * samples, int count, double elapsed) {
+	qsort(samples, count, sizeof(unsigned long long), cmp_ull);
+	unsigned long long total = 0;
+	for (int i = 0; i < count; ++i) total += samples[i];
+	printf("%d round trips in %.2fs (%.0f/s)\n", count, elapsed, count / elapsed);
+	printf("latency avg %.1f us, p50 %llu us, p99 %llu us, max %llu us\n",
+		(double)total / count,
+		samples[count / 2],
+		samples[count - 1 - count / 100],
+		samples[count - 1]);
+}
+
+static int run_server(void) {
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port   = htons(port),
+	};
+
+	if (udp) {
+		int sock = socket(AF_INET, SOCK_DGRAM, 0);
+		if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			perror("bind");
+			return 1;
+		}
+		fprintf(stderr, "netperf: UDP echo server on port %d\n", port);
+		char * buf = malloc(65536);
+		while (1) {
+			struct sockaddr_in peer;
+			socklen_t plen = sizeof(peer);
+			ssize_t r = recvfrom(sock, buf, 65536, 0, (struct sockaddr*)&peer, &plen);
+			if (r > 0) sendto(sock, buf, r, 0, (struct sockaddr*)&peer, plen);
+		}
+	}
+
+	int sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 4) < 0) {
+		perror("bind");
+		return 1;
+	}
+	fprintf(stderr, "netperf: TCP server on port %d\n", port);
+
+	char * buf = malloc(65536);
+	while (1) {
+		int conn = accept(sock, NULL, NULL);
+		if (conn < 0) continue;
+		char mode;
+		if (recv(conn, &mode, 1, 0) != 1) { close(conn); continue; }
+		size_t total = 0;
+		double start = now();
+		ssize_t r;
+		while ((r = recv(conn, buf, 65536, 0)) > 0) {
+			total += r;
+			if (mode == MODE_ECHO) send(conn, buf, r, 0);
+		}
+		double elapsed = now() - start;
+		fprintf(stderr, "netperf: connection closed, %zu bytes in %.2fs (%.2f MB/s)\n",
+			total, elapsed, total / elapsed / (1024.0 * 1024.0));
+		close(conn);
+	}
+}
+
+static int run_client(const char * host) {
+	struct hostent * remote = gethostbyname(host);
+	if (!remote) {
+		fprintf(stderr, "netperf: %s: lookup failed\n", host);
+		return 1;
+	}
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port   = htons(port),
+	};
+	memcpy(&addr.sin_addr.s_addr, remote->h_addr, remote->h_length);
+
+	if (!length) length = udp ? (rr ? 64 : 1400) : (rr ? 64 : 65536);
+	char * buf = malloc(length > 65536 ? length : 65536);
+	memset(buf, 0x2a, length);
+
+	dump_counters("before");
+
+	/* The UDP layer is sendto/recvfrom only - there is no connect. */
+	int sock = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+	if (!udp) {
+		if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+			perror("connect");
+			return 1;
+		}
+		char mode = rr ? MODE_ECHO : MODE_DISCARD;
+		send(sock, &mode, 1, 0);
+	}
+
+	double start = now();
+	double deadline = start + duration;
+
+	if (rr) {
+		static unsigned long long samples[MAX_SAMPLES];
+		int count = 0;
+		while (now() < deadline && count < MAX_SAMPLES) {
+			double t0 = now();
+			ssize_t sent = udp
+				? sendto(sock, buf, length, 0, (struct sockaddr*)&addr, sizeof(addr))
+				: send(sock, buf, length, 0);
+			if (sent < 0) break;
+			size_t got = 0;
+			while (got < (size_t)length) {
+				ssize_t r = recvfrom(sock, buf, length, 0, NULL, NULL);
+				if (r <= 0) goto _rr_done;
+				got += r;
+				if (udp) break; /* datagrams echo whole */
+			}
+			samples[count++] = (unsigned long long)((now() - t0) * 1000000.0);
+		}
+_rr_done:
+		if (!count) {
+			fprintf(stderr, "netperf: no round trips completed\n");
+			return 1;
+		}
+		printf("%s request-response, %d byte messages to %s:%d\n",
+			udp ? "UDP" : "TCP", length, host, port);
+		report_latency(samples, count, now() - start);
+	} else {
+		size_t total = 0, packets = 0;
+		while (now() < deadline) {
+			ssize_t r = udp
+				? sendto(sock, buf, length, 0, (struct sockaddr*)&addr, sizeof(addr))
+				: send(sock, buf, length, 0);
+			if (r < 0) break;
+			total += r;
+			packets++;
+		}
+		double elapsed = now() - start;
+		printf("%s stream, %d byte %s to %s:%d\n",
+			udp ? "UDP" : "TCP", length, udp ? "datagrams" : "writes", host, port);
+		printf("%zu bytes in %.2fs: %.2f MB/s, %.0f %s/s\n",
+			total, elapsed, total / elapsed / (1024.0 * 1024.0),
+			packets / elapsed, udp ? "packets" : "writes");
+	}
+
+	close(sock);
+	dump_counters("after");
+	return 0;
+}
+
+static void usage(char * argv[]) {
+	fprintf(stderr,
+		"usage: %s -s [-u] [-p port]\n"
+		"       %s -c host [-u] [-r] [-p port] [-t seconds] [-l length]\n",
+		argv[0], argv[0]);
+}
+
+int main(int argc, char * argv[]) {
+	int server = 0;
+	const char * host = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "sc:urp:t:l:?")) != -1) {
+		switch (opt) {
+			case 's': server = 1; break;
+			case 'c': host = optarg; break;
+			case 'u': udp = 1; break;
+			case 'r': rr = 1; break;
+			case 'p': port = atoi(optarg); break;
+			case 't': duration = atoi(optarg); break;
+			case 'l': length = atoi(optarg); break;
+			case '?': usage(argv); return 1;
+		}
+	}
+
+	if (server) return run_server();
+	if (host) return run_client(host);
+	usage(argv);
+	return 1;
+}
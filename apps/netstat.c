@@ -0,0 +1,60 @@
+/**
+ * @brief netstat - Show network connections and interface statistics
+ *
+ * Prints the kernel's per-socket TCP state from /proc/net/tcp, or with
+ * -i the per-interface counters and queue depths from /proc/net/netif.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+void show_usage(int argc, char * argv[]) {
+	printf(
+			"netstat - show network connections and statistics\n"
+			"\n"
+			"usage: %s [-i?]\n"
+			"\n"
+			" -i     \033[3mshow interface statistics instead of connections\033[0m\n"
+			" -?     \033[3mshow this help text\033[0m\n"
+			"\n", argv[0]);
+}
+
+static int dump(const char * path) {
+	FILE * f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "netstat: %s: no such file; is the network stack up?\n", path);
+		return 1;
+	}
+
+	char buf[1024];
+	size_t r;
+	while ((r = fread(buf, 1, sizeof(buf), f)) > 0) {
+		fwrite(buf, 1, r, stdout);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+int main(int argc, char * argv[]) {
+	int interfaces = 0;
+
+	int c;
+	while ((c = getopt(argc, argv, "i?")) != -1) {
+		switch (c) {
+			case 'i':
+				interfaces = 1;
+				break;
+			case '?':
+				show_usage(argc, argv);
+				return 0;
+		}
+	}
+
+	return dump(interfaces ? "/proc/net/netif" : "/proc/net/tcp");
+}
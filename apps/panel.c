@@ -532,6 +532,7 @@ void redraw(void) {
 		struct PanelWidget * widget = widget_node->value;
 		gfx_context_t * inner = init_graphics_subregion(ctx, widget->left, Y_PAD, widget->width, PANEL_HEIGHT - Y_PAD * 2);
 		widget->draw(widget, inner);
+		widget->dirty = 0;
 		free(inner);
 	}
 
@@ -540,6 +541,35 @@ void redraw(void) {
 	yutani_flip(yctx, panel);
 }
 
+/**
+ * Repaint only the widgets that marked themselves dirty, restoring the
+ * prerendered background underneath them and flipping just their strip
+ * of the bar, so a ticking clock doesn't redraw the whole panel.
+ */
+static void redraw_dirty_widgets(void) {
+	foreach(widget_node, widgets_enabled) {
+		struct PanelWidget * widget = widget_node->value;
+		if (!widget->dirty) continue;
+		widget->dirty = 0;
+		if (widget->width <= 0) continue;
+
+		for (int y = Y_PAD; y < PANEL_HEIGHT - Y_PAD; ++y) {
+			size_t offset = y * GFX_S(ctx) + widget->left * GFX_B(ctx);
+			memcpy(ctx->backbuffer + offset, bg_blob + offset, widget->width * GFX_B(ctx));
+		}
+
+		gfx_context_t * inner = init_graphics_subregion(ctx, widget->left, Y_PAD, widget->width, PANEL_HEIGHT - Y_PAD * 2);
+		widget->draw(widget, inner);
+		free(inner);
+
+		for (int y = Y_PAD; y < PANEL_HEIGHT - Y_PAD; ++y) {
+			size_t offset = y * GFX_S(ctx) + widget->left * GFX_B(ctx);
+			memcpy(ctx->buffer + offset, ctx->backbuffer + offset, widget->width * GFX_B(ctx));
+		}
+		yutani_flip_region(yctx, panel, widget->left, Y_PAD, widget->width, PANEL_HEIGHT - Y_PAD * 2);
+	}
+}
+
 static void update_window_list(void) {
 	yutani_query_windows(yctx);
 
@@ -711,6 +741,10 @@ struct PanelWidget * widget_new(void) {
 	out->move = mouse_event_ignore; /* move_generic */
 	out->highlighted = 0;
 	out->fill = 0;
+	out->interval = 0;
+	out->next_update = 0;
+	out->fd = -1;
+	out->dirty = 0;
 	return out;
 }
 
@@ -739,16 +773,67 @@ static void widgets_layout(void) {
 	}
 }
 
-static void update_periodic_widgets(void) {
+/**
+ * Force an update of every widget that has one, regardless of its
+ * schedule; used at startup to collect initial state before layout.
+ */
+static void update_all_widgets(void) {
 	int needs_layout = 0;
+	time_t now = time(NULL);
 	foreach(widget_node, widgets_enabled) {
 		struct PanelWidget * widget = widget_node->value;
 		needs_layout |= widget->update(widget);
+		widget->next_update = now + widget->interval;
 	}
 	if (needs_layout) widgets_layout();
 	redraw();
 }
 
+/**
+ * Run update() for the widgets whose timers have come due and repaint
+ * whatever they dirtied.
+ */
+static void update_due_widgets(void) {
+	int needs_layout = 0;
+	time_t now = time(NULL);
+	foreach(widget_node, widgets_enabled) {
+		struct PanelWidget * widget = widget_node->value;
+		if (!widget->interval || widget->next_update > now) continue;
+		needs_layout |= widget->update(widget);
+		widget->next_update = now + widget->interval;
+	}
+	if (needs_layout) {
+		widgets_layout();
+		redraw();
+	} else {
+		redraw_dirty_widgets();
+	}
+}
+
+/**
+ * One coalesced timer for the whole bar: sleep until the soonest
+ * scheduled widget update, aligned just past the second boundary so
+ * the clock ticks crisply. Clamped so launched children still get
+ * reaped and alt-tab thumbnails stay fresh.
+ */
+static int widgets_next_timeout(void) {
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	int timeout = 2000;
+	foreach(widget_node, widgets_enabled) {
+		struct PanelWidget * widget = widget_node->value;
+		if (!widget->interval) continue;
+		int msec = (widget->next_update - now.tv_sec) * 1000 - now.tv_usec / 1000;
+		if (msec < 0) msec = 0;
+		if (msec < timeout) timeout = msec;
+	}
+
+	if (was_tabbing && timeout > 500) timeout = 500;
+
+	return timeout;
+}
+
 int panel_menu_show_at(struct MenuList * menu, int x) {
 	int mwidth, mheight, offset;
 
@@ -869,7 +954,7 @@ int main (int argc, char ** argv) {
 	}
 
 	/* Lay out the widgets */
-	update_periodic_widgets();
+	update_all_widgets();
 	widgets_layout();
 
 	/* Subscribe to window updates */
@@ -881,15 +966,25 @@ int main (int argc, char ** argv) {
 	/* Key bindings */
 	bind_keys();
 
-	time_t last_tick = 0;
-
-	int fds[1] = {fileno(yctx->sock)};
+	int fds[32];
+	struct PanelWidget * fd_widgets[32];
 
 	fprintf(stderr, "entering loop?\n");
 
 	while (_continue) {
 
-		int index = fswait2(1,fds,200);
+		/* Wait on the compositor socket and any widget event sources */
+		fds[0] = fileno(yctx->sock);
+		int nfds = 1;
+		foreach(widget_node, widgets_enabled) {
+			struct PanelWidget * widget = widget_node->value;
+			if (widget->fd >= 0 && nfds < 32) {
+				fd_widgets[nfds] = widget;
+				fds[nfds++] = widget->fd;
+			}
+		}
+
+		int index = fswait2(nfds,fds,widgets_next_timeout());
 
 		if (index == 0) {
 			/* Respond to Yutani events */
@@ -935,17 +1030,24 @@ int main (int argc, char ** argv) {
 				free(m);
 				m = yutani_poll_async(yctx);
 			}
+		} else if (index > 0 && index < nfds) {
+			/* A widget's event source fired; push the change to it */
+			struct PanelWidget * widget = fd_widgets[index];
+			if (widget->update(widget)) {
+				widgets_layout();
+				redraw();
+			} else {
+				redraw_dirty_widgets();
+			}
 		}
 
-		struct timeval now;
-		gettimeofday(&now, NULL);
-		if (now.tv_sec != last_tick) {
-			last_tick = now.tv_sec;
-			waitpid(-1, NULL, WNOHANG);
-			update_periodic_widgets();
-			if (was_tabbing) {
-				redraw_alttab();
-			}
+		/* Reap any children we've launched */
+		waitpid(-1, NULL, WNOHANG);
+
+		update_due_widgets();
+
+		if (was_tabbing) {
+			redraw_alttab();
 		}
 	}
 
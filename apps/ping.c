@@ -16,7 +16,7 @@
 #include <unistd.h>
 #include <poll.h>
 #include <signal.h>
-#include <sys/times.h>
+#include <sys/time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
@@ -88,6 +88,12 @@ int main(int argc, char * argv[]) {
 		return 1;
 	}
 
+	/* Replies get stamped as they enter the kernel, so the reported
+	 * time is wire latency rather than however long it took us to get
+	 * scheduled after the wakeup. */
+	int one = 1;
+	setsockopt(sock, SOL_SOCKET, SO_TIMESTAMP, &one, sizeof(one));
+
 	signal(SIGINT, sig_break_loop);
 
 	struct sockaddr_in dest;
@@ -114,7 +120,8 @@ int main(int argc, char * argv[]) {
 		ping->checksum = htons(icmp_checksum((void*)ping, BYTES_TO_SEND));
 
 		/* Send it and wait */
-		clock_t sent_at = times(NULL);
+		struct timeval sent_at;
+		gettimeofday(&sent_at, NULL);
 		if (sendto(sock, (void*)ping, BYTES_TO_SEND, 0, (struct sockaddr*)&dest, sizeof(struct sockaddr_in)) < 0) {
 			fprintf(stderr, "sendto: %s\n", strerror(errno));
 		}
@@ -128,8 +135,25 @@ int main(int argc, char * argv[]) {
 
 		if (ret > 0) {
 			char data[4096];
-			ssize_t len = recv(sock, data, 4096, 0);
-			clock_t rcvd_at = times(NULL);
+			char ctrl[64];
+			struct iovec _iov = { data, 4096 };
+			struct msghdr hdr = {
+				.msg_name = NULL,
+				.msg_namelen = 0,
+				.msg_iov = &_iov,
+				.msg_iovlen = 1,
+				.msg_control = ctrl,
+				.msg_controllen = sizeof(ctrl),
+				.msg_flags = 0,
+			};
+			ssize_t len = recvmsg(sock, &hdr, 0);
+			struct timeval rcvd_at;
+			gettimeofday(&rcvd_at, NULL);
+			/* Prefer the kernel's arrival stamp when it sent one along. */
+			struct cmsghdr * cmsg = CMSG_FIRSTHDR(&hdr);
+			if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP) {
+				memcpy(&rcvd_at, CMSG_DATA(cmsg), sizeof(rcvd_at));
+			}
 			if (len > 0) {
 				/* Is it actually a PING response ? */
 
@@ -141,16 +165,18 @@ int main(int argc, char * argv[]) {
 					size_t len = ntohs(ipv4->length) - sizeof(struct IPV4_Header);
 					/* Get the address */
 					char * from = inet_ntoa(*(struct in_addr*)&ipv4->source);
-					int time_taken = (rcvd_at - sent_at);
-					printf("%zd bytes from %s: icmp_seq=%d ttl=%d time=%d",
+					long long time_taken = (rcvd_at.tv_sec - sent_at.tv_sec) * 1000000LL +
+						(rcvd_at.tv_usec - sent_at.tv_usec);
+					if (time_taken < 0) time_taken = 0;
+					printf("%zd bytes from %s: icmp_seq=%d ttl=%d time=%lld",
 						len, from, ntohs(icmp->sequence_number), ipv4->ttl,
 						time_taken / 1000);
 					if (time_taken < 1000) {
-						printf(".%03d", time_taken % 1000);
+						printf(".%03lld", time_taken % 1000);
 					} else if (time_taken < 10000) {
-						printf(".%02d", (time_taken / 10) % 100);
+						printf(".%02lld", (time_taken / 10) % 100);
 					} else if (time_taken < 100000) {
-						printf(".%01d", (time_taken / 100) % 10);
+						printf(".%01lld", (time_taken / 100) % 10);
 					}
 					printf(" ms\n");
 					responses_received++;
@@ -0,0 +1,238 @@
+/**
+ * @brief Sampling profiler frontend.
+ *
+ * Drives the kernel's timer-based sampling profiler: starts
+ * collection via ioctls on /proc/profile, sleeps for the requested
+ * duration, and renders a flat profile of where time was spent.
+ * Kernel samples are resolved against /proc/kallsyms; user samples
+ * are attributed to their process.
+ *
+ *   prof [-d seconds] [-n divisor]
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/profile.h>
+
+struct ksym {
+	uintptr_t addr;
+	char * name;
+};
+
+static struct ksym * ksyms = NULL;
+static size_t ksym_count = 0;
+
+static int ksym_compare(const void * a, const void * b) {
+	uintptr_t l = ((const struct ksym *)a)->addr;
+	uintptr_t r = ((const struct ksym *)b)->addr;
+	return (l > r) - (l < r);
+}
+
+static void load_kallsyms(void) {
+	FILE * f = fopen("/proc/kallsyms", "r");
+	if (!f) return;
+
+	size_t space = 256;
+	ksyms = malloc(space * sizeof(struct ksym));
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		uintptr_t addr = strtoul(line, NULL, 16);
+		char * name = strchr(line, ' ');
+		if (!addr || !name) continue;
+		name++;
+		char * nl = strchr(name, '\n');
+		if (nl) *nl = '\0';
+		if (ksym_count == space) {
+			space *= 2;
+			ksyms = realloc(ksyms, space * sizeof(struct ksym));
+		}
+		ksyms[ksym_count].addr = addr;
+		ksyms[ksym_count].name = strdup(name);
+		ksym_count++;
+	}
+	fclose(f);
+
+	qsort(ksyms, ksym_count, sizeof(struct ksym), ksym_compare);
+}
+
+/* Index of the symbol covering @p addr, or -1. */
+static ssize_t ksym_find(uintptr_t addr) {
+	if (!ksym_count || addr < ksyms[0].addr) return -1;
+	size_t lo = 0, hi = ksym_count;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (ksyms[mid].addr <= addr) lo = mid;
+		else hi = mid;
+	}
+	return lo;
+}
+
+static char * process_name(int pid) {
+	char tmp[100];
+	sprintf(tmp, "/proc/%d/status", pid);
+	FILE * f = fopen(tmp, "r");
+	if (!f) return strdup("(exited)");
+
+	char line[1024];
+	char * out = NULL;
+	while (fgets(line, sizeof(line), f)) {
+		if (strstr(line, "Name:") == line) {
+			char * tab = strchr(line, '\t');
+			char * nl = strchr(line, '\n');
+			if (nl) *nl = '\0';
+			if (tab) out = strdup(tab + 1);
+			break;
+		}
+	}
+	fclose(f);
+	return out ? out : strdup("?");
+}
+
+struct bucket {
+	char * label;
+	uint64_t count;
+};
+
+static struct bucket * buckets = NULL;
+static size_t bucket_count = 0;
+static size_t bucket_space = 0;
+
+static void bucket_add(const char * label) {
+	for (size_t i = 0; i < bucket_count; ++i) {
+		if (!strcmp(buckets[i].label, label)) {
+			buckets[i].count++;
+			return;
+		}
+	}
+	if (bucket_count == bucket_space) {
+		bucket_space = bucket_space ? bucket_space * 2 : 64;
+		buckets = realloc(buckets, bucket_space * sizeof(struct bucket));
+	}
+	buckets[bucket_count].label = strdup(label);
+	buckets[bucket_count].count = 1;
+	bucket_count++;
+}
+
+static int bucket_compare(const void * a, const void * b) {
+	uint64_t l = ((const struct bucket *)a)->count;
+	uint64_t r = ((const struct bucket *)b)->count;
+	return (l < r) - (l > r);
+}
+
+static void usage(char * argv[]) {
+	fprintf(stderr,
+			"usage: %s [-d seconds] [-n divisor]\n"
+			"\n"
+			" -d \033[3mseconds\033[0m   \033[3mHow long to sample for (default 10)\033[0m\n"
+			" -n \033[3mdivisor\033[0m   \033[3mSample every Nth timer tick (default 1)\033[0m\n",
+			argv[0]);
+}
+
+int main(int argc, char * argv[]) {
+	int duration = 10;
+	int divisor = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "?d:n:")) != -1) {
+		switch (opt) {
+			case 'd':
+				duration = atoi(optarg);
+				break;
+			case 'n':
+				divisor = atoi(optarg);
+				break;
+			case '?':
+				usage(argv);
+				return 1;
+		}
+	}
+
+	int fd = open("/proc/profile", O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: /proc/profile: not available\n", argv[0]);
+		return 1;
+	}
+
+	if (divisor != 1 && ioctl(fd, PROFILE_IOCTL_DIVISOR, &divisor) < 0) {
+		fprintf(stderr, "%s: failed to set divisor (are you root?)\n", argv[0]);
+		return 1;
+	}
+
+	if (ioctl(fd, PROFILE_IOCTL_START, NULL) < 0) {
+		fprintf(stderr, "%s: failed to start profiler (are you root?)\n", argv[0]);
+		return 1;
+	}
+
+	fprintf(stderr, "%s: sampling for %d seconds...\n", argv[0], duration);
+
+	/* Drain while sampling so long runs don't overflow the rings. */
+	struct profile_sample samples[512];
+	uint64_t total = 0;
+	uint64_t kernel_hits = 0;
+	time_t end = time(NULL) + duration;
+
+	load_kallsyms();
+
+	while (1) {
+		ssize_t r = read(fd, samples, sizeof(samples));
+		for (ssize_t i = 0; i < (ssize_t)(r / sizeof(struct profile_sample)); ++i) {
+			struct profile_sample * s = &samples[i];
+			total++;
+			if (s->flags & PROFILE_FLAG_KERNEL) {
+				kernel_hits++;
+				ssize_t sym = ksym_find(s->rip);
+				if (sym >= 0) {
+					bucket_add(ksyms[sym].name);
+				} else {
+					bucket_add("(unknown kernel)");
+				}
+			} else {
+				char label[200];
+				char * name = process_name(s->pid);
+				sprintf(label, "%s (%d)", name, s->pid);
+				free(name);
+				bucket_add(label);
+			}
+		}
+		if (time(NULL) >= end) {
+			if (r == 0) break;
+			ioctl(fd, PROFILE_IOCTL_STOP, NULL);
+		} else if (r == 0) {
+			usleep(100000);
+		}
+	}
+
+	ioctl(fd, PROFILE_IOCTL_STOP, NULL);
+	close(fd);
+
+	if (!total) {
+		fprintf(stderr, "%s: no samples collected\n", argv[0]);
+		return 1;
+	}
+
+	qsort(buckets, bucket_count, sizeof(struct bucket), bucket_compare);
+
+	printf("%zu samples (%zu kernel, %zu user)\n",
+			(size_t)total, (size_t)kernel_hits, (size_t)(total - kernel_hits));
+	printf("%8s %6s  %s\n", "SAMPLES", "PCT", "LOCATION");
+	for (size_t i = 0; i < bucket_count; ++i) {
+		printf("%8zu %5zu%%  %s\n",
+				(size_t)buckets[i].count,
+				(size_t)(buckets[i].count * 100 / total),
+				buckets[i].label);
+	}
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * @brief screencap - Capture the screen through the compositor
+ *
+ * Maps the compositor's shared-memory capture buffer and either
+ * saves a single frame as a TGA or watches the frame sequence
+ * counter and reports what changed, which is mostly useful for
+ * demonstrating the capture protocol and eyeballing damage sizes.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2022 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <toaru/yutani.h>
+
+static void show_usage(int argc, char * argv[]) {
+	printf(
+			"screencap - capture the screen through the compositor\n"
+			"\n"
+			"usage: %s [-o FILE] [-w?]\n"
+			"\n"
+			" -o FILE \033[3mwrite the captured frame to FILE (default: /tmp/capture.tga)\033[0m\n"
+			" -w      \033[3mwatch: report captured frames and damage until interrupted\033[0m\n"
+			" -?      \033[3mshow this help text\033[0m\n"
+			"\n", argv[0]);
+}
+
+static int write_tga(struct yutani_capture * capture, const char * path) {
+	FILE * f = fopen(path, "w");
+	if (!f) {
+		fprintf(stderr, "screencap: %s: could not open output file\n", path);
+		return 1;
+	}
+
+	struct {
+		uint8_t id_length;
+		uint8_t color_map_type;
+		uint8_t image_type;
+
+		uint16_t color_map_first_entry;
+		uint16_t color_map_length;
+		uint8_t color_map_entry_size;
+
+		uint16_t x_origin;
+		uint16_t y_origin;
+		uint16_t width;
+		uint16_t height;
+		uint8_t  depth;
+		uint8_t  descriptor;
+	} __attribute__((packed)) header = {
+		0, /* No image ID field */
+		0, /* No color map */
+		2, /* Uncompressed truecolor */
+		0, 0, 0, /* No color map */
+		0, 0, /* Don't care about origin */
+		capture->width, capture->height, 24,
+		0,
+	};
+	fwrite(&header, 1, sizeof(header), f);
+
+	for (int y = capture->height - 1; y >= 0; y--) {
+		uint32_t * row = (uint32_t *)((uint8_t *)capture->data + y * capture->stride);
+		for (unsigned int x = 0; x < capture->width; ++x) {
+			uint8_t buf[3] = {
+				(row[x]) & 0xFF,
+				(row[x] >> 8) & 0xFF,
+				(row[x] >> 16) & 0xFF,
+			};
+			fwrite(buf, 1, 3, f);
+		}
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static int watch(struct yutani_capture * capture) {
+	uint32_t seen = capture->seq;
+	printf("Capturing %ux%u, starting at frame %u.\n", capture->width, capture->height, seen);
+
+	while (capture->active) {
+		uint32_t seq = capture->seq;
+		if (seq != seen) {
+			if (seq - seen > YUTANI_CAPTURE_DAMAGE_COUNT) {
+				printf("frame %u: fell behind, full frame stale\n", seq);
+			} else {
+				for (uint32_t s = seen + 1; s <= seq; ++s) {
+					struct yutani_capture_damage * d = &capture->damage[(s - 1) % YUTANI_CAPTURE_DAMAGE_COUNT];
+					printf("frame %u: %dx%d at %d,%d\n", s, d->width, d->height, d->x, d->y);
+				}
+			}
+			seen = seq;
+		}
+		usleep(16000);
+	}
+
+	printf("Capture buffer abandoned by the server.\n");
+	return 0;
+}
+
+int main(int argc, char * argv[]) {
+	const char * out = "/tmp/capture.tga";
+	int watching = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "?o:w")) != -1) {
+		switch (opt) {
+			case 'o':
+				out = optarg;
+				break;
+			case 'w':
+				watching = 1;
+				break;
+			case '?':
+				show_usage(argc, argv);
+				return 0;
+		}
+	}
+
+	yutani_t * yctx = yutani_init();
+	if (!yctx) {
+		fprintf(stderr, "screencap: failed to connect to compositor\n");
+		return 1;
+	}
+
+	struct yutani_capture * capture = yutani_capture_start(yctx);
+	if (!capture) {
+		fprintf(stderr, "screencap: compositor refused capture\n");
+		return 1;
+	}
+
+	int ret = watching ? watch(capture) : write_tga(capture, out);
+
+	yutani_capture_stop(yctx, capture);
+	return ret;
+}
@@ -34,6 +34,7 @@
 #include <sys/wait.h>
 #include <sys/utsname.h>
 #include <sys/stat.h>
+#include <sys/spawn.h>
 
 #include <toaru/list.h>
 #include <toaru/hashmap.h>
@@ -789,6 +790,37 @@ void run_cmd(char ** args) {
 	exit(i);
 }
 
+/**
+ * Launch an external command with spawn() instead of fork()+exec().
+ *
+ * The combined syscall skips duplicating the shell's address space, so
+ * it's much cheaper for script-heavy workloads, but the child can't run
+ * any shell code: redirections are set up by pointing our own std
+ * streams at the right places around the call (the kernel closes
+ * everything above stderr in the child, so the saved copies don't
+ * leak), and anything that needs to happen in the child - job control,
+ * builtins in pipelines - takes the fork path instead.
+ *
+ * Returns the child pid, or -1 if the caller should fork.
+ */
+pid_t try_spawn(char ** args, int new_stdin, int new_stdout, int new_stderr) {
+	if (shell_interactive == 1) return -1; /* job control wants its own process groups */
+	if (shell_find(*args)) return -1;      /* builtins run shell code */
+
+	int old_stdin = -1, old_stdout = -1, old_stderr = -1;
+	if (new_stdin  >= 0) { old_stdin  = dup(STDIN_FILENO);  dup2(new_stdin,  STDIN_FILENO);  }
+	if (new_stdout >= 0) { old_stdout = dup(STDOUT_FILENO); dup2(new_stdout, STDOUT_FILENO); }
+	if (new_stderr >= 0) { old_stderr = dup(STDERR_FILENO); dup2(new_stderr, STDERR_FILENO); }
+
+	pid_t ret = spawnvp(*args, args);
+
+	if (old_stdin  >= 0) { dup2(old_stdin,  STDIN_FILENO);  close(old_stdin);  }
+	if (old_stdout >= 0) { dup2(old_stdout, STDOUT_FILENO); close(old_stdout); }
+	if (old_stderr >= 0) { dup2(old_stderr, STDERR_FILENO); close(old_stderr); }
+
+	return ret;
+}
+
 int is_number(const char * c) {
 	while (*c) {
 		if (!isdigit(*c)) return 0;
@@ -1383,15 +1415,20 @@ _nope:
 		int last_output[2];
 		pipe(last_output);
 
-		child_pid = fork();
-		if (!child_pid) {
-			set_pgid(0);
-			if (!nowait) set_pgrp(getpid());
-			is_subshell = 1;
-			dup2(last_output[1], STDOUT_FILENO);
-			close(last_output[0]);
-			add_environment(extra_env);
-			run_cmd(arg_starts[0]);
+		pid_t spawned = extra_env->length ? -1 : try_spawn(arg_starts[0], -1, last_output[1], -1);
+		if (spawned > 0) {
+			child_pid = spawned;
+		} else {
+			child_pid = fork();
+			if (!child_pid) {
+				set_pgid(0);
+				if (!nowait) set_pgrp(getpid());
+				is_subshell = 1;
+				dup2(last_output[1], STDOUT_FILENO);
+				close(last_output[0]);
+				add_environment(extra_env);
+				run_cmd(arg_starts[0]);
+			}
 		}
 
 		pgid = child_pid;
@@ -1399,7 +1436,8 @@ _nope:
 		for (int j = 1; j < cmdi; ++j) {
 			int tmp_out[2];
 			pipe(tmp_out);
-			if (!fork()) {
+			spawned = extra_env->length ? -1 : try_spawn(arg_starts[j], last_output[0], tmp_out[1], -1);
+			if (spawned < 0 && !fork()) {
 				is_subshell = 1;
 				set_pgid(pgid);
 				dup2(tmp_out[1], STDOUT_FILENO);
@@ -1415,38 +1453,61 @@ _nope:
 			last_output[1] = tmp_out[1];
 		}
 
-		struct semaphore s = create_semaphore();
-		last_child = fork();
-		if (!last_child) {
-			is_subshell = 1;
-			set_pgid(pgid);
-			raise_semaphore(s);
+		spawned = -1;
+		if (!extra_env->length) {
+			int out_fd = -1, err_fd = -1, files_ok = 1;
 			if (output_files[cmdi]) {
-				int fd = open(output_files[cmdi], file_args[cmdi], 0666);
-				if (fd < 0) {
-					fprintf(stderr, "sh: %s: %s\n", output_files[cmdi], strerror(errno));
-					return -1;
-				} else {
-					dup2(fd, STDOUT_FILENO);
-				}
+				out_fd = open(output_files[cmdi], file_args[cmdi], 0666);
+				if (out_fd < 0) files_ok = 0;
 			}
-			if (err_files[cmdi]) {
-				int fd = open(err_files[cmdi], err_args[cmdi], 0666);
-				if (fd < 0) {
-					fprintf(stderr, "sh: %s: %s\n", err_files[cmdi], strerror(errno));
-					return -1;
-				} else {
-					dup2(fd, STDERR_FILENO);
+			if (files_ok && err_files[cmdi]) {
+				err_fd = open(err_files[cmdi], err_args[cmdi], 0666);
+				if (err_fd < 0) files_ok = 0;
+			}
+			if (files_ok) {
+				spawned = try_spawn(arg_starts[cmdi], last_output[0], out_fd, err_fd);
+			}
+			if (out_fd >= 0) close(out_fd);
+			if (err_fd >= 0) close(err_fd);
+		}
+		if (spawned > 0) {
+			last_child = spawned;
+			close(last_output[0]);
+			close(last_output[1]);
+		} else {
+			struct semaphore s = create_semaphore();
+			last_child = fork();
+			if (!last_child) {
+				is_subshell = 1;
+				set_pgid(pgid);
+				raise_semaphore(s);
+				if (output_files[cmdi]) {
+					int fd = open(output_files[cmdi], file_args[cmdi], 0666);
+					if (fd < 0) {
+						fprintf(stderr, "sh: %s: %s\n", output_files[cmdi], strerror(errno));
+						return -1;
+					} else {
+						dup2(fd, STDOUT_FILENO);
+					}
+				}
+				if (err_files[cmdi]) {
+					int fd = open(err_files[cmdi], err_args[cmdi], 0666);
+					if (fd < 0) {
+						fprintf(stderr, "sh: %s: %s\n", err_files[cmdi], strerror(errno));
+						return -1;
+					} else {
+						dup2(fd, STDERR_FILENO);
+					}
 				}
+				dup2(last_output[0], STDIN_FILENO);
+				close(last_output[1]);
+				add_environment(extra_env);
+				run_cmd(arg_starts[cmdi]);
 			}
-			dup2(last_output[0], STDIN_FILENO);
+			close(last_output[0]);
 			close(last_output[1]);
-			add_environment(extra_env);
-			run_cmd(arg_starts[cmdi]);
+			wait_semaphore(s);
 		}
-		close(last_output[0]);
-		close(last_output[1]);
-		wait_semaphore(s);
 
 		/* Now execute the last piece and wait on all of them */
 	} else {
@@ -1479,6 +1540,28 @@ _nope:
 			if (old_err != -1) dup2(old_err, STDERR_FILENO);
 			return result;
 		} else {
+			pid_t spawned = -1;
+			if (!extra_env->length) {
+				int out_fd = -1, err_fd = -1, files_ok = 1;
+				if (output_files[cmdi]) {
+					out_fd = open(output_files[cmdi], file_args[cmdi], 0666);
+					if (out_fd < 0) files_ok = 0;
+				}
+				if (files_ok && err_files[cmdi]) {
+					err_fd = open(err_files[cmdi], err_args[cmdi], 0666);
+					if (err_fd < 0) files_ok = 0;
+				}
+				if (files_ok) {
+					spawned = try_spawn(arg_starts[0], -1, out_fd, err_fd);
+				}
+				if (out_fd >= 0) close(out_fd);
+				if (err_fd >= 0) close(err_fd);
+			}
+			if (spawned > 0) {
+				pgid = spawned;
+				last_child = spawned;
+				goto _spawned;
+			}
 			struct semaphore s = create_semaphore();
 			child_pid = fork();
 			if (!child_pid) {
@@ -1512,6 +1595,8 @@ _nope:
 
 			pgid = child_pid;
 			last_child = child_pid;
+_spawned:
+			;
 		}
 	}
 
@@ -820,10 +820,75 @@ static void finish_syscall(pid_t pid, int syscall, struct regs * r) {
 	}
 }
 
+/**
+ * Binary record mode (-b).
+ *
+ * Instead of stopping the tracee at every syscall, the kernel logs
+ * packed records (PTRACE_RECORD) into a per-process ring that we
+ * drain here whenever we feel like it, so the target runs at nearly
+ * full speed. Decoding is raw by necessity - the tracee has long
+ * moved on, so pointer arguments can't be peeked.
+ */
+static void decode_record(struct ptrace_record * rec) {
+	if (rec->dropped) {
+		fprintf(logfile, "+++ %u records lost to a full ring +++\n", rec->dropped);
+	}
+	if (rec->syscall >= sizeof(syscall_mask)) return;
+	if (!syscall_mask[rec->syscall]) return;
+
+	const char * name = syscall_names[rec->syscall];
+	fprintf(logfile, "%14lu %s(0x%lx, 0x%lx, 0x%lx, 0x%lx, 0x%lx) = %ld\n",
+			rec->tsc, name ? name : "unknown",
+			rec->args[0], rec->args[1], rec->args[2], rec->args[3], rec->args[4],
+			rec->result);
+}
+
+static void drain_records(pid_t p) {
+	struct ptrace_record records[256];
+	long count;
+	while ((count = ptrace(PTRACE_READ_RECORDS, p, (void*)(uintptr_t)256, records)) > 0) {
+		for (long i = 0; i < count; ++i) {
+			decode_record(&records[i]);
+		}
+		if (count < 256) break;
+	}
+}
+
+static int record_loop(pid_t p) {
+	while (1) {
+		drain_records(p);
+
+		int status = 0;
+		pid_t res = waitpid(p, &status, WNOHANG);
+
+		if (res == p && WIFSTOPPED(status)) {
+			/* Signal delivery still stops the tracee; pass it along */
+			int sig = WSTOPSIG(status);
+			if (sig == SIGTRAP) {
+				ptrace(PTRACE_CONT, p, NULL, NULL);
+			} else {
+				fprintf(logfile, "--- %s ---\n", signal_names[sig]);
+				ptrace(PTRACE_CONT, p, NULL, (void*)(uintptr_t)sig);
+			}
+		} else if (res == p && WIFSIGNALED(status)) {
+			fprintf(logfile, "+++ killed by %s +++\n", signal_names[WTERMSIG(status)]);
+			return 0;
+		} else if (res == p && WIFEXITED(status)) {
+			fprintf(logfile, "+++ exited with %d +++\n", WEXITSTATUS(status));
+			return 0;
+		} else if (res < 0 && errno == ECHILD) {
+			return 0;
+		}
+
+		usleep(10000);
+	}
+}
+
 static int usage(char * argv[]) {
 #define T_I "\033[3m"
 #define T_O "\033[0m"
-	fprintf(stderr, "usage: %s [-o logfile] [-e trace=...] [-p PID] [command...]\n"
+	fprintf(stderr, "usage: %s [-b] [-o logfile] [-e trace=...] [-p PID] [command...]\n"
+			"  -b           " T_I "Log packed binary records without stopping the tracee." T_O "\n"
 			"  -o logfile   " T_I "Write tracing output to a file." T_O "\n"
 			"  -h           " T_I "Show this help text." T_O "\n"
 			"  -e trace=... " T_I "Set tracing options." T_O "\n"
@@ -836,9 +901,13 @@ int main(int argc, char * argv[]) {
 	logfile = stdout;
 
 	pid_t p = 0;
+	int binary_mode = 0;
 	int opt;
-	while ((opt = getopt(argc, argv, "ho:e:p:")) != -1) {
+	while ((opt = getopt(argc, argv, "bho:e:p:")) != -1) {
 		switch (opt) {
+			case 'b':
+				binary_mode = 1;
+				break;
 			case 'p':
 				p = atoi(optarg);
 				break;
@@ -983,12 +1052,33 @@ int main(int argc, char * argv[]) {
 		}
 		signal(SIGINT, SIG_IGN);
 	} else {
+		if (binary_mode) {
+			if (ptrace(PTRACE_RECORD, p, NULL, NULL) < 0) {
+				fprintf(stderr, "%s: ptrace: %s\n", argv[0], strerror(errno));
+				return 1;
+			}
+			return record_loop(p);
+		}
 		if (ptrace(PTRACE_ATTACH, p, NULL, NULL) < 0) {
 			fprintf(stderr, "%s: ptrace: %s\n", argv[0], strerror(errno));
 			return 1;
 		}
 	}
 
+	if (binary_mode) {
+		/* Wait for the TRACEME child to stop at its first syscall, switch
+		 * it to ring recording, and let it run free. */
+		int status = 0;
+		if (waitpid(p, &status, WSTOPPED) < 0 || !WIFSTOPPED(status)) {
+			fprintf(stderr, "%s: waitpid: %s\n", argv[0], strerror(errno));
+			return 1;
+		}
+		ptrace(PTRACE_RECORD, p, NULL, NULL);
+		ptrace(PTRACE_SIGNALS_ONLY_PLZ, p, NULL, NULL);
+		ptrace(PTRACE_CONT, p, NULL, NULL);
+		return record_loop(p);
+	}
+
 	int previous_syscall = -1;
 	while (1) {
 		int status = 0;
@@ -1315,8 +1315,8 @@ int main(int argc, char ** argv) {
 			maybe_flip_cursor();
 			if (res[0]) {
 				int r = read(fd_master, buf, BUF_SIZE);
-				for (int i = 0; i < r; ++i) {
-					ansi_put(ansi_state, buf[i]);
+				if (r > 0) {
+					ansi_write(ansi_state, (char *)buf, r);
 				}
 			}
 			if (res[1]) {
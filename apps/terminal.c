@@ -140,11 +140,12 @@ static unsigned long long mouse_ticks = 0;
 static yutani_window_t * window       = NULL; /* GUI window */
 static yutani_t * yctx = NULL;
 
-/* Window flip bounds */
-static int32_t l_x = INT32_MAX;
-static int32_t l_y = INT32_MAX;
-static int32_t r_x = -1;
-static int32_t r_y = -1;
+/* Window flip damage, kept as separate rectangles so scattered
+ * updates (a cursor blink plus a title change) don't flip one
+ * giant bounding box */
+#define TERM_DAMAGE_RECTS 8
+static struct yutani_damage_rect damage_rects[TERM_DAMAGE_RECTS];
+static uint32_t damage_count = 0;
 
 static uint32_t window_width  = 640;
 static uint32_t window_height = 480;
@@ -169,15 +170,45 @@ static int decor_bottom_height = 0;
 static int decor_width = 0;
 static int decor_height = 0;
 
+/*
+ * Scrollback lines are stored packed: a short header, a list of
+ * attribute runs, and the UTF-8 text of the line. A line of
+ * uniformly-attributed text packs to a small fraction of the
+ * equivalent cell array, which is what makes deep histories
+ * affordable; lines are unpacked on demand when the view scrolls
+ * back over them.
+ */
+struct sb_run {
+	uint16_t count;  /* cells covered by this run */
+	uint32_t flags;
+	uint32_t fg;
+	uint32_t bg;
+} __attribute__((packed));
+
 struct scrollback_row {
-	unsigned short width;
-	term_cell_t cells[];
+	unsigned short width;      /* cells packed in this line */
+	unsigned short run_count;  /* attribute runs in data[] */
+	unsigned int   text_bytes; /* UTF-8 text bytes after the runs */
+	unsigned char  data[];
 };
 
-#define MAX_SCROLLBACK 1000
+#define SB_ROW_RUNS(row) ((struct sb_run *)(row)->data)
+#define SB_ROW_TEXT(row) ((char *)(row)->data + (row)->run_count * sizeof(struct sb_run))
+
+#define MAX_SCROLLBACK 100000
 static list_t * scrollback_list = NULL;
 static int scrollback_offset = 0;
 
+/* Unpacked scrollback lines, kept in a small LRU so drawing the
+ * history view doesn't decode the same lines over and over */
+#define SB_CACHE_ROWS 128
+static struct {
+	struct scrollback_row * row;
+	term_cell_t * cells;
+	uint64_t used;
+} sb_cache[SB_CACHE_ROWS];
+static uint64_t sb_cache_tick = 0;
+
 /* Menu bar entries */
 struct menu_bar terminal_menu_bar = {0};
 struct menu_bar_entries terminal_menu_entries[] = {
@@ -206,13 +237,10 @@ static uint64_t get_ticks(void) {
 }
 
 static void display_flip(void) {
-	if (l_x != INT32_MAX && l_y != INT32_MAX) {
+	if (damage_count) {
 		flip(ctx);
-		yutani_flip_region(yctx, window, l_x, l_y, r_x - l_x, r_y - l_y);
-		l_x = INT32_MAX;
-		l_y = INT32_MAX;
-		r_x = -1;
-		r_y = -1;
+		yutani_flip_regions(yctx, window, damage_count, damage_rects);
+		damage_count = 0;
 	}
 }
 
@@ -226,6 +254,53 @@ static int32_t max(int32_t a, int32_t b) {
 	return (a > b) ? a : b;
 }
 
+/* Record a damaged region for the next display_flip, coalescing
+ * into an existing rectangle whenever the union wastes no pixels */
+static void damage_add(int32_t x, int32_t y, int32_t width, int32_t height) {
+	for (uint32_t i = 0; i < damage_count; ++i) {
+		struct yutani_damage_rect * r = &damage_rects[i];
+		int32_t ux = min(r->x, x);
+		int32_t uy = min(r->y, y);
+		int32_t uw = max(r->x + r->width,  x + width)  - ux;
+		int32_t uh = max(r->y + r->height, y + height) - uy;
+		if ((int64_t)uw * uh <= (int64_t)r->width * r->height + (int64_t)width * height) {
+			r->x = ux;
+			r->y = uy;
+			r->width = uw;
+			r->height = uh;
+			return;
+		}
+	}
+	if (damage_count < TERM_DAMAGE_RECTS) {
+		struct yutani_damage_rect * r = &damage_rects[damage_count++];
+		r->x = x;
+		r->y = y;
+		r->width = width;
+		r->height = height;
+		return;
+	}
+	/* Out of slots; grow whichever rectangle grows the least */
+	uint32_t best = 0;
+	int64_t best_growth = INT64_MAX;
+	for (uint32_t i = 0; i < damage_count; ++i) {
+		struct yutani_damage_rect * r = &damage_rects[i];
+		int64_t grown = (int64_t)(max(r->x + r->width,  x + width)  - min(r->x, x)) *
+		                (int64_t)(max(r->y + r->height, y + height) - min(r->y, y));
+		int64_t growth = grown - (int64_t)r->width * r->height;
+		if (growth < best_growth) {
+			best_growth = growth;
+			best = i;
+		}
+	}
+	struct yutani_damage_rect * r = &damage_rects[best];
+	int32_t ux = min(r->x, x);
+	int32_t uy = min(r->y, y);
+	r->width  = max(r->x + r->width,  x + width)  - ux;
+	r->height = max(r->y + r->height, y + height) - uy;
+	r->x = ux;
+	r->y = uy;
+}
+
 /*
  * Convert codepoint to UTF-8
  *
@@ -266,6 +341,65 @@ static int to_eight(uint32_t codepoint, char * out) {
 	return strlen(out);
 }
 
+/* Unpack a scrollback row back into an array of cells. */
+static void scrollback_row_unpack(struct scrollback_row * row, term_cell_t * cells) {
+	char * text = SB_ROW_TEXT(row);
+	uint32_t state = 0;
+	uint32_t codepoint = 0;
+	unsigned int t = 0;
+	int cell = 0;
+	for (unsigned int i = 0; i < row->run_count; ++i) {
+		struct sb_run * run = &SB_ROW_RUNS(row)[i];
+		for (unsigned int j = 0; j < run->count && cell < row->width; ++j, ++cell) {
+			uint32_t c = 0;
+			while (t < row->text_bytes) {
+				uint32_t res = decode(&state, &codepoint, (unsigned char)text[t++]);
+				if (res == UTF8_ACCEPT) {
+					c = codepoint;
+					break;
+				} else if (res == UTF8_REJECT) {
+					state = 0;
+				}
+			}
+			cells[cell].c = c;
+			cells[cell].flags = run->flags;
+			cells[cell].fg = run->fg;
+			cells[cell].bg = run->bg;
+		}
+	}
+}
+
+/* Get the cells of a scrollback row, unpacking through the LRU cache. */
+static term_cell_t * scrollback_row_cells(struct scrollback_row * row) {
+	int lru = 0;
+	for (int i = 0; i < SB_CACHE_ROWS; ++i) {
+		if (sb_cache[i].row == row) {
+			sb_cache[i].used = ++sb_cache_tick;
+			return sb_cache[i].cells;
+		}
+		if (sb_cache[i].used < sb_cache[lru].used) lru = i;
+	}
+	free(sb_cache[lru].cells);
+	sb_cache[lru].cells = calloc(row->width ? row->width : 1, sizeof(term_cell_t));
+	sb_cache[lru].row = row;
+	sb_cache[lru].used = ++sb_cache_tick;
+	scrollback_row_unpack(row, sb_cache[lru].cells);
+	return sb_cache[lru].cells;
+}
+
+/* Free a scrollback row, dropping any cached unpacked copy. */
+static void scrollback_row_free(struct scrollback_row * row) {
+	for (int i = 0; i < SB_CACHE_ROWS; ++i) {
+		if (sb_cache[i].row == row) {
+			free(sb_cache[i].cells);
+			sb_cache[i].row = NULL;
+			sb_cache[i].cells = NULL;
+			sb_cache[i].used = 0;
+		}
+	}
+	free(row);
+}
+
 /* Set the terminal title string */
 static void set_title(char * c) {
 	int len = min(TERMINAL_TITLE_SIZE, strlen(c)+1);
@@ -335,7 +469,7 @@ static term_cell_t * cell_at(uint16_t x, uint16_t _y) {
 		if (node) {
 			struct scrollback_row * row = (struct scrollback_row *)node->value;
 			if (row && x < row->width) {
-				return &row->cells[x];
+				return &scrollback_row_cells(row)[x];
 			}
 		}
 	}
@@ -399,7 +533,7 @@ static void count_selection(uint16_t x, uint16_t _y) {
 		if (node) {
 			struct scrollback_row * row = (struct scrollback_row *)node->value;
 			if (row && x < row->width) {
-				term_cell_t * cell = &row->cells[x];
+				term_cell_t * cell = &scrollback_row_cells(row)[x];
 				if (cell && ((uint32_t *)cell)[0] != 0x00000000) {
 					char tmp[7];
 					_selection_count += to_eight(cell->c, tmp);
@@ -437,7 +571,7 @@ void write_selection(uint16_t x, uint16_t _y) {
 		if (node) {
 			struct scrollback_row * row = (struct scrollback_row *)node->value;
 			if (row && x < row->width) {
-				term_cell_t * cell = &row->cells[x];
+				term_cell_t * cell = &scrollback_row_cells(row)[x];
 				if (cell && ((uint32_t *)cell)[0] != 0x00000000 && cell->c != 0xFFFF) {
 					char tmp[7];
 					int count = to_eight(cell->c, tmp);
@@ -566,9 +700,7 @@ static void render_decors(void) {
 	 * We do this regardless of whether we drew decorations to catch
 	 * a case where decorations are toggled.
 	 */
-	l_x = 0; l_y = 0;
-	r_x = window->width;
-	r_y = window->height;
+	damage_add(0, 0, window->width, window->height);
 	display_flip();
 }
 
@@ -739,16 +871,11 @@ _extra_stuff:
 		}
 	}
 
-	/* Calculate the bounds of the updated region of the window */
-	l_x = min(l_x, decor_left_width + x);
-	l_y = min(l_y, decor_top_height+menu_bar_height + y);
-
+	/* Record the updated region of the window */
 	if (flags & ANSI_WIDE) {
-		r_x = max(r_x, decor_left_width + x + char_width * 2);
-		r_y = max(r_y, decor_top_height+menu_bar_height + y + char_height * 2);
+		damage_add(decor_left_width + x, decor_top_height+menu_bar_height + y, char_width * 2, char_height * 2);
 	} else {
-		r_x = max(r_x, decor_left_width + x + char_width);
-		r_y = max(r_y, decor_top_height+menu_bar_height + y + char_height);
+		damage_add(decor_left_width + x, decor_top_height+menu_bar_height + y, char_width, char_height);
 	}
 }
 
@@ -836,10 +963,7 @@ static void redraw_cell_image(uint16_t x, uint16_t y, term_cell_t * cell, int in
 	}
 
 	/* Update bounds */
-	l_x = min(l_x, decor_left_width + x * char_width);
-	l_y = min(l_y, decor_top_height+menu_bar_height + y * char_height);
-	r_x = max(r_x, decor_left_width + x * char_width + char_width);
-	r_y = max(r_y, decor_top_height+menu_bar_height + y * char_height + char_height);
+	damage_add(decor_left_width + x * char_width, decor_top_height+menu_bar_height + y * char_height, char_width, char_height);
 }
 
 static void maybe_flip_display(int force) {
@@ -887,7 +1011,7 @@ static void cell_redraw_offset(uint16_t x, uint16_t _y) {
 		if (node) {
 			struct scrollback_row * row = (struct scrollback_row *)node->value;
 			if (row && x < row->width) {
-				term_mirror_copy(x,i,&row->cells[x]);
+				term_mirror_copy(x,i,&scrollback_row_cells(row)[x]);
 			} else {
 				term_mirror_set(x,i,' ',TERM_DEFAULT_FG, TERM_DEFAULT_BG, TERM_DEFAULT_FLAGS);
 			}
@@ -912,7 +1036,7 @@ static void cell_redraw_offset_inverted(uint16_t x, uint16_t _y) {
 		if (node) {
 			struct scrollback_row * row = (struct scrollback_row *)node->value;
 			if (row && x < row->width) {
-				term_mirror_copy_inverted(x,i,&row->cells[x]);
+				term_mirror_copy_inverted(x,i,&scrollback_row_cells(row)[x]);
 			} else {
 				term_mirror_set(x, i, ' ', TERM_DEFAULT_BG, TERM_DEFAULT_FG, TERM_DEFAULT_FLAGS|ANSI_SPECBG);
 			}
@@ -998,14 +1122,14 @@ static void flush_unused_images(void) {
 
 	list_t * tmp = list_create();
 
-	/* Go through scrollback, too */
+	/* Go through scrollback, too; image pointers live in the run attributes */
 	if (scrollback_list) {
 		foreach(node, scrollback_list) {
 			struct scrollback_row * row = (struct scrollback_row *)node->value;
-			for (unsigned int x = 0; x < row->width; ++x) {
-				term_cell_t * cell = &row->cells[x];
-				if (cell->flags & ANSI_EXT_IMG) {
-					uint32_t * data = (uint32_t *)((uintptr_t)cell->bg << 32 | cell->fg);
+			struct sb_run * runs = SB_ROW_RUNS(row);
+			for (unsigned int i = 0; i < row->run_count; ++i) {
+				if (runs[i].flags & ANSI_EXT_IMG) {
+					uint32_t * data = (uint32_t *)((uintptr_t)runs[i].bg << 32 | runs[i].fg);
 					list_insert(tmp, data);
 				}
 			}
@@ -1069,11 +1193,33 @@ static void term_shift_region(int top, int height, int how_much) {
 	if (count) {
 		memmove(term_buffer + destination, term_buffer + source, count * term_width * sizeof(term_cell_t));
 		memmove(term_mirror + destination, term_mirror + source, count * term_width * sizeof(term_cell_t));
+
+		/*
+		 * Shift the painted pixels and the display mirror along with the
+		 * cells, so the diff pass in maybe_flip_display only has to
+		 * rasterize the newly exposed lines instead of the whole region.
+		 */
+		memmove(term_display + destination, term_display + source, count * term_width * sizeof(term_cell_t));
+
+		int ox = decor_left_width;
+		int oy = decor_top_height + menu_bar_height;
+		int dst_y = oy + (destination / term_width) * char_height;
+		int src_y = oy + (source / term_width) * char_height;
+		int px_rows = count * char_height;
+		size_t row_bytes = term_width * char_width * sizeof(uint32_t);
+		if (dst_y < src_y) {
+			for (int i = 0; i < px_rows; ++i) {
+				memmove(&GFX(ctx, ox, dst_y + i), &GFX(ctx, ox, src_y + i), row_bytes);
+			}
+		} else {
+			for (int i = px_rows - 1; i >= 0; --i) {
+				memmove(&GFX(ctx, ox, dst_y + i), &GFX(ctx, ox, src_y + i), row_bytes);
+			}
+		}
 	}
 
-	l_x = 0; l_y = 0;
-	r_x = window->width;
-	r_y = window->height;
+	damage_add(decor_left_width, decor_top_height + menu_bar_height + top * char_height,
+		term_width * char_width, height * char_height);
 
 	/* Clear new lines at bottom */
 	for (int i = new_top; i < new_bottom; ++i) {
@@ -1091,9 +1237,6 @@ static void term_scroll(int how_much) {
 
 	/* Remove image data for image cells that are no longer on screen. */
 	flush_unused_images();
-
-	/* Flip the entire window. */
-	yutani_flip(yctx, window);
 }
 
 static void insert_delete_lines(int how_many) {
@@ -1113,25 +1256,69 @@ static int is_wide(uint32_t codepoint) {
 	return wcwidth(codepoint) == 2;
 }
 
-/* Save the row that is about to be scrolled offscreen into the scrollback buffer. */
+/* Does cell i of a line start a new attribute run? */
+static int sb_new_run(term_cell_t * cells, int i) {
+	if (i == 0) return 1;
+	/* Image cells carry unique pointers, so they always get their own run */
+	if (cells[i].flags & ANSI_EXT_IMG) return 1;
+	return cells[i].flags != cells[i-1].flags ||
+	       cells[i].fg    != cells[i-1].fg ||
+	       cells[i].bg    != cells[i-1].bg;
+}
+
+/* Save the row that is about to be scrolled offscreen into the scrollback buffer, packed. */
 static void save_scrollback(void) {
 
 	/* If the scrollback is already full, remove the oldest element. */
-	struct scrollback_row * row = NULL;
 	node_t * n = NULL;
 
 	if (scrollback_list->length == MAX_SCROLLBACK) {
 		n = list_dequeue(scrollback_list);
-		row = n->value;
-		if (row->width < term_width) {
-			free(row);
-			row = NULL;
-		}
+		scrollback_row_free(n->value);
+	}
+
+	/* Trim trailing cells that were never written */
+	int width = term_width;
+	while (width > 0) {
+		term_cell_t * cell = &term_buffer[width - 1];
+		if (cell->c || cell->fg || cell->bg || cell->flags) break;
+		width--;
 	}
 
-	if (!row) {
-		row = malloc(sizeof(struct scrollback_row) + sizeof(term_cell_t) * term_width);
-		row->width = term_width;
+	/* Size the packed row: one run per attribute change, plus the text */
+	int runs = 0;
+	unsigned int text_bytes = 0;
+	char tmp[7];
+	for (int i = 0; i < width; ++i) {
+		if (sb_new_run(term_buffer, i)) runs++;
+		text_bytes += term_buffer[i].c ? to_eight(term_buffer[i].c, tmp) : 1;
+	}
+
+	struct scrollback_row * row = malloc(sizeof(struct scrollback_row) + runs * sizeof(struct sb_run) + text_bytes);
+	row->width = width;
+	row->run_count = runs;
+	row->text_bytes = text_bytes;
+
+	char * text = SB_ROW_TEXT(row);
+	unsigned int t = 0;
+	int r = -1;
+	for (int i = 0; i < width; ++i) {
+		term_cell_t * cell = &term_buffer[i];
+		if (sb_new_run(term_buffer, i)) {
+			r++;
+			SB_ROW_RUNS(row)[r].count = 0;
+			SB_ROW_RUNS(row)[r].flags = cell->flags;
+			SB_ROW_RUNS(row)[r].fg = cell->fg;
+			SB_ROW_RUNS(row)[r].bg = cell->bg;
+		}
+		SB_ROW_RUNS(row)[r].count++;
+		if (cell->c) {
+			int len = to_eight(cell->c, tmp);
+			memcpy(&text[t], tmp, len);
+			t += len;
+		} else {
+			text[t++] = 0;
+		}
 	}
 
 	if (!n) {
@@ -1140,11 +1327,6 @@ static void save_scrollback(void) {
 		n->value = row;
 		list_append(scrollback_list, n);
 	}
-
-	for (int i = 0; i < term_width; ++i) {
-		term_cell_t * cell = &term_buffer[i];
-		memcpy(&row->cells[i], cell, sizeof(term_cell_t));
-	}
 }
 
 /* Draw the scrollback. */
@@ -1174,8 +1356,9 @@ static void redraw_scrollback(void) {
 					term_mirror_set(x, y, ' ', TERM_DEFAULT_FG, TERM_DEFAULT_BG, TERM_DEFAULT_FLAGS);
 				}
 			}
+			term_cell_t * cells = scrollback_row_cells(row);
 			for (int x = 0; x < width; ++x) {
-				term_mirror_copy(x,y,&row->cells[x]);
+				term_mirror_copy(x,y,&cells[x]);
 			}
 
 			node = node->prev;
@@ -1197,8 +1380,9 @@ static void redraw_scrollback(void) {
 					term_mirror_set(x, y, ' ', TERM_DEFAULT_FG, TERM_DEFAULT_BG, TERM_DEFAULT_FLAGS);
 				}
 			}
+			term_cell_t * cells = scrollback_row_cells(row);
 			for (int x = 0; x < width; ++x) {
-				term_mirror_copy(x,y,&row->cells[x]);
+				term_mirror_copy(x,y,&cells[x]);
 			}
 
 			node = node->prev;
@@ -1211,10 +1395,10 @@ static void redraw_scrollback(void) {
  * Parses some things (\n\r, etc.) itself that should probably
  * be moved into the ANSI library.
  */
-static void term_write(char c) {
-	static uint32_t unicode_state = 0;
-	static uint32_t codepoint = 0;
+static uint32_t unicode_state = 0;
+static uint32_t codepoint = 0;
 
+static void term_write(char c) {
 	cell_redraw(csr_x, csr_y);
 
 	if (!decode(&unicode_state, &codepoint, (uint8_t)c)) {
@@ -1284,6 +1468,38 @@ static void term_write(char c) {
 	draw_cursor();
 }
 
+/* ANSI callback for writing whole runs of plain bytes */
+static void term_write_run(const char * buf, size_t len) {
+	size_t i = 0;
+	while (i < len) {
+		/*
+		 * Fast path: a run of printable ASCII that fits on the current
+		 * line becomes a row of cell writes with one cursor redraw,
+		 * skipping the per-character wrap and control checks.
+		 */
+		if (unicode_state == 0 && csr_x >= 0 && csr_y >= 0 &&
+			csr_x < term_width && csr_y < term_height) {
+			size_t limit = term_width - csr_x;
+			size_t run = 0;
+			while (run < len - i && run < limit &&
+				(unsigned char)buf[i+run] >= 0x20 && (unsigned char)buf[i+run] < 0x7F) run++;
+			if (run) {
+				cell_redraw(csr_x, csr_y); /* un-draw the cursor cell */
+				uint8_t flags = ansi_state->flags;
+				for (size_t j = 0; j < run; ++j) {
+					cell_set(csr_x, csr_y, (uint32_t)(unsigned char)buf[i+j], current_fg, current_bg, flags);
+					cell_redraw(csr_x, csr_y);
+					csr_x++;
+				}
+				draw_cursor();
+				i += run;
+				continue;
+			}
+		}
+		term_write(buf[i++]);
+	}
+}
+
 /* ANSI callback to set cursor position */
 static void term_set_csr(int x, int y) {
 	cell_redraw(csr_x,csr_y);
@@ -1386,7 +1602,7 @@ static void term_clear(int i) {
 		if (scrollback_list) {
 			while (scrollback_list->length) {
 				node_t * n = list_dequeue(scrollback_list);
-				free(n->value);
+				scrollback_row_free(n->value);
 				free(n);
 			}
 			scrollback_offset = 0;
@@ -1433,6 +1649,7 @@ term_callbacks_t term_callbacks = {
 	term_set_csr_show,
 	term_switch_buffer,
 	insert_delete_lines,
+	term_write_run,
 };
 
 static void handle_input(char c) {
@@ -2515,8 +2732,8 @@ int main(int argc, char ** argv) {
 			if (res[1]) {
 				/* Read from PTY */
 				ssize_t r = read(fd_master, buf, 4096);
-				for (ssize_t i = 0; i < r; ++i) {
-					ansi_put(ansi_state, buf[i]);
+				if (r > 0) {
+					ansi_write(ansi_state, (char *)buf, r);
 				}
 				next_wait = 10;
 			} else {
@@ -12,7 +12,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <dirent.h>
 #include <pwd.h>
 #include <termios.h>
 #include <poll.h>
@@ -22,11 +21,10 @@
 #include <sys/time.h>
 
 #include <sys/sysfunc.h>
+#include <sys/procfs.h>
 #include <toaru/list.h>
 #include <toaru/hashmap.h>
 
-#define LINE_LEN 4096
-
 enum header_columns {
 	COLUMN_NONE,
 	COLUMN_PID,
@@ -238,65 +236,24 @@ struct process * process_from_pid(pid_t pid) {
 }
 
 /**
- * @brief Collect information for a process from its procfs entry.
+ * @brief Collect information for a process from its snapshot record.
  *
- * @p dent Directory entry from calling readdir on /proc.
- * @returns Process information that must be freed by the caller.
+ * @p st One record from the /proc/procs snapshot.
+ * @returns Process information that must be freed by the caller,
+ *          or NULL for records describing non-main threads.
  */
-struct process * process_entry(struct dirent *dent) {
+struct process * process_entry(struct procfs_stat * st) {
 	char tmp[300];
 	FILE * f;
-	char line[LINE_LEN];
-
-	int pid = 0, uid = 0, tgid = 0, mem = 0, shm = 0, vsz = 0, cpu = 0, cpua = 0;
-	char name[100];
-
-	sprintf(tmp, "/proc/%s/status", dent->d_name);
-	f = fopen(tmp, "r");
-
-	if (!f) {
-		return NULL;
-	}
 
-	line[0] = 0;
-
-	while (fgets(line, LINE_LEN, f) != NULL) {
-		char * n = strstr(line,"\n");
-		if (n) { *n = '\0'; }
-		char * tab = strstr(line,"\t");
-		if (tab) {
-			*tab = '\0';
-			tab++;
-		}
-		if (strstr(line, "Pid:") == line) {
-			pid = atoi(tab);
-		} else if (strstr(line, "Uid:") == line) {
-			uid = atoi(tab);
-		} else if (strstr(line, "Tgid:") == line) {
-			tgid = atoi(tab);
-		} else if (strstr(line, "Name:") == line) {
-			strcpy(name, tab);
-		} else if (strstr(line, "VmSize:") == line) {
-			vsz = atoi(tab);
-		} else if (strstr(line, "RssShmem:") == line) {
-			shm = atoi(tab);
-		} else if (strstr(line, "MemPermille:") == line) {
-			mem = atoi(tab);
-		} else if (strstr(line, "CpuPermille:") == line) {
-			cpu = strtoul(tab, &tab, 10);
-			cpua = cpu;
-			cpua += strtoul(tab, &tab, 10);
-			cpua += strtoul(tab, &tab, 10);
-			cpua += strtoul(tab, &tab, 10);
-			cpua /= 4;
-		}
-	}
-
-	fclose(f);
+	/* The kernel tracks usage windows for us; the newest is current
+	 * CPU usage, the average of all four is sustained usage. */
+	int cpu  = st->usage[0];
+	int cpua = (st->usage[0] + st->usage[1] + st->usage[2] + st->usage[3]) / 4;
 
-	if (tgid != pid) {
+	if (st->tgid != st->pid) {
 		/* Add this thread's CPU usage to the parent */
-		struct process * parent = process_from_pid(tgid);
+		struct process * parent = process_from_pid(st->tgid);
 		if (parent) {
 			parent->cpu += cpu;
 			parent->cpua += cpua;
@@ -305,41 +262,77 @@ struct process * process_entry(struct dirent *dent) {
 	}
 
 	struct process * out = malloc(sizeof(struct process));
-	out->uid = uid;
-	out->pid = tgid;
-	out->tid = pid;
-	out->mem = mem;
-	out->shm = shm;
-	out->vsz = vsz;
+	out->uid = st->uid;
+	out->pid = st->tgid;
+	out->tid = st->pid;
+	out->mem = st->mem_permille;
+	out->shm = st->rss_shmem;
+	out->vsz = st->vm_size;
 	out->cpu = cpu;
 	out->cpua = cpua;
-	out->process = strdup(name);
+	out->process = strdup(st->name);
 	out->command_line = NULL;
 	out->user = format_username(out->uid);
 
-	hashmap_set(process_ents, (void*)(uintptr_t)pid, out);
+	hashmap_set(process_ents, (void*)(uintptr_t)out->pid, out);
 
-	sprintf(tmp, "/proc/%s/cmdline", dent->d_name);
+	sprintf(tmp, "/proc/%d/cmdline", out->pid);
 	f = fopen(tmp, "r");
-	char foo[1024];
-	int s = fread(foo, 1, 1024, f);
-	if (s > 0) {
-		out->command_line = malloc(s + 1);
-		memset(out->command_line, 0, s + 1);
-		memcpy(out->command_line, foo, s);
-		for (int i = 0; i < s; ++i) {
-			if (out->command_line[i] == 30) {
-				out->command_line[i] = ' ';
+	if (f) {
+		char foo[1024];
+		int s = fread(foo, 1, 1024, f);
+		if (s > 0) {
+			out->command_line = malloc(s + 1);
+			memset(out->command_line, 0, s + 1);
+			memcpy(out->command_line, foo, s);
+			for (int i = 0; i < s; ++i) {
+				if (out->command_line[i] == 30) {
+					out->command_line[i] = ' ';
+				}
 			}
 		}
+		fclose(f);
 	}
-	fclose(f);
 
 	update_column_widths(out);
 
 	return out;
 }
 
+/**
+ * @brief Read the whole process table in one call from /proc/procs.
+ *
+ * Each read call produces a fresh snapshot truncated to fit the buffer,
+ * so if the buffer came back full it may have been too small - grow it
+ * and take a new snapshot until one fits with room to spare.
+ *
+ * @p count (out) Number of records in the returned snapshot.
+ * @returns Record array to be freed by the caller, or NULL on failure.
+ */
+static struct procfs_stat * read_process_snapshot(size_t * count) {
+	size_t capacity = 64;
+	struct procfs_stat * table = NULL;
+
+	while (1) {
+		table = realloc(table, capacity * sizeof(struct procfs_stat));
+		int fd = open("/proc/procs", O_RDONLY);
+		if (fd < 0) break;
+		ssize_t bytes = read(fd, table, capacity * sizeof(struct procfs_stat));
+		close(fd);
+		if (bytes < 0) break;
+		if ((size_t)bytes < capacity * sizeof(struct procfs_stat)) {
+			*count = bytes / sizeof(struct procfs_stat);
+			if (*count && table->version != PROCFS_STAT_VERSION) break;
+			return table;
+		}
+		capacity *= 2;
+	}
+
+	free(table);
+	*count = 0;
+	return NULL;
+}
+
 /**
  * @brief Sort an array of process struct pointers using the
  *        currently selected sort column.
@@ -521,20 +514,16 @@ static int do_once(void) {
 	list_t * ents_list = list_create();
 	process_ents = hashmap_create_int(10);
 
-	/* Scan /proc entries */
-	DIR * dirp = opendir("/proc");
-	struct dirent * dent = readdir(dirp);
-	while (dent != NULL) {
-		if (dent->d_name[0] >= '0' && dent->d_name[0] <= '9') {
-			struct process * p = process_entry(dent);
-			if (p) {
-				list_insert(ents_list, (void *)p);
-			}
+	/* Take one snapshot of the whole process table */
+	size_t record_count = 0;
+	struct procfs_stat * snapshot = read_process_snapshot(&record_count);
+	for (size_t r = 0; r < record_count; ++r) {
+		struct process * p = process_entry(&snapshot[r]);
+		if (p) {
+			list_insert(ents_list, (void *)p);
 		}
-
-		dent = readdir(dirp);
 	}
-	closedir(dirp);
+	free(snapshot);
 
 	/* Turn list into an array */
 	size_t count = ents_list->length;
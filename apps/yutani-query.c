@@ -13,6 +13,8 @@
  * Copyright (C) 2015-2018 K. Lange
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <toaru/yutani.h>
@@ -28,6 +30,7 @@ void show_usage(int argc, char * argv[]) {
 			"\n"
 			" -r     \033[3mprint display resoluton\033[0m\n"
 			" -e     \033[3mask compositor to reload extensions\033[0m\n"
+			" -f     \033[3mprint compositor frame statistics\033[0m\n"
 			" -?     \033[3mshow this help text\033[0m\n"
 			"\n", argv[0]);
 }
@@ -50,10 +53,37 @@ int reload(void) {
 	return 0;
 }
 
+int show_frame_stats(void) {
+	if (!yctx) {
+		if (!quiet) printf("(not connected)\n");
+		return 1;
+	}
+	yutani_query_frame_stats(yctx);
+	while (1) {
+		yutani_msg_t * m = yutani_poll(yctx);
+		if (!m) return 1;
+		if (m->type == YUTANI_MSG_FRAME_STATS) {
+			struct yutani_msg_frame_stats * fs = (void *)m->data;
+			printf("Frames composited: %u\n", fs->frames);
+			printf("Last frame: %uus, %upx damaged, %u tiles, %u window blits\n",
+				fs->last_frame_us, fs->last_damage, fs->last_tiles, fs->last_windows);
+			uint32_t samples = fs->frames < YUTANI_FRAME_STATS_COUNT ? fs->frames : YUTANI_FRAME_STATS_COUNT;
+			printf("Recent frame times (us):");
+			for (uint32_t i = YUTANI_FRAME_STATS_COUNT - samples; i < YUTANI_FRAME_STATS_COUNT; ++i) {
+				printf(" %u", fs->frame_us[i]);
+			}
+			printf("\n");
+			free(m);
+			return 0;
+		}
+		free(m);
+	}
+}
+
 int main(int argc, char * argv[]) {
 	yctx = yutani_init();
 	int opt;
-	while ((opt = getopt(argc, argv, "?qre")) != -1) {
+	while ((opt = getopt(argc, argv, "?qref")) != -1) {
 		switch (opt) {
 			case 'q':
 				quiet = 1;
@@ -64,6 +94,8 @@ int main(int argc, char * argv[]) {
 				return show_resolution();
 			case 'e':
 				return reload();
+			case 'f':
+				return show_frame_stats();
 
 			case '?':
 				show_usage(argc,argv);
@@ -76,6 +108,8 @@ int main(int argc, char * argv[]) {
 			return show_resolution();
 		} else if (!strcmp(argv[optind], "reload")) {
 			return reload();
+		} else if (!strcmp(argv[optind], "frames")) {
+			return show_frame_stats();
 		} else {
 			fprintf(stderr, "%s: unsupported command: %s\n", argv[0], argv[optind]);
 			return 1;
@@ -0,0 +1,4 @@
+#!/bin/sh
+
+echo -n "Building linker cache..." > /dev/pex/splash
+ldconfig
@@ -1,4 +1,5 @@
 #!/bin/sh
+#:needs modprobe
 
 if kcmdline -q no-startup-dhcp then exit 0
 
@@ -1,4 +1,5 @@
 #!/bin/sh
+#:needs dhcp
 
 if kcmdline -q no-startup-msk then exit 0
 
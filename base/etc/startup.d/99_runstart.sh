@@ -1,4 +1,5 @@
 #!/bin/sh
+#:needs ldconfig
 
 export-cmd START kcmdline -g start
 
@@ -10,9 +10,14 @@ typedef struct dirent {
 	char d_name[256];
 } dirent;
 
+#define _DIRENT_BATCH 32
+
 typedef struct DIR {
 	int fd;
 	int cur_entry;
+	int buf_count;
+	int buf_index;
+	struct dirent buf[_DIRENT_BATCH];
 } DIR;
 
 DIR * opendir (const char * dirname);
@@ -22,19 +22,30 @@ uintptr_t mmu_first_n_frames(int n);
 uintptr_t mmu_first_frame(void);
 void mmu_frame_allocate(union PML * page, unsigned int flags);
 void mmu_frame_map_address(union PML * page, unsigned int flags, uintptr_t physAddr);
+void mmu_frame_map_zero(union PML * page);
+uintptr_t mmu_get_zero_frame(void);
+void mmu_frame_mark_shared(uintptr_t frame);
+void mmu_frame_map_cow(union PML * page, uintptr_t frame);
+void mmu_frame_map_shared_ro(union PML * page, uintptr_t frame);
+void mmu_unmap_user(uintptr_t addr, size_t size);
 void mmu_frame_free(union PML * page);
 uintptr_t mmu_map_to_physical(union PML * root, uintptr_t virtAddr);
 union PML * mmu_get_page(uintptr_t virtAddr, int flags);
+int mmu_map_large_page(uintptr_t virtAddr, uintptr_t physAddr, int flags);
 void mmu_set_directory(union PML * new_pml);
 void mmu_free(union PML * from);
 union PML * mmu_clone(union PML * from);
 void mmu_init(size_t memsize, uintptr_t firstFreePage);
 void mmu_invalidate(uintptr_t addr);
+void mmu_invalidate_batch_add(uintptr_t addr);
+void mmu_invalidate_batch_flush(void);
+void mmu_enable_pcid(void);
 uintptr_t mmu_allocate_a_frame(void);
 uintptr_t mmu_allocate_n_frames(int n);
 union PML * mmu_get_kernel_directory(void);
 void * mmu_map_from_physical(uintptr_t frameaddress);
 void * mmu_map_mmio_region(uintptr_t physical_address, size_t size);
+void * mmu_map_wc_region(uintptr_t physical_address, size_t size);
 void * mmu_map_module(size_t size);
 void mmu_unmap_module(uintptr_t base_address, size_t size);
 
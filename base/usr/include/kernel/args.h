@@ -1,6 +1,11 @@
 #pragma once
 
+#include <stddef.h>
+
 int args_present(const char * karg);
 char * args_value(const char * karg);
+long args_value_int(const char * karg, long def);
+size_t args_value_size(const char * karg, size_t def);
+int args_flag(const char * karg);
 void args_parse(const char * arg);
 
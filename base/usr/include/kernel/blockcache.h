@@ -0,0 +1,9 @@
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/vfs.h>
+
+extern ssize_t blockcache_read(fs_node_t * device, off_t offset, size_t size, uint8_t * buffer);
+extern ssize_t blockcache_write(fs_node_t * device, off_t offset, size_t size, uint8_t * buffer);
+extern void blockcache_sync(void);
+extern size_t blockcache_block_count(void);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/vfs.h>
+#include <kernel/list.h>
+
+/**
+ * One asynchronous block I/O request.
+ *
+ * The caller fills in the device, direction, range, and buffer, then
+ * hands the request to blockio_submit(). Completion is reported one of
+ * two ways - pick exactly one per request:
+ *
+ *  - a @c callback, which runs on the device's queue worker once the
+ *    transfer finishes and owns the request from that point on, or
+ *  - blockio_wait(), which sleeps until the transfer finishes and
+ *    returns its result.
+ *
+ * The request must stay allocated until it completes; the queue links
+ * it through the embedded node.
+ */
+struct blockio_request {
+	fs_node_t * device;
+	int write;            /* 0 = read, 1 = write */
+	off_t offset;
+	size_t size;
+	uint8_t * buffer;
+
+	void (*callback)(struct blockio_request * req); /* or NULL to use blockio_wait */
+	void * argp;          /* for the callback's use */
+
+	ssize_t result;       /* read_fs/write_fs return value */
+	volatile int done;
+	uint64_t deadline;    /* Issue count at which the elevator must take this */
+
+	struct blockio_queue * queue;
+	node_t node;
+};
+
+extern void blockio_submit(struct blockio_request * req);
+extern ssize_t blockio_wait(struct blockio_request * req);
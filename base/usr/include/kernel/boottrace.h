@@ -0,0 +1,10 @@
+#pragma once
+/**
+ * @brief Boot-time event timeline.
+ */
+
+#include <sys/types.h>
+#include <kernel/vfs.h>
+
+extern void boot_trace_event(const char * fmt, ...);
+extern ssize_t boottrace_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer);
@@ -0,0 +1,45 @@
+#pragma once
+/**
+ * @brief Always-on lightweight kernel event counters.
+ *
+ * A fixed table of per-core counters for hot paths - one plain
+ * increment, no locks, no branches - cheap enough to stay on in
+ * production builds so monitoring can trend them continuously.
+ * Dumped as text by /proc/counters.
+ *
+ * counter_bump() is a macro so it can be used from any file that has
+ * this_core in scope (kernel/process.h); each core owns its own
+ * cache-line-aligned block, so increments never bounce lines between
+ * cores and torn reads of a drifting total are acceptable.
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <kernel/vfs.h>
+
+enum kernel_counter {
+	COUNTER_SCHED_SWITCH,   /* context switches (switch_next) */
+	COUNTER_FAULT_COW,      /* page faults resolved by copy-on-write */
+	COUNTER_FAULT_DEMAND,   /* page faults filled from executable or shm mappings */
+	COUNTER_FAULT_STACK,    /* page faults that grew a user stack */
+	COUNTER_FAULT_SEGV,     /* page faults that killed the process */
+	COUNTER_TLB_SHOOTDOWN,  /* shootdown IPIs broadcast */
+	COUNTER_BLOCKCACHE_HIT, /* block cache chunk lookups served from memory */
+	COUNTER_BLOCKCACHE_MISS,/* block cache chunk lookups that hit the device */
+	COUNTER_PBUF_ALLOC,     /* packet buffers handed out */
+	COUNTER_PBUF_FREE,      /* packet buffers returned to the pool */
+	COUNTER_PIPE_WAKEUP,    /* pipe readers or writers awoken */
+	COUNTER_MAX
+};
+
+#define COUNTER_MAX_CORES 32
+
+struct kernel_counter_block {
+	uint64_t counts[COUNTER_MAX];
+} __attribute__((aligned(64)));
+
+extern struct kernel_counter_block kernel_counters[COUNTER_MAX_CORES];
+
+#define counter_bump(c) (kernel_counters[this_core->cpu_id].counts[(c)]++)
+
+extern ssize_t counters_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer);
@@ -0,0 +1,12 @@
+#pragma once
+/**
+ * @brief CRC32 (the zlib/gzip polynomial, reflected).
+ *
+ * Slice-by-8 table core; see kernel/misc/crc32.c. Start with a crc
+ * of 0 and feed buffers in any chunking.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+extern uint32_t crc32_calculate(uint32_t crc, const void * data, size_t len);
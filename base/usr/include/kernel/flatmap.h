@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <kernel/list.h>
+
+/**
+ * Open-addressing map from integer keys to pointers.
+ *
+ * Entries are stored inline in a flat array (Robin Hood probing with
+ * backward-shift deletion), so lookups are a linear scan of adjacent
+ * cache lines and inserts never allocate unless the table needs to
+ * grow. Growth is incremental: the old array is kept and a few slots
+ * are migrated on each write, so no single operation pays for a full
+ * rehash. Intended for hot kernel tables with integer-ish keys.
+ */
+
+typedef struct flatmap_entry {
+	uintptr_t key;
+	void * value;
+	uint32_t dist; /* Probe distance + 1; 0 means the slot is empty */
+} flatmap_entry_t;
+
+typedef struct flatmap {
+	flatmap_entry_t * entries;
+	flatmap_entry_t * old_entries; /* Array still draining after a grow, or NULL */
+	size_t capacity;               /* Always a power of two */
+	size_t old_capacity;
+	size_t shift;                  /* 64 - log2(capacity), for Fibonacci hashing */
+	size_t old_shift;
+	size_t count;
+	size_t migrated;               /* Next old slot to move */
+} flatmap_t;
+
+extern flatmap_t * flatmap_create(size_t expected);
+extern void * flatmap_set(flatmap_t * map, uintptr_t key, void * value);
+extern void * flatmap_get(flatmap_t * map, uintptr_t key);
+extern void * flatmap_remove(flatmap_t * map, uintptr_t key);
+extern int flatmap_has(flatmap_t * map, uintptr_t key);
+extern list_t * flatmap_values(flatmap_t * map);
+extern void flatmap_free(flatmap_t * map);
@@ -0,0 +1,13 @@
+#pragma once
+/**
+ * @brief Function-entry tracer.
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <kernel/vfs.h>
+
+extern void ftrace_initialize(void);
+extern void ftrace_entry(uintptr_t site_ret, uintptr_t parent);
+extern int ftrace_command(char ** args);
+extern ssize_t ftrace_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer);
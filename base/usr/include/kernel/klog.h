@@ -0,0 +1,34 @@
+#pragma once
+/**
+ * @brief Buffered kernel log.
+ *
+ * dprintf() messages are recorded in per-core rings and drained to
+ * the console by a worker thread; see kernel/misc/klog.c. A format
+ * string may start with one of the severity prefixes below - the
+ * default is info. The retained stream is readable from /proc/klog,
+ * where each message carries a "<N>" severity tag.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define KLOG_EMERG   "\0030"
+#define KLOG_ALERT   "\0031"
+#define KLOG_CRIT    "\0032"
+#define KLOG_ERR     "\0033"
+#define KLOG_WARNING "\0034"
+#define KLOG_NOTICE  "\0035"
+#define KLOG_INFO    "\0036"
+#define KLOG_DEBUG   "\0037"
+
+extern int klog_active;
+
+extern void klog_initialize(void);
+extern int klog_append(int severity, int raw, const char * text, size_t length);
+extern void klog_flush(void);
+extern void klog_panic(void);
+extern ssize_t klog_stream_copy(off_t offset, size_t size, uint8_t * buffer);
+
+/* Console output that bypasses the log queue; kernel/vfs/console.c. */
+extern ssize_t console_write_direct(size_t size, uint8_t * buffer);
+extern int console_is_output(size_t (*output)(size_t, uint8_t *));
@@ -7,3 +7,5 @@ extern void ksym_bind(const char * symname, void * value);
 extern void * ksym_lookup(const char * symname);
 extern list_t * ksym_list(void);
 extern hashmap_t * ksym_get_map(void);
+extern void ksym_sort(void);
+extern uintptr_t ksym_find_nearest(uintptr_t addr, const char ** name);
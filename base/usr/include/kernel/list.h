@@ -1,5 +1,13 @@
 /**
  * @brief General-purpose doubly-linked list.
+ *
+ * Supports two usage styles. list_insert and friends allocate a node
+ * per entry and are paired with list_free. The node-taking functions
+ * (list_append, list_append_after, list_append_before, list_delete)
+ * work on caller-owned nodes, so an object that embeds its node_t -
+ * like a process's sched_node - can move between queues with pure
+ * pointer swaps, which is what hot paths and interrupt context want.
+ * A node must be on at most one list at a time in either style.
  */
 #pragma once
 
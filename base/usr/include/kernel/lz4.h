@@ -0,0 +1,17 @@
+/**
+ * @brief Kernel LZ4 decompressor
+ *
+ * Decodes LZ4 frames (magic 0x184D2204) such as those produced by
+ * the ramdisk pipeline with RAMDISK_FORMAT=lz4. Unlike DEFLATE,
+ * LZ4 needs no Huffman decoding - matches and literals copy in
+ * multi-byte chunks - so it unpacks a ramdisk several times faster.
+ * Use @c lz4_content_size() to size the output buffer (our frames
+ * always carry the content-size field), then @c lz4_decompress().
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+extern size_t lz4_content_size(const uint8_t * src, size_t srcLen);
+extern int lz4_decompress(const uint8_t * src, size_t srcLen, uint8_t * dst, size_t dstLen);
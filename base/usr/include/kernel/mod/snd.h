@@ -27,6 +27,12 @@ typedef struct snd_device {
 	int (*mixer_read)(uint32_t knob_id, uint32_t *val);
 	int (*mixer_write)(uint32_t knob_id, uint32_t val);
 
+	/* Period configuration; zero / NULL when the device's DMA layout is fixed. */
+	uint32_t period_frames;    /* Sample frames per DMA interrupt */
+	uint32_t period_count;     /* Periods queued ahead of the DMA engine */
+	int (*set_period)(struct snd_device * dev, uint32_t frames);
+	uint32_t (*get_position)(struct snd_device * dev);
+
 	uint32_t id;
 } snd_device_t;
 
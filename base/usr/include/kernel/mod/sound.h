@@ -27,10 +27,24 @@ typedef struct snd_knob_value {
 	uint32_t val;    /* OUT for SND_MIXER_READ_KNOB, IN for SND_MIXER_WRITE_KNOB */
 } snd_knob_value_t;
 
+typedef struct snd_period_config {
+	uint32_t device;        /* IN */
+	uint32_t period_frames; /* IN for SET, OUT for GET: sample frames per DMA interrupt */
+	uint32_t period_count;  /* OUT: periods queued ahead of the DMA engine */
+} snd_period_config_t;
+
 
 /* IOCTLs */
 #define SND_MIXER_GET_KNOBS 0
 #define SND_MIXER_GET_KNOB_INFO  1
 #define SND_MIXER_READ_KNOB 2
 #define SND_MIXER_WRITE_KNOB 3
+#define SND_MIXER_GET_PERIOD 4
+#define SND_MIXER_SET_PERIOD 5
+
+/* /dev/dsp ioctls */
+#define SND_DSP_SET_REALTIME 4 /* Drop rather than queue when the buffer is full */
+#define SND_DSP_GET_SAMPLES  5 /* Sample frames the mixer has consumed from this buffer */
+#define SND_DSP_GET_POSITION 6 /* Hardware ring position in sample frames, for just-in-time mixing */
+#define SND_DSP_SET_VOLUME   7 /* Per-stream volume: uint32_t, 0..256 fixed point, 256 = unity */
 
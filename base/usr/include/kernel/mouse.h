@@ -16,6 +16,7 @@ typedef struct {
 	int32_t x_difference;
 	int32_t y_difference;
 	mouse_click_t buttons;
+	uint64_t timestamp; /* microseconds since boot, at capture */
 } mouse_device_packet_t;
 
 #define MOUSE_MAGIC 0xFEED1234
@@ -12,12 +12,26 @@
 
 void net_eth_handle(struct ethernet_packet * frame, fs_node_t * nic, size_t size);
 
+/* Zero-copy receive path: the frame arrives in a pool buffer and is
+ * delivered by reference; the caller's reference is consumed. */
+struct pbuf;
+void net_eth_handle_pbuf(struct pbuf * p, fs_node_t * nic);
+
 struct EthernetDevice {
 	char if_name[32];
 	uint8_t mac[6];
 
 	size_t mtu;
 
+	/* Loopback devices take the IPv4 shortcut: frames skip ethernet
+	 * framing, ARP, and checksum generation on the way back in. */
+	int loopback;
+
+	/* Device inserts one's-complement checksums on transmit; senders
+	 * seed the checksum field with the pseudo-header sum and leave the
+	 * payload walk to the hardware. */
+	int hw_csum;
+
 	/* XXX: just to get things going */
 	uint32_t ipv4_addr;
 	uint32_t ipv4_subnet;
@@ -27,10 +41,37 @@ struct EthernetDevice {
 	/* TODO: Address lists? */
 
 	fs_node_t * device_node;
+
+	/* Drivers that can transmit straight out of a pool buffer set this;
+	 * the frame is handed over with its reference, and the driver drops
+	 * it when the device is done. Left NULL, frames go through the
+	 * device node's write with a staging copy. */
+	void (*send_pbuf)(struct EthernetDevice * nic, struct pbuf * p, size_t size);
+
+	/* Per-interface transmit queue, set up when the interface is
+	 * registered and drained by the [nettx] worker; see
+	 * kernel/net/netif.c. Loopback devices leave this NULL and
+	 * transmit inline. */
+	struct netif_txq * txq;
 };
 
 void net_eth_send(struct EthernetDevice *, size_t, void*, uint16_t, uint8_t*);
 
+/* As net_eth_send, for frames awaiting checksum insertion: start and
+ * offset locate the summed region and the seeded checksum field,
+ * relative to the payload. Devices that can't insert in hardware get
+ * the checksum finished in software before the frame is queued. */
+void net_eth_send_csum(struct EthernetDevice *, size_t, void*, uint16_t, uint8_t*, size_t csum_start, size_t csum_offset);
+
+/* Build-in-place transmit: prepare hands out a pool buffer with room
+ * for an ethernet header, pointing *l3_start at where the packet goes;
+ * the caller assembles it there and submits with send, which adds the
+ * header and queues the buffer with the caller's reference. Prepare
+ * returns NULL when the packet won't fit in a buffer; callers fall
+ * back to the copying path. Only useful for devices with send_pbuf. */
+struct pbuf * net_eth_pbuf_prepare(void ** l3_start, size_t l3_size);
+void net_eth_pbuf_send(struct EthernetDevice * nic, struct pbuf * p, size_t l3_size, uint16_t type, uint8_t * dest, size_t csum_start, size_t csum_offset);
+
 struct ArpCacheEntry {
 	uint8_t hwaddr[6];
 	uint16_t flags;
@@ -41,3 +82,9 @@ struct ArpCacheEntry * net_arp_cache_get(uint32_t addr);
 void net_arp_cache_add(struct EthernetDevice * iface, uint32_t addr, uint8_t * hwaddr, uint16_t flags);
 void net_arp_ask(uint32_t addr, fs_node_t * fsnic);
 
+/* Park an outgoing frame on an unresolved host; it is transmitted when
+ * the ARP reply arrives. Entry aging is controlled by net_arp_timeout
+ * (seconds; zero disables it). */
+int net_arp_enqueue(uint32_t addr, fs_node_t * fsnic, uint16_t type, void * payload, size_t size, size_t csum_start, size_t csum_offset);
+extern unsigned int net_arp_timeout;
+
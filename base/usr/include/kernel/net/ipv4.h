@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 struct ipv4_packet {
 	uint8_t  version_ihl;
@@ -58,3 +59,8 @@ struct tcp_check_header {
 #define IPV4_PROT_UDP 17
 #define IPV4_PROT_TCP 6
 
+/* Software fallback for frames built for hardware checksum insertion:
+ * the field at offset holds the pseudo-header seed, and the sum runs
+ * from start to the end of the frame, just as the device would. */
+extern void net_csum_finish(void * frame, size_t size, size_t start, size_t offset);
+
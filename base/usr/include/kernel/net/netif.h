@@ -1,6 +1,7 @@
 #pragma once
 
 #include <kernel/vfs.h>
+#include <kernel/process.h>
 #include <sys/socket.h>
 
 #define htonl(l)  ( (((l) & 0xFF) << 24) | (((l) & 0xFF00) << 8) | (((l) & 0xFF0000) >> 8) | (((l) & 0xFF000000) >> 24))
@@ -12,11 +13,26 @@ int net_add_interface(const char * name, fs_node_t * deviceNode);
 fs_node_t * net_if_lookup(const char * name);
 fs_node_t * net_if_route(uint32_t addr);
 
+/* Wake anyone waiting on /dev/netstate; drivers call this when link
+ * status or addressing changes so monitors don't have to poll. */
+void net_if_state_changed(void);
+
+/* Per-interface transmit queueing. Frames are staged with
+ * net_if_tx_enqueue and pushed into the device by a dedicated worker;
+ * senders never touch the device locks. Either @p p (a pool buffer,
+ * with its reference) or @p frame (a heap frame the worker frees) is
+ * handed over. Protocols can poll the backlog and sleep until the
+ * worker drains it for back-pressure. */
+struct EthernetDevice;
+struct pbuf;
+void net_if_tx_enqueue(struct EthernetDevice * nic, struct pbuf * p, void * frame, size_t size);
+size_t net_if_tx_backlog(struct EthernetDevice * nic);
+void net_if_tx_drain_wait(struct EthernetDevice * nic);
+
 typedef struct SockData {
 	fs_node_t _fnode;
-	spin_lock_t alert_lock;
 	spin_lock_t rx_lock;
-	list_t * alert_wait;
+	fswait_queue_t alert_wait;
 	list_t * rx_wait;
 	list_t * rx_queue;
 
@@ -27,15 +43,64 @@ typedef struct SockData {
 	void (*sock_close)(struct SockData * sock);
 	long (*sock_connect)(struct SockData * sock, const struct sockaddr *addr, socklen_t addrlen);
 	long (*sock_bind)(struct SockData * sock, const struct sockaddr *addr, socklen_t addrlen);
+	long (*sock_getsockopt)(struct SockData * sock, int level, int optname, void * optval, socklen_t * optlen);
 
 	struct sockaddr dest;
 	uint32_t priv32[4];
 
 	size_t unread;
 	char * buf;
+
+	/* Protocol-private state beyond what fits in priv/priv32; TCP hangs
+	 * its window and retransmission bookkeeping here. Owned by the
+	 * protocol and torn down in its sock_close. */
+	void * proto_private;
+
+	/* Buffer limits, settable through SO_SNDBUF/SO_RCVBUF. rx_buffered
+	 * tracks how much sits in rx_queue; frames past rcvbuf are dropped,
+	 * and TCP derives its advertised window from the space left. sndbuf
+	 * caps how much TCP keeps in flight. */
+	size_t sndbuf;
+	size_t rcvbuf;
+	size_t rx_buffered;
+
+	/* SO_TIMESTAMP: datagram receives attach the frame's kernel arrival
+	 * time as a SCM_TIMESTAMP control message. */
+	int rx_timestamp;
+
+	/* Byte-stream receive ring for stream protocols; rx_buffered counts
+	 * the bytes between head and tail. Datagram sockets leave this NULL
+	 * and keep using rx_queue. */
+	uint8_t * rx_ring;
+	size_t rx_ring_size;
+	size_t rx_head;
+	size_t rx_tail;
 } sock_t;
 
+#define SOCK_BUFFER_DEFAULT 0x10000
+#define SOCK_BUFFER_MIN     0x1000
+#define SOCK_BUFFER_MAX     0x400000
+
+/* Entries in rx_queue are a size_t header followed by the frame data.
+ * The top bit of the header marks frames that live in a pool buffer
+ * (see kernel/net/pbuf.h) rather than on the heap, so always mask it
+ * off when reading the size and release entries with net_sock_free,
+ * never free() directly. */
+#define SOCK_FRAME_PBUF (1UL << 63)
+#define NET_FRAME_SIZE(blob) ((*(size_t*)(blob)) & ~SOCK_FRAME_PBUF)
+
+struct pbuf;
+
 void net_sock_alert(sock_t * sock);
 void net_sock_add(sock_t * sock, void * frame, size_t size);
+void net_sock_add_backed(sock_t * sock, void * frame, size_t size, struct pbuf * backing);
+uint64_t net_sock_frame_time(void * blob);
+void net_sock_free(void * blob);
 void * net_sock_get(sock_t * sock);
 sock_t * net_sock_create(void);
+
+/* Byte-stream receive ring. Writes are all-or-nothing (0 = no room);
+ * reads copy out up to size bytes and return how many. */
+void net_sock_stream_init(sock_t * sock);
+int net_sock_stream_write(sock_t * sock, const void * data, size_t size);
+size_t net_sock_stream_read(sock_t * sock, void * buf, size_t size);
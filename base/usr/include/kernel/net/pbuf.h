@@ -0,0 +1,37 @@
+#pragma once
+
+#include <kernel/types.h>
+#include <kernel/list.h>
+
+/**
+ * Pooled, refcounted packet buffers.
+ *
+ * Each buffer is one page: a small header at the start, packet data at
+ * a fixed offset. The pages are allocated by physical frame and mapped
+ * through the physical window, so every buffer is page-aligned, has a
+ * known physical address for the NIC to DMA into, and the header can be
+ * recovered from any pointer into the payload by masking. Buffers come
+ * out of a free pool and go back to it when the last reference drops,
+ * so steady-state packet receive does not touch the allocator at all.
+ */
+#define PBUF_BLOCK_SIZE  4096
+#define PBUF_DATA_OFFSET 64     /* Must hold struct pbuf; keeps the payload nicely aligned */
+#define PBUF_CAPACITY    (PBUF_BLOCK_SIZE - PBUF_DATA_OFFSET)
+
+struct pbuf {
+	volatile int refcount;
+	uint32_t size;       /* Bytes of packet data in the payload */
+	uintptr_t phys;      /* Physical address of the payload, for DMA */
+	uint8_t csum_start;  /* Checksum insertion on transmit: sum from */
+	uint8_t csum_offset; /* here, store at this seeded field; 0 = none */
+	uint64_t rx_time;    /* Arrival stamp, wall-clock microseconds; set
+	                      * as received frames enter the stack */
+	node_t node;         /* On the free pool */
+};
+
+#define PBUF_PAYLOAD(p) ((uint8_t*)(p) + PBUF_DATA_OFFSET)
+#define PBUF_FROM_POINTER(ptr) ((struct pbuf *)((uintptr_t)(ptr) & ~(uintptr_t)(PBUF_BLOCK_SIZE - 1)))
+
+extern struct pbuf * pbuf_alloc(void);
+extern void pbuf_ref(struct pbuf * p);
+extern void pbuf_unref(struct pbuf * p);
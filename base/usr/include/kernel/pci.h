@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <kernel/list.h>
 
 #define PCI_VENDOR_ID            0x00 // 2
 #define PCI_DEVICE_ID            0x02 // 2
@@ -22,9 +23,15 @@
 #define PCI_BAR4                 0x20 // 4
 #define PCI_BAR5                 0x24 // 4
 
+#define PCI_CAPABILITY_POINTER   0x34 // 1
+
 #define PCI_INTERRUPT_LINE       0x3C // 1
 #define PCI_INTERRUPT_PIN        0x3D
 
+#define PCI_CAP_MSI  0x05
+#define PCI_CAP_PCIE 0x10
+#define PCI_CAP_MSIX 0x11
+
 #define PCI_SECONDARY_BUS        0x19 // 1
 
 #define PCI_HEADER_TYPE_DEVICE  0
@@ -41,6 +48,21 @@
 
 typedef void (*pci_func_t)(uint32_t device, uint16_t vendor_id, uint16_t device_id, void * extra);
 
+/* One entry in the device table built on the first scan. */
+struct pci_device {
+	uint32_t address;    /* Boxed bus/slot/func for config-space access */
+	uint16_t vendor_id;
+	uint16_t device_id;
+	uint16_t type;       /* (class << 8) | subclass */
+	uint8_t  bus;
+	uint8_t  slot;
+	uint8_t  func;
+	uint8_t  cap_msi;    /* Capability offsets; 0 if not present */
+	uint8_t  cap_msix;
+	uint8_t  cap_pcie;
+	uint32_t bars[6];    /* Raw BAR values as found at enumeration */
+};
+
 static inline int pci_extract_bus(uint32_t device) {
 	return (uint8_t)((device >> 16));
 }
@@ -69,3 +91,9 @@ void pci_scan(pci_func_t f, int type, void * extra);
 void pci_remap(void);
 int pci_get_interrupt(uint32_t device);
 
+list_t * pci_devices(void);
+struct pci_device * pci_device_by_addr(uint32_t device);
+struct pci_device * pci_device_find(uint16_t vendor_id, uint16_t device_id);
+uint8_t pci_get_capability(uint32_t device, uint8_t cap);
+int pci_enable_msi(uint32_t device, uint8_t vector);
+
@@ -4,6 +4,7 @@
 #include <kernel/vfs.h>
 #include <kernel/list.h>
 #include <kernel/spinlock.h>
+#include <kernel/process.h>
 
 typedef struct _pipe_device {
 	uint8_t * buffer;
@@ -14,13 +15,10 @@ typedef struct _pipe_device {
 	list_t * wait_queue_readers;
 	list_t * wait_queue_writers;
 	int dead;
-	list_t * alert_waiters;
+	fswait_queue_t alert;
 
-	spin_lock_t lock_read;
-	spin_lock_t lock_write;
-	spin_lock_t alert_lock;
-	spin_lock_t wait_lock;
-	spin_lock_t ptr_lock;
+	spin_lock_t lock_read;  /* Serializes readers; read_ptr only moves under it. */
+	spin_lock_t lock_write; /* Serializes writers; write_ptr only moves under it. */
 } pipe_device_t;
 
 fs_node_t * make_pipe(size_t size);
@@ -15,10 +15,35 @@
 #define KERNEL_STACK_SIZE 0x9000
 #define USER_ROOT_UID 0
 
+/* Scheduler priority classes. Lower values are scheduled first; the
+ * default leaves room above it for latency-sensitive processes like
+ * the compositor and below it for batch work. */
+#define SCHED_PRIORITY_LEVELS  4
+#define SCHED_PRIORITY_DEFAULT 1
+
+/**
+ * @brief A loadable segment of an executable, for demand paging.
+ *
+ * Recorded by the ELF loader instead of reading the segment in at exec
+ * time; pages are allocated and filled on first touch.
+ */
+typedef struct exec_segment {
+	uintptr_t vaddr;
+	size_t    memsz;
+	size_t    filesz;
+	size_t    offset;
+} exec_segment_t;
+
 typedef struct {
 	intptr_t refcount;
 	union PML * directory;
 	spin_lock_t lock;
+
+	/* Demand-load state: the executable backing this address space and
+	 * its loadable segments. NULL/zero when everything is resident. */
+	fs_node_t * exec_node;
+	exec_segment_t * exec_segments;
+	int exec_segment_count;
 } page_directory_t;
 
 typedef struct {
@@ -40,6 +65,8 @@ typedef struct thread {
 	kthread_context_t context;
 	uint8_t fp_regs[512] __attribute__((aligned(16)));
 	page_directory_t * page_directory;
+	uintptr_t debug_addr[4]; /* Hardware breakpoint addresses (DR0-DR3) */
+	uintptr_t debug_ctl;     /* Debug control register image (DR7); zero when unused */
 } thread_t;
 
 typedef struct image {
@@ -70,6 +97,15 @@ typedef struct file_descriptors {
 
 #define PROC_FLAG_TRACE_SYSCALLS     0x40
 #define PROC_FLAG_TRACE_SIGNALS      0x80
+#define PROC_FLAG_TRACE_RECORD       0x100
+
+typedef struct sleeper {
+	uint64_t end_tick;
+	uint64_t end_subtick;
+	struct process * process;
+	int is_fswait;
+	size_t heap_index; /* Position in the timed sleep heap, or (size_t)-1 if not armed. */
+} sleeper_t;
 
 typedef struct process {
 	pid_t id;    /* PID */
@@ -79,6 +115,8 @@ typedef struct process {
 	int status; /* status code */
 	unsigned int flags; /* finished, started, running, isTasklet */
 	int owner;
+	int priority; /* scheduler priority class, 0 (highest) through SCHED_PRIORITY_LEVELS-1 */
+	uint32_t cpu_affinity; /* bitmask of cores this process may run on; 0 means any core */
 
 	uid_t user;
 	uid_t real_user;
@@ -107,8 +145,9 @@ typedef struct process {
 
 	node_t sched_node;
 	node_t sleep_node;
-	node_t * timed_sleep_node;
-	node_t * timeout_node;
+	struct process * retire_next; /* Link in a core's deferred-reap retire list. */
+	struct sleeper * timed_sleep_node;
+	struct sleeper * timeout_node;
 
 	struct timeval start;
 	int awoken_index;
@@ -125,27 +164,48 @@ typedef struct process {
 	gid_t * supplementary_group_list;
 
 	/* Process times */
-	uint64_t time_prev;         /* user time from previous update of usage[] */
-	uint64_t time_total;        /* user time */
-	uint64_t time_sys;          /* system time */
+	uint64_t time_prev;         /* total cpu time at the previous update of usage[] */
+	uint64_t time_total;        /* total cpu time, in tsc cycles */
+	uint64_t time_sys;          /* system time, in tsc cycles; user time is the difference */
 	uint64_t time_in;           /* tsc stamp of when this process last entered the running state */
 	uint64_t time_switch;       /* tsc stamp of when this process last started doing system things */
 	uint64_t time_children;     /* sum of user times from waited-for children */
 	uint64_t time_sys_children; /* sum of sys times from waited-for children */
 	uint16_t usage[4];          /* four permille samples over some period (currently 4Hz) */
+	uint64_t sched_count;       /* how many times this process has been picked to run */
+	uint64_t time_ready;        /* tsc stamp of when this process last became ready */
+	uint64_t time_waited;       /* total tsc time spent ready but waiting for a core */
 
 	/* Tracing */
 	pid_t tracer;
 	spin_lock_t wait_lock;
 	list_t * tracees;
+	void * syscall_ring;        /* Binary syscall record ring for PTRACE_RECORD */
+
+	/* fswait bookkeeping. The list node_waits points at and the nodes
+	 * on it are owned by the process: entries are drawn from the spare
+	 * pool when a wait is registered and returned to it on wakeup, so
+	 * blocking on and waking from an fswait touch no allocator state.
+	 * The embedded sleeper backs timed_sleep_node and timeout_node,
+	 * which are mutually exclusive. */
+	list_t fswait_waiting;
+	list_t fswait_spares;
+	struct sleeper timeout_sleeper;
 } process_t;
 
-typedef struct {
-	uint64_t end_tick;
-	uint64_t end_subtick;
-	process_t * process;
-	int is_fswait;
-} sleeper_t;
+/**
+ * @brief Alert queue for fswait (select/poll) wakeups.
+ *
+ * Devices that support selectwait keep one of these per waitable
+ * condition. Waiter nodes are recycled on the spare list rather than
+ * freed, so posting an alert - which often happens in interrupt
+ * context - never touches the allocator.
+ */
+typedef struct fswait_queue {
+	list_t waiters; /* Processes to alert; node values are process pointers */
+	list_t spares;  /* Retired waiter nodes, reused by the next wait */
+	spin_lock_t lock;
+} fswait_queue_t;
 
 struct ProcessorLocal {
 	/**
@@ -177,6 +237,31 @@ struct ProcessorLocal {
 	 */
 	volatile process_t * previous_process;
 
+	/**
+	 * @brief Core-local scheduler ready queues, one per priority class.
+	 *
+	 * Each core schedules out of its own queues and only examines
+	 * the queues of other cores when it has nothing left to run,
+	 * at which point it may steal work from the busiest core.
+	 * Picking the next process scans the fixed set of classes from
+	 * highest to lowest, so pick-next stays O(1).
+	 */
+	list_t * sched_queue[SCHED_PRIORITY_LEVELS];
+	spin_lock_t sched_lock;
+
+	/* Scheduler statistics, exposed through /proc/sched. */
+	uint64_t sched_switch_count;
+	uint64_t sched_steal_count;
+
+	/* Set when a wakeup IPI has been sent to this core and it has not
+	 * been through the scheduler since; suppresses duplicate IPIs. */
+	volatile int wakeup_pending;
+
+	/* Lock-free stack of dead processes whose final cleanup had to be
+	 * deferred because another core was still running them; drained
+	 * when this core goes idle. */
+	process_t * volatile retire_list;
+
 	int cpu_id;
 	union PML * current_pml;
 
@@ -184,6 +269,9 @@ struct ProcessorLocal {
 
 #ifdef __x86_64__
 	int lapic_id;
+	/* LAPIC timer calibration for this core; 0 if the core takes its
+	 * preemption ticks from the PIT instead (the BSP). */
+	uint64_t lapic_timer_ticks_per_10ms;
 	/* Processor information loaded at startup. */
 	int  cpu_model;
 	int  cpu_family;
@@ -215,11 +303,19 @@ extern int wakeup_queue_interrupted(list_t * queue);
 extern int sleep_on(list_t * queue);
 extern int sleep_on_unlocking(list_t * queue, spin_lock_t * release);
 extern int process_alert_node(process_t * process, void * value);
+extern void process_wait_node(process_t * process, void * value);
+extern void fswait_queue_init(fswait_queue_t * queue, const char * name, const void * owner);
+extern void fswait_queue_wait(fswait_queue_t * queue, process_t * process, void * value);
+extern void fswait_queue_alert(fswait_queue_t * queue, void * value);
+extern void fswait_queue_destroy(fswait_queue_t * queue, void * value);
 extern void sleep_until(process_t * process, unsigned long seconds, unsigned long subseconds);
 extern void switch_task(uint8_t reschedule);
 extern int process_wait_nodes(process_t * process,fs_node_t * nodes[], int timeout);
 extern process_t * process_get_parent(process_t * process);
 extern int process_is_ready(process_t * proc);
+extern int process_queue_has_work(void);
+extern long process_set_priority(process_t * proc, int priority);
+extern long process_set_affinity(process_t * proc, uint32_t mask);
 extern void wakeup_sleepers(unsigned long seconds, unsigned long subseconds);
 extern void task_exit(int retval);
 extern __attribute__((noreturn)) void switch_next(void);
@@ -229,14 +325,13 @@ extern void process_release_directory(page_directory_t * dir);
 extern process_t * spawn_worker_thread(void (*entrypoint)(void * argp), const char * name, void * argp);
 extern pid_t fork(void);
 extern pid_t clone(uintptr_t new_stack, uintptr_t thread_func, uintptr_t arg);
+extern pid_t spawn_exec(char * path, int argc, char ** argv, char ** envp);
 extern int waitpid(int pid, int * status, int options);
 extern int exec(const char * path, int argc, char *const argv[], char *const env[], int interp_depth);
 extern void update_process_usage(uint64_t clock_ticks, uint64_t perf_scale);
 
 extern tree_t * process_tree;  /* Parent->Children tree */
 extern list_t * process_list;  /* Flat storage */
-extern list_t * process_queue; /* Ready queue */
-extern list_t * sleep_queue;
 
 extern void arch_enter_tasklet(void);
 extern __attribute__((noreturn)) void arch_resume_user(void);
@@ -244,9 +339,13 @@ extern __attribute__((noreturn)) void arch_restore_context(volatile thread_t * b
 extern __attribute__((returns_twice)) int arch_save_context(volatile thread_t * buf);
 extern void arch_restore_floating(process_t * proc);
 extern void arch_save_floating(process_t * proc);
+extern void arch_set_debug_registers(process_t * proc);
 extern void arch_set_kernel_stack(uintptr_t);
 extern void arch_enter_user(uintptr_t entrypoint, int argc, char * argv[], char * envp[], uintptr_t stack);
 __attribute__((noreturn))
 extern void arch_enter_signal_handler(uintptr_t,int);
 extern void arch_wakeup_others(void);
+extern void arch_wakeup_core(int cpu_id);
+extern void arch_timer_arm(uint64_t microseconds);
+extern void arch_timer_stop(void);
 
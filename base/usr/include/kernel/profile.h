@@ -0,0 +1,15 @@
+#pragma once
+/**
+ * @brief Kernel-side hooks for the sampling profiler.
+ */
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/profile.h>
+#include <kernel/vfs.h>
+
+extern volatile int profile_active;
+
+extern void profile_tick(uintptr_t rip, int is_kernel);
+extern ssize_t profile_read(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer);
+extern int profile_ioctl(fs_node_t * node, unsigned long request, void * argp);
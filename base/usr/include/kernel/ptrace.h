@@ -1,6 +1,9 @@
 #pragma once
 
+struct regs;
+
 long ptrace_attach(pid_t pid);
 long ptrace_self(void);
 long ptrace_signal(int signal, int reason);
 long ptrace_continue(pid_t pid, int signum);
+void ptrace_record_syscall(struct regs * r, long result);
@@ -4,27 +4,43 @@
 #include <kernel/list.h>
 #include <kernel/vfs.h>
 #include <kernel/spinlock.h>
+#include <kernel/process.h>
 
 typedef struct {
 	unsigned char * buffer;
 	size_t write_ptr;
 	size_t read_ptr;
 	size_t size;
-	spin_lock_t lock;
+	size_t max_size;    /* Writers grow the buffer up to this before blocking. */
+	int frame_backed;   /* Buffer is a whole frame rather than a heap allocation. */
+	spin_lock_t rlock;  /* Serializes readers; read_ptr only moves under it. */
+	spin_lock_t wlock;  /* Serializes writers; write_ptr only moves under it. */
+	int spsc;           /* Single producer, single consumer: skip the side locks. */
 	list_t * wait_queue_readers;
 	list_t * wait_queue_writers;
 	int internal_stop;
-	list_t * alert_waiters;
+	fswait_queue_t alert;
 	int discard;
 } ring_buffer_t;
 
+/* Running totals across all ring buffers, for /proc/pipes. */
+extern uint64_t ring_buffer_total_read;
+extern uint64_t ring_buffer_total_written;
+extern uint64_t ring_buffer_total_grows;
+extern uint64_t ring_buffer_total_wakeups;
+extern uint64_t ring_buffer_total_wakeups_deferred;
+
 size_t ring_buffer_unread(ring_buffer_t * ring_buffer);
 size_t ring_buffer_size(fs_node_t * node);
 size_t ring_buffer_available(ring_buffer_t * ring_buffer);
 size_t ring_buffer_read(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer);
 size_t ring_buffer_write(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer);
+size_t ring_buffer_try_read(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer);
+size_t ring_buffer_try_write(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer);
 
 ring_buffer_t * ring_buffer_create(size_t size);
+void ring_buffer_set_spsc(ring_buffer_t * ring_buffer);
+void ring_buffer_set_max(ring_buffer_t * ring_buffer, size_t max_size);
 void ring_buffer_destroy(ring_buffer_t * ring_buffer);
 void ring_buffer_interrupt(ring_buffer_t * ring_buffer);
 void ring_buffer_alert_waiters(ring_buffer_t * ring_buffer);
@@ -9,11 +9,15 @@
 /* Types */
 struct shm_node;
 
+/* Frames are allocated on first touch; this marks an empty slot. */
+#define SHM_FRAME_UNSET ((uintptr_t)-1)
+
 typedef struct {
 	struct shm_node * parent;
 	volatile uint8_t lock;
 	ssize_t ref_count;
-	size_t num_frames;
+	size_t num_frames;     /* current logical size, in pages */
+	size_t capacity;       /* length of frames[]; never shrinks while mapped */
 	uintptr_t *frames;
 } shm_chunk_t;
 
@@ -36,4 +40,5 @@ extern int    shm_release(char * path);
 /* Other exposed functions */
 extern void shm_install(void);
 extern void shm_release_all(process_t * proc);
+extern int  shm_demand_fault(uintptr_t address);
 
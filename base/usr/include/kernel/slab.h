@@ -0,0 +1,15 @@
+#pragma once
+/**
+ * @brief Fixed-size object caches with per-core magazines.
+ *
+ * For kernel object types that are allocated and freed at high rates
+ * (processes, packet buffers), a dedicated cache avoids taking the
+ * heap allocator's global lock on every operation.
+ */
+#include <kernel/types.h>
+
+typedef struct slab_cache slab_cache_t;
+
+extern slab_cache_t * slab_cache_create(const char * name, size_t object_size);
+extern void * slab_alloc(slab_cache_t * cache);
+extern void slab_free(slab_cache_t * cache, void * object);
@@ -8,7 +8,33 @@ typedef volatile struct {
 #define spin_init(lock) do { (lock).owner = 0; (lock).latch[0] = 0; (lock).func = NULL; } while (0)
 
 #define DEBUG_LOCKS
-#ifdef DEBUG_LOCKS
+
+#ifdef LOCK_STATS
+/**
+ * Contention counters, one per spin_lock() call site. Each site is a
+ * static local stamped with the stringified lock expression and its
+ * location, chained into a global list on first acquisition and
+ * exported through /proc/locks. Sites have static storage, so the
+ * list stays valid even for locks that live in freed allocations.
+ */
+struct spin_lock_site {
+	const char * name; /* Stringified lock expression */
+	const char * file;
+	int line;
+	int registered;
+	struct spin_lock_site * next;
+	unsigned long long acquisitions;
+	unsigned long long spins;      /* Failed test-and-sets while waiting */
+	unsigned long long wait_total; /* TSC cycles spent waiting, summed */
+	unsigned long long wait_max;   /* Worst single wait, TSC cycles */
+};
+extern void spin_lock_acquire(spin_lock_t * lock, struct spin_lock_site * site);
+#define spin_lock(lock) do { \
+	static struct spin_lock_site _lock_site = { #lock, __FILE__, __LINE__, 0, (void*)0, 0, 0, 0, 0 }; \
+	spin_lock_acquire(&(lock), &_lock_site); \
+} while (0)
+#define spin_unlock(lock) do { (lock).func = NULL; (lock).owner = -1; __sync_lock_release((lock).latch); } while (0)
+#elif defined(DEBUG_LOCKS)
 #define spin_lock(lock) do { while (__sync_lock_test_and_set((lock).latch, 0x01)); (lock).owner = this_core->cpu_id+1; (lock).func = __func__; } while (0)
 #define spin_unlock(lock) do { (lock).func = NULL; (lock).owner = -1; __sync_lock_release((lock).latch); } while (0)
 #else
@@ -35,4 +35,5 @@ extern void * __attribute__ ((malloc)) realloc(void * ptr, uintptr_t size);
 extern void * __attribute__ ((malloc)) calloc(uintptr_t nmemb, uintptr_t size);
 extern void * __attribute__ ((malloc)) valloc(uintptr_t size);
 extern void free(void * ptr);
+extern void heap_arena_stats(int core, uint64_t * stats);
 extern uint8_t startswith(const char * str, const char * accept);
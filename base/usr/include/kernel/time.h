@@ -4,4 +4,5 @@
 
 extern void relative_time(unsigned long, unsigned long, unsigned long *, unsigned long *);
 extern uint64_t now(void);
+extern uint64_t arch_coarse_time(uint64_t * usec);
 extern uint64_t arch_perf_timer(void);
@@ -93,6 +93,19 @@ typedef struct fs_node {
 	selectwait_type_t selectwait;
 
 	chown_type_t chown;
+
+	/* Sequential-read tracking for readahead; per open file, since
+	 * every open works on its own clone of the node. */
+	uint64_t seq_end;      /* Where the last read ended. */
+	uint32_t seq_streak;   /* Consecutive sequential reads seen. */
+	uint64_t ra_done;      /* Readahead has been submitted up to here. */
+
+	/* Set by windowing layers (partition mappers): this node is the
+	 * underlying device, shifted by a fixed byte offset. Lets the async
+	 * block queue route requests straight to the real device's queue
+	 * with the offset pre-composed. */
+	struct fs_node * passthrough_device;
+	off_t passthrough_base;
 } fs_node_t;
 
 struct vfs_entry {
@@ -141,4 +154,19 @@ void map_vfs_directory(const char *);
 
 int make_unix_pipe(fs_node_t ** pipes);
 
+/* Page cache, for file-backed memory mappings. */
+uintptr_t pagecache_get_frame(fs_node_t * node, uint64_t offset);
+size_t pagecache_frame_count(void);
+
+/* Sequential readahead, fed by read_fs. */
+#define READAHEAD_WINDOW 0x10000
+void readahead_submit(fs_node_t * node, uint64_t offset, size_t size);
+
+/* Directory entry cache, for path resolution. */
+int dcache_lookup(fs_node_t * parent, const char * name, fs_node_t ** out);
+void dcache_store(fs_node_t * parent, const char * name, fs_node_t * node);
+void dcache_evict(fs_node_t * parent, const char * name);
+void dcache_evict_path(const char * name);
+size_t dcache_entry_count(void);
+
 int fprintf(fs_node_t * f, const char * fmt, ...);
@@ -9,17 +9,56 @@
 #define IO_VID_STRIDE 0x5007
 #define IO_VID_DRIVER 0x5008
 #define IO_VID_REINIT 0x5009
+#define IO_VID_REFRESH 0x500A
+
+/* 2D-engine operations on the visible framebuffer; only supported
+ * when an acceleration-capable driver is loaded (-EINVAL otherwise). */
+#define IO_VID_BLIT_FILL 0x500B
+#define IO_VID_BLIT_COPY 0x500C
+
+/* Cursor plane: an overlay composited by the video driver, so moving
+ * the pointer never forces a window recomposite. */
+#define IO_VID_CURSOR_SET 0x500D
+#define IO_VID_CURSOR_POS 0x500E
+
+#define VID_CURSOR_MAX 64
+
+#define VID_CURSOR_HIDE    (1 << 0)
+#define VID_CURSOR_DAMAGED (1 << 1)
 
 struct vid_size {
 	uint32_t width;
 	uint32_t height;
 };
 
+struct vid_blit {
+	uint32_t dst_x;
+	uint32_t dst_y;
+	uint32_t src_x;
+	uint32_t src_y;
+	uint32_t width;
+	uint32_t height;
+	uint32_t color;
+};
+
+struct vid_cursor {
+	uint32_t width;
+	uint32_t height;
+	uint32_t bitmap[]; /* premultiplied ARGB */
+};
+
+struct vid_cursor_pos {
+	int32_t x; /* top-left corner, may hang off any edge */
+	int32_t y;
+	uint32_t flags;
+};
+
 #ifdef _KERNEL_
-extern void lfb_set_resolution(uint16_t x, uint16_t y);
+extern int lfb_set_resolution(uint16_t x, uint16_t y);
 extern uint16_t lfb_resolution_x;
 extern uint16_t lfb_resolution_y;
 extern uint16_t lfb_resolution_b;
+extern uint16_t lfb_resolution_r;
 extern uint8_t * lfb_vid_memory;
 extern const char * lfb_driver_name;
 extern void (*lfb_resolution_impl)(uint16_t,uint16_t);
@@ -37,6 +37,10 @@ typedef struct {
 	size_t tx_bytes;
 	size_t rx_count;
 	size_t rx_bytes;
+	size_t tx_dropped;   /* Frames given up on (full ring, queue cap) */
+	size_t rx_dropped;   /* Frames discarded on receive (error bits) */
+	size_t tx_ring_used; /* Transmit descriptors currently in flight */
+	size_t tx_ring_size;
 } netif_counters_t;
 
 _End_C_Header
@@ -1,7 +1,21 @@
 #pragma once
 
 #include <_cheader.h>
+#include <sys/types.h>
 
 _Begin_C_Header
 extern int sched_yield(void);
+
+/* Scheduler priority classes; lower values are scheduled first.
+ * Regular users may only demote their own processes. */
+#define SCHED_PRIO_HIGH    0
+#define SCHED_PRIO_DEFAULT 1
+#define SCHED_PRIO_LOW     2
+#define SCHED_PRIO_BATCH   3
+
+extern int sched_setpriority(pid_t pid, int priority);
+
+/* Pin a process to a set of cores. A mask of 0 allows all cores. */
+extern int sched_setaffinity(pid_t pid, unsigned int mask);
+extern int sched_getaffinity(pid_t pid, unsigned int * mask);
 _End_C_Header
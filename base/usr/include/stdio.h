@@ -31,6 +31,15 @@ extern FILE * freopen(const char *path, const char *mode, FILE * stream);
 extern size_t fread(void *ptr, size_t size, size_t nmemb, FILE * stream);
 extern size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE * stream);
 
+/* This stdio does no locking, so these are aliases; see libc/stdio/stdio.c */
+extern size_t fread_unlocked(void *ptr, size_t size, size_t nmemb, FILE * stream);
+extern size_t fwrite_unlocked(const void *ptr, size_t size, size_t nmemb, FILE * stream);
+extern int fflush_unlocked(FILE * stream);
+extern int fputc_unlocked(int c, FILE *stream);
+extern int putc_unlocked(int c, FILE *stream);
+extern int fgetc_unlocked(FILE *stream);
+extern int getc_unlocked(FILE *stream);
+
 extern int fileno(FILE * stream);
 extern int fflush(FILE * stream);
 
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <_cheader.h>
+
+_Begin_C_Header
+
+#define EVSET_ADD 0
+#define EVSET_DEL 1
+
+extern int evset_create(void);
+extern int evset_ctl(int setfd, int op, int fd);
+extern int evset_wait(int setfd, int * out, int max, int timeout);
+
+_End_C_Header
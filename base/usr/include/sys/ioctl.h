@@ -14,4 +14,8 @@
 
 #define IOCTL_PACKETFS_QUEUED 0x5050
 
+/* Pipe capacity; SETSZ takes a pointer to a size in bytes. */
+#define IOCTLPIPESETSZ 0x5150
+#define IOCTLPIPEGETSZ 0x5151
+
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Binary process records exposed by procfs.
+ *
+ * /proc/<pid>/stat holds one struct procfs_stat; /proc/procs holds one
+ * for every live process, back to back, snapshotted per read call. The
+ * version field is bumped whenever the layout changes, so readers can
+ * reject records from a mismatched kernel instead of misparsing them.
+ * These carry the same information as the text 'status' files without
+ * the formatting and parsing costs.
+ */
+#define PROCFS_STAT_VERSION 2
+
+struct procfs_stat {
+	uint32_t version;      /* PROCFS_STAT_VERSION */
+	int32_t  pid;
+	int32_t  tgid;
+	int32_t  ppid;
+	int32_t  pgid;
+	int32_t  sid;
+	int32_t  uid;
+	int32_t  last_core;
+	uint8_t  state;        /* R, S, T, Z - as in the text form */
+	char     name[100];
+	uint64_t vm_size;      /* kB */
+	uint64_t rss_shmem;    /* kB */
+	uint64_t mem_permille;
+	uint64_t total_time;   /* us */
+	uint64_t user_time;    /* us */
+	uint64_t sys_time;     /* us */
+	uint64_t wait_time;    /* us */
+	uint64_t sched_count;
+	int32_t  usage[4];     /* CPU permille over the last four windows */
+} __attribute__((packed));
@@ -0,0 +1,24 @@
+#pragma once
+/**
+ * @brief Sampling profiler interface, shared between the kernel
+ *        and the userspace `prof` tool.
+ *
+ * /proc/profile reads return whole @c profile_sample records drained
+ * from per-core rings; collection is controlled with ioctls on the
+ * same file.
+ */
+
+#include <stdint.h>
+
+struct profile_sample {
+	uint64_t rip;   /* Instruction pointer at the timer interrupt */
+	int32_t  pid;   /* Running process, 0 if none */
+	uint32_t flags;
+};
+
+#define PROFILE_FLAG_KERNEL 0x01 /* Sample hit kernel code */
+
+/* ioctl requests for /proc/profile; root only. */
+#define PROFILE_IOCTL_START   0x50F00001UL /* Reset rings and begin sampling */
+#define PROFILE_IOCTL_STOP    0x50F00002UL /* Stop sampling; samples remain readable */
+#define PROFILE_IOCTL_DIVISOR 0x50F00003UL /* argp: int*; sample every Nth timer tick */
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <_cheader.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 _Begin_C_Header
@@ -14,13 +15,51 @@ enum __ptrace_request {
 	PTRACE_PEEKDATA,
 	PTRACE_SIGNALS_ONLY_PLZ,
 	PTRACE_POKEDATA,
-	PTRACE_SINGLESTEP
+	PTRACE_SINGLESTEP,
+	PTRACE_RECORD,
+	PTRACE_READ_RECORDS,
+	PTRACE_SETHWBREAK,
+	PTRACE_CLEARHWBREAK
+};
+
+/**
+ * Hardware breakpoint configuration for PTRACE_SETHWBREAK.
+ *
+ * addr is the address to watch; data packs the slot (0-3), the
+ * trigger condition, and the watched length. Condition and length
+ * use the DR7 field encodings. Execute breakpoints must use LEN_1.
+ */
+#define PTRACE_HWBREAK_SLOT(n)   ((n) & 3)
+#define PTRACE_HWBREAK_EXEC      (0 << 2)
+#define PTRACE_HWBREAK_WRITE     (1 << 2)
+#define PTRACE_HWBREAK_RW        (3 << 2)
+#define PTRACE_HWBREAK_LEN_1     (0 << 4)
+#define PTRACE_HWBREAK_LEN_2     (1 << 4)
+#define PTRACE_HWBREAK_LEN_8     (2 << 4)
+#define PTRACE_HWBREAK_LEN_4     (3 << 4)
+
+/**
+ * Packed syscall record for PTRACE_RECORD mode.
+ *
+ * Instead of stopping the tracee at every syscall, the kernel appends
+ * one of these to a per-tracee ring at each syscall return; the tracer
+ * drains them at its leisure with PTRACE_READ_RECORDS (addr is the
+ * record count, data the destination buffer) and decodes them offline.
+ */
+struct ptrace_record {
+	uint64_t tsc;      /* Timestamp of the syscall return */
+	uint64_t args[5];
+	int64_t  result;
+	uint16_t syscall;
+	uint16_t unused;
+	uint32_t dropped;  /* Records lost before this one to a full ring */
 };
 
 enum __ptrace_event {
 	PTRACE_EVENT_SYSCALL_ENTER,
 	PTRACE_EVENT_SYSCALL_EXIT,
 	PTRACE_EVENT_SINGLESTEP,
+	PTRACE_EVENT_HWBREAK,
 };
 
 #ifndef __kernel__
@@ -9,6 +9,7 @@ _Begin_C_Header
 #define AF_UNSPEC 0
 #define AF_INET 1
 #define AF_RAW 2
+#define AF_UNIX 3
 
 #define SOCK_STREAM 1
 #define SOCK_DGRAM  2
@@ -23,6 +24,13 @@ _Begin_C_Header
 #define SO_KEEPALIVE 1
 #define SO_REUSEADDR 2
 #define SO_BINDTODEVICE 3
+#define SO_SNDBUF 4
+#define SO_RCVBUF 5
+#define SO_PEERCRED 6
+#define SO_TIMESTAMP 7
+
+#define SCM_RIGHTS 1
+#define SCM_TIMESTAMP 2
 
 typedef size_t socklen_t;
 
@@ -62,6 +70,33 @@ struct sockaddr_storage {
 	char _ss_pad[128];
 };
 
+/* Credentials of the process on the far end of an AF_UNIX socket,
+ * via getsockopt(SOL_SOCKET, SO_PEERCRED). */
+struct ucred {
+	pid_t pid;
+	uid_t uid;
+	gid_t gid;
+};
+
+/* Ancillary data for sendmsg/recvmsg; AF_UNIX sockets use this with
+ * SCM_RIGHTS to pass file descriptors. */
+struct cmsghdr {
+	size_t cmsg_len;    /* data byte count, including this header */
+	int    cmsg_level;
+	int    cmsg_type;
+};
+
+#define CMSG_ALIGN(len) (((len) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+#define CMSG_DATA(cmsg) ((unsigned char *)((struct cmsghdr *)(cmsg) + 1))
+#define CMSG_LEN(len)   (CMSG_ALIGN(sizeof(struct cmsghdr)) + (len))
+#define CMSG_SPACE(len) (CMSG_ALIGN(sizeof(struct cmsghdr)) + CMSG_ALIGN(len))
+#define CMSG_FIRSTHDR(mhdr) \
+	((mhdr)->msg_controllen >= sizeof(struct cmsghdr) ? (struct cmsghdr *)(mhdr)->msg_control : NULL)
+#define CMSG_NXTHDR(mhdr, cmsg) \
+	((char *)(cmsg) + CMSG_ALIGN((cmsg)->cmsg_len) + sizeof(struct cmsghdr) > \
+		(char *)(mhdr)->msg_control + (mhdr)->msg_controllen ? NULL : \
+		(struct cmsghdr *)((char *)(cmsg) + CMSG_ALIGN((cmsg)->cmsg_len)))
+
 #ifndef _KERNEL_
 extern ssize_t recv(int sockfd, void *buf, size_t len, int flags);
 extern ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen);
@@ -72,6 +107,7 @@ ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const struct
 ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags);
 
 extern int socket(int domain, int type, int protocol);
+extern int socketpair(int domain, int type, int protocol, int sv[2]);
 
 extern int bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 extern int accept(int sockfd, struct sockaddr * addr, socklen_t * addrlen);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <_cheader.h>
+#include <sys/types.h>
+
+_Begin_C_Header
+
+/* Combined fork+exec: launch an executable in a new process without
+ * duplicating the caller's address space. Descriptors 0-2 and the
+ * working directory are inherited. */
+extern pid_t spawnve(const char * path, char * const argv[], char * const envp[]);
+extern pid_t spawnvp(const char * file, char * const argv[]);
+
+_End_C_Header
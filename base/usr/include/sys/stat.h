@@ -76,6 +76,7 @@ struct stat  {
 
 extern int stat(const char *file, struct stat *st);
 extern int lstat(const char *path, struct stat *st);
+extern int lstat_batch(const char *base, const char *names, size_t names_len, struct stat *stats, int count);
 extern int fstat(int fd, struct stat *st);
 extern int mkdir(const char *pathname, mode_t mode);
 extern mode_t umask(mode_t mask);
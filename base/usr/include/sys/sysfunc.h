@@ -22,6 +22,8 @@
 #define TOARU_SYS_FUNC_SETVGACURSOR 13
 #define TOARU_SYS_FUNC_SETGSBASE    14
 #define TOARU_SYS_FUNC_NPROC        15
+#define TOARU_SYS_FUNC_SCSTATS      16
+#define TOARU_SYS_FUNC_FTRACE       17
 
 _Begin_C_Header
 extern int sysfunc(int command, char ** args);
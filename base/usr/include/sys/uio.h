@@ -0,0 +1,19 @@
+#pragma once
+
+#include <_cheader.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+_Begin_C_Header
+
+struct iovec {
+	void * iov_base;
+	size_t iov_len;
+};
+
+#define UIO_MAXIOV 1024
+
+extern ssize_t readv(int fd, const struct iovec * iov, int iovcnt);
+extern ssize_t writev(int fd, const struct iovec * iov, int iovcnt);
+
+_End_C_Header
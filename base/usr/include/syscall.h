@@ -87,6 +87,9 @@ DECL_SYSCALL1(setuid, unsigned int);
 DECL_SYSCALL5(getsockopt,int,int,int,void*,size_t*);
 DECL_SYSCALL0(reboot);
 DECL_SYSCALL3(readdir, int, int, void *);
+DECL_SYSCALL4(readdir_batch, int, long, long, void *);
+DECL_SYSCALL5(lstat_batch, char *, char *, long, void *, long);
+DECL_SYSCALL2(clock_gettime, long, void *);
 DECL_SYSCALL1(chdir, char *);
 DECL_SYSCALL2(getcwd, char *, size_t);
 DECL_SYSCALL3(clone, uintptr_t, uintptr_t, void *);
@@ -130,7 +133,23 @@ DECL_SYSCALL1(setgid, unsigned int);
 DECL_SYSCALL2(getgroups, int, int*);
 DECL_SYSCALL2(setgroups, int, const int*);
 DECL_SYSCALL1(times, struct tms*);
+DECL_SYSCALL2(setpriority, int, int);
+DECL_SYSCALL2(setaffinity, int, unsigned int);
+DECL_SYSCALL1(getaffinity, int);
+DECL_SYSCALL3(futex_wait, unsigned int *, unsigned int, int);
+DECL_SYSCALL2(futex_wake, unsigned int *, int);
+DECL_SYSCALL3(futex_requeue, unsigned int *, int, unsigned int *);
+DECL_SYSCALL5(mmap, uintptr_t, size_t, int, long, int);
+DECL_SYSCALL2(munmap, uintptr_t, size_t);
+DECL_SYSCALL3(readv, int, void *, int);
+DECL_SYSCALL3(writev, int, void *, int);
+DECL_SYSCALL4(sendfile, int, int, void *, size_t);
+DECL_SYSCALL1(fsync, int);
 DECL_SYSCALL4(ptrace, int, int, void*, void*);
+DECL_SYSCALL0(evset_create);
+DECL_SYSCALL3(evset_ctl, int, int, int);
+DECL_SYSCALL4(evset_wait, int, int *, int, int);
+DECL_SYSCALL3(spawn, char *, char **, char **);
 
 _End_C_Header
 
@@ -72,3 +72,23 @@
 #define SYS_GETGROUPS 69
 #define SYS_SETGROUPS 70
 #define SYS_TIMES 71
+#define SYS_SETPRIORITY 72
+#define SYS_SETAFFINITY 73
+#define SYS_GETAFFINITY 74
+#define SYS_FUTEX_WAIT 75
+#define SYS_FUTEX_WAKE 76
+#define SYS_MMAP 77
+#define SYS_MUNMAP 78
+#define SYS_READV 79
+#define SYS_WRITEV 80
+#define SYS_SENDFILE 81
+#define SYS_FSYNC 82
+#define SYS_EVSET_CREATE 83
+#define SYS_EVSET_CTL 84
+#define SYS_EVSET_WAIT 85
+#define SYS_SOCKETPAIR 86
+#define SYS_SPAWN 87
+#define SYS_FUTEX_REQUEUE 88
+#define SYS_READDIR_BATCH 89
+#define SYS_CLOCK_GETTIME 90
+#define SYS_LSTAT_BATCH 91
@@ -47,6 +47,9 @@ typedef int clockid_t;
 
 #define CLOCK_REALTIME  0
 #define CLOCK_MONOTONIC 1
+/* Tick-granular clocks that avoid a full clock read. */
+#define CLOCK_REALTIME_COARSE  5
+#define CLOCK_MONOTONIC_COARSE 6
 
 extern int clock_gettime(clockid_t clk_id, struct timespec *tp);
 extern int clock_getres(clockid_t clk_id, struct timespec *res);
@@ -34,6 +34,11 @@ typedef struct {
  *
  * Open a configuration file and read its contents.
  * Returns NULL if the requested file failed to open.
+ *
+ * Parsed files are cached per-process and validated against the
+ * file's mtime, so repeat loads of the same path are served as a
+ * copy of the cached parse. The returned config is always the
+ * caller's own: modify and free it as before.
  */
 extern confreader_t * confreader_load(const char * file);
 
@@ -0,0 +1,17 @@
+#pragma once
+/**
+ * @brief CRC32 (the zlib/gzip polynomial, reflected).
+ *
+ * Start with a crc of 0 and feed buffers in any chunking; the value
+ * returned after each call is the checksum so far. See lib/crc32.c.
+ */
+
+#include <_cheader.h>
+#include <stdint.h>
+#include <stddef.h>
+
+_Begin_C_Header
+
+extern uint32_t crc32_calculate(uint32_t crc, const void * data, size_t len);
+
+_End_C_Header
@@ -45,6 +45,16 @@ typedef struct context {
 	uint32_t stride;
 
 	uint32_t _true_stride;
+
+	/* Accumulated damage: bounding box of everything drawn since the
+	 * last flip (right/bottom exclusive; empty when x1 <= x0). Drawing
+	 * primitives always union their bounds into it; flip() only
+	 * consults it when track_damage is set. */
+	int32_t damage_x0;
+	int32_t damage_y0;
+	int32_t damage_x1;
+	int32_t damage_y1;
+	int32_t track_damage;
 } gfx_context_t;
 
 extern gfx_context_t * init_graphics_fullscreen();
@@ -62,6 +72,7 @@ extern uint32_t rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a);
 extern uint32_t alpha_blend(uint32_t bottom, uint32_t top, uint32_t mask);
 extern uint32_t alpha_blend_rgba(uint32_t bottom, uint32_t top);
 extern uint32_t framebuffer_stride(void);
+extern int framebuffer_refresh_rate(void);
 
 extern void flip(gfx_context_t * ctx);
 void clear_buffer(gfx_context_t * ctx);
@@ -90,6 +101,11 @@ extern void draw_sprite_alpha_paint(gfx_context_t * ctx, const sprite_t * sprite
 extern void draw_sprite_rotate(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, float rotation, float alpha);
 extern void draw_sprite_transform(gfx_context_t * ctx, const sprite_t * sprite, gfx_matrix_t matrix, float alpha);
 
+/* Sampling quality for draw_sprite_transform_quality */
+#define GFX_TRANSFORM_BILINEAR 0
+#define GFX_TRANSFORM_NEAREST  1
+extern void draw_sprite_transform_quality(gfx_context_t * ctx, const sprite_t * sprite, gfx_matrix_t matrix, float alpha, int quality);
+
 //extern void context_to_png(FILE * file, gfx_context_t * ctx);
 
 extern uint32_t premultiply(uint32_t color);
@@ -98,6 +114,11 @@ extern void gfx_add_clip(gfx_context_t * ctx, int32_t x, int32_t y, int32_t w, i
 extern void gfx_clear_clip(gfx_context_t * ctx);
 extern void gfx_no_clip(gfx_context_t * ctx);
 
+extern void gfx_damage(gfx_context_t * ctx, int32_t x, int32_t y, int32_t w, int32_t h);
+extern int gfx_fetch_damage(gfx_context_t * ctx, int32_t * x, int32_t * y, int32_t * w, int32_t * h);
+extern void gfx_reset_damage(gfx_context_t * ctx);
+extern void gfx_track_damage(gfx_context_t * ctx, int enable);
+
 extern uint32_t interp_colors(uint32_t bottom, uint32_t top, uint8_t interp);
 extern void draw_rounded_rectangle(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, int radius, uint32_t color);
 extern void draw_rectangle(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, uint16_t height, uint32_t color);
@@ -7,6 +7,7 @@ _Begin_C_Header
 
 extern sprite_t * icon_get_16(const char * name);
 extern sprite_t * icon_get_48(const char * name);
+extern void icon_cache_invalidate(void);
 
 _End_C_Header
 
@@ -32,6 +32,11 @@ struct inflate_context {
 
 	/* Output ringbuffer for backwards lookups */
 	struct huff_ring * ring;
+
+	/* Trailer values recorded by gzip_decompress, for callers that
+	 * want to verify the stream against their own running checksum */
+	uint32_t gzip_crc32;
+	uint32_t gzip_size;
 };
 
 int deflate_decompress(struct inflate_context * ctx);
@@ -6,5 +6,7 @@
 _Begin_C_Header
 
 extern int load_sprite_jpg(sprite_t * sprite, char * filename);
+extern int load_sprite_jpg_scaled(sprite_t * sprite, char * filename, int scale_shift);
+extern int load_sprite_jpg_fit(sprite_t * sprite, char * filename, int max_width, int max_height);
 
 _End_C_Header
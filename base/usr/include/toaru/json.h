@@ -50,4 +50,87 @@ extern struct JSON_Value * json_parse(const char *);
  */
 extern struct JSON_Value * json_parse_file(const char * filename);
 
+/*
+ * Streaming interface: instead of building a tree with an allocation
+ * per node, the parser calls back once per syntactic event. Strings
+ * and keys arrive as slices pointing into the input buffer, raw and
+ * undecoded - nothing is copied unless the caller keeps it, for which
+ * json_string_dup decodes a slice into an arena.
+ */
+
+#define JSON_EVENT_OBJECT_START 0
+#define JSON_EVENT_OBJECT_END   1
+#define JSON_EVENT_ARRAY_START  2
+#define JSON_EVENT_ARRAY_END    3
+#define JSON_EVENT_KEY          4
+#define JSON_EVENT_STRING       5
+#define JSON_EVENT_NUMBER       6
+#define JSON_EVENT_BOOL         7
+#define JSON_EVENT_NULL         8
+
+struct JSON_Slice {
+	const char * bytes;
+	size_t length;
+};
+
+struct JSON_Arena;
+
+/**
+ * json_stream_func_t
+ *
+ * Receives one parse event. @p slice is set for KEY and STRING events
+ * (escapes intact), NULL otherwise; @p number carries the value for
+ * NUMBER and BOOL events. @p depth is the current nesting level.
+ * Return 0 to continue; any other value stops the parse and is
+ * returned from json_stream.
+ */
+typedef int (*json_stream_func_t)(int event, const struct JSON_Slice * slice, double number, int depth, void * extra);
+
+/**
+ * json_stream
+ *
+ * Parse a string, calling @p func for each event. Returns 0 on
+ * success, -1 on a parse error, or the nonzero value @p func
+ * returned to stop early.
+ */
+extern int json_stream(const char * str, json_stream_func_t func, void * extra);
+
+/**
+ * json_stream_file
+ *
+ * Open a file path and stream its contents through @p func.
+ * (Convenience function; slices are only valid during the parse.)
+ */
+extern int json_stream_file(const char * filename, json_stream_func_t func, void * extra);
+
+/**
+ * json_arena_create
+ *
+ * Create a bump allocator for values kept out of a streaming parse;
+ * @p block_size is the granularity of the underlying allocations.
+ */
+extern struct JSON_Arena * json_arena_create(size_t block_size);
+
+/**
+ * json_arena_alloc
+ *
+ * Allocate @p size bytes from the arena. Never freed individually.
+ */
+extern void * json_arena_alloc(struct JSON_Arena * arena, size_t size);
+
+/**
+ * json_arena_free
+ *
+ * Release the arena and everything allocated from it.
+ */
+extern void json_arena_free(struct JSON_Arena * arena);
+
+/**
+ * json_string_dup
+ *
+ * Decode the escapes in a KEY or STRING slice into a NUL-terminated
+ * string allocated from @p arena. Returns NULL on a bad escape.
+ */
+extern char * json_string_dup(struct JSON_Arena * arena, const struct JSON_Slice * slice);
+
 _End_C_Header
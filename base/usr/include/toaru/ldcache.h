@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * @brief Format of /etc/ld.so.cache
+ *
+ * Written by ldconfig and consulted by ld.so to turn library names
+ * into full paths without probing every search directory. The file
+ * is a header, an array of bucket heads, an array of chained
+ * entries, and a string blob, in that order; the entry arrays are
+ * indexed by the sdbm hash of the library name.
+ */
+
+#include <_cheader.h>
+#include <stdint.h>
+
+_Begin_C_Header
+
+#define LD_CACHE_PATH    "/etc/ld.so.cache"
+#define LD_CACHE_MAGIC   "toaruldc"
+#define LD_CACHE_VERSION 1
+#define LD_CACHE_NONE    0xFFFFFFFF
+
+struct ld_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t nbuckets;
+	uint32_t nentries;
+	uint32_t strings_size;
+};
+
+struct ld_cache_entry {
+	uint32_t next; /* Next entry in this bucket, or LD_CACHE_NONE */
+	uint32_t name; /* String blob offset of the library name */
+	uint32_t path; /* String blob offset of the full path */
+};
+
+_End_C_Header
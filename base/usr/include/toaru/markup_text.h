@@ -9,4 +9,38 @@ int markup_string_height(const char * str);
 int markup_draw_string(gfx_context_t * ctx, int x, int y, const char * str, uint32_t color);
 void markup_text_init(void);
 
+/*
+ * Retained layouts for documents: the markup is parsed and measured
+ * once into a list of runs, line breaking is a separate (and cheap)
+ * pass over the cached measurements, and rendering takes a vertical
+ * range so only visible lines touch the text renderer.
+ */
+struct MarkupLayout;
+
+/* Parse @p str (may be NULL) into a new, not-yet-reflowed layout. */
+struct MarkupLayout * markup_layout_create(const char * str);
+
+/* Parse and measure more markup at the end of the document. */
+void markup_layout_append(struct MarkupLayout * layout, const char * str);
+
+/*
+ * Break the measured runs into lines at most @p width wide (<= 0 for
+ * no wrapping). A no-op if nothing changed; if text was appended at
+ * the same width, only lines from the first affected one are redone.
+ */
+void markup_layout_reflow(struct MarkupLayout * layout, int width);
+
+/* Laid-out document height and widest line, in pixels. */
+int markup_layout_height(struct MarkupLayout * layout);
+int markup_layout_width(struct MarkupLayout * layout);
+
+/*
+ * Draw the lines intersecting [y_min,y_max) (document coordinates)
+ * with the document origin at (x,y). @p color applies to runs without
+ * a <color> of their own.
+ */
+void markup_layout_render(gfx_context_t * ctx, struct MarkupLayout * layout, int x, int y, int y_min, int y_max, uint32_t color);
+
+void markup_layout_free(struct MarkupLayout * layout);
+
 _End_C_Header
@@ -71,6 +71,11 @@ struct MenuList {
 	int closed;
 	int flags;
 	int tail_offset;
+	/* Retained render of the window chrome and unhighlighted entries;
+	 * regenerated when @c generation moves past @c backing_generation. */
+	sprite_t * backing;
+	int generation;
+	int backing_generation;
 };
 
 struct MenuSet {
@@ -32,6 +32,16 @@ struct PanelWidget {
 	int (*draw)(struct PanelWidget *, gfx_context_t * ctx);
 	int (*update)(struct PanelWidget *);
 	int (*onkey)(struct PanelWidget *, struct yutani_msg_key_event *);
+
+	/* Change-driven updates: the panel core calls update() every
+	 * 'interval' seconds (0 = never), or when 'fd' becomes readable
+	 * (-1 = none), off one coalesced timer. Widgets set 'dirty' when
+	 * what they display actually changed; only dirty widgets are
+	 * repainted. See apps/panel.c. */
+	int interval;
+	time_t next_update;
+	int fd;
+	int dirty;
 };
 
 extern yutani_t * yctx;
@@ -19,6 +19,37 @@ typedef struct pex_header {
 	uint8_t data[];
 } pex_header_t;
 
+/* Shared-memory fast path: large payloads ride in a one-way shm ring
+ * and the exchange only carries a small descriptor packet, so the
+ * payload is copied once (into the ring) instead of twice through the
+ * kernel. One ring serves one sender/receiver pair, descriptors must
+ * be consumed in the order they arrive, and both ends have to opt in -
+ * small control messages keep the ordinary packet path. */
+#define PEX_SHM_MAGIC 0x78655053
+
+typedef struct pex_shm_ring {
+	uint32_t magic;
+	uint32_t size;          /* data capacity, not counting this header */
+	volatile uint64_t head; /* bytes produced, absolute */
+	volatile uint64_t tail; /* bytes consumed, absolute */
+	char name[64];
+	uint8_t data[];
+} pex_shm_ring_t;
+
+typedef struct pex_shm_descriptor {
+	uint32_t magic;         /* PEX_SHM_MAGIC */
+	uint32_t size;
+	uint64_t offset;        /* absolute ring position of the payload */
+	char name[64];          /* shm key, so the receiver can attach lazily */
+} pex_shm_descriptor_t;
+
+extern pex_shm_ring_t * pex_shm_create(const char * name, size_t size);
+extern pex_shm_ring_t * pex_shm_attach(const char * name);
+extern size_t pex_send_shm(FILE * sock, uintptr_t rcpt, pex_shm_ring_t * ring, size_t size, char * blob);
+extern int pex_packet_is_shm(pex_packet_t * packet);
+extern void * pex_shm_payload(pex_shm_ring_t * ring, pex_shm_descriptor_t * desc);
+extern void pex_shm_release(pex_shm_ring_t * ring, pex_shm_descriptor_t * desc);
+
 extern size_t pex_send(FILE * sock, uintptr_t rcpt, size_t size, char * blob);
 extern size_t pex_broadcast(FILE * sock, size_t size, char * blob);
 extern size_t pex_listen(FILE * sock, pex_packet_t * packet);
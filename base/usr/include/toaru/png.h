@@ -7,5 +7,10 @@ _Begin_C_Header
 
 extern int load_sprite_png(sprite_t * sprite, char * filename);
 
+/* As load_sprite_png, but calls back after each scanline is decoded
+ * and converted, so a viewer can paint rows as they arrive. */
+typedef void (*png_row_callback_t)(sprite_t * sprite, int row, void * extra);
+extern int load_sprite_png_stream(sprite_t * sprite, char * filename, png_row_callback_t callback, void * extra);
+
 _End_C_Header
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <_cheader.h>
+#include <stddef.h>
 #include <stdint.h>
 
 _Begin_C_Header
@@ -33,6 +34,8 @@ typedef struct {
 	void (*set_csr_on)(int);
 	void (*switch_buffer)(int);
 	void (*insert_delete_lines)(int);
+	/* Optional: emit a run of plain bytes in one call; falls back to writer() if NULL */
+	void (*write_run)(const char *, size_t);
 } term_callbacks_t;
 
 typedef struct {
@@ -116,6 +119,7 @@ typedef struct {
 
 extern term_state_t * ansi_init(term_state_t * s, int w, int y, term_callbacks_t * callbacks_in);
 extern void ansi_put(term_state_t * s, char c);
+extern void ansi_write(term_state_t * s, const char * buf, size_t len);
 
 _End_C_Header
 
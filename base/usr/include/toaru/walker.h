@@ -0,0 +1,33 @@
+#pragma once
+/**
+ * @brief Directory tree walker built on the batched syscalls.
+ *
+ * Enumerates a tree with one readdir_batch sequence per directory and
+ * one lstat_batch call per run of entries, instead of a stat syscall
+ * per name. See lib/walker.c.
+ */
+
+#include <_cheader.h>
+#include <sys/stat.h>
+
+_Begin_C_Header
+
+/* Event passed to the callback for each object encountered. */
+#define WALKER_FILE      0 /* Anything that is not a directory */
+#define WALKER_DIR_ENTER 1 /* Directory, before its contents */
+#define WALKER_DIR_LEAVE 2 /* Directory, after its contents; st is NULL */
+
+/* Callback return values for WALKER_DIR_ENTER; anything negative
+ * aborts the walk from any event. */
+#define WALKER_CONTINUE 0
+#define WALKER_PRUNE    1 /* Skip this directory's contents */
+
+typedef int (*walker_func_t)(int event, const char * path, struct stat * st, void * extra);
+
+extern int walker_walk(const char * path, walker_func_t func, void * extra);
+
+/* Walks the immediate subtrees of @p path on @p threads worker
+ * threads; the callback fires concurrently and must be thread-safe. */
+extern int walker_walk_threaded(const char * path, int threads, walker_func_t func, void * extra);
+
+_End_C_Header
@@ -82,6 +82,7 @@ static int yutani_is_closing_animation[] = {
 /* Debug Options */
 #define YUTANI_DEBUG_WINDOW_BOUNDS 1
 #define YUTANI_DEBUG_WINDOW_SHAPES 1
+#define YUTANI_DEBUG_FRAME_HUD     1
 
 /* Command line flag values */
 struct {
@@ -161,6 +162,20 @@ typedef struct YutaniServerWindow {
 
 	/* Window is hidden? */
 	int hidden;
+
+	/* Per-tile opaque coverage of the canvas, for occlusion culling */
+	uint8_t * opaque_tiles;
+	int opaque_w;
+	int opaque_h;
+
+	/* Client wants a FRAME_COMPLETE event after the next displayed frame */
+	int frame_requested;
+
+	/* For double-buffered windows, which half of the canvas is on display */
+	int front;
+
+	/* Microseconds spent blitting this window, for the frame HUD */
+	uint64_t blit_us;
 } yutani_server_window_t;
 
 typedef struct YutaniGlobals {
@@ -286,6 +301,9 @@ typedef struct YutaniGlobals {
 	int debug_bounds;
 	int debug_shapes;
 
+	/* Toggle for the frame timing HUD */
+	int debug_hud;
+
 	/* If the next rendered frame should be saved as a screenshot */
 	int screenshot_frame;
 
@@ -308,6 +326,20 @@ typedef struct YutaniGlobals {
 
 	int reload_renderer;
 	uint8_t active_modifiers;
+
+	/* Tile-based damage tracking for the renderer */
+	int tiles_x;
+	int tiles_y;
+	uint8_t * tile_dirty;
+	uint32_t * tile_hashes;
+
+	/* Frame pacing interval in milliseconds, from the display refresh rate */
+	int frame_interval;
+
+	/* Shared-memory screen capture buffer and the clients using it */
+	struct yutani_capture * capture;
+	uint32_t capture_bufid;
+	list_t * capture_clients;
 } yutani_globals_t;
 
 struct key_bind {
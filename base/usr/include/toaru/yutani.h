@@ -43,6 +43,12 @@ typedef struct yutani_context {
 
 	/* server identifier string */
 	char * server_ident;
+
+	/* Outgoing message queue; when buffering is enabled, hot-path
+	 * messages coalesce here and go out in one submission on flush. */
+	int    send_buffered;
+	size_t send_length;
+	char * send_buffer;
 } yutani_t;
 
 typedef struct yutani_window {
@@ -82,6 +88,17 @@ typedef struct yutani_window {
 	yutani_t * ctx;
 
 	int32_t mouse_state;
+
+	/*
+	 * Double buffering state: the canvas is twice the window size,
+	 * `buffer` always points at the half we are drawing into, and
+	 * each half tracks how many flips ago it was last drawn so
+	 * clients can repaint only what went stale.
+	 */
+	char * buffer_base;
+	uint32_t double_buffered;
+	uint32_t swaps;
+	uint32_t ages[2];
 } yutani_window_t;
 
 typedef struct yutani_message {
@@ -176,6 +193,22 @@ struct yutani_msg_flip_region {
 	int32_t height;
 };
 
+/* Maximum rectangles in one YUTANI_MSG_FLIP_REGIONS message */
+#define YUTANI_MAX_FLIP_REGIONS 32
+
+struct yutani_damage_rect {
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+};
+
+struct yutani_msg_flip_regions {
+	yutani_wid_t wid;
+	uint32_t count;
+	struct yutani_damage_rect rects[];
+};
+
 struct yutani_msg_window_resize {
 	yutani_wid_t wid;
 	uint32_t width;
@@ -256,6 +289,68 @@ struct yutani_msg_clipboard {
 	char content[];
 };
 
+struct yutani_msg_frame_complete {
+	yutani_wid_t wid;
+	uint32_t timestamp;
+};
+
+/* Number of recent frame times carried by YUTANI_MSG_FRAME_STATS */
+#define YUTANI_FRAME_STATS_COUNT 64
+
+struct yutani_msg_frame_stats {
+	uint32_t frames;       /* total frames composited since the server started */
+	uint32_t last_frame_us;/* composite+flip time of the most recent frame */
+	uint32_t last_damage;  /* damaged pixels in the most recent frame */
+	uint32_t last_tiles;   /* damage tiles composited in the most recent frame */
+	uint32_t last_windows; /* windows blitted in the most recent frame */
+	uint32_t frame_us[YUTANI_FRAME_STATS_COUNT]; /* recent frame times, oldest first */
+};
+
+struct yutani_msg_capture_init {
+	uint32_t bufid;  /* shared memory buffer identifier; 0 if capture failed */
+	uint32_t width;
+	uint32_t height;
+};
+
+/* Damage records retained in the capture buffer's ring */
+#define YUTANI_CAPTURE_DAMAGE_COUNT 32
+
+struct yutani_capture_damage {
+	uint32_t seq; /* frame sequence this damage belongs to */
+	int32_t x;
+	int32_t y;
+	int32_t width;
+	int32_t height;
+};
+
+/*
+ * Shared-memory screen capture buffer.
+ *
+ * The server keeps a 32bpp mirror of the screen in this read-only
+ * region and copies only the regions it composited into it, so a
+ * recorder never pulls pixels through the message channel. After
+ * each captured frame @c seq is incremented; the ring of damage
+ * records describes what changed in recent frames. A reader that has
+ * seen sequence S should apply the records with seq > S, or treat
+ * the whole screen as stale if it has fallen more than
+ * YUTANI_CAPTURE_DAMAGE_COUNT frames behind. Pixels are written
+ * before @c seq, but a reader racing the server may still observe a
+ * partially-copied frame; re-check @c seq after copying. When
+ * @c active drops to 0 the server has abandoned the buffer (display
+ * resized or capture stopped) and capture should be restarted.
+ */
+struct yutani_capture {
+	uint32_t active;
+	uint32_t bufid;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;      /* bytes per row of @c data */
+	uint32_t seq;         /* completed frame count; 0 until the first copy */
+	uint32_t damage_next; /* next slot in the damage ring to be written */
+	struct yutani_capture_damage damage[YUTANI_CAPTURE_DAMAGE_COUNT];
+	uint32_t data[];
+};
+
 /* Magic value */
 #define YUTANI_MSG__MAGIC 0xABAD1DEA
 
@@ -274,6 +369,7 @@ struct yutani_msg_clipboard {
 #define YUTANI_MSG_WINDOW_MOUSE_EVENT  0x0000000C
 #define YUTANI_MSG_FLIP_REGION         0x0000000D
 #define YUTANI_MSG_WINDOW_NEW_FLAGS    0x0000000E
+#define YUTANI_MSG_FLIP_REGIONS        0x0000000F
 
 #define YUTANI_MSG_RESIZE_REQUEST      0x00000010
 #define YUTANI_MSG_RESIZE_OFFER        0x00000011
@@ -303,6 +399,8 @@ struct yutani_msg_clipboard {
 
 #define YUTANI_MSG_CLIPBOARD           0x00000060
 
+#define YUTANI_MSG_QUERY_FRAME_STATS   0x00000070
+
 #define YUTANI_MSG_GOODBYE             0x000000F0
 
 /* Special request (eg. one-off single-shot requests like "please maximize me" */
@@ -311,6 +409,9 @@ struct yutani_msg_clipboard {
 /* Server responses */
 #define YUTANI_MSG_WELCOME             0x00010001
 #define YUTANI_MSG_WINDOW_INIT         0x00010002
+#define YUTANI_MSG_FRAME_COMPLETE      0x00010003
+#define YUTANI_MSG_FRAME_STATS         0x00010004
+#define YUTANI_MSG_CAPTURE_INIT        0x00010005
 
 /*
  * YUTANI_ZORDER
@@ -481,6 +582,10 @@ struct yutani_msg_clipboard {
 #define YUTANI_WINDOW_FLAG_DIALOG_ANIMATION (1 << 4)
 #define YUTANI_WINDOW_FLAG_NO_ANIMATION     (1 << 5)
 
+/* The window canvas holds two buffers; flips swap which one the
+ * server displays, and the client repaints only stale regions. */
+#define YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED  (1 << 6)
+
 /* YUTANI_SPECIAL_REQUEST
  *
  * Special one-off single-shot request messages.
@@ -492,6 +597,15 @@ struct yutani_msg_clipboard {
 
 #define YUTANI_SPECIAL_REQUEST_RELOAD       20
 
+/* One-shot: deliver a FRAME_COMPLETE event for this window
+ * after the next displayed frame; re-arm each time you draw. */
+#define YUTANI_SPECIAL_REQUEST_FRAME_NEXT   30
+
+/* Start or stop mirroring the screen into a shared-memory capture
+ * buffer; START is answered with a CAPTURE_INIT message. */
+#define YUTANI_SPECIAL_REQUEST_CAPTURE_START 40
+#define YUTANI_SPECIAL_REQUEST_CAPTURE_STOP  41
+
 /*
  * YUTANI_RESIZE
  *
@@ -518,6 +632,8 @@ extern yutani_msg_t * yutani_poll_async(yutani_t * y);
 extern size_t yutani_query(yutani_t * y);
 
 extern int yutani_msg_send(yutani_t * y, yutani_msg_t * msg);
+extern void yutani_flush(yutani_t * y);
+extern int yutani_set_buffered(yutani_t * y, int buffered);
 extern yutani_t * yutani_context_create(FILE * socket);
 extern yutani_t * yutani_init(void);
 extern yutani_window_t * yutani_window_create(yutani_t * y, int width, int height);
@@ -528,6 +644,7 @@ extern void yutani_window_move_relative(yutani_t * yctx, yutani_window_t * windo
 extern void yutani_close(yutani_t * y, yutani_window_t * win);
 extern void yutani_set_stack(yutani_t *, yutani_window_t *, int);
 extern void yutani_flip_region(yutani_t *, yutani_window_t * win, int32_t x, int32_t y, int32_t width, int32_t height);
+extern void yutani_flip_regions(yutani_t *, yutani_window_t * win, uint32_t count, const struct yutani_damage_rect * rects);
 extern void yutani_window_resize(yutani_t * yctx, yutani_window_t * window, uint32_t width, uint32_t height);
 extern void yutani_window_resize_offer(yutani_t * yctx, yutani_window_t * window, uint32_t width, uint32_t height);
 extern void yutani_window_resize_accept(yutani_t * yctx, yutani_window_t * window, uint32_t width, uint32_t height);
@@ -537,6 +654,9 @@ extern void yutani_window_advertise_icon(yutani_t * yctx, yutani_window_t * wind
 extern void yutani_subscribe_windows(yutani_t * y);
 extern void yutani_unsubscribe_windows(yutani_t * y);
 extern void yutani_query_windows(yutani_t * y);
+extern void yutani_query_frame_stats(yutani_t * y);
+extern struct yutani_capture * yutani_capture_start(yutani_t * y);
+extern void yutani_capture_stop(yutani_t * y, struct yutani_capture * capture);
 extern void yutani_session_end(yutani_t * y);
 extern void yutani_focus_window(yutani_t * y, yutani_wid_t wid);
 extern void yutani_key_bind(yutani_t * yctx, kbd_key_t key, kbd_mod_t mod, int response);
@@ -548,6 +668,7 @@ extern void yutani_window_show_mouse(yutani_t * yctx, yutani_window_t * window,
 extern void yutani_window_resize_start(yutani_t * yctx, yutani_window_t * window, yutani_scale_direction_t direction);
 extern void yutani_special_request(yutani_t * yctx, yutani_window_t * window, uint32_t request);
 extern void yutani_special_request_wid(yutani_t * yctx, yutani_wid_t wid, uint32_t request);
+extern int yutani_window_buffer_age(yutani_window_t * window);
 extern void yutani_set_clipboard(yutani_t * yctx, char * content);
 extern FILE * yutani_open_clipboard(yutani_t * yctx);
 
@@ -99,6 +99,7 @@ extern unsigned int alarm(unsigned int seconds);
 extern void *sbrk(intptr_t increment);
 
 extern void sync(void);
+extern int fsync(int fd);
 extern int truncate(const char *, off_t);
 
 #define _PC_PATH_MAX 1
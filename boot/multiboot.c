@@ -517,6 +517,7 @@ static void finish_boot(void) {
 
 extern void do_bios_call(uint32_t function, uint32_t arg1);
 extern int bios_call(char * into, uint32_t sector);
+extern int bios_call_batch(char * into, uint32_t sector, uint32_t count);
 
 static int spin_x = 0;
 static void spin(void) {
@@ -572,10 +573,11 @@ done:
 	kernel_load_start = (char*)(DATA_LOAD_BASE + dir_entry->extent_start_LSB * ISO_SECTOR_SIZE);
 
 	print("Loading kernel... "); spin_x = x;
-	for (int i = 0, j = 0; i < dir_entry->extent_length_LSB; j++) {
-		if (!(j & 0x3FF)) spin();
-		bios_call(kernel_load_start + i, dir_entry->extent_start_LSB + j);
-		i += ISO_SECTOR_SIZE;
+	uint32_t kernel_sectors = (dir_entry->extent_length_LSB + ISO_SECTOR_SIZE - 1) / ISO_SECTOR_SIZE;
+	for (uint32_t j = 0; j < kernel_sectors; j += 64) {
+		spin();
+		uint32_t chunk = kernel_sectors - j > 64 ? 64 : kernel_sectors - j;
+		bios_call_batch(kernel_load_start + j * ISO_SECTOR_SIZE, dir_entry->extent_start_LSB + j, chunk);
 	}
 	print("\n");
 
@@ -589,10 +591,11 @@ done:
 	ramdisk_off = DATA_LOAD_BASE + dir_entry->extent_start_LSB * ISO_SECTOR_SIZE;
 
 	print("Loading ramdisk... "); spin_x = x;
-	for (int i = 0, j = 0; i < dir_entry->extent_length_LSB; j++) {
-		if (!(j & 0x3FF)) spin();
-		bios_call((char*)(ramdisk_off + i), dir_entry->extent_start_LSB + j);
-		i += ISO_SECTOR_SIZE;
+	uint32_t ramdisk_sectors = (dir_entry->extent_length_LSB + ISO_SECTOR_SIZE - 1) / ISO_SECTOR_SIZE;
+	for (uint32_t j = 0; j < ramdisk_sectors; j += 64) {
+		spin();
+		uint32_t chunk = ramdisk_sectors - j > 64 ? 64 : ramdisk_sectors - j;
+		bios_call_batch((char*)(ramdisk_off + j * ISO_SECTOR_SIZE), dir_entry->extent_start_LSB + j, chunk);
 	}
 	print("\n");
 
@@ -172,6 +172,35 @@ int bios_call(char * into, uint32_t sector) {
 	memcpy(into, disk_space, 2048);
 }
 
+/*
+ * Batched reads for the big transfers (kernel, ramdisk). Each trip
+ * through do_bios_call costs a full switch to real mode and back, so
+ * reading one 2KB sector at a time dominates boot time on real
+ * hardware. Pull up to 16 ISO sectors (32KB) per INT 13h extended
+ * read instead, through a bounce buffer in free conventional memory -
+ * the DAP buffer pointer is segment:offset, so it has to live below
+ * 1MB, and using a fixed segment keeps a full transfer from crossing
+ * a 64KB offset boundary, which some BIOSes refuse.
+ */
+#define BATCH_BOUNCE_SEG  0x5000 /* Flat 0x50000; above us, below the EBDA. */
+#define BATCH_SECTORS     16
+
+int bios_call_batch(char * into, uint32_t sector, uint32_t count) {
+	while (count) {
+		uint32_t chunk = count > BATCH_SECTORS ? BATCH_SECTORS : count;
+		dap_sectors = chunk * (2048 / drive_params_bps);
+		dap_buffer = (uint32_t)BATCH_BOUNCE_SEG << 16;
+		dap_lba_low = sector * (2048 / drive_params_bps);
+		dap_lba_high = 0;
+		do_bios_call(1,0);
+		memcpy(into, (void*)(BATCH_BOUNCE_SEG << 4), chunk * ISO_SECTOR_SIZE);
+		into += chunk * ISO_SECTOR_SIZE;
+		sector += chunk;
+		count -= chunk;
+	}
+	return 0;
+}
+
 iso_9660_volume_descriptor_t * root = NULL;
 iso_9660_directory_entry_t * dir_entry = NULL;
 static char * dir_entries = NULL;
@@ -24,6 +24,9 @@ uint64_t arch_boot_time = 0; /**< Time (in seconds) according to the CMOS right
 uint64_t tsc_basis_time = 0; /**< Accumulated time (in microseconds) on the TSC, when we timed it; eg. how long did boot take */
 uint64_t tsc_mhz = 3500;     /**< MHz rating we determined for the TSC. Usually also the core speed? */
 
+static volatile uint64_t coarse_time_sec = 0;  /**< Wall time as of the last timer tick */
+static volatile uint64_t coarse_time_usec = 0;
+
 /* Crusty old CMOS code follows. */
 
 #define from_bcd(val)  ((val / 16) * 10 + (val & 0xf))
@@ -276,6 +279,7 @@ void arch_clock_initialize(void) {
 	tsc_mhz = (end - start) / 10000;
 	if (tsc_mhz == 0) tsc_mhz = 2000; /* uh oh */
 	tsc_basis_time = start / tsc_mhz;
+	coarse_time_sec = arch_boot_time; /* valid before the first tick */
 
 	dprintf("tsc: TSC timed at %lu MHz..\n", tsc_mhz);
 	dprintf("tsc: Boot time is %lus.\n", arch_boot_time);
@@ -358,6 +362,17 @@ void relative_time(unsigned long seconds, unsigned long subseconds, unsigned lon
 static uint64_t time_slice_basis = 0; /**< When the last clock update happened */
 static spin_lock_t clock_lock = { 0 }; /**< Allow only one core to do this */
 
+/**
+ * @brief Wall clock time as of the last timer tick.
+ *
+ * Tick-granular (10ms at our 100Hz timer), but doesn't need to read
+ * or scale the TSC; backs the "coarse" clock ids.
+ */
+uint64_t arch_coarse_time(uint64_t * usec) {
+	if (usec) *usec = coarse_time_usec;
+	return coarse_time_sec;
+}
+
 /**
  * @brief Update the global timer tick values.
  *
@@ -374,6 +389,9 @@ void arch_update_clock(void) {
 	uint64_t timer_ticks, timer_subticks;
 	update_ticks(clock_ticks, &timer_ticks, &timer_subticks);
 
+	coarse_time_sec  = arch_boot_time + timer_ticks;
+	coarse_time_usec = timer_subticks;
+
 	/**
 	 * Update per-process quarter-second usage statistics
 	 *
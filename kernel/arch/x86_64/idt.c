@@ -23,6 +23,8 @@
 #include <kernel/hashmap.h>
 #include <kernel/module.h>
 #include <kernel/ksym.h>
+#include <kernel/profile.h>
+#include <kernel/counters.h>
 
 #include <sys/time.h>
 #include <sys/utsname.h>
@@ -241,9 +243,8 @@ extern char end[];
 /**
  * @brief Find the closest preceding symbol to an address.
  *
- * Scans the kernel symbol table to find the closest preceding
- * symbol to the address @p ip and stores its name in @p name,
- * returning the actual address of the symbol.
+ * Binary search over the sorted kernel symbol table; stores the
+ * matching symbol's name in @p name and returns its address.
  *
  * As this uses the kernel symbol linkage table, it is only aware
  * of exported functions and objects, and can not provide any
@@ -254,21 +255,7 @@ extern char end[];
  * @return Address of matching symbol
  */
 static uintptr_t matching_symbol(uintptr_t ip, char ** name) {
-	hashmap_t * symbols = ksym_get_map();
-	uintptr_t best_match = 0;
-	for (size_t i = 0; i < symbols->size; ++i) {
-		hashmap_entry_t * x = symbols->entries[i];
-		while (x) {
-			void* sym_addr = x->value;
-			char* sym_name = x->key;
-			if ((uintptr_t)sym_addr < ip && (uintptr_t)sym_addr > best_match) {
-				best_match = (uintptr_t)sym_addr;
-				*name = sym_name;
-			}
-			x = x->next;
-		}
-	}
-	return best_match;
+	return ksym_find_nearest(ip, (const char **)name);
 }
 
 /**
@@ -446,12 +433,25 @@ static void panic(const char * desc, struct regs * r, uintptr_t faulting_address
  * @return Register context, which should be unmodified.
  */
 static struct regs * _debug_int(struct regs * r) {
+	/* Figure out why we faulted: DR6 low bits mean a hardware
+	 * breakpoint slot fired, otherwise this was a single-step. */
+	uintptr_t dr6, zero = 0;
+	asm volatile ("mov %%dr6, %0" : "=r"(dr6));
+	asm volatile ("mov %0, %%dr6" :: "r"(zero));
+
 	/* Unset the debug flag */
 	r->rflags &= ~(1 << 8);
 
-	/* If the current process was debugging, trigger a SINGLESTEP event. */
+	/* If the current process was debugging, trigger the right event. */
 	if (this_core->current_process->flags & PROC_FLAG_TRACE_SIGNALS) {
-		ptrace_signal(SIGTRAP, PTRACE_EVENT_SINGLESTEP);
+		if (dr6 & 0xF) {
+			/* Resume flag, so an execute breakpoint doesn't refire
+			 * on the very instruction we're returning to. */
+			r->rflags |= (1 << 16);
+			ptrace_signal(SIGTRAP, PTRACE_EVENT_HWBREAK);
+		} else {
+			ptrace_signal(SIGTRAP, PTRACE_EVENT_SINGLESTEP);
+		}
 	}
 
 	/* Return from interrupt */
@@ -518,9 +518,20 @@ static void _page_fault(struct regs * r) {
 		/* This is probably a COW page? */
 		extern void mmu_copy_on_write(uintptr_t address);
 		mmu_copy_on_write(faulting_address);
+		counter_bump(COUNTER_FAULT_COW);
 		return;
 	}
 
+	/* A not-present fault in a demand-paged executable segment gets its
+	 * page loaded now. Checked before the kernel-fault panic, as syscalls
+	 * can legitimately touch user buffers in pages not yet loaded. */
+	if (!(r->err_code & 1) && faulting_address < 0x800000000000UL) {
+		extern int elf_demand_load(uintptr_t address);
+		if (elf_demand_load(faulting_address)) { counter_bump(COUNTER_FAULT_DEMAND); return; }
+		extern int shm_demand_fault(uintptr_t address);
+		if (shm_demand_fault(faulting_address)) { counter_bump(COUNTER_FAULT_DEMAND); return; }
+	}
+
 	/* Was this a kernel page fault? Those are always a panic. */
 	if (!this_core->current_process || r->cs == 0x08) {
 		panic("Page fault in kernel", r, faulting_address);
@@ -531,10 +542,12 @@ static void _page_fault(struct regs * r) {
 	/* Quietly map more stack if it was a viable stack address. */
 	if (faulting_address < 0x800000000000 && faulting_address > 0x700000000000) {
 		map_more_stack(faulting_address & 0xFFFFffffFFFFf000);
+		counter_bump(COUNTER_FAULT_STACK);
 		return;
 	}
 
 	/* Otherwise, segfault the current process. */
+	counter_bump(COUNTER_FAULT_SEGV);
 	send_signal(this_core->current_process->id, SIGSEGV, 1);
 }
 
@@ -574,6 +587,7 @@ static struct regs * _syscall_entrypoint(struct regs * r) {
 static struct regs * _local_timer(struct regs * r) {
 	extern void arch_update_clock(void);
 	arch_update_clock();
+	profile_tick(r->rip, r->cs == 0x08);
 	switch_task(1);
 	return r;
 }
@@ -614,6 +628,25 @@ static void _handle_irq(struct regs * r, int irq) {
 #define EXC(i,n) case i: _exception(r, n); break;
 #define IRQ(i) case i: _handle_irq(r,i-32); break;
 
+/**
+ * @brief Bank system time before an interrupt returns to user mode.
+ *
+ * Without this, kernel time only ever materialized in time_sys when a
+ * context switch happened to occur during the kernel entry; a syscall
+ * that ran to completion was accounted entirely as user time. Short
+ * syscall-heavy processes looked deceptively cheap in 'top'.
+ */
+static struct regs * _kernel_exit(struct regs * r) {
+	if (r->cs != 0x08 && this_core->current_process && this_core->current_process->time_switch) {
+		uint64_t pTime = arch_perf_timer();
+		if (this_core->current_process->time_switch < pTime) {
+			this_core->current_process->time_sys += pTime - this_core->current_process->time_switch;
+		}
+		this_core->current_process->time_switch = 0;
+	}
+	return r;
+}
+
 struct regs * isr_handler(struct regs * r) {
 	this_core->interrupt_registers = r;
 
@@ -623,7 +656,7 @@ struct regs * isr_handler(struct regs * r) {
 
 	switch (r->int_no) {
 		EXC(0,"divide-by-zero");
-		case 1: return _debug_int(r);
+		case 1: return _kernel_exit(_debug_int(r));
 		/* NMI doesn't reach here, we use it as a panic signal. */
 		EXC(3,"breakpoint"); /* TODO: This should map to a ptrace event */
 		EXC(4,"overflow");
@@ -669,11 +702,12 @@ struct regs * isr_handler(struct regs * r) {
 		IRQ(47);
 
 		/* Local interrupts that make it here. */
-		case 123: return _local_timer(r);
-		case 127: return _syscall_entrypoint(r);
+		case 123: return _kernel_exit(_local_timer(r));
+		case 127: return _kernel_exit(_syscall_entrypoint(r));
 
 		/* Other interrupts that don't make it here:
-		 *   124: TLB shootdown, we just reload CR3 in the handler.
+		 *   124: TLB shootdown; the handler reloads CR3, or flushes all
+	 *        PCID contexts with INVPCID when tagging is enabled.
 		 *   125: Fatal signal, jumps straight to a cli/hlt loop, though I think this just yields an NMI instead?
 		 *   126: Quiet wakeup, do we even use this anymore?
 		 */
@@ -681,13 +715,13 @@ struct regs * isr_handler(struct regs * r) {
 		default: panic("Unexpected interrupt",r,0);
 	}
 
-	if (this_core->current_process == this_core->kernel_idle_task && process_queue && process_queue->head) {
+	if (this_core->current_process == this_core->kernel_idle_task && process_queue_has_work()) {
 		/* If this is kidle and we got here, instead of finishing the interrupt
 		 * we can just switch task and there will probably be something else
 		 * to run that was awoken by the interrupt. */
 		switch_next();
 	}
 
-	return r;
+	return _kernel_exit(r);
 }
 
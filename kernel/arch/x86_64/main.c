@@ -18,10 +18,13 @@
 #include <kernel/video.h>
 #include <kernel/generic.h>
 #include <kernel/gzip.h>
+#include <kernel/lz4.h>
 #include <kernel/ramdisk.h>
 #include <kernel/args.h>
 #include <kernel/ksym.h>
 #include <kernel/misc.h>
+#include <kernel/boottrace.h>
+#include <kernel/ftrace.h>
 #include <kernel/version.h>
 
 #include <kernel/arch/x86_64/ports.h>
@@ -225,6 +228,9 @@ static void symbols_install(void) {
 		ksym_bind(k->name, (void*)k->addr);
 		k = (kernel_symbol_t *)((uintptr_t)k + sizeof *k + strlen(k->name) + 1);
 	}
+	/* Build the sorted address array now, so backtraces never have to
+	 * allocate to rebuild it in a panic path. */
+	ksym_sort();
 }
 
 /**
@@ -277,7 +283,32 @@ void fpu_initialize(void) {
 
 static void mount_ramdisk(uintptr_t addr, size_t len) {
 	uint8_t * data = mmu_map_from_physical(addr);
-	if (data[0] == 0x1F && data[1] == 0x8B) {
+	if (len > 4 && data[0] == 0x04 && data[1] == 0x22 && data[2] == 0x4D && data[3] == 0x18) {
+		/* LZ4 frame - the fast option; see util/createramdisk.py */
+		dprintf("multiboot: Decompressing initial ramdisk (lz4)...\n");
+		size_t decompressedSize = lz4_content_size(data, len);
+		if (!decompressedSize) {
+			dprintf("lz4: frame header is missing a content size\n");
+			return;
+		}
+		size_t pageCount = ((decompressedSize + 0xFFF) & ~(0xFFF)) >> 12;
+		uintptr_t physicalAddress = mmu_allocate_n_frames(pageCount) << 12;
+		if (physicalAddress == (uintptr_t)-1) {
+			dprintf("lz4: failed to allocate pages\n");
+			return;
+		}
+		if (lz4_decompress(data, len, mmu_map_from_physical(physicalAddress), decompressedSize)) {
+			dprintf("lz4: failed to decompress payload\n");
+			return;
+		}
+		ramdisk_mount(physicalAddress, decompressedSize);
+		dprintf("multiboot: Decompressed %lu kB to %zu kB.\n",
+			(len) / 1024,
+			(decompressedSize) / 1024);
+		for (size_t j = addr; j < addr + len; j += 0x1000) {
+			mmu_frame_clear(j);
+		}
+	} else if (data[0] == 0x1F && data[1] == 0x8B) {
 		/* Yes - decompress it first */
 		dprintf("multiboot: Decompressing initial ramdisk...\n");
 		uint32_t decompressedSize = *(uint32_t*)mmu_map_from_physical(addr + len - sizeof(uint32_t));
@@ -385,7 +416,8 @@ void arch_framebuffer_initialize(void) {
 	extern uint16_t lfb_resolution_b;
 
 	if (!mboot_is_2) {
-		lfb_vid_memory = mmu_map_from_physical(mboot_struct->framebuffer_addr);
+		lfb_vid_memory = mmu_map_wc_region(mboot_struct->framebuffer_addr,
+			(size_t)mboot_struct->framebuffer_pitch * mboot_struct->framebuffer_height);
 		lfb_resolution_x = mboot_struct->framebuffer_width;
 		lfb_resolution_y = mboot_struct->framebuffer_height;
 		lfb_resolution_s = mboot_struct->framebuffer_pitch;
@@ -393,7 +425,7 @@ void arch_framebuffer_initialize(void) {
 	} else {
 		struct MB2_Framebuffer * fb = mboot2_find_tag(mboot_struct, 8);
 		if (fb) {
-			lfb_vid_memory = mmu_map_from_physical(fb->addr);
+			lfb_vid_memory = mmu_map_wc_region(fb->addr, (size_t)fb->pitch * fb->height);
 			lfb_resolution_x = fb->width;
 			lfb_resolution_y = fb->height;
 			lfb_resolution_s = fb->pitch;
@@ -424,8 +456,11 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 	/* Initialize GS base */
 	arch_set_core_base((uintptr_t)&processor_local_data[0]);
 
+	boot_trace_event("kmain");
+
 	/* Time the TSC and get the initial boot time from the RTC. */
 	arch_clock_initialize();
+	boot_trace_event("clock calibrated");
 
 	/* Parse multiboot data so we can get memory map, modules, command line, etc. */
 	if (mboot_mag == 0x36d76289) {
@@ -439,10 +474,14 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 
 	/* memCount and maxAddress come from multiboot data */
 	mmu_init(highest_valid_address, highest_kernel_address);
+	boot_trace_event("mmu");
 
 	/* With the MMU initialized, set up things required for the scheduler. */
 	pat_initialize();
+	mmu_enable_pcid();
 	symbols_install();
+	ftrace_initialize();
+	boot_trace_event("symbols");
 	gdt_install();
 	idt_install();
 	fpu_initialize();
@@ -450,11 +489,10 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 
 	/* Early generic stuff */
 	generic_startup();
+	boot_trace_event("generic startup");
 
 	/* Should we override the TSC timing? */
-	if (args_present("tsc_mhz")) {
-		tsc_mhz = atoi(args_value("tsc_mhz"));
-	}
+	tsc_mhz = args_value_int("tsc_mhz", tsc_mhz);
 
 	if (!args_present("debug")) {
 		_serial_debug = 0;
@@ -463,11 +501,14 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 	/* Scheduler is running and we have parsed the kcmdline, initialize video. */
 	framebuffer_initialize();
 	fbterm_initialize();
+	boot_trace_event("video");
 
 	smp_initialize();
+	boot_trace_event("smp");
 
 	/* Decompress and mount all initial ramdisks. */
 	mount_multiboot_ramdisks(mboot_struct);
+	boot_trace_event("ramdisks mounted");
 
 	/* Set up preempt source */
 	pit_initialize();
@@ -476,6 +517,7 @@ int kmain(struct multiboot * mboot, uint32_t mboot_mag, void* esp) {
 	ps2hid_install();
 	serial_initialize();
 	portio_initialize();
+	boot_trace_event("pc devices");
 
 	/* Yield to the generic main, which starts /bin/init */
 	return generic_main();
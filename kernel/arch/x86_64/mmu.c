@@ -82,6 +82,31 @@ void mmu_frame_set(uintptr_t frame_addr) {
 
 static uintptr_t lowest_available = 0;
 
+/* Free frames also live on a stack of frame indices, so single-frame
+ * allocation is an O(1) pop rather than a scan of the bitmap. The bitmap
+ * remains the authority: entries are validated against it when popped,
+ * which keeps the two coherent even when the contiguous allocator takes
+ * frames out from under stacked entries. Filled at the end of mmu_init;
+ * until then (and if it ever runs dry) the bitmap scan is the fallback. */
+static uint32_t * frame_stack = NULL;
+static size_t frame_stack_count = 0;
+static spin_lock_t frame_stack_lock = { 0 };
+
+/* On top of the shared stack, each core keeps a small magazine of frames
+ * it has already reserved (their bitmap bits are set), refilled a batch
+ * at a time. Most single-frame allocations are then satisfied without
+ * ever touching the shared lock, so fork/exec storms across cores stop
+ * serializing on physical memory allocation. The magazine lock is all
+ * but uncontended - it only guards against preemption on the same core. */
+#define FRAME_MAGAZINE_SIZE   64
+#define FRAME_MAGAZINE_REFILL 32
+struct frame_magazine {
+	spin_lock_t lock;
+	int count;
+	uint32_t frames[FRAME_MAGAZINE_SIZE];
+};
+static struct frame_magazine frame_magazines[32]; /* Sized to match processor_local_data. */
+
 /**
  * @brief Mark a physical page frame as available.
  *
@@ -95,9 +120,19 @@ void mmu_frame_clear(uintptr_t frame_addr) {
 		uint64_t frame  = frame_addr >> PAGE_SHIFT;
 		uint64_t index  = INDEX_FROM_BIT(frame);
 		uint32_t offset = OFFSET_FROM_BIT(frame);
+		uint32_t was_set = frames[index] & ((uint32_t)1 << offset);
 		frames[index]  &= ~((uint32_t)1 << offset);
 		asm ("" ::: "memory");
 		if (frame < lowest_available) lowest_available = frame;
+		/* Only a 1->0 transition pushes, so a frame can't end up on the
+		 * stack more often than it has been freed. */
+		if (was_set && frame_stack) {
+			spin_lock(frame_stack_lock);
+			if (frame_stack_count < nframes) {
+				frame_stack[frame_stack_count++] = frame;
+			}
+			spin_unlock(frame_stack_lock);
+		}
 	}
 }
 
@@ -124,32 +159,53 @@ static spin_lock_t module_space_lock = { 0 };
 /**
  * @brief Find the first range of @p n contiguous frames.
  *
+ * Single forward pass over the bitmap tracking the current run of free
+ * frames, so this is linear in memory size regardless of @p n. Only
+ * used for DMA buffers at device setup, so it does not need to be
+ * faster than that.
+ *
  * If a large enough region could not be found, results are fatal.
  */
 uintptr_t mmu_first_n_frames(int n) {
-	for (uint64_t i = 0; i < nframes * PAGE_SIZE; i += PAGE_SIZE) {
-		int bad = 0;
-		for (int j = 0; j < n; ++j) {
-			if (mmu_frame_test(i + PAGE_SIZE * j)) {
-				bad = j + 1;
-			}
+	int run = 0;
+	for (uint64_t i = 0; i < nframes; ++i) {
+		if (mmu_frame_test(i << PAGE_SHIFT)) {
+			run = 0;
+			continue;
 		}
-		if (!bad) {
-			return i / PAGE_SIZE;
+		if (++run == n) {
+			return i - n + 1;
 		}
 	}
 
-	arch_fatal_prepare();
-	dprintf("Failed to allocate %d contiguous frames.\n", n);
-	arch_dump_traceback();
-	arch_fatal();
 	return (uintptr_t)-1;
 }
 
 /**
- * @brief Find the first available frame from the bitmap.
+ * @brief Find the first available frame.
+ *
+ * Pops the free frame stack when it has entries. The frame's bitmap bit
+ * is set while the stack lock is still held, so a stale duplicate entry
+ * can never hand the same frame out twice; callers setting the bit again
+ * afterwards is harmless. Frames the contiguous allocator claimed while
+ * they sat on the stack fail the bitmap check and are dropped.
  */
 uintptr_t mmu_first_frame(void) {
+	if (frame_stack) {
+		spin_lock(frame_stack_lock);
+		while (frame_stack_count) {
+			uintptr_t out = frame_stack[--frame_stack_count];
+			if (!mmu_frame_test(out << PAGE_SHIFT)) {
+				mmu_frame_set(out << PAGE_SHIFT);
+				spin_unlock(frame_stack_lock);
+				return out;
+			}
+		}
+		spin_unlock(frame_stack_lock);
+	}
+
+	/* Slow path: scan the bitmap. Used before the stack exists during
+	 * early startup, and as a last resort if it ever runs dry. */
 	uintptr_t i, j;
 	for (i = INDEX_FROM_BIT(lowest_available); i < INDEX_FROM_BIT(nframes); ++i) {
 		if (frames[i] != (uint32_t)-1) {
@@ -171,6 +227,45 @@ uintptr_t mmu_first_frame(void) {
 	return (uintptr_t)-1;
 }
 
+/**
+ * @brief Allocate one frame through this core's magazine.
+ *
+ * Returns a frame index whose bitmap bit is already set. Refills the
+ * magazine in batches from the shared free stack, so the shared lock is
+ * taken once per @c FRAME_MAGAZINE_REFILL allocations rather than once
+ * per frame. Falls back to the locked bitmap scan during early startup
+ * and when the free stack has run dry.
+ *
+ * Must not be called with @c frame_alloc_lock held; the COW paths that
+ * hold it for reference counting still use @ref mmu_first_frame.
+ */
+static uintptr_t mmu_frame_pop(void) {
+	struct frame_magazine * mag = &frame_magazines[this_core->cpu_id];
+	spin_lock(mag->lock);
+	if (!mag->count && frame_stack) {
+		spin_lock(frame_stack_lock);
+		while (mag->count < FRAME_MAGAZINE_REFILL && frame_stack_count) {
+			uintptr_t f = frame_stack[--frame_stack_count];
+			if (mmu_frame_test(f << PAGE_SHIFT)) continue; /* stale entry */
+			mmu_frame_set(f << PAGE_SHIFT);
+			mag->frames[mag->count++] = f;
+		}
+		spin_unlock(frame_stack_lock);
+	}
+	if (mag->count) {
+		uintptr_t out = mag->frames[--mag->count];
+		spin_unlock(mag->lock);
+		return out;
+	}
+	spin_unlock(mag->lock);
+
+	spin_lock(frame_alloc_lock);
+	uintptr_t out = mmu_first_frame();
+	mmu_frame_set(out << PAGE_SHIFT);
+	spin_unlock(frame_alloc_lock);
+	return out;
+}
+
 /**
  * @brief Set the flags for a page, and allocate a frame for it if needed.
  *
@@ -204,6 +299,89 @@ void mmu_frame_map_address(union PML * page, unsigned int flags, uintptr_t physA
 	mmu_frame_allocate(page, flags);
 }
 
+/* One page of zeroes shared read-only by every untouched anonymous
+ * mapping; the copy-on-write fault path splits off a private frame on
+ * first write. Reserved at the end of mmu_init. */
+static uintptr_t zero_page_frame = 0;
+
+/* Bitmap of frames owned by long-lived shared objects - the zero page
+ * and the page cache. Shared frames are mapped read-only into user
+ * address spaces, split into private copies on write like any other
+ * COW page, and are never reference counted or freed when a directory
+ * is torn down. */
+static uint8_t * shared_frame_map = NULL;
+
+/**
+ * @brief Mark a frame as belonging to a shared, immortal object.
+ *
+ * Once marked, the frame may be handed out to any number of address
+ * spaces via @ref mmu_frame_map_cow without reference counting; it
+ * will never be freed by directory teardown.
+ */
+void mmu_frame_mark_shared(uintptr_t frame) {
+	if (shared_frame_map && frame < nframes) {
+		__sync_or_and_fetch(&shared_frame_map[frame >> 3], 1 << (frame & 7));
+	}
+}
+
+static int frame_is_shared(uintptr_t frame) {
+	return shared_frame_map && frame < nframes && (shared_frame_map[frame >> 3] & (1 << (frame & 7)));
+}
+
+/**
+ * @brief Map a user page read-only to a shared frame, copy-on-write.
+ *
+ * The frame must have been marked with @ref mmu_frame_mark_shared;
+ * the first write to the page faults and receives a private copy.
+ */
+void mmu_frame_map_cow(union PML * page, uintptr_t frame) {
+	page->bits.page = frame;
+	page->bits.size = 0;
+	page->bits.present = 1;
+	page->bits.writable = 0;
+	page->bits.user = 1;
+	page->bits.cow_pending = 1;
+}
+
+/**
+ * @brief Map a user page read-only to a shared frame, permanently.
+ *
+ * Like @ref mmu_frame_map_cow but without the pending copy: a write
+ * to the page is a protection fault, not a split, so every process
+ * mapping the frame this way keeps sharing the same physical copy.
+ * Used for library and executable text.
+ */
+void mmu_frame_map_shared_ro(union PML * page, uintptr_t frame) {
+	page->bits.page = frame;
+	page->bits.size = 0;
+	page->bits.present = 1;
+	page->bits.writable = 0;
+	page->bits.user = 1;
+	page->bits.cow_pending = 0;
+}
+
+/**
+ * @brief Back a page with the shared zero page, copy-on-write.
+ *
+ * Anonymous user memory starts out pointing at one global page of
+ * zeroes instead of eagerly taking a frame, so address space that is
+ * reserved but touched sparsely only consumes frames for the pages
+ * actually written to.
+ */
+void mmu_frame_map_zero(union PML * page) {
+	mmu_frame_map_cow(page, zero_page_frame);
+}
+
+/**
+ * @brief The frame index of the shared zero page.
+ *
+ * For subsystems, like tmpfs, that want to reference a page of
+ * zeroes without allocating one.
+ */
+uintptr_t mmu_get_zero_frame(void) {
+	return zero_page_frame;
+}
+
 /* Initial memory maps loaded by boostrap */
 #define _pagemap __attribute__((aligned(PAGE_SIZE))) = {0}
 union PML init_page_region[3][512] _pagemap;
@@ -255,7 +433,10 @@ union PML * mmu_get_page_other(union PML * root, uintptr_t virtAddr) {
 	}
 
 	if (pd[pd_entry].bits.size) {
-		return NULL;
+		/* 2MiB mapping; the permission bits sit in the same place as in
+		 * a 4KiB entry, so returning the PD entry keeps pointer
+		 * validation working for large-mapped regions like the LFB. */
+		return (union PML *)&pd[pd_entry];
 	}
 
 	union PML * pt = mmu_map_from_physical((uintptr_t)pd[pd_entry].bits.page << PAGE_SHIFT);
@@ -325,10 +506,7 @@ union PML * mmu_get_page(uintptr_t virtAddr, int flags) {
 	/* Get the PML4 entry for this address */
 	if (!root[pml4_entry].bits.present) {
 		if (!(flags & MMU_GET_MAKE)) goto _noentry;
-		spin_lock(frame_alloc_lock);
-		uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-		mmu_frame_set(newPage);
-		spin_unlock(frame_alloc_lock);
+		uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 		/* zero it */
 		memset(mmu_map_from_physical(newPage), 0, PAGE_SIZE);
 		root[pml4_entry].raw = (newPage) | USER_PML_ACCESS;
@@ -338,10 +516,7 @@ union PML * mmu_get_page(uintptr_t virtAddr, int flags) {
 
 	if (!pdp[pdp_entry].bits.present) {
 		if (!(flags & MMU_GET_MAKE)) goto _noentry;
-		spin_lock(frame_alloc_lock);
-		uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-		mmu_frame_set(newPage);
-		spin_unlock(frame_alloc_lock);
+		uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 		/* zero it */
 		memset(mmu_map_from_physical(newPage), 0, PAGE_SIZE);
 		pdp[pdp_entry].raw = (newPage) | USER_PML_ACCESS;
@@ -356,10 +531,7 @@ union PML * mmu_get_page(uintptr_t virtAddr, int flags) {
 
 	if (!pd[pd_entry].bits.present) {
 		if (!(flags & MMU_GET_MAKE)) goto _noentry;
-		spin_lock(frame_alloc_lock);
-		uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-		mmu_frame_set(newPage);
-		spin_unlock(frame_alloc_lock);
+		uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 		/* zero it */
 		memset(mmu_map_from_physical(newPage), 0, PAGE_SIZE);
 		pd[pd_entry].raw = (newPage) | USER_PML_ACCESS;
@@ -378,6 +550,66 @@ _noentry:
 	return NULL;
 }
 
+/**
+ * @brief Map a 2MiB page at @p virtAddr to @p physAddr.
+ *
+ * Installs a large-page PD entry, creating the intermediate levels if
+ * needed, so big regions like the kernel heap and the userspace
+ * framebuffer mapping take one TLB entry per 2MiB instead of 512.
+ * Both addresses must be 2MiB-aligned; callers are expected to fall
+ * back to 4KiB mappings when they are not.
+ *
+ * Note that in a large page entry the PAT bit moves from bit 7, where
+ * it would collide with the size bit, up to bit 12, so the entry is
+ * assembled raw here rather than through @ref mmu_frame_allocate.
+ *
+ * @param virtAddr 2MiB-aligned virtual address.
+ * @param physAddr 2MiB-aligned physical address to map it to.
+ * @param flags Same MMU_FLAG_* set accepted by @ref mmu_frame_allocate.
+ * @returns 0 on success, 1 if the slot was covered by a 1GiB mapping.
+ */
+int mmu_map_large_page(uintptr_t virtAddr, uintptr_t physAddr, int flags) {
+	uintptr_t realBits = virtAddr & CANONICAL_MASK;
+	uintptr_t pageAddr = realBits >> PAGE_SHIFT;
+	unsigned int pml4_entry = (pageAddr >> 27) & ENTRY_MASK;
+	unsigned int pdp_entry  = (pageAddr >> 18) & ENTRY_MASK;
+	unsigned int pd_entry   = (pageAddr >> 9)  & ENTRY_MASK;
+
+	union PML * root = this_core->current_pml;
+
+	if (!root[pml4_entry].bits.present) {
+		uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
+		memset(mmu_map_from_physical(newPage), 0, PAGE_SIZE);
+		root[pml4_entry].raw = (newPage) | USER_PML_ACCESS;
+	}
+
+	union PML * pdp = mmu_map_from_physical((uintptr_t)root[pml4_entry].bits.page << PAGE_SHIFT);
+
+	if (!pdp[pdp_entry].bits.present) {
+		uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
+		memset(mmu_map_from_physical(newPage), 0, PAGE_SIZE);
+		pdp[pdp_entry].raw = (newPage) | USER_PML_ACCESS;
+	}
+
+	if (pdp[pdp_entry].bits.size) {
+		printf("Warning: Tried to map a 2MiB page inside a 1GiB page!\n");
+		return 1;
+	}
+
+	union PML * pd = mmu_map_from_physical((uintptr_t)pdp[pdp_entry].bits.page << PAGE_SHIFT);
+
+	uint64_t raw = (physAddr & ~(LARGE_PAGE_SIZE - 1)) | LARGE_PAGE_BIT | 0x01;
+	if (flags & MMU_FLAG_WRITABLE)     raw |= 0x02;
+	if (!(flags & MMU_FLAG_KERNEL))    raw |= 0x04;
+	if (flags & MMU_FLAG_WRITETHROUGH) raw |= 0x08;
+	if (flags & MMU_FLAG_NOCACHE)      raw |= 0x10;
+	if (flags & MMU_FLAG_SPEC)         raw |= (1UL << 12);
+	if (flags & MMU_FLAG_NOEXECUTE)    raw |= (1UL << 63);
+	pd[pd_entry].raw = raw;
+	asm ("" ::: "memory");
+	return 0;
+}
+
 /**
  * @brief Increment the reference count for a physical page of memory.
  *
@@ -446,6 +678,14 @@ int copy_page_maybe(union PML * pt_in, union PML * pt_out, size_t l, uintptr_t a
 	/* Can we cow the current page? */
 	spin_lock(frame_alloc_lock);
 
+	/* Shared frames (zero page, page cache) are shared freely and never
+	 * refcounted. */
+	if (!pt_in[l].bits.writable && frame_is_shared(pt_in[l].bits.page)) {
+		pt_out[l].raw = pt_in[l].raw;
+		spin_unlock(frame_alloc_lock);
+		return 0;
+	}
+
 	/* Is the page writable? */
 	if (pt_in[l].bits.writable) {
 		/* Then we need to initialize the refcounts */
@@ -462,7 +702,9 @@ int copy_page_maybe(union PML * pt_in, union PML * pt_out, size_t l, uintptr_t a
 		pt_in[l].bits.cow_pending = 1;
 		pt_out[l].raw = pt_in[l].raw;
 		asm ("" ::: "memory");
-		mmu_invalidate(address);
+		/* The shootdown for the downgraded mapping is batched; mmu_clone
+		 * flushes once for the whole address space. */
+		mmu_invalidate_batch_add(address);
 		spin_unlock(frame_alloc_lock);
 		return 0;
 	}
@@ -506,6 +748,11 @@ int copy_page_maybe(union PML * pt_in, union PML * pt_out, size_t l, uintptr_t a
  * @returns 0, generally
  */
 int free_page_maybe(union PML * pt_in, size_t l, uintptr_t address) {
+	/* Shared frames outlive every reference to them. */
+	if (!pt_in[l].bits.writable && frame_is_shared(pt_in[l].bits.page)) {
+		return 0;
+	}
+
 	if (pt_in[l].bits.writable) {
 		assert(mem_refcounts[pt_in[l].bits.page] == 0);
 		mmu_frame_clear((uintptr_t)pt_in[l].bits.page << PAGE_SHIFT);
@@ -526,7 +773,11 @@ int free_page_maybe(union PML * pt_in, size_t l, uintptr_t address) {
  * Allocates all of the necessary intermediary directory levels for a new address space
  * and also copies data from the existing address space.
  *
- * TODO: This doesn't do any CoW and it's kinda complicated.
+ * User pages are not copied eagerly: @ref copy_page_maybe downgrades
+ * writable pages to read-only in both directories and marks them
+ * copy-on-write, so forks share frames until one side writes. The
+ * per-page TLB invalidations that downgrade requires are batched into
+ * a single shootdown at the end of the walk.
  *
  * @param from The directory to clone, or NULL to clone the kernel map.
  * @returns a pointer to the new page directory, suitable for mapping to a physical address.
@@ -536,10 +787,7 @@ union PML * mmu_clone(union PML * from) {
 	if (!from) from = this_core->current_pml;
 
 	/* First get a page for ourselves. */
-	spin_lock(frame_alloc_lock);
-	uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-	mmu_frame_set(newPage);
-	spin_unlock(frame_alloc_lock);
+	uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 	union PML * pml4_out = mmu_map_from_physical(newPage);
 
 	/* Zero bottom half */
@@ -552,10 +800,7 @@ union PML * mmu_clone(union PML * from) {
 	for (size_t i = 0; i < 256; ++i) {
 		if (from[i].bits.present) {
 			union PML * pdp_in = mmu_map_from_physical((uintptr_t)from[i].bits.page << PAGE_SHIFT);
-			spin_lock(frame_alloc_lock);
-			uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-			mmu_frame_set(newPage);
-			spin_unlock(frame_alloc_lock);
+			uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 			union PML * pdp_out = mmu_map_from_physical(newPage);
 			memset(pdp_out, 0, 512 * sizeof(union PML));
 			pml4_out[i].raw = (newPage) | USER_PML_ACCESS;
@@ -564,10 +809,7 @@ union PML * mmu_clone(union PML * from) {
 			for (size_t j = 0; j < 512; ++j) {
 				if (pdp_in[j].bits.present) {
 					union PML * pd_in = mmu_map_from_physical((uintptr_t)pdp_in[j].bits.page << PAGE_SHIFT);
-					spin_lock(frame_alloc_lock);
-					uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-					mmu_frame_set(newPage);
-					spin_unlock(frame_alloc_lock);
+					uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 					union PML * pd_out = mmu_map_from_physical(newPage);
 					memset(pd_out, 0, 512 * sizeof(union PML));
 					pdp_out[j].raw = (newPage) | USER_PML_ACCESS;
@@ -575,11 +817,13 @@ union PML * mmu_clone(union PML * from) {
 					/* Now copy the PTs */
 					for (size_t k = 0; k < 512; ++k) {
 						if (pd_in[k].bits.present) {
+							if (pd_in[k].bits.size) {
+								/* 2MiB device mapping (the LFB); like the 4KiB
+								 * device-region entries below, it is not copied. */
+								continue;
+							}
 							union PML * pt_in = mmu_map_from_physical((uintptr_t)pd_in[k].bits.page << PAGE_SHIFT);
-							spin_lock(frame_alloc_lock);
-							uintptr_t newPage = mmu_first_frame() << PAGE_SHIFT;
-							mmu_frame_set(newPage);
-							spin_unlock(frame_alloc_lock);
+							uintptr_t newPage = mmu_frame_pop() << PAGE_SHIFT;
 							union PML * pt_out = mmu_map_from_physical(newPage);
 							memset(pt_out, 0, 512 * sizeof(union PML));
 							pd_out[k].raw = (newPage) | USER_PML_ACCESS;
@@ -604,6 +848,9 @@ union PML * mmu_clone(union PML * from) {
 		}
 	}
 
+	/* One shootdown covers every page copy_page_maybe downgraded. */
+	mmu_invalidate_batch_flush();
+
 	return pml4_out;
 }
 
@@ -613,11 +860,7 @@ union PML * mmu_clone(union PML * from) {
  * @returns a frame index, not an address
  */
 uintptr_t mmu_allocate_a_frame(void) {
-	spin_lock(frame_alloc_lock);
-	uintptr_t index = mmu_first_frame();
-	mmu_frame_set(index << PAGE_SHIFT);
-	spin_unlock(frame_alloc_lock);
-	return index;
+	return mmu_frame_pop();
 }
 
 /**
@@ -628,6 +871,12 @@ uintptr_t mmu_allocate_a_frame(void) {
 uintptr_t mmu_allocate_n_frames(int n) {
 	spin_lock(frame_alloc_lock);
 	uintptr_t index = mmu_first_n_frames(n);
+	if (index == (uintptr_t)-1) {
+		arch_fatal_prepare();
+		dprintf("Failed to allocate %d contiguous frames.\n", n);
+		arch_dump_traceback();
+		arch_fatal();
+	}
 	for (int i = 0; i < n; ++i) {
 		mmu_frame_set((index+i) << PAGE_SHIFT);
 	}
@@ -659,6 +908,8 @@ size_t mmu_count_user(union PML * from) {
 					union PML * pd_in = mmu_map_from_physical((uintptr_t)pdp_in[j].bits.page << PAGE_SHIFT);
 					for (size_t k = 0; k < 512; ++k) {
 						if (pd_in[k].bits.present) {
+							/* 2MiB mappings are only used for devices, which are excluded anyway. */
+							if (pd_in[k].bits.size) continue;
 							union PML * pt_in = mmu_map_from_physical((uintptr_t)pd_in[k].bits.page << PAGE_SHIFT);
 							for (size_t l = 0; l < 512; ++l) {
 								/* Calculate final address to skip SHM */
@@ -746,6 +997,8 @@ size_t mmu_used_memory(void) {
 	return ret * 4 - unavailable_memory;
 }
 
+static void mmu_pcid_retire(uintptr_t phys);
+
 /**
  * @brief Relinquish pages owned by a top-level directory.
  *
@@ -769,6 +1022,11 @@ void mmu_free(union PML * from) {
 					union PML * pd_in = mmu_map_from_physical((uintptr_t)pdp_in[j].bits.page << PAGE_SHIFT);
 					for (size_t k = 0; k < 512; ++k) {
 						if (pd_in[k].bits.present) {
+							if (pd_in[k].bits.size) {
+								/* 2MiB device mapping; no page table or frames to free. */
+								pd_in[k].raw = 0;
+								continue;
+							}
 							union PML * pt_in = mmu_map_from_physical((uintptr_t)pd_in[k].bits.page << PAGE_SHIFT);
 							for (size_t l = 0; l < 512; ++l) {
 								uintptr_t address = ((i << (9 * 3 + 12)) | (j << (9*2 + 12)) | (k << (9 + 12)) | (l << PAGE_SHIFT));
@@ -793,19 +1051,100 @@ void mmu_free(union PML * from) {
 
 	mmu_frame_clear((((uintptr_t)from) & PHYS_MASK));
 	spin_unlock(frame_alloc_lock);
+
+	/* The PML4's frame can be recycled for a future directory, so any
+	 * TLB tags still keyed to it must be retired before that happens. */
+	mmu_pcid_retire(((uintptr_t)from) & PHYS_MASK);
 }
 
 union PML * mmu_get_kernel_directory(void) {
 	return mmu_map_from_physical((uintptr_t)&init_page_region[0]);
 }
 
+/* When the processor supports it, TLB entries are tagged with a process
+ * context identifier so that switching address spaces does not throw away
+ * the entire TLB. Each core hands out PCIDs from a small private pool:
+ * slot assignments live in @c pcid_active, keyed by the physical address
+ * of the PML4, and are recycled round-robin. Reassigning a slot is safe
+ * because the flushing CR3 load that installs the new owner also drops
+ * whatever entries the old owner left under that tag.
+ *
+ * PCID 0 is never assigned; it is what every core runs under before the
+ * feature is enabled and what early boot uses.
+ */
+#define PCID_COUNT 16
+
+int mmu_pcid_enabled = 0;                            /* Also read by the shootdown handler in irq.S. */
+uint64_t mmu_invpcid_descriptor[2] = {0, 0};         /* All-context INVPCID descriptor, shared with irq.S. */
+static uintptr_t pcid_active[32][PCID_COUNT] = {{0}};
+static int pcid_rotor[32] = {0};
+
+/**
+ * @brief Enable TLB tagging on this core, if supported.
+ *
+ * Called once per core during early setup, alongside the PAT setup. The
+ * BSP makes the support decision for everyone: we need both PCID and
+ * INVPCID, the latter because the shootdown IPI handler has to be able
+ * to flush entries for address spaces other than the current one.
+ */
+void mmu_enable_pcid(void) {
+	if (this_core->cpu_id == 0) {
+		uint32_t a, b, c, d;
+		asm volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1), "c"(0));
+		int has_pcid = c & (1 << 17);
+		asm volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(7), "c"(0));
+		int has_invpcid = b & (1 << 10);
+		mmu_pcid_enabled = (has_pcid && has_invpcid) ? 1 : 0;
+	}
+
+	if (!mmu_pcid_enabled) return;
+
+	asm volatile (
+		"movq %%cr4, %%rax\n"
+		"orq $0x20000, %%rax\n" /* CR4.PCIDE */
+		"movq %%rax, %%cr4\n"
+		: : : "rax");
+}
+
+/* Flush all of this core's non-global TLB entries, for every tag. */
+static void mmu_flush_all_local(void) {
+	if (mmu_pcid_enabled) {
+		asm volatile ("invpcid %0, %1" : : "m"(mmu_invpcid_descriptor), "r"(3UL) : "memory");
+	} else {
+		asm volatile ("movq %%cr3, %%rax\nmovq %%rax, %%cr3" : : : "rax", "memory");
+	}
+}
+
+/**
+ * @brief Drop any TLB tags assigned to a freed page directory.
+ *
+ * Once a PML4's frame is released it can come back as a brand new
+ * directory at the same physical address, which would otherwise hit in
+ * a core's slot table and get a no-flush CR3 load over another space's
+ * stale entries. Clear the slots everywhere and shoot the TLBs down.
+ *
+ * @param phys Physical address of the retired PML4.
+ */
+static void mmu_pcid_retire(uintptr_t phys) {
+	if (!mmu_pcid_enabled) return;
+	for (int cpu = 0; cpu < processor_count; ++cpu) {
+		for (int slot = 1; slot < PCID_COUNT; ++slot) {
+			if (pcid_active[cpu][slot] == phys) pcid_active[cpu][slot] = 0;
+		}
+	}
+	mmu_flush_all_local();
+	arch_tlb_shootdown(0);
+}
+
 /**
  * @brief Switch the active page directory for this core.
  *
  * Generally called during task creation and switching to change
  * the active page directory of a core. Updates @c this_core->current_pml.
  *
- * x86-64: Loads a given PML into CR3.
+ * x86-64: Loads a given PML into CR3. With PCID enabled, a switch to an
+ * address space this core has seen recently keeps the TLB entries tagged
+ * with that space's identifier instead of flushing everything.
  *
  * @param new_pml Either the physical address or the shadow mapping virtual address
  *                of the new PML4 directory to switch into, general obtained from
@@ -816,9 +1155,28 @@ void mmu_set_directory(union PML * new_pml) {
 	if (!new_pml) new_pml = mmu_map_from_physical((uintptr_t)&init_page_region[0]);
 	this_core->current_pml = new_pml;
 
+	uintptr_t phys = (uintptr_t)new_pml & PHYS_MASK;
+
+	if (mmu_pcid_enabled) {
+		int cpu = this_core->cpu_id;
+		for (int slot = 1; slot < PCID_COUNT; ++slot) {
+			if (pcid_active[cpu][slot] == phys) {
+				/* This space still owns a tag here; the no-flush bit keeps
+				 * its TLB entries alive across the switch. */
+				asm volatile ("movq %0, %%cr3" : : "r"(phys | (uintptr_t)slot | (1UL << 63)));
+				return;
+			}
+		}
+		int slot = pcid_rotor[cpu] + 1;
+		pcid_rotor[cpu] = (pcid_rotor[cpu] + 1) % (PCID_COUNT - 1);
+		pcid_active[cpu][slot] = phys;
+		asm volatile ("movq %0, %%cr3" : : "r"(phys | (uintptr_t)slot));
+		return;
+	}
+
 	asm volatile (
 		"movq %0, %%cr3"
-		: : "r"((uintptr_t)new_pml & PHYS_MASK));
+		: : "r"(phys));
 }
 
 /**
@@ -837,6 +1195,62 @@ void mmu_invalidate(uintptr_t addr) {
 	arch_tlb_shootdown(addr);
 }
 
+/* Pages invalidated through the batch interface since the last flush;
+ * each core only ever touches its own counter. */
+static int tlb_batch_pending[32] = {0};
+
+/**
+ * @brief Queue a TLB invalidation for a later batched shootdown.
+ *
+ * Invalidates the address locally right away but defers the cross-core
+ * shootdown until @ref mmu_invalidate_batch_flush, so a loop unmapping
+ * many pages costs one IPI broadcast instead of one per page.
+ *
+ * @param addr Virtual address in the current address space to invalidate.
+ */
+void mmu_invalidate_batch_add(uintptr_t addr) {
+	asm volatile (
+		"invlpg (%0)"
+		: : "r"(addr));
+	tlb_batch_pending[this_core->cpu_id]++;
+}
+
+/**
+ * @brief Broadcast one shootdown covering all batched invalidations.
+ *
+ * No-op if nothing was added since the last flush.
+ */
+void mmu_invalidate_batch_flush(void) {
+	if (tlb_batch_pending[this_core->cpu_id]) {
+		tlb_batch_pending[this_core->cpu_id] = 0;
+		arch_tlb_shootdown(0);
+	}
+}
+
+/**
+ * @brief Unmap a range of user pages in the current address space.
+ *
+ * Backs sys_munmap. Private frames are released through the same
+ * reference-count logic directory teardown uses; shared frames (the
+ * zero page, page cache pages) are left alone. Invalidations are
+ * batched into a single shootdown for the whole range.
+ *
+ * @param addr Page-aligned base of the range.
+ * @param size Length of the range in bytes.
+ */
+void mmu_unmap_user(uintptr_t addr, size_t size) {
+	for (uintptr_t a = addr; a < addr + size; a += PAGE_SIZE) {
+		union PML * page = mmu_get_page(a, 0);
+		if (!page || !page->bits.present || !page->bits.user) continue;
+		spin_lock(frame_alloc_lock);
+		free_page_maybe(page, 0, a);
+		page->raw = 0;
+		spin_unlock(frame_alloc_lock);
+		mmu_invalidate_batch_add(a);
+	}
+	mmu_invalidate_batch_flush();
+}
+
 static char * heapStart = NULL;
 extern char end[];
 
@@ -964,6 +1378,33 @@ void mmu_init(size_t memsize, uintptr_t firstFreePage) {
 	size_t size_of_refcounts = (nframes & PAGE_LOW_MASK) ? (nframes + PAGE_SIZE - (nframes & PAGE_LOW_MASK)) : nframes;
 	mem_refcounts = sbrk(size_of_refcounts);
 	memset(mem_refcounts, 0, size_of_refcounts);
+
+	/* Build the free frame stack from the bitmap, high frames first so
+	 * that low frames pop first and allocation order matches what the
+	 * scanner used to produce. This runs after the sbrk above so the
+	 * frames backing the stack itself are already marked in use. */
+	size_t stack_bytes = (nframes * sizeof(uint32_t) + PAGE_LOW_MASK) & PAGE_SIZE_MASK;
+	if (stack_bytes <= 0x1F00000) {
+		uint32_t * stack = sbrk(stack_bytes);
+		for (size_t i = nframes; i > 0; i--) {
+			if (!mmu_frame_test((i - 1) << PAGE_SHIFT)) {
+				stack[frame_stack_count++] = i - 1;
+			}
+		}
+		frame_stack = stack;
+	} else {
+		printf("Warning: Too much memory to track free frames on a stack; falling back to bitmap scans.\n");
+	}
+
+	/* Track which frames belong to shared immortal objects. */
+	size_t shared_map_bytes = (((nframes + 7) / 8) + PAGE_LOW_MASK) & PAGE_SIZE_MASK;
+	shared_frame_map = sbrk(shared_map_bytes);
+	memset(shared_frame_map, 0, shared_map_bytes);
+
+	/* Reserve the shared zero page for anonymous mappings. */
+	zero_page_frame = mmu_allocate_a_frame();
+	memset(mmu_map_from_physical(zero_page_frame << PAGE_SHIFT), 0, PAGE_SIZE);
+	mmu_frame_mark_shared(zero_page_frame);
 }
 
 /**
@@ -1006,9 +1447,29 @@ void * sbrk(size_t bytes) {
 	spin_lock(kheap_lock);
 	void * out = heapStart;
 
-	for (uintptr_t p = (uintptr_t)out; p < (uintptr_t)out + bytes; p += PAGE_SIZE) {
+	for (uintptr_t p = (uintptr_t)out; p < (uintptr_t)out + bytes; ) {
+		/* When the break is 2MiB-aligned and at least that much is left
+		 * to map, try to grab a contiguous run and map one large page
+		 * instead of 512 small ones. Falls through to the 4KiB path if
+		 * physical memory is too fragmented for a contiguous run. */
+		if (!(p & (LARGE_PAGE_SIZE - 1)) && ((uintptr_t)out + bytes - p) >= LARGE_PAGE_SIZE) {
+			spin_lock(frame_alloc_lock);
+			uintptr_t index = mmu_first_n_frames(LARGE_PAGE_SIZE / PAGE_SIZE);
+			if (index != (uintptr_t)-1) {
+				for (size_t i = 0; i < LARGE_PAGE_SIZE / PAGE_SIZE; ++i) {
+					mmu_frame_set((index+i) << PAGE_SHIFT);
+				}
+			}
+			spin_unlock(frame_alloc_lock);
+			if (index != (uintptr_t)-1) {
+				mmu_map_large_page(p, index << PAGE_SHIFT, MMU_FLAG_WRITABLE | MMU_FLAG_KERNEL);
+				p += LARGE_PAGE_SIZE;
+				continue;
+			}
+		}
 		union PML * page = mmu_get_page(p, MMU_GET_MAKE);
 		mmu_frame_allocate(page, MMU_FLAG_WRITABLE | MMU_FLAG_KERNEL);
+		p += PAGE_SIZE;
 	}
 
 	//memset(out, 0xAA, bytes);
@@ -1051,6 +1512,34 @@ void * mmu_map_mmio_region(uintptr_t physical_address, size_t size) {
 	return out;
 }
 
+/**
+ * @brief Obtain a write-combining region mapped to the given physical address.
+ *
+ * Like @ref mmu_map_mmio_region but with the WC PAT attribute, for linear
+ * framebuffers: streaming pixel writes coalesce into full-line bursts
+ * instead of going out uncombined. The size is rounded up to a page
+ * multiple, since framebuffer sizes are rarely tidy. As with MMIO
+ * mappings, the virtual space cannot be reclaimed.
+ *
+ * @param physical_address Physical base of the framebuffer.
+ * @param size Size of the region in bytes.
+ * @returns a virtual address suitable for streaming writes.
+ */
+void * mmu_map_wc_region(uintptr_t physical_address, size_t size) {
+	size = (size + PAGE_LOW_MASK) & PAGE_SIZE_MASK;
+
+	spin_lock(mmio_space_lock);
+	void * out = (void*)mmio_base_address;
+	for (size_t i = 0; i < size; i += PAGE_SIZE) {
+		union PML * p = mmu_get_page(mmio_base_address + i, MMU_GET_MAKE);
+		mmu_frame_map_address(p, MMU_FLAG_KERNEL | MMU_FLAG_WRITABLE | MMU_FLAG_WC, physical_address + i);
+	}
+	mmio_base_address += size;
+	spin_unlock(mmio_space_lock);
+
+	return out;
+}
+
 static uintptr_t module_base_address = MODULE_BASE_START;
 
 /**
@@ -1134,6 +1623,31 @@ int mmu_copy_on_write(uintptr_t address) {
 		return 1;
 	}
 
+	/* First write to a page backed by a shared frame (the zero page, or
+	 * a page cache frame): swap in a private copy. No reference counting
+	 * here, shared frames are immortal. */
+	if (frame_is_shared(page->bits.page)) {
+		spin_lock(frame_alloc_lock);
+		if (!frame_is_shared(page->bits.page)) {
+			/* Another thread of this process split it first. */
+			spin_unlock(frame_alloc_lock);
+			mmu_invalidate(address);
+			return 0;
+		}
+		uintptr_t shared_frame = page->bits.page;
+		uintptr_t fresh_frame = mmu_first_frame();
+		mmu_frame_set(fresh_frame << PAGE_SHIFT);
+		memcpy(mmu_map_from_physical(fresh_frame << PAGE_SHIFT),
+		       mmu_map_from_physical(shared_frame << PAGE_SHIFT), PAGE_SIZE);
+		page->bits.page = fresh_frame;
+		page->bits.writable = 1;
+		page->bits.cow_pending = 0;
+		spin_unlock(frame_alloc_lock);
+		asm ("" ::: "memory");
+		mmu_invalidate(address);
+		return 0;
+	}
+
 	spin_lock(frame_alloc_lock);
 
 	/* Is this the last reference to this page? */
@@ -1198,8 +1712,16 @@ int mmu_validate_user_pointer(void * addr, size_t size, int flags) {
 	for (uintptr_t page = page_base; page <= page_end; ++page) {
 		if ((page & 0xffff800000000) != 0 && (page & 0xffff800000000) != 0xffff800000000) return 0;
 		union PML * page_entry = mmu_get_page_other(this_core->current_process->thread.page_directory->directory, page << 12);
-		if (!page_entry) return 0;
-		if (!page_entry->bits.present) return 0;
+		if (!page_entry || !page_entry->bits.present) {
+			/* Not-present pages may still be demand-loadable executable
+			 * segments or untouched shared memory; bring one in the
+			 * same way a fault would. */
+			extern int elf_demand_load(uintptr_t address);
+			extern int shm_demand_fault(uintptr_t address);
+			if (!elf_demand_load(page << 12) && !shm_demand_fault(page << 12)) return 0;
+			page_entry = mmu_get_page_other(this_core->current_process->thread.page_directory->directory, page << 12);
+			if (!page_entry || !page_entry->bits.present) return 0;
+		}
 		if (!page_entry->bits.user) return 0;
 		if (!page_entry->bits.writable && (flags & MMU_PTR_WRITE)) {
 			if (mmu_copy_on_write((uintptr_t)(page << 12))) return 0;
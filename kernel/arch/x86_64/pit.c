@@ -27,6 +27,7 @@
  */
 #include <kernel/printf.h>
 #include <kernel/process.h>
+#include <kernel/profile.h>
 #include <kernel/arch/x86_64/ports.h>
 #include <kernel/arch/x86_64/irq.h>
 #include <kernel/arch/x86_64/regs.h>
@@ -64,6 +65,8 @@ int pit_interrupt(struct regs *r) {
 	extern void arch_update_clock(void);
 	arch_update_clock();
 
+	profile_tick(r->rip, r->cs == 0x08);
+
 	irq_ack(0);
 
 	switch_task(1);
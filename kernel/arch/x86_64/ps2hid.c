@@ -16,6 +16,7 @@
 #include <kernel/mouse.h>
 #include <kernel/misc.h>
 #include <kernel/args.h>
+#include <kernel/time.h>
 
 #include <kernel/arch/x86_64/ports.h>
 #include <kernel/arch/x86_64/regs.h>
@@ -63,6 +64,17 @@ static int8_t mouse_mode = MOUSE_DEFAULT;
 static fs_node_t * mouse_pipe;
 static fs_node_t * keyboard_pipe;
 
+/* Motion coalescing: deltas pile up here while the reader is behind. */
+static mouse_device_packet_t pending_motion;
+static int have_pending_motion = 0;
+static uint32_t last_buttons = 0;
+
+static void flush_motion(void) {
+	if (!have_pending_motion) return;
+	write_fs(mouse_pipe, 0, sizeof(pending_motion), (uint8_t *)&pending_motion);
+	have_pending_motion = 0;
+}
+
 void (*ps2_mouse_alternate)(uint8_t) = NULL;
 
 /**
@@ -194,11 +206,36 @@ static void finish_packet(void) {
 		}
 	}
 
-	mouse_device_packet_t bitbucket;
-	while (pipe_size(mouse_pipe) > (int)(DISCARD_POINT * sizeof(packet))) {
-		read_fs(mouse_pipe, 0, sizeof(packet), (uint8_t *)&bitbucket);
+	packet.timestamp = arch_perf_timer() / arch_cpu_mhz();
+
+	/*
+	 * Button and scroll edges go out immediately (preceded by any held
+	 * motion, so the click lands in the right place). Pure motion only
+	 * goes out when the reader has drained the pipe; while the
+	 * compositor is busy compositing a frame, further deltas fold into
+	 * one pending record instead of queueing a wakeup per sample -
+	 * fast drags cost one recomposite per frame rather than one per
+	 * 80 Hz sample.
+	 */
+	if (packet.buttons != last_buttons || (packet.buttons & (MOUSE_SCROLL_UP | MOUSE_SCROLL_DOWN))) {
+		last_buttons = packet.buttons & (LEFT_CLICK | RIGHT_CLICK | MIDDLE_CLICK);
+		flush_motion();
+		mouse_device_packet_t bitbucket;
+		while (pipe_size(mouse_pipe) > (int)(DISCARD_POINT * sizeof(packet))) {
+			read_fs(mouse_pipe, 0, sizeof(packet), (uint8_t *)&bitbucket);
+		}
+		write_fs(mouse_pipe, 0, sizeof(packet), (uint8_t *)&packet);
+	} else {
+		if (have_pending_motion) {
+			pending_motion.x_difference += packet.x_difference;
+			pending_motion.y_difference += packet.y_difference;
+			pending_motion.timestamp = packet.timestamp;
+		} else {
+			pending_motion = packet;
+			have_pending_motion = 1;
+		}
+		if (pipe_size(mouse_pipe) == 0) flush_motion();
 	}
-	write_fs(mouse_pipe, 0, sizeof(packet), (uint8_t *)&packet);
 }
 
 /**
@@ -17,6 +17,7 @@
 #include <kernel/args.h>
 #include <kernel/time.h>
 #include <kernel/multiboot.h>
+#include <kernel/counters.h>
 #include <kernel/arch/x86_64/acpi.h>
 #include <kernel/arch/x86_64/mmu.h>
 
@@ -177,10 +178,11 @@ void ap_main(void) {
 		printf("smp: lapic id does not match\n");
 	}
 
-	/* lidt, initialize local FPU, set up page attributes */
+	/* lidt, initialize local FPU, set up page attributes and TLB tagging */
 	idt_ap_install();
 	fpu_initialize();
 	pat_initialize();
+	mmu_enable_pcid();
 
 	/* Enable our spurious vector register */
 	*((volatile uint32_t*)(lapic_final + 0x0F0)) = 0x127;
@@ -196,10 +198,14 @@ void ap_main(void) {
 	uint64_t ms = (after-before)/arch_cpu_mhz();
 	uint64_t target = 10000000000UL / ms;
 
-	/* Enable our APIC timer to send periodic wakeup signals */
+	/* Configure our APIC timer in one-shot mode. The scheduler arms it
+	 * with a time slice whenever this core picks up a process and leaves
+	 * it stopped when the core goes idle, so idle cores take no timer
+	 * ticks and sit in HLT until another core sends a wakeup IPI. */
+	this_core->lapic_timer_ticks_per_10ms = target;
 	*((volatile uint32_t*)(lapic_final + 0x3e0)) = 1;
-	*((volatile uint32_t*)(lapic_final + 0x320)) = 0x7b | 0x20000;
-	*((volatile uint32_t*)(lapic_final + 0x380)) = target;
+	*((volatile uint32_t*)(lapic_final + 0x320)) = 0x7b;
+	*((volatile uint32_t*)(lapic_final + 0x380)) = 0;
 
 	/* Set our pml pointers */
 	this_core->current_pml = &init_page_region[0];
@@ -464,6 +470,43 @@ void arch_wakeup_others(void) {
 	lapic_send_ipi(0, 0x7E | (3 << 18));
 }
 
+/**
+ * @brief Send a soft wakeup IPI to one specific core.
+ *
+ * Directed version of @ref arch_wakeup_others, used by the scheduler
+ * to nudge the one idle core a newly-readied process was queued on.
+ */
+void arch_wakeup_core(int cpu_id) {
+	if (!lapic_final || processor_count < 2) return;
+	lapic_send_ipi(processor_local_data[cpu_id].lapic_id, 0x7E);
+}
+
+/**
+ * @brief Arm this core's one-shot preemption timer.
+ *
+ * Called by the scheduler when this core picks up a process to run.
+ * On the BSP, which still takes its preemption ticks (and drives the
+ * global clock) from the PIT, this is a no-op, as is anything before
+ * the local timer has been calibrated.
+ *
+ * @param microseconds Time slice before the next local timer interrupt.
+ */
+void arch_timer_arm(uint64_t microseconds) {
+	if (!lapic_final || !this_core->lapic_timer_ticks_per_10ms) return;
+	*((volatile uint32_t*)(lapic_final + 0x380)) = this_core->lapic_timer_ticks_per_10ms * microseconds / 10000;
+}
+
+/**
+ * @brief Stop this core's preemption timer entirely.
+ *
+ * Called by the scheduler when this core goes idle; the core then
+ * waits in HLT for a wakeup IPI rather than taking pointless ticks.
+ */
+void arch_timer_stop(void) {
+	if (!lapic_final || !this_core->lapic_timer_ticks_per_10ms) return;
+	*((volatile uint32_t*)(lapic_final + 0x380)) = 0;
+}
+
 /**
  * @brief Trigger a TLB shootdown on other cores.
  *
@@ -480,5 +523,6 @@ void arch_tlb_shootdown(uintptr_t vaddr) {
 	 * mapped somewhere else before IPIing everyone...
 	 */
 
+	counter_bump(COUNTER_TLB_SHOOTDOWN);
 	lapic_send_ipi(0, 0x7C | (3 << 18));
 }
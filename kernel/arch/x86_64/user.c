@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <kernel/process.h>
 #include <kernel/string.h>
+#include <kernel/klog.h>
 #include <kernel/arch/x86_64/regs.h>
 #include <kernel/arch/x86_64/mmu.h>
 #include <kernel/arch/x86_64/ports.h>
@@ -129,6 +130,31 @@ void arch_save_floating(process_t * proc) {
 	asm volatile ("fxsave (%0)" :: "r"(&proc->thread.fp_regs));
 }
 
+/**
+ * @brief Load hardware breakpoints for this thread.
+ *
+ * Debug registers are per-core, so they need to follow the thread
+ * that owns them across switches. The common case - neither the
+ * outgoing nor the incoming thread has breakpoints armed - costs
+ * one read of DR7.
+ */
+void arch_set_debug_registers(process_t * proc) {
+	uintptr_t active;
+	asm volatile ("mov %%dr7, %0" : "=r"(active));
+	if (!active && !proc->thread.debug_ctl) return;
+
+	uintptr_t zero = 0;
+	asm volatile ("mov %0, %%dr7" :: "r"(zero));
+	if (proc->thread.debug_ctl) {
+		asm volatile ("mov %0, %%dr0" :: "r"(proc->thread.debug_addr[0]));
+		asm volatile ("mov %0, %%dr1" :: "r"(proc->thread.debug_addr[1]));
+		asm volatile ("mov %0, %%dr2" :: "r"(proc->thread.debug_addr[2]));
+		asm volatile ("mov %0, %%dr3" :: "r"(proc->thread.debug_addr[3]));
+		asm volatile ("mov %0, %%dr6" :: "r"(zero));
+		asm volatile ("mov %0, %%dr7" :: "r"(proc->thread.debug_ctl));
+	}
+}
+
 /**
  * @brief Called in a loop by kernel idle tasks.
  *
@@ -162,6 +188,9 @@ void arch_fatal_prepare(void) {
 		if (i == this_core->cpu_id) continue;
 		lapic_send_ipi(processor_local_data[i].lapic_id, 0x447D);
 	}
+
+	/* Flush any queued log messages and make further output direct. */
+	klog_panic();
 }
 
 /**
@@ -41,6 +41,7 @@ static void snd_dsp_close(fs_node_t * node);
 static int snd_mixer_ioctl(fs_node_t * node, unsigned long request, void * argp);
 static void snd_mixer_open(fs_node_t * node, unsigned int flags);
 static void snd_mixer_close(fs_node_t * node);
+static snd_device_t * snd_main_device(void);
 
 static spin_lock_t _devices_lock;
 
@@ -72,6 +73,7 @@ struct dsp_node {
 	size_t samples;
 	size_t written;
 	int realtime;
+	int32_t volume; /* 0..256 fixed point, 256 = unity */
 };
 
 int snd_register(snd_device_t * device) {
@@ -126,10 +128,21 @@ static ssize_t snd_dsp_write(fs_node_t * node, off_t offset, size_t size, uint8_
 static int snd_dsp_ioctl(fs_node_t * node, unsigned long request, void * argp) {
 	/* Potentially use this to set sample rates in the future */
 	struct dsp_node * dsp = node->device;
-	if (request == 4) {
+	if (request == SND_DSP_SET_REALTIME) {
 		dsp->realtime = 1;
-	} else if (request == 5) {
+	} else if (request == SND_DSP_GET_SAMPLES) {
 		return dsp->samples;
+	} else if (request == SND_DSP_GET_POSITION) {
+		/* Where the hardware is actually playing, so a latency-sensitive
+		 * client can mix just-in-time instead of keeping the ring full. */
+		snd_device_t * device = snd_main_device();
+		if (!device || !device->get_position) return -EINVAL;
+		return device->get_position(device);
+	} else if (request == SND_DSP_SET_VOLUME) {
+		uint32_t vol = *(uint32_t *)argp;
+		if (vol > 256) vol = 256;
+		dsp->volume = vol;
+		return 0;
 	}
 	return -1;
 }
@@ -146,6 +159,7 @@ static void snd_dsp_open(fs_node_t * node, unsigned int flags) {
 	dsp->samples = 0;
 	dsp->written = 0;
 	dsp->realtime = 0;
+	dsp->volume = 256;
 	node->device = dsp;
 	spin_lock(_buffers_lock);
 	list_insert(&_buffers, node->device);
@@ -223,6 +237,24 @@ static int snd_mixer_ioctl(fs_node_t * node, unsigned long request, void * argp)
 			}
 			return device->mixer_write(value->id, value->val);
 		}
+		case SND_MIXER_GET_PERIOD: {
+			snd_period_config_t * cfg = argp;
+			snd_device_t * device = snd_device_by_id(cfg->device);
+			if (!device) {
+				return -EINVAL;
+			}
+			cfg->period_frames = device->period_frames;
+			cfg->period_count = device->period_count;
+			return 0;
+		}
+		case SND_MIXER_SET_PERIOD: {
+			snd_period_config_t * cfg = argp;
+			snd_device_t * device = snd_device_by_id(cfg->device);
+			if (!device || !device->set_period) {
+				return -EINVAL;
+			}
+			return device->set_period(device, cfg->period_frames);
+		}
 		default: {
 			return -EINVAL;
 		}
@@ -254,15 +286,21 @@ int snd_request_buf(snd_device_t * device, uint32_t size, uint8_t *buffer) {
 			ring_buffer_read(buf, this_read_size, (uint8_t *)tmp_buf);
 			dsp->samples += this_read_size / 4; /* 16 bits, 2 channels */
 			/*
-			 * Reduce the sample by a half so that multiple sources won't immediately
-			 * cause awful clipping. This is kind of a hack since it would probably be
-			 * better to just use some kind of compressor.
+			 * One pass over exactly the samples we read: apply the
+			 * per-stream volume, halve so several sources don't clip
+			 * immediately (a compressor would be nicer), accumulate in
+			 * 32 bits, and saturate - the old code wrapped on overflow
+			 * and made a separate halving pass over the whole scratch
+			 * buffer regardless of how much was actually read.
+			 * The kernel is built -mgeneral-regs-only, so this stays
+			 * scalar integer code and the compiler unrolls it.
 			 */
-			for (size_t i = 0; i < N_ELEMENTS(tmp_buf); i++) {
-				tmp_buf[i] /= 2;
-			}
+			int32_t volume = dsp->volume;
 			for (size_t i = 0; i < this_read_size / sizeof(*adding_ptr); i++) {
-				adding_ptr[i] += tmp_buf[i];
+				int32_t sum = adding_ptr[i] + ((tmp_buf[i] * volume) >> 9);
+				if (sum > INT16_MAX) sum = INT16_MAX;
+				else if (sum < INT16_MIN) sum = INT16_MIN;
+				adding_ptr[i] = sum;
 			}
 			adding_ptr += this_read_size / sizeof(*adding_ptr);
 			bytes_left -= this_read_size;
@@ -273,7 +311,7 @@ int snd_request_buf(snd_device_t * device, uint32_t size, uint8_t *buffer) {
 	return size;
 }
 
-static snd_device_t * snd_main_device() {
+static snd_device_t * snd_main_device(void) {
 	spin_lock(_devices_lock);
 	foreach(node, &_devices) {
 		spin_unlock(_devices_lock);
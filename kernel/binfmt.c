@@ -147,6 +147,9 @@ int system(const char * path, int argc, char *const argv[], char *const envin[])
 	this_core->current_process->thread.page_directory->directory = mmu_clone(NULL); /* base PML? for exec? */
 	this_core->current_process->thread.page_directory->refcount = 1;
 	spin_init(this_core->current_process->thread.page_directory->lock);
+	this_core->current_process->thread.page_directory->exec_node = NULL;
+	this_core->current_process->thread.page_directory->exec_segments = NULL;
+	this_core->current_process->thread.page_directory->exec_segment_count = 0;
 	mmu_set_directory(this_core->current_process->thread.page_directory->directory);
 	this_core->current_process->cmdline = (char**)argv_;
 	exec(path,argc,argv_,envin ? envin : env,0);
@@ -20,6 +20,7 @@
 #include <kernel/string.h>
 #include <kernel/printf.h>
 #include <kernel/misc.h>
+#include <kernel/boottrace.h>
 
 extern int system(const char * path, int argc, const char ** argv, const char ** envin);
 extern void tarfs_register_init(void);
@@ -33,6 +34,7 @@ extern void random_initialize(void);
 extern void snd_install(void);
 extern void net_install(void);
 extern void console_initialize(void);
+extern void klog_initialize(void);
 extern void modules_install(void);
 
 void generic_startup(void) {
@@ -43,6 +45,7 @@ void generic_startup(void) {
 	tarfs_register_init();
 	tmpfs_register_init();
 	map_vfs_directory("/dev");
+	boot_trace_event("vfs");
 	console_initialize();
 	packetfs_initialize();
 	zero_initialize();
@@ -50,7 +53,10 @@ void generic_startup(void) {
 	random_initialize();
 	snd_install();
 	net_install();
+	boot_trace_event("device interfaces");
 	tasking_start();
+	boot_trace_event("tasking");
+	klog_initialize();
 	modules_install();
 }
 
@@ -74,6 +80,7 @@ int generic_main(void) {
 		boot_app = args_value("init");
 	}
 
+	boot_trace_event("exec %s", boot_app);
 	dprintf("generic: Running %s as init process.\n", boot_app);
 
 	const char * argv[] = {
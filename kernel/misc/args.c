@@ -38,6 +38,84 @@ char * args_value(const char * karg) {
 	return hashmap_get(kernel_args_map, karg);
 }
 
+/* Parse a decimal or 0x-prefixed hexadecimal string; if @p end is
+ * given, parsing stops there instead of at the terminator. Returns
+ * @p def on empty or malformed input. */
+static long parse_int(const char * value, const char * end, long def) {
+	if (!value || !*value) return def;
+
+	int negate = 0;
+	if (*value == '-') { negate = 1; value++; }
+
+	long base = 10;
+	if (value[0] == '0' && (value[1] == 'x' || value[1] == 'X')) {
+		base = 16;
+		value += 2;
+	}
+
+	long out = 0;
+	int any = 0;
+	for (; *value && value != end; value++) {
+		long digit;
+		if (*value >= '0' && *value <= '9') digit = *value - '0';
+		else if (base == 16 && *value >= 'a' && *value <= 'f') digit = *value - 'a' + 10;
+		else if (base == 16 && *value >= 'A' && *value <= 'F') digit = *value - 'A' + 10;
+		else return def;
+		out = out * base + digit;
+		any = 1;
+	}
+
+	if (!any) return def;
+	return negate ? -out : out;
+}
+
+/**
+ * @brief Parse an argument as an integer.
+ *
+ * Accepts decimal, or hexadecimal with a 0x prefix. If the argument
+ * was not passed, has no value, or does not parse, @p def is returned.
+ */
+long args_value_int(const char * karg, long def) {
+	return parse_int(args_value(karg), NULL, def);
+}
+
+/**
+ * @brief Parse an argument as a byte size.
+ *
+ * Like @ref args_value_int, but an optional K, M, or G suffix
+ * (case-insensitive) scales the value.
+ */
+size_t args_value_size(const char * karg, size_t def) {
+	const char * value = args_value(karg);
+	if (!value || !*value) return def;
+
+	size_t scale = 1;
+	const char * end = value + strlen(value);
+	switch (end[-1]) {
+		case 'k': case 'K': scale = 1UL << 10; end--; break;
+		case 'm': case 'M': scale = 1UL << 20; end--; break;
+		case 'g': case 'G': scale = 1UL << 30; end--; break;
+	}
+
+	long out = parse_int(value, end, -1);
+	if (out < 0) return def;
+	return (size_t)out * scale;
+}
+
+/**
+ * @brief Interpret an argument as an on/off switch.
+ *
+ * Present with no value (or any value but 0, no, or off) is on;
+ * absent or explicitly disabled is off.
+ */
+int args_flag(const char * karg) {
+	if (!args_present(karg)) return 0;
+	const char * value = args_value(karg);
+	if (!value || !*value) return 1;
+	if (!strcmp(value, "0") || !strcmp(value, "no") || !strcmp(value, "off")) return 0;
+	return 1;
+}
+
 /**
  * @brief Parse the given arguments to the kernel.
  *
@@ -0,0 +1,84 @@
+/**
+ * @file  kernel/misc/boottrace.c
+ * @brief Timestamped timeline of the boot sequence.
+ *
+ * Records TSC-stamped events as each subsystem comes up - paging,
+ * scheduler, SMP, ramdisk unpacking, module loads, through to the
+ * exec of init - into a small static buffer. /proc/boottrace prints
+ * the timeline in microseconds relative to the first event; the
+ * boottrace tool renders it as a waterfall. Boot-to-desktop is a
+ * number we track, so regressions should name their culprit.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdint.h>
+#include <stdarg.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/time.h>
+#include <kernel/misc.h>
+#include <kernel/vfs.h>
+#include <kernel/boottrace.h>
+
+#define BOOT_TRACE_EVENTS 256
+#define BOOT_TRACE_LABEL  64
+
+struct boot_trace_entry {
+	uint64_t tsc;
+	char label[BOOT_TRACE_LABEL];
+};
+
+/* Static, so events can be recorded before the heap exists. */
+static struct boot_trace_entry boot_trace_entries[BOOT_TRACE_EVENTS];
+static int boot_trace_count = 0;
+static spin_lock_t boot_trace_lock = { 0 };
+
+/**
+ * @brief Record one boot event; excess events are silently dropped.
+ */
+void boot_trace_event(const char * fmt, ...) {
+	spin_lock(boot_trace_lock);
+	if (boot_trace_count < BOOT_TRACE_EVENTS) {
+		struct boot_trace_entry * entry = &boot_trace_entries[boot_trace_count];
+		entry->tsc = arch_perf_timer();
+		va_list args;
+		va_start(args, fmt);
+		vsnprintf(entry->label, BOOT_TRACE_LABEL, fmt, args);
+		va_end(args);
+		boot_trace_count++;
+	}
+	spin_unlock(boot_trace_lock);
+}
+
+/**
+ * @brief /proc/boottrace: "<microseconds since first event> <label>".
+ */
+ssize_t boottrace_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	size_t space = boot_trace_count * (BOOT_TRACE_LABEL + 24) + 16;
+	char * buf = malloc(space);
+	size_t soffset = 0;
+
+	uint64_t mhz = arch_cpu_mhz();
+	if (!mhz) mhz = 1;
+
+	for (int i = 0; i < boot_trace_count; ++i) {
+		uint64_t usec = (boot_trace_entries[i].tsc - boot_trace_entries[0].tsc) / mhz;
+		soffset += snprintf(&buf[soffset], BOOT_TRACE_LABEL + 24, "%10llu %s\n",
+				(unsigned long long)usec, boot_trace_entries[i].label);
+	}
+
+	if (offset > (off_t)soffset) {
+		free(buf);
+		return 0;
+	}
+
+	if (size > soffset - offset) size = soffset - offset;
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
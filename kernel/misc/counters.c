@@ -0,0 +1,68 @@
+/**
+ * @file  kernel/misc/counters.c
+ * @brief Storage and /proc/counters dump for the kernel event counters.
+ *
+ * The counters themselves are bumped straight from the hot paths via
+ * counter_bump() in kernel/counters.h; this file only owns the arrays
+ * and formats the dump: one line per event with the fleet-trendable
+ * total first, then the per-core breakdown.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/process.h>
+#include <kernel/vfs.h>
+#include <kernel/counters.h>
+
+struct kernel_counter_block kernel_counters[COUNTER_MAX_CORES] = {{{0}}};
+
+static const char * counter_names[COUNTER_MAX] = {
+	[COUNTER_SCHED_SWITCH]    = "sched_switch",
+	[COUNTER_FAULT_COW]       = "fault_cow",
+	[COUNTER_FAULT_DEMAND]    = "fault_demand",
+	[COUNTER_FAULT_STACK]     = "fault_stack",
+	[COUNTER_FAULT_SEGV]      = "fault_segv",
+	[COUNTER_TLB_SHOOTDOWN]   = "tlb_shootdown",
+	[COUNTER_BLOCKCACHE_HIT]  = "blockcache_hit",
+	[COUNTER_BLOCKCACHE_MISS] = "blockcache_miss",
+	[COUNTER_PBUF_ALLOC]      = "pbuf_alloc",
+	[COUNTER_PBUF_FREE]       = "pbuf_free",
+	[COUNTER_PIPE_WAKEUP]     = "pipe_wakeup",
+};
+
+ssize_t counters_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	int cores = processor_count < COUNTER_MAX_CORES ? processor_count : COUNTER_MAX_CORES;
+	size_t space = COUNTER_MAX * (32 + 24 * (cores + 1)) + 1;
+	char * buf = malloc(space);
+	size_t soffset = 0;
+
+	for (int c = 0; c < COUNTER_MAX; ++c) {
+		uint64_t total = 0;
+		for (int core = 0; core < cores; ++core) {
+			total += kernel_counters[core].counts[c];
+		}
+		soffset += snprintf(&buf[soffset], space - soffset, "%-16s %llu",
+			counter_names[c], (unsigned long long)total);
+		for (int core = 0; core < cores; ++core) {
+			soffset += snprintf(&buf[soffset], space - soffset, " %llu",
+				(unsigned long long)kernel_counters[core].counts[c]);
+		}
+		soffset += snprintf(&buf[soffset], space - soffset, "\n");
+	}
+
+	if (offset > (off_t)soffset) {
+		free(buf);
+		return 0;
+	}
+
+	if (size > soffset - (size_t)offset) size = soffset - offset;
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
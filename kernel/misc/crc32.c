@@ -0,0 +1,56 @@
+/**
+ * @file  kernel/misc/crc32.c
+ * @brief CRC32 with slice-by-8 tables.
+ *
+ * Eight independent table lookups per eight-byte step, so the chain
+ * of dependent shifts in the classic byte loop disappears; the tables
+ * are generated on first use into static storage, so this works
+ * before the heap is up (the ramdisk check needs it that early). The
+ * kernel builds without SSE, so unlike the userspace copy in
+ * lib/crc32.c there is no carryless-multiply path here.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/crc32.h>
+
+static uint32_t crc_table[8][256];
+static int crc_ready = 0;
+
+static void crc_init(void) {
+	for (int i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		crc_table[0][i] = c;
+	}
+	for (int i = 0; i < 256; ++i) {
+		for (int t = 1; t < 8; ++t) {
+			crc_table[t][i] = crc_table[0][crc_table[t-1][i] & 0xFF] ^ (crc_table[t-1][i] >> 8);
+		}
+	}
+	crc_ready = 1;
+}
+
+uint32_t crc32_calculate(uint32_t crc, const void * data, size_t len) {
+	const uint8_t * p = data;
+	if (!crc_ready) crc_init();
+	crc = ~crc;
+	while (len >= 8) {
+		uint32_t one = (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)) ^ crc;
+		uint32_t two = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+		crc = crc_table[7][one & 0xFF] ^ crc_table[6][(one >> 8) & 0xFF] ^
+		      crc_table[5][(one >> 16) & 0xFF] ^ crc_table[4][one >> 24] ^
+		      crc_table[3][two & 0xFF] ^ crc_table[2][(two >> 8) & 0xFF] ^
+		      crc_table[1][(two >> 16) & 0xFF] ^ crc_table[0][two >> 24];
+		p += 8;
+		len -= 8;
+	}
+	while (len--) {
+		crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
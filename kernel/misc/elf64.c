@@ -26,6 +26,7 @@
 #include <kernel/module.h>
 #include <kernel/hashmap.h>
 #include <kernel/mutex.h>
+#include <kernel/boottrace.h>
 
 hashmap_t * _modules_table = NULL;
 sched_mutex_t * _modules_mutex = NULL;
@@ -192,7 +193,9 @@ int elf_module(char ** args) {
 	int argc = 0;
 	for (char ** aa = args; *aa; ++aa) ++argc;
 
-	return moduleData->init(argc, args);
+	int status = moduleData->init(argc, args);
+	boot_trace_event("module %s", moduleData->name);
+	return status;
 
 _unmap_module:
 	close_fs(file);
@@ -263,24 +266,30 @@ int elf_exec(const char * path, fs_node_t * file, int argc, const char *const ar
 	page_directory_t * this_directory = this_core->current_process->thread.page_directory;
 	this_core->current_process->thread.page_directory = malloc(sizeof(page_directory_t));
 	this_core->current_process->thread.page_directory->refcount = 1;
+	this_core->current_process->thread.page_directory->exec_node = NULL;
+	this_core->current_process->thread.page_directory->exec_segments = NULL;
+	this_core->current_process->thread.page_directory->exec_segment_count = 0;
 	spin_init(this_core->current_process->thread.page_directory->lock);
 	this_core->current_process->thread.page_directory->directory = mmu_clone(NULL);
 	mmu_set_directory(this_core->current_process->thread.page_directory->directory);
 	process_release_directory(this_directory);
 
+	/* Record the loadable segments rather than reading them in here;
+	 * pages are allocated and filled on first touch by
+	 * @ref elf_demand_load, so exec pays no I/O or zeroing cost for
+	 * pages the process never touches. */
+	exec_segment_t * segments = malloc(sizeof(exec_segment_t) * header.e_phnum);
+	int segment_count = 0;
+
 	for (int i = 0; i < header.e_phnum; ++i) {
 		Elf64_Phdr phdr;
 		read_fs(file, header.e_phoff + header.e_phentsize * i, sizeof(Elf64_Phdr), (uint8_t*)&phdr);
 		if (phdr.p_type == PT_LOAD) {
-			for (uintptr_t i = phdr.p_vaddr; i < phdr.p_vaddr + phdr.p_memsz; i += 0x1000) {
-				union PML * page = mmu_get_page(i, MMU_GET_MAKE);
-				mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
-			}
-
-			read_fs(file, phdr.p_offset, phdr.p_filesz, (void*)phdr.p_vaddr);
-			for (size_t i = phdr.p_filesz; i < phdr.p_memsz; ++i) {
-				*(char*)(phdr.p_vaddr + i) = 0;
-			}
+			segments[segment_count].vaddr  = phdr.p_vaddr;
+			segments[segment_count].memsz  = phdr.p_memsz;
+			segments[segment_count].filesz = phdr.p_filesz;
+			segments[segment_count].offset = phdr.p_offset;
+			segment_count++;
 
 			if (phdr.p_vaddr + phdr.p_memsz > heapBase) {
 				heapBase = phdr.p_vaddr + phdr.p_memsz;
@@ -296,15 +305,22 @@ int elf_exec(const char * path, fs_node_t * file, int argc, const char *const ar
 	this_core->current_process->image.heap  = (heapBase + 0xFFF) & (~0xFFF);
 	this_core->current_process->image.entry = header.e_entry;
 
-	close_fs(file);
+	/* The file stays open to back demand loads; it is released with the
+	 * page directory. */
+	this_core->current_process->thread.page_directory->exec_node = file;
+	this_core->current_process->thread.page_directory->exec_segments = segments;
+	this_core->current_process->thread.page_directory->exec_segment_count = segment_count;
 
 	// arch_set_...?
 
-	/* Map stack space */
+	/* Map stack space; pages start out backed by the shared zero page
+	 * and take private frames on first write, so only the stack pages
+	 * the argument setup below and the process actually dirty cost a
+	 * frame and a memset. */
 	uintptr_t userstack = 0x800000000000;
 	for (uintptr_t i = userstack - 16 * 0x400; i < userstack; i += 0x1000) {
 		union PML * page = mmu_get_page(i, MMU_GET_MAKE);
-		mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+		mmu_frame_map_zero(page);
 	}
 
 	this_core->current_process->image.userstack = userstack - 16 * 0x400;
@@ -371,3 +387,124 @@ int elf_exec(const char * path, fs_node_t * file, int argc, const char *const ar
 
 	return -EINVAL;
 }
+
+/**
+ * @brief Load a page of a demand-paged executable segment.
+ *
+ * Called from the page fault handler (and from pointer validation, for
+ * syscalls handed buffers in pages that have not been touched yet) when
+ * a not-present fault lands in the current address space. If the page
+ * falls within a segment recorded by @ref elf_exec, a frame is
+ * allocated, filled from the backing file, zeroed beyond the file data,
+ * and mapped; the faulting access then retries successfully.
+ *
+ * Concurrent faults on the same page from threads sharing the directory
+ * are resolved with the page entry's 'loading' bit: the first taker
+ * sets it and does the read, later arrivals yield until the page shows
+ * up present. Frames are filled through the physical map and only
+ * marked present once their contents are complete.
+ *
+ * Faults are served in batches: starting at the faulting page, a run
+ * of up to @ref ELF_DEMAND_RUN untouched file-backed pages is claimed
+ * at once, backed by one contiguous frame allocation, and filled with
+ * a single large read per intersecting segment. Binaries are read
+ * mostly front to back, so this turns the common page-per-fault
+ * trickle of 4 KiB reads into a few big ones. Pages holding no file
+ * data at all (pure BSS) skip I/O and frame allocation entirely - they
+ * are backed by the shared zero page, copy-on-write.
+ *
+ * @param address Faulting address.
+ * @returns 1 if the fault was resolved, 0 if this is not a demand-load page.
+ */
+#define ELF_DEMAND_RUN 16
+
+/* Does this page contain any file-backed segment data? */
+static int elf_page_has_file_data(page_directory_t * dir, uintptr_t page_base) {
+	for (int i = 0; i < dir->exec_segment_count; ++i) {
+		exec_segment_t * s = &dir->exec_segments[i];
+		if (page_base + 0x1000 > s->vaddr && page_base < s->vaddr + s->filesz) return 1;
+	}
+	return 0;
+}
+
+int elf_demand_load(uintptr_t address) {
+	volatile process_t * proc = this_core->current_process;
+	if (!proc) return 0;
+	page_directory_t * dir = proc->thread.page_directory;
+	if (!dir || !dir->exec_segments) return 0;
+	if (address >= 0x800000000000UL) return 0;
+
+	uintptr_t page_base = address & ~0xFFFUL;
+
+	int intersects = 0;
+	for (int i = 0; i < dir->exec_segment_count; ++i) {
+		exec_segment_t * s = &dir->exec_segments[i];
+		if (page_base + 0x1000 > s->vaddr && page_base < s->vaddr + s->memsz) {
+			intersects = 1;
+			break;
+		}
+	}
+	if (!intersects) return 0;
+
+retry:
+	spin_lock(dir->lock);
+	union PML * page = mmu_get_page(page_base, MMU_GET_MAKE);
+	if (page->bits.present) {
+		/* Another thread already loaded this page. */
+		spin_unlock(dir->lock);
+		return 1;
+	}
+	if (page->bits.loading) {
+		/* Another thread is reading it in; let it finish. */
+		spin_unlock(dir->lock);
+		switch_task(1);
+		goto retry;
+	}
+
+	if (!elf_page_has_file_data(dir, page_base)) {
+		/* Pure BSS: no I/O needed, just hand out the zero page. */
+		mmu_frame_map_zero(page);
+		spin_unlock(dir->lock);
+		return 1;
+	}
+
+	/* Claim a run of untouched file-backed pages following this one,
+	 * so they can all be filled with one allocation and one read. */
+	union PML * run_pages[ELF_DEMAND_RUN];
+	run_pages[0] = page;
+	page->bits.loading = 1;
+	int run = 1;
+	while (run < ELF_DEMAND_RUN) {
+		uintptr_t next = page_base + run * 0x1000;
+		if (next >= 0x800000000000UL) break;
+		if (!elf_page_has_file_data(dir, next)) break;
+		union PML * p = mmu_get_page(next, MMU_GET_MAKE);
+		if (p->bits.present || p->bits.loading) break;
+		p->bits.loading = 1;
+		run_pages[run++] = p;
+	}
+	spin_unlock(dir->lock);
+
+	uintptr_t frame = (run == 1) ? mmu_allocate_a_frame() : mmu_allocate_n_frames(run);
+	uint8_t * data = mmu_map_from_physical(frame << 12);
+	memset(data, 0, run * 0x1000);
+
+	/* The run can straddle several segments, so fill the file-backed
+	 * portion of each one that intersects it. */
+	for (int i = 0; i < dir->exec_segment_count; ++i) {
+		exec_segment_t * s = &dir->exec_segments[i];
+		uintptr_t start = s->vaddr > page_base ? s->vaddr : page_base;
+		uintptr_t end   = s->vaddr + s->filesz < page_base + run * 0x1000 ? s->vaddr + s->filesz : page_base + run * 0x1000;
+		if (start >= end) continue;
+		read_fs(dir->exec_node, s->offset + (start - s->vaddr), end - start, data + (start - page_base));
+	}
+
+	spin_lock(dir->lock);
+	for (int i = 0; i < run; ++i) {
+		run_pages[i]->bits.page = frame + i;
+		run_pages[i]->bits.loading = 0;
+		mmu_frame_allocate(run_pages[i], MMU_FLAG_WRITABLE);
+	}
+	spin_unlock(dir->lock);
+	return 1;
+}
@@ -51,8 +51,53 @@ static uint32_t bg_color = BG_COLOR;
 
 extern uint32_t lfb_resolution_s;
 
+/*
+ * Shadow buffer for 32bpp framebuffers. Characters are rendered here,
+ * in ordinary memory, and dirty rows are flushed to video memory in
+ * bulk; scrolling is a memmove within the shadow rather than a painful
+ * read-back from the framebuffer. 24bpp modes keep the direct path.
+ */
+static uint32_t * shadow_buffer = NULL;
+static int shadow_w = 0;
+static int shadow_h = 0;
+static int dirty_x0, dirty_y0, dirty_x1, dirty_y1;
+
+static void shadow_mark(int x0, int y0, int x1, int y1) {
+	if (x0 < dirty_x0) dirty_x0 = x0;
+	if (y0 < dirty_y0) dirty_y0 = y0;
+	if (x1 > dirty_x1) dirty_x1 = x1;
+	if (y1 > dirty_y1) dirty_y1 = y1;
+}
+
+/* Flush the dirty region of the shadow buffer to video memory, by row. */
+static void shadow_flush(void) {
+	if (!shadow_buffer) return;
+	if (dirty_x0 < 0) dirty_x0 = 0;
+	if (dirty_y0 < 0) dirty_y0 = 0;
+	if (dirty_x1 > shadow_w) dirty_x1 = shadow_w;
+	if (dirty_y1 > shadow_h) dirty_y1 = shadow_h;
+	/* Widen to 16-byte boundaries so each row copy starts and ends on
+	 * a write-combining buffer boundary; the extra pixels are already
+	 * correct in the shadow, so repainting them is free. */
+	dirty_x0 &= ~3;
+	dirty_x1 = (dirty_x1 + 3) & ~3;
+	if (dirty_x1 > shadow_w) dirty_x1 = shadow_w;
+	for (int row = dirty_y0; row < dirty_y1; ++row) {
+		memcpy(lfb_vid_memory + row * lfb_resolution_s + dirty_x0 * 4,
+			&shadow_buffer[row * shadow_w + dirty_x0],
+			(dirty_x1 - dirty_x0) * 4);
+	}
+	dirty_x0 = shadow_w;
+	dirty_y0 = shadow_h;
+	dirty_x1 = 0;
+	dirty_y1 = 0;
+}
+
 static inline void set_point(int x, int y, uint32_t value) {
-	if (lfb_resolution_b == 32) {
+	if (shadow_buffer) {
+		if (x < 0 || y < 0 || x >= shadow_w || y >= shadow_h) return;
+		shadow_buffer[y * shadow_w + x] = value;
+	} else if (lfb_resolution_b == 32) {
 		((uint32_t*)lfb_vid_memory)[y * (lfb_resolution_s/4) + x] = value;
 	} else if (lfb_resolution_b == 24) {
 		lfb_vid_memory[y * lfb_resolution_s + x * 3 + 0] = (value >> 0) & 0xFF;
@@ -79,6 +124,8 @@ static void fb_write_char(int _x, int _y, int val, uint32_t color) {
 			}
 		}
 	}
+
+	shadow_mark(x, y, x + char_width, y + char_height);
 }
 
 /**
@@ -113,8 +160,14 @@ static int fb_get_height(void) {
 }
 
 static void fb_scroll_terminal(void) {
-	memmove(lfb_vid_memory, lfb_vid_memory + sizeof(uint32_t) * lfb_resolution_x * char_height, (lfb_resolution_y - char_height) * lfb_resolution_x * 4);
-	memset(lfb_vid_memory + sizeof(uint32_t) * (lfb_resolution_y - char_height) * lfb_resolution_x, 0x00, char_height * lfb_resolution_x * 4);
+	if (shadow_buffer) {
+		memmove(shadow_buffer, shadow_buffer + shadow_w * char_height, (shadow_h - char_height) * shadow_w * 4);
+		memset(shadow_buffer + (shadow_h - char_height) * shadow_w, 0x00, char_height * shadow_w * 4);
+		shadow_mark(0, 0, shadow_w, shadow_h);
+	} else {
+		memmove(lfb_vid_memory, lfb_vid_memory + sizeof(uint32_t) * lfb_resolution_x * char_height, (lfb_resolution_y - char_height) * lfb_resolution_x * 4);
+		memset(lfb_vid_memory + sizeof(uint32_t) * (lfb_resolution_y - char_height) * lfb_resolution_x, 0x00, char_height * lfb_resolution_x * 4);
+	}
 }
 
 static void draw_square(int x, int y) {
@@ -145,7 +198,29 @@ static void fbterm_init_framebuffer(void) {
 	get_width = fb_get_width;
 	get_height = fb_get_height;
 	scroll_terminal = fb_scroll_terminal;
+
+	if (lfb_resolution_b == 32) {
+		shadow_buffer = malloc(lfb_resolution_x * lfb_resolution_y * 4);
+		if (shadow_buffer) {
+			shadow_w = lfb_resolution_x;
+			shadow_h = lfb_resolution_y;
+			/* Seed from whatever is on screen - one read-back, at init only */
+			for (int row = 0; row < shadow_h; ++row) {
+				memcpy(&shadow_buffer[row * shadow_w], lfb_vid_memory + row * lfb_resolution_s, shadow_w * 4);
+			}
+			dirty_x0 = shadow_w;
+			dirty_y0 = shadow_h;
+			dirty_x1 = 0;
+			dirty_y1 = 0;
+		}
+	}
+
 	fbterm_draw_logo();
+
+	if (shadow_buffer) {
+		shadow_mark(0, 0, shadow_w, shadow_h);
+		shadow_flush();
+	}
 }
 
 static void ega_write_char(int x, int y, int ch, uint32_t color) {
@@ -295,13 +370,16 @@ size_t fbterm_write(size_t size, uint8_t *buffer) {
 	for (unsigned int i = 0; i < size; ++i) {
 		process_char(buffer[i]);
 	}
+	/* One flush per write call, so a burst of scrolled lines pays for
+	 * a single pass over the framebuffer instead of one per line. */
+	shadow_flush();
 	if (previous_writer) previous_writer(size,buffer);
 	return size;
 }
 
 void fbterm_initialize(void) {
 	if (lfb_resolution_x) {
-		if (args_present("fbterm-scroll")) {
+		if (args_flag("fbterm-scroll")) {
 			fbterm_scroll = 1;
 		}
 		fbterm_init_framebuffer();
@@ -0,0 +1,211 @@
+/**
+ * @brief Open-addressing integer map with incremental resize.
+ *
+ * Companion to the chained hashmap for the kernel's hot paths: keys
+ * and values live inline in one array, so a lookup walks adjacent
+ * slots instead of chasing per-entry allocations, and an insert is
+ * just stores unless the table grows. Robin Hood probing keeps probe
+ * distances short and uniform; deletion backward-shifts the cluster
+ * instead of leaving tombstones. When the table passes 3/4 load the
+ * array is doubled but the old one is drained a few slots per write,
+ * bounding the cost of any single operation.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2022 K. Lange
+ */
+#include <kernel/string.h>
+#include <kernel/list.h>
+#include <kernel/flatmap.h>
+
+#define FLATMAP_MIN_CAPACITY 16
+#define FLATMAP_MIGRATE_STEP 8
+
+/* Fibonacci hashing; spreads the dense small keys our users favor */
+static inline size_t flatmap_slot(uintptr_t key, size_t shift) {
+	return (key * 0x9E3779B97F4A7C15UL) >> shift;
+}
+
+static flatmap_entry_t * table_find(flatmap_entry_t * entries, size_t capacity, size_t shift, uintptr_t key) {
+	size_t mask = capacity - 1;
+	size_t i = flatmap_slot(key, shift);
+	uint32_t dist = 1;
+	while (entries[i].dist >= dist) {
+		if (entries[i].key == key) return &entries[i];
+		i = (i + 1) & mask;
+		dist++;
+	}
+	return NULL;
+}
+
+static void table_insert(flatmap_entry_t * entries, size_t capacity, size_t shift, uintptr_t key, void * value) {
+	size_t mask = capacity - 1;
+	size_t i = flatmap_slot(key, shift);
+	flatmap_entry_t cur = { key, value, 1 };
+	while (entries[i].dist) {
+		if (entries[i].dist < cur.dist) {
+			/* Rob the rich: displace the closer-to-home entry */
+			flatmap_entry_t tmp = entries[i];
+			entries[i] = cur;
+			cur = tmp;
+		}
+		i = (i + 1) & mask;
+		cur.dist++;
+	}
+	entries[i] = cur;
+}
+
+static void table_delete(flatmap_entry_t * entries, size_t capacity, flatmap_entry_t * slot) {
+	size_t mask = capacity - 1;
+	size_t i = slot - entries;
+	while (1) {
+		size_t next = (i + 1) & mask;
+		if (entries[next].dist <= 1) {
+			entries[i].dist = 0;
+			return;
+		}
+		entries[i] = entries[next];
+		entries[i].dist--;
+		i = next;
+	}
+}
+
+/* Move a few entries from the draining array into the active one */
+static void flatmap_migrate(flatmap_t * map) {
+	if (!map->old_entries) return;
+	int moved = 0;
+	while (map->migrated < map->old_capacity) {
+		flatmap_entry_t * e = &map->old_entries[map->migrated];
+		if (e->dist) {
+			table_insert(map->entries, map->capacity, map->shift, e->key, e->value);
+			e->dist = 0;
+			if (++moved == FLATMAP_MIGRATE_STEP) return;
+		}
+		map->migrated++;
+	}
+	free(map->old_entries);
+	map->old_entries = NULL;
+}
+
+static void flatmap_grow(flatmap_t * map) {
+	/* If the previous grow is somehow still draining, finish it */
+	while (map->old_entries) flatmap_migrate(map);
+
+	map->old_entries  = map->entries;
+	map->old_capacity = map->capacity;
+	map->old_shift    = map->shift;
+	map->migrated     = 0;
+
+	map->capacity *= 2;
+	map->shift--;
+	map->entries = malloc(map->capacity * sizeof(flatmap_entry_t));
+	memset(map->entries, 0, map->capacity * sizeof(flatmap_entry_t));
+}
+
+flatmap_t * flatmap_create(size_t expected) {
+	size_t capacity = FLATMAP_MIN_CAPACITY;
+	size_t shift = 64 - 4;
+	while (capacity < expected * 2) {
+		capacity *= 2;
+		shift--;
+	}
+
+	flatmap_t * map = malloc(sizeof(flatmap_t));
+	map->entries = malloc(capacity * sizeof(flatmap_entry_t));
+	memset(map->entries, 0, capacity * sizeof(flatmap_entry_t));
+	map->old_entries = NULL;
+	map->capacity = capacity;
+	map->old_capacity = 0;
+	map->shift = shift;
+	map->old_shift = 0;
+	map->count = 0;
+	map->migrated = 0;
+	return map;
+}
+
+void * flatmap_set(flatmap_t * map, uintptr_t key, void * value) {
+	flatmap_migrate(map);
+
+	/* An existing entry lives in exactly one of the two arrays */
+	if (map->old_entries) {
+		flatmap_entry_t * e = table_find(map->old_entries, map->old_capacity, map->old_shift, key);
+		if (e) {
+			void * out = e->value;
+			table_delete(map->old_entries, map->old_capacity, e);
+			table_insert(map->entries, map->capacity, map->shift, key, value);
+			return out;
+		}
+	}
+
+	flatmap_entry_t * e = table_find(map->entries, map->capacity, map->shift, key);
+	if (e) {
+		void * out = e->value;
+		e->value = value;
+		return out;
+	}
+
+	if ((map->count + 1) * 4 >= map->capacity * 3) {
+		flatmap_grow(map);
+	}
+
+	table_insert(map->entries, map->capacity, map->shift, key, value);
+	map->count++;
+	return NULL;
+}
+
+void * flatmap_get(flatmap_t * map, uintptr_t key) {
+	flatmap_entry_t * e = table_find(map->entries, map->capacity, map->shift, key);
+	if (!e && map->old_entries) {
+		e = table_find(map->old_entries, map->old_capacity, map->old_shift, key);
+	}
+	return e ? e->value : NULL;
+}
+
+int flatmap_has(flatmap_t * map, uintptr_t key) {
+	if (table_find(map->entries, map->capacity, map->shift, key)) return 1;
+	if (map->old_entries && table_find(map->old_entries, map->old_capacity, map->old_shift, key)) return 1;
+	return 0;
+}
+
+void * flatmap_remove(flatmap_t * map, uintptr_t key) {
+	flatmap_migrate(map);
+
+	flatmap_entry_t * e = table_find(map->entries, map->capacity, map->shift, key);
+	if (e) {
+		void * out = e->value;
+		table_delete(map->entries, map->capacity, e);
+		map->count--;
+		return out;
+	}
+
+	if (map->old_entries) {
+		e = table_find(map->old_entries, map->old_capacity, map->old_shift, key);
+		if (e) {
+			void * out = e->value;
+			table_delete(map->old_entries, map->old_capacity, e);
+			map->count--;
+			return out;
+		}
+	}
+
+	return NULL;
+}
+
+list_t * flatmap_values(flatmap_t * map) {
+	list_t * l = list_create("flatmap values", map);
+	for (size_t i = 0; i < map->capacity; ++i) {
+		if (map->entries[i].dist) list_insert(l, map->entries[i].value);
+	}
+	if (map->old_entries) {
+		for (size_t i = 0; i < map->old_capacity; ++i) {
+			if (map->old_entries[i].dist) list_insert(l, map->old_entries[i].value);
+		}
+	}
+	return l;
+}
+
+void flatmap_free(flatmap_t * map) {
+	free(map->entries);
+	if (map->old_entries) free(map->old_entries);
+}
@@ -0,0 +1,230 @@
+/**
+ * @file  kernel/misc/ftrace.c
+ * @brief Function-entry tracer with per-function enablement.
+ *
+ * Complements the sampling profiler for cause-chasing: rather than
+ * statistically catching hot spots, this records every entry to a
+ * chosen set of kernel functions with a TSC timestamp, so sequences
+ * like switch_task -> switch_next can be followed with real timing.
+ *
+ * Build the kernel with
+ *     KERNEL_CFLAGS += -pg -mfentry -mrecord-mcount -mnop-mcount
+ * and every C function starts with a five-byte nop whose address is
+ * recorded in the __mcount_loc section. Enabling a function rewrites
+ * its nop into `call __fentry__` (kernel/arch/x86_64/ftrace.S), which
+ * logs into per-core rings drained as text from /proc/ftrace. Without
+ * those flags the site table is empty and everything here is inert.
+ *
+ * Patching is a plain store; enable tracing from a quiet system, not
+ * while all cores are hammering the function being patched.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/process.h>
+#include <kernel/ksym.h>
+#include <kernel/vfs.h>
+#include <kernel/ftrace.h>
+
+#define FTRACE_RING_ENTRIES 4096 /* Per core */
+#define FTRACE_MAX_CORES 32
+#define FTRACE_SITE_BYTES 5
+
+/* Provided by the linker script; empty when built without -pg. */
+extern uintptr_t __start___mcount_loc[];
+extern uintptr_t __stop___mcount_loc[];
+
+struct ftrace_record {
+	uint64_t  tsc;
+	uintptr_t func;
+	uintptr_t caller;
+};
+
+struct ftrace_ring {
+	struct ftrace_record * records;
+	volatile size_t head;
+	volatile size_t tail;
+	uint64_t dropped;
+};
+
+static struct ftrace_ring ftrace_rings[FTRACE_MAX_CORES];
+static uintptr_t * ftrace_sites = NULL;
+static size_t ftrace_site_count = 0;
+static spin_lock_t ftrace_lock = { 0 };
+
+/* The call emitted when a site is enabled, and the nop it replaces. */
+static const uint8_t ftrace_nop[FTRACE_SITE_BYTES] = { 0x0f, 0x1f, 0x44, 0x00, 0x00 };
+
+void __fentry__(void);
+
+/**
+ * @brief Sort the trace site table so functions can be found by address.
+ */
+void ftrace_initialize(void) {
+	ftrace_sites = __start___mcount_loc;
+	ftrace_site_count = __stop___mcount_loc - __start___mcount_loc;
+
+	for (size_t i = 1; i < ftrace_site_count; ++i) {
+		for (size_t j = i; j > 0 && ftrace_sites[j-1] > ftrace_sites[j]; --j) {
+			uintptr_t tmp = ftrace_sites[j-1];
+			ftrace_sites[j-1] = ftrace_sites[j];
+			ftrace_sites[j] = tmp;
+		}
+	}
+}
+
+static int ftrace_site_for(uintptr_t addr) {
+	size_t low = 0, high = ftrace_site_count;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if (ftrace_sites[mid] == addr) return (int)mid;
+		if (ftrace_sites[mid] < addr) low = mid + 1;
+		else high = mid;
+	}
+	return -1;
+}
+
+static void ftrace_patch(uintptr_t site, int enable) {
+	uint8_t bytes[FTRACE_SITE_BYTES];
+	if (enable) {
+		int32_t rel = (int32_t)((intptr_t)&__fentry__ - (intptr_t)(site + FTRACE_SITE_BYTES));
+		bytes[0] = 0xe8; /* call rel32 */
+		memcpy(&bytes[1], &rel, sizeof(rel));
+	} else {
+		memcpy(bytes, ftrace_nop, FTRACE_SITE_BYTES);
+	}
+	memcpy((void*)site, bytes, FTRACE_SITE_BYTES);
+}
+
+/**
+ * @brief Record one function entry on the current core.
+ *
+ * Only ever called from patched sites, so there is no global "active"
+ * check. Must not itself be traced.
+ */
+__attribute__((no_profile_instrument_function))
+void ftrace_entry(uintptr_t site_ret, uintptr_t parent) {
+	struct ftrace_ring * ring = &ftrace_rings[this_core->cpu_id];
+	if (!ring->records) return;
+
+	if (ring->tail - ring->head == FTRACE_RING_ENTRIES) {
+		ring->dropped++;
+		return;
+	}
+
+	struct ftrace_record * rec = &ring->records[ring->tail % FTRACE_RING_ENTRIES];
+	uint32_t lo, hi;
+	asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+	rec->tsc    = ((uint64_t)hi << 32) | lo;
+	rec->func   = site_ret - FTRACE_SITE_BYTES;
+	rec->caller = parent;
+	__sync_synchronize();
+	ring->tail = ring->tail + 1;
+}
+
+/**
+ * @brief Enable, disable, or reset tracing; sysfunc backend.
+ *
+ * args[0] is "enable", "disable", or "reset"; for enable and disable
+ * the remaining entries name kernel functions (global symbols only).
+ * "disable" with no names restores every patched site.
+ */
+int ftrace_command(char ** args) {
+	if (!ftrace_site_count) return -EINVAL;
+	if (!args[0]) return -EINVAL;
+
+	spin_lock(ftrace_lock);
+
+	if (!strcmp(args[0], "reset")) {
+		for (int i = 0; i < FTRACE_MAX_CORES; ++i) {
+			ftrace_rings[i].head = ftrace_rings[i].tail = 0;
+			ftrace_rings[i].dropped = 0;
+		}
+		spin_unlock(ftrace_lock);
+		return 0;
+	}
+
+	int enable = !strcmp(args[0], "enable");
+	if (!enable && strcmp(args[0], "disable")) {
+		spin_unlock(ftrace_lock);
+		return -EINVAL;
+	}
+
+	if (!args[1]) {
+		if (enable) {
+			spin_unlock(ftrace_lock);
+			return -EINVAL;
+		}
+		/* Bare disable: restore everything. */
+		for (size_t i = 0; i < ftrace_site_count; ++i) {
+			if (*(uint8_t*)ftrace_sites[i] == 0xe8) ftrace_patch(ftrace_sites[i], 0);
+		}
+		spin_unlock(ftrace_lock);
+		return 0;
+	}
+
+	if (enable) {
+		for (int i = 0; i < FTRACE_MAX_CORES; ++i) {
+			if (!ftrace_rings[i].records) {
+				ftrace_rings[i].records = malloc(FTRACE_RING_ENTRIES * sizeof(struct ftrace_record));
+			}
+		}
+	}
+
+	for (char ** arg = &args[1]; *arg; ++arg) {
+		uintptr_t addr = (uintptr_t)ksym_lookup(*arg);
+		int site = addr ? ftrace_site_for(addr) : -1;
+		if (site < 0) {
+			spin_unlock(ftrace_lock);
+			return -ENOENT;
+		}
+		ftrace_patch(ftrace_sites[site], enable);
+	}
+
+	spin_unlock(ftrace_lock);
+	return 0;
+}
+
+/**
+ * @brief Drain trace records as text.
+ *
+ * One line per record - core, timestamp, function, caller - resolved
+ * against the kernel symbol table. Like /proc/profile, this is a
+ * stream: records are consumed as they are read and offsets are
+ * ignored.
+ */
+ssize_t ftrace_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	size_t written = 0;
+	char line[160];
+
+	spin_lock(ftrace_lock);
+	for (int cpu = 0; cpu < FTRACE_MAX_CORES; ++cpu) {
+		struct ftrace_ring * ring = &ftrace_rings[cpu];
+		if (!ring->records) continue;
+		while (ring->head != ring->tail) {
+			struct ftrace_record * rec = &ring->records[ring->head % FTRACE_RING_ENTRIES];
+			const char * fname = NULL, * cname = NULL;
+			uintptr_t fbase = ksym_find_nearest(rec->func, &fname);
+			uintptr_t cbase = ksym_find_nearest(rec->caller, &cname);
+			size_t len = snprintf(line, sizeof(line), "cpu%d %llu %s+0x%zx <- %s+0x%zx\n",
+					cpu, (unsigned long long)rec->tsc,
+					fname ? fname : "?", rec->func - fbase,
+					cname ? cname : "?", rec->caller - cbase);
+			if (written + len > size) goto _done;
+			memcpy(buffer + written, line, len);
+			written += len;
+			ring->head = ring->head + 1;
+		}
+	}
+_done:
+	spin_unlock(ftrace_lock);
+	return written;
+}
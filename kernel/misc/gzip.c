@@ -16,6 +16,7 @@
  */
 #include <stdint.h>
 #include <stddef.h>
+#include <kernel/crc32.h>
 
 static uint8_t bit_buffer = 0;
 static char buffer_size = 0;
@@ -433,6 +434,8 @@ static unsigned int read_32le(void) {
 
 int gzip_decompress(void) {
 
+	uint8_t * output_start = gzip_outputPtr;
+
 	/* Read gzip headers */
 	if (read_byte() != 0x1F) return 1;
 	if (read_byte() != 0x8B) return 1;
@@ -478,12 +481,17 @@ int gzip_decompress(void) {
 
 	int status = deflate_decompress();
 
-	/* Read CRC and decompressed size from end of input */
+	/* Read CRC and decompressed size from end of input, and verify
+	 * the output against both; a corrupted ramdisk fails here rather
+	 * than as garbage file contents later. */
 	unsigned int crc32 = read_32le();
 	unsigned int dsize = read_32le();
 
-	(void)crc32;
-	(void)dsize;
+	if (!status) {
+		size_t out_len = gzip_outputPtr - output_start;
+		if ((uint32_t)out_len != dsize) return 1;
+		if (crc32_calculate(0, output_start, out_len) != crc32) return 1;
+	}
 
 	return status;
 }
@@ -0,0 +1,305 @@
+/**
+ * @file  kernel/misc/klog.c
+ * @brief Buffered kernel log with per-core rings and an async drain.
+ *
+ * dprintf() used to push every character through the console output
+ * synchronously, so a chatty driver would serialize cores behind the
+ * serial port and skew the timing of whatever it was logging. Once
+ * tasking is up, messages instead land in a per-core ring - reserved
+ * with a compare-and-swap, filled, then committed with a single size
+ * store, so logging never takes a lock and is safe from interrupt
+ * context - and a worker thread merges the rings in timestamp order
+ * out to the console. Each record keeps a severity (see the prefixes
+ * in klog.h); errors and worse still drain synchronously so they hit
+ * the wire before a crash, and a panic switches everything back to
+ * direct output after flushing what is queued.
+ *
+ * The drained stream is retained in a ring readable from /proc/klog,
+ * with a "<N>" severity tag on each message so readers can filter.
+ * The 'klog=N' kernel argument caps what goes to the console without
+ * affecting what /proc/klog retains, so verbose logging can stay on
+ * without the console paying for it.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/process.h>
+#include <kernel/spinlock.h>
+#include <kernel/time.h>
+#include <kernel/args.h>
+#include <kernel/klog.h>
+
+#define KLOG_RING_SIZE   8192   /* Per-core; power of two. */
+#define KLOG_STREAM_SIZE 32768  /* Retained for /proc/klog; power of two. */
+#define KLOG_MAX_CORES   32     /* Matches processor_local_data. */
+#define KLOG_PAD_MARKER  0xFFFFFFFFUL
+#define KLOG_SYNC_LEVEL  3      /* err and worse drain before returning. */
+
+typedef struct klog_record {
+	uint32_t size;      /* Total reserved bytes incl. header; 0 = not yet committed. */
+	uint16_t length;    /* Bytes of message text. */
+	uint8_t  severity;
+	uint8_t  raw;       /* Message asked to skip the timestamp prefix. */
+	unsigned long ticks;
+	unsigned long subticks;
+	char     text[];
+} klog_record_t;
+
+struct klog_ring {
+	uint8_t * data;
+	volatile uint64_t head;    /* Consumed up to here; drain side only. */
+	volatile uint64_t tail;    /* Reserved up to here; advanced by CAS. */
+	volatile uint64_t dropped;
+	uint64_t reported;         /* Drops already complained about; drain side only. */
+};
+
+int klog_active = 0;
+
+static struct klog_ring klog_rings[KLOG_MAX_CORES];
+static uint8_t * klog_stream = NULL;
+static uint64_t klog_stream_tail = 0;
+static int klog_console_level = 7;
+static int klog_panicked = 0;
+static spin_lock_t klog_flush_lock;
+static list_t * klog_wake = NULL;
+
+/* Scratch for rendering one record; only touched under the flush lock
+ * (or after a panic, when no other core is running). */
+static char klog_fmt_buf[4096];
+
+/**
+ * @brief Record one message in the calling core's ring.
+ *
+ * Lock-free: a span is reserved by CAS on the free-running tail, the
+ * record is filled in, and the size field is stored last so the drain
+ * side never sees a partial record. Every future record start in a
+ * consumed span is zero - the drain side re-zeroes what it consumes
+ * before advancing head - which is what makes the size store a commit.
+ *
+ * @returns 1 if the message was queued (or deliberately dropped on a
+ *          full ring), 0 if the caller should fall back to synchronous
+ *          output.
+ */
+int klog_append(int severity, int raw, const char * text, size_t length) {
+	if (!klog_active || klog_panicked) return 0;
+	struct klog_ring * ring = &klog_rings[this_core->cpu_id];
+
+	size_t need = (sizeof(klog_record_t) + length + 7) & ~7UL;
+	uint64_t tail;
+	size_t pad;
+
+	while (1) {
+		tail = ring->tail;
+		size_t off = tail & (KLOG_RING_SIZE - 1);
+		/* Records never wrap; pad out the end of the ring if needed. */
+		pad = (off + need > KLOG_RING_SIZE) ? (KLOG_RING_SIZE - off) : 0;
+		if (tail + pad + need - ring->head > KLOG_RING_SIZE) {
+			/* Drain has fallen behind; drop rather than block. */
+			__sync_fetch_and_add(&ring->dropped, 1);
+			return 1;
+		}
+		if (__sync_bool_compare_and_swap(&ring->tail, tail, tail + pad + need)) break;
+	}
+
+	if (pad) {
+		*(volatile uint32_t *)(ring->data + (tail & (KLOG_RING_SIZE - 1))) = KLOG_PAD_MARKER;
+		tail += pad;
+	}
+
+	klog_record_t * rec = (klog_record_t *)(ring->data + (tail & (KLOG_RING_SIZE - 1)));
+	rec->length   = length;
+	rec->severity = severity;
+	rec->raw      = raw;
+	relative_time(0, 0, &rec->ticks, &rec->subticks);
+	memcpy(rec->text, text, length);
+	__sync_synchronize();
+	rec->size = need;
+
+	wakeup_queue(klog_wake);
+	if (severity <= KLOG_SYNC_LEVEL) klog_flush();
+	return 1;
+}
+
+/* Next committed record in a ring, or NULL; skips padding. */
+static klog_record_t * klog_ring_peek(struct klog_ring * ring) {
+	while (ring->head != ring->tail) {
+		size_t off = ring->head & (KLOG_RING_SIZE - 1);
+		uint32_t size = *(volatile uint32_t *)(ring->data + off);
+		if (size == KLOG_PAD_MARKER) {
+			size_t pad = KLOG_RING_SIZE - off;
+			memset(ring->data + off, 0, pad);
+			__sync_synchronize();
+			ring->head += pad;
+			continue;
+		}
+		if (size == 0) return NULL; /* Reserved but not yet committed. */
+		return (klog_record_t *)(ring->data + off);
+	}
+	return NULL;
+}
+
+/* Release a record's span; zeroed first so the span is commit-ready
+ * before writers can reserve it again. */
+static void klog_ring_consume(struct klog_ring * ring, klog_record_t * rec) {
+	size_t size = rec->size;
+	memset(rec, 0, size);
+	__sync_synchronize();
+	ring->head += size;
+}
+
+/* Render a record as it appears in the stream: a "<N>" severity tag,
+ * the usual timestamp prefix (unless the message opted out), and
+ * continuation lines padded to line up, as dprintf always printed. */
+static size_t klog_format(klog_record_t * rec, char * out, size_t avail) {
+	size_t w = snprintf(out, avail, "<%d>", rec->severity);
+	int left_width = 0;
+	if (!rec->raw) {
+		left_width = snprintf(out + w, avail - w, "[%5lu.%06lu] ", rec->ticks, rec->subticks);
+		w += left_width;
+	}
+	for (size_t i = 0; i < rec->length && w + left_width + 1 < avail; ++i) {
+		char c = rec->text[i];
+		out[w++] = c;
+		if (c == '\n' && i + 1 < rec->length) {
+			for (int j = 0; j < left_width; ++j) out[w++] = ' ';
+		}
+	}
+	return w;
+}
+
+/* Append rendered text to the retained /proc/klog ring. */
+static void klog_stream_append(const char * text, size_t length) {
+	size_t off = klog_stream_tail & (KLOG_STREAM_SIZE - 1);
+	size_t first = KLOG_STREAM_SIZE - off;
+	if (first > length) first = length;
+	memcpy(klog_stream + off, text, first);
+	if (length > first) memcpy(klog_stream, text + first, length - first);
+	klog_stream_tail += length;
+}
+
+static void klog_emit(size_t length, int severity) {
+	klog_stream_append(klog_fmt_buf, length);
+	if (severity <= klog_console_level) {
+		/* Skip the three-byte "<N>" tag for the console. */
+		console_write_direct(length - 3, (uint8_t *)klog_fmt_buf + 3);
+	}
+}
+
+/* Drain every ring, merging by record timestamp so interleaved logs
+ * from different cores come out in order. */
+static void klog_flush_locked(void) {
+	while (1) {
+		struct klog_ring * best = NULL;
+		klog_record_t * best_rec = NULL;
+		for (int i = 0; i < KLOG_MAX_CORES; ++i) {
+			struct klog_ring * ring = &klog_rings[i];
+			uint64_t dropped = ring->dropped;
+			if (dropped != ring->reported) {
+				size_t len = snprintf(klog_fmt_buf, sizeof(klog_fmt_buf),
+					"<4>klog: cpu %d dropped %lu messages\n", i, dropped - ring->reported);
+				ring->reported = dropped;
+				klog_emit(len, 4);
+			}
+			klog_record_t * rec = klog_ring_peek(ring);
+			if (!rec) continue;
+			if (!best_rec || rec->ticks < best_rec->ticks ||
+				(rec->ticks == best_rec->ticks && rec->subticks < best_rec->subticks)) {
+				best = ring;
+				best_rec = rec;
+			}
+		}
+		if (!best_rec) return;
+		size_t len = klog_format(best_rec, klog_fmt_buf, sizeof(klog_fmt_buf));
+		int severity = best_rec->severity;
+		klog_ring_consume(best, best_rec);
+		klog_emit(len, severity);
+	}
+}
+
+void klog_flush(void) {
+	if (klog_panicked) {
+		klog_flush_locked();
+		return;
+	}
+	spin_lock(klog_flush_lock);
+	klog_flush_locked();
+	spin_unlock(klog_flush_lock);
+}
+
+/**
+ * @brief Switch logging back to direct output for a fatal event.
+ *
+ * Called with all other cores stopped; drains what is queued without
+ * touching the flush lock, which a stopped core may have held, and
+ * makes every later dprintf synchronous so panic output always lands.
+ */
+void klog_panic(void) {
+	if (!klog_active) return;
+	klog_panicked = 1;
+	klog_flush_locked();
+}
+
+/**
+ * @brief Copy from the retained stream for /proc/klog.
+ *
+ * Offsets are absolute positions in the log since boot; a reader that
+ * keeps its offset and re-reads gets only new messages. Offsets that
+ * have aged out of the ring snap forward to the oldest retained byte.
+ */
+ssize_t klog_stream_copy(off_t offset, size_t size, uint8_t * buffer) {
+	if (!klog_active) return 0;
+	spin_lock(klog_flush_lock);
+	uint64_t end   = klog_stream_tail;
+	uint64_t start = end > KLOG_STREAM_SIZE ? end - KLOG_STREAM_SIZE : 0;
+	uint64_t from  = (uint64_t)offset;
+	if (from >= end) {
+		spin_unlock(klog_flush_lock);
+		return 0;
+	}
+	if (from < start) from = start;
+	if (size > end - from) size = end - from;
+
+	size_t off = from & (KLOG_STREAM_SIZE - 1);
+	size_t first = KLOG_STREAM_SIZE - off;
+	if (first > size) first = size;
+	memcpy(buffer, klog_stream + off, first);
+	if (size > first) memcpy(buffer + first, klog_stream, size - first);
+	spin_unlock(klog_flush_lock);
+	return size;
+}
+
+static void klog_drain(void * argp) {
+	while (1) {
+		sleep_on(klog_wake);
+		klog_flush();
+	}
+}
+
+void klog_initialize(void) {
+	/* All possible cores get a ring now; APs come up after us. */
+	for (int i = 0; i < KLOG_MAX_CORES; ++i) {
+		klog_rings[i].data = malloc(KLOG_RING_SIZE);
+		memset(klog_rings[i].data, 0, KLOG_RING_SIZE);
+		klog_rings[i].head = 0;
+		klog_rings[i].tail = 0;
+		klog_rings[i].dropped = 0;
+		klog_rings[i].reported = 0;
+	}
+	klog_stream = malloc(KLOG_STREAM_SIZE);
+	klog_stream_tail = 0;
+	spin_init(klog_flush_lock);
+	klog_wake = list_create("klog drain", NULL);
+
+	long level = args_value_int("klog", klog_console_level);
+	if (level >= 0 && level <= 7) klog_console_level = level;
+
+	spawn_worker_thread(klog_drain, "[klog]", NULL);
+	klog_active = 1;
+}
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdarg.h>
+#include <kernel/klog.h>
 
 size_t (*printf_output)(size_t, uint8_t *) = NULL;
 
@@ -364,6 +365,23 @@ static int cb_printf(void * user, char c) {
 int printf(const char * fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
+
+	/* When the output is the console, queue through the buffered log
+	 * so callers never wait on the device; a repointed printf_output
+	 * (see vbox_set_log) still gets written directly. */
+	if (klog_active && console_is_output(printf_output)) {
+		char buf[1024];
+		va_list args2;
+		va_copy(args2, args);
+		int len = vsnprintf(buf, sizeof(buf), fmt, args2);
+		va_end(args2);
+		if ((size_t)len > sizeof(buf) - 1) len = sizeof(buf) - 1;
+		if (klog_append(6, 1, buf, len)) {
+			va_end(args);
+			return len;
+		}
+	}
+
 	int out = xvasprintf(cb_printf, NULL, fmt, args);
 	va_end(args);
 	return out;
@@ -4,7 +4,9 @@
  *
  * Essentially some wrappers around a hashmap; allows different
  * boot methods to provide symbol tables for use with linking
- * kernel modules.
+ * kernel modules. Name lookups go through the hashmap; reverse
+ * (address-to-symbol) lookups, which backtraces do for every
+ * frame, go through a sorted address array with a binary search.
  *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
@@ -12,12 +14,22 @@
  * Copyright (C) 2021 K. Lange
  */
 #include <kernel/types.h>
+#include <kernel/string.h>
 #include <kernel/hashmap.h>
 #include <kernel/assert.h>
 #include <kernel/ksym.h>
 
 static hashmap_t * ksym_hash = NULL;
 
+struct ksym_sorted_entry {
+	uintptr_t addr;
+	const char * name;
+};
+
+static struct ksym_sorted_entry * ksym_sorted = NULL;
+static size_t ksym_sorted_count = 0;
+static int ksym_sorted_stale = 1;
+
 void ksym_install(void) {
 	assert(ksym_hash == NULL);
 	ksym_hash = hashmap_create(20);
@@ -27,6 +39,7 @@ void ksym_bind(const char * symname, void * value) {
 	assert(ksym_hash != NULL);
 
 	hashmap_set(ksym_hash, symname, value);
+	ksym_sorted_stale = 1;
 }
 
 void * ksym_lookup(const char * symname) {
@@ -41,3 +54,79 @@ list_t * ksym_list(void) {
 hashmap_t * ksym_get_map(void) {
 	return ksym_hash;
 }
+
+static void ksym_sort_entries(struct ksym_sorted_entry * entries, size_t count) {
+	/* Shell sort; runs once at boot over a few thousand entries. */
+	for (size_t gap = count / 2; gap > 0; gap /= 2) {
+		for (size_t i = gap; i < count; ++i) {
+			struct ksym_sorted_entry tmp = entries[i];
+			size_t j = i;
+			while (j >= gap && entries[j - gap].addr > tmp.addr) {
+				entries[j] = entries[j - gap];
+				j -= gap;
+			}
+			entries[j] = tmp;
+		}
+	}
+}
+
+/**
+ * @brief (Re)build the sorted address array.
+ *
+ * Called once after the boot symbol table is loaded; later binds mark
+ * the array stale and the next reverse lookup rebuilds it.
+ */
+void ksym_sort(void) {
+	if (!ksym_sorted_stale) return;
+
+	size_t count = 0;
+	for (size_t i = 0; i < ksym_hash->size; ++i) {
+		for (hashmap_entry_t * x = ksym_hash->entries[i]; x; x = x->next) count++;
+	}
+
+	if (ksym_sorted) free(ksym_sorted);
+	ksym_sorted = malloc(sizeof(struct ksym_sorted_entry) * count);
+
+	size_t filled = 0;
+	for (size_t i = 0; i < ksym_hash->size; ++i) {
+		for (hashmap_entry_t * x = ksym_hash->entries[i]; x; x = x->next) {
+			ksym_sorted[filled].addr = (uintptr_t)x->value;
+			ksym_sorted[filled].name = x->key;
+			filled++;
+		}
+	}
+
+	ksym_sort_entries(ksym_sorted, filled);
+	ksym_sorted_count = filled;
+	ksym_sorted_stale = 0;
+}
+
+/**
+ * @brief Find the closest symbol at or before an address.
+ *
+ * Binary search over the sorted address array. Only exported symbols
+ * are known, so addresses inside static functions resolve to the
+ * nearest preceding export.
+ *
+ * @param addr Address to look up.
+ * @param name (out) Name of the matching symbol.
+ * @return Address of the matching symbol, or 0 if none precedes @p addr.
+ */
+uintptr_t ksym_find_nearest(uintptr_t addr, const char ** name) {
+	if (ksym_sorted_stale) ksym_sort();
+	if (!ksym_sorted_count || addr < ksym_sorted[0].addr) return 0;
+
+	size_t lo = 0;
+	size_t hi = ksym_sorted_count - 1;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo + 1) / 2;
+		if (ksym_sorted[mid].addr <= addr) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	if (name) *name = ksym_sorted[lo].name;
+	return ksym_sorted[lo].addr;
+}
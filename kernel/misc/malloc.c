@@ -36,6 +36,7 @@
 #include <kernel/spinlock.h>
 #include <kernel/mmu.h>
 #include <kernel/misc.h>
+#include <kernel/process.h>
 /* }}} */
 /* Definitions {{{ */
 
@@ -81,49 +82,14 @@ static void __assert_fail(const char * f, int l, const char * stmt) {
  */
 static void * __attribute__ ((malloc)) klmalloc(uintptr_t size);
 static void * __attribute__ ((malloc)) klrealloc(void * ptr, uintptr_t size);
-static void * __attribute__ ((malloc)) klcalloc(uintptr_t nmemb, uintptr_t size);
 static void * __attribute__ ((malloc)) klvalloc(uintptr_t size);
 static void klfree(void * ptr);
 
 static spin_lock_t mem_lock =  { 0 };
 
-void * __attribute__ ((malloc)) malloc(uintptr_t size) {
-	spin_lock(mem_lock);
-	void * out = klmalloc(size);
-	spin_unlock(mem_lock);
-	return out;
-}
-
-void * __attribute__ ((malloc)) realloc(void * ptr, uintptr_t size) {
-	spin_lock(mem_lock);
-	void * out = klrealloc(ptr, size);
-	spin_unlock(mem_lock);
-	return out;
-}
-
-void * __attribute__ ((malloc)) calloc(uintptr_t nmemb, uintptr_t size) {
-	spin_lock(mem_lock);
-	void * out = klcalloc(nmemb, size);
-	spin_unlock(mem_lock);
-	return out;
-}
-
-void * __attribute__ ((malloc)) valloc(uintptr_t size) {
-	spin_lock(mem_lock);
-	void * out = klvalloc(size);
-	spin_unlock(mem_lock);
-	return out;
-}
-
-void free(void * ptr) {
-	spin_lock(mem_lock);
-	if (ptr < (void*)0xffffff0000000000) {
-		printf("Invalid free detected (%p)\n", ptr);
-		while (1) {};
-	}
-	klfree(ptr);
-	spin_unlock(mem_lock);
-}
+/* The public malloc/free wrappers live at the bottom of this file; they
+ * route small allocations through per-core arena caches and fall back to
+ * the klmalloc internals (under mem_lock) for everything else. */
 
 /* Bin management {{{ */
 
@@ -844,7 +810,7 @@ static void * __attribute__ ((malloc)) klrealloc(void *ptr, uintptr_t size) {
 	 */
 	if (__builtin_expect(size == 0, 0))
 	{
-		free(ptr);
+		klfree(ptr);
 		return NULL;
 	}
 
@@ -907,22 +873,163 @@ static void * __attribute__ ((malloc)) klrealloc(void *ptr, uintptr_t size) {
 	return NULL;
 }
 /* }}} */
-/* calloc() {{{ */
-static void * __attribute__ ((malloc)) klcalloc(uintptr_t nmemb, uintptr_t size) {
-	/*
-	 * Allocate memory and zero it before returning
-	 * a pointer to the newly allocated memory.
-	 * 
-	 * Implemented by way of a simple malloc followed
-	 * by a memset to 0x00 across the length of the
-	 * requested memory chunk.
-	 */
+/* Per-core arenas {{{ */
 
-	void *ptr = klmalloc(nmemb * size);
-	if (__builtin_expect(ptr != NULL, 1))
-		memset(ptr,0x00,nmemb * size);
-	return ptr;
+/*
+ * Front-end caches for the small bins, one arena per core. Small
+ * allocations pop straight off the local arena without touching
+ * mem_lock; the arena refills from (and flushes back to) the klmalloc
+ * bins in half-batches. Big-bin allocations and everything that walks
+ * bin headers still serializes on mem_lock as before.
+ *
+ * An arena's lock only ever contends with another core that migrated
+ * between reading its cpu_id and taking the lock, or with procfs
+ * reading the statistics; the mem_lock hold times are what this is
+ * actually about. Lock order is arena->lock, then mem_lock.
+ */
+#define ARENA_CACHE_SIZE 32
+
+struct arena_bin_cache {
+	int count;
+	void * items[ARENA_CACHE_SIZE];
+};
+
+struct heap_arena {
+	spin_lock_t lock;
+	struct arena_bin_cache bins[BIG_BIN];
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t refills;
+	uint64_t flushes;
+};
+
+static struct heap_arena heap_arenas[32];
+
+static void * arena_alloc(unsigned int bucket_id) {
+	struct heap_arena * arena = &heap_arenas[this_core->cpu_id];
+	spin_lock(arena->lock);
+	struct arena_bin_cache * cache = &arena->bins[bucket_id];
+	if (cache->count == 0) {
+		/*
+		 * Empty cache; pull half a batch out of the shared bins.
+		 * These are all full bin entries, so ask for the full
+		 * size of the bucket to land back in the same bin.
+		 */
+		spin_lock(mem_lock);
+		for (int i = 0; i < ARENA_CACHE_SIZE / 2; ++i) {
+			void * obj = klmalloc(1UL << (SMALLEST_BIN_LOG + bucket_id));
+			if (!obj) break;
+			cache->items[cache->count++] = obj;
+		}
+		spin_unlock(mem_lock);
+		arena->refills++;
+		if (cache->count == 0) {
+			spin_unlock(arena->lock);
+			return NULL;
+		}
+	}
+	void * out = cache->items[--cache->count];
+	arena->allocs++;
+	spin_unlock(arena->lock);
+	return out;
 }
-/* }}} */
+
+static void arena_free(unsigned int bucket_id, void * ptr) {
+	struct heap_arena * arena = &heap_arenas[this_core->cpu_id];
+	spin_lock(arena->lock);
+	struct arena_bin_cache * cache = &arena->bins[bucket_id];
+	if (cache->count == ARENA_CACHE_SIZE) {
+		/*
+		 * Full cache; return half a batch to the shared bins so
+		 * the space can service other cores (or bigger requests).
+		 */
+		spin_lock(mem_lock);
+		while (cache->count > ARENA_CACHE_SIZE / 2) {
+			klfree(cache->items[--cache->count]);
+		}
+		spin_unlock(mem_lock);
+		arena->flushes++;
+	}
+	cache->items[cache->count++] = ptr;
+	arena->frees++;
+	spin_unlock(arena->lock);
+}
+
+/**
+ * @brief Read out one core's arena counters, for procfs.
+ *
+ * @p stats receives allocs, frees, refills, flushes in that order.
+ */
+void heap_arena_stats(int core, uint64_t * stats) {
+	struct heap_arena * arena = &heap_arenas[core];
+	spin_lock(arena->lock);
+	stats[0] = arena->allocs;
+	stats[1] = arena->frees;
+	stats[2] = arena->refills;
+	stats[3] = arena->flushes;
+	spin_unlock(arena->lock);
+}
+
+/* }}} Per-core arenas */
+/* Public interface {{{ */
+
+void * __attribute__ ((malloc)) malloc(uintptr_t size) {
+	if (__builtin_expect(size > 0, 1)) {
+		unsigned int bucket_id = klmalloc_bin_size(size);
+		if (bucket_id < BIG_BIN) {
+			return arena_alloc(bucket_id);
+		}
+	}
+	spin_lock(mem_lock);
+	void * out = klmalloc(size);
+	spin_unlock(mem_lock);
+	return out;
+}
+
+void * __attribute__ ((malloc)) realloc(void * ptr, uintptr_t size) {
+	spin_lock(mem_lock);
+	void * out = klrealloc(ptr, size);
+	spin_unlock(mem_lock);
+	return out;
+}
+
+void * __attribute__ ((malloc)) calloc(uintptr_t nmemb, uintptr_t size) {
+	void * out = malloc(nmemb * size);
+	if (__builtin_expect(out != NULL, 1))
+		memset(out, 0x00, nmemb * size);
+	return out;
+}
+
+void * __attribute__ ((malloc)) valloc(uintptr_t size) {
+	spin_lock(mem_lock);
+	void * out = klvalloc(size);
+	spin_unlock(mem_lock);
+	return out;
+}
+
+void free(void * ptr) {
+	if (ptr < (void*)0xffffff0000000000) {
+		printf("Invalid free detected (%p)\n", ptr);
+		while (1) {};
+	}
+	if ((uintptr_t)ptr & PAGE_MASK) {
+		/*
+		 * Small bin cells can go back to the local arena; the bin
+		 * index in the page header is set once when the page joins
+		 * a bin and never changes, so it is safe to read unlocked.
+		 * Page-aligned pointers (valloc results) go the long way.
+		 */
+		klmalloc_bin_header * header = (klmalloc_bin_header *)((uintptr_t)ptr & (uintptr_t)~PAGE_MASK);
+		if (header->bin_magic == BIN_MAGIC && header->size < BIG_BIN) {
+			arena_free(header->size, ptr);
+			return;
+		}
+	}
+	spin_lock(mem_lock);
+	klfree(ptr);
+	spin_unlock(mem_lock);
+}
+
+/* }}} Public interface */
 
 
@@ -6,11 +6,17 @@
  * (CPU port I/O methods), including scanning and modifying device
  * configuration bytes.
  *
+ * The bus is walked over port I/O exactly once, on first use; the
+ * result is cached in a device table with vendor/device/class codes,
+ * BAR values, and parsed capability offsets (MSI, MSI-X, PCIe).
+ * pci_scan() iterates that table, so every driver module probing for
+ * its hardware no longer triggers its own full configuration-space
+ * walk, and MSI setup can find its capability without one either.
+ * Individual field reads and writes still go to the hardware.
+ *
  * This used to have methods for dealing with ISA bridge IRQ remapping,
  * but it has been removed for the moment.
  *
- * TODO: Implement MSI configuration?
- *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
@@ -18,6 +24,8 @@
  */
 #include <stdint.h>
 #include <kernel/string.h>
+#include <kernel/list.h>
+#include <kernel/spinlock.h>
 #include <kernel/pci.h>
 #include <kernel/printf.h>
 
@@ -100,13 +108,9 @@ void pci_scan_bus(pci_func_t f, int type, int bus, void * extra) {
 }
 
 /**
- * @brief Scan PCI buses for devices, calling the given function for each device.
- *
- * Used by drivers to implement device discovery, runs a callback function for ever
- * device found. A device consists of a bus, slot, and function. Also performs
- * recursive scans of bridges.
+ * @brief Walk every bus over port I/O; used once to build the table.
  */
-void pci_scan(pci_func_t f, int type, void * extra) {
+static void pci_scan_raw(pci_func_t f, int type, void * extra) {
 	if ((pci_read_field(0, PCI_HEADER_TYPE, 1) & 0x80) == 0) {
 		pci_scan_bus(f,type,0,extra);
 		return;
@@ -132,6 +136,151 @@ void pci_scan(pci_func_t f, int type, void * extra) {
 	}
 }
 
+static list_t * pci_device_list = NULL;
+static spin_lock_t pci_enumerate_lock = { 0 };
+
+/* Cache one discovered function, including its capability offsets. */
+static void pci_enumerate_hit(uint32_t address, uint16_t vendor_id, uint16_t device_id, void * extra) {
+	list_t * devices = extra;
+	struct pci_device * dev = malloc(sizeof(struct pci_device));
+	memset(dev, 0, sizeof(struct pci_device));
+
+	dev->address   = address;
+	dev->vendor_id = vendor_id;
+	dev->device_id = device_id;
+	dev->type      = pci_find_type(address);
+	dev->bus       = pci_extract_bus(address);
+	dev->slot      = pci_extract_slot(address);
+	dev->func      = pci_extract_func(address);
+
+	for (int bar = 0; bar < 6; ++bar) {
+		dev->bars[bar] = pci_read_field(address, PCI_BAR0 + 4 * bar, 4);
+	}
+
+	/* Walk the capability list, if the status register says there is one. */
+	if (pci_read_field(address, PCI_STATUS, 2) & 0x10) {
+		uint8_t offset = pci_read_field(address, PCI_CAPABILITY_POINTER, 1) & 0xFC;
+		int guard = 48;
+		while (offset && guard--) {
+			uint8_t id = pci_read_field(address, offset, 1);
+			switch (id) {
+				case PCI_CAP_MSI:  dev->cap_msi  = offset; break;
+				case PCI_CAP_PCIE: dev->cap_pcie = offset; break;
+				case PCI_CAP_MSIX: dev->cap_msix = offset; break;
+			}
+			offset = pci_read_field(address, offset + 1, 1) & 0xFC;
+		}
+	}
+
+	list_insert(devices, dev);
+}
+
+static void pci_enumerate(void) {
+	spin_lock(pci_enumerate_lock);
+	if (!pci_device_list) {
+		/* Build into a local so a racing reader never sees a partial table. */
+		list_t * devices = list_create("pci devices", NULL);
+		pci_scan_raw(pci_enumerate_hit, -1, devices);
+		__sync_synchronize();
+		pci_device_list = devices;
+	}
+	spin_unlock(pci_enumerate_lock);
+}
+
+/**
+ * @brief The enumerated device table, building it on first use.
+ */
+list_t * pci_devices(void) {
+	if (!pci_device_list) pci_enumerate();
+	return pci_device_list;
+}
+
+/**
+ * @brief Scan PCI buses for devices, calling the given function for each device.
+ *
+ * Used by drivers to implement device discovery, runs a callback function for every
+ * device found. A device consists of a bus, slot, and function. Iterates the
+ * device table built on first use - bridges were walked recursively when it
+ * was built - so repeated probes cost no configuration-space I/O.
+ */
+void pci_scan(pci_func_t f, int type, void * extra) {
+	foreach(node, pci_devices()) {
+		struct pci_device * dev = node->value;
+		if (type == -1 || type == dev->type) {
+			f(dev->address, dev->vendor_id, dev->device_id, extra);
+		}
+	}
+}
+
+/**
+ * @brief Look up a cached device by configuration address.
+ */
+struct pci_device * pci_device_by_addr(uint32_t device) {
+	foreach(node, pci_devices()) {
+		struct pci_device * dev = node->value;
+		if (dev->address == device) return dev;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Find the first cached device matching a vendor/device pair.
+ */
+struct pci_device * pci_device_find(uint16_t vendor_id, uint16_t device_id) {
+	foreach(node, pci_devices()) {
+		struct pci_device * dev = node->value;
+		if (dev->vendor_id == vendor_id && dev->device_id == device_id) return dev;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Offset of a standard capability, from the cached index.
+ *
+ * @return Configuration-space offset of the capability, or 0 if the
+ *         device does not advertise it.
+ */
+uint8_t pci_get_capability(uint32_t device, uint8_t cap) {
+	struct pci_device * dev = pci_device_by_addr(device);
+	if (!dev) return 0;
+	switch (cap) {
+		case PCI_CAP_MSI:  return dev->cap_msi;
+		case PCI_CAP_PCIE: return dev->cap_pcie;
+		case PCI_CAP_MSIX: return dev->cap_msix;
+	}
+	return 0;
+}
+
+/**
+ * @brief Point a device's MSI capability at an interrupt vector.
+ *
+ * Programs a single message to the boot-state local APIC at the given
+ * IDT vector and sets the enable bit; the caller owns the vector and
+ * its IDT entry. Uses the capability offset cached at enumeration, so
+ * no configuration-space walk happens here.
+ *
+ * @return 0 on success, 1 if the device has no MSI capability.
+ */
+int pci_enable_msi(uint32_t device, uint8_t vector) {
+	uint8_t offset = pci_get_capability(device, PCI_CAP_MSI);
+	if (!offset) return 1;
+
+	uint16_t control = pci_read_field(device, offset + 2, 2);
+	pci_write_field(device, offset + 4, 4, 0xFEE00000);
+	if (control & (1 << 7)) {
+		/* 64-bit address capable: clear the upper half, data goes later. */
+		pci_write_field(device, offset + 8, 4, 0);
+		pci_write_field(device, offset + 12, 2, vector);
+	} else {
+		pci_write_field(device, offset + 8, 2, vector);
+	}
+
+	/* Single message, enabled. */
+	control = (control & ~0x70) | 1;
+	pci_write_field(device, offset + 2, 2, control);
+	return 0;
+}
+
 int pci_get_interrupt(uint32_t device) {
 	return pci_read_field(device, PCI_INTERRUPT_LINE, 1);
 }
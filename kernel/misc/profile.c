@@ -0,0 +1,142 @@
+/**
+ * @file  kernel/misc/profile.c
+ * @brief Timer-driven sampling profiler.
+ *
+ * When enabled, every Nth timer interrupt on each core records the
+ * interrupted instruction pointer, the running pid, and whether the
+ * hit landed in kernel or user code into a per-core ring. Each ring
+ * has one writer (its core's timer interrupt) and is drained by reads
+ * of /proc/profile, which also accepts start/stop/divisor ioctls; the
+ * userspace `prof` tool wraps the whole exchange and resolves kernel
+ * addresses against /proc/kallsyms.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/process.h>
+#include <kernel/vfs.h>
+#include <kernel/profile.h>
+
+#include <sys/profile.h>
+
+#define PROFILE_RING_SAMPLES 4096 /* Per core; 64KiB of samples. */
+#define PROFILE_MAX_CORES 32
+
+struct profile_ring {
+	struct profile_sample * samples;
+	volatile size_t head; /* Next sample to drain */
+	volatile size_t tail; /* Next sample to write */
+	uint64_t dropped;     /* Samples lost to a full ring */
+	int countdown;        /* Ticks until the next sample */
+};
+
+static struct profile_ring profile_rings[PROFILE_MAX_CORES];
+volatile int profile_active = 0;
+static int profile_divisor = 1;
+static spin_lock_t profile_lock = { 0 };
+
+/**
+ * @brief Record one sample for the current core.
+ *
+ * Called from the timer interrupt handlers with interrupts off; the
+ * only other party touching this ring is a reader advancing head, so
+ * no lock is needed here.
+ */
+void profile_tick(uintptr_t rip, int is_kernel) {
+	if (!profile_active) return;
+	struct profile_ring * ring = &profile_rings[this_core->cpu_id];
+	if (!ring->samples) return;
+
+	if (++ring->countdown < profile_divisor) return;
+	ring->countdown = 0;
+
+	if (ring->tail - ring->head == PROFILE_RING_SAMPLES) {
+		ring->dropped++;
+		return;
+	}
+
+	struct profile_sample * s = &ring->samples[ring->tail % PROFILE_RING_SAMPLES];
+	s->rip   = rip;
+	s->pid   = this_core->current_process ? (int32_t)this_core->current_process->id : 0;
+	s->flags = is_kernel ? PROFILE_FLAG_KERNEL : 0;
+	__sync_synchronize();
+	ring->tail = ring->tail + 1;
+}
+
+/**
+ * @brief Drain collected samples into a user buffer.
+ *
+ * Returns whole samples only, round-robining across the per-core
+ * rings; 0 when everything has been drained. Offsets are ignored -
+ * this is a stream, not a file.
+ */
+ssize_t profile_read(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	size_t want = size / sizeof(struct profile_sample);
+	size_t out = 0;
+
+	spin_lock(profile_lock);
+	while (out < want) {
+		int progress = 0;
+		for (int core = 0; core < PROFILE_MAX_CORES && out < want; ++core) {
+			struct profile_ring * ring = &profile_rings[core];
+			if (!ring->samples || ring->head == ring->tail) continue;
+			memcpy(buffer + out * sizeof(struct profile_sample),
+			       &ring->samples[ring->head % PROFILE_RING_SAMPLES],
+			       sizeof(struct profile_sample));
+			ring->head = ring->head + 1;
+			out++;
+			progress = 1;
+		}
+		if (!progress) break;
+	}
+	spin_unlock(profile_lock);
+
+	return out * sizeof(struct profile_sample);
+}
+
+/**
+ * @brief Control sampling; root only.
+ */
+int profile_ioctl(fs_node_t * node, unsigned long request, void * argp) {
+	if (this_core->current_process->user != USER_ROOT_UID) return -EPERM;
+
+	switch (request) {
+		case PROFILE_IOCTL_START:
+			spin_lock(profile_lock);
+			for (int core = 0; core < PROFILE_MAX_CORES; ++core) {
+				struct profile_ring * ring = &profile_rings[core];
+				if (!ring->samples) {
+					ring->samples = malloc(sizeof(struct profile_sample) * PROFILE_RING_SAMPLES);
+				}
+				ring->head = 0;
+				ring->tail = 0;
+				ring->dropped = 0;
+				ring->countdown = 0;
+			}
+			__sync_synchronize();
+			profile_active = 1;
+			spin_unlock(profile_lock);
+			return 0;
+
+		case PROFILE_IOCTL_STOP:
+			profile_active = 0;
+			return 0;
+
+		case PROFILE_IOCTL_DIVISOR: {
+			int divisor = *(int*)argp;
+			if (divisor < 1) return -EINVAL;
+			profile_divisor = divisor;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
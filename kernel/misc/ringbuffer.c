@@ -5,6 +5,25 @@
  * Provides a buffer interface for devices such as at PTYs with
  * blocking reads and writes.
  *
+ * Readers and writers take separate locks, and data moves in bulk
+ * copies with one index update per call rather than per byte, so a
+ * producer and a consumer streaming through a buffer never contend
+ * with each other - only with other ends of their own kind. When the
+ * creator can guarantee a single reader and a single writer (see
+ * @ref ring_buffer_set_spsc) the side locks are skipped entirely and
+ * the steady-state paths are lock-free; locks then only appear in the
+ * block/wakeup handshake, which is edge-triggered and so absent from
+ * streaming workloads.
+ *
+ * The handshake works because @ref sleep_on_unlocking queues a sleeper
+ * before releasing the lock it was given: a side that published data
+ * (or space) briefly acquires and releases the other side's lock
+ * before issuing its wakeup, which orders the wakeup after any
+ * in-progress decision to sleep. A writer may handshake the reader
+ * lock while holding the write lock - that is also the order the
+ * buffer grow path takes both locks in - but a reader must drop its
+ * own lock before handshaking the writer side.
+ *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
@@ -21,6 +40,12 @@
 #include <kernel/printf.h>
 #include <kernel/mmu.h>
 
+uint64_t ring_buffer_total_read = 0;
+uint64_t ring_buffer_total_written = 0;
+uint64_t ring_buffer_total_grows = 0;
+uint64_t ring_buffer_total_wakeups = 0;
+uint64_t ring_buffer_total_wakeups_deferred = 0;
+
 size_t ring_buffer_unread(ring_buffer_t * ring_buffer) {
 	if (ring_buffer->read_ptr == ring_buffer->write_ptr) {
 		return 0;
@@ -49,94 +74,216 @@ size_t ring_buffer_available(ring_buffer_t * ring_buffer) {
 	}
 }
 
-static inline void ring_buffer_increment_read(ring_buffer_t * ring_buffer) {
-	ring_buffer->read_ptr++;
-	if (ring_buffer->read_ptr == ring_buffer->size) {
-		ring_buffer->read_ptr = 0;
+/* Copy up to @p size unread bytes out in at most two segments, then
+ * publish the new read_ptr with a single store. The barrier orders the
+ * copies before the index update so the other side never sees an index
+ * covering bytes still in flight. */
+static size_t ring_buffer_copy_out(ring_buffer_t * ring_buffer, uint8_t * buffer, size_t size) {
+	size_t avail = ring_buffer_unread(ring_buffer);
+	if (size > avail) size = avail;
+	if (!size) return 0;
+
+	size_t read_ptr = ring_buffer->read_ptr;
+	size_t first = ring_buffer->size - read_ptr;
+	if (first > size) first = size;
+	memcpy(buffer, ring_buffer->buffer + read_ptr, first);
+	if (size > first) {
+		memcpy(buffer + first, ring_buffer->buffer, size - first);
 	}
+
+	__sync_synchronize();
+	ring_buffer->read_ptr = (read_ptr + size) % ring_buffer->size;
+	return size;
 }
 
-static inline void ring_buffer_increment_write(ring_buffer_t * ring_buffer) {
-	ring_buffer->write_ptr++;
-	if (ring_buffer->write_ptr == ring_buffer->size) {
-		ring_buffer->write_ptr = 0;
+/* The write-side counterpart: copy in what fits, publish write_ptr. */
+static size_t ring_buffer_copy_in(ring_buffer_t * ring_buffer, const uint8_t * buffer, size_t size) {
+	size_t space = ring_buffer_available(ring_buffer);
+	if (size > space) size = space;
+	if (!size) return 0;
+
+	size_t write_ptr = ring_buffer->write_ptr;
+	size_t first = ring_buffer->size - write_ptr;
+	if (first > size) first = size;
+	memcpy(ring_buffer->buffer + write_ptr, buffer, first);
+	if (size > first) {
+		memcpy(ring_buffer->buffer, buffer + first, size - first);
 	}
+
+	__sync_synchronize();
+	ring_buffer->write_ptr = (write_ptr + size) % ring_buffer->size;
+	return size;
 }
 
 void ring_buffer_alert_waiters(ring_buffer_t * ring_buffer) {
-	if (ring_buffer->alert_waiters) {
-		while (ring_buffer->alert_waiters->head) {
-			node_t * node = list_dequeue(ring_buffer->alert_waiters);
-			process_t * p = node->value;
-			process_alert_node(p, ring_buffer);
-			free(node);
-		}
-	}
+	fswait_queue_alert(&ring_buffer->alert, ring_buffer);
 }
 
 void ring_buffer_select_wait(ring_buffer_t * ring_buffer, void * process) {
-	if (!ring_buffer->alert_waiters) {
-		ring_buffer->alert_waiters = list_create("ringbuffer alerts", ring_buffer);
-	}
+	fswait_queue_wait(&ring_buffer->alert, process, ring_buffer);
+}
 
-	if (!list_find(ring_buffer->alert_waiters, process)) {
-		list_insert(ring_buffer->alert_waiters, process);
-	}
-	list_insert(((process_t *)process)->node_waits, ring_buffer);
+/* Wake the other side after publishing, with the handshake described
+ * in the header comment. */
+static void ring_buffer_notify_readers(ring_buffer_t * ring_buffer) {
+	spin_lock(ring_buffer->rlock);
+	spin_unlock(ring_buffer->rlock);
+	wakeup_queue(ring_buffer->wait_queue_readers);
+	ring_buffer_alert_waiters(ring_buffer);
+	ring_buffer_total_wakeups++;
+}
+
+static void ring_buffer_notify_writers(ring_buffer_t * ring_buffer) {
+	spin_lock(ring_buffer->wlock);
+	spin_unlock(ring_buffer->wlock);
+	wakeup_queue(ring_buffer->wait_queue_writers);
+	ring_buffer_total_wakeups++;
 }
 
 size_t ring_buffer_read(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer) {
 	size_t collected = 0;
 	while (collected == 0) {
-		spin_lock(ring_buffer->lock);
-		while (ring_buffer_unread(ring_buffer) > 0 && collected < size) {
-			buffer[collected] = ring_buffer->buffer[ring_buffer->read_ptr];
-			ring_buffer_increment_read(ring_buffer);
-			collected++;
-		}
-		wakeup_queue(ring_buffer->wait_queue_writers);
-		if (collected == 0) {
-			if (sleep_on_unlocking(ring_buffer->wait_queue_readers, &ring_buffer->lock) && ring_buffer->internal_stop) {
+		if (!ring_buffer->spsc) spin_lock(ring_buffer->rlock);
+		int was_full = (ring_buffer_available(ring_buffer) == 0);
+		collected = ring_buffer_copy_out(ring_buffer, buffer, size);
+		if (collected) {
+			if (!ring_buffer->spsc) spin_unlock(ring_buffer->rlock);
+			/* Writers only sleep on a full buffer, so they only need a
+			 * wakeup when this read made space in one. */
+			if (was_full) {
+				ring_buffer_notify_writers(ring_buffer);
+			} else {
+				ring_buffer_total_wakeups_deferred++;
+			}
+		} else {
+			/* Take the lock to sleep even in SPSC mode; the handshake
+			 * in the notify path depends on it. */
+			if (ring_buffer->spsc) spin_lock(ring_buffer->rlock);
+			if (ring_buffer_unread(ring_buffer)) {
+				/* A write landed between the copy and the lock. */
+				spin_unlock(ring_buffer->rlock);
+				continue;
+			}
+			if (sleep_on_unlocking(ring_buffer->wait_queue_readers, &ring_buffer->rlock) && ring_buffer->internal_stop) {
 				ring_buffer->internal_stop = 0;
 				break;
 			}
+		}
+	}
+	ring_buffer_total_read += collected;
+	return collected;
+}
+
+/**
+ * @brief Read whatever is immediately available without blocking.
+ */
+size_t ring_buffer_try_read(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer) {
+	if (!ring_buffer->spsc) spin_lock(ring_buffer->rlock);
+	int was_full = (ring_buffer_available(ring_buffer) == 0);
+	size_t collected = ring_buffer_copy_out(ring_buffer, buffer, size);
+	if (!ring_buffer->spsc) spin_unlock(ring_buffer->rlock);
+	if (collected) {
+		if (was_full) {
+			ring_buffer_notify_writers(ring_buffer);
 		} else {
-			spin_unlock(ring_buffer->lock);
+			ring_buffer_total_wakeups_deferred++;
 		}
 	}
-	wakeup_queue(ring_buffer->wait_queue_writers);
+	ring_buffer_total_read += collected;
 	return collected;
 }
 
+/* Replace the buffer with one twice the size (capped at max_size),
+ * linearizing the unread data into it. Called with the write lock held;
+ * takes the read lock for the swap so no reader is mid-copy. */
+static void ring_buffer_grow(ring_buffer_t * ring_buffer) {
+	size_t new_size = ring_buffer->size * 2;
+	if (new_size > ring_buffer->max_size) new_size = ring_buffer->max_size;
+
+	unsigned char * new_buffer = malloc(new_size);
+	size_t unread = ring_buffer_unread(ring_buffer);
+	for (size_t i = 0; i < unread; ++i) {
+		new_buffer[i] = ring_buffer->buffer[(ring_buffer->read_ptr + i) % ring_buffer->size];
+	}
+
+	if (ring_buffer->frame_backed) {
+		mmu_frame_clear((uintptr_t)ring_buffer->buffer & 0xFFFFFFFFF);
+		ring_buffer->frame_backed = 0;
+	} else {
+		free(ring_buffer->buffer);
+	}
+
+	ring_buffer->buffer = new_buffer;
+	ring_buffer->size = new_size;
+	ring_buffer->read_ptr = 0;
+	ring_buffer->write_ptr = unread;
+	ring_buffer_total_grows++;
+}
+
 size_t ring_buffer_write(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer) {
 	size_t written = 0;
 	while (written < size) {
-		spin_lock(ring_buffer->lock);
+		if (!ring_buffer->spsc) spin_lock(ring_buffer->wlock);
 
-		while (ring_buffer_available(ring_buffer) > 0 && written < size) {
-			ring_buffer->buffer[ring_buffer->write_ptr] = buffer[written];
-			ring_buffer_increment_write(ring_buffer);
-			written++;
+		int was_empty = (ring_buffer_unread(ring_buffer) == 0);
+		size_t chunk = ring_buffer_copy_in(ring_buffer, buffer + written, size - written);
+		written += chunk;
+
+		/* Readers only sleep on an empty buffer, so they only need a
+		 * wakeup when this write made one non-empty; a streaming
+		 * producer ahead of its consumer skips the wakeup entirely. */
+		if (chunk && was_empty) {
+			ring_buffer_notify_readers(ring_buffer);
+		} else if (chunk) {
+			ring_buffer_total_wakeups_deferred++;
 		}
 
-		wakeup_queue(ring_buffer->wait_queue_readers);
-		ring_buffer_alert_waiters(ring_buffer);
 		if (written < size) {
 			if (ring_buffer->discard) {
-				spin_unlock(ring_buffer->lock);
+				if (!ring_buffer->spsc) spin_unlock(ring_buffer->wlock);
 				break;
 			}
-			if (sleep_on_unlocking(ring_buffer->wait_queue_writers, &ring_buffer->lock) && ring_buffer->internal_stop) {
+			if (!ring_buffer->spsc && ring_buffer->size < ring_buffer->max_size) {
+				/* Grow rather than block. */
+				spin_lock(ring_buffer->rlock);
+				ring_buffer_grow(ring_buffer);
+				spin_unlock(ring_buffer->rlock);
+				spin_unlock(ring_buffer->wlock);
+				continue;
+			}
+			if (ring_buffer->spsc) spin_lock(ring_buffer->wlock);
+			if (ring_buffer_available(ring_buffer)) {
+				/* A read made space between the copy and the lock. */
+				spin_unlock(ring_buffer->wlock);
+				continue;
+			}
+			if (sleep_on_unlocking(ring_buffer->wait_queue_writers, &ring_buffer->wlock) && ring_buffer->internal_stop) {
 				ring_buffer->internal_stop = 0;
 				break;
 			}
 		} else {
-			spin_unlock(ring_buffer->lock);
+			if (!ring_buffer->spsc) spin_unlock(ring_buffer->wlock);
 		}
 	}
 
-	wakeup_queue(ring_buffer->wait_queue_readers);
-	ring_buffer_alert_waiters(ring_buffer);
+	ring_buffer_total_written += written;
+	return written;
+}
+
+/**
+ * @brief Write whatever fits immediately without blocking or growing.
+ */
+size_t ring_buffer_try_write(ring_buffer_t * ring_buffer, size_t size, uint8_t * buffer) {
+	if (!ring_buffer->spsc) spin_lock(ring_buffer->wlock);
+	int was_empty = (ring_buffer_unread(ring_buffer) == 0);
+	size_t written = ring_buffer_copy_in(ring_buffer, buffer, size);
+	if (written && was_empty) {
+		ring_buffer_notify_readers(ring_buffer);
+	} else if (written) {
+		ring_buffer_total_wakeups_deferred++;
+	}
+	if (!ring_buffer->spsc) spin_unlock(ring_buffer->wlock);
+	ring_buffer_total_written += written;
 	return written;
 }
 
@@ -145,15 +292,20 @@ ring_buffer_t * ring_buffer_create(size_t size) {
 
 	if (size == 4096) {
 		out->buffer = mmu_map_from_physical(mmu_allocate_a_frame() << 12);
+		out->frame_backed = 1;
 	} else {
 		out->buffer     = malloc(size);
+		out->frame_backed = 0;
 	}
 	out->write_ptr  = 0;
 	out->read_ptr   = 0;
 	out->size       = size;
-	out->alert_waiters = NULL;
+	out->max_size   = size; /* Fixed size unless a caller raises it. */
+	fswait_queue_init(&out->alert, "ringbuffer alerts", out);
 
-	spin_init(out->lock);
+	spin_init(out->rlock);
+	spin_init(out->wlock);
+	out->spsc = 0;
 
 	out->internal_stop = 0;
 	out->discard = 0;
@@ -164,8 +316,28 @@ ring_buffer_t * ring_buffer_create(size_t size) {
 	return out;
 }
 
+/**
+ * @brief Declare that this buffer has one producer and one consumer.
+ *
+ * The caller promises at most one thread ever reads and at most one
+ * ever writes at a time; the steady-state read and write paths then
+ * skip the side locks entirely. An SPSC buffer keeps its fixed size -
+ * the grow path needs to exclude both ends.
+ */
+void ring_buffer_set_spsc(ring_buffer_t * ring_buffer) {
+	ring_buffer->spsc = 1;
+}
+
+/**
+ * @brief Allow a ring buffer to grow up to @p max_size on write.
+ */
+void ring_buffer_set_max(ring_buffer_t * ring_buffer, size_t max_size) {
+	if (max_size < ring_buffer->size) max_size = ring_buffer->size;
+	ring_buffer->max_size = max_size;
+}
+
 void ring_buffer_destroy(ring_buffer_t * ring_buffer) {
-	if (ring_buffer->size == 4096) {
+	if (ring_buffer->frame_backed) {
 		mmu_frame_clear((uintptr_t)ring_buffer->buffer & 0xFFFFFFFFF);
 	} else {
 		free(ring_buffer->buffer);
@@ -173,18 +345,13 @@ void ring_buffer_destroy(ring_buffer_t * ring_buffer) {
 
 	wakeup_queue(ring_buffer->wait_queue_writers);
 	wakeup_queue(ring_buffer->wait_queue_readers);
-	ring_buffer_alert_waiters(ring_buffer);
+	fswait_queue_destroy(&ring_buffer->alert, ring_buffer);
 
 	list_free(ring_buffer->wait_queue_writers);
 	list_free(ring_buffer->wait_queue_readers);
 
 	free(ring_buffer->wait_queue_writers);
 	free(ring_buffer->wait_queue_readers);
-
-	if (ring_buffer->alert_waiters) {
-		list_free(ring_buffer->alert_waiters);
-		free(ring_buffer->alert_waiters);
-	}
 }
 
 void ring_buffer_interrupt(ring_buffer_t * ring_buffer) {
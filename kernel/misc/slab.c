@@ -0,0 +1,113 @@
+/**
+ * @file  kernel/misc/slab.c
+ * @brief Fixed-size object caches with per-core magazines.
+ *
+ * The general-purpose heap allocator serializes every allocation on a
+ * single lock, which makes hot fixed-size objects - process structs,
+ * packet buffers - a point of cross-core contention under fork or
+ * network load. A slab cache hands those objects out of a per-core
+ * magazine instead, so the common alloc/free pair never touches a
+ * shared lock; magazines are refilled from (and flushed to) a shared
+ * depot in batches, and the depot grows by carving multi-object chunks
+ * out of the regular heap. Objects are never returned to the heap, so
+ * a cache's footprint is its high-water mark.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/process.h>
+#include <kernel/slab.h>
+
+#define SLAB_MAGAZINE_SIZE 32 /* Objects kept per core. */
+#define SLAB_CHUNK_OBJECTS 64 /* Objects added to the depot per heap allocation. */
+
+struct slab_magazine {
+	spin_lock_t lock;
+	int count;
+	void * objects[SLAB_MAGAZINE_SIZE];
+};
+
+struct slab_cache {
+	const char * name;
+	size_t object_size;
+	spin_lock_t depot_lock;
+	void * depot;         /* Free objects, linked through their first word. */
+	size_t total_objects;
+	struct slab_magazine magazines[32]; /* Sized to match processor_local_data. */
+};
+
+/**
+ * @brief Create a cache for objects of a fixed size.
+ *
+ * @param name Human-readable description, for debugging.
+ * @param object_size Size of each object in bytes.
+ */
+slab_cache_t * slab_cache_create(const char * name, size_t object_size) {
+	if (object_size < sizeof(void *)) object_size = sizeof(void *);
+	slab_cache_t * cache = calloc(1, sizeof(slab_cache_t));
+	cache->name = name;
+	cache->object_size = object_size;
+	return cache;
+}
+
+/* Carve another chunk of objects out of the heap. Depot lock held. */
+static void slab_grow(slab_cache_t * cache) {
+	char * chunk = malloc(cache->object_size * SLAB_CHUNK_OBJECTS);
+	for (int i = 0; i < SLAB_CHUNK_OBJECTS; ++i) {
+		void * object = chunk + i * cache->object_size;
+		*(void **)object = cache->depot;
+		cache->depot = object;
+	}
+	cache->total_objects += SLAB_CHUNK_OBJECTS;
+}
+
+/**
+ * @brief Allocate one object from a cache.
+ *
+ * Contents are uninitialized, like malloc.
+ */
+void * slab_alloc(slab_cache_t * cache) {
+	struct slab_magazine * mag = &cache->magazines[this_core->cpu_id];
+	spin_lock(mag->lock);
+	if (!mag->count) {
+		spin_lock(cache->depot_lock);
+		while (mag->count < SLAB_MAGAZINE_SIZE / 2) {
+			if (!cache->depot) slab_grow(cache);
+			void * object = cache->depot;
+			cache->depot = *(void **)object;
+			mag->objects[mag->count++] = object;
+		}
+		spin_unlock(cache->depot_lock);
+	}
+	void * out = mag->objects[--mag->count];
+	spin_unlock(mag->lock);
+	return out;
+}
+
+/**
+ * @brief Return an object to its cache.
+ *
+ * The object must have come from @ref slab_alloc on the same cache.
+ */
+void slab_free(slab_cache_t * cache, void * object) {
+	struct slab_magazine * mag = &cache->magazines[this_core->cpu_id];
+	spin_lock(mag->lock);
+	if (mag->count == SLAB_MAGAZINE_SIZE) {
+		/* Flush half back to the depot in one batch. */
+		spin_lock(cache->depot_lock);
+		while (mag->count > SLAB_MAGAZINE_SIZE / 2) {
+			void * flushed = mag->objects[--mag->count];
+			*(void **)flushed = cache->depot;
+			cache->depot = flushed;
+		}
+		spin_unlock(cache->depot_lock);
+	}
+	mag->objects[mag->count++] = object;
+	spin_unlock(mag->lock);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file  kernel/misc/spinlock.c
+ * @brief Spinlock contention instrumentation.
+ *
+ * Only built into anything when LOCK_STATS is defined (see the
+ * commented-out line in the Makefile). In that mode, every
+ * spin_lock() call site carries a static counter block; this file
+ * provides the slow-path acquire that updates it and the /proc/locks
+ * text export, so contended global locks can be ranked with data
+ * from real workloads rather than guesswork.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#ifdef LOCK_STATS
+#include <stdint.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/process.h>
+#include <kernel/time.h>
+#include <kernel/vfs.h>
+
+static struct spin_lock_site * site_list = NULL;
+
+/**
+ * @brief Take a lock, counting what it costs us.
+ *
+ * Replaces the spin_lock() fast path when LOCK_STATS is on. The
+ * same call site can run concurrently on several cores (against
+ * different locks, or waiting on the same one), so counter updates
+ * are atomic.
+ */
+void spin_lock_acquire(spin_lock_t * lock, struct spin_lock_site * site) {
+	unsigned long long spins = 0;
+	uint64_t start = 0;
+
+	if (__sync_lock_test_and_set(lock->latch, 0x01)) {
+		start = arch_perf_timer();
+		do {
+			spins++;
+		} while (__sync_lock_test_and_set(lock->latch, 0x01));
+	}
+
+	lock->owner = this_core->cpu_id + 1;
+	lock->func = site->name;
+
+	__sync_fetch_and_add(&site->acquisitions, 1);
+	if (spins) {
+		unsigned long long waited = arch_perf_timer() - start;
+		__sync_fetch_and_add(&site->spins, spins);
+		__sync_fetch_and_add(&site->wait_total, waited);
+		unsigned long long prev = site->wait_max;
+		while (waited > prev && !__sync_bool_compare_and_swap(&site->wait_max, prev, waited)) {
+			prev = site->wait_max;
+		}
+	}
+
+	if (!site->registered && __sync_bool_compare_and_swap(&site->registered, 0, 1)) {
+		do {
+			site->next = site_list;
+		} while (!__sync_bool_compare_and_swap(&site_list, site->next, site));
+	}
+}
+
+/**
+ * @brief /proc/locks: one line per call site that has fired.
+ */
+ssize_t spin_lock_stats_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	size_t space = 1024;
+	for (struct spin_lock_site * site = site_list; site; site = site->next) {
+		space += 160 + strlen(site->name) + strlen(site->file);
+	}
+
+	char * buf = malloc(space);
+	size_t soffset = snprintf(buf, 100, "%-24s %-32s %12s %14s %16s %14s\n",
+			"LOCK", "SITE", "ACQUIRED", "SPINS", "WAIT-CYCLES", "WAIT-MAX");
+
+	for (struct spin_lock_site * site = site_list; site; site = site->next) {
+		char where[128];
+		snprintf(where, 128, "%s:%d", site->file, site->line);
+		soffset += snprintf(&buf[soffset], 200, "%-24s %-32s %12llu %14llu %16llu %14llu\n",
+				site->name, where,
+				site->acquisitions, site->spins,
+				site->wait_total, site->wait_max);
+	}
+
+	if (offset > (off_t)soffset) {
+		free(buf);
+		return 0;
+	}
+
+	if (size > soffset - offset) size = soffset - offset;
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+#endif
@@ -13,7 +13,8 @@
 #include <kernel/printf.h>
 #include <kernel/syscall.h>
 #include <kernel/vfs.h>
-#include <kernel/hashmap.h>
+#include <kernel/time.h>
+#include <kernel/flatmap.h>
 #include <kernel/mod/net.h>
 #include <kernel/net/netif.h>
 #include <kernel/net/eth.h>
@@ -49,30 +50,148 @@ static void ip_ntoa(const uint32_t src_addr, char * out) {
 }
 
 spin_lock_t net_arp_cache_lock = {0};
-hashmap_t * net_arp_cache = NULL;
+flatmap_t * net_arp_cache = NULL;
 
-void net_arp_cache_add(struct EthernetDevice * iface, uint32_t addr, uint8_t * hwaddr, uint16_t flags) {
+/* Seconds before a learned entry goes stale and must be confirmed
+ * again; zero disables aging entirely. */
+unsigned int net_arp_timeout = 300;
+
+/* Most frames parked on one unresolved host; beyond this the oldest
+ * is dropped, which is still kinder than dropping all of them. */
+#define ARP_PENDING_MAX 16
+
+/* Cache entries carry a lifecycle around the public ArpCacheEntry:
+ * when they were last confirmed, when we last broadcast for them, and
+ * the frames waiting to go out once the reply lands. */
+struct arp_entry {
+	struct ArpCacheEntry cache; /* public view handed out by _get */
+	uint32_t addr;
+	int resolved;
+	uint64_t updated;  /* last confirmation, wall seconds */
+	uint64_t last_ask; /* last broadcast request, wall seconds */
+	list_t * pending;
+};
+
+struct arp_pending {
+	struct EthernetDevice * nic;
+	uint16_t type;
+	size_t size;
+	size_t csum_start;  /* Deferred checksum insertion; see net_eth_send_csum */
+	size_t csum_offset;
+	node_t node;
+	uint8_t frame[];
+};
+
+/* Cache lock must be held. */
+static struct arp_entry * arp_entry_get(uint32_t addr, int create) {
+	struct arp_entry * entry = flatmap_get(net_arp_cache, addr);
+	if (!entry && create) {
+		entry = calloc(1, sizeof(struct arp_entry));
+		entry->addr = addr;
+		entry->pending = list_create("arp pending", entry);
+		flatmap_set(net_arp_cache, addr, entry);
+	}
+	return entry;
+}
+
+static void arp_cache_store(struct EthernetDevice * iface, uint32_t addr, uint8_t * hwaddr, uint16_t flags, int create) {
+	list_t * run = NULL;
 	spin_lock(net_arp_cache_lock);
-	struct ArpCacheEntry * entry = hashmap_get(net_arp_cache, (void*)(uintptr_t)addr);
-	if (!entry) entry = malloc(sizeof(struct ArpCacheEntry));
-	memcpy(entry->hwaddr, hwaddr, 6);
-	entry->flags = flags;
-	entry->iface = iface;
-	hashmap_set(net_arp_cache, (void*)(uintptr_t)addr, entry);
+	struct arp_entry * entry = arp_entry_get(addr, create);
+	if (entry) {
+		memcpy(entry->cache.hwaddr, hwaddr, 6);
+		entry->cache.flags = flags;
+		entry->cache.iface = iface;
+		entry->resolved = 1;
+		entry->updated = now();
+		if (entry->pending->length) {
+			/* Detach the queue; the sends happen outside the lock. */
+			run = entry->pending;
+			entry->pending = list_create("arp pending", entry);
+		}
+	}
 	spin_unlock(net_arp_cache_lock);
+
+	if (run) {
+		node_t * node;
+		while ((node = list_dequeue(run))) {
+			struct arp_pending * p = node->value;
+			net_eth_send_csum(p->nic, p->size, p->frame, p->type, hwaddr, p->csum_start, p->csum_offset);
+			free(p);
+		}
+		free(run);
+	}
+}
+
+void net_arp_cache_add(struct EthernetDevice * iface, uint32_t addr, uint8_t * hwaddr, uint16_t flags) {
+	arp_cache_store(iface, addr, hwaddr, flags, 1);
 }
 
 struct ArpCacheEntry * net_arp_cache_get(uint32_t addr) {
+	struct ArpCacheEntry * out = NULL;
 	spin_lock(net_arp_cache_lock);
-	struct ArpCacheEntry * out = hashmap_get(net_arp_cache, (void*)(uintptr_t)addr);
+	struct arp_entry * entry = arp_entry_get(addr, 0);
+	if (entry && entry->resolved) {
+		if (net_arp_timeout && now() - entry->updated > net_arp_timeout) {
+			/* Stale. The last-known address stays in the entry, but the
+			 * miss makes the caller kick off a fresh resolution. */
+			entry->resolved = 0;
+		} else {
+			out = &entry->cache;
+		}
+	}
 	spin_unlock(net_arp_cache_lock);
 	return out;
 }
 
+int net_arp_enqueue(uint32_t addr, fs_node_t * fsnic, uint16_t type, void * payload, size_t size, size_t csum_start, size_t csum_offset) {
+	struct arp_pending * p = malloc(sizeof(struct arp_pending) + size);
+	p->nic = fsnic->device;
+	p->type = type;
+	p->size = size;
+	p->csum_start = csum_start;
+	p->csum_offset = csum_offset;
+	p->node.value = p;
+	memcpy(p->frame, payload, size);
+
+	spin_lock(net_arp_cache_lock);
+	struct arp_entry * entry = arp_entry_get(addr, 1);
+	if (entry->resolved) {
+		/* Resolved between the caller's miss and now; just send it. */
+		uint8_t hwaddr[6];
+		memcpy(hwaddr, entry->cache.hwaddr, 6);
+		spin_unlock(net_arp_cache_lock);
+		net_eth_send_csum(p->nic, p->size, p->frame, p->type, hwaddr, p->csum_start, p->csum_offset);
+		free(p);
+		return 0;
+	}
+	if (entry->pending->length >= ARP_PENDING_MAX) {
+		node_t * old = list_dequeue(entry->pending);
+		free(old->value);
+	}
+	list_append(entry->pending, &p->node);
+	spin_unlock(net_arp_cache_lock);
+
+	net_arp_ask(addr, fsnic);
+	return 0;
+}
+
 void net_arp_ask(uint32_t addr, fs_node_t * fsnic) {
 	struct EthernetDevice * ethnic = fsnic->device;
 	struct arp_header arp_request = {0};
 
+	/* At most one broadcast per host per second, so a burst of packets
+	 * to an unresolved destination doesn't turn into a request storm. */
+	spin_lock(net_arp_cache_lock);
+	struct arp_entry * entry = arp_entry_get(addr, 1);
+	uint64_t t = now();
+	if (entry->last_ask == t) {
+		spin_unlock(net_arp_cache_lock);
+		return;
+	}
+	entry->last_ask = t;
+	spin_unlock(net_arp_cache_lock);
+
 	arp_request.arp_htype = htons(1); /* Ethernet */
 	arp_request.arp_ptype = htons(ETHERNET_TYPE_IPV4);
 	arp_request.arp_hlen  = 6;
@@ -97,7 +216,12 @@ void net_arp_handle(struct arp_header * packet, fs_node_t * nic) {
 	if (ntohs(packet->arp_htype) == 1 && ntohs(packet->arp_ptype) == ETHERNET_TYPE_IPV4) {
 		/* Ethernet, IPv4 */
 		if (packet->arp_data.arp_eth_ipv4.arp_spa) {
-			net_arp_cache_add(eth_dev, packet->arp_data.arp_eth_ipv4.arp_spa, packet->arp_data.arp_eth_ipv4.arp_sha, 0);
+			/* A gratuitous announcement (sender == target) refreshes
+			 * hosts we already know about - catching address moves
+			 * before the stale entry ages out - but doesn't earn
+			 * strangers a table entry. */
+			int gratuitous = packet->arp_data.arp_eth_ipv4.arp_spa == packet->arp_data.arp_eth_ipv4.arp_tpa;
+			arp_cache_store(eth_dev, packet->arp_data.arp_eth_ipv4.arp_spa, packet->arp_data.arp_eth_ipv4.arp_sha, 0, !gratuitous);
 		}
 		if (ntohs(packet->arp_oper) == 1) {
 			char spa[17];
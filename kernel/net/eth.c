@@ -16,12 +16,15 @@
 #include <kernel/spinlock.h>
 #include <kernel/vfs.h>
 #include <kernel/mod/net.h>
+#include <kernel/slab.h>
 #include <kernel/net/netif.h>
 #include <kernel/net/eth.h>
+#include <kernel/net/pbuf.h>
 #include <kernel/net/ipv4.h>
 #include <errno.h>
 
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #ifndef MISAKA_DEBUG_NET
 #define printf(...)
@@ -36,10 +39,14 @@ struct ethernet_packet {
 
 extern spin_lock_t net_raw_sockets_lock;
 extern list_t * net_raw_sockets_list;
-extern void net_ipv4_handle(void * packet, fs_node_t * nic, size_t);
+extern void net_ipv4_handle(void * packet, fs_node_t * nic, size_t, struct pbuf * backing);
 extern void net_arp_handle(void * packet, fs_node_t * nic);
 
-void net_eth_handle(struct ethernet_packet * frame, fs_node_t * nic, size_t size) {
+/* Raw sockets always get a copy - they see the whole frame, including
+ * the header bytes zero-copy delivery would later scribble on - but the
+ * backing buffer, when there is one, rides along to the protocol
+ * handlers so the final socket delivery can take a reference instead. */
+static void net_eth_handle_backed(struct ethernet_packet * frame, fs_node_t * nic, size_t size, struct pbuf * backing) {
 	struct EthernetDevice * nic_eth = nic->device;
 
 	if (size < sizeof(struct ethernet_packet)) {
@@ -69,20 +76,146 @@ void net_eth_handle(struct ethernet_packet * frame, fs_node_t * nic, size_t size
 				if (packet->source != 0xFFFFFFFF) {
 					net_arp_cache_add(nic->device, packet->source, frame->source, 0);
 				}
-				net_ipv4_handle(packet, nic, size - sizeof(struct ethernet_packet));
+				net_ipv4_handle(packet, nic, size - sizeof(struct ethernet_packet), backing);
 				break;
 			}
 		}
 	}
 }
 
-void net_eth_send(struct EthernetDevice * nic, size_t len, void* data, uint16_t type, uint8_t * dest) {
+void net_eth_handle(struct ethernet_packet * frame, fs_node_t * nic, size_t size) {
+	net_eth_handle_backed(frame, nic, size, NULL);
+}
+
+/**
+ * @brief Take a received frame in a pool buffer up the stack.
+ *
+ * The caller's reference is consumed; sockets that keep the buffer hold
+ * their own references.
+ */
+void net_eth_handle_pbuf(struct pbuf * p, fs_node_t * nic) {
+	/* Stamp arrival before any socket sees the frame; latency probes
+	 * read this instead of measuring their own scheduling delay. */
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	p->rx_time = (uint64_t)tv.tv_sec * 1000000UL + tv.tv_usec;
+	net_eth_handle_backed((struct ethernet_packet *)PBUF_PAYLOAD(p), nic, p->size, p);
+	pbuf_unref(p);
+}
+
+/* Outgoing frames are built in a scratch buffer that lives only for the
+ * duration of the device write; under load that's a malloc/free pair per
+ * packet, all serialized on the heap lock, so frames that fit in an MTU
+ * come from a slab cache instead. */
+#define ETH_CACHE_OBJECT_SIZE 2048
+static slab_cache_t * eth_frame_cache = NULL;
+static spin_lock_t eth_frame_cache_lock = { 0 };
+
+void net_eth_send_csum(struct EthernetDevice * nic, size_t len, void* data, uint16_t type, uint8_t * dest, size_t csum_start, size_t csum_offset) {
 	size_t total_size = sizeof(struct ethernet_packet) + len;
-	struct ethernet_packet * packet = malloc(total_size);
+	struct ethernet_packet * packet;
+
+	if (nic->send_pbuf && total_size <= PBUF_CAPACITY) {
+		/* Build the frame directly in a pool buffer and hand it to the
+		 * driver with its reference - the device DMAs straight out of
+		 * it, no second copy into a staging ring. */
+		struct pbuf * p = pbuf_alloc();
+		if (p) {
+			packet = (struct ethernet_packet *)PBUF_PAYLOAD(p);
+			memcpy(packet->payload, data, len);
+			memcpy(packet->destination, dest, 6);
+			memcpy(packet->source, nic->mac, 6);
+			packet->type = htons(type);
+			if (csum_offset) {
+				p->csum_start = sizeof(struct ethernet_packet) + csum_start;
+				p->csum_offset = sizeof(struct ethernet_packet) + csum_offset;
+			} else {
+				p->csum_start = 0;
+				p->csum_offset = 0;
+			}
+			net_if_tx_enqueue(nic, p, NULL, total_size);
+			return;
+		}
+	}
+
+	/* Frames headed for a transmit queue come from the heap - the
+	 * worker frees them after the device write, and the slab cache is
+	 * only safe to return to from this function. */
+	if (nic->txq) {
+		packet = malloc(total_size);
+		memcpy(packet->payload, data, len);
+		memcpy(packet->destination, dest, 6);
+		memcpy(packet->source, nic->mac, 6);
+		packet->type = htons(type);
+		if (csum_offset) {
+			net_csum_finish(packet, total_size,
+				sizeof(struct ethernet_packet) + csum_start,
+				sizeof(struct ethernet_packet) + csum_offset);
+		}
+		net_if_tx_enqueue(nic, NULL, packet, total_size);
+		return;
+	}
+
+	if (total_size <= ETH_CACHE_OBJECT_SIZE) {
+		if (!eth_frame_cache) {
+			spin_lock(eth_frame_cache_lock);
+			if (!eth_frame_cache) {
+				eth_frame_cache = slab_cache_create("ethernet frames", ETH_CACHE_OBJECT_SIZE);
+			}
+			spin_unlock(eth_frame_cache_lock);
+		}
+		packet = slab_alloc(eth_frame_cache);
+	} else {
+		packet = malloc(total_size);
+	}
 	memcpy(packet->payload, data, len);
 	memcpy(packet->destination, dest, 6);
 	memcpy(packet->source, nic->mac, 6);
 	packet->type = htons(type);
+	if (csum_offset) {
+		/* No hardware insertion on this path; finish it here. */
+		net_csum_finish(packet, total_size,
+			sizeof(struct ethernet_packet) + csum_start,
+			sizeof(struct ethernet_packet) + csum_offset);
+	}
 	write_fs(nic->device_node, 0, total_size, (uint8_t*)packet);
-	free(packet);
+	if (total_size <= ETH_CACHE_OBJECT_SIZE) {
+		slab_free(eth_frame_cache, packet);
+	} else {
+		free(packet);
+	}
+}
+
+void net_eth_send(struct EthernetDevice * nic, size_t len, void* data, uint16_t type, uint8_t * dest) {
+	net_eth_send_csum(nic, len, data, type, dest, 0, 0);
+}
+
+/* Build-in-place transmit, for protocols that assemble their own
+ * packets in bulk: the caller gets a pool buffer with room reserved for
+ * the ethernet header and fills its packet directly in the memory the
+ * device will DMA from, then hands it back below for the header. That
+ * is one copy out of the user's buffer, instead of a build into scratch
+ * plus a copy into the staging frame. */
+struct pbuf * net_eth_pbuf_prepare(void ** l3_start, size_t l3_size) {
+	if (sizeof(struct ethernet_packet) + l3_size > PBUF_CAPACITY) return NULL;
+	struct pbuf * p = pbuf_alloc();
+	if (!p) return NULL;
+	*l3_start = ((struct ethernet_packet *)PBUF_PAYLOAD(p))->payload;
+	return p;
+}
+
+void net_eth_pbuf_send(struct EthernetDevice * nic, struct pbuf * p, size_t l3_size, uint16_t type, uint8_t * dest, size_t csum_start, size_t csum_offset) {
+	size_t total_size = sizeof(struct ethernet_packet) + l3_size;
+	struct ethernet_packet * packet = (struct ethernet_packet *)PBUF_PAYLOAD(p);
+	memcpy(packet->destination, dest, 6);
+	memcpy(packet->source, nic->mac, 6);
+	packet->type = htons(type);
+	if (csum_offset) {
+		p->csum_start = sizeof(struct ethernet_packet) + csum_start;
+		p->csum_offset = sizeof(struct ethernet_packet) + csum_offset;
+	} else {
+		p->csum_start = 0;
+		p->csum_offset = 0;
+	}
+	net_if_tx_enqueue(nic, p, NULL, total_size);
 }
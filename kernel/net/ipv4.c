@@ -12,7 +12,6 @@
 #include <kernel/string.h>
 #include <kernel/printf.h>
 #include <kernel/syscall.h>
-#include <kernel/hashmap.h>
 #include <kernel/vfs.h>
 #include <kernel/time.h>
 #include <kernel/misc.h>
@@ -20,9 +19,11 @@
 
 #include <kernel/net/netif.h>
 #include <kernel/net/eth.h>
+#include <kernel/net/pbuf.h>
 #include <kernel/net/ipv4.h>
 
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <arpa/inet.h>
 
 #ifndef MISAKA_DEBUG_NET
@@ -42,85 +43,124 @@ static void ip_ntoa(const uint32_t src_addr, char * out) {
 		(src_addr & 0xFF));
 }
 
-static uint16_t icmp_checksum(struct ipv4_packet * packet) {
-	uint32_t sum = 0;
-	uint16_t * s = (uint16_t *)packet->payload;
-	for (int i = 0; i < (ntohs(packet->length) - 20) / 2; ++i) {
-		sum += ntohs(s[i]);
+/* One's-complement sum over a byte range, eight bytes at a time with
+ * end-around carry. The sum is byte-order independent, so words are
+ * added exactly as they sit in memory and the result swapped once at
+ * the end; that cuts the per-segment payload walk to an eighth of the
+ * old 16-bit loop. Regions can be chained as long as only the last
+ * one has odd length. */
+static uint64_t csum_add(uint64_t sum, const void * ptr, size_t len) {
+	const uint8_t * data = ptr;
+	while (len >= 8) {
+		uint64_t w;
+		memcpy(&w, data, 8);
+		sum += w;
+		if (sum < w) sum++;
+		data += 8;
+		len -= 8;
 	}
-	if (sum > 0xFFFF) {
-		sum = (sum >> 16) + (sum & 0xFFFF);
+	if (len >= 4) {
+		uint32_t w;
+		memcpy(&w, data, 4);
+		sum += w;
+		if (sum < w) sum++;
+		data += 4;
+		len -= 4;
 	}
-	return ~(sum & 0xFFFF) & 0xFFFF;
-}
-
-uint16_t calculate_ipv4_checksum(struct ipv4_packet * p) {
-	uint32_t sum = 0;
-	uint16_t * s = (uint16_t *)p;
-
-	/* TODO: Checksums for options? */
-	for (int i = 0; i < 10; ++i) {
-		sum += ntohs(s[i]);
-		if (sum > 0xFFFF) {
-			sum = (sum >> 16) + (sum & 0xFFFF);
-		}
+	if (len >= 2) {
+		uint16_t w;
+		memcpy(&w, data, 2);
+		sum += w;
+		if (sum < w) sum++;
+		data += 2;
+		len -= 2;
 	}
+	if (len) {
+		/* Trailing byte pads with zero, as if the word were there. */
+		uint16_t w = *data;
+		sum += w;
+		if (sum < w) sum++;
+	}
+	return sum;
+}
 
+/* Fold to 16 bits and complement; returned in host order to match the
+ * htons() the callers apply when storing. */
+static uint16_t csum_finalize(uint64_t sum) {
+	while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+	return ntohs(~sum & 0xFFFF);
+}
 
-	return ~(sum & 0xFFFF) & 0xFFFF;
+/* RFC 1624 incremental update: one 16-bit field of a summed region
+ * changed from old_word to new_word; fix the checksum without
+ * re-summing anything else. All values in raw memory order. */
+static uint16_t csum_incremental(uint16_t old_csum, uint16_t old_word, uint16_t new_word) {
+	uint32_t sum = (uint16_t)~old_csum + (uint16_t)~old_word + new_word;
+	while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum & 0xFFFF;
 }
 
-uint16_t calculate_tcp_checksum(struct tcp_check_header * p, struct tcp_header * h, void * d, size_t payload_size) {
-	uint32_t sum = 0;
-	uint16_t * s = (uint16_t *)p;
+/**
+ * @brief Finish a checksum a device couldn't insert in hardware.
+ *
+ * The frame was built for checksum offload: the field at @p offset
+ * holds the pseudo-header seed. Sum from @p start to the end - seed
+ * included, exactly as the hardware would - and store the complement.
+ */
+void net_csum_finish(void * frame, size_t size, size_t start, size_t offset) {
+	uint64_t sum = csum_add(0, (uint8_t*)frame + start, size - start);
+	while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+	uint16_t result = ~sum & 0xFFFF;
+	memcpy((uint8_t*)frame + offset, &result, 2);
+}
 
+uint16_t calculate_ipv4_checksum(struct ipv4_packet * p) {
 	/* TODO: Checksums for options? */
-	for (int i = 0; i < 6; ++i) {
-		sum += ntohs(s[i]);
-		if (sum > 0xFFFF) {
-			sum = (sum >> 16) + (sum & 0xFFFF);
-		}
-	}
-
-	s = (uint16_t *)h;
-	for (int i = 0; i < 10; ++i) {
-		sum += ntohs(s[i]);
-		if (sum > 0xFFFF) {
-			sum = (sum >> 16) + (sum & 0xFFFF);
-		}
-	}
-
-	uint16_t d_words = payload_size / 2;
-
-	s = (uint16_t *)d;
-	for (unsigned int i = 0; i < d_words; ++i) {
-		sum += ntohs(s[i]);
-		if (sum > 0xFFFF) {
-			sum = (sum >> 16) + (sum & 0xFFFF);
-		}
-	}
+	return csum_finalize(csum_add(0, p, 20));
+}
 
-	if (d_words * 2 != payload_size) {
-		uint8_t * t = (uint8_t *)d;
-		uint8_t tmp[2];
-		tmp[0] = t[d_words * sizeof(uint16_t)];
-		tmp[1] = 0;
+uint16_t calculate_tcp_checksum(struct tcp_check_header * p, struct tcp_header * h, void * d, size_t payload_size) {
+	uint64_t sum = csum_add(0, p, sizeof(struct tcp_check_header));
+	sum = csum_add(sum, h, sizeof(struct tcp_header));
+	if (d && payload_size) sum = csum_add(sum, d, payload_size);
+	return csum_finalize(sum);
+}
 
-		uint16_t * f = (uint16_t *)tmp;
+/* Pseudo-header seed for hardware checksum insertion, in raw memory
+ * order ready to store in the checksum field. */
+static uint16_t tcp_checksum_seed(struct tcp_check_header * p) {
+	uint64_t sum = csum_add(0, p, sizeof(struct tcp_check_header));
+	while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+	return (uint16_t)sum;
+}
 
-		sum += ntohs(f[0]);
-		if (sum > 0xFFFF) {
-			sum = (sum >> 16) + (sum & 0xFFFF);
-		}
+/* Checksum an outgoing TCP frame as cheaply as the route allows:
+ * loopback skips it (nothing verifies bytes that never leave kernel
+ * memory), offload-capable devices get the pseudo-header seed and do
+ * the payload walk themselves, everything else falls back to the
+ * software sum. */
+static void tcp_set_checksum(fs_node_t * nic, struct tcp_check_header * check_hd, struct tcp_header * tcp_header, void * payload, size_t payload_size) {
+	struct EthernetDevice * enic = nic->device;
+	if (enic->loopback) return;
+	if (enic->hw_csum) {
+		tcp_header->checksum = tcp_checksum_seed(check_hd);
+	} else {
+		tcp_header->checksum = htons(calculate_tcp_checksum(check_hd, tcp_header, payload, payload_size));
 	}
-
-	return ~(sum & 0xFFFF) & 0xFFFF;
 }
 
+extern ssize_t net_loop_deliver_ipv4(fs_node_t * node, void * packet, size_t size);
+
 int net_ipv4_send(struct ipv4_packet * response, fs_node_t * nic) {
 	/* TODO: This should be routing, with a _hint_ about the interface, not the actual nic to send from! */
 	struct EthernetDevice * enic = nic->device;
 
+	if (enic->loopback) {
+		/* Same-host traffic goes straight back into the input path. */
+		net_loop_deliver_ipv4(nic, response, ntohs(response->length));
+		return 0;
+	}
+
 	/* where are we going? */
 	uint32_t ipdest = response->destination;
 
@@ -130,39 +170,40 @@ int net_ipv4_send(struct ipv4_packet * response, fs_node_t * nic) {
 	/* Is this local or should we send it to the gateway? */
 	if (!enic->ipv4_subnet || ((ipdest & enic->ipv4_subnet) != (enic->ipv4_addr & enic->ipv4_subnet))) {
 		ipdest = enic->ipv4_gateway;
-		resp = net_arp_cache_get(ipdest);
-	} else {
-		resp = net_arp_cache_get(ipdest);
-		if (!resp) {
-			net_arp_ask(ipdest, nic);
-
-			unsigned long s, ss;
-			relative_time(0, 1000, &s, &ss);
-			sleep_until((process_t *)this_core->current_process, s, ss);
-			switch_task(0);
+	}
 
-			resp = net_arp_cache_get(ipdest);
-		}
+	/* TCP frames bound for offload-capable devices carry only the
+	 * pseudo-header seed; tell the ethernet layer where the device
+	 * should insert the sum. */
+	size_t csum_start = 0, csum_offset = 0;
+	if (enic->hw_csum && response->protocol == IPV4_PROT_TCP) {
+		size_t hlen = (response->version_ihl & 0xF) * 4;
+		csum_start = hlen;
+		csum_offset = hlen + 16; /* the checksum field within the TCP header */
 	}
 
+	resp = net_arp_cache_get(ipdest);
+	if (!resp) {
+		/* Park the packet on the unresolved entry; it goes out when
+		 * the reply lands, rather than the old ask-sleep-and-broadcast
+		 * dance that cost every new flow its first packet. */
+		return net_arp_enqueue(ipdest, nic, ETHERNET_TYPE_IPV4, response, ntohs(response->length), csum_start, csum_offset);
+	}
 
 	/* Pass the packet to the next stage */
-	net_eth_send(enic, ntohs(response->length), response, ETHERNET_TYPE_IPV4, resp ? resp->hwaddr : ETHERNET_BROADCAST_MAC);
+	net_eth_send_csum(enic, ntohs(response->length), response, ETHERNET_TYPE_IPV4, resp->hwaddr, csum_start, csum_offset);
 
 	return 0;
 }
 
 static sock_t * icmp_handler = NULL;
 
-static void icmp_handle(struct ipv4_packet * packet, const char * src, const char * dest, fs_node_t * nic) {
+static void icmp_handle(struct ipv4_packet * packet, const char * src, const char * dest, fs_node_t * nic, struct pbuf * backing) {
 	struct icmp_header * header = (void*)&packet->payload;
 
 	/* Is this a PING request? */
 	if (header->type == 8 && header->code == 0) {
 		printf("net: ping with %d bytes of payload\n", ntohs(packet->length));
-		if (ntohs(packet->length) & 1) {
-			packet->length = htons(ntohs(packet->length) + 1);
-		}
 
 		struct ipv4_packet * response = malloc(ntohs(packet->length));
 		memcpy(response, packet, ntohs(packet->length));
@@ -178,10 +219,14 @@ static void icmp_handle(struct ipv4_packet * packet, const char * src, const cha
 		response->checksum = 0;
 		response->checksum = htons(calculate_ipv4_checksum(response));
 
+		/* Only the type byte changes from the request, so patch the
+		 * checksum incrementally instead of re-summing the payload. */
 		struct icmp_header * ping_reply = (void*)&response->payload;
-		ping_reply->csum = 0;
+		uint16_t old_word, new_word;
+		memcpy(&old_word, ping_reply, 2);
 		ping_reply->type = 0;
-		ping_reply->csum = htons(icmp_checksum(response));
+		memcpy(&new_word, ping_reply, 2);
+		ping_reply->csum = csum_incremental(ping_reply->csum, old_word, new_word);
 
 		/* send ipv4... */
 		net_ipv4_send(response,nic);
@@ -190,7 +235,7 @@ static void icmp_handle(struct ipv4_packet * packet, const char * src, const cha
 		printf("net: ping reply\n");
 		/* Did we have a client waiting for this? */
 		if (icmp_handler) {
-			net_sock_add(icmp_handler, packet, ntohs(packet->length));
+			net_sock_add_backed(icmp_handler, packet, ntohs(packet->length), backing);
 		}
 	} else {
 		printf("net: ipv4: %s: %s -> %s ICMP %d (code = %d)\n", nic->name, src, dest, header->type, header->code);
@@ -201,6 +246,26 @@ static void sock_icmp_close(sock_t * sock) {
 	icmp_handler = NULL;
 }
 
+/* Attach the frame's kernel arrival time as a SCM_TIMESTAMP control
+ * message, if the socket asked for one (SO_TIMESTAMP) and the caller
+ * left room for it. Latency measured against this stamp excludes the
+ * scheduler wakeup between delivery and the receiving read. */
+static void sock_attach_timestamp(sock_t * sock, struct msghdr * msg, void * blob) {
+	if (!msg->msg_control) return;
+	if (!sock->rx_timestamp || msg->msg_controllen < CMSG_SPACE(sizeof(struct timeval))) {
+		msg->msg_controllen = 0;
+		return;
+	}
+	uint64_t stamp = net_sock_frame_time(blob);
+	struct timeval tv = { stamp / 1000000UL, stamp % 1000000UL };
+	struct cmsghdr * cmsg = CMSG_FIRSTHDR(msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_TIMESTAMP;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(struct timeval));
+	memcpy(CMSG_DATA(cmsg), &tv, sizeof(struct timeval));
+	msg->msg_controllen = CMSG_SPACE(sizeof(struct timeval));
+}
+
 static long sock_icmp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	if (msg->msg_iovlen > 1) {
 		return -ENOTSUP;
@@ -209,7 +274,7 @@ static long sock_icmp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 
 	char * packet = net_sock_get(sock);
 	if (!packet) return -EINTR;
-	size_t packet_size = *(size_t*)packet;
+	size_t packet_size = NET_FRAME_SIZE(packet);
 	struct ipv4_packet * data = (struct ipv4_packet*)(packet + sizeof(size_t));
 
 	if (packet_size > msg->msg_iov[0].iov_len) {
@@ -218,7 +283,8 @@ static long sock_icmp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	}
 
 	memcpy(msg->msg_iov[0].iov_base, data, packet_size);
-	free(packet);
+	sock_attach_timestamp(sock, msg, packet);
+	net_sock_free(packet);
 	return packet_size;
 }
 
@@ -267,12 +333,95 @@ static int icmp_socket(void) {
 	return process_append_fd((process_t *)this_core->current_process, (fs_node_t *)sock);
 }
 
-static hashmap_t * udp_sockets = NULL;
-static hashmap_t * tcp_sockets = NULL;
+/* Socket demux. Connected sockets are keyed by the full
+ * {remote address, remote port, local port} tuple, so several
+ * connections can share a local port; sockets bound without a peer -
+ * and, eventually, listeners - sit in the same table with a wildcard
+ * remote and are found on a second probe of the local-port-only slot.
+ * Buckets are chained lists, so the table stays O(1)-ish out to a few
+ * hundred sockets instead of degrading like the old ten-bucket maps. */
+#define SOCK_HASH_BUCKETS 256
+
+struct sock_binding {
+	uint32_t raddr; /* network order; 0 is the wildcard */
+	uint16_t rport; /* network order; 0 is the wildcard */
+	uint16_t lport; /* host order, to match sock->priv[0] */
+	sock_t * sock;
+	node_t node;
+};
+
+struct sock_table {
+	spin_lock_t lock;
+	list_t * buckets[SOCK_HASH_BUCKETS];
+};
+
+static struct sock_table udp_table = {0};
+static struct sock_table tcp_table = {0};
+
+static unsigned int sock_tuple_hash(uint32_t raddr, uint16_t rport, uint16_t lport) {
+	uint32_t h = raddr ^ (((uint32_t)rport << 16) | lport);
+	h *= 0x9E3779B1UL; /* Fibonacci hashing; spreads adjacent ports */
+	return (h >> 16) & (SOCK_HASH_BUCKETS - 1);
+}
+
+static void sock_table_insert(struct sock_table * table, sock_t * sock, uint32_t raddr, uint16_t rport, uint16_t lport) {
+	struct sock_binding * binding = malloc(sizeof(struct sock_binding));
+	binding->raddr = raddr;
+	binding->rport = rport;
+	binding->lport = lport;
+	binding->sock  = sock;
+	binding->node.value = binding;
+
+	unsigned int h = sock_tuple_hash(raddr, rport, lport);
+	spin_lock(table->lock);
+	if (!table->buckets[h]) table->buckets[h] = list_create("ipv4 socket bucket", table);
+	list_append(table->buckets[h], &binding->node);
+	spin_unlock(table->lock);
+}
+
+static void sock_table_remove(struct sock_table * table, sock_t * sock, uint32_t raddr, uint16_t rport, uint16_t lport) {
+	spin_lock(table->lock);
+	list_t * bucket = table->buckets[sock_tuple_hash(raddr, rport, lport)];
+	if (bucket) {
+		foreach(node, bucket) {
+			struct sock_binding * binding = node->value;
+			if (binding->sock == sock) {
+				list_delete(bucket, node);
+				free(binding);
+				break;
+			}
+		}
+	}
+	spin_unlock(table->lock);
+}
+
+static sock_t * sock_bucket_scan(struct sock_table * table, uint32_t raddr, uint16_t rport, uint16_t lport) {
+	list_t * bucket = table->buckets[sock_tuple_hash(raddr, rport, lport)];
+	if (!bucket) return NULL;
+	foreach(node, bucket) {
+		struct sock_binding * binding = node->value;
+		if (binding->raddr == raddr && binding->rport == rport && binding->lport == lport) {
+			return binding->sock;
+		}
+	}
+	return NULL;
+}
+
+static sock_t * sock_table_get(struct sock_table * table, uint32_t raddr, uint16_t rport, uint16_t lport) {
+	spin_lock(table->lock);
+	sock_t * sock = sock_bucket_scan(table, raddr, rport, lport);
+	if (!sock && (raddr || rport)) {
+		/* No exact match; fall back to a wildcard binding on the
+		 * local port - a socket bound without a peer, or a listener. */
+		sock = sock_bucket_scan(table, 0, 0, lport);
+	}
+	spin_unlock(table->lock);
+	return sock;
+}
 
 void ipv4_install(void) {
-	udp_sockets = hashmap_create_int(10);
-	tcp_sockets = hashmap_create_int(10);
+	/* The demux tables are statically allocated; buckets are created
+	 * on first insertion. */
 }
 
 #define TCP_FLAGS_FIN (1 << 0)
@@ -286,10 +435,396 @@ void ipv4_install(void) {
 #define TCP_FLAGS_NS  (1 << 8)
 #define DATA_OFFSET_5 (0x5 << 12)
 
+/* Sliding-window sender state. The sequence and ack numbers stay in
+ * sock->priv32[] as before (priv32[0] = next sequence number to send,
+ * priv32[1] = next sequence number we expect); this tracks what is in
+ * flight and what arrived out of order. */
+#define TCP_MSS         1024
+#define TCP_RTO_MIN     200000UL    /* Retransmission timeout bounds, microseconds */
+#define TCP_RTO_MAX     60000000UL
+#define TCP_RTO_DEFAULT 1000000UL
+#define TCP_RETX_LIMIT  15          /* Retransmissions before we declare the peer gone */
+#define TCP_OOO_LIMIT   64          /* Most segments held for reassembly */
+#define TCP_RETX_BATCH  8           /* Most retransmissions per timer sweep */
+#define TCP_TSQ_LIMIT   0x20000     /* Interface queue depth at which senders back off */
+
+struct tcp_seg {
+	uint32_t seq;                 /* First sequence number covered */
+	uint32_t len;                 /* Payload bytes */
+	uint64_t sent_at;             /* Microseconds; basis for the RTT sample */
+	int      retransmits;
+	size_t   total_length;        /* Full IPv4 packet size */
+	struct ipv4_packet * packet;  /* The packet as originally built, kept for resends */
+	struct pbuf * pbuf;           /* Pool buffer the packet lives in, when built in place */
+	node_t   node;
+};
+
+struct tcp_ooo {
+	uint32_t seq;
+	uint32_t payload_len;
+	size_t   size;                /* IPv4 packet size, as handed to net_sock_add */
+	struct ipv4_packet * packet;  /* Our own copy; the handler's buffer is transient */
+	node_t   node;
+};
+
+struct tcp_state {
+	spin_lock_t lock;
+	sock_t * sock;
+	list_t * unacked;   /* tcp_segs in sequence order */
+	list_t * ooo;       /* Segments received ahead of priv32[1], in sequence order */
+	list_t * ack_wait;  /* Senders blocked on a full window sleep here */
+	uint32_t snd_una;   /* Oldest unacknowledged sequence number */
+	uint32_t snd_wnd;   /* Peer's advertised receive window, already unscaled */
+	/* RFC 7323 window scaling, negotiated on the SYN exchange; both
+	 * stay zero unless both sides offered the option. */
+	uint8_t snd_wscale; /* Shift applied to windows the peer advertises */
+	uint8_t rcv_wscale; /* Shift the peer applies to windows we advertise */
+	/* RFC 6298 retransmission timer state, microseconds */
+	uint64_t srtt;
+	uint64_t rttvar;
+	uint64_t rto;
+	int rtt_valid;
+	node_t node;        /* On tcp_connections */
+};
+
+static list_t * tcp_connections = NULL;
+static spin_lock_t tcp_connections_lock = {0};
+
+static int tcp_ack(fs_node_t * nic, sock_t * sock, struct ipv4_packet * packet, int isSynAck, size_t payload_len);
+
+/* Retire a segment: the retained packet is either a reference on the
+ * pool buffer the device transmitted from, or its own heap copy. */
+static void tcp_seg_free(struct tcp_seg * seg) {
+	if (seg->pbuf) pbuf_unref(seg->pbuf);
+	else free(seg->packet);
+	free(seg);
+}
+
+static uint64_t tcp_now(void) {
+	return arch_perf_timer() / arch_cpu_mhz();
+}
+
+/* RFC 6298 §2: smoothed RTT and variance feed the retransmission
+ * timeout. Called with the state lock held, and never for a segment
+ * that was retransmitted (Karn's algorithm). */
+static void tcp_update_rtt(struct tcp_state * st, uint64_t sample) {
+	if (!st->rtt_valid) {
+		st->srtt = sample;
+		st->rttvar = sample / 2;
+		st->rtt_valid = 1;
+	} else {
+		uint64_t err = st->srtt > sample ? st->srtt - sample : sample - st->srtt;
+		st->rttvar = (3 * st->rttvar + err) / 4;
+		st->srtt = (7 * st->srtt + sample) / 8;
+	}
+	st->rto = st->srtt + 4 * st->rttvar;
+	if (st->rto < TCP_RTO_MIN) st->rto = TCP_RTO_MIN;
+	if (st->rto > TCP_RTO_MAX) st->rto = TCP_RTO_MAX;
+}
+
+/* Window we can advertise right now: the space left in the receive
+ * buffer, scaled down by the negotiated shift. */
+static uint16_t tcp_advertised_window(sock_t * sock) {
+	struct tcp_state * st = sock->proto_private;
+	size_t avail = sock->rcvbuf > sock->rx_buffered ? sock->rcvbuf - sock->rx_buffered : 0;
+	if (st) avail >>= st->rcv_wscale;
+	if (avail > 0xFFFF) avail = 0xFFFF;
+	return avail;
+}
+
+/* The shift we ask the peer to apply to our advertised windows; just
+ * enough for the window field to span the whole receive buffer. */
+static int tcp_pick_wscale(size_t rcvbuf) {
+	int shift = 0;
+	while (shift < 14 && (rcvbuf >> shift) > 0xFFFF) shift++;
+	return shift;
+}
+
+/* Scan a SYN-ACK's option block for window scaling; returns the peer's
+ * shift, or -1 if it was not offered. */
+static int tcp_parse_wscale(struct tcp_header * tcp, size_t hlen) {
+	if (hlen <= sizeof(struct tcp_header)) return -1;
+	uint8_t * opt = (uint8_t*)tcp->payload;
+	size_t remaining = hlen - sizeof(struct tcp_header);
+	while (remaining) {
+		if (opt[0] == 0) break;                        /* End of options */
+		if (opt[0] == 1) { opt++; remaining--; continue; } /* NOP */
+		if (remaining < 2 || opt[1] < 2 || opt[1] > remaining) break;
+		if (opt[0] == 3 && opt[1] == 3) return opt[2];
+		remaining -= opt[1];
+		opt += opt[1];
+	}
+	return -1;
+}
+
+/* Every 50ms, retransmit the oldest segment of any connection whose
+ * timer has expired, doubling its timeout each time. Segments are
+ * copied under the lock and sent after it is released, since sending
+ * can sleep in ARP resolution. */
+static void tcp_retx_worker(void * argp) {
+	while (1) {
+		unsigned long s, ss;
+		relative_time(0, 50000, &s, &ss);
+		sleep_until((process_t *)this_core->current_process, s, ss);
+		switch_task(0);
+
+		struct {
+			struct ipv4_packet * packet;
+			uint32_t destination;
+		} resend[TCP_RETX_BATCH];
+		int count = 0;
+		uint64_t now = tcp_now();
+
+		spin_lock(tcp_connections_lock);
+		foreach(n, tcp_connections) {
+			if (count == TCP_RETX_BATCH) break;
+			struct tcp_state * st = n->value;
+			sock_t * sock = st->sock;
+			int wake = 0;
+			int dead = 0;
+			spin_lock(st->lock);
+			if (sock->priv[1] == 2 && st->unacked->head) {
+				struct tcp_seg * seg = st->unacked->head->value;
+				if (now - seg->sent_at >= st->rto) {
+					if (seg->retransmits++ >= TCP_RETX_LIMIT) {
+						dead = 1;
+					} else {
+						resend[count].packet = malloc(seg->total_length);
+						memcpy(resend[count].packet, seg->packet, seg->total_length);
+						resend[count].destination = seg->packet->destination;
+						count++;
+						seg->sent_at = now;
+						/* Back the timer off; this segment yields no RTT sample now. */
+						st->rto *= 2;
+						if (st->rto > TCP_RTO_MAX) st->rto = TCP_RTO_MAX;
+						wake = 1;
+					}
+				}
+			}
+			if (dead) {
+				/* Peer stopped acknowledging; drop the connection. */
+				sock->priv[1] = 0;
+				wake = 1;
+			}
+			spin_unlock(st->lock);
+			if (wake) wakeup_queue(st->ack_wait);
+			if (dead) net_sock_alert(sock);
+		}
+		spin_unlock(tcp_connections_lock);
+
+		for (int i = 0; i < count; ++i) {
+			fs_node_t * nic = net_if_route(resend[i].destination);
+			if (nic) net_ipv4_send(resend[i].packet, nic);
+			free(resend[i].packet);
+		}
+	}
+}
+
+static void tcp_state_create(sock_t * sock) {
+	struct tcp_state * st = malloc(sizeof(struct tcp_state));
+	spin_init(st->lock);
+	st->sock = sock;
+	st->unacked = list_create("tcp unacked segments", st);
+	st->ooo = list_create("tcp reassembly", st);
+	st->ack_wait = list_create("tcp ack wait", st);
+	st->snd_una = 0;
+	st->snd_wnd = DEFAULT_TCP_WINDOW_SIZE;
+	st->snd_wscale = 0;
+	st->rcv_wscale = 0;
+	st->srtt = 0;
+	st->rttvar = 0;
+	st->rto = TCP_RTO_DEFAULT;
+	st->rtt_valid = 0;
+	st->node.value = st;
+	sock->proto_private = st;
+	/* Data arrives as a byte stream from here on. */
+	net_sock_stream_init(sock);
+	spin_lock(tcp_connections_lock);
+	if (!tcp_connections) {
+		tcp_connections = list_create("tcp connections", NULL);
+		spawn_worker_thread(tcp_retx_worker, "[tcpretx]", NULL);
+	}
+	list_append(tcp_connections, &st->node);
+	spin_unlock(tcp_connections_lock);
+}
+
+static void tcp_state_destroy(sock_t * sock) {
+	struct tcp_state * st = sock->proto_private;
+	if (!st) return;
+	spin_lock(tcp_connections_lock);
+	list_delete(tcp_connections, &st->node);
+	spin_unlock(tcp_connections_lock);
+	sock->proto_private = NULL;
+	while (st->unacked->head) {
+		struct tcp_seg * seg = st->unacked->head->value;
+		list_delete(st->unacked, &seg->node);
+		tcp_seg_free(seg);
+	}
+	while (st->ooo->head) {
+		struct tcp_ooo * o = st->ooo->head->value;
+		list_delete(st->ooo, &o->node);
+		free(o->packet);
+		free(o);
+	}
+	wakeup_queue(st->ack_wait);
+	free(st->unacked);
+	free(st->ooo);
+	free(st->ack_wait);
+	free(st);
+}
+
+/* An acknowledgement arrived: retire everything it covers, sample the
+ * RTT off unretransmitted segments, and wake anyone blocked on the
+ * window. */
+static void tcp_process_ack(sock_t * sock, struct tcp_header * tcp) {
+	struct tcp_state * st = sock->proto_private;
+	if (!st) return;
+	uint32_t ack = ntohl(tcp->ack_number);
+	uint64_t now = tcp_now();
+	int advanced = 0;
+	spin_lock(st->lock);
+	st->snd_wnd = (uint32_t)ntohs(tcp->window_size) << st->snd_wscale;
+	while (st->unacked->head) {
+		struct tcp_seg * seg = st->unacked->head->value;
+		if ((int32_t)(ack - (seg->seq + seg->len)) < 0) break;
+		if (!seg->retransmits) tcp_update_rtt(st, now - seg->sent_at);
+		list_delete(st->unacked, &seg->node);
+		tcp_seg_free(seg);
+		advanced = 1;
+	}
+	if ((int32_t)(ack - st->snd_una) > 0) {
+		st->snd_una = ack;
+		advanced = 1;
+	}
+	spin_unlock(st->lock);
+	if (advanced) wakeup_queue(st->ack_wait);
+}
+
+/* Send a bare ACK reflecting the current priv32[] numbers. */
+static void tcp_send_ack_only(fs_node_t * nic, sock_t * sock, uint16_t dest_port, uint32_t dest_ip) {
+	size_t total_length = sizeof(struct ipv4_packet) + sizeof(struct tcp_header);
+
+	struct ipv4_packet * response = malloc(total_length);
+	response->length = htons(total_length);
+	response->destination = dest_ip;
+	response->source = ((struct EthernetDevice*)nic->device)->ipv4_addr;
+	response->ttl = 64;
+	response->protocol = IPV4_PROT_TCP;
+	sock->priv[2]++;
+	response->ident = htons(sock->priv[2]);
+	response->flags_fragment = htons(0x0);
+	response->version_ihl = 0x45;
+	response->dscp_ecn = 0;
+	response->checksum = 0;
+	response->checksum = htons(calculate_ipv4_checksum(response));
+
+	struct tcp_header * tcp_header = (struct tcp_header*)&response->payload;
+	tcp_header->source_port = htons(sock->priv[0]);
+	tcp_header->destination_port = dest_port;
+	tcp_header->seq_number = htonl(sock->priv32[0]);
+	tcp_header->ack_number = htonl(sock->priv32[1]);
+	tcp_header->flags = htons(TCP_FLAGS_ACK | 0x5000);
+	tcp_header->window_size = htons(tcp_advertised_window(sock));
+	tcp_header->checksum = 0;
+	tcp_header->urgent = 0;
+
+	struct tcp_check_header check_hd = {
+		.source = response->source,
+		.destination = response->destination,
+		.zeros = 0,
+		.protocol = IPV4_PROT_TCP,
+		.tcp_len = htons(sizeof(struct tcp_header)),
+	};
+
+	tcp_set_checksum(nic, &check_hd, tcp_header, NULL, 0);
+	net_ipv4_send(response, nic);
+	free(response);
+}
+
+/* Data arrived on an established connection. In-order segments go to
+ * the receive queue directly and drain whatever queued up behind them;
+ * segments from the future are stashed for reassembly; everything gets
+ * an ACK for the highest in-order point, so the sender sees duplicate
+ * ACKs for a gap instead of silence. */
+static void tcp_data_in(fs_node_t * nic, sock_t * sock, struct ipv4_packet * packet, size_t payload_len, struct pbuf * backing) {
+	struct tcp_state * st = sock->proto_private;
+	struct tcp_header * tcp = (struct tcp_header*)&packet->payload;
+	uint32_t seq = ntohl(tcp->seq_number);
+
+	if (!st) {
+		/* No reassembly state; fall back to the strict in-order path. */
+		if (tcp_ack(nic, sock, packet, 0, payload_len)) {
+			net_sock_add_backed(sock, packet, ntohs(packet->length), backing);
+		}
+		return;
+	}
+
+	spin_lock(st->lock);
+	if (seq == sock->priv32[1]) {
+		/* In order: the payload bytes go straight into the receive
+		 * ring - no list node, no frame header, and the reader is only
+		 * woken if the ring was empty. */
+		size_t hlen = ((ntohs(tcp->flags) & 0xF000) >> 12) * 4;
+		if (!net_sock_stream_write(sock, (uint8_t*)tcp + hlen, payload_len)) {
+			/* No room; don't advance, the duplicate ACK below says so. */
+			spin_unlock(st->lock);
+			tcp_send_ack_only(nic, sock, tcp->source_port, packet->source);
+			return;
+		}
+		sock->priv32[1] = (seq + payload_len) & 0xFFFFFFFF;
+		while (st->ooo->head) {
+			struct tcp_ooo * o = st->ooo->head->value;
+			int32_t diff = (int32_t)(o->seq - sock->priv32[1]);
+			if (diff > 0) break;
+			if (diff == 0) {
+				struct tcp_header * otcp = (struct tcp_header*)&o->packet->payload;
+				size_t ohlen = ((ntohs(otcp->flags) & 0xF000) >> 12) * 4;
+				if (!net_sock_stream_write(sock, (uint8_t*)otcp + ohlen, o->payload_len)) break;
+				sock->priv32[1] = (o->seq + o->payload_len) & 0xFFFFFFFF;
+			}
+			/* diff < 0 was made stale by the segments before it */
+			list_delete(st->ooo, &o->node);
+			free(o->packet);
+			free(o);
+		}
+		spin_unlock(st->lock);
+	} else if ((int32_t)(seq - sock->priv32[1]) > 0) {
+		if (st->ooo->length < TCP_OOO_LIMIT) {
+			node_t * after = NULL;
+			int have = 0;
+			foreach(n, st->ooo) {
+				struct tcp_ooo * o = n->value;
+				if (o->seq == seq) { have = 1; break; }
+				if ((int32_t)(o->seq - seq) > 0) { after = n; break; }
+			}
+			if (!have) {
+				struct tcp_ooo * o = malloc(sizeof(struct tcp_ooo));
+				o->seq = seq;
+				o->payload_len = payload_len;
+				o->size = ntohs(packet->length);
+				o->packet = malloc(o->size);
+				memcpy(o->packet, packet, o->size);
+				o->node.value = o;
+				if (after) {
+					list_append_before(st->ooo, after, &o->node);
+				} else {
+					list_append(st->ooo, &o->node);
+				}
+			}
+		}
+		spin_unlock(st->lock);
+	} else {
+		/* Already have this; the ACK below tells the sender so. */
+		spin_unlock(st->lock);
+	}
+
+	tcp_send_ack_only(nic, sock, tcp->source_port, packet->source);
+}
+
 static int tcp_ack(fs_node_t * nic, sock_t * sock, struct ipv4_packet * packet, int isSynAck, size_t payload_len) {
 	struct tcp_header * tcp = (struct tcp_header*)&packet->payload;
 	int retval = 1;
-	int window_size = DEFAULT_TCP_WINDOW_SIZE;
+	int window_size = tcp_advertised_window(sock);
 	int send_thrice = 0;
 
 #if 0
@@ -370,7 +905,7 @@ static int tcp_ack(fs_node_t * nic, sock_t * sock, struct ipv4_packet * packet,
 		.tcp_len = htons(sizeof(struct tcp_header)),
 	};
 
-	tcp_header->checksum = htons(calculate_tcp_checksum(&check_hd, tcp_header, NULL, 0));
+	tcp_set_checksum(nic, &check_hd, tcp_header, NULL, 0);
 	net_ipv4_send(response,nic);
 	if (send_thrice) {
 		net_ipv4_send(response,nic);
@@ -380,7 +915,7 @@ static int tcp_ack(fs_node_t * nic, sock_t * sock, struct ipv4_packet * packet,
 	return retval;
 }
 
-void net_ipv4_handle(struct ipv4_packet * packet, fs_node_t * nic, size_t size) {
+void net_ipv4_handle(struct ipv4_packet * packet, fs_node_t * nic, size_t size, struct pbuf * backing) {
 
 	if (size < sizeof(struct ipv4_packet)) {
 		dprintf("ipv4: Incoming packet is too small.\n");
@@ -394,22 +929,22 @@ void net_ipv4_handle(struct ipv4_packet * packet, fs_node_t * nic, size_t size)
 
 	switch (packet->protocol) {
 		case 1:
-			icmp_handle(packet, src, dest, nic);
+			icmp_handle(packet, src, dest, nic, backing);
 			break;
 		case IPV4_PROT_UDP: {
 			uint16_t dest_port = ntohs(((uint16_t*)&packet->payload)[1]);
 			printf("net: ipv4: %s: %s -> %s udp %d to %d\n", nic->name, src, dest, ntohs(((uint16_t*)&packet->payload)[0]), dest_port);
-			if (hashmap_has(udp_sockets, (void*)(uintptr_t)dest_port)) {
+			sock_t * sock = sock_table_get(&udp_table, packet->source, ((uint16_t*)&packet->payload)[0], dest_port);
+			if (sock) {
 				printf("net: udp: received and have a waiting endpoint!\n");
-				sock_t * sock = hashmap_get(udp_sockets, (void*)(uintptr_t)dest_port);
-				net_sock_add(sock, packet, ntohs(packet->length));
+				net_sock_add_backed(sock, packet, ntohs(packet->length), backing);
 			}
 			break;
 		}
 		case IPV4_PROT_TCP: {
 			uint16_t dest_port = ntohs(((uint16_t*)&packet->payload)[1]);
 			printf("net: ipv4: %s: %s -> %s tcp %d to %d\n", nic->name, src, dest, ntohs(((uint16_t*)&packet->payload)[0]), dest_port);
-			sock_t * sock = hashmap_get(tcp_sockets, (void*)(uintptr_t)dest_port);
+			sock_t * sock = sock_table_get(&tcp_table, packet->source, ((uint16_t*)&packet->payload)[0], dest_port);
 			if (sock) {
 				printf("net: tcp: received and have a waiting endpoint!\n");
 				/* What kind of packet is this? Is it something we were expecting? */
@@ -420,7 +955,22 @@ void net_ipv4_handle(struct ipv4_packet * packet, fs_node_t * nic, size_t size)
 					if ((ntohs(tcp->flags) & (TCP_FLAGS_SYN | TCP_FLAGS_ACK)) == (TCP_FLAGS_SYN | TCP_FLAGS_ACK)) {
 						printf("tcp: synack\n");
 						if (tcp_ack(nic, sock, packet, 1, 1)) {
-							net_sock_add(sock, packet, ntohs(packet->length));
+							struct tcp_state * st = sock->proto_private;
+							if (st) {
+								size_t hlen = ((ntohs(tcp->flags) & 0xF000) >> 12) * 4;
+								int wscale = tcp_parse_wscale(tcp, hlen);
+								spin_lock(st->lock);
+								st->snd_una = sock->priv32[0];
+								/* A SYN-ACK's own window field is never scaled */
+								st->snd_wnd = ntohs(tcp->window_size);
+								if (wscale >= 0) {
+									/* Both sides offered scaling; it's on */
+									st->snd_wscale = wscale > 14 ? 14 : wscale;
+									st->rcv_wscale = tcp_pick_wscale(sock->rcvbuf);
+								}
+								spin_unlock(st->lock);
+							}
+							net_sock_add_backed(sock, packet, ntohs(packet->length), backing);
 						}
 					} else if ((ntohs(tcp->flags) & (TCP_FLAGS_RST))) {
 						sock->priv[1] = 0;
@@ -430,13 +980,18 @@ void net_ipv4_handle(struct ipv4_packet * packet, fs_node_t * nic, size_t size)
 					size_t packet_len = ntohs(packet->length) - sizeof(struct ipv4_packet);
 					size_t hlen = ((ntohs(tcp->flags) & 0xF000) >> 12) * 4;
 					size_t payload_len = packet_len - hlen;
+					if (ntohs(tcp->flags) & TCP_FLAGS_ACK) {
+						tcp_process_ack(sock, tcp);
+					}
 					if (payload_len) {
-						printf("tcp: acking because payload_len = %zu (hlen=%zu, packet_len=%zu)\n", payload_len, hlen, packet_len);
-						if (tcp_ack(nic, sock, packet, 0, payload_len)) {
-							net_sock_add(sock, packet, ntohs(packet->length));
-						}
+						printf("tcp: payload_len = %zu (hlen=%zu, packet_len=%zu)\n", payload_len, hlen, packet_len);
+						tcp_data_in(nic, sock, packet, payload_len, backing);
 					} else if (ntohs(tcp->flags) & TCP_FLAGS_FIN) {
 						tcp_ack(nic, sock, packet, 0, 0);
+						/* Wake any blocked reader so it sees EOF now
+						 * rather than on its next poll timeout. */
+						wakeup_queue(sock->rx_wait);
+						net_sock_alert(sock);
 					}
 				}
 			}
@@ -451,9 +1006,10 @@ static int next_port = 12345;
 static int udp_get_port(sock_t * sock) {
 	spin_lock(udp_port_lock);
 	int out = next_port++;
-	hashmap_set(udp_sockets, (void*)(uintptr_t)out, sock);
 	sock->priv[0] = out;
 	spin_unlock(udp_port_lock);
+	/* UDP sockets receive from any peer; bind with a wildcard remote. */
+	sock_table_insert(&udp_table, sock, 0, 0, out);
 	return out;
 }
 
@@ -537,16 +1093,15 @@ static long sock_udp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	printf("udp: data copied to iov 0, return length?\n");
 
 	long resp = ntohs(data->length) - sizeof(struct ipv4_packet) - sizeof(struct udp_packet);
-	free(packet);
+	sock_attach_timestamp(sock, msg, packet);
+	net_sock_free(packet);
 	return resp;
 }
 
 static void sock_udp_close(sock_t * sock) {
 	if (sock->priv[0]) {
 		printf("udp: removing port %d from bound map\n", sock->priv[0]);
-		spin_lock(udp_port_lock);
-		hashmap_remove(udp_sockets, (void*)(uintptr_t)sock->priv[0]);
-		spin_unlock(udp_port_lock);
+		sock_table_remove(&udp_table, sock, 0, 0, sock->priv[0]);
 	}
 }
 
@@ -558,12 +1113,12 @@ static long sock_udp_bind(sock_t * sock, const struct sockaddr *addr, socklen_t
 	const struct sockaddr_in * addr_in = (const struct sockaddr_in *)addr;
 	int port = ntohs(addr_in->sin_port);
 	spin_lock(udp_port_lock);
-	if (hashmap_has(udp_sockets, (void*)(uintptr_t)port)) {
+	if (sock_table_get(&udp_table, 0, 0, port)) {
 		spin_unlock(udp_port_lock);
 		return -EADDRINUSE;
 	}
-	hashmap_set(udp_sockets, (void*)(uintptr_t)port, sock);
 	sock->priv[0] = port;
+	sock_table_insert(&udp_table, sock, 0, 0, port);
 	spin_unlock(udp_port_lock);
 
 	/* Totally ignore the NIC stuff */
@@ -585,13 +1140,17 @@ static spin_lock_t tcp_port_lock = {0};
 static void sock_tcp_close(sock_t * sock) {
 	if (sock->priv[0]) {
 		printf("tcp: removing port %d from bound map\n", sock->priv[0]);
-		spin_lock(tcp_port_lock);
-		hashmap_remove(tcp_sockets, (void*)(uintptr_t)sock->priv[0]);
-		spin_unlock(tcp_port_lock);
+		sock_table_remove(&tcp_table, sock,
+			((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr,
+			((struct sockaddr_in*)&sock->dest)->sin_port,
+			sock->priv[0]);
 
 		size_t total_length = sizeof(struct ipv4_packet) + sizeof(struct tcp_header);
 		fs_node_t * nic = net_if_route(((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr);
-		if (!nic) return;
+		if (!nic) {
+			tcp_state_destroy(sock);
+			return;
+		}
 
 		struct ipv4_packet * response = malloc(total_length);
 		response->length = htons(total_length);
@@ -614,7 +1173,7 @@ static void sock_tcp_close(sock_t * sock) {
 		tcp_header->seq_number = htonl(sock->priv32[0]);
 		tcp_header->ack_number = htonl(sock->priv32[1]);
 		tcp_header->flags = htons(TCP_FLAGS_FIN | TCP_FLAGS_ACK | 0x5000);
-		tcp_header->window_size = htons(DEFAULT_TCP_WINDOW_SIZE);
+		tcp_header->window_size = htons(tcp_advertised_window(sock));
 		tcp_header->checksum = 0;
 		tcp_header->urgent = 0;
 
@@ -627,17 +1186,17 @@ static void sock_tcp_close(sock_t * sock) {
 			.tcp_len = htons(sizeof(struct tcp_header)),
 		};
 
-		tcp_header->checksum = htons(calculate_tcp_checksum(&check_hd, tcp_header, tcp_header->payload, 0));
+		tcp_set_checksum(nic, &check_hd, tcp_header, tcp_header->payload, 0);
 		net_ipv4_send(response,nic);
 		free(response);
 	}
+	tcp_state_destroy(sock);
 }
 
 static int next_tcp_port = 49152;
 static int tcp_get_port(sock_t * sock) {
 	spin_lock(tcp_port_lock);
 	int out = next_tcp_port++;
-	hashmap_set(tcp_sockets, (void*)(uintptr_t)out, sock);
 	sock->priv[0] = out;
 	spin_unlock(tcp_port_lock);
 	return out;
@@ -655,66 +1214,16 @@ static long sock_tcp_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	}
 	if (msg->msg_iovlen == 0) return 0;
 
-	if (sock->unread) {
-		if (sock->unread > msg->msg_iov[0].iov_len) {
-			unsigned long out = msg->msg_iov[0].iov_len;
-			sock->unread -= out;
-			memcpy(msg->msg_iov[0].iov_base, sock->buf, out);
-			char * x = malloc(sock->unread);
-			memcpy(x, sock->buf + out, sock->unread);
-			free(sock->buf);
-			sock->buf = x;
-			return out;
-		} else {
-			unsigned long out = sock->unread;
-			sock->unread = 0;
-			memcpy(msg->msg_iov[0].iov_base, sock->buf, out);
-			free(sock->buf);
-			sock->buf = NULL;
-			return out;
+	/* Data accumulates in the receive ring; one pass here can drain
+	 * what took many segments to arrive. */
+	while (!sock->rx_buffered) {
+		if (sock->priv[1] == 3 || sock->priv[1] == 0) {
+			return 0; /* EOF: peer closed, or the connection died */
 		}
-	}
-
-	if (!sock->rx_queue->length && sock->priv[1] == 3) {
-		return 0; /* EOF */
-	}
-
-	while (!sock->rx_queue->length) {
 		process_wait_nodes((process_t *)this_core->current_process, (fs_node_t*[]){(fs_node_t*)sock,NULL}, 200);
 	}
 
-	char * packet = net_sock_get(sock);
-	if (!packet) return -EINTR;
-	struct ipv4_packet * data = (struct ipv4_packet*)(packet + sizeof(size_t));
-	size_t packet_size = *(size_t*)packet;
-	unsigned long resp = ntohs(data->length);
-
-	if (resp != packet_size) {
-		dprintf("packet size does not match: %zu %zu\n", resp, packet_size);
-		resp = packet_size;
-	}
-
-	if (resp < sizeof(struct ipv4_packet) + sizeof(struct tcp_header)) {
-		dprintf("Invalid receive data?\n");
-		assert(0);
-	}
-
-	resp -=  sizeof(struct ipv4_packet) + sizeof(struct tcp_header);
-
-	if (resp > (unsigned long)msg->msg_iov[0].iov_len) {
-		memcpy(msg->msg_iov[0].iov_base, data->payload + sizeof(struct tcp_header),msg->msg_iov[0].iov_len);
-		resp -= msg->msg_iov[0].iov_len;
-		if (resp == 0xFFFFffffFFFFffff) printf("what\n");
-		sock->unread = resp;
-		sock->buf = malloc(resp);
-		memcpy(sock->buf, data->payload + sizeof(struct tcp_header) + msg->msg_iov[0].iov_len, resp);
-		free(packet);
-		return msg->msg_iov[0].iov_len;
-	}
-
-	memcpy(msg->msg_iov[0].iov_base, data->payload + sizeof(struct tcp_header), resp);
-	free(packet);
-	return resp;
+	return net_sock_stream_read(sock, msg->msg_iov[0].iov_base, msg->msg_iov[0].iov_len);
 }
 
 extern uint32_t rand(void);
@@ -730,19 +1239,27 @@ static long sock_tcp_connect(sock_t * sock, const struct sockaddr *addr, socklen
 		return -EINVAL;
 	}
 
-	/* Get a port */
+	memcpy(&sock->dest, addr, addrlen);
+
+	/* Get a port, and enter the connection under its full tuple so
+	 * other connections can share the local port. */
 	tcp_get_port(sock);
+	sock_table_insert(&tcp_table, sock, dest->sin_addr.s_addr, dest->sin_port, sock->priv[0]);
 	printf("tcp: connecting from ephemeral port %d\n", (int)sock->priv[0]);
 
+	/* Window and retransmission state for the life of the connection */
+	tcp_state_create(sock);
+
 	/* Mark as awaiting connection, send initial SYN */
 	sock->priv[1] = 1;
 
-	memcpy(&sock->dest, addr, addrlen);
-
 	fs_node_t * nic = net_if_route(dest->sin_addr.s_addr);
 	if (!nic) return -ENONET;
 
-	size_t total_length = sizeof(struct ipv4_packet) + sizeof(struct tcp_header);
+	/* The SYN carries a window scale offer (RFC 7323); a NOP pads the
+	 * option block out to a word. */
+	uint8_t syn_options[4] = { 1, 3, 3, tcp_pick_wscale(sock->rcvbuf) };
+	size_t total_length = sizeof(struct ipv4_packet) + sizeof(struct tcp_header) + sizeof(syn_options);
 
 	struct ipv4_packet * response = malloc(total_length);
 	response->length = htons(total_length);
@@ -764,10 +1281,11 @@ static long sock_tcp_connect(sock_t * sock, const struct sockaddr *addr, socklen
 	tcp_header->destination_port = dest->sin_port;
 	tcp_header->seq_number = 0;
 	tcp_header->ack_number = 0;
-	tcp_header->flags = htons((1 << 1) | 0x5000);
-	tcp_header->window_size = htons(DEFAULT_TCP_WINDOW_SIZE);
+	tcp_header->flags = htons((1 << 1) | (0x6 << 12));
+	tcp_header->window_size = htons(tcp_advertised_window(sock));
 	tcp_header->checksum = 0;
 	tcp_header->urgent = 0;
+	memcpy(tcp_header->payload, syn_options, sizeof(syn_options));
 
 	/* Calculate checksum */
 	struct tcp_check_header check_hd = {
@@ -775,10 +1293,10 @@ static long sock_tcp_connect(sock_t * sock, const struct sockaddr *addr, socklen
 		.destination = response->destination,
 		.zeros = 0,
 		.protocol = IPV4_PROT_TCP,
-		.tcp_len = htons(sizeof(struct tcp_header)),
+		.tcp_len = htons(sizeof(struct tcp_header) + sizeof(syn_options)),
 	};
 
-	tcp_header->checksum = htons(calculate_tcp_checksum(&check_hd, tcp_header, NULL, 0));
+	tcp_set_checksum(nic, &check_hd, tcp_header, tcp_header->payload, sizeof(syn_options));
 
 	net_ipv4_send(response,nic);
 
@@ -818,7 +1336,7 @@ static long sock_tcp_connect(sock_t * sock, const struct sockaddr *addr, socklen
 	if (!packet) return -EINTR;
 	//struct ipv4_packet * data = packet + sizeof(size_t);
 	printf("tcp: connect complete\n");
-	free(packet);
+	net_sock_free(packet);
 
 	return 0;
 }
@@ -840,13 +1358,6 @@ ssize_t sock_tcp_read(fs_node_t *node, off_t offset, size_t size, uint8_t *buffe
 	return sock_tcp_recv((sock_t*)node, &_header, 0);
 }
 
-static void delay_yield(size_t subticks) {
-	unsigned long s, ss;
-	relative_time(0, subticks, &s, &ss);
-	sleep_until((process_t *)this_core->current_process, s, ss);
-	switch_task(0);
-}
-
 static long sock_tcp_send(sock_t * sock, const struct msghdr *msg, int flags) {
 	printf("tcp: send called\n");
 	if (msg->msg_iovlen > 1) {
@@ -855,74 +1366,149 @@ static long sock_tcp_send(sock_t * sock, const struct msghdr *msg, int flags) {
 	}
 	if (msg->msg_iovlen == 0) return 0;
 
+	struct tcp_state * st = sock->proto_private;
 	size_t size_into = 0;
 	size_t size_remaining = msg->msg_iov[0].iov_len;
 
-	size_t last = arch_perf_timer();
+	fs_node_t * nic = net_if_route(((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr);
+	if (!nic) return -ENONET;
+	struct EthernetDevice * enic = nic->device;
+
+	/* The headers are identical from one segment to the next apart from
+	 * the lengths, sequence numbers and the ident; build them once and
+	 * patch those fields per segment instead of refilling every field
+	 * each time around the loop. */
+	uint8_t tmpl[sizeof(struct ipv4_packet) + sizeof(struct tcp_header)] __attribute__((aligned(4)));
+	struct ipv4_packet * tmpl_ip = (struct ipv4_packet *)tmpl;
+	struct tcp_header * tmpl_tcp = (struct tcp_header *)tmpl_ip->payload;
+	tmpl_ip->destination = ((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr;
+	tmpl_ip->source = enic->ipv4_addr;
+	tmpl_ip->ttl = 64;
+	tmpl_ip->protocol = IPV4_PROT_TCP;
+	tmpl_ip->flags_fragment = htons(0x0);
+	tmpl_ip->version_ihl = 0x45;
+	tmpl_ip->dscp_ecn = 0;
+	tmpl_tcp->source_port = htons(sock->priv[0]);
+	tmpl_tcp->destination_port = ((struct sockaddr_in*)&sock->dest)->sin_port;
+	tmpl_tcp->flags = htons(TCP_FLAGS_PSH | TCP_FLAGS_ACK | 0x5000);
+	tmpl_tcp->urgent = 0;
+
+	/* The pseudo-header only ever changes in its length field. */
+	struct tcp_check_header check_hd = {
+		.source = tmpl_ip->source,
+		.destination = tmpl_ip->destination,
+		.zeros = 0,
+		.protocol = IPV4_PROT_TCP,
+	};
+
+	/* When the device can transmit from a pool buffer and the next hop
+	 * is already resolved, segments are assembled directly in the
+	 * memory the device DMAs from: the payload is copied exactly once,
+	 * out of the caller's buffer, and the same buffer is what the
+	 * retransmission queue retains. Otherwise (loopback, unresolved
+	 * ARP, exhausted pool) each segment takes the old heap path. */
+	struct ArpCacheEntry * arp = NULL;
+	if (!enic->loopback && enic->send_pbuf) {
+		uint32_t ipdest = tmpl_ip->destination;
+		if (!enic->ipv4_subnet || ((ipdest & enic->ipv4_subnet) != (enic->ipv4_addr & enic->ipv4_subnet))) {
+			ipdest = enic->ipv4_gateway;
+		}
+		arp = net_arp_cache_get(ipdest);
+	}
+
 	while (size_remaining) {
-		size_t size_to_send = size_remaining > 1024 ? 1024 : size_remaining;
+		size_t size_to_send = size_remaining > TCP_MSS ? TCP_MSS : size_remaining;
 		size_t total_length = sizeof(struct ipv4_packet) + sizeof(struct tcp_header) + size_to_send;
 
-		fs_node_t * nic = net_if_route(((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr);
-		if (!nic) return -ENONET;
+		/* Back off while the interface queue is deep, rather than
+		 * stacking every window's worth of segments in it at once; the
+		 * transmit worker wakes us as it drains batches. */
+		while (net_if_tx_backlog(enic) > TCP_TSQ_LIMIT) {
+			net_if_tx_drain_wait(enic);
+		}
 
-		struct ipv4_packet * response = malloc(total_length);
+		if (st) {
+			/* Block while the window is full; ACK processing and the
+			 * retransmission timer wake us. With nothing in flight we
+			 * always send one segment, so a zero window from the peer
+			 * still gets probed rather than deadlocking. */
+			spin_lock(st->lock);
+			while (sock->priv[1] == 2) {
+				uint32_t in_flight = sock->priv32[0] - st->snd_una;
+				uint32_t window = st->snd_wnd > sock->sndbuf ? sock->sndbuf : st->snd_wnd;
+				if (!in_flight || in_flight + size_to_send <= window) break;
+				sleep_on_unlocking(st->ack_wait, &st->lock);
+				spin_lock(st->lock);
+			}
+			int alive = (sock->priv[1] == 2);
+			spin_unlock(st->lock);
+			if (!alive) return size_into ? (long)size_into : -ECONNRESET;
+		}
+
+		struct pbuf * p = NULL;
+		struct ipv4_packet * response = NULL;
+		if (arp) {
+			void * l3 = NULL;
+			p = net_eth_pbuf_prepare(&l3, total_length);
+			response = l3;
+		}
+		if (!response) {
+			p = NULL;
+			response = malloc(total_length);
+		}
+
+		memcpy(response, tmpl, sizeof(tmpl));
 		response->length = htons(total_length);
-		response->destination = ((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr;
-		response->source = ((struct EthernetDevice*)nic->device)->ipv4_addr;
-		response->ttl = 64;
-		response->protocol = IPV4_PROT_TCP;
 		sock->priv[2]++;
 		response->ident = htons(sock->priv[2]);
-		response->flags_fragment = htons(0x0);
-		response->version_ihl = 0x45;
-		response->dscp_ecn = 0;
 		response->checksum = 0;
 		response->checksum = htons(calculate_ipv4_checksum(response));
 
-		/* Stick TCP header into payload */
 		struct tcp_header * tcp_header = (struct tcp_header*)&response->payload;
-		tcp_header->source_port = htons(sock->priv[0]);
-		tcp_header->destination_port = ((struct sockaddr_in*)&sock->dest)->sin_port;
 		tcp_header->seq_number = htonl(sock->priv32[0]);
 		tcp_header->ack_number = htonl(sock->priv32[1]);
-		tcp_header->flags = htons(TCP_FLAGS_PSH | TCP_FLAGS_ACK | 0x5000);
-		tcp_header->window_size = htons(DEFAULT_TCP_WINDOW_SIZE);
+		tcp_header->window_size = htons(tcp_advertised_window(sock));
 		tcp_header->checksum = 0;
-		tcp_header->urgent = 0;
 
 		sock->priv32[0] += size_to_send;
 
-		/* Calculate checksum */
-		struct tcp_check_header check_hd = {
-			.source = response->source,
-			.destination = response->destination,
-			.zeros = 0,
-			.protocol = IPV4_PROT_TCP,
-			.tcp_len = htons(sizeof(struct tcp_header) + size_to_send),
-		};
-
+		check_hd.tcp_len = htons(sizeof(struct tcp_header) + size_to_send);
 		memcpy(tcp_header->payload, (char*)msg->msg_iov[0].iov_base + size_into, size_to_send);
-		tcp_header->checksum = htons(calculate_tcp_checksum(&check_hd, tcp_header, tcp_header->payload, size_to_send));
-		net_ipv4_send(response,nic);
-		free(response);
-
-		size_remaining -= size_to_send;
-		size_into += size_to_send;
+		tcp_set_checksum(nic, &check_hd, tcp_header, tcp_header->payload, size_to_send);
+
+		if (st) {
+			/* Queue before sending, so the ACK can't beat us to it. The
+			 * packet is kept until acknowledged in case it needs to go
+			 * out again. */
+			struct tcp_seg * seg = malloc(sizeof(struct tcp_seg));
+			seg->seq = ntohl(tcp_header->seq_number);
+			seg->len = size_to_send;
+			seg->sent_at = tcp_now();
+			seg->retransmits = 0;
+			seg->total_length = total_length;
+			seg->packet = response;
+			seg->pbuf = p;
+			if (p) pbuf_ref(p);
+			seg->node.value = seg;
+			spin_lock(st->lock);
+			list_append(st->unacked, &seg->node);
+			spin_unlock(st->lock);
+		}
 
-		if (size_remaining) {
-			/* Keep us away from the BSP... */
-			if (processor_count > 1) {
-				if (this_core->cpu_id == 0) {
-					delay_yield(0);
-				}
-			} else {
-				if (arch_perf_timer() - last > 10000UL * arch_cpu_mhz()) {
-					delay_yield(0);
-					last = arch_perf_timer();
-				}
+		if (p) {
+			size_t cs = 0, co = 0;
+			if (enic->hw_csum) {
+				cs = sizeof(struct ipv4_packet);
+				co = sizeof(struct ipv4_packet) + 16; /* the checksum field within the TCP header */
 			}
+			net_eth_pbuf_send(enic, p, total_length, ETHERNET_TYPE_IPV4, arp->hwaddr, cs, co);
+		} else {
+			net_ipv4_send(response, nic);
+			if (!st) free(response);
 		}
+
+		size_remaining -= size_to_send;
+		size_into += size_to_send;
 	}
 
 	return size_into;
@@ -974,3 +1560,44 @@ long net_ipv4_socket(int type, int protocol) {
 			return -EINVAL;
 	}
 }
+
+/**
+ * @brief Describe every TCP connection for /proc/net/tcp.
+ *
+ * One line per connection: endpoints, state, what is in flight against
+ * the peer's window, the RTT estimate and retransmission timer, and how
+ * much received data is waiting to be read. All the numbers a printf in
+ * here used to be the only way to see.
+ */
+size_t net_tcp_procfs(char * buf, size_t avail) {
+	size_t len = 0;
+	len += snprintf(buf, avail,
+		"Local  Remote                 State  InFlight  Window  Unacked  SRTT(ms)  RTO(ms)  RxQueued\n");
+	if (!tcp_connections) return len;
+	spin_lock(tcp_connections_lock);
+	foreach(n, tcp_connections) {
+		struct tcp_state * st = n->value;
+		sock_t * sock = st->sock;
+		char remote[24];
+		char dest[16];
+		ip_ntoa(ntohl(((struct sockaddr_in*)&sock->dest)->sin_addr.s_addr), dest);
+		snprintf(remote, 24, "%s:%d", dest, ntohs(((struct sockaddr_in*)&sock->dest)->sin_port));
+		const char * state =
+			sock->priv[1] == 1 ? "SYN" :
+			sock->priv[1] == 2 ? "ESTAB" :
+			sock->priv[1] == 3 ? "CLOSED" : "NEW";
+		spin_lock(st->lock);
+		uint32_t in_flight = sock->priv32[0] - st->snd_una;
+		size_t line = snprintf(buf + len, avail > len ? avail - len : 0,
+			"%-6d %-22s %-6s %-9u %-7u %-8zu %-9lu %-8lu %zu\n",
+			sock->priv[0], remote, state,
+			in_flight, st->snd_wnd, (size_t)st->unacked->length,
+			(unsigned long)(st->srtt / 1000), (unsigned long)(st->rto / 1000),
+			sock->rx_buffered);
+		spin_unlock(st->lock);
+		len += line;
+		if (len >= avail) break;
+	}
+	spin_unlock(tcp_connections_lock);
+	return len > avail ? avail : len;
+}
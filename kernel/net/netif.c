@@ -15,8 +15,14 @@
 #include <kernel/printf.h>
 #include <kernel/spinlock.h>
 #include <kernel/hashmap.h>
+#include <kernel/flatmap.h>
+#include <kernel/process.h>
 #include <kernel/net/netif.h>
+#include <kernel/net/eth.h>
+#include <kernel/net/pbuf.h>
+#include <kernel/time.h>
 
+#include <net/if.h>
 #include <errno.h>
 
 static hashmap_t * interfaces = NULL;
@@ -25,19 +31,293 @@ static fs_node_t * _if_first = NULL;
 static fs_node_t * _if_loop = NULL;
 
 extern void ipv4_install(void);
-extern hashmap_t * net_arp_cache;
+extern flatmap_t * net_arp_cache;
 
 extern fs_node_t * loopbook_install(void);
 
+static void net_procfs_install(void);
+static void netif_state_install(void);
+
 void net_install(void) {
 	/* Set up virtual devices */
 	map_vfs_directory("/dev/net");
 	interfaces = hashmap_create(10);
 	net_raw_sockets_list = list_create("raw sockets", NULL);
-	net_arp_cache = hashmap_create_int(10);
+	net_arp_cache = flatmap_create(32);
 	ipv4_install();
 	_if_loop = loopbook_install();
 	_if_first = NULL;
+	net_procfs_install();
+	netif_state_install();
+}
+
+/**
+ * Per-interface transmit queues.
+ *
+ * Senders stage frames here instead of writing into the device from
+ * their own context; a single worker thread pushes them into the
+ * driver in batches. Only the worker ever takes the device's transmit
+ * locks, so any number of processes can enqueue without contending on
+ * the NIC, and a full descriptor ring stalls the worker rather than a
+ * user process holding protocol locks.
+ */
+
+/* Bytes a queue may hold before further frames are dropped. Stream
+ * protocols are expected to watch the backlog and back off first. */
+#define NETIF_TXQ_MAX 0x100000
+
+struct txq_entry {
+	struct pbuf * p;   /* pool buffer, with its reference; or */
+	void * frame;      /* heap frame, freed after the device write */
+	size_t size;
+};
+
+struct netif_txq {
+	struct EthernetDevice * nic;
+	spin_lock_t lock;
+	list_t * frames;
+	list_t * drain_wait;  /* senders backing off; woken per batch */
+	size_t queued_bytes;
+	size_t dropped;
+};
+
+static list_t * netif_tx_ifaces = NULL;
+static list_t * netif_tx_work = NULL;
+static spin_lock_t netif_tx_sleep_lock = {0};
+static volatile size_t netif_tx_pending = 0;
+
+static void netif_tx_transmit(struct netif_txq * txq, struct txq_entry * entry) {
+	if (entry->p) {
+		txq->nic->send_pbuf(txq->nic, entry->p, entry->size);
+	} else {
+		write_fs(txq->nic->device_node, 0, entry->size, entry->frame);
+		free(entry->frame);
+	}
+	free(entry);
+}
+
+static void netif_tx_worker(void * argp) {
+	while (1) {
+		int busy = 0;
+		foreach(ifnode, netif_tx_ifaces) {
+			struct netif_txq * txq = ifnode->value;
+
+			/* Claim the whole backlog in one lock acquisition and
+			 * transmit it with the queue unlocked. */
+			spin_lock(txq->lock);
+			node_t * batch = txq->frames->head;
+			txq->frames->head = txq->frames->tail = NULL;
+			txq->frames->length = 0;
+			txq->queued_bytes = 0;
+			spin_unlock(txq->lock);
+			if (!batch) continue;
+
+			busy = 1;
+			size_t count = 0;
+			while (batch) {
+				node_t * next = batch->next;
+				netif_tx_transmit(txq, batch->value);
+				free(batch);
+				batch = next;
+				count++;
+			}
+
+			spin_lock(netif_tx_sleep_lock);
+			netif_tx_pending -= count;
+			spin_unlock(netif_tx_sleep_lock);
+
+			wakeup_queue(txq->drain_wait);
+		}
+
+		if (!busy) {
+			/* The pending count is checked under the same lock enqueuers
+			 * bump it under, so a frame can't slip in unseen between the
+			 * check and the sleep. */
+			spin_lock(netif_tx_sleep_lock);
+			if (netif_tx_pending) {
+				spin_unlock(netif_tx_sleep_lock);
+				continue;
+			}
+			sleep_on_unlocking(netif_tx_work, &netif_tx_sleep_lock);
+		}
+	}
+}
+
+void net_if_tx_enqueue(struct EthernetDevice * nic, struct pbuf * p, void * frame, size_t size) {
+	struct netif_txq * txq = nic->txq;
+	if (!txq) {
+		/* No queue (loopback): transmit inline as before. */
+		if (p) {
+			nic->send_pbuf(nic, p, size);
+		} else {
+			write_fs(nic->device_node, 0, size, frame);
+			free(frame);
+		}
+		return;
+	}
+
+	spin_lock(txq->lock);
+	if (txq->queued_bytes + size > NETIF_TXQ_MAX) {
+		txq->dropped++;
+		spin_unlock(txq->lock);
+		if (p) pbuf_unref(p);
+		else free(frame);
+		return;
+	}
+	struct txq_entry * entry = malloc(sizeof(struct txq_entry));
+	entry->p = p;
+	entry->frame = frame;
+	entry->size = size;
+	list_insert(txq->frames, entry);
+	txq->queued_bytes += size;
+	spin_unlock(txq->lock);
+
+	spin_lock(netif_tx_sleep_lock);
+	netif_tx_pending++;
+	wakeup_queue(netif_tx_work);
+	spin_unlock(netif_tx_sleep_lock);
+}
+
+size_t net_if_tx_backlog(struct EthernetDevice * nic) {
+	return nic->txq ? nic->txq->queued_bytes : 0;
+}
+
+void net_if_tx_drain_wait(struct EthernetDevice * nic) {
+	struct netif_txq * txq = nic->txq;
+	if (!txq) return;
+	spin_lock(txq->lock);
+	if (!txq->queued_bytes) {
+		spin_unlock(txq->lock);
+		return;
+	}
+	sleep_on_unlocking(txq->drain_wait, &txq->lock);
+}
+
+/**
+ * /proc/net: runtime visibility into the network stack.
+ *
+ * netif holds one block per registered interface - driver counters,
+ * transmit queue depth and drops, and descriptor ring occupancy; tcp
+ * has one line per TCP connection, produced by the TCP layer.
+ */
+extern size_t net_tcp_procfs(char * buf, size_t avail);
+
+static size_t net_procfs_netif(char * buf, size_t avail) {
+	size_t len = 0;
+	if (!netif_tx_ifaces) return 0;
+	foreach(ifnode, netif_tx_ifaces) {
+		struct netif_txq * txq = ifnode->value;
+		struct EthernetDevice * nic = txq->nic;
+		netif_counters_t counts = {0};
+		ioctl_fs(nic->device_node, SIOCGIFCOUNTS, &counts);
+		spin_lock(txq->lock);
+		size_t q_frames = txq->frames->length;
+		size_t q_bytes  = txq->queued_bytes;
+		size_t q_drops  = txq->dropped;
+		spin_unlock(txq->lock);
+		len += snprintf(buf + len, avail > len ? avail - len : 0,
+			"%s:\n"
+			"  rx packets %zu bytes %zu dropped %zu\n"
+			"  tx packets %zu bytes %zu dropped %zu\n"
+			"  txqueue frames %zu bytes %zu dropped %zu\n"
+			"  txring used %zu of %zu\n",
+			nic->if_name,
+			counts.rx_count, counts.rx_bytes, counts.rx_dropped,
+			counts.tx_count, counts.tx_bytes, counts.tx_dropped,
+			q_frames, q_bytes, q_drops,
+			counts.tx_ring_used, counts.tx_ring_size);
+		if (len >= avail) break;
+	}
+	return len > avail ? avail : len;
+}
+
+static ssize_t read_net_procfs(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	char * buf = malloc(4096);
+	size_t _bsize = node->inode ? net_tcp_procfs(buf, 4096) : net_procfs_netif(buf, 4096);
+
+	if ((size_t)offset > _bsize) {
+		free(buf);
+		return 0;
+	}
+	if (size > _bsize - offset) size = _bsize - offset;
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+
+static fs_node_t * net_procfs_node(const char * name, int selector) {
+	fs_node_t * fnode = malloc(sizeof(fs_node_t));
+	memset(fnode, 0x00, sizeof(fs_node_t));
+	snprintf(fnode->name, 100, "%s", name);
+	fnode->inode = selector;
+	fnode->mask  = 0444;
+	fnode->flags = FS_FILE;
+	fnode->read  = read_net_procfs;
+	fnode->ctime = now();
+	fnode->mtime = now();
+	fnode->atime = now();
+	return fnode;
+}
+
+static void net_procfs_install(void) {
+	map_vfs_directory("/proc/net");
+	vfs_mount("/proc/net/netif", net_procfs_node("netif", 0));
+	vfs_mount("/proc/net/tcp",   net_procfs_node("tcp", 1));
+}
+
+/**
+ * /dev/netstate: interface state change notifications.
+ *
+ * Drivers report link, address, and interface-set changes through
+ * net_if_state_changed(), so a monitor can sit in fswait on this node
+ * and be woken instead of polling interface flags on a timer. Reads
+ * return a monotonically increasing generation count and mark it seen,
+ * which rearms the node. The seen mark is global, so this is a
+ * single-consumer device - in practice, the desktop panel.
+ */
+static fs_node_t * netif_state_node = NULL;
+static fswait_queue_t netif_state_alert;
+static volatile uint64_t netif_state_gen = 1;
+static uint64_t netif_state_seen = 0;
+
+void net_if_state_changed(void) {
+	if (!netif_state_node) return;
+	netif_state_gen++;
+	fswait_queue_alert(&netif_state_alert, netif_state_node);
+}
+
+static ssize_t netif_state_read(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	uint64_t gen = netif_state_gen;
+	netif_state_seen = gen;
+	if (size > sizeof(gen)) size = sizeof(gen);
+	memcpy(buffer, &gen, size);
+	return size;
+}
+
+static int netif_state_check(fs_node_t * node) {
+	return (netif_state_gen != netif_state_seen) ? 0 : 1;
+}
+
+static int netif_state_wait(fs_node_t * node, void * process) {
+	fswait_queue_wait(&netif_state_alert, process, netif_state_node);
+	return 0;
+}
+
+static void netif_state_install(void) {
+	fswait_queue_init(&netif_state_alert, "netif state alert", NULL);
+	fs_node_t * fnode = malloc(sizeof(fs_node_t));
+	memset(fnode, 0x00, sizeof(fs_node_t));
+	snprintf(fnode->name, 100, "netstate");
+	fnode->mask  = 0444;
+	fnode->flags = FS_CHARDEVICE;
+	fnode->read  = netif_state_read;
+	fnode->selectcheck = netif_state_check;
+	fnode->selectwait  = netif_state_wait;
+	fnode->ctime = now();
+	fnode->mtime = now();
+	fnode->atime = now();
+	netif_state_node = fnode;
+	vfs_mount("/dev/netstate", fnode);
 }
 
 /* kinda temporary for now */
@@ -50,6 +330,26 @@ int net_add_interface(const char * name, fs_node_t * deviceNode) {
 
 	if (!_if_first) _if_first = deviceNode;
 
+	/* Give the interface a transmit queue and make sure the worker
+	 * that drains them is running. */
+	struct EthernetDevice * nic = deviceNode->device;
+	struct netif_txq * txq = calloc(sizeof(struct netif_txq), 1);
+	txq->nic = nic;
+	txq->frames = list_create("netif tx frames", txq);
+	txq->drain_wait = list_create("netif tx drain wait", txq);
+	nic->txq = txq;
+
+	if (!netif_tx_ifaces) {
+		netif_tx_ifaces = list_create("netif tx interfaces", NULL);
+		netif_tx_work = list_create("netif tx work", NULL);
+		list_insert(netif_tx_ifaces, txq);
+		spawn_worker_thread(netif_tx_worker, "[nettx]", NULL);
+	} else {
+		list_insert(netif_tx_ifaces, txq);
+	}
+
+	net_if_state_changed();
+
 	return 0;
 }
 
@@ -0,0 +1,82 @@
+/**
+ * @file  kernel/net/pbuf.c
+ * @brief Pooled, refcounted network packet buffers.
+ *
+ * Receive used to mean a malloc and a copy out of the NIC's descriptor
+ * ring and another malloc and copy into each listening socket's queue;
+ * at high packet rates everything serialized on the heap lock. These
+ * buffers are handed to the NIC to DMA into directly and then travel up
+ * the stack by reference: the driver swaps a fresh buffer into the ring,
+ * the socket layer takes a reference instead of a copy, and the buffer
+ * returns to the pool when the last holder drops it.
+ *
+ * See kernel/net/pbuf.h for the layout that makes this work.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/spinlock.h>
+#include <kernel/list.h>
+#include <kernel/process.h>
+#include <kernel/mmu.h>
+#include <kernel/counters.h>
+#include <kernel/net/pbuf.h>
+
+/* Upper bound on pool growth: 8MiB of packet buffers. Each e1000
+ * receive ring keeps 512 of these pinned. */
+#define PBUF_MAX_BUFFERS 2048
+
+static list_t * pbuf_pool = NULL;
+static spin_lock_t pbuf_lock = {0};
+static size_t pbuf_count = 0;
+
+struct pbuf * pbuf_alloc(void) {
+	spin_lock(pbuf_lock);
+	if (pbuf_pool && pbuf_pool->head) {
+		struct pbuf * p = pbuf_pool->head->value;
+		list_delete(pbuf_pool, &p->node);
+		spin_unlock(pbuf_lock);
+		p->refcount = 1;
+		p->size = 0;
+		p->csum_start = 0;
+		p->csum_offset = 0;
+		counter_bump(COUNTER_PBUF_ALLOC);
+		return p;
+	}
+	if (pbuf_count >= PBUF_MAX_BUFFERS) {
+		spin_unlock(pbuf_lock);
+		return NULL;
+	}
+	if (!pbuf_pool) pbuf_pool = list_create("pbuf pool", NULL);
+	pbuf_count++;
+	spin_unlock(pbuf_lock);
+
+	/* One frame per buffer; the physical window mapping keeps the
+	 * virtual address page-aligned so PBUF_FROM_POINTER works. */
+	uintptr_t frame = mmu_allocate_a_frame() << 12;
+	struct pbuf * p = mmu_map_from_physical(frame);
+	p->refcount = 1;
+	p->size = 0;
+	p->csum_start = 0;
+	p->csum_offset = 0;
+	p->phys = frame + PBUF_DATA_OFFSET;
+	p->node.value = p;
+	counter_bump(COUNTER_PBUF_ALLOC);
+	return p;
+}
+
+void pbuf_ref(struct pbuf * p) {
+	__sync_fetch_and_add(&p->refcount, 1);
+}
+
+void pbuf_unref(struct pbuf * p) {
+	if (__sync_sub_and_fetch(&p->refcount, 1)) return;
+	counter_bump(COUNTER_PBUF_FREE);
+	spin_lock(pbuf_lock);
+	list_append(pbuf_pool, &p->node);
+	spin_unlock(pbuf_lock);
+}
@@ -18,8 +18,10 @@
 #include <kernel/vfs.h>
 
 #include <kernel/net/netif.h>
+#include <kernel/net/pbuf.h>
 
 #include <sys/socket.h>
+#include <sys/time.h>
 
 #ifndef MISAKA_DEBUG_NET
 #define printf(...)
@@ -33,29 +35,126 @@
 extern long net_ipv4_socket(int,int);
 
 void net_sock_alert(sock_t * sock) {
-	spin_lock(sock->alert_lock);
-	while (sock->alert_wait->head) {
-		node_t * node = list_dequeue(sock->alert_wait);
-		process_t * p = node->value;
-		free(node);
-		spin_unlock(sock->alert_lock);
-		process_alert_node(p, (fs_node_t*)sock);
-		spin_lock(sock->alert_lock);
-	}
-	spin_unlock(sock->alert_lock);
+	fswait_queue_alert(&sock->alert_wait, (fs_node_t*)sock);
 }
 
-void net_sock_add(sock_t * sock, void * frame, size_t size) {
+void net_sock_add_backed(sock_t * sock, void * frame, size_t size, struct pbuf * backing) {
 	spin_lock(sock->rx_lock);
-	char * bleh = malloc(size + sizeof(size_t));
-	*(size_t*)bleh = size;
-	memcpy(bleh + sizeof(size_t), frame, size);
+	if (sock->rx_buffered >= sock->rcvbuf) {
+		/* Receive buffer is full; the frame is dropped. TCP peers were
+		 * told as much through the advertised window, everyone else
+		 * gets datagram semantics. */
+		spin_unlock(sock->rx_lock);
+		return;
+	}
+	sock->rx_buffered += size;
+	char * bleh;
+	if (backing && (uint8_t*)frame >= PBUF_PAYLOAD(backing) + sizeof(size_t)) {
+		/* The frame sits in a pool buffer with room for the header in
+		 * front of it (over bytes of the link layer framing, which is
+		 * done with by now): queue it by reference, no copy. */
+		pbuf_ref(backing);
+		bleh = (char*)frame - sizeof(size_t);
+		*(size_t*)bleh = size | SOCK_FRAME_PBUF;
+	} else {
+		/* Copied frames carry their arrival stamp behind the data; the
+		 * by-reference path above reads it out of the pool buffer. */
+		bleh = malloc(size + sizeof(size_t) + sizeof(uint64_t));
+		*(size_t*)bleh = size;
+		memcpy(bleh + sizeof(size_t), frame, size);
+		uint64_t stamp;
+		if (backing) {
+			stamp = backing->rx_time;
+		} else {
+			struct timeval tv;
+			gettimeofday(&tv, NULL);
+			stamp = (uint64_t)tv.tv_sec * 1000000UL + tv.tv_usec;
+		}
+		memcpy(bleh + sizeof(size_t) + size, &stamp, sizeof(uint64_t));
+	}
 	list_insert(sock->rx_queue, bleh);
 	wakeup_queue(sock->rx_wait);
 	net_sock_alert(sock);
 	spin_unlock(sock->rx_lock);
 }
 
+void net_sock_add(sock_t * sock, void * frame, size_t size) {
+	net_sock_add_backed(sock, frame, size, NULL);
+}
+
+/**
+ * @brief Attach a byte-stream receive ring to a socket.
+ *
+ * Stream protocols deliver payload bytes into a ring sized by the
+ * receive buffer instead of queuing one malloc'd list node per frame;
+ * readers copy out in bulk, and a wakeup is only posted when the ring
+ * goes from empty to non-empty, so one wakeup can drain many segments.
+ */
+void net_sock_stream_init(sock_t * sock) {
+	spin_lock(sock->rx_lock);
+	if (!sock->rx_ring) {
+		sock->rx_ring_size = sock->rcvbuf;
+		sock->rx_ring = malloc(sock->rx_ring_size);
+		sock->rx_head = 0;
+		sock->rx_tail = 0;
+	}
+	spin_unlock(sock->rx_lock);
+}
+
+int net_sock_stream_write(sock_t * sock, const void * data, size_t size) {
+	spin_lock(sock->rx_lock);
+	if (!sock->rx_ring || sock->rx_ring_size - sock->rx_buffered < size) {
+		/* No room - the peer overran the advertised window; dropping
+		 * here leaves the sequence numbers saying exactly that. */
+		spin_unlock(sock->rx_lock);
+		return 0;
+	}
+	int was_empty = (sock->rx_buffered == 0);
+	size_t first = sock->rx_ring_size - sock->rx_tail;
+	if (first > size) first = size;
+	memcpy(sock->rx_ring + sock->rx_tail, data, first);
+	memcpy(sock->rx_ring, (const uint8_t*)data + first, size - first);
+	sock->rx_tail = (sock->rx_tail + size) % sock->rx_ring_size;
+	sock->rx_buffered += size;
+	if (was_empty) {
+		wakeup_queue(sock->rx_wait);
+		net_sock_alert(sock);
+	}
+	spin_unlock(sock->rx_lock);
+	return 1;
+}
+
+size_t net_sock_stream_read(sock_t * sock, void * buf, size_t size) {
+	spin_lock(sock->rx_lock);
+	if (size > sock->rx_buffered) size = sock->rx_buffered;
+	size_t first = sock->rx_ring_size - sock->rx_head;
+	if (first > size) first = size;
+	memcpy(buf, sock->rx_ring + sock->rx_head, first);
+	memcpy((uint8_t*)buf + first, sock->rx_ring, size - first);
+	sock->rx_head = (sock->rx_head + size) % sock->rx_ring_size;
+	sock->rx_buffered -= size;
+	spin_unlock(sock->rx_lock);
+	return size;
+}
+
+/* When this frame got here, in wall-clock microseconds. */
+uint64_t net_sock_frame_time(void * blob) {
+	if (*(size_t*)blob & SOCK_FRAME_PBUF) {
+		return PBUF_FROM_POINTER(blob)->rx_time;
+	}
+	uint64_t stamp;
+	memcpy(&stamp, (char*)blob + sizeof(size_t) + NET_FRAME_SIZE(blob), sizeof(uint64_t));
+	return stamp;
+}
+
+void net_sock_free(void * blob) {
+	if (*(size_t*)blob & SOCK_FRAME_PBUF) {
+		pbuf_unref(PBUF_FROM_POINTER(blob));
+	} else {
+		free(blob);
+	}
+}
+
 void * net_sock_get(sock_t * sock) {
 	while (!sock->rx_queue->length) {
 		if (sleep_on(sock->rx_wait)) {
@@ -67,6 +166,8 @@ void * net_sock_get(sock_t * sock) {
 	spin_lock(sock->rx_lock);
 	node_t * n = list_dequeue(sock->rx_queue);
 	void* value = n->value;
+	size_t size = NET_FRAME_SIZE(value);
+	sock->rx_buffered = (sock->rx_buffered > size) ? sock->rx_buffered - size : 0;
 	free(n);
 	spin_unlock(sock->rx_lock);
 
@@ -76,19 +177,14 @@ void * net_sock_get(sock_t * sock) {
 int sock_generic_check(fs_node_t *node) {
 	sock_t * sock = (sock_t*)node;
 	if (sock->rx_queue->length) return 0;
+	if (sock->rx_buffered) return 0;
 	if (sock->unread) return 0;
 	return 1;
 }
 
 int sock_generic_wait(fs_node_t *node, void * process) {
 	sock_t * sock = (sock_t*)node;
-
-	spin_lock(sock->alert_lock);
-	if (!list_find(sock->alert_wait, process)) {
-		list_insert(sock->alert_wait, process);
-	}
-	list_insert(((process_t *)process)->node_waits, sock);
-	spin_unlock(sock->alert_lock);
+	fswait_queue_wait(&sock->alert_wait, process, sock);
 	return 0;
 }
 
@@ -97,9 +193,13 @@ void sock_generic_close(fs_node_t *node) {
 	sock->sock_close(sock);
 	while (sock->rx_queue->length) {
 		node_t * n = list_dequeue(sock->rx_queue);
-		free(n->value);
+		net_sock_free(n->value);
 		free(n);
 	}
+	if (sock->rx_ring) {
+		free(sock->rx_ring);
+		sock->rx_ring = NULL;
+	}
 	printf("net: socket closed\n");
 }
 
@@ -111,7 +211,9 @@ sock_t * net_sock_create(void) {
 	sock->_fnode.selectcheck = sock_generic_check;
 	sock->_fnode.selectwait = sock_generic_wait;
 	sock->_fnode.close = sock_generic_close;
-	sock->alert_wait = list_create("socket alert wait", sock);
+	sock->sndbuf = SOCK_BUFFER_DEFAULT;
+	sock->rcvbuf = SOCK_BUFFER_DEFAULT;
+	fswait_queue_init(&sock->alert_wait, "socket alert wait", sock);
 	sock->rx_wait    = list_create("socket rx wait", sock);
 	sock->rx_queue   = list_create("socket rx queue", sock);
 	open_fs((fs_node_t*)sock,0);
@@ -130,10 +232,10 @@ static long sock_raw_recv(sock_t * sock, struct msghdr * msg, int flags) {
 	if (msg->msg_iovlen == 0) return 0;
 	char * data = net_sock_get(sock);
 	if (!data) return -EINTR;
-	size_t packet_size = *(size_t*)data;
+	size_t packet_size = NET_FRAME_SIZE(data);
 	if (msg->msg_iov[0].iov_len < packet_size) return -EINVAL;
 	memcpy(msg->msg_iov[0].iov_base, data + sizeof(size_t), packet_size);
-	free(data);
+	net_sock_free(data);
 	return 4096;
 }
 
@@ -186,6 +288,16 @@ long net_socket(int domain, int type, int protocol) {
 	}
 }
 
+extern long net_unix_socketpair(int type, int protocol, int * sv);
+
+long net_socketpair(int domain, int type, int protocol, int * sv) {
+	PTR_VALIDATE(sv);
+	if (!sv) return -EFAULT;
+	/* Only AF_UNIX sockets come in pairs. */
+	if (domain != AF_UNIX) return -EINVAL;
+	return net_unix_socketpair(type, protocol, sv);
+}
+
 long net_so_socket(struct SockData * sock, int optname, const void *optval, socklen_t optlen) {
 	switch (optname) {
 		case SO_BINDTODEVICE: {
@@ -195,6 +307,21 @@ long net_so_socket(struct SockData * sock, int optname, const void *optval, sock
 			sock->_fnode.device = netif;
 			return 0;
 		}
+		case SO_SNDBUF:
+		case SO_RCVBUF: {
+			if (optlen < sizeof(int)) return -EINVAL;
+			long size = *(const int*)optval;
+			if (size < SOCK_BUFFER_MIN) size = SOCK_BUFFER_MIN;
+			if (size > SOCK_BUFFER_MAX) size = SOCK_BUFFER_MAX;
+			if (optname == SO_SNDBUF) sock->sndbuf = size;
+			else sock->rcvbuf = size;
+			return 0;
+		}
+		case SO_TIMESTAMP: {
+			if (optlen < sizeof(int)) return -EINVAL;
+			sock->rx_timestamp = !!*(const int*)optval;
+			return 0;
+		}
 		default:
 			return -ENOPROTOOPT;
 	}
@@ -215,6 +342,19 @@ long net_setsockopt(int sockfd, int level, int optname, const void *optval, sock
 
 long net_getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *optlen) {
 	if (!FD_CHECK(sockfd)) return -EBADF;
+	PTR_VALIDATE(optval);
+	PTR_VALIDATE(optlen);
+	sock_t * node = (sock_t*)FD_ENTRY(sockfd);
+	if (level == SOL_SOCKET && (optname == SO_SNDBUF || optname == SO_RCVBUF || optname == SO_TIMESTAMP)) {
+		if (*optlen < sizeof(int)) return -EINVAL;
+		*(int*)optval = (optname == SO_SNDBUF) ? node->sndbuf :
+			(optname == SO_RCVBUF) ? node->rcvbuf : node->rx_timestamp;
+		*optlen = sizeof(int);
+		return 0;
+	}
+	if (node->sock_getsockopt) {
+		return node->sock_getsockopt(node, level, optname, optval, optlen);
+	}
 	return -EINVAL;
 }
 
@@ -0,0 +1,429 @@
+/**
+ * @file  kernel/net/unix.c
+ * @brief AF_UNIX socket pairs.
+ *
+ * Provides connected socket pairs for local RPC. Small writes are
+ * copied into the peer's receive ring, same as the TCP stream path;
+ * writes at or above UNIX_BULK_THRESHOLD skip the intermediate ring
+ * entirely: the sender parks on a descriptor pointing at its own
+ * buffer and the reader copies straight out of the sender's address
+ * space through the physical map, so bulk transfers cost one copy
+ * instead of the two a pipe pays. Also supports passing open file
+ * descriptors as SCM_RIGHTS ancillary data and reporting peer
+ * credentials through SO_PEERCRED.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <errno.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/list.h>
+#include <kernel/syscall.h>
+#include <kernel/vfs.h>
+#include <kernel/process.h>
+#include <kernel/signal.h>
+#include <kernel/mmu.h>
+
+#include <sys/signal_defs.h>
+
+#include <kernel/net/netif.h>
+
+#include <sys/socket.h>
+
+#ifndef MISAKA_DEBUG_NET
+#define printf(...)
+#endif
+
+/* Writes this large bypass the receive ring and are copied directly
+ * from the sender's address space when the reader shows up. */
+#define UNIX_BULK_THRESHOLD 0x4000
+
+/* Cap on file descriptors parked at one end awaiting recvmsg(). */
+#define UNIX_MAX_PENDING_FDS 64
+
+/* A write waiting to be pulled directly from the sender. When
+ * @p directory is set this is a blocked bulk writer and @p addr is a
+ * user address in that address space; the directory holds a reference
+ * so the frames stay good even if the sender dies mid-transfer. When
+ * @p directory is NULL, @p addr is a kernel heap copy made to keep a
+ * small write ordered behind queued bulk data. */
+struct unix_bulk {
+	page_directory_t * directory;
+	const uint8_t * addr;
+	size_t size;
+	size_t consumed;
+	list_t * done_wait;
+};
+
+/* One end of a pair; proto_private of the owning sock_t. */
+struct unix_sock {
+	sock_t * sock;
+	struct unix_sock * peer;     /* NULL once the other end closes */
+	struct ucred peercred;       /* credentials of the creating process */
+	spin_lock_t lock;            /* guards bulk/fd queues and peer link */
+	list_t * bulk_queue;         /* struct unix_bulk, oldest first */
+	list_t * fd_queue;           /* fs_node_t* passed via SCM_RIGHTS */
+	list_t * tx_wait;            /* writers blocked on this end's buffers */
+	size_t queued_heap;          /* heap bytes held for ordering */
+};
+
+static void unix_bulk_retire(struct unix_bulk * bulk) {
+	if (bulk->directory) {
+		process_release_directory(bulk->directory);
+	} else {
+		free((void*)bulk->addr);
+	}
+	free(bulk->done_wait);
+	free(bulk);
+}
+
+/**
+ * @brief Copy out of a parked bulk write.
+ *
+ * Walks the sender's page tables the same way ptrace_peek does and
+ * copies through the physical map, one page at a time. Returns bytes
+ * copied; stops short if a page of the sender's buffer is not mapped.
+ */
+static size_t unix_bulk_copy(struct unix_bulk * bulk, uint8_t * dest, size_t size) {
+	if (size > bulk->size - bulk->consumed) size = bulk->size - bulk->consumed;
+	if (!bulk->directory) {
+		memcpy(dest, bulk->addr + bulk->consumed, size);
+		bulk->consumed += size;
+		return size;
+	}
+	size_t copied = 0;
+	while (copied < size) {
+		uintptr_t src = (uintptr_t)bulk->addr + bulk->consumed;
+		size_t chunk = 0x1000 - (src & 0xFFF);
+		if (chunk > size - copied) chunk = size - copied;
+		uintptr_t phys = mmu_map_to_physical(bulk->directory->directory, src);
+		if ((intptr_t)phys < 0) break; /* sender buffer went away */
+		memcpy(dest + copied, mmu_map_from_physical(phys), chunk);
+		bulk->consumed += chunk;
+		copied += chunk;
+	}
+	return copied;
+}
+
+static long sock_unix_recv(sock_t * sock, struct msghdr * msg, int flags) {
+	struct unix_sock * un = sock->proto_private;
+
+	if (msg->msg_iovlen > 1) {
+		printf("net: todo: can't recv multiple iovs\n");
+		return -ENOTSUP;
+	}
+
+	/* Deliver any parked file descriptors first, if the caller gave us
+	 * control space; they ride along with whatever data we return. */
+	size_t control_used = 0;
+	spin_lock(un->lock);
+	if (un->fd_queue->length && msg->msg_control &&
+	    msg->msg_controllen >= CMSG_LEN(sizeof(int))) {
+		struct cmsghdr * cmsg = msg->msg_control;
+		int * fds = (int*)CMSG_DATA(cmsg);
+		size_t space = (msg->msg_controllen - CMSG_LEN(0)) / sizeof(int);
+		size_t count = 0;
+		while (count < space && un->fd_queue->length) {
+			node_t * n = list_dequeue(un->fd_queue);
+			fs_node_t * fnode = n->value;
+			free(n);
+			/* The sender's reference transfers to the new entry. */
+			fds[count++] = process_append_fd((process_t *)this_core->current_process, fnode);
+		}
+		cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		control_used = CMSG_SPACE(count * sizeof(int));
+	}
+	spin_unlock(un->lock);
+	msg->msg_controllen = control_used;
+
+	if (msg->msg_iovlen == 0) return 0;
+	uint8_t * buf = msg->msg_iov[0].iov_base;
+	size_t len = msg->msg_iov[0].iov_len;
+
+	while (!sock->rx_buffered && !sock->unread) {
+		if (!un->peer) return 0; /* EOF */
+		if (control_used) return 0; /* we did hand over fds */
+		process_wait_nodes((process_t *)this_core->current_process, (fs_node_t*[]){(fs_node_t*)sock,NULL}, 200);
+	}
+
+	/* Ring bytes are always older than queued bulk data (writes only
+	 * enter the ring while the bulk queue is empty), so drain the ring
+	 * before touching descriptors. */
+	size_t total = net_sock_stream_read(sock, buf, len);
+
+	spin_lock(un->lock);
+	while (total < len && un->bulk_queue->head) {
+		struct unix_bulk * bulk = un->bulk_queue->head->value;
+		size_t got = unix_bulk_copy(bulk, buf + total, len - total);
+		sock->unread -= got;
+		total += got;
+		if (bulk->consumed == bulk->size || got == 0) {
+			list_dequeue(un->bulk_queue);
+			if (bulk->directory) {
+				/* If a page vanished mid-transfer, cut the write short
+				 * so the sender reports what actually arrived. */
+				if (got == 0) {
+					sock->unread -= bulk->size - bulk->consumed;
+					bulk->size = bulk->consumed;
+				}
+				wakeup_queue(bulk->done_wait);
+				/* The writer retires its own descriptor. */
+			} else {
+				un->queued_heap -= bulk->size;
+				unix_bulk_retire(bulk);
+			}
+			if (got == 0) break;
+		}
+	}
+	spin_unlock(un->lock);
+
+	/* We made room; writers blocked on this end can try again. */
+	wakeup_queue(un->tx_wait);
+
+	return total;
+}
+
+/**
+ * @brief Park a bulk write on the peer and sleep until it drains.
+ */
+static long unix_send_bulk(struct unix_sock * peer, const uint8_t * addr, size_t size) {
+	struct unix_bulk * bulk = malloc(sizeof(struct unix_bulk));
+	bulk->directory = this_core->current_process->thread.page_directory;
+	bulk->addr = addr;
+	bulk->size = size;
+	bulk->consumed = 0;
+	bulk->done_wait = list_create("unix bulk wait", bulk);
+
+	/* Fault the buffer in from our own context; the reader can only
+	 * walk pages that are already resident. */
+	for (uintptr_t p = (uintptr_t)addr & ~0xFFF; p < (uintptr_t)addr + size; p += 0x1000) {
+		volatile uint8_t x = *(volatile uint8_t *)p; (void)x;
+	}
+
+	spin_lock(bulk->directory->lock);
+	bulk->directory->refcount++;
+	spin_unlock(bulk->directory->lock);
+
+	spin_lock(peer->lock);
+	list_insert(peer->bulk_queue, bulk);
+	peer->sock->unread += size;
+	spin_unlock(peer->lock);
+	wakeup_queue(peer->sock->rx_wait);
+	net_sock_alert(peer->sock);
+
+	while (1) {
+		spin_lock(peer->lock);
+		if (bulk->consumed == bulk->size || !peer->peer) {
+			/* Fully drained, or the reader closed under us. */
+			node_t * n = list_find(peer->bulk_queue, bulk);
+			if (n) list_delete(peer->bulk_queue, n), free(n);
+			if (bulk->consumed < bulk->size) peer->sock->unread -= bulk->size - bulk->consumed;
+			long out = bulk->consumed ? (long)bulk->consumed : -EPIPE;
+			spin_unlock(peer->lock);
+			unix_bulk_retire(bulk);
+			return out;
+		}
+		spin_unlock(peer->lock);
+		if (sleep_on(bulk->done_wait)) {
+			/* Interrupted: withdraw whatever the reader hasn't taken. */
+			spin_lock(peer->lock);
+			node_t * n = list_find(peer->bulk_queue, bulk);
+			if (n) {
+				list_delete(peer->bulk_queue, n);
+				free(n);
+				peer->sock->unread -= bulk->size - bulk->consumed;
+			}
+			long out = bulk->consumed ? (long)bulk->consumed : -EINTR;
+			spin_unlock(peer->lock);
+			unix_bulk_retire(bulk);
+			return out;
+		}
+	}
+}
+
+static long sock_unix_send(sock_t * sock, const struct msghdr *msg, int flags) {
+	struct unix_sock * un = sock->proto_private;
+
+	if (msg->msg_iovlen > 1) {
+		printf("net: todo: can't send multiple iovs\n");
+		return -ENOTSUP;
+	}
+
+	spin_lock(un->lock);
+	struct unix_sock * peer = un->peer;
+	spin_unlock(un->lock);
+	if (!peer) {
+		send_signal(this_core->current_process->id, SIGPIPE, 1);
+		return -EPIPE;
+	}
+
+	/* Attach any passed file descriptors before the data so they are
+	 * available no later than the bytes they were sent with. */
+	if (msg->msg_control) {
+		struct cmsghdr * cmsg = CMSG_FIRSTHDR(msg);
+		for (; cmsg; cmsg = CMSG_NXTHDR((struct msghdr*)msg, cmsg)) {
+			if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -EINVAL;
+			size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			int * fds = (int*)CMSG_DATA(cmsg);
+			spin_lock(peer->lock);
+			if (peer->fd_queue->length + count > UNIX_MAX_PENDING_FDS) {
+				spin_unlock(peer->lock);
+				return -ETOOMANYREFS;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				if (!FD_CHECK(fds[i])) {
+					spin_unlock(peer->lock);
+					return -EBADF;
+				}
+				fs_node_t * fnode = FD_ENTRY(fds[i]);
+				open_fs(fnode, 0);
+				list_insert(peer->fd_queue, fnode);
+			}
+			spin_unlock(peer->lock);
+		}
+		wakeup_queue(peer->sock->rx_wait);
+		net_sock_alert(peer->sock);
+	}
+
+	if (msg->msg_iovlen == 0) return 0;
+	const uint8_t * buf = msg->msg_iov[0].iov_base;
+	size_t size = msg->msg_iov[0].iov_len;
+
+	if (size >= UNIX_BULK_THRESHOLD) {
+		return unix_send_bulk(peer, buf, size);
+	}
+
+	while (1) {
+		spin_lock(un->lock);
+		if (!un->peer) {
+			spin_unlock(un->lock);
+			send_signal(this_core->current_process->id, SIGPIPE, 1);
+			return -EPIPE;
+		}
+		spin_unlock(un->lock);
+
+		spin_lock(peer->lock);
+		if (peer->bulk_queue->length) {
+			/* Bulk data is queued ahead of us; to keep the byte stream
+			 * ordered, this write lines up behind it as a heap copy. */
+			if (peer->queued_heap + size <= sock->sndbuf) {
+				struct unix_bulk * bulk = malloc(sizeof(struct unix_bulk));
+				bulk->directory = NULL;
+				uint8_t * copy = malloc(size);
+				memcpy(copy, buf, size);
+				bulk->addr = copy;
+				bulk->size = size;
+				bulk->consumed = 0;
+				bulk->done_wait = list_create("unix heap wait", bulk);
+				list_insert(peer->bulk_queue, bulk);
+				peer->queued_heap += size;
+				peer->sock->unread += size;
+				spin_unlock(peer->lock);
+				wakeup_queue(peer->sock->rx_wait);
+				net_sock_alert(peer->sock);
+				return size;
+			}
+			spin_unlock(peer->lock);
+		} else {
+			spin_unlock(peer->lock);
+			if (net_sock_stream_write(peer->sock, buf, size)) {
+				return size;
+			}
+		}
+
+		/* No room at the peer; wait for its reader to drain. */
+		if (sleep_on(peer->tx_wait)) return -EINTR;
+	}
+}
+
+static long sock_unix_getsockopt(sock_t * sock, int level, int optname, void * optval, socklen_t * optlen) {
+	struct unix_sock * un = sock->proto_private;
+	if (level == SOL_SOCKET && optname == SO_PEERCRED) {
+		if (*optlen < sizeof(struct ucred)) return -EINVAL;
+		memcpy(optval, &un->peercred, sizeof(struct ucred));
+		*optlen = sizeof(struct ucred);
+		return 0;
+	}
+	return -ENOPROTOOPT;
+}
+
+static void sock_unix_close(sock_t * sock) {
+	struct unix_sock * un = sock->proto_private;
+	if (!un) return;
+
+	spin_lock(un->lock);
+	struct unix_sock * peer = un->peer;
+	un->peer = NULL;
+	spin_unlock(un->lock);
+
+	if (peer) {
+		/* Unhook the far end and wake anyone mid-call on it. */
+		spin_lock(peer->lock);
+		peer->peer = NULL;
+		spin_unlock(peer->lock);
+		wakeup_queue(peer->sock->rx_wait);
+		wakeup_queue(peer->tx_wait);
+		net_sock_alert(peer->sock);
+	}
+
+	/* Blocked bulk writers notice the dropped peer link and retire
+	 * their own descriptors; heap copies and unclaimed fds are ours. */
+	spin_lock(un->lock);
+	while (un->bulk_queue->head) {
+		struct unix_bulk * bulk = un->bulk_queue->head->value;
+		if (bulk->directory) break;
+		list_dequeue(un->bulk_queue);
+		unix_bulk_retire(bulk);
+	}
+	foreach(node, un->bulk_queue) {
+		struct unix_bulk * bulk = node->value;
+		wakeup_queue(bulk->done_wait);
+	}
+	while (un->fd_queue->length) {
+		node_t * n = list_dequeue(un->fd_queue);
+		close_fs(n->value);
+		free(n);
+	}
+	spin_unlock(un->lock);
+}
+
+static struct unix_sock * unix_sock_create(void) {
+	sock_t * sock = net_sock_create();
+	sock->sock_recv = sock_unix_recv;
+	sock->sock_send = sock_unix_send;
+	sock->sock_close = sock_unix_close;
+	sock->sock_getsockopt = sock_unix_getsockopt;
+	net_sock_stream_init(sock);
+
+	struct unix_sock * un = calloc(sizeof(struct unix_sock), 1);
+	un->sock = sock;
+	un->bulk_queue = list_create("unix bulk queue", un);
+	un->fd_queue = list_create("unix fd queue", un);
+	un->tx_wait = list_create("unix tx wait", un);
+	un->peercred.pid = this_core->current_process->id;
+	un->peercred.uid = this_core->current_process->user;
+	un->peercred.gid = this_core->current_process->user_group;
+	sock->proto_private = un;
+	return un;
+}
+
+long net_unix_socketpair(int type, int protocol, int * sv) {
+	if (type != SOCK_STREAM || protocol != 0) return -EINVAL;
+
+	struct unix_sock * a = unix_sock_create();
+	struct unix_sock * b = unix_sock_create();
+	a->peer = b;
+	b->peer = a;
+
+	sv[0] = process_append_fd((process_t *)this_core->current_process, (fs_node_t *)a->sock);
+	sv[1] = process_append_fd((process_t *)this_core->current_process, (fs_node_t *)b->sock);
+	FD_MODE(sv[0]) = 03;
+	FD_MODE(sv[1]) = 03;
+	return 0;
+}
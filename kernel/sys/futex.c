@@ -0,0 +1,202 @@
+/**
+ * @file  kernel/sys/futex.c
+ * @brief Kernel-side wait/wake for userspace synchronization primitives.
+ *
+ * Provides a futex-style interface: a thread can ask to block until
+ * another thread pokes a userspace address, with the kernel checking
+ * an expected value under its own lock so lost wakeups can't happen.
+ * libc builds mutexes and condition variables on top of this instead
+ * of burning cycles in yield loops.
+ *
+ * Wait channels are keyed on the physical address of the futex word,
+ * so words in shared memory work across processes.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <kernel/process.h>
+#include <kernel/spinlock.h>
+#include <kernel/string.h>
+#include <kernel/flatmap.h>
+#include <kernel/list.h>
+#include <kernel/mmu.h>
+#include <kernel/time.h>
+#include <kernel/syscall.h>
+
+/* Maps physical address of a futex word to a list of waiting processes. */
+static flatmap_t * futex_queues = NULL;
+static spin_lock_t futex_lock = { 0 };
+
+/**
+ * Lives on the waiting thread's kernel stack for the duration of
+ * futex_wait. The key is updated by futex_requeue when the waiter is
+ * moved to another word's queue, so the waiter can always find (and
+ * remove) its own entry if the sleep ends some other way.
+ */
+struct futex_waiter {
+	process_t * proc;
+	uintptr_t key;
+};
+
+/**
+ * @brief Resolve a userspace futex word to its physical address.
+ *
+ * @returns the physical address, or (uintptr_t)-1 if it is not mapped.
+ */
+static uintptr_t futex_key(uint32_t * addr) {
+	return mmu_map_to_physical(this_core->current_process->thread.page_directory->directory, (uintptr_t)addr);
+}
+
+/**
+ * @brief Block until another thread wakes this futex word.
+ *
+ * Atomically (with respect to @ref futex_wake) checks that the word
+ * still contains @p value and then sleeps. Returns early if the word
+ * has already changed.
+ *
+ * @param addr    Userspace address of the futex word.
+ * @param value   Expected value; if *addr differs, returns immediately.
+ * @param timeout Milliseconds to wait, or 0 to wait indefinitely.
+ * @returns 0 if woken by @ref futex_wake, -EAGAIN if the value had
+ *          already changed, -EINTR if the sleep was otherwise ended.
+ */
+long futex_wait(uint32_t * addr, uint32_t value, int timeout) {
+	PTR_VALIDATE(addr);
+	uintptr_t key = futex_key(addr);
+	if (key == (uintptr_t)-1) return -EFAULT;
+
+	process_t * proc = (process_t *)this_core->current_process;
+	struct futex_waiter waiter = { proc, key };
+
+	spin_lock(futex_lock);
+	if (!futex_queues) futex_queues = flatmap_create(16);
+
+	if (*addr != value) {
+		spin_unlock(futex_lock);
+		return -EAGAIN;
+	}
+
+	list_t * queue = flatmap_get(futex_queues, key);
+	if (!queue) {
+		queue = list_create("futex waiters", (void*)key);
+		flatmap_set(futex_queues, key, queue);
+	}
+	list_insert(queue, &waiter);
+	spin_unlock(futex_lock);
+
+	if (timeout > 0) {
+		unsigned long s, ss;
+		relative_time(timeout / 1000, (timeout % 1000) * 1000, &s, &ss);
+		sleep_until(proc, s, ss);
+	}
+
+	switch_task(0);
+
+	/* If we are still in a wait queue, this was a timeout or an
+	 * interruption rather than a futex wakeup; clean up our entry.
+	 * A requeue may have moved us, so look where the waiter says. */
+	long result = 0;
+	spin_lock(futex_lock);
+	queue = flatmap_get(futex_queues, waiter.key);
+	if (queue) {
+		node_t * node = list_find(queue, &waiter);
+		if (node) {
+			list_delete(queue, node);
+			free(node);
+			result = -EINTR;
+		}
+		if (!queue->length) {
+			flatmap_remove(futex_queues, waiter.key);
+			free(queue);
+		}
+	}
+	spin_unlock(futex_lock);
+
+	return result;
+}
+
+/**
+ * @brief Wake threads blocked on a futex word.
+ *
+ * @param addr  Userspace address of the futex word.
+ * @param count Maximum number of waiters to wake.
+ * @returns the number of threads actually awoken.
+ */
+long futex_wake(uint32_t * addr, int count) {
+	PTR_VALIDATE(addr);
+	uintptr_t key = futex_key(addr);
+	if (key == (uintptr_t)-1) return -EFAULT;
+
+	long awoken = 0;
+	spin_lock(futex_lock);
+	list_t * queue = futex_queues ? flatmap_get(futex_queues, key) : NULL;
+	while (queue && queue->length && awoken < count) {
+		node_t * node = list_dequeue(queue);
+		struct futex_waiter * waiter = node->value;
+		free(node);
+		make_process_ready(waiter->proc);
+		awoken++;
+	}
+	if (queue && !queue->length) {
+		flatmap_remove(futex_queues, key);
+		free(queue);
+	}
+	spin_unlock(futex_lock);
+
+	return awoken;
+}
+
+/**
+ * @brief Wake some waiters and move the rest to another futex word.
+ *
+ * Used by condition variable broadcast: one waiter is woken to run
+ * immediately and the others are transferred to the mutex's wait
+ * queue, so they wake one at a time as the lock is handed off instead
+ * of all stampeding for a mutex only one of them can hold.
+ *
+ * @param addr  Word the waiters are currently blocked on.
+ * @param count Maximum number of waiters to wake now.
+ * @param addr2 Word the remaining waiters should block on instead.
+ * @returns the number of threads awoken.
+ */
+long futex_requeue(uint32_t * addr, int count, uint32_t * addr2) {
+	PTR_VALIDATE(addr);
+	PTR_VALIDATE(addr2);
+	uintptr_t key = futex_key(addr);
+	uintptr_t key2 = futex_key(addr2);
+	if (key == (uintptr_t)-1 || key2 == (uintptr_t)-1) return -EFAULT;
+
+	long awoken = 0;
+	spin_lock(futex_lock);
+	list_t * queue = futex_queues ? flatmap_get(futex_queues, key) : NULL;
+	while (queue && queue->length && awoken < count) {
+		node_t * node = list_dequeue(queue);
+		struct futex_waiter * waiter = node->value;
+		free(node);
+		make_process_ready(waiter->proc);
+		awoken++;
+	}
+	if (queue && queue->length && key != key2) {
+		list_t * target = flatmap_get(futex_queues, key2);
+		if (!target) {
+			target = list_create("futex waiters", (void*)key2);
+			flatmap_set(futex_queues, key2, target);
+		}
+		while (queue->length) {
+			node_t * node = list_dequeue(queue);
+			((struct futex_waiter *)node->value)->key = key2;
+			list_append(target, node);
+		}
+	}
+	if (queue && !queue->length) {
+		flatmap_remove(futex_queues, key);
+		free(queue);
+	}
+	spin_unlock(futex_lock);
+
+	return awoken;
+}
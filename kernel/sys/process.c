@@ -36,6 +36,9 @@
 #include <kernel/time.h>
 #include <kernel/misc.h>
 #include <kernel/syscall.h>
+#include <kernel/slab.h>
+#include <kernel/hashmap.h>
+#include <kernel/counters.h>
 #include <sys/wait.h>
 #include <sys/signal_defs.h>
 
@@ -44,20 +47,46 @@
 
 tree_t * process_tree;  /* Stores the parent-child process relationships; the root of this graph is 'init'. */
 list_t * process_list;  /* Stores all existing processes. Mostly used for sanity checking or for places where iterating over all processes is useful. */
-list_t * process_queue; /* Scheduler ready queue. This the round-robin source. The head is the next process to run. */
-list_t * sleep_queue;   /* Ordered list of processes waiting to be awoken by timeouts. The head is the earliest thread to awaken. */
-list_t * reap_queue;    /* Processes that could not be cleaned up and need to be deleted. */
+
+/* PID-to-process map, maintained alongside the tree under tree_lock,
+ * so pid lookups are a bucket probe instead of a full tree walk. */
+static hashmap_t * process_hash = NULL;
+
+/* Process structs are allocated and freed constantly under fork-heavy
+ * loads, so they come from a slab cache rather than the general heap. */
+static slab_cache_t * process_cache = NULL;
+
+/* Timed sleeps live in a binary min-heap ordered by wake time, so arming
+ * and disarming are O(log n) regardless of how many threads are waiting
+ * on timeouts. The heap is guarded by @c sleep_lock. */
+static sleeper_t ** sleep_heap = NULL;
+static size_t sleep_heap_length = 0;
+static size_t sleep_heap_capacity = 0;
+
+/* The heap replaced the old sleep_queue list, but sleep_node.owner is
+ * still how we tell a timed sleep from a semaphore wait; this otherwise
+ * unused list serves as the owner tag for heap-armed sleeps. */
+static list_t sleep_queue_tag = {0};
+#define SLEEP_QUEUE_OWNER (&sleep_queue_tag)
 
 struct ProcessorLocal processor_local_data[32] = {0};
 int processor_count = 1;
 
-/* The following locks protect access to the process tree, scheduler queue,
- * sleeping, and the very special wait queue... */
+/* The following locks protect access to the process tree and
+ * the timed sleep heap. The scheduler ready queues are per-core
+ * and carry their own locks in @ref processor_local_data. */
 static spin_lock_t tree_lock = { 0 };
-static spin_lock_t process_queue_lock = { 0 };
-static spin_lock_t wait_lock_tmp = { 0 };
 static spin_lock_t sleep_lock = { 0 };
-static spin_lock_t reap_lock = { 0 };
+
+/* Wait queues ("semaphore queues") used to share one global lock,
+ * which made hot queues like TTY input and pipe waiters ping-pong a
+ * single cacheline across every core. Locks for wait queues are now
+ * striped by queue address, so unrelated queues no longer contend. */
+static spin_lock_t wait_queue_locks[64];
+
+static spin_lock_t * wait_lock_for(list_t * queue) {
+	return &wait_queue_locks[((uintptr_t)queue >> 6) & 63];
+}
 
 void update_process_times(int includeSystem) {
 	uint64_t pTime = arch_perf_timer();
@@ -100,8 +129,13 @@ void update_process_times(int includeSystem) {
  *
  * @returns never.
  */
+static void reap_retired(void);
+
 void switch_next(void) {
 	this_core->previous_process = this_core->current_process;
+	this_core->sched_switch_count++;
+	counter_bump(COUNTER_SCHED_SWITCH);
+	this_core->wakeup_pending = 0;
 	update_process_times(1);
 
 	/* Get the next available process, discarded anything in the queue
@@ -113,9 +147,21 @@ void switch_next(void) {
 	this_core->current_process->time_in = arch_perf_timer();
 	this_core->current_process->time_switch = this_core->current_process->time_in;
 
+	/* Arm the local preemption timer only when this core has real work;
+	 * a core going idle stops its timer and waits for a wakeup IPI. */
+	if (this_core->current_process == this_core->kernel_idle_task) {
+		arch_timer_stop();
+		/* With nothing to run, this is a good time to clean up any
+		 * processes whose teardown was deferred to this core. */
+		reap_retired();
+	} else {
+		arch_timer_arm(10000);
+	}
+
 	/* Restore paging and task switch context. */
 	mmu_set_directory(this_core->current_process->thread.page_directory->directory);
 	arch_set_kernel_stack(this_core->current_process->image.stack);
+	arch_set_debug_registers((process_t *)this_core->current_process);
 
 	if ((this_core->current_process->flags & PROC_FLAG_FINISHED) ||  (!this_core->current_process->signal_queue)) {
 		arch_fatal_prepare();
@@ -224,9 +270,18 @@ void switch_task(uint8_t reschedule) {
 void initialize_process_tree(void) {
 	process_tree = tree_create();
 	process_list = list_create("global process list",NULL);
-	process_queue = list_create("global scheduler queue",NULL);
-	sleep_queue = list_create("global timed sleep queue",NULL);
-	reap_queue = list_create("processes awaiting later cleanup",NULL);
+	process_hash = hashmap_create_int(64);
+	process_cache = slab_cache_create("process structs", sizeof(process_t));
+
+	/* All of the core-local ready queues are allocated up front, as this
+	 * happens long before the APs are enumerated and we don't want to
+	 * deal with the queues appearing while the scheduler is active. */
+	for (int i = 0; i < (int)(sizeof(processor_local_data) / sizeof(*processor_local_data)); ++i) {
+		for (int p = 0; p < SCHED_PRIORITY_LEVELS; ++p) {
+			processor_local_data[i].sched_queue[p] = list_create("core scheduler queue",&processor_local_data[i]);
+		}
+		spin_init(processor_local_data[i].sched_lock);
+	}
 
 	/* TODO: PID bitset? */
 }
@@ -343,6 +398,8 @@ void process_release_directory(page_directory_t * dir) {
 	spin_lock(dir->lock);
 	dir->refcount--;
 	if (dir->refcount < 1) {
+		if (dir->exec_node) close_fs(dir->exec_node);
+		if (dir->exec_segments) free(dir->exec_segments);
 		mmu_free(dir->directory);
 		free(dir);
 	} else {
@@ -351,7 +408,8 @@ void process_release_directory(page_directory_t * dir) {
 }
 
 process_t * spawn_kidle(int bsp) {
-	process_t * idle = calloc(1,sizeof(process_t));
+	process_t * idle = slab_alloc(process_cache);
+	memset(idle, 0, sizeof(process_t));
 	idle->id = -1;
 	idle->name = strdup("[kidle]");
 	idle->flags = PROC_FLAG_IS_TASKLET | PROC_FLAG_STARTED | PROC_FLAG_RUNNING;
@@ -375,15 +433,20 @@ process_t * spawn_kidle(int bsp) {
 	idle->thread.page_directory->refcount = 1;
 	idle->thread.page_directory->directory = mmu_clone(this_core->current_pml);
 	spin_init(idle->thread.page_directory->lock);
+	idle->thread.page_directory->exec_node = NULL;
+	idle->thread.page_directory->exec_segments = NULL;
+	idle->thread.page_directory->exec_segment_count = 0;
 	return idle;
 }
 
 process_t * spawn_init(void) {
-	process_t * init = calloc(1,sizeof(process_t));
+	process_t * init = slab_alloc(process_cache);
+	memset(init, 0, sizeof(process_t));
 	tree_set_root(process_tree, (void*)init);
 
 	init->tree_entry = process_tree->root;
 	init->id         = 1;
+	hashmap_set(process_hash, (void*)(uintptr_t)init->id, (void*)init);
 	init->group      = 0;
 	init->job        = 1;
 	init->session    = 1;
@@ -395,6 +458,7 @@ process_t * spawn_init(void) {
 	init->real_user_group = USER_ROOT_UID;
 	init->mask       = 022;
 	init->status     = 0;
+	init->priority   = SCHED_PRIORITY_DEFAULT;
 
 	init->fds           = malloc(sizeof(fd_table_t));
 	init->fds->refs     = 1;
@@ -436,6 +500,9 @@ process_t * spawn_init(void) {
 	init->thread.page_directory->refcount = 1;
 	init->thread.page_directory->directory = this_core->current_pml;
 	spin_init(init->thread.page_directory->lock);
+	init->thread.page_directory->exec_node = NULL;
+	init->thread.page_directory->exec_segments = NULL;
+	init->thread.page_directory->exec_segment_count = 0;
 	init->description = strdup("[init]");
 	list_insert(process_list, (void*)init);
 
@@ -443,7 +510,8 @@ process_t * spawn_init(void) {
 }
 
 process_t * spawn_process(volatile process_t * parent, int flags) {
-	process_t * proc = calloc(1,sizeof(process_t));
+	process_t * proc = slab_alloc(process_cache);
+	memset(proc, 0, sizeof(process_t));
 
 	proc->id          = get_next_pid();
 	proc->group       = proc->id;
@@ -458,6 +526,7 @@ process_t * spawn_process(volatile process_t * parent, int flags) {
 	proc->mask        = parent->mask;
 	proc->job         = parent->job;
 	proc->session     = parent->session;
+	proc->priority    = parent->priority;
 
 	if (parent->supplementary_group_count) {
 		proc->supplementary_group_count = parent->supplementary_group_count;
@@ -521,6 +590,7 @@ process_t * spawn_process(volatile process_t * parent, int flags) {
 	spin_lock(tree_lock);
 	tree_node_insert_child_node(process_tree, parent->tree_entry, entry);
 	list_insert(process_list, (void*)proc);
+	hashmap_set(process_hash, (void*)(uintptr_t)proc->id, (void*)proc);
 	spin_unlock(tree_lock);
 	return proc;
 }
@@ -539,6 +609,10 @@ void process_reap(process_t * proc) {
 		free(proc->tracees);
 	}
 
+	if (proc->syscall_ring) {
+		free(proc->syscall_ring);
+	}
+
 	/* Unmark the stack bottom's fault detector */
 	mmu_frame_allocate(
 		mmu_get_page(proc->image.stack - KERNEL_STACK_SIZE, 0),
@@ -548,7 +622,7 @@ void process_reap(process_t * proc) {
 	process_release_directory(proc->thread.page_directory);
 
 	free(proc->name);
-	free(proc);
+	slab_free(process_cache, proc);
 }
 
 static int process_is_owned(process_t * proc) {
@@ -561,21 +635,44 @@ static int process_is_owned(process_t * proc) {
 	return 0;
 }
 
+/**
+ * @brief Defer cleanup of a process that is still visible on another core.
+ *
+ * Pushes the process onto this core's retire list, a lock-free LIFO
+ * stack drained by @ref reap_retired when the core next goes idle.
+ * This used to funnel every deferred reap through a global list and
+ * lock, which fork-heavy workloads hammered from every core at once.
+ */
 void process_reap_later(process_t * proc) {
-	spin_lock(reap_lock);
-	/* See if we can delete anything */
-	while (reap_queue->head) {
-		process_t * proc = reap_queue->head->value;
-		if (!process_is_owned(proc)) {
-			free(list_dequeue(reap_queue));
-			process_reap(proc);
+	struct ProcessorLocal * local = &processor_local_data[this_core->cpu_id];
+	do {
+		proc->retire_next = local->retire_list;
+	} while (!__sync_bool_compare_and_swap(&local->retire_list, proc->retire_next, proc));
+}
+
+/**
+ * @brief Free retired processes that no core is still looking at.
+ *
+ * Detaches this core's entire retire list in one atomic exchange and
+ * reaps each entry, pushing back any process some other core still has
+ * as its current or previous process - those get another chance on the
+ * next pass through idle.
+ */
+static void reap_retired(void) {
+	struct ProcessorLocal * local = &processor_local_data[this_core->cpu_id];
+	if (!local->retire_list) return;
+	process_t * proc = __sync_lock_test_and_set(&local->retire_list, NULL);
+	while (proc) {
+		process_t * next = proc->retire_next;
+		if (process_is_owned(proc)) {
+			do {
+				proc->retire_next = local->retire_list;
+			} while (!__sync_bool_compare_and_swap(&local->retire_list, proc->retire_next, proc));
 		} else {
-			break;
+			process_reap(proc);
 		}
+		proc = next;
 	}
-	/* And delete this thing later */
-	list_insert(reap_queue, proc);
-	spin_unlock(reap_lock);
 }
 
 /**
@@ -604,6 +701,7 @@ void process_delete(process_t * proc) {
 	int has_children = entry->children->length;
 	tree_remove_reparent_root(process_tree, entry);
 	list_delete(process_list, list_find(process_list, proc));
+	hashmap_remove(process_hash, (void*)(uintptr_t)proc->id);
 	spin_unlock(tree_lock);
 
 	if (has_children) {
@@ -636,6 +734,89 @@ void process_delete(process_t * proc) {
 	process_reap(proc);
 }
 
+/**
+ * @brief Order two sleepers by wake time.
+ *
+ * @returns non-zero if @p a wakes strictly before @p b.
+ */
+static int sleeper_before(sleeper_t * a, sleeper_t * b) {
+	return (a->end_tick < b->end_tick) ||
+	       (a->end_tick == b->end_tick && a->end_subtick < b->end_subtick);
+}
+
+static void sleep_heap_sift_up(size_t i) {
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!sleeper_before(sleep_heap[i], sleep_heap[parent])) break;
+		sleeper_t * tmp = sleep_heap[i];
+		sleep_heap[i] = sleep_heap[parent];
+		sleep_heap[parent] = tmp;
+		sleep_heap[i]->heap_index = i;
+		sleep_heap[parent]->heap_index = parent;
+		i = parent;
+	}
+}
+
+static void sleep_heap_sift_down(size_t i) {
+	while (1) {
+		size_t left = i * 2 + 1;
+		size_t right = left + 1;
+		size_t smallest = i;
+		if (left < sleep_heap_length && sleeper_before(sleep_heap[left], sleep_heap[smallest])) smallest = left;
+		if (right < sleep_heap_length && sleeper_before(sleep_heap[right], sleep_heap[smallest])) smallest = right;
+		if (smallest == i) break;
+		sleeper_t * tmp = sleep_heap[i];
+		sleep_heap[i] = sleep_heap[smallest];
+		sleep_heap[smallest] = tmp;
+		sleep_heap[i]->heap_index = i;
+		sleep_heap[smallest]->heap_index = smallest;
+		i = smallest;
+	}
+}
+
+/**
+ * @brief Arm a timed sleep.
+ *
+ * Caller must hold @c sleep_lock.
+ */
+static void sleep_heap_insert(sleeper_t * sleeper) {
+	if (sleep_heap_length == sleep_heap_capacity) {
+		sleep_heap_capacity = sleep_heap_capacity ? sleep_heap_capacity * 2 : 64;
+		sleep_heap = realloc(sleep_heap, sleep_heap_capacity * sizeof(sleeper_t *));
+	}
+	sleeper->heap_index = sleep_heap_length;
+	sleep_heap[sleep_heap_length++] = sleeper;
+	sleep_heap_sift_up(sleeper->heap_index);
+}
+
+/**
+ * @brief Disarm a timed sleep that has not yet fired.
+ *
+ * Caller must hold @c sleep_lock. The sleeper is not freed.
+ */
+static void sleep_heap_remove(sleeper_t * sleeper) {
+	size_t i = sleeper->heap_index;
+	if (i == (size_t)-1) return;
+	sleeper->heap_index = (size_t)-1;
+	sleep_heap_length--;
+	if (i == sleep_heap_length) return;
+	sleep_heap[i] = sleep_heap[sleep_heap_length];
+	sleep_heap[i]->heap_index = i;
+	sleep_heap_sift_down(i);
+	sleep_heap_sift_up(i);
+}
+
+/**
+ * @brief Total number of ready processes queued for a core.
+ */
+static size_t sched_queue_depth(struct ProcessorLocal * core) {
+	size_t depth = 0;
+	for (int p = 0; p < SCHED_PRIORITY_LEVELS; ++p) {
+		depth += core->sched_queue[p]->length;
+	}
+	return depth;
+}
+
 /**
  * @brief Place an available process in the ready queue.
  *
@@ -648,62 +829,104 @@ void process_delete(process_t * proc) {
  * queue before it is placed in the ready queue.
  */
 void make_process_ready(volatile process_t * proc) {
-	if (proc->sleep_node.owner != NULL) {
+	list_t * sleep_owner = (list_t*)proc->sleep_node.owner;
+	if (sleep_owner == SLEEP_QUEUE_OWNER) {
+		/* The timed sleep heap is slightly special... */
 		int sleep_lock_is_mine = sleep_lock.owner == (this_core->cpu_id + 1);
 		if (!sleep_lock_is_mine) spin_lock(sleep_lock);
-		if (proc->sleep_node.owner == sleep_queue) {
-			/* The sleep queue is slightly special... */
-			if (proc->timed_sleep_node) {
-				list_delete(sleep_queue, proc->timed_sleep_node);
-				proc->sleep_node.owner = NULL;
-				free(proc->timed_sleep_node->value);
-			}
-		} else {
-			/* This was blocked on a semaphore we can interrupt. */
-			__sync_or_and_fetch(&proc->flags, PROC_FLAG_SLEEP_INT);
-			list_delete((list_t*)proc->sleep_node.owner, (node_t*)&proc->sleep_node);
+		if (proc->timed_sleep_node) {
+			sleep_heap_remove(proc->timed_sleep_node);
+			proc->sleep_node.owner = NULL;
+			proc->timed_sleep_node = NULL;
 		}
 		if (!sleep_lock_is_mine) spin_unlock(sleep_lock);
+	} else if (sleep_owner) {
+		/* This was blocked on a semaphore we can interrupt. Take the
+		 * queue's lock and make sure no one woke it in the meantime. */
+		spin_lock_t * wait_lock = wait_lock_for(sleep_owner);
+		spin_lock(*wait_lock);
+		if (proc->sleep_node.owner == sleep_owner) {
+			__sync_or_and_fetch(&proc->flags, PROC_FLAG_SLEEP_INT);
+			list_delete(sleep_owner, (node_t*)&proc->sleep_node);
+		}
+		spin_unlock(*wait_lock);
+	}
+
+	/* Ready processes go to the queue of the core that last ran them,
+	 * which keeps their working set close; idle cores will steal them
+	 * if that core is too busy to get to them. */
+	struct ProcessorLocal * target = &processor_local_data[proc->owner];
+
+	if (proc->cpu_affinity && !(proc->cpu_affinity & (1U << proc->owner))) {
+		/* The last core is no longer in the affinity mask; place the
+		 * process on the least-loaded core it is still allowed on. */
+		target = NULL;
+		for (int i = 0; i < processor_count; ++i) {
+			if (!(proc->cpu_affinity & (1U << i))) continue;
+			if (!target || sched_queue_depth(&processor_local_data[i]) < sched_queue_depth(target)) {
+				target = &processor_local_data[i];
+			}
+		}
+		/* An affinity mask that excludes every core is ignored. */
+		if (!target) target = &processor_local_data[proc->owner];
 	}
 
-	spin_lock(process_queue_lock);
+	spin_lock(target->sched_lock);
 	if (proc->sched_node.owner) {
-		/* There's only one ready queue, so this means the process was already ready, which
-		 * is indicative of a bug somewhere as we shouldn't be added processes to the ready
-		 * queue multiple times. */
-		spin_unlock(process_queue_lock);
+		/* If the process is already sitting in a ready queue, something
+		 * has gone wrong, as we shouldn't be adding processes to ready
+		 * queues multiple times. */
+		spin_unlock(target->sched_lock);
 		return;
 	}
 
-	list_append(process_queue, (node_t*)&proc->sched_node);
-	spin_unlock(process_queue_lock);
-
-	arch_wakeup_others();
+	proc->time_ready = arch_perf_timer();
+	list_append(target->sched_queue[proc->priority], (node_t*)&proc->sched_node);
+	spin_unlock(target->sched_lock);
+
+	/* Nudge the target core, but only if it is idle and doesn't already
+	 * have a wakeup in flight; busy cores will find the process at their
+	 * next reschedule anyway. This coalesces bursts of wakeups - common
+	 * under network load - into a single directed IPI per idle core,
+	 * instead of broadcasting to everyone on every enqueue. */
+	if (target != &processor_local_data[this_core->cpu_id] &&
+	    target->current_process == target->kernel_idle_task &&
+	    !__sync_lock_test_and_set(&target->wakeup_pending, 1)) {
+		arch_wakeup_core(target->cpu_id);
+	}
 }
 
 /**
- * @brief Pop the next available process from the queue.
+ * @brief Pop the next available process from a core's ready queue.
  *
- * Gets the next available process from the round-robin scheduling
- * queue. If there is no process to run, the idle task is returned.
+ * Dequeues from the head of @p core's ready queue, with the same
+ * round-robin semantics the old global queue had. The caller must
+ * hold the queue's @c sched_lock; it is released before returning.
  *
- * TODO This needs more locking for SMP...
+ * @returns the next process, or NULL if the queue was empty or the
+ *          head was a process another core has not yet switched from.
  */
-volatile process_t * next_ready_process(void) {
-	spin_lock(process_queue_lock);
-
-	if (!process_queue->head) {
-		if (process_queue->length) {
+static volatile process_t * sched_pop(struct ProcessorLocal * core) {
+	list_t * queue = NULL;
+	for (int p = 0; p < SCHED_PRIORITY_LEVELS; ++p) {
+		if (core->sched_queue[p]->head) {
+			queue = core->sched_queue[p];
+			break;
+		}
+		if (core->sched_queue[p]->length) {
 			arch_fatal_prepare();
 			printf("Queue has a length but head is NULL\n");
 			arch_dump_traceback();
 			arch_fatal();
 		}
-		spin_unlock(process_queue_lock);
-		return this_core->kernel_idle_task;
 	}
 
-	node_t * np = list_dequeue(process_queue);
+	if (!queue) {
+		spin_unlock(core->sched_lock);
+		return NULL;
+	}
+
+	node_t * np = list_dequeue(queue);
 
 	if ((uintptr_t)np < 0xFFFFff0000000000UL || (uintptr_t)np > 0xFFFFfff000000000UL) {
 		arch_fatal_prepare();
@@ -713,22 +936,118 @@ volatile process_t * next_ready_process(void) {
 	}
 	volatile process_t * next = np->value;
 
+	if (next->cpu_affinity && !(next->cpu_affinity & (1U << this_core->cpu_id))) {
+		/* The process was repinned while it sat in this queue; send it
+		 * to a core it is actually allowed on rather than spinning on it. */
+		spin_unlock(core->sched_lock);
+		make_process_ready(next);
+		return NULL;
+	}
+
 	if ((next->flags & PROC_FLAG_RUNNING) && (next->owner != this_core->cpu_id)) {
-		/* We pulled a process too soon, switch to idle for a bit so the
-		 * core that marked this process as ready can finish switching away from it. */
-		list_append(process_queue, (node_t*)&next->sched_node);
-		spin_unlock(process_queue_lock);
-		return this_core->kernel_idle_task;
+		/* We pulled a process too soon, put it back and let the core that
+		 * marked this process as ready finish switching away from it. */
+		list_append(queue, (node_t*)&next->sched_node);
+		spin_unlock(core->sched_lock);
+		return NULL;
 	}
 
-	spin_unlock(process_queue_lock);
+	spin_unlock(core->sched_lock);
 
 	__sync_or_and_fetch(&next->flags, PROC_FLAG_RUNNING);
 	next->owner = this_core->cpu_id;
 
+	next->sched_count++;
+	if (next->time_ready) {
+		uint64_t now = arch_perf_timer();
+		if (next->time_ready < now) next->time_waited += now - next->time_ready;
+		next->time_ready = 0;
+	}
+
 	return next;
 }
 
+/**
+ * @brief Whether this core has anything queued to run.
+ *
+ * Used by the interrupt return path to decide if the idle task
+ * should yield. Safe to call before the scheduler is initialized.
+ */
+int process_queue_has_work(void) {
+	struct ProcessorLocal * local = &processor_local_data[this_core->cpu_id];
+	for (int p = 0; p < SCHED_PRIORITY_LEVELS; ++p) {
+		if (local->sched_queue[p] && local->sched_queue[p]->head) return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Pop the next available process from the queue.
+ *
+ * Gets the next available process from this core's ready queues.
+ * If the local queues are empty, the other cores' queues are examined,
+ * and work is stolen from the one with the longest backlog. If there
+ * is no process to run anywhere, the idle task is returned.
+ */
+volatile process_t * next_ready_process(void) {
+	struct ProcessorLocal * local = &processor_local_data[this_core->cpu_id];
+	spin_lock(local->sched_lock);
+	volatile process_t * next = sched_pop(local);
+	if (next) return next;
+
+	/* Local queues were empty; find the busiest core. A racy read of
+	 * the queue lengths is fine here - if we lose a candidate we'll
+	 * catch it on the next pass through the idle task. */
+	struct ProcessorLocal * victim = NULL;
+	size_t victim_depth = 0;
+	for (int i = 0; i < processor_count; ++i) {
+		if (i == this_core->cpu_id) continue;
+		size_t depth = sched_queue_depth(&processor_local_data[i]);
+		if (depth > victim_depth) {
+			victim = &processor_local_data[i];
+			victim_depth = depth;
+		}
+	}
+
+	if (victim) {
+		spin_lock(victim->sched_lock);
+		next = sched_pop(victim);
+		if (next) {
+			this_core->sched_steal_count++;
+			return next;
+		}
+	}
+
+	return this_core->kernel_idle_task;
+}
+
+/**
+ * @brief Change a process's scheduler priority class.
+ *
+ * The new class applies the next time the process is placed in a
+ * ready queue; we don't bother moving it if it is already queued.
+ */
+long process_set_priority(process_t * proc, int priority) {
+	if (priority < 0) priority = 0;
+	if (priority >= SCHED_PRIORITY_LEVELS) priority = SCHED_PRIORITY_LEVELS - 1;
+	proc->priority = priority;
+	return 0;
+}
+
+/**
+ * @brief Restrict a process to a set of cores.
+ *
+ * A mask of 0 clears the restriction. If the process is already
+ * queued on a disallowed core, the pick-next path will reroute it;
+ * if it is running on one, it moves at its next reschedule.
+ */
+long process_set_affinity(process_t * proc, uint32_t mask) {
+	uint32_t possible = (processor_count >= 32) ? 0xFFFFFFFFU : ((1U << processor_count) - 1);
+	if (mask & ~possible) return -EINVAL;
+	proc->cpu_affinity = mask;
+	return 0;
+}
+
 /**
  * @brief Signal a semaphore.
  *
@@ -749,7 +1068,8 @@ volatile process_t * next_ready_process(void) {
  */
 int wakeup_queue(list_t * queue) {
 	int awoken_processes = 0;
-	spin_lock(wait_lock_tmp);
+	spin_lock_t * wait_lock = wait_lock_for(queue);
+	spin_lock(*wait_lock);
 	while (queue->length > 0) {
 		node_t * node = list_pop(queue);
 		if (!(((process_t *)node->value)->flags & PROC_FLAG_FINISHED)) {
@@ -757,7 +1077,7 @@ int wakeup_queue(list_t * queue) {
 		}
 		awoken_processes++;
 	}
-	spin_unlock(wait_lock_tmp);
+	spin_unlock(*wait_lock);
 	return awoken_processes;
 }
 
@@ -773,7 +1093,8 @@ int wakeup_queue(list_t * queue) {
  */
 int wakeup_queue_interrupted(list_t * queue) {
 	int awoken_processes = 0;
-	spin_lock(wait_lock_tmp);
+	spin_lock_t * wait_lock = wait_lock_for(queue);
+	spin_lock(*wait_lock);
 	while (queue->length > 0) {
 		node_t * node = list_pop(queue);
 		if (!(((process_t *)node->value)->flags & PROC_FLAG_FINISHED)) {
@@ -783,13 +1104,14 @@ int wakeup_queue_interrupted(list_t * queue) {
 		}
 		awoken_processes++;
 	}
-	spin_unlock(wait_lock_tmp);
+	spin_unlock(*wait_lock);
 	return awoken_processes;
 }
 
 int wakeup_queue_one(list_t * queue) {
 	int awoken_processes = 0;
-	spin_lock(wait_lock_tmp);
+	spin_lock_t * wait_lock = wait_lock_for(queue);
+	spin_lock(*wait_lock);
 	if (queue->length > 0) {
 		node_t * node = list_pop(queue);
 		if (!(((process_t *)node->value)->flags & PROC_FLAG_FINISHED)) {
@@ -797,7 +1119,7 @@ int wakeup_queue_one(list_t * queue) {
 		}
 		awoken_processes++;
 	}
-	spin_unlock(wait_lock_tmp);
+	spin_unlock(*wait_lock);
 	return awoken_processes;
 }
 
@@ -814,18 +1136,20 @@ int sleep_on(list_t * queue) {
 		return 0;
 	}
 	__sync_and_and_fetch(&this_core->current_process->flags, ~(PROC_FLAG_SLEEP_INT));
-	spin_lock(wait_lock_tmp);
+	spin_lock_t * wait_lock = wait_lock_for(queue);
+	spin_lock(*wait_lock);
 	list_append(queue, (node_t*)&this_core->current_process->sleep_node);
-	spin_unlock(wait_lock_tmp);
+	spin_unlock(*wait_lock);
 	switch_task(0);
 	return !!(this_core->current_process->flags & PROC_FLAG_SLEEP_INT);
 }
 
 int sleep_on_unlocking(list_t * queue, spin_lock_t * release) {
 	__sync_and_and_fetch(&this_core->current_process->flags, ~(PROC_FLAG_SLEEP_INT));
-	spin_lock(wait_lock_tmp);
+	spin_lock_t * wait_lock = wait_lock_for(queue);
+	spin_lock(*wait_lock);
 	list_append(queue, (node_t*)&this_core->current_process->sleep_node);
-	spin_unlock(wait_lock_tmp);
+	spin_unlock(*wait_lock);
 
 	spin_unlock(*release);
 
@@ -852,29 +1176,20 @@ int process_alert_node_locked(process_t * process, void * value);
  */
 void wakeup_sleepers(unsigned long seconds, unsigned long subseconds) {
 	spin_lock(sleep_lock);
-	if (sleep_queue->length) {
-		sleeper_t * proc = ((sleeper_t *)sleep_queue->head->value);
-		while (proc && (proc->end_tick < seconds || (proc->end_tick == seconds && proc->end_subtick <= subseconds))) {
-
-			if (proc->is_fswait) {
-				proc->is_fswait = -1;
-				process_alert_node_locked(proc->process,proc);
-			} else {
-				process_t * process = proc->process;
-				process->sleep_node.owner = NULL;
-				process->timed_sleep_node = NULL;
-				if (!process_is_ready(process)) {
-					spin_lock(wait_lock_tmp);
-					make_process_ready(process);
-					spin_unlock(wait_lock_tmp);
-				}
-			}
-			free(proc);
-			free(list_dequeue(sleep_queue));
-			if (sleep_queue->length) {
-				proc = ((sleeper_t *)sleep_queue->head->value);
-			} else {
-				break;
+	while (sleep_heap_length) {
+		sleeper_t * proc = sleep_heap[0];
+		if (proc->end_tick > seconds || (proc->end_tick == seconds && proc->end_subtick > subseconds)) break;
+		sleep_heap_remove(proc);
+
+		if (proc->is_fswait) {
+			proc->is_fswait = -1;
+			process_alert_node_locked(proc->process,proc);
+		} else {
+			process_t * process = proc->process;
+			process->sleep_node.owner = NULL;
+			process->timed_sleep_node = NULL;
+			if (!process_is_ready(process)) {
+				make_process_ready(process);
 			}
 		}
 	}
@@ -895,46 +1210,25 @@ void sleep_until(process_t * process, unsigned long seconds, unsigned long subse
 		/* Can't sleep, sleeping already */
 		return;
 	}
-	process->sleep_node.owner = sleep_queue;
+	process->sleep_node.owner = SLEEP_QUEUE_OWNER;
 
-	node_t * before = NULL;
-	foreach(node, sleep_queue) {
-		sleeper_t * candidate = ((sleeper_t *)node->value);
-		if (!candidate) {
-			printf("null candidate?\n");
-			continue;
-		}
-		if (candidate->end_tick > seconds || (candidate->end_tick == seconds && candidate->end_subtick > subseconds)) {
-			break;
-		}
-		before = node;
-	}
-	sleeper_t * proc = malloc(sizeof(sleeper_t));
+	sleeper_t * proc = &process->timeout_sleeper;
 	proc->process     = process;
 	proc->end_tick    = seconds;
 	proc->end_subtick = subseconds;
 	proc->is_fswait = 0;
-	process->timed_sleep_node = list_insert_after(sleep_queue, before, proc);
+	sleep_heap_insert(proc);
+	process->timed_sleep_node = proc;
 	spin_unlock(sleep_lock);
 }
 
-uint8_t process_compare(void * proc_v, void * pid_v) {
-	pid_t pid = (*(pid_t *)pid_v);
-	process_t * proc = (process_t *)proc_v;
-
-	return (uint8_t)(proc->id == pid);
-}
-
 process_t * process_from_pid(pid_t pid) {
 	if (pid < 0) return NULL;
 
 	spin_lock(tree_lock);
-	tree_node_t * entry = tree_find(process_tree,&pid,process_compare);
+	process_t * proc = hashmap_get(process_hash, (void*)(uintptr_t)pid);
 	spin_unlock(tree_lock);
-	if (entry) {
-		return (process_t *)entry->value;
-	}
-	return NULL;
+	return proc;
 }
 
 
@@ -1045,7 +1339,7 @@ int waitpid(int pid, int * status, int options) {
 			int pid = candidate->id;
 			if (is_parent && (candidate->flags & PROC_FLAG_FINISHED)) {
 				while (*((volatile int *)&candidate->flags) & PROC_FLAG_RUNNING);
-				proc->time_children += candidate->time_children + candidate->time_total;
+				proc->time_children += candidate->time_children + (candidate->time_total - candidate->time_sys);
 				proc->time_sys_children += candidate->time_sys_children + candidate->time_sys;
 				process_delete((process_t*)candidate);
 			}
@@ -1063,25 +1357,36 @@ int waitpid(int pid, int * status, int options) {
 	} while (1);
 }
 
+/**
+ * @brief Record one thing an fswait call is waiting on.
+ *
+ * Appends @p value to the process's list of watched nodes, so that a
+ * later @ref process_alert_node with the same value wakes it. The list
+ * entry comes from the process's spare pool when one is available;
+ * the pool only grows when a process waits on more things at once than
+ * it ever has before, so steady-state fswait traffic never allocates.
+ */
+void process_wait_node(process_t * process, void * value) {
+	node_t * node = list_dequeue(&process->fswait_spares);
+	if (!node) {
+		node = malloc(sizeof(node_t));
+	}
+	node->value = value;
+	list_append(process->node_waits, node);
+}
+
 int process_timeout_sleep(process_t * process, int timeout) {
 	unsigned long s, ss;
 	relative_time(0, timeout * 1000, &s, &ss);
 
-	node_t * before = NULL;
-	foreach(node, sleep_queue) {
-		sleeper_t * candidate = ((sleeper_t *)node->value);
-		if (candidate->end_tick > s || (candidate->end_tick == s && candidate->end_subtick > ss)) {
-			break;
-		}
-		before = node;
-	}
-	sleeper_t * proc = malloc(sizeof(sleeper_t));
+	sleeper_t * proc = &process->timeout_sleeper;
 	proc->process     = process;
 	proc->end_tick    = s;
 	proc->end_subtick = ss;
 	proc->is_fswait = 1;
-	list_insert(((process_t *)process)->node_waits, proc);
-	process->timeout_node = list_insert_after(sleep_queue, before, proc);
+	process_wait_node(process, proc);
+	sleep_heap_insert(proc);
+	process->timeout_node = proc;
 
 	return 0;
 }
@@ -1111,7 +1416,12 @@ int process_wait_nodes(process_t * process,fs_node_t * nodes[], int timeout) {
 
 	spin_lock(sleep_lock);
 	spin_lock(process->sched_lock);
-	process->node_waits = list_create("process fswaiters",process);
+	process->fswait_waiting.head = NULL;
+	process->fswait_waiting.tail = NULL;
+	process->fswait_waiting.length = 0;
+	process->fswait_waiting.name = "process fswaiters";
+	process->fswait_waiting.metadata = process;
+	process->node_waits = &process->fswait_waiting;
 	if (*n) {
 		do {
 			if (selectwait_fs(*n, process) < 0) {
@@ -1141,23 +1451,22 @@ int process_awaken_from_fswait(process_t * process, int index) {
 	must_have_lock(sleep_lock);
 
 	process->awoken_index = index;
-	list_free(process->node_waits);
-	free(process->node_waits);
+	/* Return the wait entries to the spare pool; this can run from a
+	 * device's interrupt handler, so nothing is freed here. */
+	while (process->node_waits->head) {
+		list_append(&process->fswait_spares, list_dequeue(process->node_waits));
+	}
 	process->node_waits = NULL;
 
-	if (process->timeout_node && process->timeout_node->owner == sleep_queue) {
-		sleeper_t * proc = process->timeout_node->value;
+	if (process->timeout_node) {
+		sleeper_t * proc = process->timeout_node;
 		if (proc->is_fswait != -1) {
-			list_delete(sleep_queue, process->timeout_node);
-			free(process->timeout_node->value);
-			free(process->timeout_node);
+			sleep_heap_remove(proc);
 		}
 	}
 	process->timeout_node = NULL;
 
-	spin_lock(wait_lock_tmp);
 	make_process_ready(process);
-	spin_unlock(wait_lock_tmp);
 	spin_unlock(process->sched_lock);
 	return 0;
 }
@@ -1207,6 +1516,77 @@ int process_alert_node(process_t * process, void * value) {
 	return result;
 }
 
+/**
+ * @brief Set up a device-side fswait alert queue.
+ *
+ * @p queue is typically embedded in the device's own structure;
+ * @p name and @p owner serve the same debugging role as they do
+ * for @ref list_create.
+ */
+void fswait_queue_init(fswait_queue_t * queue, const char * name, const void * owner) {
+	queue->waiters.head = NULL;
+	queue->waiters.tail = NULL;
+	queue->waiters.length = 0;
+	queue->waiters.name = name;
+	queue->waiters.metadata = owner;
+	queue->spares = queue->waiters;
+	spin_init(queue->lock);
+}
+
+/**
+ * @brief Register @p process on an alert queue.
+ *
+ * Called from a device's selectwait handler. A future
+ * @ref fswait_queue_alert will wake the process with @p value, which
+ * must match what the device passes there. The waiter entry is drawn
+ * from the queue's spare pool when one is available.
+ */
+void fswait_queue_wait(fswait_queue_t * queue, process_t * process, void * value) {
+	spin_lock(queue->lock);
+	if (!list_find(&queue->waiters, process)) {
+		node_t * node = list_dequeue(&queue->spares);
+		if (!node) {
+			node = malloc(sizeof(node_t));
+		}
+		node->value = process;
+		list_append(&queue->waiters, node);
+	}
+	spin_unlock(queue->lock);
+	process_wait_node(process, value);
+}
+
+/**
+ * @brief Wake every process registered on an alert queue.
+ *
+ * Safe to call from interrupt context: retired waiter entries go back
+ * on the spare pool rather than to the allocator. The queue's lock is
+ * released around each wakeup, as @ref process_alert_node takes the
+ * scheduler's sleep lock.
+ */
+void fswait_queue_alert(fswait_queue_t * queue, void * value) {
+	spin_lock(queue->lock);
+	while (queue->waiters.head) {
+		node_t * node = list_dequeue(&queue->waiters);
+		process_t * p = node->value;
+		list_append(&queue->spares, node);
+		spin_unlock(queue->lock);
+		process_alert_node(p, value);
+		spin_lock(queue->lock);
+	}
+	spin_unlock(queue->lock);
+}
+
+/**
+ * @brief Tear down an alert queue, waking anyone still on it.
+ */
+void fswait_queue_destroy(fswait_queue_t * queue, void * value) {
+	fswait_queue_alert(queue, value);
+	list_free(&queue->spares);
+	queue->spares.head = NULL;
+	queue->spares.tail = NULL;
+	queue->spares.length = 0;
+}
+
 process_t * process_get_parent(process_t * process) {
 	process_t * result = NULL;
 	spin_lock(tree_lock);
@@ -1231,10 +1611,12 @@ void task_exit(int retval) {
 	free(this_core->current_process->signal_queue);
 	free(this_core->current_process->wd_name);
 	if (this_core->current_process->node_waits) {
-		list_free(this_core->current_process->node_waits);
-		free(this_core->current_process->node_waits);
+		while (this_core->current_process->node_waits->head) {
+			list_append((list_t*)&this_core->current_process->fswait_spares, list_dequeue(this_core->current_process->node_waits));
+		}
 		this_core->current_process->node_waits = NULL;
 	}
+	list_free((list_t*)&this_core->current_process->fswait_spares);
 
 	if (this_core->current_process->fds) {
 		spin_lock(this_core->current_process->fds->lock);
@@ -1264,7 +1646,7 @@ void task_exit(int retval) {
 			free(n);
 			if (is_valid_process(tracee)) {
 				tracee->tracer = 0;
-				__sync_and_and_fetch(&tracee->flags, ~(PROC_FLAG_TRACE_SIGNALS | PROC_FLAG_TRACE_SYSCALLS));
+				__sync_and_and_fetch(&tracee->flags, ~(PROC_FLAG_TRACE_SIGNALS | PROC_FLAG_TRACE_SYSCALLS | PROC_FLAG_TRACE_RECORD));
 				if (tracee->flags & PROC_FLAG_SUSPENDED) {
 					tracee->status = 0;
 					__sync_and_and_fetch(&tracee->flags, ~(PROC_FLAG_SUSPENDED));
@@ -1312,6 +1694,20 @@ pid_t fork(void) {
 	new_proc->thread.page_directory->directory = directory;
 	spin_init(new_proc->thread.page_directory->lock);
 
+	/* The clone only copies present pages, so the child needs its own
+	 * reference to the demand-load state to fault in pages the parent
+	 * never touched. */
+	page_directory_t * parent_dir = parent->thread.page_directory;
+	new_proc->thread.page_directory->exec_node = parent_dir->exec_node ? clone_fs(parent_dir->exec_node) : NULL;
+	new_proc->thread.page_directory->exec_segment_count = parent_dir->exec_segment_count;
+	if (parent_dir->exec_segments) {
+		size_t segments_size = sizeof(exec_segment_t) * parent_dir->exec_segment_count;
+		new_proc->thread.page_directory->exec_segments = malloc(segments_size);
+		memcpy(new_proc->thread.page_directory->exec_segments, parent_dir->exec_segments, segments_size);
+	} else {
+		new_proc->thread.page_directory->exec_segments = NULL;
+	}
+
 	struct regs r;
 	memcpy(&r, parent->syscall_registers, sizeof(struct regs));
 	sp = new_proc->image.stack;
@@ -1368,8 +1764,93 @@ pid_t clone(uintptr_t new_stack, uintptr_t thread_func, uintptr_t arg) {
 	return new_proc->id;
 }
 
+/**
+ * Arguments handed to a spawned child; kernel-heap copies made by the
+ * spawn syscall, donated to the child.
+ */
+struct spawn_request {
+	char *  path;
+	int     argc;
+	char ** argv;
+	char ** envp;
+};
+
+/**
+ * First thing a spawned child runs, in kernel mode on its own stack:
+ * load the requested executable. @ref exec only returns on failure,
+ * and the parent already validated the file, so the fallback is just
+ * the traditional failed-to-launch exit status.
+ */
+static void spawn_entrypoint(void * argp) {
+	struct spawn_request * req = argp;
+	char path[1024];
+	int argc = req->argc;
+	char ** argv = req->argv;
+	char ** envp = req->envp;
+	strcpy(path, req->path);
+	free(req->path);
+	free(req);
+
+	this_core->current_process->cmdline = argv;
+	exec(path, argc, argv, envp, 0);
+	task_exit(127 << 8);
+}
+
+/**
+ * @brief Create a new process running a new executable.
+ *
+ * Combined fork+exec: since the child immediately replaces its image,
+ * there is no point cloning the parent's address space just to tear it
+ * down again, so the child starts from a bare kernel mapping and enters
+ * @ref exec through a small thunk. File descriptors, working directory,
+ * and credentials are inherited as with @ref fork, except that
+ * descriptors above stderr are closed to match the execve behavior.
+ *
+ * @p path, @p argv, and @p envp must be kernel-heap copies; they are
+ * owned by the child from here on.
+ *
+ * @returns the pid of the new process.
+ */
+pid_t spawn_exec(char * path, int argc, char ** argv, char ** envp) {
+	process_t * parent = (process_t *)this_core->current_process;
+	process_t * new_proc = spawn_process(parent, 0);
+
+	new_proc->thread.page_directory = malloc(sizeof(page_directory_t));
+	new_proc->thread.page_directory->refcount = 1;
+	new_proc->thread.page_directory->directory = mmu_clone(mmu_get_kernel_directory());
+	spin_init(new_proc->thread.page_directory->lock);
+	new_proc->thread.page_directory->exec_node = NULL;
+	new_proc->thread.page_directory->exec_segments = NULL;
+	new_proc->thread.page_directory->exec_segment_count = 0;
+
+	/* See the FIXME in sys_execve: everything above stderr is closed. */
+	for (unsigned int i = 3; i < new_proc->fds->length; ++i) {
+		if (new_proc->fds->entries[i]) {
+			close_fs(new_proc->fds->entries[i]);
+			new_proc->fds->entries[i] = NULL;
+		}
+	}
+
+	struct spawn_request * req = malloc(sizeof(struct spawn_request));
+	req->path = path;
+	req->argc = argc;
+	req->argv = argv;
+	req->envp = envp;
+
+	uintptr_t sp = new_proc->image.stack;
+	PUSH(sp, uintptr_t, (uintptr_t)spawn_entrypoint);
+	PUSH(sp, void*, req);
+	new_proc->thread.context.sp = sp;
+	new_proc->thread.context.bp = sp;
+	new_proc->thread.context.ip = (uintptr_t)&arch_enter_tasklet;
+
+	make_process_ready(new_proc);
+	return new_proc->id;
+}
+
 process_t * spawn_worker_thread(void (*entrypoint)(void * argp), const char * name, void * argp) {
-	process_t * proc = calloc(1,sizeof(process_t));
+	process_t * proc = slab_alloc(process_cache);
+	memset(proc, 0, sizeof(process_t));
 
 	proc->flags = PROC_FLAG_IS_TASKLET | PROC_FLAG_STARTED;
 
@@ -1387,11 +1868,15 @@ process_t * spawn_worker_thread(void (*entrypoint)(void * argp), const char * na
 	proc->mask        = 0;
 	proc->job         = proc->id;
 	proc->session     = proc->id;
+	proc->priority    = SCHED_PRIORITY_DEFAULT;
 
 	proc->thread.page_directory = malloc(sizeof(page_directory_t));
 	proc->thread.page_directory->refcount = 1;
 	proc->thread.page_directory->directory = mmu_clone(mmu_get_kernel_directory());
 	spin_init(proc->thread.page_directory->lock);
+	proc->thread.page_directory->exec_node = NULL;
+	proc->thread.page_directory->exec_segments = NULL;
+	proc->thread.page_directory->exec_segment_count = 0;
 
 	proc->image.stack       = (uintptr_t)valloc(KERNEL_STACK_SIZE) + KERNEL_STACK_SIZE;
 	PUSH(proc->image.stack, uintptr_t, (uintptr_t)entrypoint);
@@ -1416,6 +1901,7 @@ process_t * spawn_worker_thread(void (*entrypoint)(void * argp), const char * na
 	spin_lock(tree_lock);
 	tree_node_insert_child_node(process_tree, this_core->current_process->tree_entry, entry);
 	list_insert(process_list, (void*)proc);
+	hashmap_set(process_hash, (void*)(uintptr_t)proc->id, (void*)proc);
 	spin_unlock(tree_lock);
 
 	make_process_ready(proc);
@@ -20,6 +20,7 @@
 #include <kernel/syscall.h>
 #include <kernel/ptrace.h>
 #include <kernel/args.h>
+#include <kernel/time.h>
 
 #include <kernel/arch/x86_64/regs.h>
 #include <kernel/arch/x86_64/mmu.h>
@@ -147,6 +148,141 @@ long ptrace_poke(pid_t pid, void * addr, void * data) {
 	return 0;
 }
 
+/**
+ * @brief Binary syscall recording.
+ *
+ * PTRACE_RECORD turns on a mode where the tracee is never stopped:
+ * each syscall return appends a packed record to a per-tracee ring
+ * and execution continues immediately. The tracer drains the ring
+ * with PTRACE_READ_RECORDS whenever it gets around to it, so the
+ * only cost in the tracee's path is a few stores.
+ */
+#define PTRACE_RING_RECORDS 1024
+
+struct ptrace_ring {
+	uint64_t head;    /* Next record to write (only the tracee writes) */
+	uint64_t tail;    /* Next record to read (only the tracer writes) */
+	uint64_t dropped; /* Records lost since the last successful append */
+	struct ptrace_record records[PTRACE_RING_RECORDS];
+};
+
+void ptrace_record_syscall(struct regs * r, long result) {
+	struct ptrace_ring * ring = this_core->current_process->syscall_ring;
+	if (!ring) return;
+
+	if (ring->head - ring->tail >= PTRACE_RING_RECORDS) {
+		__sync_fetch_and_add(&ring->dropped, 1);
+		return;
+	}
+
+	struct ptrace_record * rec = &ring->records[ring->head % PTRACE_RING_RECORDS];
+	rec->tsc     = arch_perf_timer();
+	rec->args[0] = arch_syscall_arg0(r);
+	rec->args[1] = arch_syscall_arg1(r);
+	rec->args[2] = arch_syscall_arg2(r);
+	rec->args[3] = arch_syscall_arg3(r);
+	rec->args[4] = arch_syscall_arg4(r);
+	rec->result  = result;
+	rec->syscall = arch_syscall_number(r);
+	rec->unused  = 0;
+	rec->dropped = __sync_lock_test_and_set(&ring->dropped, 0);
+
+	/* Publish the record before moving the head past it */
+	__sync_synchronize();
+	ring->head++;
+}
+
+long ptrace_record(pid_t pid) {
+	process_t * tracer = (process_t *)this_core->current_process;
+	process_t * tracee = process_from_pid(pid);
+	if (!tracee) return -ESRCH;
+	if (tracer->user != 0 && tracer->user != tracee->user) return -EPERM;
+
+	if (!tracee->syscall_ring) {
+		struct ptrace_ring * ring = malloc(sizeof(struct ptrace_ring));
+		memset(ring, 0, sizeof(struct ptrace_ring));
+		tracee->syscall_ring = ring;
+	}
+
+	spin_lock(tracer->wait_lock);
+	if (!tracer->tracees) {
+		tracer->tracees = list_create("debug tracees", tracer);
+	}
+	list_insert(tracer->tracees, tracee);
+	tracee->tracer = tracer->id;
+	spin_unlock(tracer->wait_lock);
+
+	__sync_or_and_fetch(&tracee->flags, PROC_FLAG_TRACE_RECORD);
+
+	return 0;
+}
+
+long ptrace_read_records(pid_t pid, size_t count, void * data) {
+	if (!data || ptr_validate(data, "ptrace")) return -EFAULT;
+	process_t * tracee = process_from_pid(pid);
+	if (!tracee || (tracee->tracer != this_core->current_process->id)) return -ESRCH;
+
+	struct ptrace_ring * ring = tracee->syscall_ring;
+	if (!ring) return -EINVAL;
+
+	struct ptrace_record * out = data;
+	size_t copied = 0;
+	while (copied < count && ring->tail != ring->head) {
+		out[copied] = ring->records[ring->tail % PTRACE_RING_RECORDS];
+		__sync_synchronize();
+		ring->tail++;
+		copied++;
+	}
+
+	return copied;
+}
+
+/**
+ * @brief Arm a hardware breakpoint or watchpoint in the tracee.
+ *
+ * Stores the address in one of the four debug address slots and
+ * builds the matching DR7 fields; the registers themselves are
+ * loaded when the tracee is next scheduled. @p config packs the
+ * slot, condition, and length as described in sys/ptrace.h.
+ */
+long ptrace_sethwbreak(pid_t pid, void * addr, int config) {
+	process_t * tracee = process_from_pid(pid);
+	if (!tracee || (tracee->tracer != this_core->current_process->id) || !(tracee->flags & PROC_FLAG_SUSPENDED)) return -ESRCH;
+
+	int slot = config & 3;
+	uintptr_t type = (config >> 2) & 3;
+	uintptr_t len  = (config >> 4) & 3;
+
+	/* Execute breakpoints require a length of one */
+	if (type == 0 && len != 0) return -EINVAL;
+	/* 10 is "undefined", not "read" */
+	if (type == 2) return -EINVAL;
+
+	tracee->thread.debug_addr[slot] = (uintptr_t)addr;
+
+	uintptr_t dr7 = tracee->thread.debug_ctl;
+	dr7 &= ~((3UL << (slot * 2)) | (0xFUL << (16 + slot * 4)));
+	dr7 |= (1UL << (slot * 2));           /* Local enable */
+	dr7 |= (type << (16 + slot * 4));
+	dr7 |= (len  << (18 + slot * 4));
+	tracee->thread.debug_ctl = dr7;
+
+	return 0;
+}
+
+long ptrace_clearhwbreak(pid_t pid, int slot) {
+	process_t * tracee = process_from_pid(pid);
+	if (!tracee || (tracee->tracer != this_core->current_process->id) || !(tracee->flags & PROC_FLAG_SUSPENDED)) return -ESRCH;
+	if (slot < 0 || slot > 3) return -EINVAL;
+
+	uintptr_t dr7 = tracee->thread.debug_ctl;
+	dr7 &= ~((3UL << (slot * 2)) | (0xFUL << (16 + slot * 4)));
+	tracee->thread.debug_ctl = dr7;
+	tracee->thread.debug_addr[slot] = 0;
+
+	return 0;
+}
+
 long ptrace_signals_only(pid_t pid) {
 	process_t * tracee = process_from_pid(pid);
 	if (!tracee || (tracee->tracer != this_core->current_process->id) || !(tracee->flags & PROC_FLAG_SUSPENDED)) return -ESRCH;
@@ -188,6 +324,14 @@ long ptrace_handle(long request, pid_t pid, void * addr, void * data) {
 			return ptrace_signals_only(pid);
 		case PTRACE_SINGLESTEP:
 			return ptrace_singlestep(pid,(uintptr_t)data);
+		case PTRACE_RECORD:
+			return ptrace_record(pid);
+		case PTRACE_READ_RECORDS:
+			return ptrace_read_records(pid,(uintptr_t)addr,data);
+		case PTRACE_SETHWBREAK:
+			return ptrace_sethwbreak(pid,addr,(uintptr_t)data);
+		case PTRACE_CLEARHWBREAK:
+			return ptrace_clearhwbreak(pid,(uintptr_t)data);
 		default:
 			return -EINVAL;
 	}
@@ -103,22 +103,47 @@ static shm_chunk_t * create_chunk (shm_node_t * parent, size_t size) {
 	chunk->ref_count = 1;
 
 	chunk->num_frames = (size / 0x1000) + ((size % 0x1000) ? 1 : 0);
+	chunk->capacity = chunk->num_frames;
 	chunk->frames = malloc(sizeof(uintptr_t) * chunk->num_frames);
 	if (chunk->frames == NULL) {
 		free(chunk);
 		return NULL;
 	}
 
-	/* Now grab some frames for this guy. */
+	/* Frames are populated on first touch by @ref shm_demand_fault, so
+	 * a multi-megabyte chunk costs only its bookkeeping until someone
+	 * actually writes to it. */
 	for (uint32_t i = 0; i < chunk->num_frames; i++) {
-		/* Allocate frame */
-		uintptr_t index = mmu_allocate_a_frame();
-		chunk->frames[i] = index;
+		chunk->frames[i] = SHM_FRAME_UNSET;
 	}
 
 	return chunk;
 }
 
+/**
+ * @brief Grow or shrink a chunk in place.
+ *
+ * Growth adds lazily-populated slots. Shrinking just trims the logical
+ * size: existing mappings of the larger chunk stay valid, so populated
+ * frames past the new end are kept until the last reference goes away.
+ */
+static void resize_chunk (shm_chunk_t * chunk, size_t size) {
+	size_t num_frames = (size / 0x1000) + ((size % 0x1000) ? 1 : 0);
+
+	if (num_frames > chunk->capacity) {
+		uintptr_t * frames = malloc(sizeof(uintptr_t) * num_frames);
+		memcpy(frames, chunk->frames, sizeof(uintptr_t) * chunk->capacity);
+		for (size_t i = chunk->capacity; i < num_frames; i++) {
+			frames[i] = SHM_FRAME_UNSET;
+		}
+		free(chunk->frames);
+		chunk->frames = frames;
+		chunk->capacity = num_frames;
+	}
+
+	chunk->num_frames = num_frames;
+}
+
 static int release_chunk (shm_chunk_t * chunk) {
 	if (chunk) {
 		chunk->ref_count--;
@@ -129,8 +154,10 @@ static int release_chunk (shm_chunk_t * chunk) {
 			debug_print(INFO, "Freeing chunk with name %s", chunk->parent->name);
 #endif
 
-			/* First, free the frames used by this chunk */
-			for (uint32_t i = 0; i < chunk->num_frames; i++) {
+			/* First, free the frames used by this chunk; slots no one
+			 * ever touched were never backed by anything. */
+			for (uint32_t i = 0; i < chunk->capacity; i++) {
+				if (chunk->frames[i] == SHM_FRAME_UNSET) continue;
 				mmu_frame_clear(chunk->frames[i] << 12);
 			}
 
@@ -161,6 +188,18 @@ static uintptr_t proc_sbrk(uint32_t num_pages, volatile process_t * volatile pro
 	return initial;
 }
 
+/* Point one page of a mapping at a chunk slot. Slots that have not
+ * been populated yet are left not-present; the page fault handler
+ * finishes the job (see shm_demand_fault) on first access. */
+static void map_page (shm_chunk_t * chunk, shm_mapping_t * mapping, unsigned int i, uintptr_t vaddr) {
+	union PML * page = mmu_get_page(vaddr, MMU_GET_MAKE);
+	if (chunk->frames[i] != SHM_FRAME_UNSET) {
+		page->bits.page = chunk->frames[i];
+		mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+	}
+	mapping->vaddrs[i] = vaddr;
+}
+
 static void * map_in (shm_chunk_t * chunk, volatile process_t * volatile proc) {
 	if (!chunk) {
 		return NULL;
@@ -179,10 +218,7 @@ static void * map_in (shm_chunk_t * chunk, volatile process_t * volatile proc) {
 			if (gap >= mapping->num_vaddrs * 0x1000) {
 				/* Map the gap */
 				for (unsigned int i = 0; i < chunk->num_frames; ++i) {
-					union PML * page = mmu_get_page(last_address + (i << 12), MMU_GET_MAKE);
-					page->bits.page = chunk->frames[i];
-					mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
-					mapping->vaddrs[i] = last_address + (i << 12);
+					map_page(chunk, mapping, i, last_address + (i << 12));
 				}
 
 				/* Insert us before this node */
@@ -199,10 +235,7 @@ static void * map_in (shm_chunk_t * chunk, volatile process_t * volatile proc) {
 		if (gap >= mapping->num_vaddrs * 0x1000) {
 
 			for (unsigned int i = 0; i < chunk->num_frames; ++i) {
-				union PML * page = mmu_get_page(last_address + (i << 12), MMU_GET_MAKE);
-				page->bits.page = chunk->frames[i];
-				mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
-				mapping->vaddrs[i] = last_address + (i << 12);
+				map_page(chunk, mapping, i, last_address + (i << 12));
 			}
 
 			list_insert(proc->shm_mappings, mapping);
@@ -213,11 +246,7 @@ static void * map_in (shm_chunk_t * chunk, volatile process_t * volatile proc) {
 
 	for (uint32_t i = 0; i < chunk->num_frames; i++) {
 		uintptr_t new_vpage = proc_sbrk(1, proc);
-
-		union PML * page = mmu_get_page(new_vpage, MMU_GET_MAKE);
-		page->bits.page = chunk->frames[i];
-		mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
-		mapping->vaddrs[i] = new_vpage;
+		map_page(chunk, mapping, i, new_vpage);
 	}
 
 	list_insert(proc->shm_mappings, mapping);
@@ -263,6 +292,14 @@ void * shm_obtain (char * path, size_t * size) {
 	} else {
 		/* New accessor! */
 		chunk->ref_count++;
+
+		/* Obtaining an existing chunk with a different size resizes it
+		 * in place; earlier mappings keep their old (larger or smaller)
+		 * view until their owners re-obtain. Window resizes remap this
+		 * way instead of allocating and copying a fresh buffer. */
+		if (size && *size && *size != chunk_size(chunk)) {
+			resize_chunk(chunk, *size);
+		}
 	}
 
 	void * vshm_start = map_in(chunk, proc);
@@ -305,12 +342,14 @@ int shm_release (char * path) {
 
 	shm_mapping_t * mapping = (shm_mapping_t *)node->value;
 
-	/* Clear the mappings from the process's address space */
+	/* Clear the mappings from the process's address space; one shootdown
+	 * covers the whole region rather than one broadcast per page. */
 	for (uint32_t i = 0; i < mapping->num_vaddrs; i++) {
 		union PML * page = mmu_get_page(mapping->vaddrs[i], 0);
 		page->bits.present = 0;
-		mmu_invalidate(mapping->vaddrs[i]);
+		mmu_invalidate_batch_add(mapping->vaddrs[i]);
 	}
+	mmu_invalidate_batch_flush();
 
 	/* Clean up */
 	release_chunk(chunk);
@@ -322,6 +361,50 @@ int shm_release (char * path) {
 	return 0;
 }
 
+/**
+ * @brief Back a shared memory page on first access.
+ *
+ * Called from the page fault handler for not-present user faults. If
+ * the address falls inside one of the faulting process's shm mappings,
+ * the chunk slot gets a (zeroed) frame if no one has touched it yet,
+ * the page is mapped, and the fault is resolved.
+ *
+ * @param address Faulting virtual address.
+ * @return 1 if this was a shared memory page and was populated.
+ */
+int shm_demand_fault (uintptr_t address) {
+	volatile process_t * volatile proc = this_core->current_process;
+	if (!proc || !shm_tree) return 0;
+
+	if (proc->group != 0) {
+		proc = process_from_pid(proc->group);
+	}
+
+	spin_lock(bsl);
+	foreach (n, proc->shm_mappings) {
+		shm_mapping_t * mapping = (shm_mapping_t *)n->value;
+		for (uint32_t i = 0; i < mapping->num_vaddrs; i++) {
+			if ((address & ~0xFFFUL) != mapping->vaddrs[i]) continue;
+
+			shm_chunk_t * chunk = mapping->chunk;
+			if (chunk->frames[i] == SHM_FRAME_UNSET) {
+				uintptr_t index = mmu_allocate_a_frame();
+				memset(mmu_map_from_physical(index << 12), 0, 0x1000);
+				chunk->frames[i] = index;
+			}
+
+			union PML * page = mmu_get_page(mapping->vaddrs[i], MMU_GET_MAKE);
+			page->bits.page = chunk->frames[i];
+			mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+
+			spin_unlock(bsl);
+			return 1;
+		}
+	}
+	spin_unlock(bsl);
+	return 0;
+}
+
 /* This function should only be called if the process's address space
  * is about to be destroyed -- chunks will not be unmounted therefrom ! */
 void shm_release_all (process_t * proc) {
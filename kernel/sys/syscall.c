@@ -12,9 +12,12 @@
 #include <sys/sysfunc.h>
 #include <sys/types.h>
 #include <sys/utsname.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/times.h>
 #include <sys/ptrace.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <syscall_nums.h>
 #include <kernel/printf.h>
 #include <kernel/process.h>
@@ -30,6 +33,8 @@
 #include <kernel/syscall.h>
 #include <kernel/misc.h>
 #include <kernel/ptrace.h>
+#include <kernel/blockcache.h>
+#include <kernel/ftrace.h>
 
 static char   hostname[256];
 static size_t hostname_len = 0;
@@ -60,15 +65,86 @@ long sys_sbrk(ssize_t size) {
 		if (page->bits.page != 0) {
 			printf("odd, %#zx is already allocated?\n", i);
 		}
-		mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+		/* Don't commit a frame yet; point it at the shared zero page
+		 * and let the first write fault in a private copy. */
+		mmu_frame_map_zero(page);
 	}
 	proc->image.heap += size;
 	spin_unlock(proc->image.lock);
 	return (long)out;
 }
 
+/**
+ * @brief Map a file into the calling process's address space.
+ *
+ * Pages come from the page cache, so every mapping of the same file
+ * shares frames; they are mapped read-only copy-on-write, which gives
+ * private (MAP_PRIVATE) semantics: reads are shared, the first write
+ * to a page splits off a private copy. With MAP_SHARED the pages are
+ * instead mapped read-only for good - a write is a protection fault -
+ * so every process keeps sharing one physical copy; the linker uses
+ * this for library text. The caller picks the address, as with the
+ * older anonymous-mapping sysfunc. Any previous private mappings in
+ * the range are released first.
+ */
+long sys_mmap(uintptr_t address, size_t size, int fd, off_t offset, int flags) {
+	if (!FD_CHECK(fd)) return -EBADF;
+	if ((address & 0xFFF) || (offset & 0xFFF) || !size) return -EINVAL;
+
+	fs_node_t * node = FD_ENTRY(fd);
+	if (!(node->flags & FS_FILE)) return -ENODEV;
+
+	size = (size + 0xFFF) & 0xFFFFffffFFFFf000UL;
+	if (!PTR_INRANGE(address) || !PTR_INRANGE(address + size - 1)) return -EFAULT;
+
+	volatile process_t * volatile proc = this_core->current_process;
+	if (proc->group != 0) proc = process_from_pid(proc->group);
+
+	spin_lock(proc->image.lock);
+	mmu_unmap_user(address, size);
+	for (uintptr_t i = 0; i < size; i += 0x1000) {
+		uintptr_t frame = pagecache_get_frame(node, offset + i);
+		if (frame == (uintptr_t)-1) {
+			spin_unlock(proc->image.lock);
+			return -ENODEV;
+		}
+		union PML * page = mmu_get_page(address + i, MMU_GET_MAKE);
+		if (flags & MAP_SHARED) {
+			mmu_frame_map_shared_ro(page, frame);
+		} else {
+			mmu_frame_map_cow(page, frame);
+		}
+		mmu_invalidate_batch_add(address + i);
+	}
+	mmu_invalidate_batch_flush();
+	spin_unlock(proc->image.lock);
+
+	return (long)address;
+}
+
+/**
+ * @brief Unmap a range previously mapped with mmap or sbrk.
+ */
+long sys_munmap(uintptr_t address, size_t size) {
+	if ((address & 0xFFF) || !size) return -EINVAL;
+	size = (size + 0xFFF) & 0xFFFFffffFFFFf000UL;
+	if (!PTR_INRANGE(address) || !PTR_INRANGE(address + size - 1)) return -EFAULT;
+
+	volatile process_t * volatile proc = this_core->current_process;
+	if (proc->group != 0) proc = process_from_pid(proc->group);
+
+	spin_lock(proc->image.lock);
+	mmu_unmap_user(address, size);
+	spin_unlock(proc->image.lock);
+	return 0;
+}
+
 extern int elf_module(char ** args);
 
+#ifdef SYSCALL_STATS
+static void syscall_stats_reset(void);
+#endif
+
 long sys_sysfunc(long fn, char ** args) {
 	/* FIXME: Most of these should be top-level, many are hacks/broken in Misaka */
 	switch (fn) {
@@ -138,7 +214,12 @@ long sys_sysfunc(long fn, char ** args) {
 			if (!PTR_INRANGE(end)) return -EFAULT;
 			for (uintptr_t i = start; i < end; i += 0x1000) {
 				union PML * page = mmu_get_page(i, MMU_GET_MAKE);
-				mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+				if (page->bits.page == 0) {
+					/* Untouched anonymous page; defer the frame to first write. */
+					mmu_frame_map_zero(page);
+				} else if (page->bits.page != mmu_get_zero_frame()) {
+					mmu_frame_allocate(page, MMU_FLAG_WRITABLE);
+				}
 			}
 			spin_unlock(proc->image.lock);
 			return 0;
@@ -177,6 +258,24 @@ long sys_sysfunc(long fn, char ** args) {
 		case TOARU_SYS_FUNC_NPROC:
 			return processor_count;
 
+		case TOARU_SYS_FUNC_SCSTATS:
+#ifdef SYSCALL_STATS
+			if (this_core->current_process->user != 0) return -EACCES;
+			syscall_stats_reset();
+			return 0;
+#else
+			return -EINVAL;
+#endif
+
+		case TOARU_SYS_FUNC_FTRACE:
+			if (this_core->current_process->user != 0) return -EACCES;
+			PTR_VALIDATE(args);
+			if (!args) return -EFAULT;
+			PTR_VALIDATE(args[0]);
+			if (!args[0]) return -EFAULT;
+			for (char ** aa = args; *aa; ++aa) { PTR_VALIDATE(*aa); }
+			return ftrace_command(args);
+
 		default:
 			printf("Bad system function: %ld\n", fn);
 			return -EINVAL;
@@ -301,6 +400,47 @@ long sys_lstat(char * file, uintptr_t st) {
 	return result;
 }
 
+/**
+ * @brief Stat many entries of one directory in a single syscall.
+ *
+ * @p names holds @p count nul-terminated names packed back to back in
+ * @p names_len bytes; each is resolved against @p base with lstat
+ * semantics and its result written to the corresponding slot of
+ * @p stats. An entry that cannot be resolved gets a zeroed buffer - a
+ * zero st_mode never names a real object - so one unreadable entry
+ * does not fail the batch. Directory walkers otherwise pay one path
+ * resolution syscall per entry right after batching the readdir side.
+ */
+long sys_lstat_batch(const char * base, const char * names, long names_len, uintptr_t stats, long count) {
+	PTR_VALIDATE(base);
+	if (count < 0 || names_len < 0) return -EINVAL;
+	PTRCHECK((void*)names, names_len, MMU_PTR_NULL);
+	PTRCHECK((void*)stats, count * sizeof(struct stat), MMU_PTR_NULL | MMU_PTR_WRITE);
+	if (!base || !names) return -EFAULT;
+
+	char path[1024];
+	size_t base_len = strlen(base);
+	const char * name = names;
+	const char * names_end = names + names_len;
+
+	for (long i = 0; i < count; ++i) {
+		size_t nlen = 0;
+		while (name + nlen < names_end && name[nlen]) nlen++;
+		/* Ran out of names, or the last one was not terminated. */
+		if (name + nlen >= names_end) return -EINVAL;
+
+		fs_node_t * fn = NULL;
+		if (base_len + nlen + 2 <= sizeof(path)) {
+			snprintf(path, sizeof(path), "%s/%s", base, name);
+			fn = kopen(path, O_PATH | O_NOFOLLOW);
+		}
+		stat_node(fn, stats + i * sizeof(struct stat));
+		if (fn) close_fs(fn);
+		name += nlen + 1;
+	}
+	return count;
+}
+
 long sys_open(const char * file, long flags, long mode) {
 	PTR_VALIDATE(file);
 	if (!file) return -EFAULT;
@@ -425,6 +565,146 @@ long sys_read(int fd, char * ptr, unsigned long len) {
 	return -EBADF;
 }
 
+/* Shared validation for readv/writev: checks each vector and returns
+ * the total transfer size, or a negative error. */
+static int64_t iov_total(struct iovec * iov, int iovcnt, int write) {
+	int64_t total = 0;
+	for (int i = 0; i < iovcnt; ++i) {
+		PTRCHECK(iov[i].iov_base, iov[i].iov_len, write ? (MMU_PTR_NULL | MMU_PTR_WRITE) : MMU_PTR_NULL);
+		if (iov[i].iov_len && !iov[i].iov_base) return -EFAULT;
+		if (total + (int64_t)iov[i].iov_len < total) return -EINVAL;
+		total += iov[i].iov_len;
+	}
+	return total;
+}
+
+long sys_readv(int fd, struct iovec * iov, int iovcnt) {
+	if (FD_CHECK(fd)) {
+		if (iovcnt < 0 || iovcnt > UIO_MAXIOV) return -EINVAL;
+		PTRCHECK(iov, iovcnt * sizeof(struct iovec), MMU_PTR_NULL);
+		if (!(FD_MODE(fd) & 01)) {
+			return -EACCES;
+		}
+
+		int64_t total = iov_total(iov, iovcnt, 1);
+		if (total <= 0) return total;
+
+		/* This is one driver read followed by a scatter, not a read per
+		 * vector: packet interfaces deliver a whole message per read,
+		 * and reading the vectors separately would split messages. */
+		uint8_t * staging = malloc(total);
+		int64_t out = read_fs(FD_ENTRY(fd), FD_OFFSET(fd), total, staging);
+		if (out > 0) {
+			FD_OFFSET(fd) += out;
+			uint8_t * ptr = staging;
+			int64_t remaining = out;
+			for (int i = 0; i < iovcnt && remaining; ++i) {
+				size_t count = iov[i].iov_len > (size_t)remaining ? (size_t)remaining : iov[i].iov_len;
+				memcpy(iov[i].iov_base, ptr, count);
+				ptr += count;
+				remaining -= count;
+			}
+		}
+		free(staging);
+		return out;
+	}
+	return -EBADF;
+}
+
+long sys_writev(int fd, struct iovec * iov, int iovcnt) {
+	if (FD_CHECK(fd)) {
+		if (iovcnt < 0 || iovcnt > UIO_MAXIOV) return -EINVAL;
+		PTRCHECK(iov, iovcnt * sizeof(struct iovec), MMU_PTR_NULL);
+		if (!(FD_MODE(fd) & 2)) return -EACCES;
+
+		int64_t total = iov_total(iov, iovcnt, 0);
+		if (total <= 0) return total;
+
+		/* Gather, then hand the driver one contiguous write, so a
+		 * header+payload pair lands in a pipe or packet exchange as a
+		 * single message. */
+		uint8_t * staging = malloc(total);
+		uint8_t * ptr = staging;
+		for (int i = 0; i < iovcnt; ++i) {
+			memcpy(ptr, iov[i].iov_base, iov[i].iov_len);
+			ptr += iov[i].iov_len;
+		}
+		int64_t out = write_fs(FD_ENTRY(fd), FD_OFFSET(fd), total, staging);
+		if (out > 0) {
+			FD_OFFSET(fd) += out;
+		}
+		free(staging);
+		return out;
+	}
+	return -EBADF;
+}
+
+/**
+ * @brief Copy data from one file descriptor to another inside the kernel.
+ *
+ * Replaces the read-to-userspace-then-write loop for things like
+ * serving a file over a socket: data moves through one kernel staging
+ * buffer, so there are no user-space copies and one syscall covers the
+ * whole transfer. (The network stack copies payloads into its own
+ * packet buffers, so handing cache pages to it directly would not
+ * save anything today.)
+ *
+ * If @p offset is non-NULL, reading starts there and the final
+ * position is written back without touching the source descriptor's
+ * offset, matching the usual sendfile contract.
+ */
+long sys_sendfile(int out_fd, int in_fd, off_t * offset, size_t count) {
+	if (!FD_CHECK(in_fd) || !FD_CHECK(out_fd)) return -EBADF;
+	if (!(FD_MODE(in_fd) & 01)) return -EACCES;
+	if (!(FD_MODE(out_fd) & 02)) return -EACCES;
+	if (offset) {
+		PTRCHECK(offset, sizeof(off_t), MMU_PTR_NULL | MMU_PTR_WRITE);
+	}
+	if (!count) return 0;
+
+	off_t in_offset = offset ? *offset : (off_t)FD_OFFSET(in_fd);
+	size_t staging_size = count < 0x10000 ? count : 0x10000;
+	uint8_t * staging = malloc(staging_size);
+
+	int64_t total = 0;
+	int64_t error = 0;
+	while ((size_t)total < count) {
+		size_t want = count - total;
+		if (want > staging_size) want = staging_size;
+		int64_t r = read_fs(FD_ENTRY(in_fd), in_offset, want, staging);
+		if (r <= 0) {
+			error = r;
+			break;
+		}
+		int64_t w = write_fs(FD_ENTRY(out_fd), FD_OFFSET(out_fd), r, staging);
+		if (w < 0) {
+			error = w;
+			break;
+		}
+		FD_OFFSET(out_fd) += w;
+		in_offset += w;
+		total += w;
+		if (w < r || r < (int64_t)want) break; /* Destination full or source exhausted. */
+	}
+	free(staging);
+
+	if (offset) {
+		*offset = in_offset;
+	} else {
+		FD_OFFSET(in_fd) = in_offset;
+	}
+	return total ? total : error;
+}
+
+long sys_fsync(int fd) {
+	if (fd >= 0 && !FD_CHECK(fd)) return -EBADF;
+	/* The block cache does not track which file a dirty chunk belongs
+	 * to, so this flushes everything; the ordering guarantee - data is
+	 * on the device when we return - is the same. */
+	blockcache_sync();
+	return 0;
+}
+
 long sys_ioctl(int fd, unsigned long request, void * argp) {
 	if (FD_CHECK(fd)) {
 		PTR_VALIDATE(argp);
@@ -449,6 +729,22 @@ long sys_readdir(int fd, long index, struct dirent * entry) {
 	return -EBADF;
 }
 
+long sys_readdir_batch(int fd, long index, long count, struct dirent * entries) {
+	if (!FD_CHECK(fd)) return -EBADF;
+	if (count < 0) return -EINVAL;
+	PTRCHECK(entries, count * sizeof(struct dirent), MMU_PTR_NULL | MMU_PTR_WRITE);
+	if (count && !entries) return -EFAULT;
+	long out = 0;
+	while (out < count) {
+		struct dirent * kentry = readdir_fs(FD_ENTRY(fd), (uint64_t)(index + out));
+		if (!kentry) break;
+		memcpy(&entries[out], kentry, sizeof *kentry);
+		free(kentry);
+		out++;
+	}
+	return out;
+}
+
 long sys_mkdir(char * path, uint64_t mode) {
 	PTR_VALIDATE(path);
 	if (!path) return -EFAULT;
@@ -476,6 +772,8 @@ long sys_chmod(char * file, long mode) {
 		}
 		long result = chmod_fs(fn, mode);
 		close_fs(fn);
+		/* Any cached lookup result still carries the old mask. */
+		dcache_evict_path(file);
 		return result;
 	} else {
 		return -ENOENT;
@@ -521,6 +819,8 @@ long sys_chown(char * file, uid_t uid, uid_t gid) {
 
 		long result = chown_fs(fn, uid, gid);
 		close_fs(fn);
+		/* Any cached lookup result still carries the old owner. */
+		dcache_evict_path(file);
 		return result;
 	} else {
 		return -ENOENT;
@@ -538,6 +838,30 @@ long sys_gettimeofday(struct timeval * tv, void * tz) {
 	return gettimeofday(tv, tz);
 }
 
+long sys_clock_gettime(long clockid, struct timespec * tp) {
+	PTR_VALIDATE(tp);
+	if (!tp) return -EFAULT;
+	switch (clockid) {
+		case CLOCK_REALTIME:
+		case CLOCK_MONOTONIC: {
+			struct timeval t;
+			gettimeofday(&t, NULL);
+			tp->tv_sec  = t.tv_sec;
+			tp->tv_nsec = t.tv_usec * 1000;
+			return 0;
+		}
+		case CLOCK_REALTIME_COARSE:
+		case CLOCK_MONOTONIC_COARSE: {
+			/* Wall time as of the last timer tick; no TSC read. */
+			uint64_t usec;
+			tp->tv_sec  = arch_coarse_time(&usec);
+			tp->tv_nsec = usec * 1000;
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
 long sys_getuid(void) {
 	return (long)this_core->current_process->real_user;
 }
@@ -852,6 +1176,64 @@ long sys_fork(void) {
 	return fork();
 }
 
+/**
+ * Combined fork+exec. Launches @p filename in a new process without
+ * cloning the caller's address space; see @ref spawn_exec. The
+ * executable is validated here, in the parent, since the child has no
+ * way to report that it never managed to launch.
+ */
+long sys_spawn(const char * filename, char *const argv[], char *const envp[]) {
+	PTR_VALIDATE(filename);
+	PTR_VALIDATE(argv);
+	PTR_VALIDATE(envp);
+
+	if (!filename || !argv) return -EFAULT;
+	if (strlen(filename) >= 1024) return -ENAMETOOLONG;
+
+	fs_node_t * file = kopen(filename, 0);
+	if (!file) return -ENOENT;
+	if (!has_permission(file, 01)) {
+		close_fs(file);
+		return -EACCES;
+	}
+	close_fs(file);
+
+	int argc = 0;
+	int envc = 0;
+	while (argv[argc]) {
+		PTR_VALIDATE(argv[argc]);
+		++argc;
+	}
+
+	if (envp) {
+		while (envp[envc]) {
+			PTR_VALIDATE(envp[envc]);
+			++envc;
+		}
+	}
+
+	char **argv_ = malloc(sizeof(char*) * (argc + 1));
+	for (int j = 0; j < argc; ++j) {
+		argv_[j] = malloc(strlen(argv[j]) + 1);
+		memcpy(argv_[j], argv[j], strlen(argv[j]) + 1);
+	}
+	argv_[argc] = 0;
+	char ** envp_;
+	if (envp && envc) {
+		envp_ = malloc(sizeof(char*) * (envc + 1));
+		for (int j = 0; j < envc; ++j) {
+			envp_[j] = malloc(strlen(envp[j]) + 1);
+			memcpy(envp_[j], envp[j], strlen(envp[j]) + 1);
+		}
+		envp_[envc] = 0;
+	} else {
+		envp_ = malloc(sizeof(char*));
+		envp_[0] = NULL;
+	}
+
+	return spawn_exec(strdup(filename), argc, argv_, envp_);
+}
+
 long sys_clone(uintptr_t new_stack, uintptr_t thread_func, uintptr_t arg) {
 	if (!new_stack || !PTR_INRANGE(new_stack)) return -EINVAL;
 	if (!thread_func || !PTR_INRANGE(thread_func)) return -EINVAL;
@@ -1042,7 +1424,8 @@ long sys_times(struct tms *buf) {
 	if (buf) {
 		PTR_VALIDATE(buf);
 
-		buf->tms_utime  = this_core->current_process->time_total        / arch_cpu_mhz();
+		buf->tms_utime  = (this_core->current_process->time_total
+		                   - this_core->current_process->time_sys)         / arch_cpu_mhz();
 		buf->tms_stime  = this_core->current_process->time_sys          / arch_cpu_mhz();
 		buf->tms_cutime = this_core->current_process->time_children     / arch_cpu_mhz();
 		buf->tms_cstime = this_core->current_process->time_sys_children / arch_cpu_mhz();
@@ -1051,6 +1434,47 @@ long sys_times(struct tms *buf) {
 	return arch_perf_timer() / arch_cpu_mhz();
 }
 
+/**
+ * @brief Set the scheduler priority class of a process.
+ *
+ * @param pid Process to modify, or 0 for the calling process.
+ * @param priority New priority class; lower is scheduled first.
+ */
+long sys_setpriority(pid_t pid, int priority) {
+	process_t * proc = pid ? process_from_pid(pid) : (process_t*)this_core->current_process;
+	if (!proc) return -ESRCH;
+
+	if (this_core->current_process->user != USER_ROOT_UID) {
+		/* Regular users may only demote their own processes. */
+		if (proc->user != this_core->current_process->user) return -EPERM;
+		if (priority < proc->priority) return -EPERM;
+	}
+
+	return process_set_priority(proc, priority);
+}
+
+/**
+ * @brief Pin a process to a set of cores.
+ *
+ * @param pid Process to modify, or 0 for the calling process.
+ * @param mask Bitmask of allowed cores; 0 allows all cores.
+ */
+long sys_setaffinity(pid_t pid, unsigned int mask) {
+	process_t * proc = pid ? process_from_pid(pid) : (process_t*)this_core->current_process;
+	if (!proc) return -ESRCH;
+
+	if (this_core->current_process->user != USER_ROOT_UID &&
+	    proc->user != this_core->current_process->user) return -EPERM;
+
+	return process_set_affinity(proc, mask);
+}
+
+long sys_getaffinity(pid_t pid) {
+	process_t * proc = pid ? process_from_pid(pid) : (process_t*)this_core->current_process;
+	if (!proc) return -ESRCH;
+	return proc->cpu_affinity;
+}
+
 extern long net_socket();
 extern long net_setsockopt();
 extern long net_bind();
@@ -1061,8 +1485,15 @@ extern long net_getsockopt();
 extern long net_recv();
 extern long net_send();
 extern long net_shutdown();
+extern long net_socketpair();
 
 extern long ptrace_handle(long,pid_t,void*,void*);
+extern long futex_wait(uint32_t * addr, uint32_t value, int timeout);
+extern long futex_wake(uint32_t * addr, int count);
+extern long futex_requeue(uint32_t * addr, int count, uint32_t * addr2);
+extern long evset_create(void);
+extern long evset_ctl(int setfd, int op, int fd);
+extern long evset_wait(int setfd, int * out, int max, int timeout);
 
 static long (*syscalls[])() = {
 	/* System Call Table */
@@ -1073,6 +1504,7 @@ static long (*syscalls[])() = {
 	[SYS_WRITE]        = sys_write,
 	[SYS_CLOSE]        = sys_close,
 	[SYS_GETTIMEOFDAY] = sys_gettimeofday,
+	[SYS_CLOCK_GETTIME] = sys_clock_gettime,
 	[SYS_GETPID]       = sys_getpid,
 	[SYS_SBRK]         = sys_sbrk,
 	[SYS_UNAME]        = sys_uname,
@@ -1081,6 +1513,8 @@ static long (*syscalls[])() = {
 	[SYS_GETUID]       = sys_getuid,
 	[SYS_SETUID]       = sys_setuid,
 	[SYS_READDIR]      = sys_readdir,
+	[SYS_READDIR_BATCH] = sys_readdir_batch,
+	[SYS_LSTAT_BATCH]  = sys_lstat_batch,
 	[SYS_CHDIR]        = sys_chdir,
 	[SYS_GETCWD]       = sys_getcwd,
 	[SYS_SETHOSTNAME]  = sys_sethostname,
@@ -1105,6 +1539,7 @@ static long (*syscalls[])() = {
 	[SYS_DUP2]         = sys_dup2,
 	[SYS_EXECVE]       = sys_execve,
 	[SYS_FORK]         = sys_fork,
+	[SYS_SPAWN]        = sys_spawn,
 	[SYS_WAITPID]      = sys_waitpid,
 	[SYS_YIELD]        = sys_yield,
 	[SYS_SLEEPABS]     = sys_sleepabs,
@@ -1126,7 +1561,22 @@ static long (*syscalls[])() = {
 	[SYS_GETGROUPS]    = sys_getgroups,
 	[SYS_SETGROUPS]    = sys_setgroups,
 	[SYS_TIMES]        = sys_times,
+	[SYS_SETPRIORITY]  = sys_setpriority,
+	[SYS_SETAFFINITY]  = sys_setaffinity,
+	[SYS_GETAFFINITY]  = sys_getaffinity,
+	[SYS_FUTEX_WAIT]   = futex_wait,
+	[SYS_FUTEX_WAKE]   = futex_wake,
+	[SYS_FUTEX_REQUEUE] = futex_requeue,
+	[SYS_MMAP]         = sys_mmap,
+	[SYS_MUNMAP]       = sys_munmap,
+	[SYS_READV]        = sys_readv,
+	[SYS_WRITEV]       = sys_writev,
+	[SYS_SENDFILE]     = sys_sendfile,
+	[SYS_FSYNC]        = sys_fsync,
 	[SYS_PTRACE]       = ptrace_handle,
+	[SYS_EVSET_CREATE] = evset_create,
+	[SYS_EVSET_CTL]    = evset_ctl,
+	[SYS_EVSET_WAIT]   = evset_wait,
 
 	[SYS_SOCKET]       = net_socket,
 	[SYS_SETSOCKOPT]   = net_setsockopt,
@@ -1138,11 +1588,187 @@ static long (*syscalls[])() = {
 	[SYS_RECV]         = net_recv,
 	[SYS_SEND]         = net_send,
 	[SYS_SHUTDOWN]     = net_shutdown,
+	[SYS_SOCKETPAIR]   = net_socketpair,
 };
 
 static long num_syscalls = sizeof(syscalls) / sizeof(*syscalls);
 typedef long (*scall_func)();
 
+#ifdef SYSCALL_STATS
+/**
+ * Per-syscall invocation counts and log2 latency histograms, built
+ * only when SYSCALL_STATS is defined (commented-out flag in the
+ * Makefile). Accumulation is per-core so the hot path touches no
+ * shared cachelines; /proc/syscalls sums the cores at read time and
+ * sysfunc(TOARU_SYS_FUNC_SCSTATS) resets everything. Bucket N counts
+ * calls that took [2^N, 2^(N+1)) TSC cycles - wall time, so blocking
+ * calls land in the high buckets, which is exactly what we want when
+ * hunting interactive hiccups.
+ */
+#define SYSCALL_HIST_BUCKETS 32
+
+static uint64_t * syscall_hist[32] = { NULL };
+
+static const char * syscall_stat_names[] = {
+	[SYS_EXT]          = "exit",
+	[SYS_GETEUID]      = "geteuid",
+	[SYS_OPEN]         = "open",
+	[SYS_READ]         = "read",
+	[SYS_WRITE]        = "write",
+	[SYS_CLOSE]        = "close",
+	[SYS_GETTIMEOFDAY] = "gettimeofday",
+	[SYS_CLOCK_GETTIME] = "clock_gettime",
+	[SYS_GETPID]       = "getpid",
+	[SYS_SBRK]         = "sbrk",
+	[SYS_UNAME]        = "uname",
+	[SYS_SEEK]         = "seek",
+	[SYS_STAT]         = "stat",
+	[SYS_GETUID]       = "getuid",
+	[SYS_SETUID]       = "setuid",
+	[SYS_READDIR]      = "readdir",
+	[SYS_READDIR_BATCH] = "readdir_batch",
+	[SYS_LSTAT_BATCH]  = "lstat_batch",
+	[SYS_CHDIR]        = "chdir",
+	[SYS_GETCWD]       = "getcwd",
+	[SYS_SETHOSTNAME]  = "sethostname",
+	[SYS_GETHOSTNAME]  = "gethostname",
+	[SYS_MKDIR]        = "mkdir",
+	[SYS_GETTID]       = "gettid",
+	[SYS_SYSFUNC]      = "sysfunc",
+	[SYS_IOCTL]        = "ioctl",
+	[SYS_ACCESS]       = "access",
+	[SYS_STATF]        = "statf",
+	[SYS_CHMOD]        = "chmod",
+	[SYS_UMASK]        = "umask",
+	[SYS_UNLINK]       = "unlink",
+	[SYS_MOUNT]        = "mount",
+	[SYS_SYMLINK]      = "symlink",
+	[SYS_READLINK]     = "readlink",
+	[SYS_LSTAT]        = "lstat",
+	[SYS_CHOWN]        = "chown",
+	[SYS_SETSID]       = "setsid",
+	[SYS_SETPGID]      = "setpgid",
+	[SYS_GETPGID]      = "getpgid",
+	[SYS_DUP2]         = "dup2",
+	[SYS_EXECVE]       = "execve",
+	[SYS_FORK]         = "fork",
+	[SYS_SPAWN]        = "spawn",
+	[SYS_WAITPID]      = "waitpid",
+	[SYS_YIELD]        = "yield",
+	[SYS_SLEEPABS]     = "sleepabs",
+	[SYS_SLEEP]        = "sleep",
+	[SYS_PIPE]         = "pipe",
+	[SYS_FSWAIT]       = "fswait",
+	[SYS_FSWAIT2]      = "fswait_timeout",
+	[SYS_FSWAIT3]      = "fswait_multi",
+	[SYS_CLONE]        = "clone",
+	[SYS_OPENPTY]      = "openpty",
+	[SYS_SHM_OBTAIN]   = "shm_obtain",
+	[SYS_SHM_RELEASE]  = "shm_release",
+	[SYS_SIGNAL]       = "signal",
+	[SYS_KILL]         = "kill",
+	[SYS_REBOOT]       = "reboot",
+	[SYS_GETGID]       = "getgid",
+	[SYS_GETEGID]      = "getegid",
+	[SYS_SETGID]       = "setgid",
+	[SYS_GETGROUPS]    = "getgroups",
+	[SYS_SETGROUPS]    = "setgroups",
+	[SYS_TIMES]        = "times",
+	[SYS_SETPRIORITY]  = "setpriority",
+	[SYS_SETAFFINITY]  = "setaffinity",
+	[SYS_GETAFFINITY]  = "getaffinity",
+	[SYS_FUTEX_WAIT]   = "futex_wait",
+	[SYS_FUTEX_WAKE]   = "futex_wake",
+	[SYS_FUTEX_REQUEUE] = "futex_requeue",
+	[SYS_MMAP]         = "mmap",
+	[SYS_MUNMAP]       = "munmap",
+	[SYS_READV]        = "readv",
+	[SYS_WRITEV]       = "writev",
+	[SYS_SENDFILE]     = "sendfile",
+	[SYS_FSYNC]        = "fsync",
+	[SYS_PTRACE]       = "ptrace",
+	[SYS_EVSET_CREATE] = "evset_create",
+	[SYS_EVSET_CTL]    = "evset_ctl",
+	[SYS_EVSET_WAIT]   = "evset_wait",
+	[SYS_SOCKET]       = "socket",
+	[SYS_SETSOCKOPT]   = "setsockopt",
+	[SYS_BIND]         = "bind",
+	[SYS_ACCEPT]       = "accept",
+	[SYS_LISTEN]       = "listen",
+	[SYS_CONNECT]      = "connect",
+	[SYS_GETSOCKOPT]   = "getsockopt",
+	[SYS_RECV]         = "recv",
+	[SYS_SEND]         = "send",
+	[SYS_SHUTDOWN]     = "shutdown",
+	[SYS_SOCKETPAIR]   = "socketpair",
+};
+
+static void syscall_stats_account(long number, uint64_t cycles) {
+	uint64_t * hist = syscall_hist[this_core->cpu_id];
+	if (!hist) {
+		hist = malloc(sizeof(uint64_t) * num_syscalls * SYSCALL_HIST_BUCKETS);
+		memset(hist, 0, sizeof(uint64_t) * num_syscalls * SYSCALL_HIST_BUCKETS);
+		syscall_hist[this_core->cpu_id] = hist;
+	}
+
+	int bucket = 0;
+	while (cycles >>= 1) bucket++;
+	if (bucket >= SYSCALL_HIST_BUCKETS) bucket = SYSCALL_HIST_BUCKETS - 1;
+	hist[number * SYSCALL_HIST_BUCKETS + bucket]++;
+}
+
+static void syscall_stats_reset(void) {
+	for (int core = 0; core < 32; ++core) {
+		if (syscall_hist[core]) {
+			memset(syscall_hist[core], 0, sizeof(uint64_t) * num_syscalls * SYSCALL_HIST_BUCKETS);
+		}
+	}
+}
+
+/**
+ * @brief /proc/syscalls: one line per syscall that has been invoked.
+ *
+ * Columns are the invocation count followed by the 32 log2 latency
+ * buckets, summed over all cores.
+ */
+ssize_t syscall_stats_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	size_t space = num_syscalls * (64 + SYSCALL_HIST_BUCKETS * 12) + 256;
+	char * buf = malloc(space);
+	size_t soffset = snprintf(buf, 100, "%-16s %12s  log2-cycle buckets 0..%d\n",
+			"SYSCALL", "CALLS", SYSCALL_HIST_BUCKETS - 1);
+
+	for (long i = 0; i < num_syscalls; ++i) {
+		uint64_t row[SYSCALL_HIST_BUCKETS] = { 0 };
+		uint64_t calls = 0;
+		for (int core = 0; core < 32; ++core) {
+			if (!syscall_hist[core]) continue;
+			for (int b = 0; b < SYSCALL_HIST_BUCKETS; ++b) {
+				row[b] += syscall_hist[core][i * SYSCALL_HIST_BUCKETS + b];
+				calls  += syscall_hist[core][i * SYSCALL_HIST_BUCKETS + b];
+			}
+		}
+		if (!calls) continue;
+
+		const char * name = (i < (long)(sizeof(syscall_stat_names)/sizeof(*syscall_stat_names))) ? syscall_stat_names[i] : NULL;
+		soffset += snprintf(&buf[soffset], 64, "%-16s %12llu ", name ? name : "?", (unsigned long long)calls);
+		for (int b = 0; b < SYSCALL_HIST_BUCKETS; ++b) {
+			soffset += snprintf(&buf[soffset], 16, " %llu", (unsigned long long)row[b]);
+		}
+		soffset += snprintf(&buf[soffset], 4, "\n");
+	}
+
+	if (offset > (off_t)soffset) {
+		free(buf);
+		return 0;
+	}
+
+	if (size > soffset - offset) size = soffset - offset;
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+#endif
+
 void syscall_handler(struct regs * r) {
 
 	if (arch_syscall_number(r) >= num_syscalls) {
@@ -1157,9 +1783,23 @@ void syscall_handler(struct regs * r) {
 		ptrace_signal(SIGTRAP, PTRACE_EVENT_SYSCALL_ENTER);
 	}
 
-	arch_syscall_return(r, func(
+#ifdef SYSCALL_STATS
+	uint64_t _stats_start = arch_perf_timer();
+#endif
+
+	long result = func(
 		arch_syscall_arg0(r), arch_syscall_arg1(r), arch_syscall_arg2(r),
-		arch_syscall_arg3(r), arch_syscall_arg4(r)));
+		arch_syscall_arg3(r), arch_syscall_arg4(r));
+
+#ifdef SYSCALL_STATS
+	syscall_stats_account(arch_syscall_number(r), arch_perf_timer() - _stats_start);
+#endif
+
+	if (this_core->current_process->flags & PROC_FLAG_TRACE_RECORD) {
+		ptrace_record_syscall(r, result);
+	}
+
+	arch_syscall_return(r, result);
 
 	if (this_core->current_process->flags & PROC_FLAG_TRACE_SYSCALLS) {
 		ptrace_signal(SIGTRAP, PTRACE_EVENT_SYSCALL_EXIT);
@@ -0,0 +1,347 @@
+/**
+ * @file  kernel/vfs/blockcache.c
+ * @brief Shared cache of device blocks for filesystem drivers.
+ *
+ * Caches reads from block devices in 4KiB chunks so that the
+ * filesystem drivers stop keeping (or wanting) little private caches
+ * of their own and repeated metadata reads stop reaching the disk
+ * drivers. Chunks are keyed by the device node and chunk index and
+ * recycled least-recently-used once the cache is full; the size can
+ * be set with the 'blockcache=' kernel argument (in 4KiB blocks).
+ *
+ * Writes go through @ref blockcache_write and are cached back: the
+ * chunk is updated (filled first, if the write only covers part of
+ * it) and marked dirty, and the device write happens later - from the
+ * flusher tasklet, which runs on an interval and is also kicked
+ * synchronously when too much of the cache is dirty, or from
+ * @ref blockcache_sync for callers that need ordering (fsync). A
+ * driver that reads and writes through this interface always sees its
+ * own writes. Two different nodes reaching the same underlying device
+ * (say, a raw disk and a partition on it) have separate keys and are
+ * not kept coherent - the same situation as when each driver cached
+ * privately.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/vfs.h>
+#include <kernel/hashmap.h>
+#include <kernel/list.h>
+#include <kernel/args.h>
+#include <kernel/process.h>
+#include <kernel/time.h>
+#include <kernel/blockcache.h>
+#include <kernel/blockio.h>
+#include <kernel/counters.h>
+
+#define BLOCKCACHE_BLOCK_SIZE 4096
+#define BLOCKCACHE_DEFAULT_BLOCKS 1024 /* 4MiB */
+#define BLOCKCACHE_FLUSH_BATCH 32
+
+struct bc_entry {
+	fs_node_t * device;
+	uint64_t index;
+	ssize_t valid; /* Bytes the device actually gave us; short at end-of-device. */
+	int dirty;     /* Newer than the device copy; flusher will write it out. */
+	node_t lru_node;
+	uint8_t data[BLOCKCACHE_BLOCK_SIZE];
+};
+
+static hashmap_t * block_hash = NULL;
+static list_t * block_lru = NULL;
+static spin_lock_t block_lock = { 0 };
+static size_t max_blocks = BLOCKCACHE_DEFAULT_BLOCKS;
+static size_t dirty_blocks = 0;
+static int flusher_started = 0;
+
+static void blockcache_key(char * key, fs_node_t * device, uint64_t index) {
+	snprintf(key, 64, "%zx:%zx", (size_t)(uintptr_t)device, (size_t)index);
+}
+
+static void blockcache_init(void) {
+	block_hash = hashmap_create(0x400);
+	block_lru = list_create("block cache lru", NULL);
+	long requested = args_value_int("blockcache", 0);
+	if (requested > 0) max_blocks = requested;
+}
+
+/* Entries ride the LRU list through a node embedded in the entry. */
+static void blockcache_touch(struct bc_entry * entry) {
+	list_delete(block_lru, &entry->lru_node);
+	list_append(block_lru, &entry->lru_node);
+}
+
+static void blockcache_evict(void) {
+	/* Dirty chunks can not be written out from here - the device write
+	 * may block and we hold the cache lock - so evict the oldest clean
+	 * chunk instead. If every chunk is dirty, tolerate running over the
+	 * limit briefly; the flusher is already being kicked by then. */
+	while (block_lru->length >= max_blocks) {
+		struct bc_entry * victim = NULL;
+		foreach(n, block_lru) {
+			struct bc_entry * entry = n->value;
+			if (!entry->dirty) {
+				victim = entry;
+				break;
+			}
+		}
+		if (!victim) break;
+		list_delete(block_lru, &victim->lru_node);
+		char key[64];
+		blockcache_key(key, victim->device, victim->index);
+		hashmap_remove(block_hash, key);
+		free(victim);
+	}
+}
+
+/* A dirty chunk is snapshotted under the lock and written out after it
+ * is released, since the device write may block. If a new write dirties
+ * the chunk again in between, the fresher data goes out next round. */
+struct bc_flush {
+	fs_node_t * device;
+	uint64_t index;
+	ssize_t valid;
+	struct blockio_request req;
+	uint8_t data[BLOCKCACHE_BLOCK_SIZE];
+};
+
+static size_t blockcache_flush_some(void) {
+	struct bc_flush * batch = malloc(sizeof(struct bc_flush) * BLOCKCACHE_FLUSH_BATCH);
+	size_t count = 0;
+	spin_lock(block_lock);
+	if (block_lru) {
+		foreach(n, block_lru) {
+			struct bc_entry * entry = n->value;
+			if (!entry->dirty) continue;
+			entry->dirty = 0;
+			dirty_blocks--;
+			batch[count].device = entry->device;
+			batch[count].index = entry->index;
+			batch[count].valid = entry->valid;
+			memcpy(batch[count].data, entry->data, entry->valid);
+			if (++count == BLOCKCACHE_FLUSH_BATCH) break;
+		}
+	}
+	spin_unlock(block_lock);
+	/* Submit the whole batch before collecting anything, so writes to
+	 * different devices stay in flight together. */
+	for (size_t i = 0; i < count; ++i) {
+		batch[i].req.device = batch[i].device;
+		batch[i].req.write = 1;
+		batch[i].req.offset = batch[i].index * BLOCKCACHE_BLOCK_SIZE;
+		batch[i].req.size = batch[i].valid;
+		batch[i].req.buffer = batch[i].data;
+		batch[i].req.callback = NULL;
+		blockio_submit(&batch[i].req);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		blockio_wait(&batch[i].req);
+	}
+	free(batch);
+	return count;
+}
+
+/**
+ * @brief Write every dirty chunk out to its device.
+ */
+void blockcache_sync(void) {
+	while (blockcache_flush_some());
+}
+
+static void blockcache_flusher(void * arg) {
+	while (1) {
+		unsigned long s, ss;
+		relative_time(1, 0, &s, &ss);
+		sleep_until((process_t *)this_core->current_process, s, ss);
+		switch_task(0);
+		blockcache_sync();
+	}
+}
+
+/**
+ * @brief Copy part of one cached chunk out to a caller, filling on miss.
+ *
+ * @p offset and @p count must lie within a single chunk.
+ * @returns Bytes copied (short or zero at end-of-device), or a driver error.
+ */
+static ssize_t blockcache_read_block(fs_node_t * device, uint64_t index, size_t offset, size_t count, uint8_t * buffer) {
+	char key[64];
+	blockcache_key(key, device, index);
+
+	spin_lock(block_lock);
+	if (!block_hash) blockcache_init();
+	struct bc_entry * entry = hashmap_get(block_hash, key);
+	if (entry) counter_bump(COUNTER_BLOCKCACHE_HIT);
+	else counter_bump(COUNTER_BLOCKCACHE_MISS);
+	if (!entry) {
+		/* Miss. Fill a fresh entry outside the lock, as the device
+		 * read may block. */
+		spin_unlock(block_lock);
+		struct bc_entry * fresh = malloc(sizeof(struct bc_entry));
+		fresh->device = device;
+		fresh->index = index;
+		fresh->dirty = 0;
+		fresh->lru_node.value = fresh;
+		fresh->valid = read_fs(device, index * BLOCKCACHE_BLOCK_SIZE, BLOCKCACHE_BLOCK_SIZE, fresh->data);
+		if (fresh->valid < 0) {
+			ssize_t error = fresh->valid;
+			free(fresh);
+			return error;
+		}
+		spin_lock(block_lock);
+		entry = hashmap_get(block_hash, key);
+		if (entry) {
+			/* Someone else filled this chunk first; ours can go. */
+			free(fresh);
+		} else {
+			blockcache_evict();
+			hashmap_set(block_hash, key, fresh);
+			list_append(block_lru, &fresh->lru_node);
+			entry = fresh;
+		}
+	}
+
+	if ((size_t)entry->valid <= offset) {
+		spin_unlock(block_lock);
+		return 0;
+	}
+	if (count > (size_t)entry->valid - offset) count = (size_t)entry->valid - offset;
+	memcpy(buffer, entry->data + offset, count);
+	blockcache_touch(entry);
+	spin_unlock(block_lock);
+	return count;
+}
+
+/**
+ * @brief Read from a block device through the cache.
+ *
+ * Same contract as read_fs on the device itself.
+ */
+ssize_t blockcache_read(fs_node_t * device, off_t offset, size_t size, uint8_t * buffer) {
+	ssize_t total = 0;
+	while (size) {
+		uint64_t index = offset / BLOCKCACHE_BLOCK_SIZE;
+		size_t block_offset = offset % BLOCKCACHE_BLOCK_SIZE;
+		size_t count = BLOCKCACHE_BLOCK_SIZE - block_offset;
+		if (count > size) count = size;
+		ssize_t result = blockcache_read_block(device, index, block_offset, count, buffer);
+		if (result < 0) return total ? total : result;
+		total += result;
+		if ((size_t)result < count) break; /* End of device. */
+		buffer += result;
+		offset += result;
+		size -= result;
+	}
+	return total;
+}
+
+/**
+ * @brief Apply part of a write to one chunk, filling on miss.
+ *
+ * @p offset and @p count must lie within a single chunk.
+ * @returns 0 on success; negative if the chunk could not be filled,
+ *          in which case the caller writes that piece through.
+ */
+static ssize_t blockcache_write_block(fs_node_t * device, uint64_t index, size_t offset, size_t count, uint8_t * buffer) {
+	char key[64];
+	blockcache_key(key, device, index);
+
+	spin_lock(block_lock);
+	if (!block_hash) blockcache_init();
+	struct bc_entry * entry = hashmap_get(block_hash, key);
+	if (entry) counter_bump(COUNTER_BLOCKCACHE_HIT);
+	else counter_bump(COUNTER_BLOCKCACHE_MISS);
+	if (!entry) {
+		/* Miss. A partial write needs the rest of the chunk, so read it
+		 * in first - outside the lock, as the device read may block. A
+		 * write that covers the whole chunk just replaces it. */
+		spin_unlock(block_lock);
+		struct bc_entry * fresh = malloc(sizeof(struct bc_entry));
+		fresh->device = device;
+		fresh->index = index;
+		fresh->dirty = 0;
+		fresh->lru_node.value = fresh;
+		if (offset == 0 && count == BLOCKCACHE_BLOCK_SIZE) {
+			fresh->valid = BLOCKCACHE_BLOCK_SIZE;
+		} else {
+			fresh->valid = read_fs(device, index * BLOCKCACHE_BLOCK_SIZE, BLOCKCACHE_BLOCK_SIZE, fresh->data);
+			if (fresh->valid < 0) {
+				ssize_t error = fresh->valid;
+				free(fresh);
+				return error;
+			}
+			/* Don't leave a gap of stale heap between a short read and
+			 * the write we are about to apply. */
+			if (fresh->valid < BLOCKCACHE_BLOCK_SIZE) {
+				memset(fresh->data + fresh->valid, 0, BLOCKCACHE_BLOCK_SIZE - fresh->valid);
+			}
+		}
+		spin_lock(block_lock);
+		entry = hashmap_get(block_hash, key);
+		if (entry) {
+			/* Someone else filled this chunk first; ours can go. */
+			free(fresh);
+		} else {
+			blockcache_evict();
+			hashmap_set(block_hash, key, fresh);
+			list_append(block_lru, &fresh->lru_node);
+			entry = fresh;
+		}
+	}
+
+	memcpy(entry->data + offset, buffer, count);
+	if (entry->valid < (ssize_t)(offset + count)) entry->valid = offset + count;
+	if (!entry->dirty) {
+		entry->dirty = 1;
+		dirty_blocks++;
+	}
+	blockcache_touch(entry);
+	if (!flusher_started) {
+		flusher_started = 1;
+		spawn_worker_thread(blockcache_flusher, "[bcflush]", NULL);
+	}
+	spin_unlock(block_lock);
+	return 0;
+}
+
+/**
+ * @brief Write to a block device through the cache.
+ *
+ * The data lands in cached chunks and is marked dirty; the device
+ * write happens later, from the flusher or @ref blockcache_sync.
+ */
+ssize_t blockcache_write(fs_node_t * device, off_t offset, size_t size, uint8_t * buffer) {
+	off_t o = offset;
+	size_t s = size;
+	uint8_t * b = buffer;
+	while (s) {
+		uint64_t index = o / BLOCKCACHE_BLOCK_SIZE;
+		size_t block_offset = o % BLOCKCACHE_BLOCK_SIZE;
+		size_t count = BLOCKCACHE_BLOCK_SIZE - block_offset;
+		if (count > s) count = s;
+		if (blockcache_write_block(device, index, block_offset, count, b) < 0) {
+			ssize_t result = write_fs(device, o, count, b);
+			if (result < 0) return (o == offset) ? result : (ssize_t)(o - offset);
+		}
+		o += count;
+		b += count;
+		s -= count;
+	}
+	/* Pressure: if too much of the cache is dirty, the writer pays for
+	 * a flush batch itself rather than waiting on the interval. */
+	if (dirty_blocks > max_blocks / 4) blockcache_flush_some();
+	return size;
+}
+
+/**
+ * @brief Number of chunks currently cached.
+ */
+size_t blockcache_block_count(void) {
+	return block_lru ? block_lru->length : 0;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file  kernel/vfs/blockio.c
+ * @brief Asynchronous block I/O request queues.
+ *
+ * The storage drivers themselves are synchronous: a read_fs against
+ * ata.c parks the calling thread until the transfer interrupt fires.
+ * This layer lets callers that do not need the data immediately - the
+ * block cache flusher, prefetchers, anything walking several devices -
+ * submit requests and carry on. Each device gets its own queue and
+ * worker tasklet, so requests to different devices proceed in
+ * parallel and a caller can keep many requests in flight and collect
+ * them afterwards.
+ *
+ * Queues keep their pending requests sorted by device offset and the
+ * worker services them elevator-style, sweeping upward from the last
+ * offset it issued; a request that has been passed over for too many
+ * services is issued next regardless, so the sweep cannot starve
+ * anyone. When the request about to be issued has neighbours that are
+ * physically contiguous and in the same direction, they are issued as
+ * one combined transfer through a bounce buffer - scattered 4KiB
+ * flusher writes over a contiguous file coalesce into large device
+ * commands. True in-device queueing (NCQ) belongs to the driver
+ * underneath, which can adopt this interface when it grows it.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/vfs.h>
+#include <kernel/list.h>
+#include <kernel/process.h>
+#include <kernel/blockio.h>
+
+/* A request may sit through this many issues before it is forced to
+ * the front of the elevator sweep. */
+#define BLOCKIO_DEADLINE 32
+/* Upper bound on one merged transfer. */
+#define BLOCKIO_MERGE_MAX 0x10000
+/* Most requests one merged transfer may cover. */
+#define BLOCKIO_MERGE_REQS 16
+
+struct blockio_queue {
+	fs_node_t * device;
+	list_t * requests;  /* Pending requests, sorted by offset, linked through their embedded nodes */
+	list_t * wait;      /* The worker sleeps here when the queue is empty */
+	list_t * complete;  /* blockio_wait callers sleep here */
+	spin_lock_t lock;
+	off_t position;     /* Elevator sweep position: offset just past the last issue */
+	uint64_t served;    /* Issues so far; requests expire against this */
+};
+
+/* One queue per device node, created on first use and kept for the
+ * life of the system - block device nodes are few and long-lived. */
+static list_t * queues = NULL;
+static spin_lock_t queues_lock = { 0 };
+
+static void blockio_complete(struct blockio_queue * queue, struct blockio_request ** batch, size_t count) {
+	int wake = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (batch[i]->callback) {
+			/* The callback owns the request now; don't touch it after. */
+			batch[i]->callback(batch[i]);
+		} else {
+			spin_lock(queue->lock);
+			batch[i]->done = 1;
+			spin_unlock(queue->lock);
+			wake = 1;
+		}
+	}
+	if (wake) wakeup_queue(queue->complete);
+}
+
+static void blockio_worker(void * argp) {
+	struct blockio_queue * queue = argp;
+	struct blockio_request * batch[BLOCKIO_MERGE_REQS];
+	while (1) {
+		spin_lock(queue->lock);
+		if (!queue->requests->length) {
+			sleep_on_unlocking(queue->wait, &queue->lock);
+			continue;
+		}
+
+		/* An expired request is issued next no matter where the sweep
+		 * is; otherwise take the first request at or past the sweep
+		 * position, wrapping to the lowest offset. */
+		node_t * pick = NULL;
+		node_t * expired = NULL;
+		foreach(n, queue->requests) {
+			struct blockio_request * req = n->value;
+			if (!expired && queue->served >= req->deadline) expired = n;
+			if (!pick && req->offset >= queue->position) pick = n;
+		}
+		if (expired) pick = expired;
+		if (!pick) pick = queue->requests->head;
+
+		/* The list is sorted, so a contiguous run sits in adjacent
+		 * nodes; back up to its start, then collect forward. */
+		int write = ((struct blockio_request *)pick->value)->write;
+		while (pick->prev) {
+			struct blockio_request * prev = pick->prev->value;
+			struct blockio_request * cur = pick->value;
+			if (prev->write != write || prev->offset + (off_t)prev->size != cur->offset) break;
+			pick = pick->prev;
+		}
+
+		size_t count = 0;
+		size_t total = 0;
+		for (node_t * n = pick; n && count < BLOCKIO_MERGE_REQS; n = n->next) {
+			struct blockio_request * req = n->value;
+			if (count) {
+				struct blockio_request * last = batch[count-1];
+				if (req->write != write) break;
+				if (last->offset + (off_t)last->size != req->offset) break;
+				if (total + req->size > BLOCKIO_MERGE_MAX) break;
+			}
+			batch[count++] = req;
+			total += req->size;
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+			list_delete(queue->requests, &batch[i]->node);
+		}
+		queue->served++;
+		queue->position = batch[count-1]->offset + batch[count-1]->size;
+		spin_unlock(queue->lock);
+
+		if (count == 1) {
+			struct blockio_request * req = batch[0];
+			if (req->write) {
+				req->result = write_fs(req->device, req->offset, req->size, req->buffer);
+			} else {
+				req->result = read_fs(req->device, req->offset, req->size, req->buffer);
+			}
+		} else {
+			/* One combined transfer through a bounce buffer, its result
+			 * split back out by each request's position in the run. */
+			uint8_t * bounce = malloc(total);
+			off_t base = batch[0]->offset;
+			ssize_t result;
+			if (write) {
+				size_t at = 0;
+				for (size_t i = 0; i < count; ++i) {
+					memcpy(bounce + at, batch[i]->buffer, batch[i]->size);
+					at += batch[i]->size;
+				}
+				result = write_fs(queue->device, base, total, bounce);
+			} else {
+				result = read_fs(queue->device, base, total, bounce);
+			}
+			size_t at = 0;
+			for (size_t i = 0; i < count; ++i) {
+				if (result < 0) {
+					batch[i]->result = result;
+				} else {
+					size_t avail = ((size_t)result > at) ? (size_t)result - at : 0;
+					if (avail > batch[i]->size) avail = batch[i]->size;
+					if (!write && avail) memcpy(batch[i]->buffer, bounce + at, avail);
+					batch[i]->result = avail;
+				}
+				at += batch[i]->size;
+			}
+			free(bounce);
+		}
+
+		blockio_complete(queue, batch, count);
+	}
+}
+
+static struct blockio_queue * blockio_queue_for(fs_node_t * device) {
+	spin_lock(queues_lock);
+	if (!queues) queues = list_create("blockio queues", NULL);
+	foreach(n, queues) {
+		struct blockio_queue * queue = n->value;
+		if (queue->device == device) {
+			spin_unlock(queues_lock);
+			return queue;
+		}
+	}
+	struct blockio_queue * queue = malloc(sizeof(struct blockio_queue));
+	queue->device = device;
+	queue->requests = list_create("blockio requests", queue);
+	queue->wait = list_create("blockio worker wait", queue);
+	queue->complete = list_create("blockio completion wait", queue);
+	spin_init(queue->lock);
+	queue->position = 0;
+	queue->served = 0;
+	list_insert(queues, queue);
+	spawn_worker_thread(blockio_worker, "[blockio]", queue);
+	spin_unlock(queues_lock);
+	return queue;
+}
+
+/**
+ * @brief Queue a request on its device and return immediately.
+ *
+ * See struct blockio_request for the completion contract.
+ */
+void blockio_submit(struct blockio_request * req) {
+	/* Partition nodes are windows onto a real device; fold the window
+	 * offset in up front and queue on the device itself, so requests to
+	 * different partitions of one disk share an elevator and can merge. */
+	while (req->device->passthrough_device) {
+		req->offset += req->device->passthrough_base;
+		req->device = req->device->passthrough_device;
+	}
+
+	struct blockio_queue * queue = blockio_queue_for(req->device);
+	req->queue = queue;
+	req->done = 0;
+	req->result = 0;
+	req->node.value = req;
+
+	spin_lock(queue->lock);
+	req->deadline = queue->served + BLOCKIO_DEADLINE;
+	/* Keep the queue sorted by offset so the elevator sweep and the
+	 * merge scan only ever look at adjacent nodes. */
+	node_t * after = NULL;
+	foreach(n, queue->requests) {
+		struct blockio_request * other = n->value;
+		if (other->offset > req->offset) {
+			after = n;
+			break;
+		}
+	}
+	if (after) {
+		list_append_before(queue->requests, after, &req->node);
+	} else {
+		list_append(queue->requests, &req->node);
+	}
+	spin_unlock(queue->lock);
+	wakeup_queue(queue->wait);
+}
+
+/**
+ * @brief Sleep until a submitted request finishes.
+ *
+ * Only for requests submitted without a callback.
+ *
+ * @returns The transfer's read_fs/write_fs result.
+ */
+ssize_t blockio_wait(struct blockio_request * req) {
+	struct blockio_queue * queue = req->queue;
+	spin_lock(queue->lock);
+	while (!req->done) {
+		sleep_on_unlocking(queue->complete, &queue->lock);
+		spin_lock(queue->lock);
+	}
+	spin_unlock(queue->lock);
+	return req->result;
+}
@@ -14,6 +14,7 @@
 #include <kernel/string.h>
 #include <kernel/printf.h>
 #include <kernel/time.h>
+#include <kernel/klog.h>
 
 static fs_node_t * console_dev = NULL;
 
@@ -58,6 +59,19 @@ static int cb_printf(void * user, char c) {
 	return 0;
 }
 
+/* Direct console output, bypassing the log queue; used by the klog
+ * drain and for anything that must hit the wire immediately. */
+ssize_t console_write_direct(size_t size, uint8_t * buffer) {
+	return write_console(size, buffer);
+}
+
+/* Whether @p output is the console's registered backend; printf() uses
+ * this to tell the normal console apart from a hijacked printf_output
+ * (the vbox module points it at the host log port). */
+int console_is_output(size_t (*output)(size_t,uint8_t*)) {
+	return output && output == console_write;
+}
+
 void console_set_output(size_t (*output)(size_t,uint8_t*)) {
 	console_write = output;
 
@@ -71,19 +85,36 @@ int dprintf(const char * fmt, ...) {
 	va_list args;
 	va_start(args, fmt);
 
-	/* Is this a FATAL message? */
-
-	/* If it's ready now but wasn't ready previously, are there
-	 * things in the queue to dump? */
-
-	/* Is this a fresh message for this core that we need to assign a timestamp to? */
+	/* An optional severity prefix comes first; info by default. */
+	int severity = 6;
+	if (fmt[0] == '\003' && fmt[1] >= '0' && fmt[1] <= '7') {
+		severity = fmt[1] - '0';
+		fmt += 2;
+	}
 
+	/* Then the continuation marker, which suppresses the timestamp. */
+	int raw = (*fmt == '\a');
+	if (raw) fmt++;
+
+	/* Once tasking is up, messages queue in per-core rings and a
+	 * worker drains them; timestamps are assigned at queue time. */
+	if (klog_active) {
+		char buf[1024];
+		va_list args2;
+		va_copy(args2, args);
+		int len = vsnprintf(buf, sizeof(buf), fmt, args2);
+		va_end(args2);
+		if ((size_t)len > sizeof(buf) - 1) len = sizeof(buf) - 1;
+		if (klog_append(severity, raw, buf, len)) {
+			va_end(args);
+			return len;
+		}
+	}
 
+	/* Synchronous path, for early boot and after a panic. */
 	struct dprintf_data _data = {0,0};
 
-	if (*fmt == '\a') {
-		fmt++;
-	} else {
+	if (!raw) {
 		char timestamp[32];
 		unsigned long timer_ticks, timer_subticks;
 		relative_time(0,0,&timer_ticks,&timer_subticks);
@@ -101,11 +132,24 @@ static ssize_t write_fs_console(fs_node_t * node, off_t offset, size_t size, uin
 	if (size > 0x1000) return -EINVAL;
 	size_t size_in = size;
 	if (size && *buffer == '\r') {
-		write_console(1,(uint8_t*)"\r");
+		if (!klog_active || !klog_append(6, 1, "\r", 1)) write_console(1,(uint8_t*)"\r");
 		buffer++;
 		size--;
 	}
-	if (size) dprintf("%*s", (unsigned int)size, buffer);
+	/* The buffer is user data with no terminator, so feed it to the log
+	 * queue by length rather than through a format string; under flood
+	 * the ring drops with a count instead of stalling this process at
+	 * device speed. The first chunk gets the usual timestamp. */
+	int first = 1;
+	while (size) {
+		size_t chunk = size > 1024 ? 1024 : size;
+		if (!klog_active || !klog_append(6, !first, (char*)buffer, chunk)) {
+			dprintf(first ? "%.*s" : "\a%.*s", (int)chunk, buffer);
+		}
+		buffer += chunk;
+		size -= chunk;
+		first = 0;
+	}
 	return size_in;
 }
 
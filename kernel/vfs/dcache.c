@@ -0,0 +1,168 @@
+/**
+ * @file  kernel/vfs/dcache.c
+ * @brief Cache of directory lookup results for path resolution.
+ *
+ * Every open re-walks its path through finddir, which for on-disk
+ * filesystems means re-parsing directory blocks for every component;
+ * a process launch resolving a dozen libraries repeats the same
+ * lookups hundreds of times. This caches the result of one finddir
+ * call - the returned node, or the fact that the name was not found -
+ * keyed by the parent's device and inode plus the child name, so hot
+ * paths resolve without calling into the filesystem at all.
+ *
+ * Staleness is handled at the call sites rather than here: the VFS
+ * evicts a name when it creates, unlinks, or symlinks it, and opens
+ * that may modify a file bypass the cache for the final component so
+ * a cached node never carries an outdated length. Entries are
+ * recycled least-recently-used beyond a fixed cap.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/vfs.h>
+#include <kernel/hashmap.h>
+#include <kernel/list.h>
+
+#define DCACHE_MAX_ENTRIES 4096
+#define DCACHE_MAX_NAME 255
+
+struct dc_entry {
+	node_t lru_node;
+	int negative;
+	fs_node_t node; /* Copy of the finddir result; meaningless if negative. */
+	char key[];
+};
+
+static hashmap_t * dc_hash = NULL;
+static list_t * dc_lru = NULL;
+static spin_lock_t dc_lock = { 0 };
+
+/* Parents are identified the way the page cache identifies files: by
+ * device pointer and inode, the only identity that survives the node
+ * clones kopen passes around. Parents carrying neither are anonymous
+ * and can't be cached against. */
+static int dcache_key(char * key, fs_node_t * parent, const char * name) {
+	if (!parent->device && !parent->inode) return 0;
+	if (strlen(name) > DCACHE_MAX_NAME) return 0;
+	snprintf(key, 32 + DCACHE_MAX_NAME, "%zx:%zx:%s", (size_t)(uintptr_t)parent->device, (size_t)parent->inode, name);
+	return 1;
+}
+
+static void dcache_evict_oldest(void) {
+	while (dc_lru->length >= DCACHE_MAX_ENTRIES) {
+		node_t * n = list_dequeue(dc_lru);
+		struct dc_entry * victim = n->value;
+		hashmap_remove(dc_hash, victim->key);
+		free(victim);
+	}
+}
+
+/**
+ * @brief Look up a cached directory entry.
+ *
+ * On a hit, @p out receives a fresh clone of the cached node - or
+ * NULL if the name is cached as not existing - and the entry moves to
+ * the young end of the LRU.
+ *
+ * @returns 1 on a hit (positive or negative), 0 on a miss.
+ */
+int dcache_lookup(fs_node_t * parent, const char * name, fs_node_t ** out) {
+	char key[32 + DCACHE_MAX_NAME];
+	if (!dcache_key(key, parent, name)) return 0;
+
+	spin_lock(dc_lock);
+	if (!dc_hash) {
+		spin_unlock(dc_lock);
+		return 0;
+	}
+	struct dc_entry * entry = hashmap_get(dc_hash, key);
+	if (!entry) {
+		spin_unlock(dc_lock);
+		return 0;
+	}
+	if (entry->negative) {
+		*out = NULL;
+	} else {
+		fs_node_t * clone = malloc(sizeof(fs_node_t));
+		memcpy(clone, &entry->node, sizeof(fs_node_t));
+		clone->refcount = 0;
+		*out = clone;
+	}
+	list_delete(dc_lru, &entry->lru_node);
+	list_append(dc_lru, &entry->lru_node);
+	spin_unlock(dc_lock);
+	return 1;
+}
+
+/**
+ * @brief Remember the result of a directory lookup.
+ *
+ * @p node is the finddir result and may be NULL, which stores a
+ * negative entry so repeated lookups of missing names (PATH searches,
+ * optional config files) also stop hitting the filesystem.
+ */
+void dcache_store(fs_node_t * parent, const char * name, fs_node_t * node) {
+	char key[32 + DCACHE_MAX_NAME];
+	if (!dcache_key(key, parent, name)) return;
+
+	struct dc_entry * entry = malloc(sizeof(struct dc_entry) + strlen(key) + 1);
+	entry->lru_node.value = entry;
+	entry->negative = !node;
+	if (node) {
+		memcpy(&entry->node, node, sizeof(fs_node_t));
+		entry->node.refcount = 0;
+	}
+	strcpy(entry->key, key);
+
+	spin_lock(dc_lock);
+	if (!dc_hash) {
+		dc_hash = hashmap_create(0x1000);
+		dc_lru = list_create("dcache lru", NULL);
+	}
+	struct dc_entry * old = hashmap_get(dc_hash, key);
+	if (old) {
+		/* Raced with another walker; theirs is as good as ours. */
+		spin_unlock(dc_lock);
+		free(entry);
+		return;
+	}
+	dcache_evict_oldest();
+	hashmap_set(dc_hash, entry->key, entry);
+	list_append(dc_lru, &entry->lru_node);
+	spin_unlock(dc_lock);
+}
+
+/**
+ * @brief Drop any cached entry for @p name under @p parent.
+ *
+ * Called by the VFS whenever a name is created, removed, or about to
+ * be opened for writing.
+ */
+void dcache_evict(fs_node_t * parent, const char * name) {
+	char key[32 + DCACHE_MAX_NAME];
+	if (!dcache_key(key, parent, name)) return;
+
+	spin_lock(dc_lock);
+	if (dc_hash) {
+		struct dc_entry * entry = hashmap_get(dc_hash, key);
+		if (entry) {
+			hashmap_remove(dc_hash, key);
+			list_delete(dc_lru, &entry->lru_node);
+			free(entry);
+		}
+	}
+	spin_unlock(dc_lock);
+}
+
+/**
+ * @brief Number of entries currently cached.
+ */
+size_t dcache_entry_count(void) {
+	return dc_lru ? dc_lru->length : 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file  kernel/vfs/eventset.c
+ * @brief Persistent interest sets for event polling.
+ *
+ * fswait3 validates, copies, and registers its entire fd array on every
+ * call, and reports one ready descriptor per wakeup - a heavy loop for
+ * anything watching dozens of descriptors thousands of times a second.
+ * An event set keeps the membership in the kernel: descriptors are
+ * added once, each wait scans only kernel-side state with no per-call
+ * allocation or user copies, and everything that is ready comes back
+ * in one batch.
+ *
+ * Sets are file descriptors themselves, so they close with the process
+ * and can even be nested in fswait or other sets. Waiters still
+ * register with member devices through the usual selectwait path when
+ * they block - that contract is shared with every driver - but
+ * registration only happens when the set is actually empty of events.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <errno.h>
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/vfs.h>
+#include <kernel/list.h>
+#include <kernel/spinlock.h>
+#include <kernel/process.h>
+#include <kernel/syscall.h>
+
+#define EVENTSET_MAGIC 0x45565354
+
+struct evmember {
+	int fd;
+	fs_node_t * node;
+	node_t link;
+};
+
+struct eventset {
+	uint32_t magic;
+	spin_lock_t lock;
+	list_t * members;
+	fs_node_t ** scratch; /* NULL-terminated member array for blocking */
+	size_t scratch_size;
+};
+
+static struct eventset * eventset_from_node(fs_node_t * node) {
+	struct eventset * es = node->device;
+	if (!es || es->magic != EVENTSET_MAGIC) return NULL;
+	return es;
+}
+
+/* Set lock held; keep the scratch array in sync with the membership so
+ * waits don't allocate. */
+static void eventset_rebuild_scratch(struct eventset * es) {
+	if (es->scratch) free(es->scratch);
+	es->scratch_size = es->members->length;
+	es->scratch = malloc(sizeof(fs_node_t *) * (es->scratch_size + 1));
+	size_t i = 0;
+	foreach(n, es->members) {
+		struct evmember * m = n->value;
+		es->scratch[i++] = m->node;
+	}
+	es->scratch[i] = NULL;
+}
+
+static int eventset_check(fs_node_t * node) {
+	struct eventset * es = eventset_from_node(node);
+	if (!es) return -1;
+	int ready = 1;
+	spin_lock(es->lock);
+	foreach(n, es->members) {
+		struct evmember * m = n->value;
+		if (selectcheck_fs(m->node) == 0) {
+			ready = 0;
+			break;
+		}
+	}
+	spin_unlock(es->lock);
+	return ready;
+}
+
+static int eventset_wait(fs_node_t * node, void * process) {
+	struct eventset * es = eventset_from_node(node);
+	if (!es) return -1;
+	spin_lock(es->lock);
+	foreach(n, es->members) {
+		struct evmember * m = n->value;
+		selectwait_fs(m->node, process);
+	}
+	spin_unlock(es->lock);
+	return 0;
+}
+
+static void eventset_close(fs_node_t * node) {
+	struct eventset * es = eventset_from_node(node);
+	if (!es) return;
+	spin_lock(es->lock);
+	while (es->members->length) {
+		node_t * n = list_dequeue(es->members);
+		struct evmember * m = n->value;
+		close_fs(m->node);
+		free(m);
+	}
+	spin_unlock(es->lock);
+	free(es->members);
+	if (es->scratch) free(es->scratch);
+	free(es);
+	node->device = NULL;
+}
+
+long evset_create(void) {
+	struct eventset * es = calloc(1, sizeof(struct eventset));
+	es->magic = EVENTSET_MAGIC;
+	es->members = list_create("eventset members", es);
+
+	fs_node_t * node = calloc(1, sizeof(fs_node_t));
+	snprintf(node->name, 100, "[eventset]");
+	node->mask = 0600;
+	node->device = es;
+	node->close = eventset_close;
+	node->selectcheck = eventset_check;
+	node->selectwait = eventset_wait;
+
+	int fd = process_append_fd((process_t *)this_core->current_process, node);
+	FD_MODE(fd) = 3;
+	return fd;
+}
+
+long evset_ctl(int setfd, int op, int fd) {
+	if (!FD_CHECK(setfd)) return -EBADF;
+	struct eventset * es = eventset_from_node(FD_ENTRY(setfd));
+	if (!es) return -EINVAL;
+	if (!FD_CHECK(fd)) return -EBADF;
+	fs_node_t * target = FD_ENTRY(fd);
+	if (target == FD_ENTRY(setfd)) return -EINVAL; /* no self-reference */
+
+	spin_lock(es->lock);
+	switch (op) {
+		case 0: { /* add */
+			foreach(n, es->members) {
+				struct evmember * m = n->value;
+				if (m->fd == fd) {
+					spin_unlock(es->lock);
+					return -EEXIST;
+				}
+			}
+			struct evmember * m = malloc(sizeof(struct evmember));
+			m->fd = fd;
+			m->node = target;
+			m->link.value = m;
+			open_fs(target, 0); /* the set holds its own reference */
+			list_append(es->members, &m->link);
+			eventset_rebuild_scratch(es);
+			spin_unlock(es->lock);
+			return 0;
+		}
+		case 1: { /* delete */
+			foreach(n, es->members) {
+				struct evmember * m = n->value;
+				if (m->fd == fd) {
+					list_delete(es->members, n);
+					eventset_rebuild_scratch(es);
+					spin_unlock(es->lock);
+					close_fs(m->node);
+					free(m);
+					return 0;
+				}
+			}
+			spin_unlock(es->lock);
+			return -ENOENT;
+		}
+		default:
+			spin_unlock(es->lock);
+			return -EINVAL;
+	}
+}
+
+long evset_wait(int setfd, int * out, int max, int timeout) {
+	PTR_VALIDATE(out);
+	if (!out || max <= 0) return -EINVAL;
+	if (!FD_CHECK(setfd)) return -EBADF;
+	struct eventset * es = eventset_from_node(FD_ENTRY(setfd));
+	if (!es) return -EINVAL;
+
+	do {
+		/* Collect everything that's ready in one pass. */
+		int count = 0;
+		spin_lock(es->lock);
+		foreach(n, es->members) {
+			struct evmember * m = n->value;
+			if (count >= max) break;
+			if (selectcheck_fs(m->node) == 0) {
+				out[count++] = m->fd;
+			}
+		}
+		spin_unlock(es->lock);
+		if (count) return count;
+		if (!es->scratch || !es->scratch_size) return 0; /* nothing to wait for */
+		if (timeout == 0) return 0;
+
+		/* Nothing ready; block on the membership. The scratch array is
+		 * only rebuilt under the lock by ctl, and member nodes are
+		 * pinned by the set's references. */
+		int result = process_wait_nodes((process_t *)this_core->current_process, es->scratch, timeout);
+		if (result == -1 && timeout > 0) {
+			/* Timed out (or interrupted); report what's ready, if
+			 * anything arrived while we were being woken. */
+			timeout = 0;
+		}
+	} while (1);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file  kernel/vfs/pagecache.c
+ * @brief Page cache backing file mappings.
+ *
+ * Caches file contents at page granularity so that file-backed
+ * memory mappings (sys_mmap) can share physical frames: every mapping
+ * of the same page of the same file - across processes and across
+ * repeated opens - points at one cached frame, read from the backing
+ * filesystem exactly once. Cached frames are marked shared with the
+ * MMU, which maps them read-only copy-on-write and never frees them,
+ * so private dirty copies split off on write without any bookkeeping
+ * here.
+ *
+ * Pages are keyed by the owning node's device pointer and inode, the
+ * only identity that survives reopening a file; nodes carrying
+ * neither cannot be cached. The cache does not write back and is not
+ * invalidated when a file is written through the VFS, so it is only
+ * offered for mappings, where the consumers - libraries, read-only
+ * assets - do not change underneath. There is no eviction yet.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/vfs.h>
+#include <kernel/hashmap.h>
+#include <kernel/mmu.h>
+#include <kernel/process.h>
+
+static hashmap_t * page_hash = NULL;
+static spin_lock_t page_hash_lock = { 0 };
+static size_t pagecache_frames = 0;
+
+static void pagecache_key(char * key, fs_node_t * node, uint64_t offset) {
+	snprintf(key, 64, "%zx:%zx:%zx", (size_t)(uintptr_t)node->device, (size_t)node->inode, (size_t)(offset >> 12));
+}
+
+/**
+ * @brief Obtain the cached frame for one page of a file.
+ *
+ * Returns the frame index holding the 4KiB of @p node starting at
+ * @p offset, filling it from the filesystem on first request. The
+ * frame is marked shared and may be mapped copy-on-write into any
+ * address space; short reads at end-of-file are zero padded.
+ *
+ * @param node File to read from.
+ * @param offset Page-aligned offset into the file.
+ * @returns A shared frame index, or (uintptr_t)-1 if the node cannot be cached.
+ */
+uintptr_t pagecache_get_frame(fs_node_t * node, uint64_t offset) {
+	if (!node->device && !node->inode) return (uintptr_t)-1;
+
+	char key[64];
+	pagecache_key(key, node, offset);
+
+	spin_lock(page_hash_lock);
+	if (!page_hash) page_hash = hashmap_create(0x1000);
+	void * cached = hashmap_get(page_hash, key);
+	spin_unlock(page_hash_lock);
+	if (cached) return (uintptr_t)cached;
+
+	/* Miss. Fill a frame from the file outside the lock, as the read
+	 * may block on the backing device. */
+	uintptr_t frame = mmu_allocate_a_frame();
+	uint8_t * data = mmu_map_from_physical(frame << 12);
+	memset(data, 0, 0x1000);
+	read_fs(node, offset, 0x1000, data);
+
+	spin_lock(page_hash_lock);
+	void * raced = hashmap_get(page_hash, key);
+	if (raced) {
+		/* Someone else filled this page first; ours was never shared
+		 * with anyone, so it can go straight back. */
+		spin_unlock(page_hash_lock);
+		mmu_frame_clear(frame << 12);
+		return (uintptr_t)raced;
+	}
+	mmu_frame_mark_shared(frame);
+	hashmap_set(page_hash, key, (void*)frame);
+	pagecache_frames++;
+	spin_unlock(page_hash_lock);
+
+	return frame;
+}
+
+/**
+ * @brief Number of frames currently held by the page cache.
+ */
+size_t pagecache_frame_count(void) {
+	return pagecache_frames;
+}
@@ -27,6 +27,7 @@
 #include <kernel/spinlock.h>
 #include <kernel/signal.h>
 #include <kernel/time.h>
+#include <kernel/counters.h>
 
 #include <sys/signal_defs.h>
 
@@ -45,10 +46,7 @@ static inline size_t pipe_unread(pipe_device_t * pipe) {
 
 int pipe_size(fs_node_t * node) {
 	pipe_device_t * pipe = (pipe_device_t *)node->device;
-	spin_lock(pipe->ptr_lock);
-	int out = pipe_unread(pipe);
-	spin_unlock(pipe->ptr_lock);
-	return out;
+	return pipe_unread(pipe);
 }
 
 static inline size_t pipe_available(pipe_device_t * pipe) {
@@ -65,47 +63,51 @@ static inline size_t pipe_available(pipe_device_t * pipe) {
 
 int pipe_unsize(fs_node_t * node) {
 	pipe_device_t * pipe = (pipe_device_t *)node->device;
-	spin_lock(pipe->ptr_lock);
-	int out = pipe_available(pipe);
-	spin_unlock(pipe->ptr_lock);
-	return out;
+	return pipe_available(pipe);
 }
 
-static inline void pipe_increment_read(pipe_device_t * pipe) {
-	spin_lock(pipe->ptr_lock);
-	pipe->read_ptr++;
-	if (pipe->read_ptr == pipe->size) {
-		pipe->read_ptr = 0;
+/* Copy up to @p size unread bytes out in at most two segments, then
+ * publish the new read_ptr with a single store; the barrier keeps the
+ * index update behind the copies. Caller holds lock_read. */
+static size_t pipe_copy_out(pipe_device_t * pipe, uint8_t * buffer, size_t size) {
+	size_t avail = pipe_unread(pipe);
+	if (size > avail) size = avail;
+	if (!size) return 0;
+
+	size_t read_ptr = pipe->read_ptr;
+	size_t first = pipe->size - read_ptr;
+	if (first > size) first = size;
+	memcpy(buffer, pipe->buffer + read_ptr, first);
+	if (size > first) {
+		memcpy(buffer + first, pipe->buffer, size - first);
 	}
-	spin_unlock(pipe->ptr_lock);
+
+	__sync_synchronize();
+	pipe->read_ptr = (read_ptr + size) % pipe->size;
+	return size;
 }
 
-static inline void pipe_increment_write(pipe_device_t * pipe) {
-	spin_lock(pipe->ptr_lock);
-	pipe->write_ptr++;
-	if (pipe->write_ptr == pipe->size) {
-		pipe->write_ptr = 0;
+/* The write-side counterpart; caller holds lock_write. */
+static size_t pipe_copy_in(pipe_device_t * pipe, uint8_t * buffer, size_t size) {
+	size_t space = pipe_available(pipe);
+	if (size > space) size = space;
+	if (!size) return 0;
+
+	size_t write_ptr = pipe->write_ptr;
+	size_t first = pipe->size - write_ptr;
+	if (first > size) first = size;
+	memcpy(pipe->buffer + write_ptr, buffer, first);
+	if (size > first) {
+		memcpy(pipe->buffer, buffer + first, size - first);
 	}
-	spin_unlock(pipe->ptr_lock);
-}
 
-static inline void pipe_increment_write_by(pipe_device_t * pipe, size_t amount) {
-	pipe->write_ptr = (pipe->write_ptr + amount) % pipe->size;
+	__sync_synchronize();
+	pipe->write_ptr = (write_ptr + size) % pipe->size;
+	return size;
 }
 
 static void pipe_alert_waiters(pipe_device_t * pipe) {
-	spin_lock(pipe->alert_lock);
-	while (pipe->alert_waiters->head) {
-		node_t * node = list_dequeue(pipe->alert_waiters);
-		process_t * p = node->value;
-		free(node);
-		spin_unlock(pipe->alert_lock);
-
-		process_alert_node(p, pipe);
-
-		spin_lock(pipe->alert_lock);
-	}
-	spin_unlock(pipe->alert_lock);
+	fswait_queue_alert(&pipe->alert, pipe);
 }
 
 ssize_t read_pipe(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
@@ -121,18 +123,22 @@ ssize_t read_pipe(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
 	while (collected == 0) {
 		spin_lock(pipe->lock_read);
 		if (pipe_unread(pipe) >= size) {
-			while (pipe_unread(pipe) > 0 && collected < size) {
-				buffer[collected] = pipe->buffer[pipe->read_ptr];
-				pipe_increment_read(pipe);
-				collected++;
-			}
+			collected = pipe_copy_out(pipe, buffer, size);
 		}
-		wakeup_queue(pipe->wait_queue_writers);
 		/* Deschedule and switch */
 		if (collected == 0) {
 			sleep_on_unlocking(pipe->wait_queue_readers, &pipe->lock_read);
 		} else {
 			spin_unlock(pipe->lock_read);
+			/* The brief acquire of the writer lock orders this wakeup
+			 * after any in-progress decision by a writer to sleep;
+			 * sleep_on_unlocking queues the sleeper before unlocking,
+			 * so a writer we raced either sees the space we just made
+			 * or is already on the queue when we get here. */
+			spin_lock(pipe->lock_write);
+			spin_unlock(pipe->lock_write);
+			counter_bump(COUNTER_PIPE_WAKEUP);
+			wakeup_queue(pipe->wait_queue_writers);
 		}
 	}
 
@@ -150,21 +156,21 @@ ssize_t write_pipe(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer)
 
 	size_t written = 0;
 	while (written < size) {
-		spin_lock(pipe->lock_read);
+		spin_lock(pipe->lock_write);
 		/* These pipes enforce atomic writes, poorly. */
 		if (pipe_available(pipe) > size) {
-			while (pipe_available(pipe) > 0 && written < size) {
-				pipe->buffer[pipe->write_ptr] = buffer[written];
-				pipe_increment_write(pipe);
-				written++;
-			}
+			written = pipe_copy_in(pipe, buffer, size);
 		}
-		wakeup_queue(pipe->wait_queue_readers);
-		pipe_alert_waiters(pipe);
 		if (written < size) {
-			sleep_on_unlocking(pipe->wait_queue_writers, &pipe->lock_read);
+			sleep_on_unlocking(pipe->wait_queue_writers, &pipe->lock_write);
 		} else {
+			spin_unlock(pipe->lock_write);
+			/* Same handshake as read_pipe, from the other side. */
+			spin_lock(pipe->lock_read);
 			spin_unlock(pipe->lock_read);
+			counter_bump(COUNTER_PIPE_WAKEUP);
+			wakeup_queue(pipe->wait_queue_readers);
+			pipe_alert_waiters(pipe);
 		}
 	}
 
@@ -216,32 +222,19 @@ static int pipe_check(fs_node_t * node) {
 
 static int pipe_wait(fs_node_t * node, void * process) {
 	pipe_device_t * pipe = (pipe_device_t *)node->device;
-
-	spin_lock(pipe->alert_lock);
-	if (!list_find(pipe->alert_waiters, process)) {
-		list_insert(pipe->alert_waiters, process);
-	}
-	spin_unlock(pipe->alert_lock);
-
-	spin_lock(pipe->wait_lock);
-	list_insert(((process_t *)process)->node_waits, pipe);
-	spin_unlock(pipe->wait_lock);
-
+	fswait_queue_wait(&pipe->alert, process, pipe);
 	return 0;
 }
 
 void pipe_destroy(fs_node_t * node) {
 	pipe_device_t * pipe = (pipe_device_t *)node->device;
-	spin_lock(pipe->ptr_lock);
 	pipe->dead = 1;
-	pipe_alert_waiters(pipe);
+	fswait_queue_destroy(&pipe->alert, pipe);
 	wakeup_queue(pipe->wait_queue_writers);
 	wakeup_queue(pipe->wait_queue_readers);
-	free(pipe->alert_waiters);
 	free(pipe->wait_queue_writers);
 	free(pipe->wait_queue_readers);
 	free(pipe->buffer);
-	spin_unlock(pipe->ptr_lock);
 	free(pipe);
 }
 
@@ -284,13 +277,11 @@ fs_node_t * make_pipe(size_t size) {
 	pipe->dead      = 0;
 
 	spin_init(pipe->lock_read);
-	spin_init(pipe->alert_lock);
-	spin_init(pipe->wait_lock);
-	spin_init(pipe->ptr_lock);
+	spin_init(pipe->lock_write);
 
 	pipe->wait_queue_writers = list_create("pipe writers",pipe);
 	pipe->wait_queue_readers = list_create("pip readers",pipe);
-	pipe->alert_waiters = list_create("pipe alert waiters",pipe);
+	fswait_queue_init(&pipe->alert, "pipe alert waiters", pipe);
 
 	return fnode;
 }
@@ -33,6 +33,15 @@
 #include <kernel/misc.h>
 #include <kernel/module.h>
 #include <kernel/ksym.h>
+#include <kernel/ringbuffer.h>
+#include <kernel/spinlock.h>
+#include <kernel/klog.h>
+#include <kernel/profile.h>
+#include <kernel/boottrace.h>
+#include <kernel/ftrace.h>
+#include <kernel/counters.h>
+
+#include <sys/procfs.h>
 
 #define PROCFS_STANDARD_ENTRIES (sizeof(std_entries) / sizeof(struct procfs_entry))
 #define PROCFS_PROCDIR_ENTRIES  (sizeof(procdir_entries) / sizeof(struct procfs_entry))
@@ -180,6 +189,14 @@ static ssize_t proc_status_func(fs_node_t *node, off_t offset, size_t size, uint
 			proc->usage[0], proc->usage[1], proc->usage[2], proc->usage[3]
 			);
 
+	size_t len = strlen(buf);
+	snprintf(buf + len, 2000 - len,
+			"SchedCount:\t %zu\n"
+			"WaitTime:\t %ld ms\n",
+			(size_t)proc->sched_count,
+			proc->time_waited / arch_cpu_mhz()
+			);
+
 	size_t _bsize = strlen(buf);
 	if ((size_t)offset > _bsize) return 0;
 	if (size > _bsize - offset) size = _bsize - offset;
@@ -188,9 +205,64 @@ static ssize_t proc_status_func(fs_node_t *node, off_t offset, size_t size, uint
 	return size;
 }
 
+/* Fill one binary record; shared by /proc/<pid>/stat and /proc/procs. */
+static void procfs_fill_stat(process_t * proc, struct procfs_stat * st) {
+	process_t * parent = process_get_parent(proc);
+
+	char * name = proc->name + strlen(proc->name) - 1;
+	while (1) {
+		if (*name == '/') {
+			name++;
+			break;
+		}
+		if (name == proc->name) break;
+		name--;
+	}
+
+	long mem_usage = mmu_count_user(proc->thread.page_directory->directory) * 4;
+	long shm_usage = mmu_count_shm(proc->thread.page_directory->directory) * 4;
+
+	memset(st, 0, sizeof(struct procfs_stat));
+	st->version = PROCFS_STAT_VERSION;
+	st->pid  = proc->id;
+	st->tgid = proc->group ? proc->group : proc->id;
+	st->ppid = parent ? parent->id : 0;
+	st->pgid = proc->job;
+	st->sid  = proc->session;
+	st->uid  = proc->user;
+	st->last_core = proc->owner;
+	st->state = (proc->flags & PROC_FLAG_FINISHED) ? 'Z' :
+		((proc->flags & PROC_FLAG_SUSPENDED) ? 'T' :
+			(process_is_ready(proc) ? 'R' : 'S'));
+	snprintf(st->name, 100, "%s", name);
+	st->vm_size = mem_usage;
+	st->rss_shmem = shm_usage;
+	st->mem_permille = 1000 * (mem_usage + shm_usage) / mmu_total_memory();
+	st->total_time = proc->time_total / arch_cpu_mhz();
+	st->user_time = (proc->time_total - proc->time_sys) / arch_cpu_mhz();
+	st->sys_time = proc->time_sys / arch_cpu_mhz();
+	st->wait_time = proc->time_waited / arch_cpu_mhz();
+	st->sched_count = proc->sched_count;
+	for (int i = 0; i < 4; ++i) st->usage[i] = proc->usage[i];
+}
+
+static ssize_t proc_stat_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	struct procfs_stat st;
+	process_t * proc = process_from_pid(node->inode);
+	if (!proc) return 0;
+
+	procfs_fill_stat(proc, &st);
+
+	if ((size_t)offset > sizeof(st)) return 0;
+	if (size > sizeof(st) - offset) size = sizeof(st) - offset;
+	memcpy(buffer, (uint8_t *)&st + offset, size);
+	return size;
+}
+
 static struct procfs_entry procdir_entries[] = {
 	{1, "cmdline", proc_cmdline_func},
 	{2, "status",  proc_status_func},
+	{3, "stat",    proc_stat_func},
 };
 
 static struct dirent * readdir_procfs_procdir(fs_node_t *node, uint64_t index) {
@@ -260,7 +332,30 @@ static fs_node_t * procfs_procdir_create(process_t * process) {
 	return fnode;
 }
 
+/* Files whose text can not change after boot are generated once and
+ * then served from these; everything dynamic still regenerates. */
+static char * cpuinfo_cache = NULL;
+static char * version_cache = NULL;
+static char * compiler_cache = NULL;
+static spin_lock_t text_cache_lock = { 0 };
+
+static ssize_t serve_cached_text(const char * text, off_t offset, size_t size, uint8_t * buffer) {
+	size_t _bsize = strlen(text);
+	if ((size_t)offset > _bsize) return 0;
+	if (size > _bsize - offset) size = _bsize - offset;
+	memcpy(buffer, text + offset, size);
+	return size;
+}
+
 static ssize_t cpuinfo_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	spin_lock(text_cache_lock);
+	if (cpuinfo_cache) {
+		ssize_t out = serve_cached_text(cpuinfo_cache, offset, size, buffer);
+		spin_unlock(text_cache_lock);
+		return out;
+	}
+	spin_unlock(text_cache_lock);
+
 	char buf[4096];
 	size_t _bsize = 0;
 
@@ -285,6 +380,11 @@ static ssize_t cpuinfo_func(fs_node_t *node, off_t offset, size_t size, uint8_t
 				);
 	}
 #endif
+	buf[_bsize] = '\0';
+
+	spin_lock(text_cache_lock);
+	if (!cpuinfo_cache) cpuinfo_cache = strdup(buf);
+	spin_unlock(text_cache_lock);
 
 	if ((size_t)offset > _bsize) return 0;
 	if (size > _bsize - offset) size = _bsize - offset;
@@ -398,6 +498,14 @@ static ssize_t cmdline_func(fs_node_t *node, off_t offset, size_t size, uint8_t
 }
 
 static ssize_t version_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	spin_lock(text_cache_lock);
+	if (version_cache) {
+		ssize_t out = serve_cached_text(version_cache, offset, size, buffer);
+		spin_unlock(text_cache_lock);
+		return out;
+	}
+	spin_unlock(text_cache_lock);
+
 	char buf[1024];
 	char version_number[512];
 	snprintf(version_number, 510,
@@ -414,6 +522,10 @@ static ssize_t version_func(fs_node_t *node, off_t offset, size_t size, uint8_t
 			__kernel_build_time,
 			__kernel_arch);
 
+	spin_lock(text_cache_lock);
+	if (!version_cache) version_cache = strdup(buf);
+	spin_unlock(text_cache_lock);
+
 	size_t _bsize = strlen(buf);
 	if ((size_t)offset > _bsize) return 0;
 	if (size > _bsize - offset) size = _bsize - offset;
@@ -423,9 +535,21 @@ static ssize_t version_func(fs_node_t *node, off_t offset, size_t size, uint8_t
 }
 
 static ssize_t compiler_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	spin_lock(text_cache_lock);
+	if (compiler_cache) {
+		ssize_t out = serve_cached_text(compiler_cache, offset, size, buffer);
+		spin_unlock(text_cache_lock);
+		return out;
+	}
+	spin_unlock(text_cache_lock);
+
 	char buf[1024];
 	snprintf(buf, 1000, "%s\n", __kernel_compiler_version);
 
+	spin_lock(text_cache_lock);
+	if (!compiler_cache) compiler_cache = strdup(buf);
+	spin_unlock(text_cache_lock);
+
 	size_t _bsize = strlen(buf);
 	if ((size_t)offset > _bsize) return 0;
 	if (size > _bsize - offset) size = _bsize - offset;
@@ -675,6 +799,62 @@ static ssize_t idle_func(fs_node_t *node, off_t offset, size_t size, uint8_t *bu
 	return size;
 }
 
+static ssize_t sched_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	char * buf = malloc(4096);
+	unsigned int soffset = 0;
+
+	soffset += snprintf(&buf[soffset], 100, "cpu\tqueued\tswitches\tsteals\n");
+	for (int i = 0; i < processor_count; ++i) {
+		size_t depth = 0;
+		for (int p = 0; p < SCHED_PRIORITY_LEVELS; ++p) {
+			depth += processor_local_data[i].sched_queue[p]->length;
+		}
+		soffset += snprintf(&buf[soffset], 100, "%d\t%zu\t%zu\t%zu\n",
+			i, depth,
+			(size_t)processor_local_data[i].sched_switch_count,
+			(size_t)processor_local_data[i].sched_steal_count);
+	}
+
+	size_t _bsize = strlen(buf);
+	if ((size_t)offset > _bsize) {
+		free(buf);
+		return 0;
+	}
+	if (size > _bsize - offset) size = _bsize - offset;
+
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+
+static ssize_t heap_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	char * buf = malloc(4096);
+	unsigned int soffset = 0;
+
+	soffset += snprintf(&buf[soffset], 100, "cpu\tallocs\tfrees\trefills\tflushes\n");
+	for (int i = 0; i < processor_count; ++i) {
+		uint64_t stats[4];
+		heap_arena_stats(i, stats);
+		soffset += snprintf(&buf[soffset], 100, "%d\t%zu\t%zu\t%zu\t%zu\n",
+			i,
+			(size_t)stats[0],
+			(size_t)stats[1],
+			(size_t)stats[2],
+			(size_t)stats[3]);
+	}
+
+	size_t _bsize = strlen(buf);
+	if ((size_t)offset > _bsize) {
+		free(buf);
+		return 0;
+	}
+	if (size > _bsize - offset) size = _bsize - offset;
+
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+
 static ssize_t kallsyms_func(fs_node_t *node, off_t offset, size_t size, uint8_t * buffer) {
 	/* This doesn't include module symbols at the moment... */
 	list_t * syms = ksym_list();
@@ -708,6 +888,77 @@ free_results:
 	return size;
 }
 
+static ssize_t pipes_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	char * buf = malloc(4096);
+
+	snprintf(buf, 4095,
+		"BytesRead:\t%zu\n"
+		"BytesWritten:\t%zu\n"
+		"Grows:\t%zu\n"
+		"Wakeups:\t%zu\n"
+		"WakeupsDeferred:\t%zu\n",
+		(size_t)ring_buffer_total_read,
+		(size_t)ring_buffer_total_written,
+		(size_t)ring_buffer_total_grows,
+		(size_t)ring_buffer_total_wakeups,
+		(size_t)ring_buffer_total_wakeups_deferred);
+
+	size_t _bsize = strlen(buf);
+	if ((size_t)offset > _bsize) {
+		free(buf);
+		return 0;
+	}
+	if (size > _bsize - offset) size = _bsize - offset;
+
+	memcpy(buffer, buf + offset, size);
+	free(buf);
+	return size;
+}
+
+/**
+ * Streaming view of the retained kernel log. Offsets are absolute
+ * positions in the log since boot, so a reader that remembers where it
+ * left off picks up only new messages; each message carries a "<N>"
+ * severity tag for filtering. See kernel/misc/klog.c.
+ */
+static ssize_t klog_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	return klog_stream_copy(offset, size, buffer);
+}
+
+/**
+ * One-shot binary process table: every live process as a packed
+ * procfs_stat record, so monitors take one read instead of opening and
+ * parsing a status file per process. The table is snapshotted for each
+ * read call; whole-table reads see a consistent snapshot.
+ */
+static ssize_t procs_func(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
+	size_t count = process_list->length;
+	struct procfs_stat * table = malloc(sizeof(struct procfs_stat) * count);
+	size_t filled = 0;
+
+	foreach(lnode, process_list) {
+		if (filled == count) break;
+		procfs_fill_stat((process_t *)lnode->value, &table[filled++]);
+	}
+
+	size_t _bsize = filled * sizeof(struct procfs_stat);
+	if ((size_t)offset > _bsize) {
+		free(table);
+		return 0;
+	}
+	if (size > _bsize - offset) size = _bsize - offset;
+	memcpy(buffer, (uint8_t *)table + offset, size);
+	free(table);
+	return size;
+}
+
+#ifdef LOCK_STATS
+extern ssize_t spin_lock_stats_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer);
+#endif
+#ifdef SYSCALL_STATS
+extern ssize_t syscall_stats_func(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer);
+#endif
+
 static struct procfs_entry std_entries[] = {
 	{-1, "cpuinfo",  cpuinfo_func},
 	{-2, "meminfo",  meminfo_func},
@@ -721,10 +972,25 @@ static struct procfs_entry std_entries[] = {
 	{-10,"loader",   loader_func},
 	{-11,"idle",     idle_func},
 	{-12,"kallsyms", kallsyms_func},
+	{-13,"sched",    sched_func},
+	{-17,"heap",     heap_func},
+	{-18,"pipes",    pipes_func},
+	{-19,"procs",    procs_func},
+	{-20,"klog",     klog_func},
+	{-21,"profile",  profile_read},
+#ifdef LOCK_STATS
+	{-22,"locks",    spin_lock_stats_func},
+#endif
+#ifdef SYSCALL_STATS
+	{-23,"syscalls", syscall_stats_func},
+#endif
+	{-24,"boottrace",boottrace_func},
+	{-25,"ftrace",   ftrace_func},
+	{-26,"counters", counters_func},
 #ifdef __x86_64__
-	{-13,"irq",      irq_func},
-	{-14,"pat",      pat_func},
-	{-15,"pci",      pci_func},
+	{-14,"irq",      irq_func},
+	{-15,"pat",      pat_func},
+	{-16,"pci",      pci_func},
 #endif
 };
 
@@ -882,6 +1148,10 @@ static fs_node_t * finddir_procfs_root(fs_node_t * node, char * name) {
 	for (unsigned int i = 0; i < PROCFS_STANDARD_ENTRIES; ++i) {
 		if (!strcmp(name, std_entries[i].name)) {
 			fs_node_t * out = procfs_generic_create(std_entries[i].name, std_entries[i].func);
+			/* The profiler is controlled through ioctls on its node. */
+			if (std_entries[i].func == profile_read) {
+				out->ioctl = profile_ioctl;
+			}
 			return out;
 		}
 	}
@@ -0,0 +1,106 @@
+/**
+ * @file  kernel/vfs/readahead.c
+ * @brief Asynchronous readahead for sequential file reads.
+ *
+ * read_fs notices when a file is being streamed - consecutive reads
+ * each starting where the last one ended - and submits the next
+ * window of the file here. A worker tasklet then pulls that window
+ * through the filesystem driver, which lands it in the block cache,
+ * so by the time the reader asks for it the data comes out of memory
+ * and the disk wait overlapped with the reader's own work.
+ *
+ * Readahead is purely advisory: submissions are dropped when the
+ * queue is full, and a window that was read ahead needlessly just
+ * ages out of the block cache.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <kernel/types.h>
+#include <kernel/string.h>
+#include <kernel/printf.h>
+#include <kernel/spinlock.h>
+#include <kernel/vfs.h>
+#include <kernel/list.h>
+#include <kernel/process.h>
+
+#define READAHEAD_MAX_QUEUE 32
+
+struct ra_request {
+	fs_node_t * node; /* Private clone, holding a driver reference. */
+	uint64_t offset;
+	size_t size;
+};
+
+static list_t * ra_queue = NULL;
+static list_t * ra_wait = NULL;
+static spin_lock_t ra_lock = { 0 };
+static int ra_worker_started = 0;
+
+static void readahead_task(void * arg) {
+	uint8_t * scratch = malloc(READAHEAD_WINDOW);
+	while (1) {
+		spin_lock(ra_lock);
+		node_t * n = list_dequeue(ra_queue);
+		if (!n) {
+			sleep_on_unlocking(ra_wait, &ra_lock);
+			continue;
+		}
+		spin_unlock(ra_lock);
+
+		struct ra_request * req = n->value;
+		free(n);
+		/* The driver read is the whole point: it pulls the window into
+		 * the block cache. The scratch copy itself is discarded. */
+		read_fs(req->node, req->offset, req->size, scratch);
+		close_fs(req->node);
+		free(req);
+	}
+}
+
+/**
+ * @brief Queue one window of a file for background reading.
+ *
+ * Called by read_fs when it detects sequential streaming. Takes its
+ * own reference on a clone of @p node, so the caller may close the
+ * file before the readahead happens.
+ */
+void readahead_submit(fs_node_t * node, uint64_t offset, size_t size) {
+	if (!size || size > READAHEAD_WINDOW) return;
+
+	spin_lock(ra_lock);
+	if (!ra_queue) {
+		ra_queue = list_create("readahead queue", NULL);
+		ra_wait = list_create("readahead wait", NULL);
+	}
+	if (ra_queue->length >= READAHEAD_MAX_QUEUE) {
+		/* Saturated; this is advisory, so just drop it. */
+		spin_unlock(ra_lock);
+		return;
+	}
+	if (!ra_worker_started) {
+		ra_worker_started = 1;
+		spawn_worker_thread(readahead_task, "[readahead]", NULL);
+	}
+	spin_unlock(ra_lock);
+
+	fs_node_t * clone = malloc(sizeof(fs_node_t));
+	memcpy(clone, node, sizeof(fs_node_t));
+	clone->refcount = 0;
+	/* The clone must never trigger readahead of its own. */
+	clone->seq_streak = 0;
+	clone->ra_done = (uint64_t)-1;
+	open_fs(clone, 0);
+
+	struct ra_request * req = malloc(sizeof(struct ra_request));
+	req->node = clone;
+	req->offset = offset;
+	req->size = size;
+
+	spin_lock(ra_lock);
+	list_insert(ra_queue, req);
+	spin_unlock(ra_lock);
+	wakeup_queue(ra_wait);
+}
@@ -2,6 +2,12 @@
  * @file  kernel/vfs/tarfs.c
  * @brief Read-only filesystem driver for ustar archives.
  *
+ * The whole archive is scanned once at mount time to build an index:
+ * a hash of full paths to header offsets for lookups, and a list of
+ * children per directory for enumeration. Without it, every finddir
+ * and readdir walked the headers linearly from the start of the
+ * archive, which adds up quickly on a ramdisk with thousands of files.
+ *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
@@ -21,6 +27,13 @@
 struct tarfs {
 	fs_node_t * device;
 	unsigned int length;
+	hashmap_t * by_name;  /* full path -> struct tar_entry */
+	hashmap_t * children; /* directory path ("" for the root) -> list of struct tar_entry */
+};
+
+struct tar_entry {
+	unsigned int offset; /* of the ustar header in the archive */
+	char name[256];      /* basename, for readdir */
 };
 
 struct ustar {
@@ -124,15 +137,77 @@ static char * strncat(char *dest, const char *src, size_t n) {
 }
 #endif
 
-static int count_slashes(char * string) {
-	int i = 0;
-	char * s = strstr(string, "/");
-	while (s) {
-		if (*(s+1) == '\0') return i;
-		i++;
-		s = strstr(s+1,"/");
+/* Full path of a header - prefix then filename - with any trailing
+ * slash (directories carry one in the archive) stripped. */
+static void tar_full_name(struct ustar * file, char * out) {
+	memset(out, 0, 256);
+	strncat(out, file->prefix, 155);
+	strncat(out, file->filename, 100);
+	size_t len = strlen(out);
+	if (len && out[len-1] == '/') out[len-1] = '\0';
+}
+
+/**
+ * @brief Scan the archive once and index every header.
+ *
+ * Entries land in @c by_name keyed by full path, and in the child
+ * list of their parent directory for readdir. Built at mount time;
+ * the archive is read-only, so the index never changes after that.
+ */
+static void tar_build_index(struct tarfs * self) {
+	self->by_name  = hashmap_create(0x1000);
+	self->children = hashmap_create(0x100);
+
+	unsigned int offset = 0;
+	struct ustar * file = malloc(sizeof(struct ustar));
+	while (offset < self->length) {
+		if (!ustar_from_offset(self, offset, file)) break;
+
+		char filename_workspace[256];
+		tar_full_name(file, filename_workspace);
+
+		if (strlen(filename_workspace)) {
+			struct tar_entry * entry = malloc(sizeof(struct tar_entry));
+			entry->offset = offset;
+
+			/* Split into parent directory and basename. */
+			char dirname[256];
+			memcpy(dirname, filename_workspace, 256);
+			char * slash = strrchr(dirname, '/');
+			if (slash) {
+				*slash = '\0';
+				strcpy(entry->name, slash + 1);
+			} else {
+				dirname[0] = '\0';
+				strcpy(entry->name, filename_workspace);
+			}
+
+			hashmap_set(self->by_name, filename_workspace, entry);
+
+			list_t * siblings = hashmap_get(self->children, dirname);
+			if (!siblings) {
+				siblings = list_create("tarfs directory children", NULL);
+				hashmap_set(self->children, dirname, siblings);
+			}
+			list_insert(siblings, entry);
+		}
+
+		offset += 512;
+		offset += round_to_512(interpret_size(file));
 	}
-	return i;
+	free(file);
+}
+
+static struct dirent * tar_readdir_index(struct tarfs * self, const char * path, unsigned long index) {
+	list_t * children = hashmap_get(self->children, path);
+	if (!children || index >= children->length) return NULL;
+
+	struct tar_entry * entry = list_index(children, index);
+	struct dirent * out = malloc(sizeof(struct dirent));
+	memset(out, 0x00, sizeof(struct dirent));
+	out->d_ino = entry->offset;
+	strcpy(out->d_name, entry->name);
+	return out;
 }
 
 static struct dirent * readdir_tar_root(fs_node_t *node, unsigned long index) {
@@ -155,48 +230,7 @@ static struct dirent * readdir_tar_root(fs_node_t *node, unsigned long index) {
 	index -= 2;
 
 	struct tarfs * self = node->device;
-	/* Go through each file and pick the ones are at the root */
-	/* Root files will have no /, so this is easy */
-	unsigned int offset = 0;
-	struct ustar * file = malloc(sizeof(struct ustar));
-	while (offset < self->length) {
-		int status = ustar_from_offset(self, offset, file);
-
-		if (!status) {
-			free(file);
-			return NULL;
-		}
-
-		char filename_workspace[256];
-
-		memset(filename_workspace, 0, 256);
-		strncat(filename_workspace, file->prefix, 155);
-		strncat(filename_workspace, file->filename, 100);
-
-		if (!count_slashes(filename_workspace)) {
-			char * slash = strstr(filename_workspace,"/");
-			if (slash) *slash = '\0'; /* remove trailing slash */
-			if (strlen(filename_workspace)) {
-				if (index == 0) {
-					struct dirent * out = malloc(sizeof(struct dirent));
-					memset(out, 0x00, sizeof(struct dirent));
-					out->d_ino = offset;
-					strcpy(out->d_name, filename_workspace);
-					free(file);
-					return out;
-				} else {
-					index--;
-				}
-			}
-		}
-
-		offset += 512;
-		offset += round_to_512(interpret_size(file));
-
-	}
-
-	free(file);
-	return NULL;
+	return tar_readdir_index(self, "", index);
 }
 
 static ssize_t read_tarfs(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
@@ -236,107 +270,48 @@ static struct dirent * readdir_tarfs(fs_node_t *node, unsigned long index) {
 
 	struct tarfs * self = node->device;
 
-	/* Go through each file and pick the ones are at the root */
-	/* Root files will have no /, so this is easy */
-	unsigned int offset = node->inode;
-
-	/* Read myself */
+	/* Read my own header to recover my path; that is the key into the
+	 * child index. */
 	struct ustar * file = malloc(sizeof(struct ustar));
-	int status = ustar_from_offset(self, node->inode, file);
+	if (!ustar_from_offset(self, node->inode, file)) {
+		free(file);
+		return NULL;
+	}
 	char my_filename[256];
+	tar_full_name(file, my_filename);
+	free(file);
 
-	/* Figure out my own filename, with forward slash */
-	memset(my_filename, 0, 256);
-	strncat(my_filename, file->prefix, 155);
-	strncat(my_filename, file->filename, 100);
-
-	while (offset < self->length) {
-		ustar_from_offset(self, offset, file);
-
-		if (!status) {
-			free(file);
-			return NULL;
-		}
-
-		char filename_workspace[256];
-		memset(filename_workspace, 0, 256);
-		strncat(filename_workspace, file->prefix, 155);
-		strncat(filename_workspace, file->filename, 100);
-
-		if (startswith(filename_workspace, my_filename)) {
-			if (!count_slashes(filename_workspace + strlen(my_filename))) {
-				if (strlen(filename_workspace + strlen(my_filename))) {
-					if (index == 0) {
-						char * slash = strstr(filename_workspace+strlen(my_filename),"/");
-						if (slash) *slash = '\0'; /* remove trailing slash */
-						struct dirent * out = malloc(sizeof(struct dirent));
-						memset(out, 0x00, sizeof(struct dirent));
-						out->d_ino = offset;
-						strcpy(out->d_name, filename_workspace+strlen(my_filename));
-						free(file);
-						return out;
-					} else {
-						index--;
-					}
-				}
-			}
-		}
+	return tar_readdir_index(self, my_filename, index);
+}
 
-		offset += 512;
-		offset += round_to_512(interpret_size(file));
+static fs_node_t * file_from_entry(struct tarfs * self, struct tar_entry * entry) {
+	struct ustar * file = malloc(sizeof(struct ustar));
+	if (!ustar_from_offset(self, entry->offset, file)) {
+		free(file);
+		return NULL;
 	}
-
-	free(file);
-	return NULL;
+	return file_from_ustar(self, file, entry->offset);
 }
 
 static fs_node_t * finddir_tarfs(fs_node_t *node, char *name) {
 	struct tarfs * self = node->device;
 
-	/* find my own filename */
+	/* Read my own header to recover my path, then look up path/name. */
 	struct ustar * file = malloc(sizeof(struct ustar));
-	ustar_from_offset(self, node->inode, file);
-
-	char my_filename[256];
-	/* Figure out my own filename, with forward slash */
-	memset(my_filename, 0, 256);
-	strncat(my_filename, file->prefix, 155);
-	strncat(my_filename, file->filename, 100);
-
-	/* Append name */
-	strncat(my_filename, name, strlen(name));
-	if (strlen(my_filename) > 255) {
-		printf("tarfs: critical: what?");
-	}
-
-	unsigned int offset = node->inode;
-	while (offset < self->length) {
-		int status = ustar_from_offset(self, offset, file);
-
-		if (!status) {
-			free(file);
-			return NULL;
-		}
-
-		char filename_workspace[256];
-		memset(filename_workspace, 0, 256);
-		strncat(filename_workspace, file->prefix, 155);
-		strncat(filename_workspace, file->filename, 100);
-
-		if (filename_workspace[strlen(filename_workspace)-1] == '/') {
-			filename_workspace[strlen(filename_workspace)-1] = '\0';
-		}
-		if (!strcmp(filename_workspace, my_filename)) {
-			return file_from_ustar(self, file, offset);
-		}
-
-		offset += 512;
-		offset += round_to_512(interpret_size(file));
+	if (!ustar_from_offset(self, node->inode, file)) {
+		free(file);
+		return NULL;
 	}
+	char my_filename[256];
+	tar_full_name(file, my_filename);
+	free(file);
 
+	char target[256];
+	snprintf(target, 256, "%s/%s", my_filename, name);
 
-	free(file);
-	return NULL;
+	struct tar_entry * entry = hashmap_get(self->by_name, target);
+	if (!entry) return NULL;
+	return file_from_entry(self, entry);
 }
 
 static ssize_t readlink_tarfs(fs_node_t * node, char * buf, size_t size) {
@@ -370,7 +345,9 @@ static fs_node_t * file_from_ustar(struct tarfs * self, struct ustar * file, uns
 	fs->inode  = offset;
 	fs->impl   = 0;
 	char filename_workspace[256];
-	memcpy(fs->name, filename_workspace, strlen(filename_workspace)+1);
+	tar_full_name(file, filename_workspace);
+	char * slash = strrchr(filename_workspace, '/');
+	strcpy(fs->name, slash ? slash + 1 : filename_workspace);
 
 	fs->uid = interpret_uid(file);
 	fs->gid = interpret_gid(file);
@@ -406,37 +383,9 @@ static fs_node_t * file_from_ustar(struct tarfs * self, struct ustar * file, uns
 static fs_node_t * finddir_tar_root(fs_node_t *node, char *name) {
 	struct tarfs * self = node->device;
 
-	unsigned int offset = 0;
-	struct ustar * file = malloc(sizeof(struct ustar));
-	while (offset < self->length) {
-		int status = ustar_from_offset(self, offset, file);
-
-		if (!status) {
-			free(file);
-			return NULL;
-		}
-
-		char filename_workspace[256];
-		memset(filename_workspace, 0, 256);
-		strncat(filename_workspace, file->prefix, 155);
-		strncat(filename_workspace, file->filename, 100);
-
-		if (count_slashes(filename_workspace)) {
-			/* skip */
-		} else {
-			char * slash = strstr(filename_workspace,"/");
-			if (slash) *slash = '\0';
-			if (!strcmp(filename_workspace, name)) {
-				return file_from_ustar(self, file, offset);
-			}
-		}
-
-		offset += 512;
-		offset += round_to_512(interpret_size(file));
-	}
-
-	free(file);
-	return NULL;
+	struct tar_entry * entry = hashmap_get(self->by_name, name);
+	if (!entry) return NULL;
+	return file_from_entry(self, entry);
 }
 
 static int ustar_from_offset(struct tarfs * self, unsigned int offset, struct ustar * out) {
@@ -476,6 +425,8 @@ static fs_node_t * tar_mount(const char * device, const char * mount_path) {
 	self->device = dev;
 	self->length = dev->length;
 
+	tar_build_index(self);
+
 	fs_node_t * root = malloc(sizeof(fs_node_t));
 	memset(root, 0, sizeof(fs_node_t));
 
@@ -131,9 +131,12 @@ static void tmpfs_file_free(struct tmpfs_file * t) {
 	}
 	spin_lock(t->lock);
 	for (size_t i = 0; i < t->block_count; ++i) {
+		if (!t->blocks[i]) continue; /* untouched zero block */
 		mmu_frame_clear((uintptr_t)t->blocks[i] * 0x1000);
 		tmpfs_total_blocks--;
 	}
+	free(t->blocks);
+	free(t->name);
 	spin_unlock(t->lock);
 }
 
@@ -147,17 +150,30 @@ static char * tmpfs_file_getset_block(struct tmpfs_file * t, size_t blockid, int
 		while (blockid >= t->pointers) {
 			tmpfs_file_blocks_embiggen(t);
 		}
+		/* Blocks that have never been written don't get frames; a zero
+		 * entry means "page of zeroes", so sparse files only take memory
+		 * for the blocks actually written to. */
 		while (blockid >= t->block_count) {
+			t->blocks[t->block_count] = 0;
+			t->block_count += 1;
+		}
+		if (!t->blocks[blockid]) {
 			uintptr_t index = mmu_allocate_a_frame();
+			/* A caller that is about to overwrite the whole block (create
+			 * of 2) can skip the zero fill. */
+			if (create != 2) memset(mmu_map_from_physical(index << 12), 0x00, BLOCKSIZE);
 			tmpfs_total_blocks++;
-			t->blocks[t->block_count] = index;
-			t->block_count += 1;
+			t->blocks[blockid] = index;
 		}
 	} else {
 		if (blockid >= t->block_count) {
 			printf("tmpfs: not enough blocks?\n");
 			return NULL;
 		}
+		if (!t->blocks[blockid]) {
+			/* Never written; read from the shared zero page. */
+			return (char *)mmu_map_from_physical(mmu_get_zero_frame() << 12);
+		}
 	}
 
 	return (char *)mmu_map_from_physical(t->blocks[blockid] << 12);
@@ -228,7 +244,7 @@ static ssize_t write_tmpfs(fs_node_t *node, off_t offset, size_t size, uint8_t *
 	uint64_t end_size     = end - end_block * BLOCKSIZE;
 	uint64_t size_to_read = end - offset;
 	if (start_block == end_block) {
-		void *buf = tmpfs_file_getset_block(t, start_block, 1);
+		void *buf = tmpfs_file_getset_block(t, start_block, size_to_read == BLOCKSIZE ? 2 : 1);
 		memcpy((uint8_t *)(((uint64_t)buf) + ((uintptr_t)offset % BLOCKSIZE)), buffer, size_to_read);
 		spin_unlock(t->lock);
 		return size_to_read;
@@ -237,10 +253,11 @@ static ssize_t write_tmpfs(fs_node_t *node, off_t offset, size_t size, uint8_t *
 		uint64_t blocks_read = 0;
 		for (block_offset = start_block; block_offset < end_block; block_offset++, blocks_read++) {
 			if (block_offset == start_block) {
-				void *buf = tmpfs_file_getset_block(t, block_offset, 1);
+				int full = !(offset % BLOCKSIZE);
+				void *buf = tmpfs_file_getset_block(t, block_offset, full ? 2 : 1);
 				memcpy((uint8_t *)(((uint64_t)buf) + ((uintptr_t)offset % BLOCKSIZE)), buffer, BLOCKSIZE - (offset % BLOCKSIZE));
 			} else {
-				void *buf = tmpfs_file_getset_block(t, block_offset, 1);
+				void *buf = tmpfs_file_getset_block(t, block_offset, 2);
 				memcpy(buf, buffer + BLOCKSIZE * blocks_read - (offset % BLOCKSIZE), BLOCKSIZE);
 			}
 		}
@@ -277,11 +294,19 @@ static int truncate_tmpfs(fs_node_t * node) {
 	struct tmpfs_file * t = (struct tmpfs_file *)(node->device);
 	spin_lock(t->lock);
 	for (size_t i = 0; i < t->block_count; ++i) {
+		if (!t->blocks[i]) continue; /* untouched zero block */
 		mmu_frame_clear((uintptr_t)t->blocks[i] * 0x1000);
 		tmpfs_total_blocks--;
 		t->blocks[i] = 0;
 	}
 	t->block_count = 0;
+	/* Return the pointer array to its starting size as well; a scratch
+	 * file that grew large once should not pin the array forever. */
+	t->pointers = 2;
+	t->blocks = realloc(t->blocks, t->pointers * sizeof(char *));
+	for (size_t i = 0; i < t->pointers; ++i) {
+		t->blocks[i] = 0;
+	}
 	t->length = 0;
 	t->mtime = node->atime;
 	spin_unlock(t->lock);
@@ -15,7 +15,7 @@
 #include <kernel/printf.h>
 #include <kernel/ringbuffer.h>
 #include <kernel/pty.h>
-#include <kernel/hashmap.h>
+#include <kernel/flatmap.h>
 #include <kernel/process.h>
 #include <kernel/signal.h>
 #include <kernel/time.h>
@@ -30,7 +30,7 @@ extern void ptr_validate(void * ptr, const char * syscall);
 #define validate(o) ptr_validate(o,"ioctl")
 
 static int _pty_counter = 0;
-static hashmap_t * _pty_index = NULL;
+static flatmap_t * _pty_index = NULL;
 static fs_node_t * _pty_dir = NULL;
 static fs_node_t * _dev_tty = NULL;
 
@@ -328,6 +328,17 @@ int pty_ioctl(pty_t * pty, unsigned long request, void * argp) {
 	}
 }
 
+/* True when the input line discipline has nothing to do per byte: no
+ * canonical editing, no signal keys, no echo, and no iflag translations.
+ * Pasted or streamed input can then move to the slave as one block. */
+static int input_is_raw(pty_t * pty) {
+	if (pty->write_in != pty_write_in) return 0;
+	if (pty->next_is_verbatim) return 0;
+	if (pty->tios.c_lflag & (ICANON | ISIG | ECHO)) return 0;
+	if (pty->tios.c_iflag & (ISTRIP | IGNCR | INLCR | ICRNL)) return 0;
+	return 1;
+}
+
 ssize_t  read_pty_master(fs_node_t * node, off_t offset, size_t size, uint8_t *buffer) {
 	pty_t * pty = (pty_t *)node->device;
 
@@ -337,6 +348,12 @@ ssize_t  read_pty_master(fs_node_t * node, off_t offset, size_t size, uint8_t *b
 ssize_t write_pty_master(fs_node_t * node, off_t offset, size_t size, uint8_t *buffer) {
 	pty_t * pty = (pty_t *)node->device;
 
+	/* Raw input goes to the slave's ring in bulk: one write, and at
+	 * most one reader wakeup, however large the paste or transfer. */
+	if (input_is_raw(pty)) {
+		return ring_buffer_write(pty->in, size, buffer);
+	}
+
 	size_t l = 0;
 	for (uint8_t * c = buffer; l < size; ++c, ++l) {
 		input_process(pty, *c);
@@ -368,6 +385,12 @@ ssize_t read_pty_slave(fs_node_t * node, off_t offset, size_t size, uint8_t *buf
 ssize_t write_pty_slave(fs_node_t * node, off_t offset, size_t size, uint8_t *buffer) {
 	pty_t * pty = (pty_t *)node->device;
 
+	/* With output processing off, bytes go to the master untranslated,
+	 * so skip the per-byte pass and move them as one block. */
+	if (!(pty->tios.c_oflag & OPOST) && pty->write_out == pty_write_out) {
+		return ring_buffer_write(pty->out, size, buffer);
+	}
+
 	size_t l = 0;
 	for (uint8_t * c = buffer; l < size; ++c, ++l) {
 		output_process_slave(pty, *c);
@@ -382,7 +405,7 @@ void     close_pty_slave(fs_node_t * node) {
 	pty_t * pty = (pty_t *)node->device;
 
 	if (pty->name) {
-		hashmap_remove(_pty_index, (void*)pty->name);
+		flatmap_remove(_pty_index, pty->name);
 	}
 
 	return;
@@ -574,7 +597,7 @@ static struct dirent * readdir_pty(fs_node_t *node, unsigned long index) {
 	index -= 2;
 
 	pty_t * out_pty = NULL;
-	list_t * values = hashmap_values(_pty_index);
+	list_t * values = flatmap_values(_pty_index);
 	foreach(node, values) {
 		if (index == 0) {
 			out_pty = node->value;
@@ -608,7 +631,7 @@ static fs_node_t * finddir_pty(fs_node_t * node, char * name) {
 		c = c * 10 + name[i] - '0';
 	}
 
-	pty_t * _pty = hashmap_get(_pty_index, (void*)c);
+	pty_t * _pty = flatmap_get(_pty_index, c);
 
 	if (!_pty) {
 		return NULL;
@@ -640,7 +663,7 @@ static fs_node_t * create_pty_dir(void) {
 }
 
 void pty_install(void) {
-	_pty_index = hashmap_create_int(10);
+	_pty_index = flatmap_create(16);
 	_pty_dir   = create_pty_dir();
 	_dev_tty   = create_dev_tty();
 
@@ -676,7 +699,7 @@ pty_t * pty_new(struct winsize * size, int index) {
 	pty->write_out = pty_write_out;
 
 	if (index) {
-		hashmap_set(_pty_index, (void*)pty->name, pty);
+		flatmap_set(_pty_index, pty->name, pty);
 	}
 
 	if (size) {
@@ -22,6 +22,8 @@
 #include <sys/ioctl.h>
 
 #define UNIX_PIPE_BUFFER 4096
+#define UNIX_PIPE_MAX_DEFAULT 0x100000 /* Writers may grow the buffer to 1MiB before blocking. */
+#define UNIX_PIPE_MAX_LIMIT   0x400000 /* Hard cap for IOCTLPIPESETSZ. */
 
 struct unix_pipe {
 	fs_node_t * read_end;
@@ -75,6 +77,25 @@ static void close_write_pipe(fs_node_t * node) {
 	}
 }
 
+static int ioctl_unixpipe(fs_node_t * node, unsigned long request, void * argp) {
+	struct unix_pipe * self = node->device;
+	switch (request) {
+		case IOCTLPIPEGETSZ:
+			return self->buffer->max_size;
+		case IOCTLPIPESETSZ: {
+			/* The buffer itself still only grows on demand; this just
+			 * raises (or lowers) the ceiling. */
+			if (!argp) return -EINVAL;
+			size_t requested = *(size_t *)argp;
+			if (requested < UNIX_PIPE_BUFFER || requested > UNIX_PIPE_MAX_LIMIT) return -EINVAL;
+			ring_buffer_set_max(self->buffer, requested);
+			return self->buffer->max_size;
+		}
+		default:
+			return -EINVAL;
+	}
+}
+
 static int check_pipe(fs_node_t * node) {
 	struct unix_pipe * self = node->device;
 	if (ring_buffer_unread(self->buffer) > 0) {
@@ -115,6 +136,9 @@ int make_unix_pipe(fs_node_t ** pipes) {
 	pipes[0]->close = close_read_pipe;
 	pipes[1]->close = close_write_pipe;
 
+	pipes[0]->ioctl = ioctl_unixpipe;
+	pipes[1]->ioctl = ioctl_unixpipe;
+
 	/* Read end can wait */
 	pipes[0]->selectcheck = check_pipe;
 	pipes[0]->selectwait = wait_pipe;
@@ -125,6 +149,7 @@ int make_unix_pipe(fs_node_t ** pipes) {
 	internals->read_closed = 0;
 	internals->write_closed = 0;
 	internals->buffer = ring_buffer_create(size);
+	ring_buffer_set_max(internals->buffer, UNIX_PIPE_MAX_DEFAULT);
 
 	pipes[0]->device = internals;
 	pipes[1]->device = internals;
@@ -38,6 +38,11 @@ fs_node_t * fs_root = NULL; /* Pointer to the root mount fs_node (must be some f
 
 hashmap_t * fs_types = NULL;
 
+/* Full mount prefixes ("/dev", "/dev/net", ...) to their vfs_entry, so
+ * mount resolution is a handful of hash probes instead of a walk of the
+ * mount tree with a string compare per child. */
+static hashmap_t * mount_hash = NULL;
+
 #define MIN(l,r) ((l) < (r) ? (l) : (r))
 #define MAX(l,r) ((l) > (r) ? (l) : (r))
 
@@ -176,11 +181,32 @@ int selectwait_fs(fs_node_t * node, void * process) {
  */
 ssize_t read_fs(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
 	if (!node) return -ENOENT;
-	if (node->read) {
-		return node->read(node, offset, size, buffer);
-	} else {
-		return -EINVAL;
+	if (!node->read) return -EINVAL;
+
+	ssize_t result = node->read(node, offset, size, buffer);
+
+	/* Watch regular files for streaming: a few reads in a row that
+	 * each pick up where the last ended, and we ask for the next
+	 * window in the background so it is cached before the reader
+	 * gets there. The counters are heuristic; racing readers on a
+	 * shared descriptor just lose the streak. */
+	if (result > 0 && (node->flags & FS_FILE)) {
+		if ((uint64_t)offset == node->seq_end) {
+			node->seq_streak++;
+		} else {
+			node->seq_streak = 0;
+			node->ra_done = 0;
+		}
+		node->seq_end = offset + result;
+		if (node->seq_streak >= 2 && node->seq_end >= node->ra_done && node->seq_end < node->length) {
+			size_t window = READAHEAD_WINDOW;
+			if (node->seq_end + window > node->length) window = node->length - node->seq_end;
+			readahead_submit(node, node->seq_end, window);
+			node->ra_done = node->seq_end + window;
+		}
 	}
+
+	return result;
 }
 
 /**
@@ -400,6 +426,7 @@ int create_file_fs(char *name, mode_t permission) {
 	int ret = 0;
 	if (parent->create) {
 		ret = parent->create(parent, f_path, permission);
+		dcache_evict(parent, f_path);
 	} else {
 		ret = -EINVAL;
 	}
@@ -450,6 +477,7 @@ int unlink_fs(char * name) {
 	int ret = 0;
 	if (parent->unlink) {
 		ret = parent->unlink(parent, f_path);
+		dcache_evict(parent, f_path);
 	} else {
 		ret = -EINVAL;
 	}
@@ -459,6 +487,43 @@ int unlink_fs(char * name) {
 	return ret;
 }
 
+/**
+ * @brief Drop the cached directory entry for a path, if any.
+ *
+ * For callers that change file metadata (chmod, chown) and only have
+ * a path in hand: resolves the parent directory and evicts the leaf
+ * name so the next lookup re-reads the node from the filesystem.
+ */
+void dcache_evict_path(const char * name) {
+	char *cwd = (char *)(this_core->current_process->wd_name);
+	char *path = canonicalize_path(cwd, name);
+
+	char * parent_path = malloc(strlen(path) + 5);
+	snprintf(parent_path, strlen(path) + 4, "%s/..", path);
+
+	char * f_path = path + strlen(path) - 1;
+	while (f_path > path) {
+		if (*f_path == '/') {
+			f_path += 1;
+			break;
+		}
+		f_path--;
+	}
+
+	while (*f_path == '/') {
+		f_path++;
+	}
+
+	fs_node_t * parent = kopen(parent_path, 0);
+	free(parent_path);
+
+	if (parent) {
+		dcache_evict(parent, f_path);
+		close_fs(parent);
+	}
+	free(path);
+}
+
 int mkdir_fs(char *name, mode_t permission) {
 	fs_node_t * parent;
 	char *cwd = (char *)(this_core->current_process->wd_name);
@@ -515,6 +580,7 @@ int mkdir_fs(char *name, mode_t permission) {
 	int ret = 0;
 	if (parent->mkdir) {
 		ret = parent->mkdir(parent, f_path, permission);
+		dcache_evict(parent, f_path);
 	} else {
 		ret = -EROFS;
 	}
@@ -567,6 +633,7 @@ int symlink_fs(char * target, char * name) {
 	int ret = 0;
 	if (parent->symlink) {
 		ret = parent->symlink(parent, target, f_path);
+		dcache_evict(parent, f_path);
 	} else {
 		ret = -EINVAL;
 	}
@@ -719,6 +786,7 @@ void vfs_install(void) {
 	tree_set_root(fs_tree, root);
 
 	fs_types = hashmap_create(5);
+	mount_hash = hashmap_create(0x10);
 }
 
 int vfs_register(const char * name, vfs_mount_callback callback) {
@@ -851,6 +919,16 @@ void * vfs_mount(const char * path, fs_node_t * local_root) {
 		ret_val = node;
 	}
 
+	/* Index the mount under its full prefix for fast resolution;
+	 * normalize away any trailing separators first. */
+	if (ret_val) {
+		char * key = strdup(path);
+		size_t key_len = strlen(key);
+		while (key_len > 1 && key[key_len-1] == PATH_SEPARATOR) key[--key_len] = '\0';
+		hashmap_set(mount_hash, key, ret_val->value);
+		free(key);
+	}
+
 	free(p);
 	spin_unlock(tmp_vfs_lock);
 	return ret_val;
@@ -901,49 +979,58 @@ void debug_print_vfs_tree(void) {
 /**
  * get_mount_point
  *
+ * Find the deepest mounted filesystem along a tokenized path by
+ * probing the mount hash with successively shorter prefixes.
  */
 fs_node_t *get_mount_point(char * path, unsigned int path_depth, char **outpath, unsigned int * outdepth) {
 	size_t depth;
+	char * end = path;
 
 	for (depth = 0; depth <= path_depth; ++depth) {
-		path += strlen(path) + 1;
+		end += strlen(end) + 1;
 	}
 
 	/* Last available node */
-	fs_node_t   * last = fs_root;
-	tree_node_t * node = fs_tree->root;
+	fs_node_t * last = fs_root;
+	unsigned int _tree_depth = 0;
 
-	char * at = *outpath;
-	int _depth = 1;
-	int _tree_depth = 0;
+	/* Reassemble the tokenized path into a prefix buffer, remembering
+	 * where each component ends and where the next one starts. */
+	size_t   count = 0;
+	char   * prefix = malloc(end - *outpath + 2);
+	size_t * lens   = malloc(sizeof(size_t) * (path_depth + 1));
+	char  ** nexts  = malloc(sizeof(char *) * (path_depth + 1));
+	size_t   plen   = 0;
 
-	while (1) {
-		if (at >= path) {
-			break;
-		}
-		int found = 0;
-		debug_print(INFO, "Searching for %s", at);
-		foreach(child, node->children) {
-			tree_node_t * tchild = (tree_node_t *)child->value;
-			struct vfs_entry * ent = (struct vfs_entry *)tchild->value;
-			if (!strcmp(ent->name, at)) {
-				found = 1;
-				node = tchild;
-				at = at + strlen(at) + 1;
-				if (ent->file) {
-					_tree_depth = _depth;
-					last = ent->file;
-					*outpath = at;
-				}
-				break;
-			}
-		}
-		if (!found) {
+	char * at = *outpath;
+	while (at < end && count <= path_depth) {
+		size_t len = strlen(at);
+		prefix[plen++] = PATH_SEPARATOR;
+		memcpy(prefix + plen, at, len);
+		plen += len;
+		at += len + 1;
+		lens[count]  = plen;
+		nexts[count] = at;
+		count++;
+	}
+	prefix[plen] = '\0';
+
+	/* Longest prefix wins; the root mount is the fallback. */
+	for (size_t k = count; k > 0; k--) {
+		prefix[lens[k-1]] = '\0';
+		struct vfs_entry * ent = hashmap_get(mount_hash, prefix);
+		if (ent && ent->file) {
+			last = ent->file;
+			*outpath = nexts[k-1];
+			_tree_depth = k;
 			break;
 		}
-		_depth++;
 	}
 
+	free(nexts);
+	free(lens);
+	free(prefix);
+
 	*outdepth = _tree_depth;
 
 	if (last) {
@@ -1096,7 +1183,17 @@ fs_node_t *kopen_recur(const char *filename, uint64_t flags, uint64_t symlink_de
 		}
 		/* We are still searching... */
 		debug_print(INFO, "... Searching for %s", path_offset);
-		fs_node_t * node_next = finddir_fs(node_ptr, path_offset);
+		fs_node_t * node_next = NULL;
+		if (depth == path_depth - 1 && (flags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND))) {
+			/* Opens that may modify the file go straight to the driver and
+			 * drop any cached entry, so the cache never serves a node with
+			 * an outdated length afterwards. */
+			dcache_evict(node_ptr, path_offset);
+			node_next = finddir_fs(node_ptr, path_offset);
+		} else if (!dcache_lookup(node_ptr, path_offset, &node_next)) {
+			node_next = finddir_fs(node_ptr, path_offset);
+			dcache_store(node_ptr, path_offset, node_next);
+		}
 		free(node_ptr); /* Always a clone or an unopened thing */
 		node_ptr = node_next;
 		/* Search the active directory for the requested directory */
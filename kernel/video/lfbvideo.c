@@ -40,6 +40,7 @@ static int PREFERRED_H = 900;
 uint16_t lfb_resolution_x = 0;
 uint16_t lfb_resolution_y = 0;
 uint16_t lfb_resolution_b = 0;
+uint16_t lfb_resolution_r = 60;
 uint32_t lfb_resolution_s = 0;
 uint8_t * lfb_vid_memory = (uint8_t *)0xE0000000;
 size_t lfb_memsize = 0xFF0000;
@@ -56,14 +57,76 @@ static pid_t display_change_recipient = 0;
 /* Driver-specific modesetting function */
 void (*lfb_resolution_impl)(uint16_t,uint16_t) = NULL;
 
-/* Called by ioctl on /dev/fb0 */
-void lfb_set_resolution(uint16_t x, uint16_t y) {
-	if (lfb_resolution_impl) {
-		lfb_resolution_impl(x,y);
-		if (display_change_recipient) {
-			send_signal(display_change_recipient, SIGWINEVENT, 1);
+/*
+ * Software cursor plane. The cursor is blended into the framebuffer by
+ * the driver, with the covered pixels saved so it can be moved without
+ * the compositor re-rendering anything. None of our devices have a real
+ * hardware cursor we can program, but the interface doesn't care.
+ */
+static uint32_t cursor_image[VID_CURSOR_MAX * VID_CURSOR_MAX];
+static uint32_t cursor_under[VID_CURSOR_MAX * VID_CURSOR_MAX];
+static int32_t  cursor_x = 0;
+static int32_t  cursor_y = 0;
+static uint32_t cursor_w = 0;
+static uint32_t cursor_h = 0;
+static int cursor_visible = 0;
+
+/* Put back what the cursor was drawn over. */
+static void cursor_restore(void) {
+	if (!cursor_visible) return;
+	for (uint32_t row = 0; row < cursor_h; ++row) {
+		int32_t y = cursor_y + (int32_t)row;
+		if (y < 0 || y >= lfb_resolution_y) continue;
+		for (uint32_t col = 0; col < cursor_w; ++col) {
+			int32_t x = cursor_x + (int32_t)col;
+			if (x < 0 || x >= lfb_resolution_x) continue;
+			*(uint32_t *)(lfb_vid_memory + y * lfb_resolution_s + x * 4) = cursor_under[row * cursor_w + col];
+		}
+	}
+	cursor_visible = 0;
+}
+
+/* Save what's under the cursor, then blend it on top. */
+static void cursor_paint(void) {
+	for (uint32_t row = 0; row < cursor_h; ++row) {
+		int32_t y = cursor_y + (int32_t)row;
+		if (y < 0 || y >= lfb_resolution_y) continue;
+		for (uint32_t col = 0; col < cursor_w; ++col) {
+			int32_t x = cursor_x + (int32_t)col;
+			if (x < 0 || x >= lfb_resolution_x) continue;
+			uint32_t * pixel = (uint32_t *)(lfb_vid_memory + y * lfb_resolution_s + x * 4);
+			uint32_t under = *pixel;
+			cursor_under[row * cursor_w + col] = under;
+			uint32_t over = cursor_image[row * cursor_w + col];
+			uint8_t alpha = over >> 24;
+			if (alpha == 0xFF) { *pixel = over; continue; }
+			if (alpha == 0) continue;
+			/* Cursor data is premultiplied, so this is just 'over' */
+			uint32_t out = 0xFF000000;
+			for (int shift = 0; shift < 24; shift += 8) {
+				uint32_t c = ((over >> shift) & 0xFF) + (((under >> shift) & 0xFF) * (0xFF ^ alpha)) / 0xFF;
+				out |= (c > 0xFF ? 0xFF : c) << shift;
+			}
+			*pixel = out;
 		}
 	}
+	cursor_visible = 1;
+}
+
+/* Called by ioctl on /dev/fb0 */
+int lfb_set_resolution(uint16_t x, uint16_t y) {
+	/* Preset (EFI GOP / multiboot) framebuffers have no modesetting
+	 * interface; tell the caller rather than silently doing nothing. */
+	if (!lfb_resolution_impl) return -EINVAL;
+	/* Whatever was under the cursor is gone with the old mode */
+	cursor_visible = 0;
+	lfb_resolution_impl(x,y);
+	/* The device length tracks the visible framebuffer */
+	if (lfb_device) lfb_device->length = lfb_resolution_s * lfb_resolution_y;
+	if (display_change_recipient) {
+		send_signal(display_change_recipient, SIGWINEVENT, 1);
+	}
+	return 0;
 }
 
 extern void ptr_validate(void * ptr, const char * syscall);
@@ -108,9 +171,19 @@ static int ioctl_vid(fs_node_t * node, unsigned long request, void * argp) {
 					validate((void*)(*(uintptr_t*)argp));
 					lfb_user_offset = *(uintptr_t*)argp;
 				}
-				for (uintptr_t i = 0; i < lfb_memsize; i += 0x1000) {
+				uintptr_t lfb_phys = (uintptr_t)lfb_vid_memory & 0xFFFFFFFF;
+				uintptr_t i = 0;
+				/* Use 2MiB pages for as much of the framebuffer as
+				 * alignment allows - it is the hottest mapping the
+				 * compositor touches - and 4KiB pages for the rest. */
+				if (!(lfb_phys & 0x1FFFFF) && !(lfb_user_offset & 0x1FFFFF)) {
+					for (; i + 0x200000 <= lfb_memsize; i += 0x200000) {
+						mmu_map_large_page(lfb_user_offset + i, lfb_phys + i, MMU_FLAG_WRITABLE|MMU_FLAG_WC);
+					}
+				}
+				for (; i < lfb_memsize; i += 0x1000) {
 					union PML * page = mmu_get_page(lfb_user_offset + i, MMU_GET_MAKE);
-					mmu_frame_map_address(page,MMU_FLAG_WRITABLE|MMU_FLAG_WC,((uintptr_t)(lfb_vid_memory) & 0xFFFFFFFF) + i);
+					mmu_frame_map_address(page,MMU_FLAG_WRITABLE|MMU_FLAG_WC,lfb_phys + i);
 				}
 				*((uintptr_t *)argp) = lfb_user_offset;
 			}
@@ -122,12 +195,50 @@ static int ioctl_vid(fs_node_t * node, unsigned long request, void * argp) {
 		case IO_VID_SET:
 			/* Initiate mode setting */
 			validate(argp);
-			lfb_set_resolution(((struct vid_size *)argp)->width, ((struct vid_size *)argp)->height);
-			return 0;
+			return lfb_set_resolution(((struct vid_size *)argp)->width, ((struct vid_size *)argp)->height);
 		case IO_VID_DRIVER:
 			validate(argp);
 			memcpy(argp, lfb_driver_name, strlen(lfb_driver_name));
 			return 0;
+		case IO_VID_REFRESH:
+			/* Get nominal refresh rate in Hz.
+			 * None of our devices expose real vblank timing, so this
+			 * is a pacing hint (overridable with vid=...,...,...,hz)
+			 * rather than a synchronization source. */
+			validate(argp);
+			*((size_t *)argp) = lfb_resolution_r;
+			return 0;
+		case IO_VID_CURSOR_SET:
+			/* Upload a new cursor image */
+			validate(argp);
+			{
+				struct vid_cursor * cursor = argp;
+				if (lfb_resolution_b != 32) return -EINVAL;
+				if (!cursor->width || !cursor->height) return -EINVAL;
+				if (cursor->width > VID_CURSOR_MAX || cursor->height > VID_CURSOR_MAX) return -EINVAL;
+				int was_visible = cursor_visible;
+				cursor_restore();
+				cursor_w = cursor->width;
+				cursor_h = cursor->height;
+				memcpy(cursor_image, cursor->bitmap, cursor_w * cursor_h * 4);
+				if (was_visible) cursor_paint();
+			}
+			return 0;
+		case IO_VID_CURSOR_POS:
+			/* Move (or hide) the cursor */
+			validate(argp);
+			{
+				struct vid_cursor_pos * pos = argp;
+				if (!cursor_w) return -EINVAL;
+				/* DAMAGED means the caller just redrew the pixels under
+				 * us, so the saved contents are stale - don't put them back. */
+				if (pos->flags & VID_CURSOR_DAMAGED) cursor_visible = 0;
+				cursor_restore();
+				cursor_x = pos->x;
+				cursor_y = pos->y;
+				if (!(pos->flags & VID_CURSOR_HIDE)) cursor_paint();
+			}
+			return 0;
 		case IO_VID_REINIT:
 			if (this_core->current_process->user != 0) {
 				return -EPERM;
@@ -162,13 +273,15 @@ static ssize_t framebuffer_func(fs_node_t * node, off_t offset, size_t size, uin
 			"YRes:\t%d\n"
 			"BitsPerPixel:\t%d\n"
 			"Stride:\t%d\n"
-			"Address:\t%p\n",
+			"Address:\t%p\n"
+			"Refresh:\t%d\n",
 			lfb_driver_name,
 			lfb_resolution_x,
 			lfb_resolution_y,
 			lfb_resolution_b,
 			lfb_resolution_s,
-			lfb_vid_memory);
+			lfb_vid_memory,
+			lfb_resolution_r);
 	} else {
 		snprintf(buf, 20, "Driver:\tnone\n");
 	}
@@ -215,14 +328,15 @@ static void qemu_scan_pci(uint32_t device, uint16_t v, uint16_t d, void * extra)
 		}
 
 		if (t > 0) {
-			output[0] = (uintptr_t)mmu_map_from_physical(t & 0xFFFFFFF0);
-			output[1] = (uintptr_t)mmu_map_from_physical(m & 0xFFFFFFF0);
 			/* Figure out size */
 			pci_write_field(device, PCI_BAR0, 4, 0xFFFFFFFF);
 			uint32_t s = pci_read_field(device, PCI_BAR0, 4);
 			s = ~(s & -15) + 1;
 			output[2] = s;
 			pci_write_field(device, PCI_BAR0, 4, (uint32_t)t);
+			/* The framebuffer gets a write-combining mapping; the MMIO registers must not. */
+			output[0] = (uintptr_t)mmu_map_wc_region(t & 0xFFFFFFF0, s);
+			output[1] = (uintptr_t)mmu_map_from_physical(m & 0xFFFFFFF0);
 		}
 	}
 }
@@ -300,7 +414,11 @@ static void bochs_scan_pci(uint32_t device, uint16_t v, uint16_t d, void * extra
 	if ((v == 0x80EE && d == 0xBEEF) || (v == 0x1234 && d == 0x1111)) {
 		uintptr_t t = pci_read_field(device, PCI_BAR0, 4);
 		if (t > 0) {
-			*((uint8_t **)extra) = mmu_map_from_physical(t & 0xFFFFFFF0);
+			pci_write_field(device, PCI_BAR0, 4, 0xFFFFFFFF);
+			uint32_t s = pci_read_field(device, PCI_BAR0, 4);
+			s = ~(s & -15) + 1;
+			pci_write_field(device, PCI_BAR0, 4, (uint32_t)t);
+			*((uint8_t **)extra) = mmu_map_wc_region(t & 0xFFFFFFF0, s);
 		}
 	}
 }
@@ -434,7 +552,7 @@ static void graphics_install_vmware(uint16_t w, uint16_t h) {
 
 	printf("vmware fb size: 0x%lx\n", lfb_memsize);
 
-	lfb_vid_memory = mmu_map_from_physical(fb_addr);
+	lfb_vid_memory = mmu_map_wc_region(fb_addr, lfb_memsize);
 
 	finalize_graphics("vmware");
 }
@@ -531,6 +649,12 @@ static int lfb_init(const char * c) {
 	if (argc >= 3) {
 		x = atoi(argv[1]);
 		y = atoi(argv[2]);
+		if (argc >= 4) {
+			int r = atoi(argv[3]);
+			if (r >= 24 && r <= 240) {
+				lfb_resolution_r = r;
+			}
+		}
 	} else if (!lfb_resolution_x) {
 		x = PREFERRED_W;
 		y = PREFERRED_H;
@@ -13,6 +13,7 @@
  * Copyright (C) 2018 K. Lange
  */
 #include <stdio.h>
+#include <sys/stat.h>
 #include <toaru/hashmap.h>
 #include <toaru/confreader.h>
 
@@ -67,7 +68,7 @@ confreader_t * confreader_create_empty(void) {
 	return out;
 }
 
-confreader_t * confreader_load(const char * file) {
+static confreader_t * confreader_parse(const char * file) {
 
 	FILE * f = fopen(file, "r");
 
@@ -151,6 +152,70 @@ confreader_t * confreader_load(const char * file) {
 	return out;
 }
 
+/*
+ * Parsed-config cache: the master copy of each file this process has
+ * loaded stays resident, keyed by path and validated against the
+ * file's mtime. A repeat load is a hash lookup and a copy instead of
+ * a reopen and reparse, and a changed file is picked up on the next
+ * load without any extra machinery. Callers get their own copy, so
+ * the existing ownership rules - modify it, free it - still hold.
+ */
+
+struct cached_config {
+	confreader_t * config;
+	time_t mtime;
+};
+
+static hashmap_t * config_cache = NULL;
+
+static confreader_t * confreader_copy(confreader_t * in) {
+	confreader_t * out = confreader_create_empty();
+	list_t * sections = hashmap_keys(in->sections);
+	foreach(node, sections) {
+		char * name = (char*)node->value;
+		hashmap_t * src = hashmap_get(in->sections, name);
+		hashmap_t * dst = hashmap_create(10);
+		list_t * keys = hashmap_keys(src);
+		foreach(knode, keys) {
+			char * key = (char*)knode->value;
+			hashmap_set(dst, key, strdup(hashmap_get(src, key)));
+		}
+		list_free(keys);
+		free(keys);
+		hashmap_set(out->sections, name, dst);
+	}
+	list_free(sections);
+	free(sections);
+	return out;
+}
+
+confreader_t * confreader_load(const char * file) {
+	struct stat statbuf;
+	if (stat(file, &statbuf) < 0) return NULL;
+
+	if (!config_cache) config_cache = hashmap_create(10);
+
+	struct cached_config * cached = hashmap_get(config_cache, (char*)file);
+	if (cached && cached->mtime == statbuf.st_mtime) {
+		TRACE("cache hit for %s", file);
+		return confreader_copy(cached->config);
+	}
+
+	confreader_t * fresh = confreader_parse(file);
+	if (!fresh) return NULL;
+
+	if (!cached) {
+		cached = malloc(sizeof(struct cached_config));
+		hashmap_set(config_cache, (char*)file, cached);
+	} else {
+		confreader_free(cached->config);
+	}
+	cached->config = fresh;
+	cached->mtime = statbuf.st_mtime;
+
+	return confreader_copy(fresh);
+}
+
 void confreader_free(confreader_t * conf) {
 	free_hashmap(conf->sections);
 	free(conf);
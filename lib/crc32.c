@@ -0,0 +1,190 @@
+/**
+ * @brief CRC32 with slice-by-8 tables and a PCLMULQDQ fast path.
+ *
+ * The portable core is slice-by-8: eight independent table lookups
+ * per eight-byte step, so the chain of dependent shifts in the
+ * classic byte loop disappears. On processors with carryless
+ * multiply, buffers of 64 bytes and up instead go through the
+ * folding reduction from Intel's CRC whitepaper (the same constants
+ * zlib's vectorized fold uses), picked once at first use via CPUID.
+ * Both paths produce the standard reflected zlib/gzip checksum.
+ *
+ * The kernel carries its own copy of the table core in
+ * kernel/misc/crc32.c; it builds without SSE, so the vector path
+ * lives only here.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#include <toaru/crc32.h>
+
+static uint32_t crc_table[8][256];
+static int crc_ready = 0;
+
+static void crc_init(void) {
+	for (int i = 0; i < 256; ++i) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		crc_table[0][i] = c;
+	}
+	for (int i = 0; i < 256; ++i) {
+		for (int t = 1; t < 8; ++t) {
+			crc_table[t][i] = crc_table[0][crc_table[t-1][i] & 0xFF] ^ (crc_table[t-1][i] >> 8);
+		}
+	}
+	crc_ready = 1;
+}
+
+/* Running state here is pre-inverted, as every implementation keeps it. */
+static uint32_t crc_slice8(uint32_t crc, const uint8_t * data, size_t len) {
+	while (len >= 8) {
+		uint32_t one = (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24)) ^ crc;
+		uint32_t two = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+		crc = crc_table[7][one & 0xFF] ^ crc_table[6][(one >> 8) & 0xFF] ^
+		      crc_table[5][(one >> 16) & 0xFF] ^ crc_table[4][one >> 24] ^
+		      crc_table[3][two & 0xFF] ^ crc_table[2][(two >> 8) & 0xFF] ^
+		      crc_table[1][(two >> 16) & 0xFF] ^ crc_table[0][two >> 24];
+		data += 8;
+		len -= 8;
+	}
+	while (len--) {
+		crc = crc_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifndef NO_SSE
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+
+/* Folding constants for the reflected polynomial, from the Intel
+ * "Fast CRC Computation Using PCLMULQDQ" paper. */
+static const uint64_t __attribute__((aligned(16))) k1k2[2] = { 0x0154442bd4, 0x01c6e41596 };
+static const uint64_t __attribute__((aligned(16))) k3k4[2] = { 0x01751997d0, 0x00ccaa009e };
+static const uint64_t __attribute__((aligned(16))) k5k0[2] = { 0x0163cd6124, 0x0000000000 };
+static const uint64_t __attribute__((aligned(16))) poly[2] = { 0x01db710641, 0x01f7011641 };
+
+/* Requires len >= 64 and a multiple of 16. */
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t crc_clmul(uint32_t crc, const uint8_t * buf, size_t len) {
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+	x0 = _mm_load_si128((const __m128i *)k1k2);
+
+	buf += 64;
+	len -= 64;
+
+	/* Fold four 128-bit lanes in parallel across each block of 64. */
+	while (len >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+		y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+		y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+		y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+		buf += 64;
+		len -= 64;
+	}
+
+	/* Merge the four lanes into one. */
+	x0 = _mm_load_si128((const __m128i *)k3k4);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	/* Remaining 16-byte blocks. */
+	while (len >= 16) {
+		x2 = _mm_loadu_si128((const __m128i *)buf);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		buf += 16;
+		len -= 16;
+	}
+
+	/* 128 -> 64 bits. */
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduction to 32 bits. */
+	x0 = _mm_load_si128((const __m128i *)poly);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return _mm_extract_epi32(x1, 1);
+}
+
+static int have_clmul = -1;
+#endif
+
+uint32_t crc32_calculate(uint32_t crc, const void * data, size_t len) {
+	const uint8_t * p = data;
+	crc = ~crc;
+
+#ifndef NO_SSE
+	if (have_clmul < 0) {
+		have_clmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+	}
+	if (have_clmul && len >= 64) {
+		size_t chunk = len & ~(size_t)15;
+		crc = crc_clmul(crc, p, chunk);
+		p += chunk;
+		len -= chunk;
+	}
+#endif
+
+	if (len) {
+		if (!crc_ready) crc_init();
+		crc = crc_slice8(crc, p, len);
+	}
+	return ~crc;
+}
@@ -16,6 +16,7 @@
 #include <toaru/graphics.h>
 #include <toaru/decorations.h>
 #include <toaru/text.h>
+#include <toaru/hashmap.h>
 
 #define TTK_FANCY_PATH "/usr/share/ttk/fancy/"
 
@@ -119,6 +120,115 @@ static int get_bounds_fancy(yutani_window_t * window, struct decor_bounds * boun
 	return 0;
 }
 
+/*
+ * Pre-rendered frame strips, one set per window. Assembling the
+ * nine-patch pieces costs a draw_sprite call per column (and per row
+ * for the sides), which is what made dragging repaint so expensive on
+ * large windows; the composed strips only change when the window is
+ * resized or switches between active and inactive, so everything but
+ * the title text and buttons can be reblitted from here.
+ */
+struct frame_cache {
+	uint32_t width;
+	uint32_t height;
+	int active;
+	int flags;          /* Tiling bits, which change the frame shape */
+	sprite_t * top;
+	sprite_t * bottom;
+	sprite_t * left;
+	sprite_t * right;
+};
+
+static hashmap_t * frame_caches = NULL;
+
+static sprite_t * strip_sprite(int w, int h) {
+	sprite_t * strip = create_sprite(w, h, ALPHA_EMBEDDED);
+	gfx_context_t * sctx = init_graphics_sprite(strip);
+	draw_fill(sctx, rgba(0,0,0,0));
+	free(sctx);
+	return strip;
+}
+
+static void build_frame_cache(struct frame_cache * cache, yutani_window_t * window, int decors_active) {
+	if (cache->top)    sprite_free(cache->top);
+	if (cache->bottom) sprite_free(cache->bottom);
+	if (cache->left)   sprite_free(cache->left);
+	if (cache->right)  sprite_free(cache->right);
+	cache->top = cache->bottom = cache->left = cache->right = NULL;
+
+	int width = window->width;
+	int height = window->height;
+
+	cache->width  = window->width;
+	cache->height = window->height;
+	cache->active = decors_active;
+	cache->flags  = window->decorator_flags & DECOR_FLAG_TILED;
+
+	if (cache->flags) {
+		/* Tiled windows only have the flat titlebar strip */
+		int top_height = 27 * TOTAL_SCALE + !(window->decorator_flags & DECOR_FLAG_TILE_UP);
+		cache->top = strip_sprite(width, top_height);
+		gfx_context_t * t = init_graphics_sprite(cache->top);
+		for (int i = 0; i < width; ++i) {
+			draw_sprite(t, sprites[decors_active + 1], i, -6 * TOTAL_SCALE + !(window->decorator_flags & DECOR_FLAG_TILE_UP));
+		}
+		free(t);
+		return;
+	}
+
+	cache->top = strip_sprite(width, u_height);
+	gfx_context_t * t = init_graphics_sprite(cache->top);
+	draw_sprite(t, sprites[decors_active + 0], 0, 0);
+	for (int i = 0; i < width - (ul_width + ur_width); ++i) {
+		draw_sprite(t, sprites[decors_active + 1], i + ul_width, 0);
+	}
+	draw_sprite(t, sprites[decors_active + 2], width - ur_width, 0);
+	free(t);
+
+	int m_height = height - (u_height + l_height);
+	if (m_height > 0) {
+		cache->left = strip_sprite(ml_width, m_height);
+		cache->right = strip_sprite(mr_width, m_height);
+		gfx_context_t * l = init_graphics_sprite(cache->left);
+		gfx_context_t * r = init_graphics_sprite(cache->right);
+		for (int i = 0; i < m_height; ++i) {
+			draw_sprite(l, sprites[decors_active + 3], 0, i);
+			draw_sprite(r, sprites[decors_active + 4], 0, i);
+		}
+		free(l);
+		free(r);
+	}
+
+	cache->bottom = strip_sprite(width, l_height);
+	gfx_context_t * b = init_graphics_sprite(cache->bottom);
+	draw_sprite(b, sprites[decors_active + 5], 0, 0);
+	for (int i = 0; i < width - (ll_width + lr_width); ++i) {
+		draw_sprite(b, sprites[decors_active + 6], i + ll_width, 0);
+	}
+	draw_sprite(b, sprites[decors_active + 7], width - lr_width, 0);
+	free(b);
+}
+
+static struct frame_cache * get_frame_cache(yutani_window_t * window, int decors_active) {
+	if (!frame_caches) {
+		frame_caches = hashmap_create_int(10);
+	}
+
+	struct frame_cache * cache = hashmap_get(frame_caches, (void*)(uintptr_t)window->wid);
+	if (!cache) {
+		cache = calloc(1, sizeof(struct frame_cache));
+		hashmap_set(frame_caches, (void*)(uintptr_t)window->wid, cache);
+	}
+
+	if (cache->width != window->width || cache->height != window->height ||
+		cache->active != decors_active ||
+		cache->flags != (int)(window->decorator_flags & DECOR_FLAG_TILED)) {
+		build_frame_cache(cache, window, decors_active);
+	}
+
+	return cache;
+}
+
 static char * ellipsify(char * input, int font_size, struct TT_Font * font, int max_width, int * out_width) {
 	int len = strlen(input);
 	char * out = malloc(len + 4);
@@ -153,10 +263,10 @@ static void render_decorations_fancy(yutani_window_t * window, gfx_context_t * c
 
 	decors_active = (decors_active == DECOR_INACTIVE) ? INACTIVE : ACTIVE;
 
+	struct frame_cache * frame = get_frame_cache(window, decors_active);
+
 	if ((window->decorator_flags & DECOR_FLAG_TILED)) {
-		for (int i = 0; i < width; ++i) {
-			draw_sprite(ctx, sprites[decors_active + 1], i, -6 * TOTAL_SCALE + !(window->decorator_flags & DECOR_FLAG_TILE_UP));
-		}
+		draw_sprite(ctx, frame->top, 0, 0);
 
 		uint32_t clear_color = BORDER_COLOR;
 		if (!(window->decorator_flags & DECOR_FLAG_TILE_DOWN)) {
@@ -199,20 +309,10 @@ static void render_decorations_fancy(yutani_window_t * window, gfx_context_t * c
 			}
 		}
 
-		draw_sprite(ctx, sprites[decors_active + 0], 0, 0);
-		for (int i = 0; i < width - (ul_width + ur_width); ++i) {
-			draw_sprite(ctx, sprites[decors_active + 1], i + ul_width, 0);
-		}
-		draw_sprite(ctx, sprites[decors_active + 2], width - ur_width, 0);
-		for (int i = 0; i < height - (u_height + l_height); ++i) {
-			draw_sprite(ctx, sprites[decors_active + 3], 0, i + u_height);
-			draw_sprite(ctx, sprites[decors_active + 4], width - mr_width, i + u_height);
-		}
-		draw_sprite(ctx, sprites[decors_active + 5], 0, height - l_height);
-		for (int i = 0; i < width - (ll_width + lr_width); ++i) {
-			draw_sprite(ctx, sprites[decors_active + 6], i + ll_width, height - l_height);
-		}
-		draw_sprite(ctx, sprites[decors_active + 7], width - lr_width, height - l_height);
+		draw_sprite(ctx, frame->top, 0, 0);
+		if (frame->left)  draw_sprite(ctx, frame->left, 0, u_height);
+		if (frame->right) draw_sprite(ctx, frame->right, width - mr_width, u_height);
+		draw_sprite(ctx, frame->bottom, 0, height - l_height);
 	}
 
 #define EXTRA_SPACE 120
@@ -14,10 +14,14 @@
 #include <dlfcn.h>
 
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifndef NO_SSE
 #include <xmmintrin.h>
 #include <emmintrin.h>
+#include <tmmintrin.h>
 #endif
 
 #include <kernel/video.h>
@@ -76,17 +80,90 @@ void gfx_no_clip(gfx_context_t * ctx) {
 	free(tmp);
 }
 
+/**
+ * Damage tracking. Drawing primitives union their bounds into a dirty
+ * rectangle on the context, so a client can ask what changed since the
+ * last flip - eg. to send a minimal update region to the compositor.
+ * flip() itself only consults the rectangle once gfx_track_damage has
+ * been called, since code that pokes pixels directly through GFX()
+ * leaves no damage record and would otherwise never reach the screen.
+ */
+void gfx_damage(gfx_context_t * ctx, int32_t x, int32_t y, int32_t w, int32_t h) {
+	int32_t x1 = min(x + w, ctx->width);
+	int32_t y1 = min(y + h, ctx->height);
+	if (x < 0) x = 0;
+	if (y < 0) y = 0;
+	if (x >= x1 || y >= y1) return;
+	ctx->damage_x0 = min(ctx->damage_x0, x);
+	ctx->damage_y0 = min(ctx->damage_y0, y);
+	ctx->damage_x1 = max(ctx->damage_x1, x1);
+	ctx->damage_y1 = max(ctx->damage_y1, y1);
+}
+
+int gfx_fetch_damage(gfx_context_t * ctx, int32_t * x, int32_t * y, int32_t * w, int32_t * h) {
+	if (ctx->damage_x1 <= ctx->damage_x0 || ctx->damage_y1 <= ctx->damage_y0) return 0;
+	*x = ctx->damage_x0;
+	*y = ctx->damage_y0;
+	*w = ctx->damage_x1 - ctx->damage_x0;
+	*h = ctx->damage_y1 - ctx->damage_y0;
+	return 1;
+}
+
+void gfx_reset_damage(gfx_context_t * ctx) {
+	ctx->damage_x0 = ctx->width;
+	ctx->damage_y0 = ctx->height;
+	ctx->damage_x1 = 0;
+	ctx->damage_y1 = 0;
+}
+
+void gfx_track_damage(gfx_context_t * ctx, int enable) {
+	ctx->track_damage = enable;
+}
+
+/**
+ * memcpy into the framebuffer with non-temporal stores. The front
+ * buffer is mapped write-combining and is never read back, so there is
+ * no point pulling its lines into the cache on the way out; streaming
+ * stores leave the cache to the surfaces we will actually read again.
+ * Falls back to memcpy when either pointer is misaligned or the row
+ * isn't a multiple of 16 bytes.
+ */
+static void * memcpy_nt(void * restrict dest, const void * restrict src, size_t n) {
+#ifndef NO_SSE
+	if (!(((uintptr_t)dest | (uintptr_t)src | n) & 15)) {
+		__m128i * d = dest;
+		const __m128i * s = src;
+		for (size_t i = 0; i < n / 16; ++i) {
+			_mm_stream_si128(&d[i], _mm_load_si128(&s[i]));
+		}
+		_mm_sfence();
+		return dest;
+	}
+#endif
+	return memcpy(dest, src, n);
+}
+
 /* Pointer to graphics memory */
 void flip(gfx_context_t * ctx) {
-	if (ctx->clips) {
+	if (ctx->track_damage) {
+		int32_t dx, dy, dw, dh;
+		if (gfx_fetch_damage(ctx, &dx, &dy, &dw, &dh)) {
+			for (int32_t i = dy; i < dy + dh; ++i) {
+				if (_is_in_clip(ctx,i)) {
+					memcpy_nt(&ctx->buffer[i*GFX_S(ctx) + dx*4], &ctx->backbuffer[i*GFX_S(ctx) + dx*4], 4 * dw);
+				}
+			}
+		}
+	} else if (ctx->clips) {
 		for (size_t i = 0; i < ctx->height; ++i) {
 			if (_is_in_clip(ctx,i)) {
-				memcpy(&ctx->buffer[i*GFX_S(ctx)], &ctx->backbuffer[i*GFX_S(ctx)], 4 * ctx->width);
+				memcpy_nt(&ctx->buffer[i*GFX_S(ctx)], &ctx->backbuffer[i*GFX_S(ctx)], 4 * ctx->width);
 			}
 		}
 	} else {
-		memcpy(ctx->buffer, ctx->backbuffer, ctx->size);
+		memcpy_nt(ctx->buffer, ctx->backbuffer, ctx->size);
 	}
+	gfx_reset_damage(ctx);
 }
 
 void gfx_flip_24bit(gfx_context_t * ctx) {
@@ -102,6 +179,7 @@ void gfx_flip_24bit(gfx_context_t * ctx) {
 }
 
 void clearbuffer(gfx_context_t * ctx) {
+	gfx_damage(ctx, 0, 0, ctx->width, ctx->height);
 	memset(ctx->backbuffer, 0, ctx->size);
 }
 
@@ -138,6 +216,8 @@ gfx_context_t * init_graphics_fullscreen() {
 	}
 
 	out->backbuffer = out->buffer;
+	out->track_damage = 0;
+	gfx_reset_damage(out);
 	return out;
 }
 
@@ -147,6 +227,17 @@ uint32_t framebuffer_stride(void) {
 	return stride;
 }
 
+/**
+ * Nominal display refresh rate in Hz, for clients that want to pace
+ * frames. Falls back to 60 when the driver doesn't provide one.
+ */
+int framebuffer_refresh_rate(void) {
+	size_t rate = 0;
+	if (!framebuffer_fd) return 60;
+	if (ioctl(framebuffer_fd, IO_VID_REFRESH, &rate) < 0 || !rate) return 60;
+	return rate;
+}
+
 gfx_context_t * init_graphics_fullscreen_double_buffer() {
 	gfx_context_t * out = init_graphics_fullscreen();
 	if (!out) return NULL;
@@ -175,6 +266,8 @@ gfx_context_t * init_graphics_subregion(gfx_context_t * base, int x, int y, int
 	}
 
 	out->size = 0; /* don't allow flip or clear operations */
+	out->track_damage = 0;
+	gfx_reset_damage(out);
 	return out;
 }
 
@@ -201,6 +294,7 @@ void reinit_graphics_fullscreen(gfx_context_t * out) {
 		out->backbuffer = out->buffer;
 	}
 
+	gfx_reset_damage(out);
 }
 
 gfx_context_t * init_graphics_sprite(sprite_t * sprite) {
@@ -214,6 +308,8 @@ gfx_context_t * init_graphics_sprite(sprite_t * sprite) {
 	out->size   = GFX_H(out) * GFX_W(out) * GFX_B(out);
 	out->buffer = (char *)sprite->bitmap;
 	out->backbuffer = out->buffer;
+	out->track_damage = 0;
+	gfx_reset_damage(out);
 
 	return out;
 }
@@ -295,6 +391,7 @@ static inline int clamp(int a, int l, int h) {
 	return a < l ? l : (a > h ? h : a);
 }
 
+#ifdef NO_SSE
 static void _box_blur_horizontal(gfx_context_t * _src, int radius) {
 	int w = _src->width;
 	int h = _src->height;
@@ -400,7 +497,143 @@ static void _box_blur_vertical(gfx_context_t * _src, int radius) {
 	free(out_color);
 }
 
+#else /* !NO_SSE */
+
+/* The box blur is a sliding-window average: as the window moves one
+ * pixel, the pixel that left is subtracted from a running sum and the
+ * one that entered is added, so the cost per pixel is constant no
+ * matter the radius. The four channel sums for a window live in the
+ * 32-bit lanes of one vector register. */
+
+static inline __m128i gfx_expand_pixel(uint32_t px) {
+	__m128i v = _mm_cvtsi32_si128(px);
+	v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+	return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+}
+
+static inline uint32_t gfx_pack_pixel(__m128i v) {
+	v = _mm_packs_epi32(v, v);
+	v = _mm_packus_epi16(v, v);
+	return _mm_cvtsi128_si32(v);
+}
+
+/* Divide the four lane sums by the window size, as floats against a
+ * precomputed reciprocal. The reciprocal is nudged up by a hair so
+ * that sums which divide exactly don't truncate one below the integer
+ * quotient; the nudge is far smaller than the gap to the next integer,
+ * so every lane comes out equal to the plain integer division. */
+static inline __m128 gfx_blur_recip(int hits) {
+	return _mm_set1_ps((1.0f / hits) * (1.0f + 1e-6f));
+}
+
+static inline uint32_t gfx_blur_divide(__m128i sum, __m128 recip) {
+	return gfx_pack_pixel(_mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sum), recip)));
+}
+
+static void _box_blur_horizontal(gfx_context_t * _src, int radius) {
+	int w = _src->width;
+	int h = _src->height;
+	int half_radius = radius / 2;
+	uint32_t * out_color = malloc(sizeof(uint32_t) * w);
+
+	for (int y = 0; y < h; y++) {
+		__m128i sum = _mm_setzero_si128();
+		__m128 recip = _mm_set1_ps(0.0f);
+		int hits = 0;
+		int last_hits = 0;
+		for (int x = -half_radius; x < w; x++) {
+			int old_p = x - half_radius - 1;
+			if (old_p >= 0) {
+				sum = _mm_sub_epi32(sum, gfx_expand_pixel(GFX(_src, old_p, y)));
+				hits--;
+			}
+			int new_p = x + half_radius;
+			if (new_p < w) {
+				sum = _mm_add_epi32(sum, gfx_expand_pixel(GFX(_src, new_p, y)));
+				hits++;
+			}
+			if (x >= 0) {
+				/* The window only changes size near the edges. */
+				if (hits != last_hits) {
+					recip = gfx_blur_recip(hits);
+					last_hits = hits;
+				}
+				out_color[x] = gfx_blur_divide(sum, recip);
+			}
+		}
+
+		if (!_is_in_clip(_src, y)) continue;
+		memcpy(&GFX(_src, 0, y), out_color, w * sizeof(uint32_t));
+	}
+
+	free(out_color);
+}
+
+/* The vertical pass slides one window per column, all advanced in step
+ * down the rows, so the image is walked row-major here too and the
+ * working set per step is two pixel rows plus the accumulators - small
+ * enough to sit in L2 at any sane framebuffer width. Output rows are
+ * written in place; a short ring holds each original row until it has
+ * left every window. */
+static void _box_blur_vertical(gfx_context_t * _src, int radius) {
+	int w = _src->width;
+	int h = _src->height;
+	int half_radius = radius / 2;
+	int ring_rows = half_radius + 2;
+
+	uint32_t * acc = calloc(sizeof(uint32_t) * 4, w);
+	uint32_t * ring = malloc(sizeof(uint32_t) * w * ring_rows);
+	uint32_t * out_color = malloc(sizeof(uint32_t) * w);
+
+	__m128 recip = _mm_set1_ps(0.0f);
+	int hits = 0;
+	int last_hits = 0;
+
+	for (int y = -half_radius; y < h; y++) {
+		int old_p = y - half_radius - 1;
+		if (old_p >= 0) {
+			uint32_t * old_row = &ring[(old_p % ring_rows) * w];
+			for (int x = 0; x < w; x++) {
+				__m128i s = _mm_loadu_si128((void*)&acc[x*4]);
+				_mm_storeu_si128((void*)&acc[x*4], _mm_sub_epi32(s, gfx_expand_pixel(old_row[x])));
+			}
+			hits--;
+		}
+		int new_p = y + half_radius;
+		if (new_p < h) {
+			uint32_t * new_row = &GFX(_src, 0, new_p);
+			for (int x = 0; x < w; x++) {
+				__m128i s = _mm_loadu_si128((void*)&acc[x*4]);
+				_mm_storeu_si128((void*)&acc[x*4], _mm_add_epi32(s, gfx_expand_pixel(new_row[x])));
+			}
+			hits++;
+		}
+		if (y < 0) continue;
+
+		/* This row's original pixels are still inside the windows of the
+		 * next half_radius rows; keep them until they fall out. */
+		memcpy(&ring[(y % ring_rows) * w], &GFX(_src, 0, y), w * sizeof(uint32_t));
+
+		if (hits != last_hits) {
+			recip = gfx_blur_recip(hits);
+			last_hits = hits;
+		}
+		for (int x = 0; x < w; x++) {
+			out_color[x] = gfx_blur_divide(_mm_loadu_si128((void*)&acc[x*4]), recip);
+		}
+
+		if (!_is_in_clip(_src, y)) continue;
+		memcpy(&GFX(_src, 0, y), out_color, w * sizeof(uint32_t));
+	}
+
+	free(out_color);
+	free(ring);
+	free(acc);
+}
+#endif
+
 void blur_context_box(gfx_context_t * _src, int radius) {
+	gfx_damage(_src, 0, 0, _src->width, _src->height);
 	_box_blur_horizontal(_src,radius);
 	_box_blur_vertical(_src,radius);
 }
@@ -438,20 +671,22 @@ int load_sprite(sprite_t * sprite, const char * filename) {
 }
 
 int load_sprite_bmp(sprite_t * sprite, const char * filename) {
-	/* Open the requested binary */
-	FILE * image = fopen(filename, "r");
-
-	if (!image) return 1;
+	/* Map the requested binary; the pages stay in the kernel page cache,
+	 * so reloading the same image (wallpapers...) doesn't reread it. */
+	int fd = open(filename, O_RDONLY);
 
-	size_t image_size= 0;
+	if (fd < 0) return 1;
 
-	fseek(image, 0, SEEK_END);
-	image_size = ftell(image);
-	fseek(image, 0, SEEK_SET);
+	struct stat st;
+	if (fstat(fd, &st) < 0 || !st.st_size) {
+		close(fd);
+		return 1;
+	}
+	size_t image_size = st.st_size;
 
-	/* Alright, we have the length */
-	char * bufferb = malloc(image_size);
-	fread(bufferb, image_size, 1, image);
+	char * bufferb = mmap(NULL, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (bufferb == MAP_FAILED) return 1;
 
 	if (bufferb[0] == 'B' && bufferb[1] == 'M') {
 		/* Bitmaps */
@@ -573,8 +808,7 @@ int load_sprite_bmp(sprite_t * sprite, const char * filename) {
 	}
 
 _cleanup_sprite:
-	fclose(image);
-	free(bufferb);
+	munmap(bufferb, image_size);
 	return 0;
 }
 
@@ -583,10 +817,122 @@ static __m128i mask00ff;
 static __m128i mask0080;
 static __m128i mask0101;
 
+/* Composite four packed source pixels over four destination pixels;
+ * dst must be 16-byte aligned, src can be anything. */
+static inline void gfx_blend4_sse2(uint32_t * dst, const uint32_t * src) {
+	__m128i d = _mm_load_si128((void *)dst);
+	__m128i s = _mm_loadu_si128((void *)src);
+
+	__m128i d_l, d_h;
+	__m128i s_l, s_h;
+
+	// unpack destination
+	d_l = _mm_unpacklo_epi8(d, _mm_setzero_si128());
+	d_h = _mm_unpackhi_epi8(d, _mm_setzero_si128());
+
+	// unpack source
+	s_l = _mm_unpacklo_epi8(s, _mm_setzero_si128());
+	s_h = _mm_unpackhi_epi8(s, _mm_setzero_si128());
+
+	__m128i a_l, a_h;
+	__m128i t_l, t_h;
+
+	// extract source alpha RGBA → AAAA
+	a_l = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_l, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+	a_h = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_h, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+
+	// negate source alpha
+	t_l = _mm_xor_si128(a_l, mask00ff);
+	t_h = _mm_xor_si128(a_h, mask00ff);
+
+	// apply source alpha to destination
+	d_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_l,t_l),mask0080),mask0101);
+	d_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_h,t_h),mask0080),mask0101);
+
+	// combine source and destination
+	d_l = _mm_adds_epu8(s_l,d_l);
+	d_h = _mm_adds_epu8(s_h,d_h);
+
+	// pack low + high and write back to memory
+	_mm_store_si128((void*)dst, _mm_packus_epi16(d_l,d_h));
+}
+
+/* Same blend, but pshufb splats each pixel's alpha byte across its
+ * unpacked lanes in one shot, replacing the four-shuffle dance. */
+__attribute__((target("ssse3")))
+static inline void gfx_blend4_ssse3(uint32_t * dst, const uint32_t * src) {
+	const __m128i splat_a_l = _mm_set_epi8(-1,7,-1,7,-1,7,-1,7,-1,3,-1,3,-1,3,-1,3);
+	const __m128i splat_a_h = _mm_set_epi8(-1,15,-1,15,-1,15,-1,15,-1,11,-1,11,-1,11,-1,11);
+
+	__m128i d = _mm_load_si128((void *)dst);
+	__m128i s = _mm_loadu_si128((void *)src);
+
+	__m128i d_l = _mm_unpacklo_epi8(d, _mm_setzero_si128());
+	__m128i d_h = _mm_unpackhi_epi8(d, _mm_setzero_si128());
+	__m128i s_l = _mm_unpacklo_epi8(s, _mm_setzero_si128());
+	__m128i s_h = _mm_unpackhi_epi8(s, _mm_setzero_si128());
+
+	__m128i t_l = _mm_xor_si128(_mm_shuffle_epi8(s, splat_a_l), mask00ff);
+	__m128i t_h = _mm_xor_si128(_mm_shuffle_epi8(s, splat_a_h), mask00ff);
+
+	d_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_l,t_l),mask0080),mask0101);
+	d_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_h,t_h),mask0080),mask0101);
+
+	d_l = _mm_adds_epu8(s_l,d_l);
+	d_h = _mm_adds_epu8(s_h,d_h);
+
+	_mm_store_si128((void*)dst, _mm_packus_epi16(d_l,d_h));
+}
+
+/* Row kernels: composite a whole span of source over destination,
+ * eight pixels per iteration - scalar up to destination alignment,
+ * vectors, scalar tail. Everything that blits rows of embedded-alpha
+ * pixels (sprites, translucent windows in the compositor) lands here,
+ * through the pointer picked at load time below. */
+static void gfx_blend_row_sse2(uint32_t * dst, const uint32_t * src, size_t width) {
+	size_t i = 0;
+	for (; i < width && ((uintptr_t)&dst[i] & 15); ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], src[i]);
+	}
+	for (; i + 8 <= width; i += 8) {
+		gfx_blend4_sse2(&dst[i], &src[i]);
+		gfx_blend4_sse2(&dst[i+4], &src[i+4]);
+	}
+	for (; i + 4 <= width; i += 4) {
+		gfx_blend4_sse2(&dst[i], &src[i]);
+	}
+	for (; i < width; ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], src[i]);
+	}
+}
+
+__attribute__((target("ssse3")))
+static void gfx_blend_row_ssse3(uint32_t * dst, const uint32_t * src, size_t width) {
+	size_t i = 0;
+	for (; i < width && ((uintptr_t)&dst[i] & 15); ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], src[i]);
+	}
+	for (; i + 8 <= width; i += 8) {
+		gfx_blend4_ssse3(&dst[i], &src[i]);
+		gfx_blend4_ssse3(&dst[i+4], &src[i+4]);
+	}
+	for (; i + 4 <= width; i += 4) {
+		gfx_blend4_ssse3(&dst[i], &src[i]);
+	}
+	for (; i < width; ++i) {
+		dst[i] = alpha_blend_rgba(dst[i], src[i]);
+	}
+}
+
+static void (*gfx_blend_row)(uint32_t * dst, const uint32_t * src, size_t width) = gfx_blend_row_sse2;
+
 __attribute__((constructor)) static void _masks(void) {
 	mask00ff = _mm_set1_epi16(0x00FF);
 	mask0080 = _mm_set1_epi16(0x0080);
 	mask0101 = _mm_set1_epi16(0x0101);
+	if (__builtin_cpu_supports("ssse3")) {
+		gfx_blend_row = gfx_blend_row_ssse3;
+	}
 }
 #endif
 
@@ -597,6 +943,7 @@ void draw_sprite(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_
 	int32_t _top    = max(y, 0);
 	int32_t _right  = min(x + sprite->width,  ctx->width - 1);
 	int32_t _bottom = min(y + sprite->height, ctx->height - 1);
+	gfx_damage(ctx, x, y, sprite->width, sprite->height);
 	if (sprite->alpha == ALPHA_EMBEDDED) {
 		/* Alpha embedded is the most important step. */
 		for (uint16_t _y = 0; _y < sprite->height; ++_y) {
@@ -611,51 +958,9 @@ void draw_sprite(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_
 			}
 #else
 			uint16_t _x = (x < _left) ? _left - x : 0;
-
-			/* Ensure alignment */
-			for (; _x < sprite->width && x + _x <= _right; ++_x) {
-				if (!((uintptr_t)&GFX(ctx, x + _x, y + _y) & 15)) break;
-				GFX(ctx, x + _x, y + _y) = alpha_blend_rgba(GFX(ctx, x + _x, y + _y), SPRITE(sprite, _x, _y));
-			}
-			for (; _x < sprite->width - 3 && x + _x + 3 <= _right; _x += 4) {
-				__m128i d = _mm_load_si128((void *)&GFX(ctx, x + _x, y + _y));
-				__m128i s = _mm_loadu_si128((void *)&SPRITE(sprite, _x, _y));
-
-				__m128i d_l, d_h;
-				__m128i s_l, s_h;
-
-				// unpack destination
-				d_l = _mm_unpacklo_epi8(d, _mm_setzero_si128());
-				d_h = _mm_unpackhi_epi8(d, _mm_setzero_si128());
-
-				// unpack source
-				s_l = _mm_unpacklo_epi8(s, _mm_setzero_si128());
-				s_h = _mm_unpackhi_epi8(s, _mm_setzero_si128());
-
-				__m128i a_l, a_h;
-				__m128i t_l, t_h;
-
-				// extract source alpha RGBA → AAAA
-				a_l = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_l, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
-				a_h = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_h, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
-
-				// negate source alpha
-				t_l = _mm_xor_si128(a_l, mask00ff);
-				t_h = _mm_xor_si128(a_h, mask00ff);
-
-				// apply source alpha to destination
-				d_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_l,t_l),mask0080),mask0101);
-				d_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(d_h,t_h),mask0080),mask0101);
-
-				// combine source and destination
-				d_l = _mm_adds_epu8(s_l,d_l);
-				d_h = _mm_adds_epu8(s_h,d_h);
-
-				// pack low + high and write back to memory
-				_mm_storeu_si128((void*)&GFX(ctx, x + _x, y + _y), _mm_packus_epi16(d_l,d_h));
-			}
-			for (; _x < sprite->width && x + _x <= _right; ++_x) {
-				GFX(ctx, x + _x, y + _y) = alpha_blend_rgba(GFX(ctx, x + _x, y + _y), SPRITE(sprite, _x, _y));
+			int32_t _end = min((int32_t)sprite->width, _right - x + 1);
+			if ((int32_t)_x < _end) {
+				gfx_blend_row(&GFX(ctx, x + _x, y + _y), &SPRITE(sprite, _x, _y), _end - _x);
 			}
 #endif
 		}
@@ -674,6 +979,7 @@ void draw_sprite(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_
 void draw_line(gfx_context_t * ctx, int32_t x0, int32_t x1, int32_t y0, int32_t y1, uint32_t color) {
 	int deltax = abs(x1 - x0);
 	int deltay = abs(y1 - y0);
+	gfx_damage(ctx, min(x0,x1), min(y0,y1), deltax + 1, deltay + 1);
 	int sx = (x0 < x1) ? 1 : -1;
 	int sy = (y0 < y1) ? 1 : -1;
 	int error = deltax - deltay;
@@ -697,6 +1003,7 @@ void draw_line(gfx_context_t * ctx, int32_t x0, int32_t x1, int32_t y0, int32_t
 void draw_line_thick(gfx_context_t * ctx, int32_t x0, int32_t x1, int32_t y0, int32_t y1, uint32_t color, char thickness) {
 	int deltax = abs(x1 - x0);
 	int deltay = abs(y1 - y0);
+	gfx_damage(ctx, min(x0,x1) - thickness, min(y0,y1) - thickness, deltax + 2 * thickness + 1, deltay + 2 * thickness + 1);
 	int sx = (x0 < x1) ? 1 : -1;
 	int sy = (y0 < y1) ? 1 : -1;
 	int error = deltax - deltay;
@@ -723,6 +1030,7 @@ void draw_line_thick(gfx_context_t * ctx, int32_t x0, int32_t x1, int32_t y0, in
 
 
 void draw_fill(gfx_context_t * ctx, uint32_t color) {
+	gfx_damage(ctx, 0, 0, ctx->width, ctx->height);
 	for (uint16_t y = 0; y < ctx->height; ++y) {
 		for (uint16_t x = 0; x < ctx->width; ++x) {
 			GFX(ctx, x, y) = color;
@@ -768,6 +1076,27 @@ static uint32_t gfx_bilinear_interpolation(const sprite_t * tex, double u, doubl
 }
 #endif
 
+/*
+ * Fixed-point (16.16) flavor of the above for the incremental
+ * transform loop; the filter weights come straight out of the
+ * fraction bits, so there's no float math per pixel.
+ */
+__attribute__((hot))
+static inline uint32_t gfx_bilinear_fixed(const sprite_t * tex, int64_t u, int64_t v) {
+	int x = (int)(u >> 16);
+	int y = (int)(v >> 16);
+	uint32_t ul = out_of_bounds(tex,x,y)     ? 0 : SPRITE(tex,x,y);
+	uint32_t ur = out_of_bounds(tex,x+1,y)   ? 0 : SPRITE(tex,x+1,y);
+	uint32_t ll = out_of_bounds(tex,x,y+1)   ? 0 : SPRITE(tex,x,y+1);
+	uint32_t lr = out_of_bounds(tex,x+1,y+1) ? 0 : SPRITE(tex,x+1,y+1);
+	if ((ul | ur | ll | lr) == 0) return 0;
+	uint8_t u_ratio = (u >> 8) & 0xFF;
+	uint8_t v_ratio = (v >> 8) & 0xFF;
+	uint32_t top = linear_interp(ul,ur,u_ratio);
+	uint32_t bot = linear_interp(ll,lr,u_ratio);
+	return linear_interp(top,bot,v_ratio);
+}
+
 static inline void apply_alpha_vector(uint32_t * pixels, size_t width, uint8_t alpha) {
 	size_t i = 0;
 #ifndef NO_SSE
@@ -827,6 +1156,7 @@ void draw_sprite_alpha_paint(gfx_context_t * ctx, const sprite_t * sprite, int32
 	int32_t _top    = max(y, 0);
 	int32_t _right  = min(x + sprite->width,  ctx->width);
 	int32_t _bottom = min(y + sprite->height, ctx->height);
+	gfx_damage(ctx, x, y, sprite->width, sprite->height);
 	for (uint16_t _y = 0; _y < sprite->height; ++_y) {
 		if (y + _y < _top) continue;
 		if (y + _y > _bottom) break;
@@ -932,12 +1262,22 @@ int gfx_matrix_invert(gfx_matrix_t m, gfx_matrix_t inverse) {
 	return 0;
 }
 
+/* Destination pixels are processed in tiles this big, so that a
+ * rotated source walk stays within a cache-friendly window instead
+ * of striding through the whole texture once per scanline. */
+#define TRANSFORM_TILE 32
+
 /**
- * @brief Draw a sprite into a context, applying a transformation matrix.
+ * @brief Draw a transformed sprite at a selectable quality.
  *
- * Uses the affine transformaton matrix @p matrix to draw @p sprite into @p ctx.
+ * Like @ref draw_sprite_transform, but @p quality selects between the
+ * full bilinear filter and a cheaper nearest-neighbor fetch, which is
+ * usually good enough for in-flight animation frames.
+ *
+ * The inverse matrix is only evaluated once per tile row; within a row
+ * the source coordinate is stepped incrementally in 16.16 fixed point.
  */
-void draw_sprite_transform(gfx_context_t * ctx, const sprite_t * sprite, gfx_matrix_t matrix, float alpha) {
+void draw_sprite_transform_quality(gfx_context_t * ctx, const sprite_t * sprite, gfx_matrix_t matrix, float alpha, int quality) {
 	double inverse[2][3];
 
 	/* Calculate the inverse matrix for use in calculating sprite
@@ -962,21 +1302,62 @@ void draw_sprite_transform(gfx_context_t * ctx, const sprite_t * sprite, gfx_mat
 	int32_t _right  = clamp(fmax(fmax(ul_x+1, ll_x+1), fmax(ur_x+1, lr_x+1)), 0, ctx->width);
 	int32_t _bottom = clamp(fmax(fmax(ul_y+1, ll_y+1), fmax(ur_y+1, lr_y+1)), 0, ctx->height);
 
-	sprite_t * scanline = create_sprite(_right - _left, 1, ALPHA_EMBEDDED);
+	/* Source coordinate steps per destination pixel */
+	int64_t du_dx = (int64_t)(inverse[0][0] * 65536.0);
+	int64_t dv_dx = (int64_t)(inverse[1][0] * 65536.0);
+
+	sprite_t * tile = create_sprite(TRANSFORM_TILE, TRANSFORM_TILE, ALPHA_EMBEDDED);
 	uint8_t alp = alpha * 255;
 
-	for (int32_t _y = _top; _y < _bottom; ++_y) {
-		if (!_is_in_clip(ctx, _y)) continue;
-		for (int32_t _x = _left; _x < _right; ++_x) {
-			double u, v;
-			apply_matrix(_x, _y, inverse, &u, &v);
-			SPRITE(scanline,_x - _left,0) = gfx_bilinear_interpolation(sprite, u, v);
+	for (int32_t ty = _top; ty < _bottom; ty += TRANSFORM_TILE) {
+		int32_t th = min(TRANSFORM_TILE, _bottom - ty);
+		for (int32_t tx = _left; tx < _right; tx += TRANSFORM_TILE) {
+			int32_t tw = min(TRANSFORM_TILE, _right - tx);
+
+			/* Partial tiles keep their unused pixels transparent */
+			if (tw < TRANSFORM_TILE || th < TRANSFORM_TILE) {
+				memset(tile->bitmap, 0, sizeof(uint32_t) * TRANSFORM_TILE * TRANSFORM_TILE);
+			}
+
+			for (int32_t row = 0; row < th; ++row) {
+				/* draw_sprite skips unclipped rows, so we can, too */
+				if (!_is_in_clip(ctx, ty + row)) continue;
+
+				double u0, v0;
+				apply_matrix(tx, ty + row, inverse, &u0, &v0);
+				int64_t u = (int64_t)(u0 * 65536.0);
+				int64_t v = (int64_t)(v0 * 65536.0);
+
+				uint32_t * out = &SPRITE(tile, 0, row);
+				if (quality == GFX_TRANSFORM_NEAREST) {
+					for (int32_t i = 0; i < tw; ++i, u += du_dx, v += dv_dx) {
+						int32_t sx = (int32_t)((u + 0x8000) >> 16);
+						int32_t sy = (int32_t)((v + 0x8000) >> 16);
+						out[i] = out_of_bounds(sprite, sx, sy) ? 0 : SPRITE(sprite, sx, sy);
+					}
+				} else {
+					for (int32_t i = 0; i < tw; ++i, u += du_dx, v += dv_dx) {
+						out[i] = gfx_bilinear_fixed(sprite, u, v);
+					}
+				}
+
+				apply_alpha_vector(out, tw, alp);
+			}
+
+			draw_sprite(ctx, tile, tx, ty);
 		}
-		apply_alpha_vector(scanline->bitmap, scanline->width, alp);
-		draw_sprite(ctx,scanline,_left,_y);
 	}
 
-	sprite_free(scanline);
+	sprite_free(tile);
+}
+
+/**
+ * @brief Draw a sprite into a context, applying a transformation matrix.
+ *
+ * Uses the affine transformaton matrix @p matrix to draw @p sprite into @p ctx.
+ */
+void draw_sprite_transform(gfx_context_t * ctx, const sprite_t * sprite, gfx_matrix_t matrix, float alpha) {
+	draw_sprite_transform_quality(ctx, sprite, matrix, alpha, GFX_TRANSFORM_BILINEAR);
 }
 
 void draw_sprite_rotate(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, float rotation, float alpha) {
@@ -988,20 +1369,126 @@ void draw_sprite_rotate(gfx_context_t * ctx, const sprite_t * sprite, int32_t x,
 	draw_sprite_transform(ctx,sprite,m,alpha);
 }
 
+/* Horizontally scale one sprite row into @p out using column offsets
+ * and weights computed once per blit. Rows off the sprite read as
+ * transparent, like the transform path's out-of-bounds samples. */
+static void gfx_scale_row(const sprite_t * sprite, int32_t sy, uint32_t * out, int cols, const int32_t * src_x, const uint8_t * wgt_x) {
+	if (sy < 0 || sy >= sprite->height) {
+		memset(out, 0, cols * sizeof(uint32_t));
+		return;
+	}
+	const uint32_t * row = &SPRITE(sprite, 0, sy);
+	for (int i = 0; i < cols; i++) {
+		int32_t sx = src_x[i];
+		uint32_t l = (sx >= 0 && sx < sprite->width) ? row[sx] : 0;
+		uint32_t r = (sx + 1 >= 0 && sx + 1 < sprite->width) ? row[sx + 1] : 0;
+		out[i] = linear_interp(l, r, wgt_x[i]);
+	}
+}
+
+/* Blend two scaled rows with one weight for the whole span - the
+ * vertical half of the bilinear filter, which is where the scaled blit
+ * spends its time, four pixels per iteration. Lane math matches
+ * linear_interp exactly. */
+static void gfx_interp_rows(const uint32_t * top, const uint32_t * bot, uint32_t * out, int cols, uint8_t pr) {
+	int i = 0;
+#ifndef NO_SSE
+	__m128i wr = _mm_set1_epi16(pr);
+	__m128i wl = _mm_set1_epi16(0xFF ^ pr);
+	for (; i + 4 <= cols; i += 4) {
+		__m128i t = _mm_loadu_si128((void*)&top[i]);
+		__m128i b = _mm_loadu_si128((void*)&bot[i]);
+
+		__m128i t_l = _mm_unpacklo_epi8(t, _mm_setzero_si128());
+		__m128i t_h = _mm_unpackhi_epi8(t, _mm_setzero_si128());
+		__m128i b_l = _mm_unpacklo_epi8(b, _mm_setzero_si128());
+		__m128i b_h = _mm_unpackhi_epi8(b, _mm_setzero_si128());
+
+		t_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(t_l,wl),mask0080),mask0101);
+		t_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(t_h,wl),mask0080),mask0101);
+		b_l = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(b_l,wr),mask0080),mask0101);
+		b_h = _mm_mulhi_epu16(_mm_adds_epu16(_mm_mullo_epi16(b_h,wr),mask0080),mask0101);
+
+		_mm_storeu_si128((void*)&out[i], _mm_packus_epi16(_mm_add_epi16(t_l,b_l), _mm_add_epi16(t_h,b_h)));
+	}
+#endif
+	for (; i < cols; i++) {
+		out[i] = linear_interp(top[i], bot[i], pr);
+	}
+}
+
+/* Axis-aligned bilinear scaling. The transform path recomputes the
+ * sample position and weights per destination pixel in doubles; for a
+ * straight scale the column offsets and weights repeat every row and
+ * the row weight is constant across a row, so both are computed once
+ * and the blit is two separable filter passes. The two horizontally
+ * scaled source rows are cached between output rows, since upscales
+ * reuse them many times. */
+static void gfx_sprite_scale(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, uint16_t width, uint16_t height, float alpha) {
+	if (!width || !height || !sprite->width || !sprite->height) return;
+
+	int32_t _left   = clamp(x, 0, ctx->width);
+	int32_t _top    = clamp(y, 0, ctx->height);
+	int32_t _right  = clamp(x + width,  0, ctx->width);
+	int32_t _bottom = clamp(y + height, 0, ctx->height);
+	if (_right <= _left || _bottom <= _top) return;
+
+	int cols = _right - _left;
+	int32_t * src_x = malloc(sizeof(int32_t) * cols);
+	uint8_t * wgt_x = malloc(cols);
+	double step_u = (double)sprite->width / (double)width;
+	double step_v = (double)sprite->height / (double)height;
+	for (int i = 0; i < cols; i++) {
+		double u = ((_left + i) - x) * step_u;
+		int32_t sx = (int32_t)(u + 2.0) - 2;
+		src_x[i] = sx;
+		wgt_x[i] = (uint8_t)((u - sx) * 0xFF);
+	}
+
+	uint32_t * row_a = malloc(sizeof(uint32_t) * cols);
+	uint32_t * row_b = malloc(sizeof(uint32_t) * cols);
+	int32_t have_a = -1, have_b = -1;
+	sprite_t * scanline = create_sprite(cols, 1, ALPHA_EMBEDDED);
+	uint8_t alp = alpha * 255;
+
+	for (int32_t _y = _top; _y < _bottom; ++_y) {
+		if (!_is_in_clip(ctx, _y)) continue;
+		double v = (_y - y) * step_v;
+		int32_t sy = (int32_t)(v + 2.0) - 2;
+		uint8_t vw = (uint8_t)((v - sy) * 0xFF);
+
+		if (have_a != sy) {
+			if (have_b == sy) {
+				uint32_t * t = row_a; row_a = row_b; row_b = t;
+				int32_t th = have_a; have_a = have_b; have_b = th;
+			} else {
+				gfx_scale_row(sprite, sy, row_a, cols, src_x, wgt_x);
+				have_a = sy;
+			}
+		}
+		if (have_b != sy + 1) {
+			gfx_scale_row(sprite, sy + 1, row_b, cols, src_x, wgt_x);
+			have_b = sy + 1;
+		}
+
+		gfx_interp_rows(row_a, row_b, scanline->bitmap, cols, vw);
+		if (alp != 255) apply_alpha_vector(scanline->bitmap, cols, alp);
+		draw_sprite(ctx, scanline, _left, _y);
+	}
+
+	sprite_free(scanline);
+	free(row_a);
+	free(row_b);
+	free(src_x);
+	free(wgt_x);
+}
+
 void draw_sprite_scaled(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, uint16_t width, uint16_t height) {
-	gfx_matrix_t m;
-	gfx_matrix_identity(m);
-	gfx_matrix_translate(m, x, y);
-	gfx_matrix_scale(m, (double)width / (double)sprite->width, (double)height / (double)sprite->height);
-	draw_sprite_transform(ctx,sprite,m,1.0);
+	gfx_sprite_scale(ctx,sprite,x,y,width,height,1.0);
 }
 
 void draw_sprite_scaled_alpha(gfx_context_t * ctx, const sprite_t * sprite, int32_t x, int32_t y, uint16_t width, uint16_t height, float alpha) {
-	gfx_matrix_t m;
-	gfx_matrix_identity(m);
-	gfx_matrix_translate(m, x, y);
-	gfx_matrix_scale(m, (double)width / (double)sprite->width, (double)height / (double)sprite->height);
-	draw_sprite_transform(ctx,sprite,m,alpha);
+	gfx_sprite_scale(ctx,sprite,x,y,width,height,alpha);
 }
 
 uint32_t interp_colors(uint32_t bottom, uint32_t top, uint8_t interp) {
@@ -1017,6 +1504,7 @@ void draw_rectangle(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t width, u
 	int32_t _top    = max(y, 0);
 	int32_t _right  = min(x + width,  ctx->width - 1);
 	int32_t _bottom = min(y + height, ctx->height - 1);
+	gfx_damage(ctx, x, y, width, height);
 	for (uint16_t _y = 0; _y < height; ++_y) {
 		if (!_is_in_clip(ctx, y + _y)) continue;
 		for (uint16_t _x = 0; _x < width; ++_x) {
@@ -1032,6 +1520,7 @@ void draw_rectangle_solid(gfx_context_t * ctx, int32_t x, int32_t y, uint16_t wi
 	int32_t _top    = max(y, 0);
 	int32_t _right  = min(x + width,  ctx->width - 1);
 	int32_t _bottom = min(y + height, ctx->height - 1);
+	gfx_damage(ctx, x, y, width, height);
 	for (uint16_t _y = 0; _y < height; ++_y) {
 		if (!_is_in_clip(ctx, y + _y)) continue;
 		for (uint16_t _x = 0; _x < width; ++_x) {
@@ -1073,6 +1562,8 @@ void draw_rounded_rectangle_pattern(gfx_context_t * ctx, int32_t x, int32_t y, u
 		radius = height / 2;
 	}
 
+	gfx_damage(ctx, x, y, width, height);
+
 	for (int row = y; row < y + height; row++){
 		if (row < 0) continue;
 		if (row >= ctx->height) break;
@@ -1171,6 +1662,8 @@ void draw_line_aa_points(gfx_context_t * ctx, struct gfx_point *v, struct gfx_po
 	int y_0 = max(min(v->y - thickness - 1, w->y - thickness - 1), 0);
 	int y_1 = min(max(v->y + thickness + 1, w->y + thickness + 1), ctx->height);
 
+	gfx_damage(ctx, x_0, y_0, x_1 - x_0, y_1 - y_0);
+
 	for (int y = y_0; y < y_1; ++y) {
 		for (int x = x_0; x < x_1; ++x) {
 			struct gfx_point p = {x,y};
@@ -4,6 +4,12 @@
  * Used be a few different applications.
  * Probably needs scaling?
  *
+ * Icons are decoded once system-wide into a shared-memory atlas;
+ * each process keeps a small map of name → sprite wrappers whose
+ * bitmaps point directly into the atlas, so the panel, file browser,
+ * and menus don't each decode and store their own copies of the
+ * same PNGs.
+ *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
@@ -11,15 +17,52 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/shm.h>
+#include <syscall.h>
 
 #include <toaru/graphics.h>
 #include <toaru/hashmap.h>
+#include <toaru/list.h>
+#include <toaru/spinlock.h>
 
 static hashmap_t * icon_cache_16;
 static hashmap_t * icon_cache_48;
 
+#define ATLAS_MAGIC       0x49434f4e /* 'ICON' */
+#define ATLAS_MAX_ENTRIES 128
+#define ATLAS_POOL_PIXELS (1024 * 256) /* 1MB of pixel data */
+
+struct atlas_entry {
+	char name[52];       /* Icon identifier */
+	uint8_t  alpha;      /* Sprite alpha mode */
+	uint8_t  _pad;
+	uint16_t size;       /* Nominal size class (16 or 48) */
+	uint16_t width;      /* Actual sprite dimensions */
+	uint16_t height;
+	uint32_t offset;     /* Offset into the pixel pool, in pixels */
+};
+
+struct atlas_header {
+	uint32_t magic;
+	uint32_t generation; /* Bumped when the atlas is rebuilt */
+	int volatile lock;
+	uint32_t count;      /* Entries in use */
+	uint32_t pool_used;  /* Pixels in use */
+	struct atlas_entry entries[ATLAS_MAX_ENTRIES];
+	uint32_t pool[];
+};
+
+static struct atlas_header * atlas = NULL;
+static uint32_t atlas_generation = 0;
+
+/* Sprite wrappers whose bitmaps live in the shared pool */
+static list_t * atlas_sprites = NULL;
+/* Sprites this process decoded itself (atlas full, or no atlas) */
+static list_t * local_sprites = NULL;
+
 static char * icon_directories_16[] = {
 	"/usr/share/icons/16",
 	"/usr/share/icons/24",
@@ -44,25 +87,149 @@ static char * prefixes[] = {
 	NULL
 };
 
+/*
+ * Map (or create) the shared atlas. The first process to get here
+ * initializes the header; everyone else just picks it up.
+ */
+static void atlas_connect(void) {
+	size_t size = sizeof(struct atlas_header) + sizeof(uint32_t) * ATLAS_POOL_PIXELS;
+	atlas = shm_obtain("sys.icons.atlas", &size);
+	if (!atlas || size < sizeof(struct atlas_header) + sizeof(uint32_t) * ATLAS_POOL_PIXELS) {
+		atlas = NULL;
+		return;
+	}
+	spin_lock(&atlas->lock);
+	if (atlas->magic != ATLAS_MAGIC) {
+		atlas->count = 0;
+		atlas->pool_used = 0;
+		atlas->generation = 1;
+		atlas->magic = ATLAS_MAGIC;
+	}
+	atlas_generation = atlas->generation;
+	spin_unlock(&atlas->lock);
+}
+
+/* Wrap an atlas entry in a local sprite pointing into the shared pool */
+static sprite_t * atlas_wrap(struct atlas_entry * ent) {
+	sprite_t * icon = malloc(sizeof(sprite_t));
+	icon->width  = ent->width;
+	icon->height = ent->height;
+	icon->bitmap = &atlas->pool[ent->offset];
+	icon->masks  = NULL;
+	icon->blank  = 0;
+	icon->alpha  = ent->alpha;
+	list_insert(atlas_sprites, icon);
+	return icon;
+}
+
+/* Look up an already-decoded icon in the atlas; caller holds the lock. */
+static struct atlas_entry * atlas_find(const char * name, int size) {
+	for (uint32_t i = 0; i < atlas->count; ++i) {
+		if (atlas->entries[i].size == size && !strcmp(atlas->entries[i].name, name)) {
+			return &atlas->entries[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Publish a freshly-decoded icon into the atlas; caller holds the
+ * lock. Returns NULL when it doesn't fit (or has masks, which we
+ * can't share), in which case the caller keeps its private copy.
+ */
+static struct atlas_entry * atlas_add(const char * name, int size, sprite_t * icon) {
+	size_t pixels = (size_t)icon->width * icon->height;
+	if (icon->masks) return NULL;
+	if (strlen(name) >= sizeof(atlas->entries[0].name)) return NULL;
+	if (atlas->count >= ATLAS_MAX_ENTRIES) return NULL;
+	if (atlas->pool_used + pixels > ATLAS_POOL_PIXELS) return NULL;
+
+	struct atlas_entry * ent = &atlas->entries[atlas->count];
+	strcpy(ent->name, name);
+	ent->alpha  = icon->alpha;
+	ent->size   = size;
+	ent->width  = icon->width;
+	ent->height = icon->height;
+	ent->offset = atlas->pool_used;
+	memcpy(&atlas->pool[ent->offset], icon->bitmap, sizeof(uint32_t) * pixels);
+	atlas->pool_used += pixels;
+	atlas->count++;
+	return ent;
+}
+
+static void seed_cache(hashmap_t * cache, const char * path) {
+	sprite_t * app_icon = malloc(sizeof(sprite_t));
+	load_sprite(app_icon, (char *)path);
+	list_insert(local_sprites, app_icon);
+	hashmap_set(cache, "generic", app_icon);
+}
+
+static void seed_caches(void) {
+	atlas_sprites = list_create();
+	local_sprites = list_create();
+
+	icon_cache_16 = hashmap_create(10);
+	seed_cache(icon_cache_16, "/usr/share/icons/16/applications-generic.png");
+
+	icon_cache_48 = hashmap_create(10);
+	seed_cache(icon_cache_48, "/usr/share/icons/48/applications-generic.png");
+}
+
 __attribute__((constructor))
 static void _init_caches(void) {
-	icon_cache_16 = hashmap_create(10);
-	{ /* Generic fallback icon */
-		sprite_t * app_icon = malloc(sizeof(sprite_t));
-		load_sprite(app_icon, "/usr/share/icons/16/applications-generic.png");
-		hashmap_set(icon_cache_16, "generic", app_icon);
+	seed_caches();
+	atlas_connect();
+}
+
+/*
+ * The atlas generation changes when another process rebuilds it
+ * (eg. on a theme change); drop everything we have cached, as our
+ * sprites may point at recycled pool space.
+ */
+static void atlas_sync(void) {
+	if (!atlas || atlas->generation == atlas_generation) return;
+
+	foreach(node, atlas_sprites) {
+		free(node->value);
 	}
+	list_free(atlas_sprites);
+	free(atlas_sprites);
 
-	icon_cache_48 = hashmap_create(10);
-	{ /* Generic fallback icon */
-		sprite_t * app_icon = malloc(sizeof(sprite_t));
-		load_sprite(app_icon, "/usr/share/icons/48/applications-generic.png");
-		hashmap_set(icon_cache_48, "generic", app_icon);
+	foreach(node, local_sprites) {
+		sprite_t * icon = node->value;
+		free(icon->bitmap);
+		if (icon->masks) free(icon->masks);
+		free(icon);
 	}
+	list_free(local_sprites);
+	free(local_sprites);
+
+	hashmap_free(icon_cache_16);
+	free(icon_cache_16);
+	hashmap_free(icon_cache_48);
+	free(icon_cache_48);
+
+	seed_caches();
+	atlas_generation = atlas->generation;
+}
+
+/*
+ * Rebuild the atlas from scratch. Existing clients notice the
+ * generation bump on their next icon_get_*() and re-resolve.
+ */
+void icon_cache_invalidate(void) {
+	if (!atlas) return;
+	spin_lock(&atlas->lock);
+	atlas->count = 0;
+	atlas->pool_used = 0;
+	atlas->generation++;
+	spin_unlock(&atlas->lock);
+	atlas_sync();
 }
 
+static sprite_t * icon_get_int(const char * name, hashmap_t * icon_cache, int size, char ** icon_directories) {
 
-static sprite_t * icon_get_int(const char * name, hashmap_t * icon_cache, char ** icon_directories) {
+	atlas_sync();
 
 	if (!strcmp(name,"")) {
 		/* If a window doesn't have an icon set, return the generic icon */
@@ -73,6 +240,18 @@ static sprite_t * icon_get_int(const char * name, hashmap_t * icon_cache, char *
 	sprite_t * icon = hashmap_get(icon_cache, (void*)name);
 
 	if (!icon) {
+		/* Someone else may have decoded this icon already */
+		if (atlas) {
+			spin_lock(&atlas->lock);
+			struct atlas_entry * ent = atlas_find(name, size);
+			spin_unlock(&atlas->lock);
+			if (ent) {
+				icon = atlas_wrap(ent);
+				hashmap_set(icon_cache, (void*)name, icon);
+				return icon;
+			}
+		}
+
 		/* We don't have an icon cached for this identifier, try search */
 		int i = 0;
 		char path[100];
@@ -85,6 +264,24 @@ static sprite_t * icon_get_int(const char * name, hashmap_t * icon_cache, char *
 					/* And if we find one, cache it */
 					icon = malloc(sizeof(sprite_t));
 					load_sprite(icon, path);
+
+					/* Publish it for everyone else */
+					if (atlas) {
+						spin_lock(&atlas->lock);
+						struct atlas_entry * ent = atlas_find(name, size);
+						if (!ent) ent = atlas_add(name, size, icon);
+						spin_unlock(&atlas->lock);
+						if (ent) {
+							free(icon->bitmap);
+							if (icon->masks) free(icon->masks);
+							free(icon);
+							icon = atlas_wrap(ent);
+							hashmap_set(icon_cache, (void*)name, icon);
+							return icon;
+						}
+					}
+
+					list_insert(local_sprites, icon);
 					hashmap_set(icon_cache, (void*)name, icon);
 					return icon;
 				}
@@ -103,9 +300,9 @@ static sprite_t * icon_get_int(const char * name, hashmap_t * icon_cache, char *
 }
 
 sprite_t * icon_get_16(const char * name) {
-	return icon_get_int(name, icon_cache_16, icon_directories_16);
+	return icon_get_int(name, icon_cache_16, 16, icon_directories_16);
 }
 
 sprite_t * icon_get_48(const char * name) {
-	return icon_get_int(name, icon_cache_48, icon_directories_48);
+	return icon_get_int(name, icon_cache_48, 48, icon_directories_48);
 }
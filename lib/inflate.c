@@ -13,12 +13,23 @@
 #include <toaru/inflate.h>
 #endif
 
+/**
+ * Fast-path direct lookup: codes up to this many bits are decoded with
+ * a single table index instead of walking the code bit by bit. Longer
+ * codes (rare - they only show up for the least frequent symbols in
+ * dynamic blocks) fall back to the walk.
+ */
+#define HUFF_FAST_BITS 10
+#define HUFF_FAST_SIZE (1 << HUFF_FAST_BITS)
+
 /**
  * Decoded Huffman table
  */
 struct huff {
 	uint16_t counts[16];   /* Number of symbols of each length */
 	uint16_t symbols[288]; /* Ordered symbols */
+	uint16_t fast_sym[HUFF_FAST_SIZE]; /* Symbol for each short-code bit prefix */
+	uint8_t  fast_len[HUFF_FAST_SIZE]; /* Code length for same, 0 if code is long */
 };
 
 /**
@@ -46,41 +57,31 @@ static uint16_t read_16le(struct inflate_context * ctx) {
 }
 
 /**
- * Read a single bit from the source.
- * Fills the byte buffer with one byte when it runs out.
+ * Read multible bits, in bit order, from the source.
+ *
+ * The bit buffer is topped up one byte at a time, and only when the
+ * request cannot be satisfied from what is already buffered, so input
+ * bytes are consumed exactly when a bit-at-a-time reader would consume
+ * them - consumers like the PNG decoder count on that when they track
+ * how much of a chunk the inflater has eaten. Between reads the buffer
+ * never holds a whole byte of leftovers.
  */
-static uint8_t read_bit(struct inflate_context * ctx) {
-
-	/* When we run out of bits... */
-	if (ctx->buffer_size == 0) {
-		/* Refill from the next input byte */
-		ctx->bit_buffer = ctx->get_input(ctx);
-		/* And restore bit buffer size to 8 bits */
-		ctx->buffer_size = 8;
+static uint32_t read_bits(struct inflate_context * ctx, unsigned int count) {
+	while (ctx->buffer_size < (int)count) {
+		ctx->bit_buffer |= ctx->get_input(ctx) << ctx->buffer_size;
+		ctx->buffer_size += 8;
 	}
-
-	/* Get the next available bit */
-	int out = ctx->bit_buffer & 1;
-
-	/* Shift the bit buffer forward */
-	ctx->bit_buffer >>= 1;
-
-	/* There is now one less bit available */
-	ctx->buffer_size--;
-
+	uint32_t out = ctx->bit_buffer & ((1 << count) - 1);
+	ctx->bit_buffer >>= count;
+	ctx->buffer_size -= count;
 	return out;
 }
 
 /**
- * Read multible bits, in bit order, from the source.
+ * Read a single bit from the source.
  */
-static uint32_t read_bits(struct inflate_context * ctx, unsigned int count) {
-	uint32_t out = 0;
-	for (unsigned int bit = 0; bit < count; bit++) {
-		/* Read one bit at a time, from least to most significant */
-		out |= (read_bit(ctx) << bit);
-	}
-	return out;
+static uint8_t read_bit(struct inflate_context * ctx) {
+	return read_bits(ctx, 1);
 }
 
 /**
@@ -110,6 +111,30 @@ static void build_huffman(uint8_t * lengths, size_t size, struct huff * out) {
 	for (unsigned int i = 0; i < size; ++i) {
 		if (lengths[i]) out->symbols[offsets[lengths[i]]++] = i;
 	}
+
+	/* Precompute the direct lookup table for short codes. Codes are
+	 * canonical, so they can be enumerated from the counts; each code's
+	 * bits arrive least-significant-first in the stream, so its table
+	 * slots are the bit-reversed code under every possible filling of
+	 * the unused high index bits. */
+	for (unsigned int i = 0; i < HUFF_FAST_SIZE; ++i) out->fast_len[i] = 0;
+
+	unsigned int code = 0;
+	unsigned int index = 0;
+	for (unsigned int len = 1; len < 16; ++len) {
+		for (unsigned int n = 0; n < out->counts[len]; ++n, ++index, ++code) {
+			if (len > HUFF_FAST_BITS) continue;
+			unsigned int rev = 0;
+			for (unsigned int b = 0; b < len; ++b) {
+				rev |= ((code >> b) & 1) << (len - 1 - b);
+			}
+			for (unsigned int fill = rev; fill < HUFF_FAST_SIZE; fill += (1 << len)) {
+				out->fast_sym[fill] = out->symbols[index];
+				out->fast_len[fill] = len;
+			}
+		}
+		code <<= 1;
+	}
 }
 
 /**
@@ -148,8 +173,31 @@ static void build_fixed(void) {
 
 /**
  * Decode a symbol from the source using a Huffman table.
+ *
+ * Short codes resolve with one lookup in the precomputed table. A miss
+ * only happens when the true code needs more bits than are currently
+ * buffered, so refilling on a miss consumes input bytes exactly when
+ * the bit-at-a-time walk would have.
  */
 static int decode(struct inflate_context * ctx, struct huff * huff) {
+	while (1) {
+		if (ctx->buffer_size == 0) {
+			ctx->bit_buffer = ctx->get_input(ctx);
+			ctx->buffer_size = 8;
+		}
+		int len = huff->fast_len[ctx->bit_buffer & (HUFF_FAST_SIZE - 1)];
+		if (len && len <= ctx->buffer_size) {
+			int symbol = huff->fast_sym[ctx->bit_buffer & (HUFF_FAST_SIZE - 1)];
+			ctx->bit_buffer >>= len;
+			ctx->buffer_size -= len;
+			return symbol;
+		}
+		if (!len && ctx->buffer_size >= HUFF_FAST_BITS) break;
+		ctx->bit_buffer |= ctx->get_input(ctx) << ctx->buffer_size;
+		ctx->buffer_size += 8;
+	}
+
+	/* Code is longer than HUFF_FAST_BITS; walk it out bit by bit. */
 	int count = 0, cur = 0;
 	for (int i = 1; cur >= 0; i++) {
 		cur = (cur << 1) | read_bit(ctx); /* Shift */
@@ -174,13 +222,6 @@ static void emit(struct inflate_context * ctx, unsigned char byte) {
 	ctx->ring->pointer++;
 }
 
-/**
- * Look backwards in the output ring buffer.
- */
-static uint8_t peek(struct inflate_context * ctx, int offset) {
-	return ctx->ring->data[(ctx->ring->pointer - offset) % 32768];
-}
-
 /**
  * Decompress a block of Huffman-encoded data.
  */
@@ -254,8 +295,13 @@ static int inflate(struct inflate_context * ctx, struct huff * huff_len, struct
 			distance = decode(ctx, huff_dist);
 			offset = read_bits(ctx, dext[distance]) + dists[distance];
 
+			/* Walk the source cursor forward through the ring rather
+			 * than recomputing the back-reference for every byte; this
+			 * also naturally handles overlapping copies. */
+			size_t src = (ctx->ring->pointer - offset) & 32767;
 			for (int i = 0; i < length; ++i) {
-				uint8_t b = peek(ctx, offset);
+				uint8_t b = ctx->ring->data[src];
+				src = (src + 1) & 32767;
 				emit(ctx, b);
 			}
 		}
@@ -471,12 +517,11 @@ int gzip_decompress(struct inflate_context * ctx) {
 
 	int status = deflate_decompress(ctx);
 
-	/* Read CRC and decompressed size from end of input */
-	unsigned int crc32 = read_32le(ctx);
-	unsigned int dsize = read_32le(ctx);
-
-	(void)crc32;
-	(void)dsize;
+	/* Read CRC and decompressed size from end of input; we don't
+	 * verify them here - the output path never sees the bytes again -
+	 * but record them so the caller can check its own running CRC. */
+	ctx->gzip_crc32 = read_32le(ctx);
+	ctx->gzip_size = read_32le(ctx);
 
 	return status;
 }
@@ -53,6 +53,23 @@
 
 static sprite_t * sprite = NULL;
 
+/* Dimensions from the file; the sprite may be smaller when downscaling */
+static int jpeg_width = 0;
+static int jpeg_height = 0;
+
+/*
+ * How much to scale the image down by while decoding: the output
+ * is 1/(1 << scale_shift) the size of the file in each dimension,
+ * and each 8×8 coefficient block produces block_size × block_size
+ * output pixels (8 >> scale_shift).
+ */
+static int scale_shift = 0;
+static int block_size = 8;
+
+/* When set, baseline_dct picks scale_shift so the output fits */
+static int fit_width = 0;
+static int fit_height = 0;
+
 /* Byte swap short (because JPEG uses big-endian values) */
 static void swap16(uint16_t * val) {
 	char * a = (char *)val;
@@ -96,10 +113,6 @@ static void color_conversion(
 	*B = clamp(b + 128);
 }
 
-static int xy_to_lin(int x, int y) {
-	return x + y * 8;
-}
-
 struct huffman_table {
 	uint8_t lengths[16];
 	uint8_t elements[256];
@@ -147,8 +160,20 @@ static void baseline_dct(FILE * f, int len) {
 	len -= sizeof(struct dct);
 
 	TRACE("Image dimensions are %d×%d", dct.width, dct.height);
-	sprite->width  = dct.width;
-	sprite->height = dct.height;
+	jpeg_width  = dct.width;
+	jpeg_height = dct.height;
+
+	if (fit_width && fit_height) {
+		/* Smallest reduction that fits the requested bounds, up to 1/8 */
+		while (scale_shift < 3 &&
+		       ((dct.width >> scale_shift) > fit_width || (dct.height >> scale_shift) > fit_height)) {
+			scale_shift++;
+		}
+		block_size = 8 >> scale_shift;
+	}
+
+	sprite->width  = (dct.width  + (1 << scale_shift) - 1) >> scale_shift;
+	sprite->height = (dct.height + (1 << scale_shift) - 1) >> scale_shift;
 	sprite->bitmap = malloc(sizeof(uint32_t) * sprite->width * sprite->height);
 	sprite->masks = NULL;
 	sprite->alpha = 0;
@@ -212,14 +237,14 @@ static void define_huffman_table(FILE * f, int len) {
 }
 
 struct idct {
-	float base[64];
+	float base[64] __attribute__((aligned(16)));
 };
 
 /**
  * norm_coeff[0] = 0.35355339059
  * norm_coeff[1] = 0.5
  */
-static float cosines[8][8] = {
+static float cosines[8][8] __attribute__((aligned(16))) = {
 	{ 0.35355339059,0.35355339059,0.35355339059,0.35355339059,0.35355339059,0.35355339059,0.35355339059,0.35355339059 },
 	{ 0.490392640202,0.415734806151,0.27778511651,0.0975451610081,-0.0975451610081,-0.27778511651,-0.415734806151,-0.490392640202 },
 	{ 0.461939766256,0.191341716183,-0.191341716183,-0.461939766256,-0.461939766256,-0.191341716183,0.191341716183,0.461939766256 },
@@ -230,43 +255,72 @@ static float cosines[8][8] = {
 	{ 0.0975451610081,-0.27778511651,0.415734806151,-0.490392640202,0.490392640202,-0.415734806151,0.27778511651,-0.0975451610081 },
 };
 
-static float premul[8][8][8][8]= {{{{0}}}};
+/*
+ * Output basis for each scale. basis[0] is just @c cosines; for
+ * smaller scales each column is the average of the 1 << k cosine
+ * columns that fold into that output pixel, so the transform
+ * produces an exact box-filtered reduction without ever computing
+ * the full-size block.
+ */
+static float basis[4][8][8] __attribute__((aligned(16))) = {{{0}}};
+
+/*
+ * Transform a block of dequantized coefficients (in natural order)
+ * into samples, in place. The transform is separable: rows first
+ * into a temporary, then columns. Output is block_size × block_size.
+ */
+static void idct_transform(struct idct * self) {
+	float tmp[64] __attribute__((aligned(16)));
+	int n = block_size;
 
-static void add_idc(struct idct * self, int n, int m, int coeff) {
-#ifdef NO_SSE
-	for (int y = 0; y < 8; ++y) {
-		for (int x = 0; x < 8; ++x) {
-			self->base[xy_to_lin(x, y)] += premul[n][m][y][x] * coeff;
+#ifndef NO_SSE
+	if (n == 8) {
+		for (int m = 0; m < 8; ++m) {
+			__m128 lo = _mm_setzero_ps();
+			__m128 hi = _mm_setzero_ps();
+			for (int u = 0; u < 8; ++u) {
+				__m128 c = _mm_set1_ps(self->base[m * 8 + u]);
+				lo = _mm_add_ps(lo, _mm_mul_ps(c, _mm_load_ps(&cosines[u][0])));
+				hi = _mm_add_ps(hi, _mm_mul_ps(c, _mm_load_ps(&cosines[u][4])));
+			}
+			_mm_store_ps(&tmp[m * 8], lo);
+			_mm_store_ps(&tmp[m * 8 + 4], hi);
 		}
-	}
-#else
-	__m128 c = _mm_set_ps(coeff,coeff,coeff,coeff);
-	for (int y = 0; y < 8; ++y) {
-		__m128 a, b;
-		/* base[y][x] = base[y][x] + premul[n][m][y][x] * coeff */
-
-		/* x = 0..3 */
-		a = _mm_load_ps(&premul[n][m][y][0]);
-		a = _mm_mul_ps(a,c);
-		b = _mm_load_ps(&self->base[xy_to_lin(0,y)]);
-		a = _mm_add_ps(a,b);
-		_mm_store_ps(&self->base[xy_to_lin(0,y)], a);
-
-		/* x = 4..7 */
-		a = _mm_load_ps(&premul[n][m][y][4]);
-		a = _mm_mul_ps(a,c);
-		b = _mm_load_ps(&self->base[xy_to_lin(4,y)]);
-		a = _mm_add_ps(a,b);
-		_mm_store_ps(&self->base[xy_to_lin(4,y)], a);
+		for (int y = 0; y < 8; ++y) {
+			__m128 lo = _mm_setzero_ps();
+			__m128 hi = _mm_setzero_ps();
+			for (int m = 0; m < 8; ++m) {
+				__m128 c = _mm_set1_ps(cosines[m][y]);
+				lo = _mm_add_ps(lo, _mm_mul_ps(c, _mm_load_ps(&tmp[m * 8])));
+				hi = _mm_add_ps(hi, _mm_mul_ps(c, _mm_load_ps(&tmp[m * 8 + 4])));
+			}
+			_mm_store_ps(&self->base[y * 8], lo);
+			_mm_store_ps(&self->base[y * 8 + 4], hi);
+		}
+		return;
 	}
 #endif
-}
 
-static void add_zigzag(struct idct * self, int zi, int coeff) {
-	int i = zigzag[zi];
-	int n = i & 0x7;
-	int m = i >> 3;
-	add_idc(self, n, m, coeff);
+	float out[64];
+	for (int m = 0; m < 8; ++m) {
+		for (int x = 0; x < n; ++x) {
+			float s = 0.0;
+			for (int u = 0; u < 8; ++u) {
+				s += self->base[m * 8 + u] * basis[scale_shift][u][x];
+			}
+			tmp[m * 8 + x] = s;
+		}
+	}
+	for (int y = 0; y < n; ++y) {
+		for (int x = 0; x < n; ++x) {
+			float s = 0.0;
+			for (int m = 0; m < 8; ++m) {
+				s += tmp[m * 8 + x] * basis[scale_shift][m][y];
+			}
+			out[y * n + x] = s;
+		}
+	}
+	memcpy(self->base, out, sizeof(float) * n * n);
 }
 
 /* Read a bit from the stream */
@@ -361,7 +415,7 @@ static struct idct * build_matrix(struct idct * i, struct stream * st, int idx,
 	int bits = get_bitn(st, code);
 	int dccoeff = decode(code, bits) + oldcoeff;
 
-	add_zigzag(i, 0, dccoeff * quant[0]);
+	i->base[zigzag[0]] = dccoeff * quant[0];
 	int l = 1;
 
 	while (l < 64) {
@@ -373,10 +427,12 @@ static struct idct * build_matrix(struct idct * i, struct stream * st, int idx,
 		}
 		bits = get_bitn(st, code);
 		int coeff = decode(code, bits);
-		add_zigzag(i, l, coeff * quant[l]);
+		i->base[zigzag[l]] = coeff * quant[l];
 		l += 1;
 	}
 
+	idct_transform(i);
+
 	*outcoeff = dccoeff;
 	return i;
 }
@@ -390,13 +446,47 @@ static void set_pixel(int x, int y, uint32_t color) {
 
 /* Concvert YCbCr values to RGB pixels */
 static void draw_matrix(int x, int y, struct idct * L, struct idct * cb, struct idct * cr) {
-	for (int yy = 0; yy < 8; ++yy) {
-		for (int xx = 0; xx < 8; ++xx) {
-			int o = xy_to_lin(xx,yy);
-			int r, g, b;
-			color_conversion(L->base[o], cb->base[o], cr->base[o], &r, &g, &b);
-			uint32_t c = 0xFF000000 | (r << 16) | (g << 8) | b;
-			set_pixel((x * 8 + xx), (y * 8 + yy), c);
+	int n = block_size;
+	uint32_t out[64];
+	int o = 0;
+
+#ifndef NO_SSE
+	/* Convert four pixels at a time straight out of the sample blocks. */
+	const __m128 k_r   = _mm_set1_ps(2.0-2.0*0.299);
+	const __m128 k_b   = _mm_set1_ps(2.0-2.0*0.114);
+	const __m128 k_gb  = _mm_set1_ps(0.144);
+	const __m128 k_gr  = _mm_set1_ps(0.229);
+	const __m128 k_gd  = _mm_set1_ps(0.587);
+	const __m128 off   = _mm_set1_ps(128.0);
+	const __m128 zero  = _mm_setzero_ps();
+	const __m128 k_255 = _mm_set1_ps(255.0);
+	for (; o + 4 <= n * n; o += 4) {
+		__m128 Y  = _mm_load_ps(&L->base[o]);
+		__m128 Cb = _mm_load_ps(&cb->base[o]);
+		__m128 Cr = _mm_load_ps(&cr->base[o]);
+		__m128 r = _mm_add_ps(_mm_mul_ps(Cr, k_r), Y);
+		__m128 b = _mm_add_ps(_mm_mul_ps(Cb, k_b), Y);
+		__m128 g = _mm_div_ps(_mm_sub_ps(Y, _mm_add_ps(_mm_mul_ps(k_gb, b), _mm_mul_ps(k_gr, r))), k_gd);
+		r = _mm_min_ps(_mm_max_ps(_mm_add_ps(r, off), zero), k_255);
+		g = _mm_min_ps(_mm_max_ps(_mm_add_ps(g, off), zero), k_255);
+		b = _mm_min_ps(_mm_max_ps(_mm_add_ps(b, off), zero), k_255);
+		__m128i c = _mm_or_si128(_mm_set1_epi32(0xFF000000),
+			_mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(r), 16),
+			_mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(g), 8),
+			             _mm_cvttps_epi32(b))));
+		_mm_storeu_si128((__m128i *)&out[o], c);
+	}
+#endif
+
+	for (; o < n * n; ++o) {
+		int r, g, b;
+		color_conversion(L->base[o], cb->base[o], cr->base[o], &r, &g, &b);
+		out[o] = 0xFF000000 | (r << 16) | (g << 8) | b;
+	}
+
+	for (int yy = 0; yy < n; ++yy) {
+		for (int xx = 0; xx < n; ++xx) {
+			set_pixel((x * n + xx), (y * n + yy), out[yy * n + xx]);
 		}
 	}
 }
@@ -416,9 +506,9 @@ static void start_of_scan(FILE * f, int len) {
 	int old_lum = 0;
 	int old_crd = 0;
 	int old_cbd = 0;
-	for (int y = 0; y < sprite->height / 8 + !!(sprite->height & 0x7); ++y) {
+	for (int y = 0; y < jpeg_height / 8 + !!(jpeg_height & 0x7); ++y) {
 		TRACE("Star row %d", y );
-		for (int x = 0; x < sprite->width / 8 + !!(sprite->width & 0x7); ++x) {
+		for (int x = 0; x < jpeg_width / 8 + !!(jpeg_width & 0x7); ++x) {
 			if (y >= 134) {
 				TRACE("Start col %d", x);
 			}
@@ -439,23 +529,37 @@ static void start_of_scan(FILE * f, int len) {
 	TRACE("Done.");
 }
 
-int load_sprite_jpg(sprite_t * tsprite, char * filename) {
+/*
+ * Decode a JPEG at 1/(1 << shift) of its stored size. The reduction
+ * happens in the DCT domain - each scan still has to be entropy-decoded,
+ * but the transform and color conversion only produce the pixels that
+ * are kept, so decoding a thumbnail of a camera photo costs a fraction
+ * of a full-size decode.
+ */
+int load_sprite_jpg_scaled(sprite_t * tsprite, char * filename, int shift) {
 	FILE * f = fopen(filename, "r");
 	if (!f) {
 		return 1;
 	}
 
+	if (shift < 0) shift = 0;
+	if (shift > 3) shift = 3;
+	scale_shift = shift;
+	block_size = 8 >> shift;
+
 	sprite = tsprite;
 
 	memset(huffman_tables, 0, sizeof(huffman_tables));
 
-	if (premul[0][0][0][0] == 0.0) {
-		for (int n = 0; n < 8; ++n) {
-			for (int m = 0; m < 8; ++m) {
-				for (int y = 0; y < 8; ++y) {
-					for (int x = 0; x < 8; ++x) {
-						premul[n][m][y][x] = cosines[n][x] * cosines[m][y];
+	if (basis[0][0][0] == 0.0) {
+		for (int k = 0; k < 4; ++k) {
+			for (int u = 0; u < 8; ++u) {
+				for (int x = 0; x < (8 >> k); ++x) {
+					float s = 0.0;
+					for (int t = 0; t < (1 << k); ++t) {
+						s += cosines[u][(x << k) + t];
 					}
+					basis[k][u][x] = s / (1 << k);
 				}
 			}
 		}
@@ -510,3 +614,25 @@ int load_sprite_jpg(sprite_t * tsprite, char * filename) {
 
 	return 0;
 }
+
+int load_sprite_jpg(sprite_t * tsprite, char * filename) {
+	return load_sprite_jpg_scaled(tsprite, filename, 0);
+}
+
+/*
+ * Decode at whatever reduction keeps the output within the given
+ * bounds (or 1/8, whichever comes first). A viewer can pass the
+ * display size and never allocate or transform full-resolution
+ * pixels for a photo much bigger than the screen.
+ */
+int load_sprite_jpg_fit(sprite_t * tsprite, char * filename, int max_width, int max_height) {
+	if (max_width <= 0 || max_height <= 0) {
+		return load_sprite_jpg_scaled(tsprite, filename, 0);
+	}
+	fit_width = max_width;
+	fit_height = max_height;
+	int out = load_sprite_jpg_scaled(tsprite, filename, 0);
+	fit_width = 0;
+	fit_height = 0;
+	return out;
+}
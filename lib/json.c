@@ -22,6 +22,11 @@ struct JSON_Context {
 	const char * string;
 	int c;
 	const char * error;
+	/* Streaming interface */
+	json_stream_func_t func;
+	void * extra;
+	int depth;
+	int stop;
 };
 
 void json_free(Value * v) {
@@ -438,3 +443,346 @@ Value * json_parse_file(const char * filename) {
 	free(tmp);
 	return out;
 }
+
+/*
+ * Streaming interface. No tree is built: each syntactic element turns
+ * into one callback, strings and keys are handed over as slices into
+ * the input buffer with their escapes intact, and nothing is
+ * allocated during the parse.
+ */
+
+static int emit(struct JSON_Context * ctx, int event, const struct JSON_Slice * slice, double number) {
+	int r = ctx->func(event, slice, number, ctx->depth, ctx->extra);
+	if (r) ctx->stop = r;
+	return r;
+}
+
+/* Find the extent of a string without decoding it; the slice covers
+ * everything between the quotes. */
+static int scan_string(struct JSON_Context * ctx, struct JSON_Slice * slice) {
+	if (peek(ctx) != '"') {
+		ctx->error = "Expected string";
+		return -1;
+	}
+	advance(ctx);
+	slice->bytes = &ctx->string[ctx->c];
+	while (1) {
+		int ch = peek(ctx);
+		if (ch == 0) {
+			ctx->error = "Unexpected EOF in string";
+			return -1;
+		}
+		if (ch == '"') break;
+		if (ch == '\\') {
+			advance(ctx);
+			if (!peek(ctx)) {
+				ctx->error = "Unexpected EOF in string";
+				return -1;
+			}
+		}
+		advance(ctx);
+	}
+	slice->length = &ctx->string[ctx->c] - slice->bytes;
+	advance(ctx);
+	return 0;
+}
+
+static int scan_literal(struct JSON_Context * ctx, const char * lit) {
+	while (*lit) {
+		if (peek(ctx) != *lit) {
+			ctx->error = "Invalid literal";
+			return -1;
+		}
+		advance(ctx);
+		lit++;
+	}
+	return 0;
+}
+
+/* Same grammar as number(), but into a double rather than a Value. */
+static int scan_number(struct JSON_Context * ctx, double * result) {
+	double value = 0;
+	int sign = 1;
+	if (peek(ctx) == '-') {
+		sign = -1;
+		advance(ctx);
+	}
+
+	if (peek(ctx) == '0') {
+		advance(ctx);
+	} else if (isdigit(peek(ctx))) {
+		value = peek(ctx) - '0';
+		advance(ctx);
+		while (isdigit(peek(ctx))) {
+			value *= 10;
+			value += peek(ctx) - '0';
+			advance(ctx);
+		}
+	} else {
+		ctx->error = "Expected digit";
+		return -1;
+	}
+
+	if (peek(ctx) == '.') {
+		advance(ctx);
+		double multiplier = 0.1;
+		if (!isdigit(peek(ctx))) {
+			ctx->error = "Expected digit";
+			return -1;
+		}
+		while (isdigit(peek(ctx))) {
+			value += multiplier * (peek(ctx) - '0');
+			multiplier *= 0.1;
+			advance(ctx);
+		}
+	}
+
+	if (peek(ctx) == 'e' || peek(ctx) == 'E') {
+		int exp_sign = 1;
+		advance(ctx);
+		if (peek(ctx) == '+') advance(ctx);
+		else if (peek(ctx) == '-') {
+			exp_sign = -1;
+			advance(ctx);
+		}
+		if (!isdigit(peek(ctx))) {
+			ctx->error = "Expected digit";
+			return -1;
+		}
+		double exp = peek(ctx) - '0';
+		advance(ctx);
+		while (isdigit(peek(ctx))) {
+			exp *= 10;
+			exp += peek(ctx) - '0';
+			advance(ctx);
+		}
+		value = value * pow(10.0, exp * exp_sign);
+	}
+
+	*result = value * sign;
+	return 0;
+}
+
+static int stream_value(struct JSON_Context * ctx) {
+	whitespace(ctx);
+	int ch = peek(ctx);
+
+	if (ch == '"') {
+		struct JSON_Slice slice;
+		if (scan_string(ctx, &slice)) return -1;
+		if (emit(ctx, JSON_EVENT_STRING, &slice, 0)) return 0;
+	} else if (ch == '{') {
+		advance(ctx);
+		if (emit(ctx, JSON_EVENT_OBJECT_START, NULL, 0)) return 0;
+		ctx->depth++;
+		whitespace(ctx);
+		if (peek(ctx) == '}') {
+			advance(ctx);
+		} else while (1) {
+			whitespace(ctx);
+			struct JSON_Slice key;
+			if (scan_string(ctx, &key)) return -1;
+			if (emit(ctx, JSON_EVENT_KEY, &key, 0)) return 0;
+			whitespace(ctx);
+			if (peek(ctx) != ':') {
+				ctx->error = "Expected :";
+				return -1;
+			}
+			advance(ctx);
+			if (stream_value(ctx)) return -1;
+			if (ctx->stop) return 0;
+			if (peek(ctx) == '}') {
+				advance(ctx);
+				break;
+			}
+			if (peek(ctx) != ',') {
+				ctx->error = "Expected , or }";
+				return -1;
+			}
+			advance(ctx);
+		}
+		ctx->depth--;
+		if (emit(ctx, JSON_EVENT_OBJECT_END, NULL, 0)) return 0;
+	} else if (ch == '[') {
+		advance(ctx);
+		if (emit(ctx, JSON_EVENT_ARRAY_START, NULL, 0)) return 0;
+		ctx->depth++;
+		whitespace(ctx);
+		if (peek(ctx) == ']') {
+			advance(ctx);
+		} else while (1) {
+			if (stream_value(ctx)) return -1;
+			if (ctx->stop) return 0;
+			if (peek(ctx) == ']') {
+				advance(ctx);
+				break;
+			}
+			if (peek(ctx) != ',') {
+				ctx->error = "Expected , or ]";
+				return -1;
+			}
+			advance(ctx);
+		}
+		ctx->depth--;
+		if (emit(ctx, JSON_EVENT_ARRAY_END, NULL, 0)) return 0;
+	} else if (ch == '-' || isdigit(ch)) {
+		double num;
+		if (scan_number(ctx, &num)) return -1;
+		if (emit(ctx, JSON_EVENT_NUMBER, NULL, num)) return 0;
+	} else if (ch == 't') {
+		if (scan_literal(ctx, "true")) return -1;
+		if (emit(ctx, JSON_EVENT_BOOL, NULL, 1)) return 0;
+	} else if (ch == 'f') {
+		if (scan_literal(ctx, "false")) return -1;
+		if (emit(ctx, JSON_EVENT_BOOL, NULL, 0)) return 0;
+	} else if (ch == 'n') {
+		if (scan_literal(ctx, "null")) return -1;
+		if (emit(ctx, JSON_EVENT_NULL, NULL, 0)) return 0;
+	} else {
+		ctx->error = "Unexpected value";
+		return -1;
+	}
+
+	whitespace(ctx);
+	return 0;
+}
+
+int json_stream(const char * str, json_stream_func_t func, void * extra) {
+	struct JSON_Context ctx;
+	ctx.string = str;
+	ctx.c = 0;
+	ctx.error = NULL;
+	ctx.func = func;
+	ctx.extra = extra;
+	ctx.depth = 0;
+	ctx.stop = 0;
+	if (stream_value(&ctx)) return -1;
+	return ctx.stop;
+}
+
+int json_stream_file(const char * filename, json_stream_func_t func, void * extra) {
+	FILE * f = fopen(filename, "r");
+
+	if (!f) return -1;
+
+	fseek(f, 0, SEEK_END);
+	size_t size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	char * tmp = malloc(size + 1);
+	fread(tmp, size, 1, f);
+	tmp[size] = 0;
+
+	fclose(f);
+
+	int out = json_stream(tmp, func, extra);
+	free(tmp);
+	return out;
+}
+
+/* Bump allocator for the few values a streaming caller does keep;
+ * allocations only ever move a pointer forward, and everything goes
+ * away in one json_arena_free. */
+struct JSON_Block {
+	struct JSON_Block * next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+struct JSON_Arena {
+	struct JSON_Block * head;
+	size_t block_size;
+};
+
+static struct JSON_Block * block_create(size_t size) {
+	struct JSON_Block * block = malloc(sizeof(struct JSON_Block) + size);
+	block->next = NULL;
+	block->size = size;
+	block->used = 0;
+	return block;
+}
+
+struct JSON_Arena * json_arena_create(size_t block_size) {
+	struct JSON_Arena * arena = malloc(sizeof(struct JSON_Arena));
+	arena->block_size = block_size;
+	arena->head = block_create(block_size);
+	return arena;
+}
+
+void * json_arena_alloc(struct JSON_Arena * arena, size_t size) {
+	size = (size + 7) & ~(size_t)7;
+	if (arena->head->used + size > arena->head->size) {
+		struct JSON_Block * fresh = block_create(arena->block_size > size ? arena->block_size : size);
+		fresh->next = arena->head;
+		arena->head = fresh;
+	}
+	void * out = &arena->head->data[arena->head->used];
+	arena->head->used += size;
+	return out;
+}
+
+void json_arena_free(struct JSON_Arena * arena) {
+	struct JSON_Block * block = arena->head;
+	while (block) {
+		struct JSON_Block * next = block->next;
+		free(block);
+		block = next;
+	}
+	free(arena);
+}
+
+char * json_string_dup(struct JSON_Arena * arena, const struct JSON_Slice * slice) {
+	/* Decoding only ever shrinks, so the raw length bounds the output. */
+	char * out = json_arena_alloc(arena, slice->length + 1);
+	char * w = out;
+	const char * r = slice->bytes;
+	const char * end = slice->bytes + slice->length;
+
+	while (r < end) {
+		if (*r != '\\') {
+			*w++ = *r++;
+			continue;
+		}
+		r++;
+		if (r == end) return NULL;
+		switch (*r) {
+			case '"':  *w++ = '"';  break;
+			case '\\': *w++ = '\\'; break;
+			case '/':  *w++ = '/';  break;
+			case 'b':  *w++ = '\b'; break;
+			case 'f':  *w++ = '\f'; break;
+			case 'n':  *w++ = '\n'; break;
+			case 'r':  *w++ = '\r'; break;
+			case 't':  *w++ = '\t'; break;
+			case 'u': {
+				char hex_digits[5];
+				if (end - r < 5) return NULL;
+				for (int i = 0; i < 4; ++i) {
+					if (!isxdigit(r[1+i])) return NULL;
+					hex_digits[i] = r[1+i];
+				}
+				hex_digits[4] = 0;
+				uint32_t val = strtoul(hex_digits, NULL, 16);
+				if (val < 0x0080) {
+					*w++ = val;
+				} else if (val < 0x0800) {
+					*w++ = 0xC0 | (val >> 6);
+					*w++ = 0x80 | (val & 0x3F);
+				} else {
+					*w++ = 0xE0 | (val >> 12);
+					*w++ = 0x80 | ((val >> 6) & 0x3F);
+					*w++ = 0x80 | (val & 0x3F);
+				}
+				r += 4;
+				break;
+			}
+			default:
+				return NULL;
+		}
+		r++;
+	}
+
+	*w = 0;
+	return out;
+}
@@ -242,6 +242,9 @@ static KrkValue _yutani_init(int argc, KrkValue argv[], int hasKw) {
 	yctxInstance = self;
 	krk_attachNamedObject(&module->fields, "_yutani_t", (KrkObj*)self);
 
+	/* Event pool for drain(); lives in a field so the GC tracks it. */
+	krk_attachNamedValue(&self->fields, "_events", krk_list_of(0,NULL,0));
+
 	return argv[0];
 }
 
@@ -293,6 +296,48 @@ static KrkValue _yutani_wait_for(int argc, KrkValue argv[], int hasKw) {
 	return krk_pop();
 }
 
+/**
+ * Drain all pending events into a reused list of reused Message objects.
+ *
+ * Returns a list of every event currently queued, without blocking. The
+ * list and the Message instances in it belong to the context and are
+ * recycled by the next call to drain(), so callers must finish with (or
+ * copy out of) each event before draining again.
+ */
+static KrkValue _yutani_drain(int argc, KrkValue argv[], int hasKw) {
+	CHECK_YUTANI();
+
+	KrkValue list = NONE_VAL();
+	krk_tableGet(&self->fields, OBJECT_VAL(S("_events")), &list);
+	if (IS_NONE(list) || !krk_isInstanceOf(list, vm.baseClasses->listClass))
+		return krk_runtimeError(vm.exceptions->baseException, "Failed to get event pool?");
+
+	size_t count = 0;
+	yutani_msg_t * result;
+	while ((result = yutani_poll_async(self->yctx))) {
+		struct MessageClass * out;
+		if (count < AS_LIST(list)->count) {
+			/* Recycle the Message already at this position. */
+			out = (struct MessageClass*)AS_INSTANCE(AS_LIST(list)->values[count]);
+			free(out->msg);
+		} else {
+			out = (struct MessageClass*)krk_newInstance(Message);
+			krk_push(OBJECT_VAL(out));
+			krk_writeValueArray(AS_LIST(list), OBJECT_VAL(out));
+			krk_pop();
+		}
+		out->msg = result;
+		krk_attachNamedValue(&out->inst.fields, "type", INTEGER_VAL(result->type));
+		count++;
+	}
+
+	/* Truncate to what we actually drained; any Messages past the end
+	 * fall to the garbage collector, which frees their payloads. */
+	AS_LIST(list)->count = count;
+
+	return list;
+}
+
 static KrkValue _yutani_subscribe(int argc, KrkValue argv[], int hasKw) {
 	CHECK_YUTANI();
 	yutani_subscribe_windows(self->yctx);
@@ -1243,6 +1288,7 @@ KrkValue krk_module_onload__yutani(void) {
 	krk_defineNative(&Yutani->methods, "__init__", _yutani_init);
 	krk_defineNative(&Yutani->methods, "poll", _yutani_poll);
 	krk_defineNative(&Yutani->methods, "wait_for", _yutani_wait_for);
+	krk_defineNative(&Yutani->methods, "drain", _yutani_drain);
 	krk_defineNative(&Yutani->methods, "subscribe", _yutani_subscribe);
 	krk_defineNative(&Yutani->methods, "unsubscribe", _yutani_unsubscribe);
 	krk_defineNative(&Yutani->methods, "query_windows", _yutani_query_windows);
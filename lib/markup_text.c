@@ -10,11 +10,13 @@
 #include <toaru/list.h>
 #include <toaru/graphics.h>
 #include <toaru/text.h>
+#include <toaru/markup_text.h>
 
 static struct TT_Font * dejaVuSans = NULL;
 static struct TT_Font * dejaVuSans_Bold = NULL;
 static struct TT_Font * dejaVuSans_Oblique = NULL;
 static struct TT_Font * dejaVuSans_BoldOblique = NULL;
+static struct TT_Font * dejaVuSansMono = NULL;
 
 struct MarkupState {
 	list_t * state;
@@ -26,19 +28,63 @@ struct MarkupState {
 	gfx_context_t * ctx;
 	int max_cursor_x;
 	list_t * colors;
+	/* Layout construction; NULL for the immediate draw/measure paths */
+	struct MarkupLayout * layout;
+	char * word;
+	int word_len;
+	int word_alloc;
 };
 
 #define STATE_BOLD     (1 << 0)
 #define STATE_OBLIQUE  (1 << 1)
 #define STATE_HEADING  (1 << 2)
 #define STATE_SMALL    (1 << 3)
+#define STATE_MONO     (1 << 4)
+
+/* One measured word (or, with a NULL text, an explicit line break). */
+struct MarkupRun {
+	char * text;
+	int state;
+	int size;
+	int width;   /* measured when the run was made */
+	int space;   /* width of a space in this run's font */
+	int height;  /* line advance this run asks for */
+	int custom;  /* use our color rather than the caller's */
+	uint32_t color;
+};
+
+struct MarkupLine {
+	int first;   /* index of this line's first run */
+	int count;   /* runs on this line, including a trailing break */
+	int y;
+	int height;
+	int width;
+};
+
+struct MarkupLayout {
+	struct MarkupRun * runs;
+	int run_count;
+	int run_alloc;
+	struct MarkupLine * lines;
+	int line_count;
+	int line_alloc;
+	int layout_width; /* width the lines were broken for; -1 = never */
+	int dirty_from;   /* first run the lines don't cover; -1 = clean */
+	int height;
+	int max_width;
+};
+
+static void layout_flush_word(struct MarkupState * state);
+static void layout_push_break(struct MarkupState * state);
 
 static void push_state(struct MarkupState * state, int val) {
+	if (state->layout) layout_flush_word(state);
 	list_insert(state->state, (void*)(uintptr_t)state->current_state);
 	state->current_state |= val;
 }
 
 static void pop_state(struct MarkupState * state) {
+	if (state->layout) layout_flush_word(state);
 	node_t * nstate = list_pop(state->state);
 	state->current_state = (int)(uintptr_t)nstate->value;
 	free(nstate);
@@ -64,13 +110,21 @@ static int parser_open(struct markup_state * self, void * user, struct markup_ta
 		push_state(state, STATE_HEADING);
 	} else if (!strcmp(tag->name, "small")) {
 		push_state(state, STATE_SMALL);
+	} else if (!strcmp(tag->name, "mono")) {
+		push_state(state, STATE_MONO);
 	} else if (!strcmp(tag->name, "br")) {
-		state->cursor_x = state->initial_left;
-		state->cursor_y += 20; /* state->line_height? */
+		if (state->layout) {
+			layout_flush_word(state);
+			layout_push_break(state);
+		} else {
+			state->cursor_x = state->initial_left;
+			state->cursor_y += 20; /* state->line_height? */
+		}
 	} else if (!strcmp(tag->name, "color")) {
 		/* get options */
 		list_t * args = hashmap_keys(tag->options);
 		if (args->length == 1) {
+			if (state->layout) layout_flush_word(state);
 			list_insert(state->colors, (void*)(uintptr_t)state->color);
 			state->color = parseColor((char*)args->head->value);
 		}
@@ -87,10 +141,18 @@ static int parser_close(struct markup_state * self, void * user, char * tag_name
 	} else if (!strcmp(tag_name, "i")) {
 		pop_state(state);
 	} else if (!strcmp(tag_name, "h1")) {
+		if (state->layout) {
+			/* A heading ends its line */
+			layout_flush_word(state);
+			layout_push_break(state);
+		}
 		pop_state(state);
 	} else if (!strcmp(tag_name, "small")) {
 		pop_state(state);
+	} else if (!strcmp(tag_name, "mono")) {
+		pop_state(state);
 	} else if (!strcmp(tag_name, "color")) {
+		if (state->layout) layout_flush_word(state);
 		node_t * ncolor = list_pop(state->colors);
 		state->color = (uint32_t)(uintptr_t)ncolor->value;
 		free(ncolor);
@@ -98,24 +160,88 @@ static int parser_close(struct markup_state * self, void * user, char * tag_name
 	return 0;
 }
 
-static struct TT_Font * fontForState(struct MarkupState * state) {
-	if (state->current_state & (1 << 0)) {
-		if (state->current_state & (1 << 1)) {
+static struct TT_Font * fontForBits(int bits) {
+	if (bits & STATE_MONO) {
+		return dejaVuSansMono;
+	}
+	if (bits & STATE_BOLD) {
+		if (bits & STATE_OBLIQUE) {
 			return dejaVuSans_BoldOblique;
 		}
 		return dejaVuSans_Bold;
-	} else if (state->current_state & (1 << 1)) {
+	} else if (bits & STATE_OBLIQUE) {
 		return dejaVuSans_Oblique;
 	}
 	return dejaVuSans;
 }
 
-static int sizeForState(struct MarkupState * state) {
-	if (state->current_state & STATE_HEADING) return 18;
-	if (state->current_state & STATE_SMALL) return 10;
+static struct TT_Font * fontForState(struct MarkupState * state) {
+	return fontForBits(state->current_state);
+}
+
+static int sizeForBits(int bits) {
+	if (bits & STATE_HEADING) return 18;
+	if (bits & STATE_SMALL) return 10;
 	return 13;
 }
 
+static int sizeForState(struct MarkupState * state) {
+	return sizeForBits(state->current_state);
+}
+
+static int lineHeightForBits(int bits) {
+	return (bits & STATE_HEADING) ? 28 : 20;
+}
+
+static struct MarkupRun * layout_add_run(struct MarkupLayout * layout) {
+	if (layout->run_count == layout->run_alloc) {
+		layout->run_alloc = layout->run_alloc ? layout->run_alloc * 2 : 64;
+		layout->runs = realloc(layout->runs, layout->run_alloc * sizeof(struct MarkupRun));
+	}
+	return &layout->runs[layout->run_count++];
+}
+
+/* Turn the accumulated word into a run, measuring it now so reflow
+ * and render never have to. */
+static void layout_flush_word(struct MarkupState * state) {
+	if (!state->word_len) return;
+	state->word[state->word_len] = '\0';
+	state->word_len = 0;
+
+	struct TT_Font * font = fontForState(state);
+	tt_set_size(font, sizeForState(state));
+
+	struct MarkupRun * run = layout_add_run(state->layout);
+	run->text   = strdup(state->word);
+	run->state  = state->current_state;
+	run->size   = sizeForState(state);
+	run->width  = tt_string_width(font, run->text);
+	run->space  = tt_string_width(font, " ");
+	run->height = lineHeightForBits(state->current_state);
+	run->custom = state->colors->length > 0;
+	run->color  = state->color;
+}
+
+static void layout_push_break(struct MarkupState * state) {
+	struct MarkupRun * run = layout_add_run(state->layout);
+	run->text   = NULL;
+	run->state  = state->current_state;
+	run->size   = sizeForState(state);
+	run->width  = 0;
+	run->space  = 0;
+	run->height = lineHeightForBits(state->current_state);
+	run->custom = 0;
+	run->color  = 0;
+}
+
+static void layout_word_char(struct MarkupState * state, int chr) {
+	if (state->word_len + 2 > state->word_alloc) {
+		state->word_alloc = state->word_alloc ? state->word_alloc * 2 : 32;
+		state->word = realloc(state->word, state->word_alloc);
+	}
+	state->word[state->word_len++] = chr;
+}
+
 static int parser_data(struct markup_state * self, void * user, char * data) {
 	struct MarkupState * state = (struct MarkupState*)user;
 	struct TT_Font * font = fontForState(state);
@@ -135,7 +261,7 @@ static int parser_dryrun(struct markup_state * self, void * user, char * data) {
 }
 
 int markup_string_width(const char * str) {
-	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create()};
+	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create(), NULL, NULL, 0, 0};
 	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_dryrun);
 	while (*str) {
 		if (markup_parse(parser, *str++)) {
@@ -149,7 +275,7 @@ int markup_string_width(const char * str) {
 }
 
 int markup_string_height(const char * str) {
-	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create()};
+	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create(), NULL, NULL, 0, 0};
 	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_dryrun);
 	while (*str) {
 		if (markup_parse(parser, *str++)) {
@@ -163,7 +289,7 @@ int markup_string_height(const char * str) {
 }
 
 int markup_draw_string(gfx_context_t * ctx, int x, int y, const char * str, uint32_t color) {
-	struct MarkupState state = {list_create(), 0, x, y, x, color, ctx, x, list_create()};
+	struct MarkupState state = {list_create(), 0, x, y, x, color, ctx, x, list_create(), NULL, NULL, 0, 0};
 	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_data);
 	while (*str) {
 		if (markup_parse(parser, *str++)) {
@@ -176,10 +302,189 @@ int markup_draw_string(gfx_context_t * ctx, int x, int y, const char * str, uint
 	return state.max_cursor_x - state.initial_left;
 }
 
+static int parser_layout_data(struct markup_state * self, void * user, char * data) {
+	struct MarkupState * state = (struct MarkupState*)user;
+	for (char * c = data; *c; c++) {
+		int chr = *c;
+		if (chr == '&') {
+			if (c[1] == 'l' && c[2] == 't' && c[3] == ';') { chr = '<'; c += 3; }
+			else if (c[1] == 'g' && c[2] == 't' && c[3] == ';') { chr = '>'; c += 3; }
+			else if (c[1] == 'a' && c[2] == 'm' && c[3] == 'p' && c[4] == ';') { chr = '&'; c += 4; }
+		}
+		if (chr == '\n') {
+			layout_flush_word(state);
+			if (state->current_state & STATE_MONO) {
+				/* Mono text keeps its line structure */
+				layout_push_break(state);
+			}
+		} else if (chr == ' ' && !(state->current_state & STATE_MONO)) {
+			layout_flush_word(state);
+		} else {
+			layout_word_char(state, chr);
+		}
+	}
+	return 0;
+}
+
+struct MarkupLayout * markup_layout_create(const char * str) {
+	struct MarkupLayout * layout = malloc(sizeof(struct MarkupLayout));
+	layout->runs = NULL;
+	layout->run_count = 0;
+	layout->run_alloc = 0;
+	layout->lines = NULL;
+	layout->line_count = 0;
+	layout->line_alloc = 0;
+	layout->layout_width = -1;
+	layout->dirty_from = 0;
+	layout->height = 0;
+	layout->max_width = 0;
+	if (str) markup_layout_append(layout, str);
+	return layout;
+}
+
+void markup_layout_append(struct MarkupLayout * layout, const char * str) {
+	struct MarkupState state = {list_create(), 0, 0, 0, 0, 0, NULL, 0, list_create(), layout, NULL, 0, 0};
+	int first_new = layout->run_count;
+
+	struct markup_state * parser = markup_init(&state, parser_open, parser_close, parser_layout_data);
+	while (*str) {
+		if (markup_parse(parser, *str++)) {
+			break;
+		}
+	}
+	markup_finish(parser);
+	layout_flush_word(&state);
+	list_free(state.state);
+	list_free(state.colors);
+	free(state.word);
+
+	if (layout->dirty_from < 0 || layout->dirty_from > first_new) {
+		layout->dirty_from = first_new;
+	}
+}
+
+static struct MarkupLine * layout_add_line(struct MarkupLayout * layout) {
+	if (layout->line_count == layout->line_alloc) {
+		layout->line_alloc = layout->line_alloc ? layout->line_alloc * 2 : 64;
+		layout->lines = realloc(layout->lines, layout->line_alloc * sizeof(struct MarkupLine));
+	}
+	return &layout->lines[layout->line_count++];
+}
+
+void markup_layout_reflow(struct MarkupLayout * layout, int width) {
+	if (layout->layout_width == width && layout->dirty_from < 0) return;
+
+	int start_line = 0;
+	if (layout->layout_width == width && layout->dirty_from >= 0) {
+		/* Same width and a clean prefix: keep every line that ends
+		 * before the first changed run, and redo the one before it
+		 * too, since it may absorb part of what changed. */
+		while (start_line < layout->line_count &&
+		       layout->lines[start_line].first + layout->lines[start_line].count <= layout->dirty_from) {
+			start_line++;
+		}
+		if (start_line > 0) start_line--;
+	}
+
+	int run = 0;
+	int y = 0;
+	if (start_line < layout->line_count) {
+		run = layout->lines[start_line].first;
+	} else if (layout->line_count) {
+		run = layout->lines[layout->line_count-1].first + layout->lines[layout->line_count-1].count;
+	}
+	if (start_line > 0) {
+		y = layout->lines[start_line-1].y + layout->lines[start_line-1].height;
+	}
+	layout->line_count = start_line;
+	layout->max_width = 0;
+	for (int i = 0; i < start_line; ++i) {
+		if (layout->lines[i].width > layout->max_width) layout->max_width = layout->lines[i].width;
+	}
+
+	int i = run;
+	while (i < layout->run_count) {
+		int first = i;
+		int count = 0;
+		int line_w = 0;
+		int line_h = 0;
+		while (i < layout->run_count) {
+			struct MarkupRun * r = &layout->runs[i];
+			if (!r->text) {
+				/* An explicit break belongs to the line it ends. */
+				if (line_h < r->height) line_h = r->height;
+				count++;
+				i++;
+				break;
+			}
+			int gap = line_w ? layout->runs[i-1].space : 0;
+			if (width > 0 && line_w && line_w + gap + r->width > width) break;
+			line_w += gap + r->width;
+			if (line_h < r->height) line_h = r->height;
+			count++;
+			i++;
+		}
+		if (!line_h) line_h = 20;
+
+		struct MarkupLine * line = layout_add_line(layout);
+		line->first = first;
+		line->count = count;
+		line->y = y;
+		line->height = line_h;
+		line->width = line_w;
+
+		y += line_h;
+		if (line_w > layout->max_width) layout->max_width = line_w;
+	}
+
+	layout->height = y;
+	layout->layout_width = width;
+	layout->dirty_from = -1;
+}
+
+int markup_layout_height(struct MarkupLayout * layout) {
+	return layout->height;
+}
+
+int markup_layout_width(struct MarkupLayout * layout) {
+	return layout->max_width;
+}
+
+void markup_layout_render(gfx_context_t * ctx, struct MarkupLayout * layout, int x, int y, int y_min, int y_max, uint32_t color) {
+	for (int li = 0; li < layout->line_count; ++li) {
+		struct MarkupLine * line = &layout->lines[li];
+		if (line->y + line->height <= y_min) continue;
+		if (line->y >= y_max) break;
+		int cx = x;
+		int placed = 0;
+		for (int i = line->first; i < line->first + line->count; ++i) {
+			struct MarkupRun * r = &layout->runs[i];
+			if (!r->text) continue;
+			if (placed) cx += layout->runs[i-1].space;
+			struct TT_Font * font = fontForBits(r->state);
+			tt_set_size(font, r->size);
+			tt_draw_string(ctx, font, cx, y + line->y + r->size, r->text, r->custom ? r->color : color);
+			cx += r->width;
+			placed = 1;
+		}
+	}
+}
+
+void markup_layout_free(struct MarkupLayout * layout) {
+	for (int i = 0; i < layout->run_count; ++i) {
+		free(layout->runs[i].text);
+	}
+	free(layout->runs);
+	free(layout->lines);
+	free(layout);
+}
+
 void markup_text_init(void) {
+	if (dejaVuSans) return;
 	dejaVuSans             = tt_font_from_shm("sans-serif");
 	dejaVuSans_Bold        = tt_font_from_shm("sans-serif.bold");
 	dejaVuSans_Oblique     = tt_font_from_shm("sans-serif.italic");
 	dejaVuSans_BoldOblique = tt_font_from_shm("sans-serif.bolditalic");
+	dejaVuSansMono         = tt_font_from_shm("monospace");
 }
 
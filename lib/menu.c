@@ -271,6 +271,7 @@ void menu_update_title(struct MenuEntry * self, char * new_title) {
 		}
 		_self->title = strdup(new_title);
 		_self->rwidth = 50 + string_width(_self->title);
+		if (self->_owner) self->_owner->generation++;
 	} else if (self->_type == MenuEntry_Submenu) {
 		struct MenuEntry_Submenu * _self = (struct MenuEntry_Submenu *)self;
 		if (_self->title) {
@@ -278,6 +279,7 @@ void menu_update_title(struct MenuEntry * self, char * new_title) {
 		}
 		_self->title = strdup(new_title);
 		_self->rwidth = 50 + string_width(_self->title);
+		if (self->_owner) self->_owner->generation++;
 	}
 }
 
@@ -298,6 +300,7 @@ void menu_update_icon(struct MenuEntry * self, char * newIcon) {
 		default:
 			break;
 	}
+	if (self->_owner) self->_owner->generation++;
 }
 
 void menu_free_entry(struct MenuEntry * self) {
@@ -394,6 +397,7 @@ struct MenuList * menu_set_get_menu(struct MenuSet * menu, char * submenu) {
 void menu_insert(struct MenuList * menu, struct MenuEntry * entry) {
 	list_insert(menu->entries, entry);
 	entry->_owner = menu;
+	menu->generation++;
 }
 
 struct MenuList * menu_create(void) {
@@ -408,6 +412,9 @@ struct MenuList * menu_create(void) {
 	p->closed = 1;
 	p->flags = 0;
 	p->tail_offset = 0;
+	p->backing = NULL;
+	p->generation = 0;
+	p->backing_generation = -1;
 	return p;
 }
 
@@ -524,10 +531,91 @@ failure:
 	return NULL;
 }
 
+/*
+ * The chrome and the unhighlighted render of the stock entry types
+ * are retained in menu->backing across redraws and across close/open
+ * cycles, so reopening a menu is a blit rather than a trip through
+ * the text renderer for every item. Custom entries (the clock, the
+ * volume slider) draw whatever they like whenever they like, so they
+ * stay out of the cache and are rendered on every pass.
+ */
+static int _entry_is_cacheable(struct MenuEntry * entry) {
+	return entry->vtable == &_menu_vtable_MenuEntry_Normal ||
+	       entry->vtable == &_menu_vtable_MenuEntry_Submenu ||
+	       entry->vtable == &_menu_vtable_MenuEntry_Separator;
+}
+
+static int _entry_needs_overlay(struct MenuEntry * entry) {
+	if (!_entry_is_cacheable(entry)) return 1;
+	if (entry->hilight) return 1;
+	if (entry->_type == MenuEntry_Submenu) {
+		/* Submenus draw highlighted while their child is open */
+		struct MenuEntry_Submenu * _self = (struct MenuEntry_Submenu *)entry;
+		if (_self->_owner && _self->_my_child && _self->_owner->child == _self->_my_child) return 1;
+	}
+	return 0;
+}
+
+static int _menu_backing_is_valid(struct MenuList * menu) {
+	return menu->backing &&
+		menu->backing_generation == menu->generation &&
+		menu->backing->width == menu->ctx->width &&
+		menu->backing->height == menu->ctx->height;
+}
+
+/* Copy rows of the retained render back into the backbuffer; a plain
+ * copy, since draw_sprite's opaque path would clobber the alpha that
+ * bubble menus rely on. */
+static void _menu_restore_backing(struct MenuList * menu, int y, int h) {
+	gfx_context_t * ctx = menu->ctx;
+	if (y < 0) { h += y; y = 0; }
+	if (y + h > ctx->height) h = ctx->height - y;
+	for (int i = y; i < y + h; ++i) {
+		memcpy(&ctx->backbuffer[i * GFX_S(ctx)], &menu->backing->bitmap[i * ctx->width], ctx->width * sizeof(uint32_t));
+	}
+}
+
+static void _menu_snapshot_backing(struct MenuList * menu) {
+	gfx_context_t * ctx = menu->ctx;
+	if (menu->backing && (menu->backing->width != ctx->width || menu->backing->height != ctx->height)) {
+		sprite_free(menu->backing);
+		menu->backing = NULL;
+	}
+	if (!menu->backing) {
+		menu->backing = create_sprite(ctx->width, ctx->height, ALPHA_OPAQUE);
+	}
+	for (int i = 0; i < ctx->height; ++i) {
+		memcpy(&menu->backing->bitmap[i * ctx->width], &ctx->backbuffer[i * GFX_S(ctx)], ctx->width * sizeof(uint32_t));
+	}
+	menu->backing_generation = menu->generation;
+}
+
 static void _menu_redraw(yutani_window_t * menu_window, yutani_t * yctx, struct MenuList * menu, int expose) {
 
 	gfx_context_t * ctx = menu->ctx;
 	list_t * entries = menu->entries;
+
+	if (_menu_backing_is_valid(menu)) {
+		/* Start from the retained render; entry offsets were recorded
+		 * when it was drawn and nothing has moved since. */
+		_menu_restore_backing(menu, 0, ctx->height);
+
+		int offset = (menu->flags & MENU_FLAG_BUBBLE) ? 12 : 4;
+		foreach(node, entries) {
+			struct MenuEntry * entry = node->value;
+			if (entry->vtable->methods >= 1 && entry->vtable->renderer && _entry_needs_overlay(entry)) {
+				entry->vtable->renderer(ctx, entry, offset);
+			}
+			offset += entry->height;
+		}
+
+		flip(ctx);
+		if (expose) {
+			yutani_flip(yctx, menu_window);
+		}
+		return;
+	}
+
 	/* Window background */
 	if (menu->flags & MENU_FLAG_BUBBLE) {
 		draw_fill(ctx, rgba(0,0,0,0));
@@ -562,11 +650,30 @@ static void _menu_redraw(yutani_window_t * menu_window, yutani_t * yctx, struct
 		draw_line(ctx, 0, ctx->width-1, ctx->height-1, ctx->height-1, rgb(109,111,112));
 	}
 
-	/* Draw menu entries */
+	/* Draw menu entries: the retained pass, with highlights forced
+	 * off and custom entries left as bare background. */
 	int offset = (menu->flags & MENU_FLAG_BUBBLE) ? 12 : 4;
 	foreach(node, entries) {
 		struct MenuEntry * entry = node->value;
-		if (entry->vtable->methods >= 1 && entry->vtable->renderer) {
+		if (entry->vtable->methods >= 1 && entry->vtable->renderer && _entry_is_cacheable(entry)) {
+			int h = entry->hilight;
+			entry->hilight = 0;
+			entry->vtable->renderer(ctx, entry, offset);
+			entry->hilight = h;
+		} else {
+			entry->offset = offset;
+		}
+
+		offset += entry->height;
+	}
+
+	_menu_snapshot_backing(menu);
+
+	/* And whatever is highlighted or dynamic goes on top. */
+	offset = (menu->flags & MENU_FLAG_BUBBLE) ? 12 : 4;
+	foreach(node, entries) {
+		struct MenuEntry * entry = node->value;
+		if (entry->vtable->methods >= 1 && entry->vtable->renderer && _entry_needs_overlay(entry)) {
 			entry->vtable->renderer(ctx, entry, offset);
 		}
 
@@ -580,6 +687,28 @@ static void _menu_redraw(yutani_window_t * menu_window, yutani_t * yctx, struct
 	}
 }
 
+/* Redraw just one entry's rows from the retained render; returns 0 if
+ * there is no usable backing, in which case the caller should fall
+ * back to a full redraw. */
+static int _menu_update_entry(struct MenuList * menu, struct MenuEntry * entry, int offset) {
+	if (!_menu_backing_is_valid(menu)) return 0;
+
+	gfx_context_t * ctx = menu->ctx;
+
+	_menu_restore_backing(menu, offset, entry->height);
+
+	gfx_clear_clip(ctx);
+	gfx_add_clip(ctx, 0, offset, ctx->width, entry->height);
+	if (entry->vtable->methods >= 1 && entry->vtable->renderer && _entry_needs_overlay(entry)) {
+		entry->vtable->renderer(ctx, entry, offset);
+	}
+	flip(ctx);
+	gfx_no_clip(ctx);
+
+	yutani_flip_region(menu->window->ctx, menu->window, 0, offset, ctx->width, entry->height);
+	return 1;
+}
+
 void menu_prepare(struct MenuList * menu, yutani_t * yctx) {
 	/* Calculate window dimensions */
 	int height, width;
@@ -820,16 +949,31 @@ void menu_mouse_action(struct MenuList * menu, struct yutani_msg_window_mouse_ev
 
 	int offset = (menu->flags & MENU_FLAG_BUBBLE) ? 12 : 4;
 	int changed = 0;
+
+	/* Entries whose highlight toggled; updated after the loop so
+	 * focus changes (opening and closing submenus) have settled. */
+	struct { struct MenuEntry * entry; int offset; } dirty[8];
+	int dirty_count = 0;
+	#define mark_dirty(e,o) do { \
+		if (dirty_count < 8) { \
+			dirty[dirty_count].entry = e; \
+			dirty[dirty_count].offset = o; \
+			dirty_count++; \
+		} else { \
+			changed = 1; \
+		} \
+	} while (0)
+
 	foreach(node, menu->entries) {
 		struct MenuEntry * entry = node->value;
 		if (me->new_y >= offset && me->new_y < offset + entry->height &&
 				me->new_x >= 0 && me->new_x < entry->width) {
 			if (!entry->hilight) {
-				changed = 1;
 				entry->hilight = 1;
 				if (entry->vtable->methods >= 2 && entry->vtable->focus_change) {
 					entry->vtable->focus_change(entry, 1);
 				}
+				mark_dirty(entry, offset);
 			}
 			if (entry->vtable->methods >= 4 && entry->vtable->mouse_event) {
 				if (entry->vtable->mouse_event(entry, me)) {
@@ -842,17 +986,29 @@ void menu_mouse_action(struct MenuList * menu, struct yutani_msg_window_mouse_ev
 			}
 		} else {
 			if (entry->hilight) {
-				changed = 1;
 				entry->hilight = 0;
 				if (entry->vtable->methods >= 2 && entry->vtable->focus_change) {
 					entry->vtable->focus_change(entry, 0);
 				}
+				mark_dirty(entry, offset);
 			}
 		}
 		offset += entry->height;
 	}
+	#undef mark_dirty
+
+	if (menu->closed || !menu->window) return;
+
 	if (changed) {
 		_menu_redraw(window,yctx,menu,1);
+	} else {
+		for (int i = 0; i < dirty_count; ++i) {
+			if (!_menu_update_entry(menu, dirty[i].entry, dirty[i].offset)) {
+				/* No retained render to patch; draw everything. */
+				_menu_redraw(window,yctx,menu,1);
+				break;
+			}
+		}
 	}
 }
 
@@ -85,6 +85,7 @@ static int widget_update_clock(struct PanelWidget * this) {
 	if (clockmenu && clockmenu->window) {
 		menu_force_redraw(clockmenu);
 	}
+	this->dirty = 1; /* The seconds display changes every tick */
 	return 0;
 }
 
@@ -100,6 +101,7 @@ struct PanelWidget * widget_init_clock(void) {
 	widget->draw = widget_draw_clock;
 	widget->click = widget_click_clock;
 	widget->update = widget_update_clock;
+	widget->interval = 1;
 	list_insert(widgets_enabled, widget);
 	return widget;
 }
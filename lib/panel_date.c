@@ -179,8 +179,11 @@ static int widget_click_date(struct PanelWidget * this, struct yutani_msg_window
 
 static int widget_update_date(struct PanelWidget * this) {
 	int width_before = date_widget_width;
+	char date_before[80];
+	memcpy(date_before, date, 80);
 	update_date_widget();
 	this->width = date_widget_width;
+	if (strcmp(date_before, date)) this->dirty = 1; /* It's a new day */
 	return width_before != date_widget_width;
 }
 
@@ -194,6 +197,7 @@ struct PanelWidget * widget_init_date(void) {
 	widget->draw = widget_draw_date;
 	widget->click = widget_click_date;
 	widget->update = widget_update_date;
+	widget->interval = 10;
 	list_insert(widgets_enabled, widget);
 	return widget;
 }
@@ -95,6 +95,14 @@ _netif_next:
 }
 
 static int widget_update_network(struct PanelWidget * this) {
+	int status_before = network_status;
+
+	/* Consume the state-change notification that woke us */
+	if (this->fd >= 0) {
+		uint64_t generation;
+		read(this->fd, &generation, sizeof(generation));
+	}
+
 	network_status = 0;
 	netstat_count = 0;
 
@@ -109,6 +117,8 @@ static int widget_update_network(struct PanelWidget * this) {
 	}
 
 	closedir(d);
+
+	if (network_status != status_before) this->dirty = 1;
 	return 0;
 }
 
@@ -160,6 +170,13 @@ struct PanelWidget * widget_init_network(void) {
 	widget->draw = widget_draw_network;
 	widget->click = widget_click_network;
 	widget->update = widget_update_network;
+
+	/* The kernel pushes link and address changes through /dev/netstate,
+	 * so we only rescan interfaces when something actually happened;
+	 * fall back to polling on kernels without it. */
+	widget->fd = open("/dev/netstate", O_RDONLY);
+	if (widget->fd < 0) widget->interval = 2;
+
 	list_insert(widgets_enabled, widget);
 	return widget;
 }
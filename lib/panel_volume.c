@@ -36,7 +36,11 @@ static int widget_update_volume(struct PanelWidget * this) {
 	value.id     = VOLUME_KNOB_ID;   /* TODO this too */
 
 	ioctl(mixer, SND_MIXER_READ_KNOB, &value);
-	volume_level = value.val;
+	if (volume_level != (long)value.val) {
+		/* Someone else moved the knob */
+		volume_level = value.val;
+		this->dirty = 1;
+	}
 
 	return 0;
 }
@@ -226,6 +230,7 @@ struct PanelWidget * widget_init_volume(void) {
 	widget->click = widget_click_volume;
 	widget->move  = widget_move_volume;
 	widget->update = widget_update_volume;
+	widget->interval = 2;
 	list_insert(widgets_enabled, widget);
 	return widget;
 }
@@ -1,6 +1,7 @@
 /**
  * @brief Panel Weather Widget
  */
+#include <sys/stat.h>
 #include <toaru/yutani.h>
 #include <toaru/yutani-internal.h>
 #include <toaru/graphics.h>
@@ -30,8 +31,11 @@ static sprite_t * weather_icon = NULL;
 static int widgets_weather_enabled = 0;
 
 static int widget_update_weather(struct PanelWidget * this) {
-	FILE * f = fopen("/tmp/weather-parsed.conf","r");
-	if (!f) {
+	static time_t last_mtime = 0;
+
+	struct stat statbuf;
+	if (stat("/tmp/weather-parsed.conf", &statbuf)) {
+		last_mtime = 0;
 		weather_status_valid = 0;
 		if (widgets_weather_enabled) {
 			widgets_weather_enabled = 0;
@@ -41,7 +45,15 @@ static int widget_update_weather(struct PanelWidget * this) {
 		return 0;
 	}
 
+	/* Only reparse when the weather tool has written something new */
+	if (statbuf.st_mtime == last_mtime) return 0;
+	last_mtime = statbuf.st_mtime;
+
+	FILE * f = fopen("/tmp/weather-parsed.conf","r");
+	if (!f) return 0;
+
 	weather_status_valid = 1;
+	this->dirty = 1;
 
 	if (weather_title_str) free(weather_title_str);
 	if (weather_updated_str) free(weather_updated_str);
@@ -190,6 +202,7 @@ struct PanelWidget * widget_init_weather(void) {
 	widget->draw = widget_draw_weather;
 	widget->click = widget_click_weather;
 	widget->update = widget_update_weather;
+	widget->interval = 10;
 	list_insert(widgets_enabled, widget);
 	return widget;
 }
@@ -18,17 +18,22 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/shm.h>
 
 #include <toaru/pex.h>
 
 size_t pex_send(FILE * sock, uintptr_t rcpt, size_t size, char * blob) {
 	assert(size <= MAX_PACKET_SIZE);
-	pex_header_t * broadcast = malloc(sizeof(pex_header_t) + size);
-	broadcast->target = rcpt;
-	memcpy(broadcast->data, blob, size);
-	size_t out = write(fileno(sock), broadcast, sizeof(pex_header_t) + size);
-	free(broadcast);
-	return out;
+	/* The header and payload go out as one gathered write, so the
+	 * exchange still sees a single packet and we skip assembling a
+	 * temporary copy of the blob. */
+	pex_header_t header = { .target = rcpt };
+	struct iovec iov[2] = {
+		{ &header, sizeof(pex_header_t) },
+		{ blob, size },
+	};
+	return writev(fileno(sock), iov, 2);
 }
 
 size_t pex_broadcast(FILE * sock, size_t size, char * blob) {
@@ -77,3 +82,73 @@ FILE * pex_bind(char * target) {
 size_t pex_query(FILE * sock) {
 	return ioctl(fileno(sock), IOCTL_PACKETFS_QUEUED, NULL);
 }
+
+pex_shm_ring_t * pex_shm_create(const char * name, size_t size) {
+	if (!size || strlen(name) >= sizeof(((pex_shm_ring_t*)0)->name)) return NULL;
+	size_t total = size + sizeof(pex_shm_ring_t);
+	pex_shm_ring_t * ring = shm_obtain(name, &total);
+	if (!ring || total <= sizeof(pex_shm_ring_t)) return NULL;
+	/* shm rounds up to whole pages; use everything we were given. */
+	ring->size = total - sizeof(pex_shm_ring_t);
+	ring->head = 0;
+	ring->tail = 0;
+	strcpy(ring->name, name);
+	__sync_synchronize();
+	ring->magic = PEX_SHM_MAGIC;
+	return ring;
+}
+
+pex_shm_ring_t * pex_shm_attach(const char * name) {
+	size_t size = 0;
+	pex_shm_ring_t * ring = shm_obtain(name, &size);
+	if (!ring || size < sizeof(pex_shm_ring_t) || ring->magic != PEX_SHM_MAGIC) return NULL;
+	return ring;
+}
+
+size_t pex_send_shm(FILE * sock, uintptr_t rcpt, pex_shm_ring_t * ring, size_t size, char * blob) {
+	if (!ring || size > ring->size) {
+		/* No ring, or the payload outgrows it: small messages keep
+		 * the ordinary copying path. */
+		if (size <= MAX_PACKET_SIZE) return pex_send(sock, rcpt, size, blob);
+		return 0;
+	}
+
+	/* Payloads are contiguous so the receiver can read them in place;
+	 * if this one would wrap, skip the tail of the ring. */
+	uint64_t head = ring->head;
+	size_t at = head % ring->size;
+	size_t skip = (at + size > ring->size) ? (ring->size - at) : 0;
+
+	/* Descriptors stay ordered through the exchange, so if the ring is
+	 * full the receiver just hasn't drained yet - give it a moment. */
+	while (head + skip + size - ring->tail > ring->size) {
+		usleep(100);
+	}
+
+	uint64_t offset = head + skip;
+	memcpy(ring->data + (offset % ring->size), blob, size);
+	__sync_synchronize();
+	ring->head = offset + size;
+
+	pex_shm_descriptor_t desc = { .magic = PEX_SHM_MAGIC, .size = size, .offset = offset };
+	strcpy(desc.name, ring->name);
+	if (!pex_send(sock, rcpt, sizeof(desc), (char *)&desc)) return 0;
+	return size;
+}
+
+int pex_packet_is_shm(pex_packet_t * packet) {
+	return packet->size == sizeof(pex_shm_descriptor_t) &&
+		((pex_shm_descriptor_t *)packet->data)->magic == PEX_SHM_MAGIC;
+}
+
+void * pex_shm_payload(pex_shm_ring_t * ring, pex_shm_descriptor_t * desc) {
+	if (!ring || desc->magic != PEX_SHM_MAGIC || desc->size > ring->size) return NULL;
+	return ring->data + (desc->offset % ring->size);
+}
+
+void pex_shm_release(pex_shm_ring_t * ring, pex_shm_descriptor_t * desc) {
+	/* Releases must follow arrival order; jumping the tail past the
+	 * payload also frees any wrap padding in front of it. */
+	ring->tail = desc->offset + desc->size;
+	__sync_synchronize();
+}
@@ -9,8 +9,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifndef NO_SSE
+#include <emmintrin.h>
+#endif
+
 #include <toaru/graphics.h>
 #include <toaru/inflate.h>
+#include <toaru/png.h>
 
 /**
  * Read 32-bit big-endian value from file.
@@ -51,13 +56,16 @@ static char*  reorder_type(unsigned int type) {
 struct png_ctx {
 	FILE * f;          /* File being decoded. */
 	sprite_t * sprite; /* Sprite being generated. */
-	int y;             /* Cursor pointers for writing out bitmap data */
-	int x;
-	char buffer[4];   /* A buffer to hold a pixel's worth of data until it can
-	                     be written out to the image with the right filter. */
-	int  buf_off;     /* How much data is in the above buffer */
+	int y;             /* Row being filled. */
 	int seen_ihdr;    /* Whether the IHDR was seen; for error handling */
 
+	uint8_t * row_cur;       /* Raw bytes of the scanline being collected */
+	uint8_t * row_prev;      /* Unfiltered bytes of the previous scanline */
+	unsigned int row_bytes;  /* Bytes per scanline (width * bpp) */
+	unsigned int row_fill;   /* How much of the current scanline has arrived */
+	int row_has_filter;      /* Whether this scanline's filter byte was read */
+	int bpp;                 /* Bytes per pixel for the color type */
+
 	unsigned int width;   /* Image width (dup from sprite) */
 	unsigned int height;  /* Image height (dup from sprite) */
 	int bit_depth;        /* Bit depth of the image */
@@ -68,6 +76,9 @@ struct png_ctx {
 
 	unsigned int size;    /* Remaining IDAT chunk size */
 	int sf;               /* Current scanline filter type */
+
+	png_row_callback_t row_callback; /* Called as each row completes */
+	void * row_extra;                /* Caller data for the callback */
 };
 
 /* PNG chunk types */
@@ -134,230 +145,132 @@ static int paeth(int a, int b, int c) {
 	return c;
 }
 
-static void write_pixel(struct png_ctx * c, uint32_t color) {
-	SPRITE((c->sprite), (c->x), (c->y)) = color;
-
-	/* Reset the short buffer */
-	c->buf_off = 0;
-
-	/* Advance to next pixel */
-	c->x++;
-	if (c->x == (int)c->width) {
-		/* Advance to next line; next read is scanline filter type */
-		c->x = -1;
-		c->y++;
-	}
-}
-
-static void process_pixel_type_6(struct png_ctx * c) {
-	/*
-	 * Obtain pixel data from short buffer;
-	 * For color type 6, this is always in R G B A order in the
-	 * bytestream, so we don't have to worry about subpixel ordering
-	 * or weird color masks.
-	 */
-	unsigned int r = c->buffer[0];
-	unsigned int g = c->buffer[1];
-	unsigned int b = c->buffer[2];
-	unsigned int a = c->buffer[3];
-
-	/* Apply filters */
-	if (c->sf == PNG_FILTER_SUB) {
-		/* Add raw value to the pixel on the left */
-		if (c->x > 0) {
-			uint32_t left = SPRITE((c->sprite), (c->x - 1), (c->y));
-			r += _RED(left);
-			g += _GRE(left);
-			b += _BLU(left);
-			a += _ALP(left);
-		}
-	} else if (c->sf == PNG_FILTER_UP) {
-		/* Add raw value to the pixel above */
-		if (c->y > 0) {
-			uint32_t up = SPRITE((c->sprite), (c->x), (c->y - 1));
-			r += _RED(up);
-			g += _GRE(up);
-			b += _BLU(up);
-			a += _ALP(up);
-		}
-	} else if (c->sf == PNG_FILTER_AVG) {
-		/* Add raw value to the average of the pixel above and left */
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-
-		r += ((int)_RED(left) + (int)_RED(up)) / 2;
-		g += ((int)_GRE(left) + (int)_GRE(up)) / 2;
-		b += ((int)_BLU(left) + (int)_BLU(up)) / 2;
-		a += ((int)_ALP(left) + (int)_ALP(up)) / 2;
-	} else if (c->sf == PNG_FILTER_PAETH) {
-		/* Use the Paeth predictor */
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-		uint32_t upleft = (c->x > 0 && c->y > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y - 1)) : 0;
-
-		r = ((int)r + paeth((int)_RED(left),(int)_RED(up),(int)_RED(upleft))) % 256;
-		g = ((int)g + paeth((int)_GRE(left),(int)_GRE(up),(int)_GRE(upleft))) % 256;
-		b = ((int)b + paeth((int)_BLU(left),(int)_BLU(up),(int)_BLU(upleft))) % 256;
-		a = ((int)a + paeth((int)_ALP(left),(int)_ALP(up),(int)_ALP(upleft))) % 256;
-	}
-
-	/* Write new pixel to the image */
-	write_pixel(c, rgba(r,g,b,a));
-}
-
-static void process_pixel_type_2(struct png_ctx * c) {
-	/*
-	 * Obtain pixel data from short buffer;
-	 * For color type 6, this is always in R G B A order in the
-	 * bytestream, so we don't have to worry about subpixel ordering
-	 * or weird color masks.
-	 */
-	unsigned int r = c->buffer[0];
-	unsigned int g = c->buffer[1];
-	unsigned int b = c->buffer[2];
-
-	/* Apply filters */
-	if (c->sf == PNG_FILTER_SUB) {
-		/* Add raw value to the pixel on the left */
-		if (c->x > 0) {
-			uint32_t left = SPRITE((c->sprite), (c->x - 1), (c->y));
-			r += _RED(left);
-			g += _GRE(left);
-			b += _BLU(left);
-		}
-	} else if (c->sf == PNG_FILTER_UP) {
-		/* Add raw value to the pixel above */
-		if (c->y > 0) {
-			uint32_t up = SPRITE((c->sprite), (c->x), (c->y - 1));
-			r += _RED(up);
-			g += _GRE(up);
-			b += _BLU(up);
-		}
-	} else if (c->sf == PNG_FILTER_AVG) {
-		/* Add raw value to the average of the pixel above and left */
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-
-		r += ((int)_RED(left) + (int)_RED(up)) / 2;
-		g += ((int)_GRE(left) + (int)_GRE(up)) / 2;
-		b += ((int)_BLU(left) + (int)_BLU(up)) / 2;
-	} else if (c->sf == PNG_FILTER_PAETH) {
-		/* Use the Paeth predictor */
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-		uint32_t upleft = (c->x > 0 && c->y > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y - 1)) : 0;
-
-		r = ((int)r + paeth((int)_RED(left),(int)_RED(up),(int)_RED(upleft))) % 256;
-		g = ((int)g + paeth((int)_GRE(left),(int)_GRE(up),(int)_GRE(upleft))) % 256;
-		b = ((int)b + paeth((int)_BLU(left),(int)_BLU(up),(int)_BLU(upleft))) % 256;
-	}
-
-	/* Write new pixel to the image */
-	write_pixel(c, rgb(r,g,b));
-}
-
-static void process_pixel_type_4(struct png_ctx * c) {
-	/*
-	 * Obtain pixel data from short buffer;
-	 * For color type 6, this is always in R G B A order in the
-	 * bytestream, so we don't have to worry about subpixel ordering
-	 * or weird color masks.
-	 */
-	unsigned int b = c->buffer[0];
-	unsigned int a = c->buffer[1];
-
-	/* Apply filters */
-	if (c->sf == PNG_FILTER_SUB) {
-		/* Add raw value to the pixel on the left */
-		if (c->x > 0) {
-			uint32_t left = SPRITE((c->sprite), (c->x - 1), (c->y));
-			b += _BLU(left);
-			a += _ALP(left);
-		}
-	} else if (c->sf == PNG_FILTER_UP) {
-		/* Add raw value to the pixel above */
-		if (c->y > 0) {
-			uint32_t up = SPRITE((c->sprite), (c->x), (c->y - 1));
-			b += _BLU(up);
-			a += _ALP(up);
+/**
+ * Unfilter a completed scanline in place.
+ *
+ * Filters operate on raw bytes (RFC 2083, section 6), so a whole row
+ * can be reconstructed with one branch on the filter type instead of
+ * one per pixel. Addition is naturally modulo 256 on the byte arrays.
+ * The Up filter has no dependency on the pixel to the left, so it gets
+ * done sixteen bytes at a time.
+ */
+static void unfilter_row(struct png_ctx * c) {
+	uint8_t * cur = c->row_cur;
+	const uint8_t * prev = c->row_prev;
+	unsigned int n = c->row_bytes;
+	int bpp = c->bpp;
+
+	switch (c->sf) {
+		case PNG_FILTER_NONE:
+			break;
+		case PNG_FILTER_SUB:
+			for (unsigned int i = bpp; i < n; ++i) {
+				cur[i] += cur[i - bpp];
+			}
+			break;
+		case PNG_FILTER_UP: {
+			unsigned int i = 0;
+#ifndef NO_SSE
+			for (; i + 16 <= n; i += 16) {
+				_mm_storeu_si128((__m128i *)&cur[i], _mm_add_epi8(
+					_mm_loadu_si128((__m128i *)&cur[i]),
+					_mm_loadu_si128((const __m128i *)&prev[i])));
+			}
+#endif
+			for (; i < n; ++i) {
+				cur[i] += prev[i];
+			}
+			break;
 		}
-	} else if (c->sf == PNG_FILTER_AVG) {
-		/* Add raw value to the average of the pixel above and left */
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-
-		b += ((int)_BLU(left) + (int)_BLU(up)) / 2;
-		a += ((int)_ALP(left) + (int)_ALP(up)) / 2;
-	} else if (c->sf == PNG_FILTER_PAETH) {
-		/* Use the Paeth predictor */
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-		uint32_t upleft = (c->x > 0 && c->y > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y - 1)) : 0;
-
-		b = ((int)b + paeth((int)_BLU(left),(int)_BLU(up),(int)_BLU(upleft))) % 256;
-		a = ((int)a + paeth((int)_ALP(left),(int)_ALP(up),(int)_ALP(upleft))) % 256;
+		case PNG_FILTER_AVG:
+			for (int i = 0; i < bpp; ++i) {
+				cur[i] += prev[i] / 2;
+			}
+			for (unsigned int i = bpp; i < n; ++i) {
+				cur[i] += ((int)cur[i - bpp] + (int)prev[i]) / 2;
+			}
+			break;
+		case PNG_FILTER_PAETH:
+			for (int i = 0; i < bpp; ++i) {
+				cur[i] += prev[i]; /* paeth(0, up, 0) is always up */
+			}
+			for (unsigned int i = bpp; i < n; ++i) {
+				cur[i] += paeth(cur[i - bpp], prev[i], prev[i - bpp]);
+			}
+			break;
 	}
-
-	/* Write new pixel to the image */
-	write_pixel(c, rgba(b,b,b,a));
 }
 
-static void process_pixel_type_0(struct png_ctx * c) {
-	unsigned int b = c->buffer[0];
-	if (c->sf == PNG_FILTER_SUB) {
-		if (c->x > 0) {
-			uint32_t left = SPRITE((c->sprite), (c->x - 1), (c->y));
-			b += _BLU(left);
-		}
-	} else if (c->sf == PNG_FILTER_UP) {
-		if (c->y > 0) {
-			uint32_t up = SPRITE((c->sprite), (c->x), (c->y - 1));
-			b += _BLU(up);
-		}
-	} else if (c->sf == PNG_FILTER_AVG) {
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-		b += ((int)_BLU(left) + (int)_BLU(up)) / 2;
-	} else if (c->sf == PNG_FILTER_PAETH) {
-		uint32_t left = (c->x > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y)) : 0;
-		uint32_t up = (c->y > 0) ? SPRITE((c->sprite), (c->x), (c->y - 1)) : 0;
-		uint32_t upleft = (c->x > 0 && c->y > 0) ? SPRITE((c->sprite), (c->x - 1), (c->y - 1)) : 0;
-		b = ((int)b + paeth((int)_BLU(left),(int)_BLU(up),(int)_BLU(upleft))) % 256;
+/**
+ * Convert an unfiltered scanline to sprite pixels.
+ *
+ * Alpha is premultiplied here, per row, so completed rows are final
+ * and can be handed to a row callback immediately.
+ */
+static void write_row(struct png_ctx * c) {
+	const uint8_t * s = c->row_cur;
+	uint32_t * out = &SPRITE((c->sprite), 0, (c->y));
+
+	switch (c->color_type) {
+		case 0:
+			for (unsigned int x = 0; x < c->width; ++x) {
+				out[x] = rgb(s[x], s[x], s[x]);
+			}
+			break;
+		case 4:
+			for (unsigned int x = 0; x < c->width; ++x) {
+				out[x] = premultiply(rgba(s[x*2], s[x*2], s[x*2], s[x*2+1]));
+			}
+			break;
+		case 2:
+			for (unsigned int x = 0; x < c->width; ++x) {
+				out[x] = rgb(s[x*3], s[x*3+1], s[x*3+2]);
+			}
+			break;
+		case 6:
+			for (unsigned int x = 0; x < c->width; ++x) {
+				out[x] = premultiply(rgba(s[x*4], s[x*4+1], s[x*4+2], s[x*4+3]));
+			}
+			break;
 	}
 
-	/* Write new pixel to the image */
-	write_pixel(c, rgb(b,b,b));
+	if (c->row_callback) c->row_callback(c->sprite, c->y, c->row_extra);
 }
 
-
 /**
  * Handle decompressed output from the inflater
  *
- * Writes pixel data to the image, and applies relevant filters.
+ * Collects bytes into the current scanline; when a scanline completes
+ * it is unfiltered and converted to pixels in one pass, so the image
+ * streams out row by row as the inflater produces data.
  */
 static void _write(struct inflate_context * ctx, unsigned int sym) {
 	struct png_ctx * c = (ctx->input_priv);
 
-	/* Put this byte into the short buffer */
-	c->buffer[c->buf_off] = sym;
-	c->buf_off++;
+	/* Don't run off the end of the sprite on damaged input */
+	if (c->y >= (int)c->height) return;
 
-	/* If this is the beginning of a scanline... */
-	if (c->x == -1 && c->buf_off == 1) {
-		/* Then this is the scanline filter type */
+	/* The first byte of every scanline is its filter type */
+	if (!c->row_has_filter) {
 		c->sf = sym;
+		c->row_has_filter = 1;
+		return;
+	}
+
+	c->row_cur[c->row_fill++] = sym;
+
+	if (c->row_fill == c->row_bytes) {
+		unfilter_row(c);
+		write_row(c);
 
-		/* Reset the buffer, advance to the beginning of the actual scanline */
-		c->x = 0;
-		c->buf_off = 0;
-	} else if (c->buf_off == 1 && c->color_type == 0) {
-		process_pixel_type_0(c);
-	} else if (c->buf_off == 2 && c->color_type == 4) {
-		process_pixel_type_4(c);
-	} else if (c->buf_off == 3 && c->color_type == 2) {
-		process_pixel_type_2(c);
-	} else if (c->buf_off == 4 && c->color_type == 6) {
-		process_pixel_type_6(c);
+		/* This row is the next row's "up" neighbor */
+		uint8_t * tmp = c->row_prev;
+		c->row_prev = c->row_cur;
+		c->row_cur = tmp;
+
+		c->row_fill = 0;
+		c->row_has_filter = 0;
+		c->y++;
 	}
 }
 
@@ -371,7 +284,7 @@ static int color_type_has_alpha(int c) {
 	}
 }
 
-int load_sprite_png(sprite_t * sprite, char * filename) {
+int load_sprite_png_stream(sprite_t * sprite, char * filename, png_row_callback_t callback, void * extra) {
 	FILE * f = fopen(filename,"r");
 	if (!f) {
 		fprintf(stderr, "Failed to open file %s\n", filename);
@@ -391,11 +304,15 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 	/* Set up context for future calls to inflate */
 	struct png_ctx c;
 	c.sprite = sprite;
-	c.x = -1;
 	c.y = 0;
 	c.f = f;
-	c.buf_off = 0;
 	c.seen_ihdr = 0;
+	c.row_cur = NULL;
+	c.row_prev = NULL;
+	c.row_fill = 0;
+	c.row_has_filter = 0;
+	c.row_callback = callback;
+	c.row_extra = extra;
 
 	while (1) {
 		/* read chunks */
@@ -437,6 +354,13 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 					sprite->alpha = color_type_has_alpha(c.color_type);
 					sprite->blank = 0;
 
+					/* Scanline buffers; the "previous" row starts as
+					 * all zeroes, which is what the filters expect of
+					 * the row above the first one. */
+					c.bpp = (c.color_type == 6) ? 4 : (c.color_type == 2) ? 3 : (c.color_type == 4) ? 2 : 1;
+					c.row_bytes = c.width * c.bpp;
+					c.row_cur = malloc(c.row_bytes);
+					c.row_prev = calloc(1, c.row_bytes);
 
 					/* Skip */
 					for (unsigned int i = 13; i < size; ++i) fgetc(f);
@@ -491,15 +415,8 @@ int load_sprite_png(sprite_t * sprite, char * filename) {
 		(void)crc32;
 	}
 
-	/*
-	 * Data in PNGs is unpremultiplied, but our sprites expect
-	 * premultiplied alpha, so convert the image data
-	 */
-	for (int y = 0; y < sprite->height; ++y) {
-		for (int x = 0; x < sprite->width; ++x) {
-			SPRITE(sprite,x,y) = premultiply(SPRITE(sprite,x,y));
-		}
-	}
+	free(c.row_cur);
+	free(c.row_prev);
 
 	return 0;
 
@@ -507,3 +424,7 @@ _error:
 	fclose(f);
 	return 1;
 }
+
+int load_sprite_png(sprite_t * sprite, char * filename) {
+	return load_sprite_png_stream(sprite, filename, NULL, NULL);
+}
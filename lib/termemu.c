@@ -588,6 +588,37 @@ void ansi_put(term_state_t * s, char c) {
 	spin_unlock(&s->lock);
 }
 
+/**
+ * Buffer-oriented entry point. While the parser is in its ground state,
+ * plain bytes are emitted as whole runs - through the write_run callback
+ * when the renderer provides one - and only escape bytes drop down to the
+ * state machine. The lock is taken once per buffer rather than per byte,
+ * which is most of the win for bulk output like cat or build logs.
+ */
+void ansi_write(term_state_t * s, const char * buf, size_t len) {
+	spin_lock(&s->lock);
+	size_t i = 0;
+	while (i < len) {
+		if (s->escape == 0 && !s->box) {
+			size_t j = i;
+			while (j < len && (unsigned char)buf[j] != ANSI_ESCAPE && buf[j] != 0) j++;
+			if (j > i) {
+				if (s->callbacks->write_run) {
+					s->callbacks->write_run(buf + i, j - i);
+				} else {
+					for (size_t k = i; k < j; ++k) {
+						s->callbacks->writer(buf[k]);
+					}
+				}
+				i = j;
+				continue;
+			}
+		}
+		_ansi_put(s, buf[i++]);
+	}
+	spin_unlock(&s->lock);
+}
+
 term_state_t * ansi_init(term_state_t * s, int w, int y, term_callbacks_t * callbacks_in) {
 
 	if (!s) {
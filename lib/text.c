@@ -84,6 +84,10 @@ struct TT_Font {
 	struct TT_Table hmtx_ptr;
 	struct TT_Table name_ptr;
 
+	hashmap_t * glyphCache;
+	size_t glyphCacheCount;
+	unsigned int glyphCacheTick;
+
 	off_t cmap_start;
 
 	size_t cmap_maxInd;
@@ -219,6 +223,8 @@ void tt_path_paint(gfx_context_t * ctx, const struct TT_Shape * shape, uint32_t
 	int startY = shape->startY < 0 ? 0 : shape->startY;
 	int endY = shape->lastY <= ctx->height ? shape->lastY : ctx->height;
 
+	gfx_damage(ctx, shape->startX, startY, shape->lastX - shape->startX, endY - startY);
+
 	for (int y = startY; y < endY; ++y) {
 		float _y = y + 0.0001;
 		for (int l = 0; l < 4; ++l) {
@@ -680,7 +686,157 @@ static struct TT_Contour * tt_draw_glyph_into(struct TT_Contour * contour, struc
 	return contour;
 }
 
+/**
+ * Glyph atlas cache.
+ *
+ * Rasterizing a glyph means walking its outline and scan-converting it
+ * with per-glyph scratch allocations, which dominates redraw cost in
+ * the terminal and bim where the same few dozen glyphs are painted over
+ * and over. We keep a per-font cache of coverage bitmaps, keyed on
+ * glyph index, scale, and the subpixel x position quantized to quarter
+ * pixels, so repeat draws become a colored alpha blit. The cache is
+ * bounded: past @c TT_GLYPH_CACHE_MAX entries the least recently used
+ * one is evicted, and outsized glyphs are not cached at all.
+ */
+#define TT_GLYPH_CACHE_MAX     256
+#define TT_GLYPH_CACHE_BIGGEST (64 * 1024)
+
+struct TT_GlyphCache {
+	int x0, y0;           /* placement relative to the (integer) pen position */
+	int width, height;
+	unsigned int tick;    /* last use, for eviction */
+	uint8_t coverage[];
+};
+
+static uintptr_t tt_glyph_cache_ident(struct TT_Font * font, unsigned int glyph, int xbin) {
+	union { float f; uint32_t i; } scale = { font->scale };
+	return ((uintptr_t)scale.i << 32) | (glyph << 2) | xbin;
+}
+
+static void tt_glyph_cache_evict(struct TT_Font * font) {
+	list_t * keys = hashmap_keys(font->glyphCache);
+	void * oldest_key = NULL;
+	unsigned int oldest = 0;
+	foreach(node, keys) {
+		struct TT_GlyphCache * entry = hashmap_get(font->glyphCache, node->value);
+		if (!oldest_key || entry->tick < oldest) {
+			oldest = entry->tick;
+			oldest_key = node->value;
+		}
+	}
+	list_free(keys);
+	free(keys);
+	if (oldest_key) {
+		free(hashmap_remove(font->glyphCache, oldest_key));
+		font->glyphCacheCount--;
+	}
+}
+
+static struct TT_GlyphCache * tt_glyph_cache_lookup(struct TT_Font * font, unsigned int glyph, int xbin) {
+	if (!font->glyphCache) {
+		font->glyphCache = hashmap_create_int(64);
+	}
+
+	uintptr_t ident = tt_glyph_cache_ident(font, glyph, xbin);
+	struct TT_GlyphCache * entry = hashmap_get(font->glyphCache, (void*)ident);
+	if (entry) {
+		entry->tick = ++font->glyphCacheTick;
+		return entry;
+	}
+
+	struct TT_Contour * contour = tt_contour_start(0, 0);
+	contour = tt_draw_glyph_into(contour, font, (float)xbin / 4.0, 0, glyph);
+
+	if (!contour->edgeCount) {
+		/* Blank glyphs (eg. space) still get an entry so we don't redo the lookup. */
+		entry = malloc(sizeof(struct TT_GlyphCache));
+		entry->x0 = 0;
+		entry->y0 = 0;
+		entry->width = 0;
+		entry->height = 0;
+	} else {
+		struct TT_Shape * shape = tt_contour_finish(contour);
+		int width  = shape->lastX - shape->startX;
+		int height = shape->lastY - shape->startY;
+
+		if (width <= 0 || height <= 0 || width * height > TT_GLYPH_CACHE_BIGGEST) {
+			/* Too big to be worth keeping; caller paints it the slow way. */
+			free(shape);
+			free(contour);
+			return NULL;
+		}
+
+		entry = malloc(sizeof(struct TT_GlyphCache) + width * height);
+		entry->x0 = shape->startX;
+		entry->y0 = shape->startY;
+		entry->width = width;
+		entry->height = height;
+
+		/* Same scan conversion as tt_path_paint, but the coverage lands
+		 * in the cache entry instead of being blended into a context. */
+		size_t size = shape->edgeCount;
+		struct TT_Intersection * crosses = malloc(sizeof(struct TT_Intersection) * size);
+		float * subsamples = malloc(sizeof(float) * width);
+		memset(subsamples, 0, sizeof(float) * width);
+
+		for (int y = shape->startY; y < shape->lastY; ++y) {
+			float _y = y + 0.0001;
+			for (int l = 0; l < 4; ++l) {
+				size_t cnt;
+				if ((cnt = prune_edges(size, _y, shape->edges, crosses))) {
+					sort_intersections(cnt, crosses);
+					process_scanline(_y, shape, width, subsamples, cnt, crosses);
+				}
+				_y += 1.0/4.0;
+			}
+			uint8_t * row = &entry->coverage[(y - shape->startY) * width];
+			for (int x = 0; x < width; ++x) {
+				row[x] = (int)(255 * subsamples[x]) >> 2;
+				subsamples[x] = 0;
+			}
+		}
+
+		free(subsamples);
+		free(crosses);
+		free(shape);
+	}
+	free(contour);
+
+	if (font->glyphCacheCount >= TT_GLYPH_CACHE_MAX) {
+		tt_glyph_cache_evict(font);
+	}
+
+	entry->tick = ++font->glyphCacheTick;
+	hashmap_set(font->glyphCache, (void*)ident, entry);
+	font->glyphCacheCount++;
+	return entry;
+}
+
+static void tt_glyph_cache_blit(gfx_context_t * ctx, const struct TT_GlyphCache * entry, int x, int y, uint32_t color) {
+	gfx_damage(ctx, x + entry->x0, y + entry->y0, entry->width, entry->height);
+	for (int row = 0; row < entry->height; ++row) {
+		int ty = y + entry->y0 + row;
+		if (ty < 0) continue;
+		if (ty >= ctx->height) break;
+		const uint8_t * src = &entry->coverage[row * entry->width];
+		for (int col = 0; col < entry->width; ++col) {
+			int tx = x + entry->x0 + col;
+			if (tx < 0 || tx >= ctx->width) continue;
+			uint16_t na = src[col];
+			if (!na) continue;
+			uint32_t nc = tt_apply_alpha(color, na);
+			GFX(ctx, tx, ty) = tt_alpha_blend_rgba(GFX(ctx, tx, ty), nc);
+		}
+	}
+}
+
 void tt_draw_glyph(gfx_context_t * ctx, struct TT_Font * font, int x, int y, unsigned int glyph, uint32_t color) {
+	struct TT_GlyphCache * cached = tt_glyph_cache_lookup(font, glyph, 0);
+	if (cached) {
+		tt_glyph_cache_blit(ctx, cached, x, y, color);
+		return;
+	}
+
 	struct TT_Contour * contour = tt_contour_start(0, 0);
 	contour = tt_draw_glyph_into(contour,font,x,y,glyph);
 	if (contour->edgeCount) {
@@ -707,8 +863,6 @@ int tt_string_width(struct TT_Font * font, const char * s) {
 }
 
 int tt_draw_string(gfx_context_t * ctx, struct TT_Font * font, int x, int y, const char * s, uint32_t color) {
-	struct TT_Contour * contour = tt_contour_start(0, 0);
-
 	float x_offset = x;
 	uint32_t cp = 0;
 	uint32_t istate = 0;
@@ -716,18 +870,32 @@ int tt_draw_string(gfx_context_t * ctx, struct TT_Font * font, int x, int y, con
 	for (const unsigned char * c = (const unsigned char*)s; *c; ++c) {
 		if (!decode(&istate, &cp, *c)) {
 			unsigned int glyph = tt_glyph_for_codepoint(font, cp);
-			contour = tt_draw_glyph_into(contour,font,x_offset,y,glyph);
+			/* Split the pen position into an integer cell and a quarter-pixel
+			 * bin, which is what the cache keys subpixel positioning on. */
+			int cell = (int)x_offset;
+			float frac = x_offset - cell;
+			if (frac < 0) {
+				cell -= 1;
+				frac += 1;
+			}
+			int xbin = (int)(frac * 4.0) & 3;
+			struct TT_GlyphCache * cached = tt_glyph_cache_lookup(font, glyph, xbin);
+			if (cached) {
+				tt_glyph_cache_blit(ctx, cached, cell, y, color);
+			} else {
+				struct TT_Contour * contour = tt_contour_start(0, 0);
+				contour = tt_draw_glyph_into(contour,font,x_offset,y,glyph);
+				if (contour->edgeCount) {
+					struct TT_Shape * shape = tt_contour_finish(contour);
+					tt_path_paint(ctx, shape, color);
+					free(shape);
+				}
+				free(contour);
+			}
 			x_offset += tt_xadvance_for_glyph(font, glyph) * font->scale;
 		}
 	}
 
-	if (contour->edgeCount) {
-		struct TT_Shape * shape = tt_contour_finish(contour);
-		tt_path_paint(ctx, shape, color);
-		free(shape);
-	}
-	free(contour);
-
 	return x_offset - x;
 }
 
@@ -0,0 +1,194 @@
+/**
+ * @brief Directory tree walker built on the batched syscalls.
+ *
+ * The usual opendir/readdir/lstat sequence pays one syscall per entry
+ * for the stat alone. This walker lists each directory through the
+ * batched readdir and then resolves each run of names with a single
+ * lstat_batch call, so a directory of N entries costs a handful of
+ * syscalls instead of N-plus-some. Callers get one callback per
+ * object - directories twice, entering and leaving - with the stat
+ * the walker already paid for.
+ *
+ * walker_walk_threaded() spreads the immediate subtrees of the root
+ * across worker threads pulling from a shared list, for scans of
+ * large trees on volumes that can overlap requests; callbacks then
+ * fire concurrently and must be thread-safe.
+ *
+ * @copyright
+ * This file is part of ToaruOS and is released under the terms
+ * of the NCSA / University of Illinois License - see LICENSE.md
+ * Copyright (C) 2021 K. Lange
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <toaru/walker.h>
+
+#define WALKER_BATCH 64
+
+/* One run of entries from a directory: names packed for lstat_batch
+ * and the stats that came back. */
+struct walker_batch {
+	char names[WALKER_BATCH * 256];
+	size_t names_len;
+	size_t offsets[WALKER_BATCH];
+	struct stat stats[WALKER_BATCH];
+	int count;
+};
+
+static int walk_object(const char * path, struct stat * st, walker_func_t func, void * extra);
+
+static int walk_directory(const char * path, walker_func_t func, void * extra) {
+	DIR * dirp = opendir(path);
+	if (!dirp) return 0; /* Unreadable directories are skipped, not fatal. */
+
+	struct walker_batch * batch = malloc(sizeof(struct walker_batch));
+	size_t path_len = strlen(path);
+	int result = 0;
+
+	struct dirent * ent = readdir(dirp);
+	while (ent && !result) {
+		/* Collect a run of names... */
+		batch->count = 0;
+		batch->names_len = 0;
+		while (ent && batch->count < WALKER_BATCH) {
+			if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")) {
+				size_t len = strlen(ent->d_name) + 1;
+				if (batch->names_len + len > sizeof(batch->names)) break;
+				batch->offsets[batch->count] = batch->names_len;
+				memcpy(batch->names + batch->names_len, ent->d_name, len);
+				batch->names_len += len;
+				batch->count++;
+			}
+			ent = readdir(dirp);
+		}
+		if (!batch->count) break;
+
+		/* ...resolve them all at once... */
+		if (lstat_batch(path, batch->names, batch->names_len, batch->stats, batch->count) < 0) {
+			memset(batch->stats, 0, sizeof(struct stat) * batch->count);
+		}
+
+		/* ...and visit each one. */
+		for (int i = 0; i < batch->count && !result; ++i) {
+			const char * name = batch->names + batch->offsets[i];
+			char * child = malloc(path_len + strlen(name) + 2);
+			sprintf(child, "%s/%s", path, name);
+			result = walk_object(child, &batch->stats[i], func, extra);
+			free(child);
+		}
+	}
+
+	free(batch);
+	closedir(dirp);
+	return result;
+}
+
+static int walk_object(const char * path, struct stat * st, walker_func_t func, void * extra) {
+	if (!st->st_mode) return 0; /* lstat_batch could not resolve it. */
+	if (!S_ISDIR(st->st_mode)) {
+		int r = func(WALKER_FILE, path, st, extra);
+		return r < 0 ? r : 0;
+	}
+	int r = func(WALKER_DIR_ENTER, path, st, extra);
+	if (r < 0) return r;
+	if (r != WALKER_PRUNE) {
+		r = walk_directory(path, func, extra);
+		if (r < 0) return r;
+	}
+	r = func(WALKER_DIR_LEAVE, path, NULL, extra);
+	return r < 0 ? r : 0;
+}
+
+int walker_walk(const char * path, walker_func_t func, void * extra) {
+	struct stat st;
+	if (lstat(path, &st) < 0) return -1;
+	return walk_object(path, &st, func, extra);
+}
+
+struct walker_pool {
+	char ** paths;
+	int count;
+	volatile int next;
+	walker_func_t func;
+	void * extra;
+	volatile int result;
+};
+
+static void * pool_worker(void * arg) {
+	struct walker_pool * pool = arg;
+	int i;
+	while ((i = __sync_fetch_and_add(&pool->next, 1)) < pool->count) {
+		if (pool->result < 0) break;
+		int r = walker_walk(pool->paths[i], pool->func, pool->extra);
+		if (r < 0) pool->result = r;
+	}
+	return NULL;
+}
+
+int walker_walk_threaded(const char * path, int threads, walker_func_t func, void * extra) {
+	struct stat st;
+	if (lstat(path, &st) < 0) return -1;
+	if (!S_ISDIR(st.st_mode) || threads < 2) return walk_object(path, &st, func, extra);
+
+	int r = func(WALKER_DIR_ENTER, path, &st, extra);
+	if (r < 0) return r;
+
+	if (r != WALKER_PRUNE) {
+		/* List the root once; files are delivered here, directories
+		 * become the work list for the pool. */
+		struct walker_pool pool = { NULL, 0, 0, func, extra, 0 };
+		int space = 0;
+		DIR * dirp = opendir(path);
+		struct dirent * ent;
+		while (dirp && (ent = readdir(dirp))) {
+			if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+			char * child = malloc(strlen(path) + strlen(ent->d_name) + 2);
+			sprintf(child, "%s/%s", path, ent->d_name);
+			struct stat cst;
+			if (lstat(child, &cst) < 0) {
+				free(child);
+				continue;
+			}
+			if (S_ISDIR(cst.st_mode)) {
+				if (pool.count == space) {
+					space = space ? space * 2 : 16;
+					pool.paths = realloc(pool.paths, space * sizeof(char *));
+				}
+				pool.paths[pool.count++] = child;
+			} else {
+				if (pool.result >= 0) {
+					int fr = func(WALKER_FILE, child, &cst, extra);
+					if (fr < 0) pool.result = fr;
+				}
+				free(child);
+			}
+		}
+		if (dirp) closedir(dirp);
+
+		if (threads > pool.count) threads = pool.count;
+		pthread_t * workers = threads > 1 ? malloc(threads * sizeof(pthread_t)) : NULL;
+		if (workers && pool.result >= 0) {
+			for (int i = 0; i < threads; ++i) {
+				pthread_create(&workers[i], NULL, pool_worker, &pool);
+			}
+			for (int i = 0; i < threads; ++i) {
+				pthread_join(workers[i], NULL);
+			}
+		} else if (pool.result >= 0) {
+			pool_worker(&pool);
+		}
+		free(workers);
+
+		for (int i = 0; i < pool.count; ++i) free(pool.paths[i]);
+		free(pool.paths);
+		if (pool.result < 0) return pool.result;
+	}
+
+	r = func(WALKER_DIR_LEAVE, path, NULL, extra);
+	return r < 0 ? r : 0;
+}
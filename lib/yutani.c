@@ -31,6 +31,7 @@
  * of messages for processing later.
  */
 yutani_msg_t * yutani_wait_for(yutani_t * y, uint32_t type) {
+	yutani_flush(y);
 	do {
 		yutani_msg_t * out;
 		size_t size;
@@ -57,6 +58,7 @@ yutani_msg_t * yutani_wait_for(yutani_t * y, uint32_t type) {
  */
 size_t yutani_query(yutani_t * y) {
 	if (y->queued->length > 0) return 1;
+	yutani_flush(y);
 	return pex_query(y->sock);
 }
 
@@ -120,6 +122,8 @@ yutani_msg_t * yutani_poll(yutani_t * y) {
 		return out;
 	}
 
+	yutani_flush(y);
+
 	size_t size;
 	{
 		char tmp[MAX_PACKET_SIZE];
@@ -336,6 +340,19 @@ void yutani_msg_buildx_flip_region(yutani_msg_t * msg, yutani_wid_t wid, int32_t
 }
 
 
+void yutani_msg_buildx_flip_regions(yutani_msg_t * msg, yutani_wid_t wid, uint32_t count, const struct yutani_damage_rect * rects) {
+	msg->magic = YUTANI_MSG__MAGIC;
+	msg->type  = YUTANI_MSG_FLIP_REGIONS;
+	msg->size  = sizeof(struct yutani_message) + sizeof(struct yutani_msg_flip_regions) + count * sizeof(struct yutani_damage_rect);
+
+	struct yutani_msg_flip_regions * mw = (void *)msg->data;
+
+	mw->wid = wid;
+	mw->count = count;
+	memcpy(mw->rects, rects, count * sizeof(struct yutani_damage_rect));
+}
+
+
 void yutani_msg_buildx_window_resize(yutani_msg_t * msg, uint32_t type, yutani_wid_t wid, uint32_t width, uint32_t height, uint32_t bufid, uint32_t flags) {
 	msg->magic = YUTANI_MSG__MAGIC;
 	msg->type  = type;
@@ -512,8 +529,105 @@ void yutani_msg_buildx_clipboard(yutani_msg_t * msg, char * content) {
 	memcpy(cl->content, content, strlen(content));
 }
 
+void yutani_msg_buildx_frame_complete(yutani_msg_t * msg, yutani_wid_t wid, uint32_t timestamp) {
+	msg->magic = YUTANI_MSG__MAGIC;
+	msg->type  = YUTANI_MSG_FRAME_COMPLETE;
+	msg->size  = sizeof(struct yutani_message) + sizeof(struct yutani_msg_frame_complete);
+
+	struct yutani_msg_frame_complete * fc = (void *)msg->data;
+
+	fc->wid = wid;
+	fc->timestamp = timestamp;
+}
+
+void yutani_msg_buildx_query_frame_stats(yutani_msg_t * msg) {
+	msg->magic = YUTANI_MSG__MAGIC;
+	msg->type  = YUTANI_MSG_QUERY_FRAME_STATS;
+	msg->size  = sizeof(struct yutani_message);
+}
+
+void yutani_msg_buildx_frame_stats(yutani_msg_t * msg, const struct yutani_msg_frame_stats * stats) {
+	msg->magic = YUTANI_MSG__MAGIC;
+	msg->type  = YUTANI_MSG_FRAME_STATS;
+	msg->size  = sizeof(struct yutani_message) + sizeof(struct yutani_msg_frame_stats);
+
+	memcpy(msg->data, stats, sizeof(struct yutani_msg_frame_stats));
+}
+
+void yutani_msg_buildx_capture_init(yutani_msg_t * msg, uint32_t bufid, uint32_t width, uint32_t height) {
+	msg->magic = YUTANI_MSG__MAGIC;
+	msg->type  = YUTANI_MSG_CAPTURE_INIT;
+	msg->size  = sizeof(struct yutani_message) + sizeof(struct yutani_msg_capture_init);
+
+	struct yutani_msg_capture_init * ci = (void *)msg->data;
+
+	ci->bufid = bufid;
+	ci->width = width;
+	ci->height = height;
+}
+
+/**
+ * Messages it is safe to sit on until the next flush: state updates
+ * the server only acts on when it composites a frame. Everything else
+ * - handshakes, resizes, anything with a reply - goes out immediately
+ * (carrying whatever was queued ahead of it, so ordering holds).
+ */
+static int yutani_msg_is_lazy(uint32_t type) {
+	switch (type) {
+		case YUTANI_MSG_FLIP:
+		case YUTANI_MSG_FLIP_REGION:
+		case YUTANI_MSG_FLIP_REGIONS:
+		case YUTANI_MSG_WINDOW_MOVE:
+		case YUTANI_MSG_WINDOW_MOUSE_EVENT:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * yutani_flush
+ *
+ * Submit all queued messages to the server in one packet.
+ */
+void yutani_flush(yutani_t * y) {
+	if (!y->send_length) return;
+	pex_reply(y->sock, y->send_length, y->send_buffer);
+	y->send_length = 0;
+}
+
+/**
+ * yutani_set_buffered
+ *
+ * Enable or disable the outgoing message queue; returns the previous
+ * setting. With buffering on, flips, damage, and window moves are
+ * queued and coalesce into a single submission at the next flush -
+ * which happens explicitly, when another message type is sent, or
+ * when the library is about to wait for the server. Apps that block
+ * outside the library (raw fswait on the socket) must call
+ * yutani_flush before doing so.
+ */
+int yutani_set_buffered(yutani_t * y, int buffered) {
+	int old = y->send_buffered;
+	y->send_buffered = buffered;
+	if (!buffered) yutani_flush(y);
+	return old;
+}
+
 int yutani_msg_send(yutani_t * y, yutani_msg_t * msg) {
-	return pex_reply(y->sock, msg->size, (char *)msg);
+	if (!y->send_buffered || msg->size > MAX_PACKET_SIZE) {
+		yutani_flush(y);
+		return pex_reply(y->sock, msg->size, (char *)msg);
+	}
+	if (y->send_length + msg->size > MAX_PACKET_SIZE) {
+		yutani_flush(y);
+	}
+	memcpy(y->send_buffer + y->send_length, msg, msg->size);
+	y->send_length += msg->size;
+	if (!yutani_msg_is_lazy(msg->type)) {
+		yutani_flush(y);
+	}
+	return msg->size;
 }
 
 yutani_t * yutani_context_create(FILE * socket) {
@@ -524,6 +638,9 @@ yutani_t * yutani_context_create(FILE * socket) {
 	out->display_height = 0;
 	out->windows = hashmap_create_int(10);
 	out->queued = list_create();
+	out->send_buffered = 0;
+	out->send_length = 0;
+	out->send_buffer = malloc(MAX_PACKET_SIZE);
 	return out;
 }
 
@@ -586,6 +703,10 @@ yutani_window_t * yutani_window_create_flags(yutani_t * y, int width, int height
 	win->user_data = NULL;
 	win->ctx = y;
 	win->mouse_state = -1;
+	win->double_buffered = !!(flags & YUTANI_WINDOW_FLAG_DOUBLE_BUFFERED);
+	win->swaps = 0;
+	win->ages[0] = 0;
+	win->ages[1] = 0;
 	free(mm);
 
 	hashmap_set(y->windows, (void*)(uintptr_t)win->wid, win);
@@ -593,8 +714,9 @@ yutani_window_t * yutani_window_create_flags(yutani_t * y, int width, int height
 	char key[1024];
 	YUTANI_SHMKEY(y->server_ident, key, 1024, win);
 
-	size_t size = (width * height * 4);
-	win->buffer = shm_obtain(key, &size);
+	size_t size = (width * height * 4) * (win->double_buffered ? 2 : 1);
+	win->buffer_base = shm_obtain(key, &size);
+	win->buffer = win->buffer_base;
 	return win;
 
 }
@@ -608,6 +730,34 @@ yutani_window_t * yutani_window_create(yutani_t * y, int width, int height) {
 	return yutani_window_create_flags(y,width,height,0);
 }
 
+/**
+ * Advance a double-buffered window to its other half.
+ *
+ * Flips swap deterministically on both sides of the protocol, so the
+ * age of the acquired buffer is known locally: 1 when we just drew it,
+ * bumped each time it sits out a swap, 0 if it has never been drawn.
+ */
+static void window_swap_buffers(yutani_window_t * win) {
+	if (!win->double_buffered) return;
+	uint32_t cur = win->swaps & 1;
+	win->ages[cur] = 1;
+	if (win->ages[cur ^ 1]) win->ages[cur ^ 1]++;
+	win->swaps++;
+	win->buffer = win->buffer_base + (win->swaps & 1) * (win->width * win->height * 4);
+}
+
+/**
+ * yutani_window_buffer_age
+ *
+ * How many flips ago the buffer the client is currently drawing
+ * into was last fully drawn. 0 means its contents are undefined;
+ * single-buffered windows always report 1 (content is preserved).
+ */
+int yutani_window_buffer_age(yutani_window_t * window) {
+	if (!window->double_buffered) return 1;
+	return window->ages[window->swaps & 1];
+}
+
 /**
  * yutani_flip
  *
@@ -617,6 +767,7 @@ void yutani_flip(yutani_t * y, yutani_window_t * win) {
 	yutani_msg_buildx_flip_alloc(m);
 	yutani_msg_buildx_flip(m, win->wid);
 	yutani_msg_send(y, m);
+	window_swap_buffers(win);
 }
 
 /**
@@ -628,6 +779,26 @@ void yutani_flip_region(yutani_t * yctx, yutani_window_t * win, int32_t x, int32
 	yutani_msg_buildx_flip_region_alloc(m);
 	yutani_msg_buildx_flip_region(m, win->wid, x, y, width, height);
 	yutani_msg_send(yctx, m);
+	window_swap_buffers(win);
+}
+
+/**
+ * yutani_flip_regions
+ *
+ * Ask the server to redraw a list of regions relative to the window,
+ * so scattered small updates (a cursor blink plus a title change)
+ * don't get merged into one huge bounding box. Degenerate counts
+ * fall back to a whole-window flip.
+ */
+void yutani_flip_regions(yutani_t * yctx, yutani_window_t * win, uint32_t count, const struct yutani_damage_rect * rects) {
+	if (count == 0 || count > YUTANI_MAX_FLIP_REGIONS) {
+		yutani_flip(yctx, win);
+		return;
+	}
+	yutani_msg_buildx_flip_regions_alloc(m);
+	yutani_msg_buildx_flip_regions(m, win->wid, count, rects);
+	yutani_msg_send(yctx, m);
+	window_swap_buffers(win);
 }
 
 /**
@@ -736,13 +907,17 @@ void yutani_window_resize_accept(yutani_t * yctx, yutani_window_t * window, uint
 	window->bufid = wr->bufid;
 	free(mm);
 
-	/* Allocate the buffer */
+	/* Allocate the buffer; both halves are fresh for double-buffered windows */
 	{
 		char key[1024];
 		YUTANI_SHMKEY(yctx->server_ident, key, 1024, window);
 
-		size_t size = (window->width * window->height * 4);
-		window->buffer = shm_obtain(key, &size);
+		size_t size = (window->width * window->height * 4) * (window->double_buffered ? 2 : 1);
+		window->buffer_base = shm_obtain(key, &size);
+		window->buffer = window->buffer_base;
+		window->swaps = 0;
+		window->ages[0] = 0;
+		window->ages[1] = 0;
 	}
 }
 
@@ -764,6 +939,10 @@ void yutani_window_resize_done(yutani_t * yctx, yutani_window_t * window) {
 	yutani_msg_buildx_window_resize_alloc(m);
 	yutani_msg_buildx_window_resize(m, YUTANI_MSG_RESIZE_DONE, window->wid, window->width, window->height, window->bufid, 0);
 	yutani_msg_send(yctx, m);
+
+	/* The resized content was drawn into the first half and is now on
+	 * display, so move on to the second. */
+	window_swap_buffers(window);
 }
 
 /**
@@ -860,6 +1039,60 @@ void yutani_query_windows(yutani_t * y) {
 	yutani_msg_send(y, m);
 }
 
+/**
+ * yutani_query_frame_stats
+ *
+ * Ask the server for its frame timing statistics; the reply arrives
+ * as a YUTANI_MSG_FRAME_STATS message.
+ */
+void yutani_query_frame_stats(yutani_t * y) {
+	yutani_msg_buildx_query_frame_stats_alloc(m);
+	yutani_msg_buildx_query_frame_stats(m);
+	yutani_msg_send(y, m);
+}
+
+/**
+ * yutani_capture_start
+ *
+ * Ask the server to mirror the screen into a shared-memory capture
+ * buffer and map it. Returns NULL if the server refused. The buffer
+ * is read-only from the client's perspective; see struct yutani_capture
+ * for how to consume frames from it.
+ */
+struct yutani_capture * yutani_capture_start(yutani_t * y) {
+	yutani_special_request_wid(y, 0, YUTANI_SPECIAL_REQUEST_CAPTURE_START);
+	yutani_msg_t * mm = yutani_wait_for(y, YUTANI_MSG_CAPTURE_INIT);
+	struct yutani_msg_capture_init * ci = (void *)mm->data;
+	uint32_t bufid = ci->bufid;
+	free(mm);
+
+	if (!bufid) return NULL;
+
+	char key[1024];
+	YUTANI_SHMKEY_EXP(y->server_ident, key, 1024, bufid);
+
+	size_t size = 0;
+	struct yutani_capture * capture = shm_obtain(key, &size);
+	if (!size) return NULL;
+
+	return capture;
+}
+
+/**
+ * yutani_capture_stop
+ *
+ * Release a capture buffer and tell the server we are no longer
+ * watching; the server tears the buffer down when the last capture
+ * client stops.
+ */
+void yutani_capture_stop(yutani_t * y, struct yutani_capture * capture) {
+	if (!capture) return;
+	char key[1024];
+	YUTANI_SHMKEY_EXP(y->server_ident, key, 1024, capture->bufid);
+	yutani_special_request_wid(y, 0, YUTANI_SPECIAL_REQUEST_CAPTURE_STOP);
+	shm_release(key);
+}
+
 /**
  * yutani_session_end
  *
@@ -1081,6 +1314,8 @@ gfx_context_t * init_graphics_yutani(yutani_window_t * window) {
 	out->buffer = window->buffer;
 	out->backbuffer = out->buffer;
 	out->clips  = NULL;
+	out->track_damage = 0;
+	gfx_reset_damage(out);
 	return out;
 }
 
@@ -1122,6 +1357,8 @@ void reinit_graphics_yutani(gfx_context_t * out, yutani_window_t * window) {
 		out->buffer = window->buffer;
 		out->backbuffer = realloc(out->backbuffer, GFX_B(out) * GFX_W(out) * GFX_H(out));
 	}
+
+	gfx_reset_damage(out);
 }
 
 /**
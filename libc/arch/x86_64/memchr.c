@@ -0,0 +1,33 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+void * memchr(const void * src, int c, size_t n) {
+	const unsigned char * s = src;
+	if (!n) return NULL;
+
+	__m128i needle = _mm_set1_epi8((char)c);
+
+	/* Round down to an aligned load - it can't cross into an unmapped
+	 * page - and shift the bytes before the start out of the mask. */
+	uintptr_t off = (uintptr_t)s & 15;
+	const __m128i * p = (const __m128i *)((uintptr_t)s - off);
+	int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), needle)) >> off;
+	if (mask) {
+		size_t pos = __builtin_ctz(mask);
+		return pos < n ? (void *)(s + pos) : NULL;
+	}
+	if (n <= 16 - off) return NULL;
+	n -= 16 - off;
+
+	for (;;) {
+		p++;
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), needle));
+		if (mask) {
+			size_t pos = __builtin_ctz(mask);
+			return pos < n ? (void *)((const unsigned char *)p + pos) : NULL;
+		}
+		if (n <= 16) return NULL;
+		n -= 16;
+	}
+}
@@ -1,9 +1,73 @@
 #include <stddef.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+/* Copies at or above this size go through 'rep movsb'. On processors with
+ * enhanced rep movsb (ERMS) the microcoded copy beats a vector loop from a
+ * couple hundred bytes up; without it only very large copies benefit, so we
+ * probe CPUID once at load time and set the crossover accordingly. Shared
+ * with memset, which has the same tradeoff for 'rep stosb'. */
+int __libc_string_threshold = 65536;
+
+__attribute__((constructor))
+static void _probe_erms(void) {
+	uint32_t eax = 0, ebx, ecx, edx;
+	asm volatile ("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+	if (eax < 7) return;
+	eax = 7;
+	ecx = 0;
+	asm volatile ("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+	if (ebx & (1 << 9)) {
+		__libc_string_threshold = 256;
+	}
+}
 
 void * memcpy(void * restrict dest, const void * restrict src, size_t n) {
-	asm volatile("cld; rep movsb"
-	            : "=c"((int){0})
-	            : "D"(dest), "S"(src), "c"(n)
-	            : "flags", "memory");
+	char * d = dest;
+	const char * s = src;
+
+	if (n < 16) {
+		/* Two possibly-overlapping loads and stores cover any length */
+		if (n >= 8) {
+			uint64_t head = *(const uint64_t *)s;
+			uint64_t tail = *(const uint64_t *)(s + n - 8);
+			*(uint64_t *)d = head;
+			*(uint64_t *)(d + n - 8) = tail;
+		} else if (n >= 4) {
+			uint32_t head = *(const uint32_t *)s;
+			uint32_t tail = *(const uint32_t *)(s + n - 4);
+			*(uint32_t *)d = head;
+			*(uint32_t *)(d + n - 4) = tail;
+		} else if (n >= 2) {
+			uint16_t head = *(const uint16_t *)s;
+			uint16_t tail = *(const uint16_t *)(s + n - 2);
+			*(uint16_t *)d = head;
+			*(uint16_t *)(d + n - 2) = tail;
+		} else if (n) {
+			*d = *s;
+		}
+		return dest;
+	}
+
+	if (n >= (size_t)__libc_string_threshold) {
+		asm volatile("cld; rep movsb"
+		            : "+D"(d), "+S"(s), "+c"(n)
+		            :: "flags", "memory");
+		return dest;
+	}
+
+	/* SSE2, 32 bytes a step; the last (up to) 32 bytes are redone from the
+	 * end with overlapping stores rather than peeled byte by byte. */
+	while (n > 32) {
+		_mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+		_mm_storeu_si128((__m128i *)(d + 16), _mm_loadu_si128((const __m128i *)(s + 16)));
+		d += 32;
+		s += 32;
+		n -= 32;
+	}
+	_mm_storeu_si128((__m128i *)(d + n - 16), _mm_loadu_si128((const __m128i *)(s + n - 16)));
+	if (n > 16) {
+		_mm_storeu_si128((__m128i *)d, _mm_loadu_si128((const __m128i *)s));
+	}
 	return dest;
 }
@@ -0,0 +1,37 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <emmintrin.h>
+
+void * memmove(void * dest, const void * src, size_t n) {
+	char * d = dest;
+	const char * s = src;
+
+	if (d == s || !n) {
+		return dest;
+	}
+
+	/* Only a copy into the tail of its own source has to go backwards */
+	if (d < s || d >= s + n) {
+		return memcpy(dest, src, n);
+	}
+
+	if (n < 16) {
+		while (n--) {
+			d[n] = s[n];
+		}
+		return dest;
+	}
+
+	/* Back to front, 16 bytes a step; each store may overwrite source
+	 * bytes above it, but those have already been copied. The first 16
+	 * bytes are grabbed up front, before any store can touch them, and
+	 * written last to cover whatever the loop leaves at the head. */
+	__m128i head = _mm_loadu_si128((const __m128i *)s);
+	while (n > 16) {
+		n -= 16;
+		_mm_storeu_si128((__m128i *)(d + n), _mm_loadu_si128((const __m128i *)(s + n)));
+	}
+	_mm_storeu_si128((__m128i *)d, head);
+	return dest;
+}
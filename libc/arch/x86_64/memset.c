@@ -1,10 +1,48 @@
 #include <stddef.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+/* Probed at load time in memcpy.c */
+extern int __libc_string_threshold;
 
 void * memset(void * dest, int c, size_t n) {
-	asm volatile("cld; rep stosb"
-	             : "=c"((int){0})
-	             : "rdi"(dest), "a"(c), "c"(n)
-	             : "flags", "memory", "rdi");
+	char * d = dest;
+
+	if (n < 16) {
+		uint64_t fill = 0x0101010101010101ULL * (unsigned char)c;
+		if (n >= 8) {
+			*(uint64_t *)d = fill;
+			*(uint64_t *)(d + n - 8) = fill;
+		} else if (n >= 4) {
+			*(uint32_t *)d = (uint32_t)fill;
+			*(uint32_t *)(d + n - 4) = (uint32_t)fill;
+		} else if (n >= 2) {
+			*(uint16_t *)d = (uint16_t)fill;
+			*(uint16_t *)(d + n - 2) = (uint16_t)fill;
+		} else if (n) {
+			*d = (char)c;
+		}
+		return dest;
+	}
+
+	if (n >= (size_t)__libc_string_threshold) {
+		asm volatile("cld; rep stosb"
+		             : "+D"(d), "+c"(n)
+		             : "a"(c)
+		             : "flags", "memory");
+		return dest;
+	}
+
+	__m128i fill = _mm_set1_epi8((char)c);
+	while (n > 32) {
+		_mm_storeu_si128((__m128i *)d, fill);
+		_mm_storeu_si128((__m128i *)(d + 16), fill);
+		d += 32;
+		n -= 32;
+	}
+	_mm_storeu_si128((__m128i *)(d + n - 16), fill);
+	if (n > 16) {
+		_mm_storeu_si128((__m128i *)d, fill);
+	}
 	return dest;
 }
-
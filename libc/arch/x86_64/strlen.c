@@ -0,0 +1,20 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+size_t strlen(const char * str) {
+	const __m128i zero = _mm_setzero_si128();
+
+	/* Aligned loads stay within the string's page, so scanning a few
+	 * bytes before the start (masked off) or past the NUL is safe. */
+	uintptr_t off = (uintptr_t)str & 15;
+	const __m128i * p = (const __m128i *)((uintptr_t)str - off);
+	int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero)) >> off;
+	if (mask) return __builtin_ctz(mask);
+
+	for (;;) {
+		p++;
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(p), zero));
+		if (mask) return (const char *)p + __builtin_ctz(mask) - str;
+	}
+}
@@ -7,6 +7,7 @@
 #include <bits/dirent.h>
 
 DEFN_SYSCALL3(readdir, SYS_READDIR, int, int, void *);
+DEFN_SYSCALL4(readdir_batch, SYS_READDIR_BATCH, int, long, long, void *);
 
 DIR * opendir (const char * dirname) {
 	int fd = open(dirname, O_RDONLY);
@@ -18,6 +19,8 @@ DIR * opendir (const char * dirname) {
 	DIR * dir = (DIR *)malloc(sizeof(DIR));
 	dir->fd = fd;
 	dir->cur_entry = -1;
+	dir->buf_count = 0;
+	dir->buf_index = 0;
 	return dir;
 }
 
@@ -30,20 +33,23 @@ int closedir (DIR * dir) {
 }
 
 struct dirent * readdir (DIR * dirp) {
-	static struct dirent ent;
-
-	int ret = syscall_readdir(dirp->fd, ++dirp->cur_entry, &ent);
-	if (ret < 0) {
-		errno = -ret;
-		memset(&ent, 0, sizeof(struct dirent));
-		return NULL;
-	}
-
-	if (ret == 0) {
-		/* end of directory */
-		memset(&ent, 0, sizeof(struct dirent));
-		return NULL;
+	if (dirp->buf_index >= dirp->buf_count) {
+		/* Fetch the next run of entries in one syscall. */
+		int ret = syscall_readdir_batch(dirp->fd, dirp->cur_entry + 1, _DIRENT_BATCH, dirp->buf);
+		if (ret < 0) {
+			errno = -ret;
+			return NULL;
+		}
+
+		if (ret == 0) {
+			/* end of directory */
+			return NULL;
+		}
+
+		dirp->buf_count = ret;
+		dirp->buf_index = 0;
 	}
 
-	return &ent;
+	dirp->cur_entry++;
+	return &dirp->buf[dirp->buf_index++];
 }
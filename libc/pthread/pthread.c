@@ -16,14 +16,18 @@
 
 DEFN_SYSCALL3(clone, SYS_CLONE, uintptr_t, uintptr_t, void *);
 DEFN_SYSCALL0(gettid, SYS_GETTID);
+DEFN_SYSCALL3(futex_wait, SYS_FUTEX_WAIT, unsigned int *, unsigned int, int);
+DEFN_SYSCALL2(futex_wake, SYS_FUTEX_WAKE, unsigned int *, int);
+DEFN_SYSCALL3(futex_requeue, SYS_FUTEX_REQUEUE, unsigned int *, int, unsigned int *);
 
 extern int __libc_is_multicore;
-static inline void _yield(void) {
-	if (!__libc_is_multicore) syscall_yield();
-}
 
 #define PTHREAD_STACK_SIZE 0x100000
 
+/* malloc's per-thread magazines; see libc/stdlib/malloc.c */
+extern int __malloc_tls_ready;
+extern void __malloc_thread_exit(void);
+
 int clone(uintptr_t a,uintptr_t b,void* c) {
 	__sets_errno(syscall_clone(a,b,c));
 }
@@ -46,13 +50,18 @@ void __make_tls(void) {
 	char ** tlsSelf  = (char **)(tlsSpace + 4096 - sizeof(char *));
 	*tlsSelf = (char*)tlsSelf;
 	sysfunc(TOARU_SYS_FUNC_SETGSBASE, (char*[]){(char*)tlsSelf});
+	/* This thread has a thread pointer of its own now, so thread-local
+	 * fast paths in the allocator are safe to use. */
+	__malloc_tls_ready = 1;
 }
 
 void * __thread_start(void * thread) {
 	__make_tls();
 	struct pthread * me = ((pthread_t *)thread)->ret_val;
 	((pthread_t *)thread)->ret_val = 0;
-	return me->entry(me->arg);
+	void * ret = me->entry(me->arg);
+	__malloc_thread_exit();
+	return ret;
 }
 
 int pthread_create(pthread_t * thread, pthread_attr_t * attr, void *(*start_routine)(void *), void * arg) {
@@ -79,6 +88,7 @@ void pthread_exit(void * value) {
 	free(stack);
 	/* XXX: Return value!? */
 #endif
+	__malloc_thread_exit();
 	uintptr_t magic_exit_target = 0xFFFFB00F;
 	void (*magic_exit_func)(void) = (void *)magic_exit_target;
 	magic_exit_func();
@@ -92,22 +102,42 @@ void pthread_cleanup_pop(int execute) {
 	/* do nothing */
 }
 
+/* Mutexes are a word: 0 = free, 1 = held, 2 = held with sleepers.
+ * An unlock only pays for a wake syscall when it sees state 2. */
+#define MUTEX_SPIN_MAX 128
+
 int pthread_mutex_lock(pthread_mutex_t *mutex) {
-	while (__sync_lock_test_and_set(mutex, 0x01)) {
-		_yield();
+	/* Uncontended fast path. */
+	if (__sync_bool_compare_and_swap(mutex, 0, 1)) return 0;
+
+	/* Adaptive: spin briefly in case the holder is mid-critical-section
+	 * on another core, then sleep in the kernel until an unlock wakes us. */
+	if (__libc_is_multicore) {
+		for (int i = 0; i < MUTEX_SPIN_MAX; ++i) {
+			if (*mutex == 0 && __sync_bool_compare_and_swap(mutex, 0, 1)) return 0;
+			asm volatile ("pause");
+		}
+	}
+
+	while (__sync_lock_test_and_set(mutex, 2) != 0) {
+		syscall_futex_wait((unsigned int *)mutex, 2, 0);
 	}
 	return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t *mutex) {
-	if (__sync_lock_test_and_set(mutex, 0x01)) {
+	if (!__sync_bool_compare_and_swap(mutex, 0, 1)) {
 		return EBUSY;
 	}
 	return 0;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t *mutex) {
-	__sync_lock_release(mutex);
+	if (__sync_fetch_and_sub(mutex, 1) != 1) {
+		/* There may be sleepers; hand the lock off to one of them. */
+		*mutex = 0;
+		syscall_futex_wake((unsigned int *)mutex, 1);
+	}
 	return 0;
 }
 
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
+
+/* Condition variables are a wake sequence word. Waiters snapshot the
+ * sequence, drop the mutex, and futex-wait for the sequence to move;
+ * the kernel rechecks the snapshot under its own lock, so a signal
+ * landing between the unlock and the sleep is never lost. */
+
+int pthread_cond_init(pthread_cond_t * cond, const pthread_condattr_t * attr) {
+	(void)attr;
+	cond->seq = 0;
+	cond->mutex = NULL;
+	return 0;
+}
+
+int pthread_cond_destroy(pthread_cond_t * cond) {
+	return 0;
+}
+
+int pthread_cond_wait(pthread_cond_t * cond, pthread_mutex_t * mutex) {
+	cond->mutex = mutex;
+	unsigned int seq = cond->seq;
+	pthread_mutex_unlock(mutex);
+	syscall_futex_wait((unsigned int *)&cond->seq, seq, 0);
+	/* Re-acquire with the contended protocol, never the fast path: a
+	 * broadcast may have requeued other waiters onto the mutex word,
+	 * and taking it with CAS(0->1) would leave the mutex in state 1,
+	 * so our unlock would see no sleepers and strand them. Forcing
+	 * state 2 means our unlock always hands the lock on. */
+	while (__sync_lock_test_and_set(mutex, 2) != 0) {
+		syscall_futex_wait((unsigned int *)mutex, 2, 0);
+	}
+	return 0;
+}
+
+int pthread_cond_signal(pthread_cond_t * cond) {
+	__sync_fetch_and_add(&cond->seq, 1);
+	syscall_futex_wake((unsigned int *)&cond->seq, 1);
+	return 0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t * cond) {
+	pthread_mutex_t * mutex = cond->mutex;
+	__sync_fetch_and_add(&cond->seq, 1);
+
+	if (!mutex) {
+		/* Nobody has ever waited; nothing to requeue onto. */
+		syscall_futex_wake((unsigned int *)&cond->seq, INT_MAX);
+		return 0;
+	}
+
+	/* Wake one waiter to run now and move the rest to the mutex, so
+	 * they are released one at a time as the lock is handed off
+	 * instead of all charging a mutex only one of them can take. */
+	syscall_futex_requeue((unsigned int *)&cond->seq, 1, (unsigned int *)mutex);
+
+	/* The requeued waiters are asleep on the mutex word now; make sure
+	 * the eventual unlock sees the contended state and wakes them. If
+	 * the mutex turns out to be free, that unlock already happened. */
+	if (__sync_val_compare_and_swap(mutex, 1, 2) == 0) {
+		syscall_futex_wake((unsigned int *)mutex, INT_MAX);
+	}
+	return 0;
+}
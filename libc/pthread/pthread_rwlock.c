@@ -6,20 +6,36 @@
 #include <signal.h>
 #include <pthread.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <sys/wait.h>
 
 extern int __libc_is_multicore;
-static inline void _yield(void) {
-	if (!__libc_is_multicore) syscall_yield();
+
+/* lock->readers counts the holders: -1 a writer, 0 free, n readers.
+ * lock->atomic_lock is a wake sequence; sleepers futex-wait on it and
+ * every release that could admit someone bumps it and wakes them. */
+#define RWLOCK_SPIN_MAX 128
+
+static void _rwlock_sleep(pthread_rwlock_t * lock, int want_write) {
+	int seq = lock->atomic_lock;
+	/* Readers only need to wait out a writer; writers wait out anyone.
+	 * The kernel rechecks the sequence under its lock, so a release
+	 * between this test and the sleep can't strand us. */
+	if (want_write ? (lock->readers != 0) : (lock->readers < 0)) {
+		syscall_futex_wait((unsigned int *)&lock->atomic_lock, seq, 0);
+	}
 }
 
-#define ACQUIRE_LOCK() do { while (__sync_lock_test_and_set(&lock->atomic_lock, 0x01)) { _yield(); } } while (0)
-#define RELEASE_LOCK() do { __sync_lock_release(&lock->atomic_lock); } while (0)
+static void _rwlock_wake(pthread_rwlock_t * lock) {
+	__sync_fetch_and_add(&lock->atomic_lock, 1);
+	syscall_futex_wake((unsigned int *)&lock->atomic_lock, INT_MAX);
+}
 
 int pthread_rwlock_init(pthread_rwlock_t * lock, void * args) {
 	lock->readers = 0;
 	lock->atomic_lock = 0;
+	lock->writerPid = 0;
 	if (args != NULL) {
 		fprintf(stderr, "pthread: pthread_rwlock_init arg unsupported\n");
 		return 1;
@@ -28,36 +44,52 @@ int pthread_rwlock_init(pthread_rwlock_t * lock, void * args) {
 }
 
 int pthread_rwlock_wrlock(pthread_rwlock_t * lock) {
-	ACQUIRE_LOCK();
+	int spins = __libc_is_multicore ? RWLOCK_SPIN_MAX : 0;
 	while (1) {
-		if (lock->readers == 0) {
-			lock->readers = -1;
+		if (lock->readers == 0 && __sync_bool_compare_and_swap(&lock->readers, 0, -1)) {
 			lock->writerPid = syscall_getpid();
-			RELEASE_LOCK();
 			return 0;
 		}
-		_yield();
+		if (spins > 0) {
+			spins--;
+			asm volatile ("pause");
+			continue;
+		}
+		_rwlock_sleep(lock, 1);
 	}
 }
 
 int pthread_rwlock_rdlock(pthread_rwlock_t * lock) {
-	ACQUIRE_LOCK();
+	int spins = __libc_is_multicore ? RWLOCK_SPIN_MAX : 0;
 	while (1) {
-		if (lock->readers >= 0) {
-			lock->readers++;
-			RELEASE_LOCK();
+		int readers = lock->readers;
+		if (readers >= 0 && __sync_bool_compare_and_swap(&lock->readers, readers, readers + 1)) {
 			return 0;
 		}
-		_yield();
+		if (spins > 0) {
+			spins--;
+			asm volatile ("pause");
+			continue;
+		}
+		_rwlock_sleep(lock, 0);
 	}
 }
 
 int pthread_rwlock_unlock(pthread_rwlock_t * lock) {
-	ACQUIRE_LOCK();
-	if (lock->readers > 0) lock->readers--;
-	else if (lock->readers < 0) lock->readers = 0;
-	else fprintf(stderr, "pthread: bad lock state detected\n");
-	RELEASE_LOCK();
+	int readers = lock->readers;
+	if (readers < 0) {
+		lock->writerPid = 0;
+		lock->readers = 0;
+	} else if (readers > 0) {
+		if (__sync_sub_and_fetch(&lock->readers, 1) > 0) {
+			/* Other readers still hold the lock; nothing to admit. */
+			return 0;
+		}
+	} else {
+		fprintf(stderr, "pthread: bad lock state detected\n");
+		return 0;
+	}
+	_rwlock_wake(lock);
 	return 0;
 }
 
@@ -0,0 +1,21 @@
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <sched.h>
+#include <errno.h>
+
+DEFN_SYSCALL2(setaffinity, SYS_SETAFFINITY, int, unsigned int);
+DEFN_SYSCALL1(getaffinity, SYS_GETAFFINITY, int);
+
+int sched_setaffinity(pid_t pid, unsigned int mask) {
+	__sets_errno(syscall_setaffinity(pid, mask));
+}
+
+int sched_getaffinity(pid_t pid, unsigned int * mask) {
+	long result = syscall_getaffinity(pid);
+	if (result < 0) {
+		errno = -result;
+		return -1;
+	}
+	if (mask) *mask = result;
+	return 0;
+}
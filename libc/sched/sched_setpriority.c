@@ -0,0 +1,10 @@
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <sched.h>
+#include <errno.h>
+
+DEFN_SYSCALL2(setpriority, SYS_SETPRIORITY, int, int);
+
+int sched_setpriority(pid_t pid, int priority) {
+	__sets_errno(syscall_setpriority(pid, priority));
+}
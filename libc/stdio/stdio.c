@@ -2,10 +2,15 @@
 #include <syscall.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 
+/* Streams backed by regular files get a bigger buffer than BUFSIZ so
+ * sequential filters do a handful of syscalls instead of thousands. */
+#define FILE_BUFSIZ 0x10000
+
 struct _FILE {
 	int fd;
 
@@ -23,6 +28,9 @@ struct _FILE {
 	size_t written;
 	size_t wbufsiz;
 
+	int bufmode;
+	int user_buf;
+
 	struct _FILE * prev;
 	struct _FILE * next;
 };
@@ -41,6 +49,7 @@ FILE _stdin = {
 	.wbufsiz = BUFSIZ,
 	.write_buf = NULL,
 	.written = 0,
+	.bufmode = _IOLBF,
 };
 
 FILE _stdout = {
@@ -57,6 +66,7 @@ FILE _stdout = {
 	.wbufsiz = BUFSIZ,
 	.write_buf = NULL,
 	.written = 0,
+	.bufmode = _IOLBF,
 };
 
 FILE _stderr = {
@@ -73,6 +83,7 @@ FILE _stderr = {
 	.wbufsiz = BUFSIZ,
 	.write_buf = NULL,
 	.written = 0,
+	.bufmode = _IOLBF,
 };
 
 FILE * stdin = &_stdin;
@@ -113,19 +124,41 @@ extern int __libc_debug;
 extern char * _argv_0;
 
 int setvbuf(FILE * stream, char * buf, int mode, size_t size) {
-	if (mode != _IOLBF) {
-		return -1; /* Unsupported */
+	if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+		return -1;
+	}
+	if (stream->available) {
+		return -1; /* Too late - there is buffered input we would lose */
+	}
+	fflush(stream);
+	stream->bufmode = mode;
+	if (mode == _IONBF || size == 0) {
+		return 0;
+	}
+	if (stream->read_buf && !stream->user_buf) {
+		free(stream->read_buf);
 	}
 	if (buf) {
-		if (stream->read_buf) {
-			free(stream->read_buf);
-		}
+		/* A caller-provided buffer serves the read side and is theirs to free. */
 		stream->read_buf = buf;
-		stream->bufsiz = size;
+		stream->user_buf = 1;
+	} else {
+		stream->read_buf = malloc(size);
+		stream->user_buf = 0;
+		if (stream->write_buf) {
+			free(stream->write_buf);
+			stream->write_buf = malloc(size);
+			stream->wbufsiz = size;
+		}
 	}
+	stream->bufsiz = size;
+	stream->offset = 0;
+	stream->read_from = 0;
 	return 0;
 }
 
+int fflush_unlocked(FILE * stream) __attribute__((weak, alias("fflush")));
+
 int fflush(FILE * stream) {
 	if (!stream->write_buf) return EOF;
 	if (stream->written) {
@@ -138,15 +171,42 @@ int fflush(FILE * stream) {
 static size_t write_bytes(FILE * f, char * buf, size_t len) {
 	if (!f->write_buf) return 0;
 
+	if (f->bufmode == _IONBF) {
+		fflush(f);
+		syscall_write(f->fd, buf, len);
+		return len;
+	}
+
 	size_t newBytes = 0;
 	while (len > 0) {
-		f->write_buf[f->written++] = *buf;
-		if (f->written == (size_t)f->wbufsiz || *buf == '\n') {
+		if (f->written == (size_t)f->wbufsiz) {
+			fflush(f);
+		}
+		/* A full-buffer-or-more write to a fully buffered stream goes
+		 * straight to the kernel instead of being copied in pieces. */
+		if (f->bufmode == _IOFBF && !f->written && len >= (size_t)f->wbufsiz) {
+			syscall_write(f->fd, buf, len);
+			return newBytes + len;
+		}
+		size_t space = f->wbufsiz - f->written;
+		size_t chunk = len < space ? len : space;
+		int flush_after = 0;
+		if (f->bufmode == _IOLBF) {
+			/* Only take up to the last newline in one go, then flush */
+			char * nl = memrchr(buf, '\n', chunk);
+			if (nl) {
+				chunk = nl - buf + 1;
+				flush_after = 1;
+			}
+		}
+		memcpy(&f->write_buf[f->written], buf, chunk);
+		f->written += chunk;
+		newBytes += chunk;
+		buf += chunk;
+		len -= chunk;
+		if (flush_after) {
 			fflush(f);
 		}
-		newBytes++;
-		buf++;
-		len--;
 	}
 
 	return newBytes;
@@ -169,6 +229,25 @@ static size_t read_bytes(FILE * f, char * out, size_t len) {
 		}
 
 		if (f->available == 0) {
+			/* Requests of at least a whole buffer skip the buffer and
+			 * read straight into the destination. */
+			if (len >= (size_t)f->bufsiz) {
+				ssize_t r = read(fileno(f), out, len);
+				if (r < 0) {
+					return r_out;
+				}
+				if (r == 0) {
+					f->eof = 1;
+					return r_out;
+				}
+				out += r;
+				len -= r;
+				r_out += r;
+				f->last_read_start = syscall_seek(f->fd, 0, SEEK_CUR);
+				f->read_from = 0;
+				f->offset = 0;
+				continue;
+			}
 			if (f->offset == f->bufsiz) {
 				f->offset = 0;
 			}
@@ -191,15 +270,13 @@ static size_t read_bytes(FILE * f, char * out, size_t len) {
 			return r_out;
 		}
 
-		//fprintf(stderr, "%s: reading until %d reaches %d or %d reaches 0\n", _argv_0, f->read_from, f->offset, len);
-		while (f->read_from < f->offset && len > 0 && f->available > 0) {
-			*out = f->read_buf[f->read_from];
-			len--;
-			f->read_from++;
-			f->available--;
-			out++;
-			r_out += 1;
-		}
+		size_t chunk = (size_t)f->available < len ? (size_t)f->available : len;
+		memcpy(out, &f->read_buf[f->read_from], chunk);
+		f->read_from += chunk;
+		f->available -= chunk;
+		out += chunk;
+		len -= chunk;
+		r_out += chunk;
 	}
 
 	//fprintf(stderr, "%s: read completed, returning read value of %d\n", _argv_0, r_out);
@@ -247,21 +324,27 @@ FILE * fopen(const char *path, const char *mode) {
 		return NULL;
 	}
 
+	/* Regular files get big, fully buffered streams; everything else
+	 * (ttys, pipes, devices) keeps line buffering and BUFSIZ. */
+	struct stat statbuf;
+	int bufsiz = (fstat(fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode)) ? FILE_BUFSIZ : BUFSIZ;
+
 	FILE * out = malloc(sizeof(FILE));
 	memset(out, 0, sizeof(struct _FILE));
 	out->fd = fd;
-	out->read_buf = malloc(BUFSIZ);
-	out->bufsiz = BUFSIZ;
+	out->read_buf = malloc(bufsiz);
+	out->bufsiz = bufsiz;
 	out->available = 0;
 	out->read_from = 0;
 	out->offset = 0;
 	out->ungetc = -1;
 	out->eof = 0;
+	out->bufmode = (bufsiz == FILE_BUFSIZ) ? _IOFBF : _IOLBF;
 	out->_name = strdup(path);
 
-	out->write_buf = malloc(BUFSIZ);
+	out->write_buf = malloc(bufsiz);
 	out->written = 0;
-	out->wbufsiz = BUFSIZ;
+	out->wbufsiz = bufsiz;
 
 	out->next = _head;
 	if (_head) _head->prev = out;
@@ -309,24 +392,28 @@ int ungetc(int c, FILE * stream) {
 }
 
 FILE * fdopen(int fd, const char *mode){
+	struct stat statbuf;
+	int bufsiz = (fstat(fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode)) ? FILE_BUFSIZ : BUFSIZ;
+
 	FILE * out = malloc(sizeof(FILE));
 	memset(out, 0, sizeof(struct _FILE));
 	out->fd = fd;
-	out->read_buf = malloc(BUFSIZ);
-	out->bufsiz = BUFSIZ;
+	out->read_buf = malloc(bufsiz);
+	out->bufsiz = bufsiz;
 	out->available = 0;
 	out->read_from = 0;
 	out->offset = 0;
 	out->ungetc = -1;
 	out->eof = 0;
+	out->bufmode = (bufsiz == FILE_BUFSIZ) ? _IOFBF : _IOLBF;
 
 	char tmp[30];
 	sprintf(tmp, "fd[%d]", fd);
 	out->_name = strdup(tmp);
 
-	out->write_buf = malloc(BUFSIZ);
+	out->write_buf = malloc(bufsiz);
 	out->written = 0;
-	out->wbufsiz = BUFSIZ;
+	out->wbufsiz = bufsiz;
 
 	out->next = _head;
 	if (_head) _head->prev = out;
@@ -343,7 +430,7 @@ int fclose(FILE * stream) {
 	fflush(stream);
 	int out = syscall_close(stream->fd);
 	free(stream->_name);
-	free(stream->read_buf);
+	if (!stream->user_buf) free(stream->read_buf);
 	if (stream->write_buf) free(stream->write_buf);
 	stream->write_buf = NULL;
 	if (stream == &_stdin || stream == &_stdout || stream == &_stderr) {
@@ -431,35 +518,22 @@ int fsetpos(FILE *stream, const fpos_t *pos) {
 }
 
 size_t fread(void *ptr, size_t size, size_t nmemb, FILE * stream) {
-	char * tracking = (char*)ptr;
-	for (size_t i = 0; i < nmemb; ++i) {
-		int r = read_bytes(stream, tracking, size);
-		if (r < 0) {
-			return -1;
-		}
-		tracking += r;
-		if (r < (int)size) {
-			return i;
-		}
-	}
-	return nmemb;
+	if (!size || !nmemb) return 0;
+	size_t r = read_bytes(stream, ptr, size * nmemb);
+	if (r == size * nmemb) return nmemb;
+	return r / size;
 }
 
 size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE * stream) {
-	char * tracking = (char*)ptr;
-	for (size_t i = 0; i < nmemb; ++i) {
-		int r = write_bytes(stream, tracking, size);
-		if (r < 0) {
-			return -1;
-		}
-		tracking += r;
-		if (r < (int)size) {
-			return i;
-		}
-	}
-	return nmemb;
+	if (!size || !nmemb) return 0;
+	size_t r = write_bytes(stream, (char*)ptr, size * nmemb);
+	if (r == size * nmemb) return nmemb;
+	return r / size;
 }
 
+size_t fread_unlocked(void *ptr, size_t size, size_t nmemb, FILE * stream) __attribute__((weak, alias("fread")));
+size_t fwrite_unlocked(const void *ptr, size_t size, size_t nmemb, FILE * stream) __attribute__((weak, alias("fwrite")));
+
 int fileno(FILE * stream) {
 	return stream->fd;
 }
@@ -479,6 +553,14 @@ int fputc(int c, FILE *stream) {
 
 int putc(int c, FILE *stream) __attribute__((weak, alias("fputc")));
 
+/*
+ * stdio does no locking, so the _unlocked variants are the same
+ * functions; they exist so portable code that batches its own locking
+ * can call the names it expects.
+ */
+int fputc_unlocked(int c, FILE *stream) __attribute__((weak, alias("fputc")));
+int putc_unlocked(int c, FILE *stream) __attribute__((weak, alias("fputc")));
+
 int fgetc(FILE * stream) {
 	char buf[1];
 	int r;
@@ -494,6 +576,8 @@ int fgetc(FILE * stream) {
 }
 
 int getc(FILE * stream) __attribute__((weak, alias("fgetc")));
+int fgetc_unlocked(FILE * stream) __attribute__((weak, alias("fgetc")));
+int getc_unlocked(FILE * stream) __attribute__((weak, alias("fgetc")));
 
 int getchar(void) {
 	return fgetc(stdin);
@@ -533,7 +617,7 @@ void rewind(FILE *stream) {
 }
 
 void setbuf(FILE * stream, char * buf) {
-	// ...
+	setvbuf(stream, buf, buf ? _IOFBF : _IONBF, BUFSIZ);
 }
 
 int feof(FILE * stream) {
@@ -3,17 +3,63 @@
 
 extern char ** environ;
 
+/* Lazily-built hash index over environ, so the linker and shell don't
+ * strcmp their way down the whole array for every lookup. putenv and
+ * friends mark the index dirty; a program swapping in an entirely new
+ * environ array is caught by remembering which array we indexed. */
+#define ENV_BUCKETS 64
+
+struct env_node {
+	char * entry;
+	struct env_node * next;
+};
+
+int __environ_dirty = 1;
+static char ** _indexed_environ = NULL;
+static struct env_node * _nodes = NULL;
+static struct env_node * _buckets[ENV_BUCKETS];
+
+static unsigned int env_hash(const char * s) {
+	/* sdbm, as in the userspace hashmap library, stopping at the '=' */
+	unsigned int hash = 0;
+	int c;
+	while ((c = *(unsigned char *)s++) && c != '=') {
+		hash = c + (hash << 6) + (hash << 16) - hash;
+	}
+	return hash;
+}
+
+static void env_reindex(void) {
+	size_t count = 0;
+	for (char ** e = environ; *e; e++) count++;
+
+	memset(_buckets, 0, sizeof(_buckets));
+	free(_nodes);
+	_nodes = count ? malloc(count * sizeof(struct env_node)) : NULL;
+
+	for (size_t i = 0; i < count; ++i) {
+		unsigned int bucket = env_hash(environ[i]) & (ENV_BUCKETS - 1);
+		_nodes[i].entry = environ[i];
+		_nodes[i].next = _buckets[bucket];
+		_buckets[bucket] = &_nodes[i];
+	}
+
+	_indexed_environ = environ;
+	__environ_dirty = 0;
+}
+
 char * getenv(const char *name) {
-	char ** e = environ;
+	if (!environ) return NULL;
+	if (__environ_dirty || _indexed_environ != environ) {
+		env_reindex();
+	}
+
 	size_t len = strlen(name);
-	while (*e) {
-		char * t = *e;
-		if (strstr(t, name) == *e) {
-			if (t[len] == '=') {
-				return &t[len+1];
-			}
+	struct env_node * n = _buckets[env_hash(name) & (ENV_BUCKETS - 1)];
+	for (; n; n = n->next) {
+		if (!strncmp(n->entry, name, len) && n->entry[len] == '=') {
+			return &n->entry[len+1];
 		}
-		e++;
 	}
 	return NULL;
 }
@@ -144,6 +144,9 @@ static void * __attribute__ ((malloc)) klcalloc(uintptr_t nmemb, uintptr_t size)
 static void * __attribute__ ((malloc)) klvalloc(uintptr_t size);
 static void klfree(void * ptr);
 
+static void * klmalloc_magazine_alloc(uintptr_t size);
+static int klmalloc_magazine_free(void * ptr);
+
 static int volatile mem_lock = 0;
 static const char * _lock_holder;
 
@@ -183,8 +186,10 @@ static void spin_unlock(int volatile * lock) {
 
 
 void * __attribute__ ((malloc)) malloc(uintptr_t size) {
+	void * ret = klmalloc_magazine_alloc(size);
+	if (ret) return ret;
 	spin_lock(&mem_lock, __FUNCTION__);
-	void * ret = klmalloc(size);
+	ret = klmalloc(size);
 	spin_unlock(&mem_lock);
 	return ret;
 }
@@ -211,6 +216,7 @@ void * __attribute__ ((malloc)) valloc(uintptr_t size) {
 }
 
 void free(void * ptr) {
+	if (klmalloc_magazine_free(ptr)) return;
 	spin_lock(&mem_lock, __FUNCTION__);
 	klfree(ptr);
 	spin_unlock(&mem_lock);
@@ -257,6 +263,7 @@ typedef struct _klmalloc_bin_header {
 	void * head;							/* Head of this bin. */
 	uintptr_t size;							/* Size of this bin, if big; otherwise bin index. */
 	uint32_t bin_magic;
+	uint32_t free_count;					/* Number of free cells; small bins only. */
 } klmalloc_bin_header;
 
 /*
@@ -290,6 +297,7 @@ static struct _klmalloc_big_bins {
 	int level;
 } klmalloc_big_bins;
 static klmalloc_big_bin_header * klmalloc_newest_big = NULL;		/* Newest big bin */
+static klmalloc_bin_header * klmalloc_empty_pages = NULL;			/* Fully-freed small-bin pages banked for reuse */
 
 /* }}} Bin management */
 /* Doubly-Linked List {{{ */
@@ -607,6 +615,132 @@ static inline int __attribute__ ((always_inline)) klmalloc_stack_empty(klmalloc_
 }
 
 /* }}} Stack */
+/* Per-thread magazines {{{ */
+
+/*
+ * Each thread keeps a small cache (a "magazine") of cells for every
+ * small bin so the common malloc/free pair never touches the global
+ * lock. The lock is only taken to refill an empty magazine, to flush a
+ * full one, and for anything involving big bins. The arena holding the
+ * magazines is allocated lazily out of the locked allocator the first
+ * time a thread refills, and handed back wholesale when it exits.
+ */
+#define MAGAZINE_CAP 32
+
+typedef struct _klmalloc_arena {
+	void * magazine[NUM_BINS - 1][MAGAZINE_CAP];
+	int    count[NUM_BINS - 1];
+} klmalloc_arena;
+
+/*
+ * The arena pointer must be initial-exec: the default dynamic TLS model
+ * would route every access through __tls_get_addr, which our linker
+ * does not implement - and which would mean a function call in the
+ * hottest path of the library anyway.
+ */
+static __thread klmalloc_arena * klmalloc_thread_arena __attribute__((tls_model("initial-exec")));
+
+/*
+ * Set from __make_tls once the calling thread has a thread pointer of
+ * its own. Before that - early startup, or a fresh thread that has not
+ * reached __make_tls yet - thread-local reads land in the creator's
+ * block and the magazines must not be touched. ld.so forces this back
+ * to zero for its private copy of the allocator.
+ */
+int __malloc_tls_ready = 0;
+
+/*
+ * Satisfy an allocation from the calling thread's magazine, refilling
+ * it from the shared slabs if need be. Returns NULL if the request is
+ * not eligible (too big, or no usable thread pointer yet) and the
+ * caller should take the locked path.
+ */
+static void * klmalloc_magazine_alloc(uintptr_t size) {
+	if (!__malloc_tls_ready || __builtin_expect(size == 0, 0)) {
+		return NULL;
+	}
+	uintptr_t bucket = klmalloc_bin_size(size);
+	if (bucket >= BIG_BIN) {
+		return NULL;
+	}
+	klmalloc_arena * arena = klmalloc_thread_arena;
+	if (arena && arena->count[bucket]) {
+		return arena->magazine[bucket][--arena->count[bucket]];
+	}
+	spin_lock(&mem_lock, __FUNCTION__);
+	if (!arena) {
+		arena = klcalloc(1, sizeof(klmalloc_arena));
+		klmalloc_thread_arena = arena;
+	}
+	void * ret;
+	if (arena) {
+		int i;
+		for (i = 0; i < MAGAZINE_CAP / 2; ++i) {
+			arena->magazine[bucket][i] = klmalloc(SMALLEST_BIN << bucket);
+		}
+		arena->count[bucket] = MAGAZINE_CAP / 2 - 1;
+		ret = arena->magazine[bucket][MAGAZINE_CAP / 2 - 1];
+	} else {
+		ret = klmalloc(size);
+	}
+	spin_unlock(&mem_lock);
+	return ret;
+}
+
+/*
+ * Return a cell to the calling thread's magazine, flushing the cold
+ * half back to the shared slabs when it is full. Returns zero if the
+ * pointer is not a small-bin cell (or there is no arena), in which
+ * case the caller must free it under the lock.
+ */
+static int klmalloc_magazine_free(void * ptr) {
+	if (!__malloc_tls_ready || !ptr || !((uintptr_t)ptr & PAGE_MASK)) {
+		return 0;
+	}
+	klmalloc_bin_header * header = (klmalloc_bin_header *)((uintptr_t)ptr & (uintptr_t)~PAGE_MASK);
+	if (header->bin_magic != BIN_MAGIC || header->size >= (uintptr_t)BIG_BIN) {
+		return 0;
+	}
+	klmalloc_arena * arena = klmalloc_thread_arena;
+	if (!arena) {
+		return 0;
+	}
+	uintptr_t bucket = header->size;
+	if (arena->count[bucket] == MAGAZINE_CAP) {
+		int i;
+		spin_lock(&mem_lock, __FUNCTION__);
+		for (i = 0; i < MAGAZINE_CAP / 2; ++i) {
+			klfree(arena->magazine[bucket][i]);
+		}
+		spin_unlock(&mem_lock);
+		memcpy(&arena->magazine[bucket][0], &arena->magazine[bucket][MAGAZINE_CAP / 2], (MAGAZINE_CAP / 2) * sizeof(void *));
+		arena->count[bucket] = MAGAZINE_CAP / 2;
+	}
+	arena->magazine[bucket][arena->count[bucket]++] = ptr;
+	return 1;
+}
+
+/*
+ * Hand a departing thread's cached cells back to the shared allocator.
+ * Called from pthread_exit and the thread start wrapper; without this,
+ * every short-lived thread would strand a few kilobytes of cells.
+ */
+void __malloc_thread_exit(void) {
+	klmalloc_arena * arena = klmalloc_thread_arena;
+	if (!arena) return;
+	klmalloc_thread_arena = NULL;
+	spin_lock(&mem_lock, __FUNCTION__);
+	unsigned int bucket;
+	for (bucket = 0; bucket < NUM_BINS - 1; ++bucket) {
+		while (arena->count[bucket]) {
+			klfree(arena->magazine[bucket][--arena->count[bucket]]);
+		}
+	}
+	klfree(arena);
+	spin_unlock(&mem_lock);
+}
+
+/* }}} Per-thread magazines */
 
 /* malloc() {{{ */
 static void * __attribute__ ((malloc)) klmalloc(uintptr_t size) {
@@ -631,9 +765,16 @@ static void * __attribute__ ((malloc)) klmalloc(uintptr_t size) {
 		klmalloc_bin_header * bin_header = klmalloc_list_head(&klmalloc_bin_head[bucket_id]);
 		if (!bin_header) {
 			/*
-			 * Grow the heap for the new bin.
+			 * Reuse a fully-freed page if we have one banked,
+			 * otherwise grow the heap for the new bin.
 			 */
-			bin_header = (klmalloc_bin_header*)sbrk(PAGE_SIZE);
+			if (klmalloc_empty_pages) {
+				bin_header = klmalloc_empty_pages;
+				klmalloc_empty_pages = bin_header->next;
+				bin_header->next = NULL;
+			} else {
+				bin_header = (klmalloc_bin_header*)sbrk(PAGE_SIZE);
+			}
 			bin_header->bin_magic = BIN_MAGIC;
 			assert((uintptr_t)bin_header % PAGE_SIZE == 0);
 
@@ -668,8 +809,10 @@ static void * __attribute__ ((malloc)) klmalloc(uintptr_t size) {
 			}
 			base[available << bucket_id] = NULL;
 			bin_header->size = bucket_id;
+			bin_header->free_count = available + 1;
 		}
 		uintptr_t ** item = klmalloc_stack_pop(bin_header);
+		bin_header->free_count--;
 		if (klmalloc_stack_empty(bin_header)) {
 			klmalloc_list_decouple(&(klmalloc_bin_head[bucket_id]),bin_header);
 		}
@@ -900,6 +1043,19 @@ static void klfree(void *ptr) {
 		 * Push new space back into the stack.
 		 */
 		klmalloc_stack_push(header, ptr);
+		header->free_count++;
+		/*
+		 * If every cell in this page is free again and it isn't the
+		 * only page serving its bin, pull it off the bin list and
+		 * bank it for reuse by any size class.
+		 */
+		if (header->free_count == ((PAGE_SIZE - sizeof(klmalloc_bin_header)) >> (SMALLEST_BIN_LOG + bucket_id)) &&
+		    klmalloc_list_head(&klmalloc_bin_head[bucket_id]) == header && header->next) {
+			klmalloc_list_decouple(&klmalloc_bin_head[bucket_id], header);
+			header->bin_magic = 0;
+			header->next = klmalloc_empty_pages;
+			klmalloc_empty_pages = header;
+		}
 	}
 }
 /* }}} */
@@ -932,7 +1088,8 @@ static void * __attribute__ ((malloc)) klrealloc(void *ptr, uintptr_t size) {
 	 */
 	if (__builtin_expect(size == 0, 0))
 	{
-		free(ptr);
+		/* klfree, not free - we are already holding the lock. */
+		klfree(ptr);
 		return NULL;
 	}
 
@@ -4,6 +4,7 @@
 
 extern char ** environ;
 extern int _environ_size;
+extern int __environ_dirty;
 
 static int why_no_strnstr(char * a, char * b, int n) {
 	for (int i = 0; (i < n) && (a[i]) && (b[i]); ++i) {
@@ -34,12 +35,14 @@ int unsetenv(const char * str) {
 	if (last_index == found_index) {
 		/* Was last element */
 		environ[last_index] = NULL;
+		__environ_dirty = 1;
 		return 0;
 	}
 
 	/* Was not last element, swap ordering */
 	environ[found_index] = environ[last_index];
 	environ[last_index] = NULL;
+	__environ_dirty = 1;
 	return 0;
 }
 
@@ -59,6 +62,7 @@ int putenv(char * string) {
 	for (i = 0; i < (_environ_size - 1) && environ[i]; ++i) {
 		if (!why_no_strnstr(name, environ[i], s) && environ[i][s] == '=') {
 			environ[i] = string;
+			__environ_dirty = 1;
 			return 0;
 		}
 	}
@@ -80,5 +84,6 @@ int putenv(char * string) {
 	}
 
 	environ[i] = string;
+	__environ_dirty = 1;
 	return 0;
 }
@@ -23,6 +23,8 @@ int memcmp(const void * vl, const void * vr, size_t n) {
 	return n ? *l-*r : 0;
 }
 
+#ifndef __x86_64__
+/* x86-64 gets an SSE2 version from libc/arch/x86_64/memchr.c */
 void * memchr(const void * src, int c, size_t n) {
 	const unsigned char * s = src;
 	c = (unsigned char)c;
@@ -35,6 +37,7 @@ void * memchr(const void * src, int c, size_t n) {
 	}
 	return n ? (void *)s : 0;
 }
+#endif
 
 void * memrchr(const void * m, int c, size_t n) {
 	const unsigned char * s = m;
@@ -56,6 +59,8 @@ int strcoll(const char * s1, const char * s2) {
 	return strcmp(s1,s2); /* TODO locales */
 }
 
+#ifndef __x86_64__
+/* x86-64 gets an SSE2 version from libc/arch/x86_64/strlen.c */
 size_t strlen(const char * s) {
 	const char * a = s;
 	const size_t * w;
@@ -68,6 +73,7 @@ size_t strlen(const char * s) {
 	for (s = (const void *)w; *s; s++);
 	return s-a;
 }
+#endif
 
 char * strdup(const char * s) {
 	size_t l = strlen(s);
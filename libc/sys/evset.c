@@ -0,0 +1,20 @@
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <sys/evset.h>
+#include <errno.h>
+
+DEFN_SYSCALL0(evset_create, SYS_EVSET_CREATE);
+DEFN_SYSCALL3(evset_ctl, SYS_EVSET_CTL, int, int, int);
+DEFN_SYSCALL4(evset_wait, SYS_EVSET_WAIT, int, int *, int, int);
+
+int evset_create(void) {
+	__sets_errno(syscall_evset_create());
+}
+
+int evset_ctl(int setfd, int op, int fd) {
+	__sets_errno(syscall_evset_ctl(setfd, op, fd));
+}
+
+int evset_wait(int setfd, int * out, int max, int timeout) {
+	__sets_errno(syscall_evset_wait(setfd, out, max, timeout));
+}
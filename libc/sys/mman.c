@@ -0,0 +1,41 @@
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+
+DEFN_SYSCALL5(mmap,   SYS_MMAP, uintptr_t, size_t, int, long, int);
+DEFN_SYSCALL2(munmap, SYS_MUNMAP, uintptr_t, size_t);
+
+/* File-backed mappings only: pages are shared out of the kernel page
+ * cache read-only and split into private copies on write, so MAP_PRIVATE
+ * behaves as expected. MAP_SHARED without PROT_WRITE maps the cache
+ * pages permanently read-only - one physical copy system-wide; writable
+ * shared mappings are not supported and quietly fall back to private.
+ * For anonymous memory, use malloc (or the sysfunc mmap, which this is
+ * not). */
+void * mmap(void * addr, size_t len, int prot, int flags, int fd, off_t offset) {
+	if (prot & PROT_WRITE) {
+		flags &= ~MAP_SHARED;
+	}
+
+	if (!addr) {
+		/* The kernel does not pick addresses; carve space out of the
+		 * heap. sbrk'd pages are zero-page-backed until touched, so
+		 * mapping over them wastes nothing. */
+		addr = sbrk((len + 0xFFF) & ~(size_t)0xFFF);
+		if (addr == (void*)-1) return MAP_FAILED;
+	}
+
+	long ret = syscall_mmap((uintptr_t)addr, len, fd, offset, flags);
+	if (ret < 0) {
+		errno = -ret;
+		return MAP_FAILED;
+	}
+	return (void *)ret;
+}
+
+int munmap(void * addr, size_t len) {
+	__sets_errno(syscall_munmap((uintptr_t)addr, len));
+}
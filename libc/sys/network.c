@@ -29,6 +29,7 @@ DEFN_SYSCALL5(getsockopt, SYS_GETSOCKOPT, int,int,int,void*,size_t*);
 DEFN_SYSCALL3(recv, SYS_RECV, int,void*,int);
 DEFN_SYSCALL3(send, SYS_SEND, int,const void*,int);
 DEFN_SYSCALL2(shutdown, SYS_SHUTDOWN, int, int);
+DEFN_SYSCALL4(socketpair, SYS_SOCKETPAIR, int,int,int,int*);
 
 int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
 	__sets_errno(syscall_connect(sockfd,addr,addrlen));
@@ -110,6 +111,10 @@ int socket(int domain, int type, int protocol) {
 	__sets_errno(syscall_socket(domain,type,protocol));
 }
 
+int socketpair(int domain, int type, int protocol, int sv[2]) {
+	__sets_errno(syscall_socketpair(domain,type,protocol,sv));
+}
+
 uint32_t htonl(uint32_t hostlong) {
 	return ( (((hostlong) & 0xFF) << 24) | (((hostlong) & 0xFF00) << 8) | (((hostlong) & 0xFF0000) >> 8) | (((hostlong) & 0xFF000000) >> 24));
 }
@@ -0,0 +1,55 @@
+#include <syscall.h>
+#include <syscall_nums.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/spawn.h>
+
+DEFN_SYSCALL3(spawn, SYS_SPAWN, char *, char **, char **);
+
+extern char ** environ;
+
+pid_t spawnve(const char * path, char * const argv[], char * const envp[]) {
+	__sets_errno(syscall_spawn((char*)path, (char**)argv, (char**)envp));
+}
+
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+pid_t spawnvp(const char * file, char * const argv[]) {
+	if (file && (!strstr(file, "/"))) {
+		/* Same rough "$PATH" handling as execvp... */
+		char * path = getenv("PATH");
+		if (!path) {
+			path = DEFAULT_PATH;
+		}
+		char * xpath = strdup(path);
+		char * p, * last;
+		for ((p = strtok_r(xpath, ":", &last)); p; p = strtok_r(NULL, ":", &last)) {
+			int r;
+			struct stat stat_buf;
+			char * exe = malloc(strlen(p) + strlen(file) + 2);
+			strcpy(exe, p);
+			strcat(exe, "/");
+			strcat(exe, file);
+
+			r = stat(exe, &stat_buf);
+			if (r != 0 || !(stat_buf.st_mode & 0111)) {
+				free(exe);
+				continue;
+			}
+
+			pid_t out = spawnve(exe, argv, environ);
+			free(exe);
+			free(xpath);
+			return out;
+		}
+		free(xpath);
+		errno = ENOENT;
+		return -1;
+	} else if (file) {
+		return spawnve(file, argv, environ);
+	}
+	errno = ENOENT;
+	return -1;
+}
@@ -0,0 +1,15 @@
+#include <errno.h>
+#include <sys/uio.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+
+DEFN_SYSCALL3(readv,  SYS_READV, int, void *, int);
+DEFN_SYSCALL3(writev, SYS_WRITEV, int, void *, int);
+
+ssize_t readv(int fd, const struct iovec * iov, int iovcnt) {
+	__sets_errno(syscall_readv(fd, (void *)iov, iovcnt));
+}
+
+ssize_t writev(int fd, const struct iovec * iov, int iovcnt) {
+	__sets_errno(syscall_writev(fd, (void *)iov, iovcnt));
+}
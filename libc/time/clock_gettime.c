@@ -1,28 +1,42 @@
 #include <time.h>
 #include <errno.h>
 #include <sys/time.h>
+#include <syscall.h>
+#include <syscall_nums.h>
+
+DEFN_SYSCALL2(clock_gettime, SYS_CLOCK_GETTIME, long, void *);
+
+static int clock_is_valid(clockid_t clk_id) {
+	return (clk_id >= CLOCK_REALTIME && clk_id <= CLOCK_MONOTONIC) ||
+	       (clk_id >= CLOCK_REALTIME_COARSE && clk_id <= CLOCK_MONOTONIC_COARSE);
+}
 
 int clock_getres(clockid_t clk_id, struct timespec *res) {
-	if (clk_id < 0 || clk_id > 1) {
+	if (!clock_is_valid(clk_id)) {
 		errno = EINVAL;
 		return -1;
 	}
 
 	res->tv_sec = 0;
-	res->tv_nsec = 1000;
+	if (clk_id >= CLOCK_REALTIME_COARSE) {
+		/* Coarse clocks only advance on the 100Hz timer tick. */
+		res->tv_nsec = 10000000;
+	} else {
+		res->tv_nsec = 1000;
+	}
 	return 0;
 }
 
 int clock_gettime(clockid_t clk_id, struct timespec *tp) {
-	if (clk_id < 0 || clk_id > 1) {
+	if (!clock_is_valid(clk_id)) {
 		errno = EINVAL;
 		return -1;
 	}
-	struct timeval t;
-	gettimeofday(&t, NULL);
-
-	tp->tv_sec  = t.tv_sec;
-	tp->tv_nsec = t.tv_usec * 1000;
 
+	int ret = syscall_clock_gettime(clk_id, tp);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
 	return 0;
 }
@@ -172,8 +172,47 @@ static char * get_timezone(void) {
 }
 
 
+/* Cached timezone state. setenv replaces the backing string, so the
+ * pointers getenv returns are enough to notice a TZ change without
+ * reparsing the offset on every call. */
+static char * _tz_env     = (char *)-1;
+static char * _tz_off_env = (char *)-1;
+static int _tz_offset = 0;
+static const char * _tz_name = "UTC";
+
+/* The last minute we broke down; the panel clock and log timestamps
+ * ask about the same minute over and over, and only tm_sec changes. */
+static time_t _minute_start = -1;
+static struct tm _minute_tm;
+
+static void tz_refresh(void) {
+	char * tzEnv = getenv("TZ");
+	char * tzOff = getenv("TZ_OFFSET");
+	if (tzEnv == _tz_env && tzOff == _tz_off_env) return;
+	_tz_offset = get_timezone_offset();
+	_tz_name   = get_timezone();
+	_tz_env     = tzEnv;
+	_tz_off_env = tzOff;
+	_minute_start = -1;
+}
+
 struct tm *localtime_r(const time_t *timep, struct tm * _timevalue) {
-	return fill_time(timep, _timevalue, get_timezone(), get_timezone_offset());
+	tz_refresh();
+
+	time_t t = *timep + _tz_offset;
+	if (t >= 0 && t - (t % 60) == _minute_start) {
+		*_timevalue = _minute_tm;
+		_timevalue->tm_sec = t % 60;
+		return _timevalue;
+	}
+
+	if (!fill_time(timep, _timevalue, _tz_name, _tz_offset)) return NULL;
+
+	if (t >= 0) {
+		_minute_tm = *_timevalue;
+		_minute_start = t - (t % 60);
+	}
+	return _timevalue;
 }
 
 struct tm * gmtime_r(const time_t * timep, struct tm * tm) {
@@ -181,7 +220,7 @@ struct tm * gmtime_r(const time_t * timep, struct tm * tm) {
 }
 
 struct tm * localtime(const time_t *timep) {
-	return fill_time(timep, &_timevalue, get_timezone(), get_timezone_offset());
+	return localtime_r(timep, &_timevalue);
 }
 
 struct tm *gmtime(const time_t *timep) {
@@ -6,6 +6,7 @@
 
 DEFN_SYSCALL2(statf, SYS_STATF, char *, void *);
 DEFN_SYSCALL2(lstat, SYS_LSTAT, char *, void *);
+DEFN_SYSCALL5(lstat_batch, SYS_LSTAT_BATCH, char *, char *, long, void *, long);
 
 int stat(const char *file, struct stat *st){
 	int ret = syscall_statf((char *)file, (void *)st);
@@ -18,6 +19,19 @@ int stat(const char *file, struct stat *st){
 	}
 }
 
+/* Stat many entries of one directory: @p names is @p count
+ * nul-terminated names packed into @p names_len bytes, resolved
+ * against @p base; entries that fail come back with st_mode of 0. */
+int lstat_batch(const char *base, const char *names, size_t names_len, struct stat *stats, int count) {
+	int ret = syscall_lstat_batch((char *)base, (char *)names, names_len, (void *)stats, count);
+	if (ret >= 0) {
+		return ret;
+	} else {
+		errno = -ret;
+		return -1;
+	}
+}
+
 int lstat(const char *path, struct stat *st) {
 	int ret = syscall_lstat((char *)path, (void *)st);
 	if (ret >= 0) {
@@ -1,8 +1,10 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/types.h>
+#include <syscall.h>
+#include <syscall_nums.h>
 
 void sync(void) {
-	/* TODO */
+	/* The kernel flushes everything regardless of the descriptor. */
+	syscall_fsync(-1);
 }
-
@@ -1,2036 +1,391 @@
 /* Generated by util/gen_wcwidth.krk */
+#include <stdint.h>
 #include <wchar.h>
 
+/* Sorted, contiguous codepoint ranges: entry i covers everything below
+ * its upper bound that entry i-1 does not. wcwidth() binary-searches for
+ * the first upper bound above the character. */
+struct _width_range {
+	uint32_t upper;
+	int8_t width;
+};
+
+static const struct _width_range _ranges[] = {
+	{0x20,-1}, {0x7f,1}, {0xa0,-1}, {0x300,1}, {0x370,0}, {0x378,1}, {0x37a,-1},
+	{0x380,1}, {0x384,-1}, {0x38b,1}, {0x38c,-1}, {0x38d,1}, {0x38e,-1}, {0x3a2,1},
+	{0x3a3,-1}, {0x483,1}, {0x48a,0}, {0x530,1}, {0x531,-1}, {0x557,1}, {0x559,-1},
+	{0x58b,1}, {0x58d,-1}, {0x590,1}, {0x591,-1}, {0x5be,0}, {0x5bf,1}, {0x5c0,0},
+	{0x5c1,1}, {0x5c3,0}, {0x5c4,1}, {0x5c6,0}, {0x5c7,1}, {0x5c8,0}, {0x5d0,-1},
+	{0x5eb,1}, {0x5ef,-1}, {0x5f5,1}, {0x600,-1}, {0x606,0}, {0x610,1}, {0x61b,0},
+	{0x61c,1}, {0x61d,0}, {0x64b,1}, {0x660,0}, {0x670,1}, {0x671,0}, {0x6d6,1},
+	{0x6de,0}, {0x6df,1}, {0x6e5,0}, {0x6e7,1}, {0x6e9,0}, {0x6ea,1}, {0x6ee,0},
+	{0x70e,1}, {0x70f,-1}, {0x710,0}, {0x711,1}, {0x712,0}, {0x730,1}, {0x74b,0},
+	{0x74d,-1}, {0x7a6,1}, {0x7b1,0}, {0x7b2,1}, {0x7c0,-1}, {0x7eb,1}, {0x7f4,0},
+	{0x7fb,1}, {0x7fd,-1}, {0x7fe,0}, {0x816,1}, {0x81a,0}, {0x81b,1}, {0x824,0},
+	{0x825,1}, {0x828,0}, {0x829,1}, {0x82e,0}, {0x830,-1}, {0x83f,1}, {0x840,-1},
+	{0x859,1}, {0x85c,0}, {0x85e,-1}, {0x85f,1}, {0x860,-1}, {0x86b,1}, {0x870,-1},
+	{0x88f,1}, {0x890,-1}, {0x892,0}, {0x898,-1}, {0x8a0,0}, {0x8ca,1}, {0x903,0},
+	{0x93a,1}, {0x93b,0}, {0x93c,1}, {0x93d,0}, {0x941,1}, {0x949,0}, {0x94d,1},
+	{0x94e,0}, {0x951,1}, {0x958,0}, {0x962,1}, {0x964,0}, {0x981,1}, {0x982,0},
+	{0x984,1}, {0x985,-1}, {0x98d,1}, {0x98f,-1}, {0x991,1}, {0x993,-1}, {0x9a9,1},
+	{0x9aa,-1}, {0x9b1,1}, {0x9b2,-1}, {0x9b3,1}, {0x9b6,-1}, {0x9ba,1},
+	{0x9bc,-1}, {0x9bd,0}, {0x9c1,1}, {0x9c5,0}, {0x9c7,-1}, {0x9c9,1}, {0x9cb,-1},
+	{0x9cd,1}, {0x9ce,0}, {0x9cf,1}, {0x9d7,-1}, {0x9d8,1}, {0x9dc,-1}, {0x9de,1},
+	{0x9df,-1}, {0x9e2,1}, {0x9e4,0}, {0x9e6,-1}, {0x9fe,1}, {0x9ff,0}, {0xa01,-1},
+	{0xa03,0}, {0xa04,1}, {0xa05,-1}, {0xa0b,1}, {0xa0f,-1}, {0xa11,1}, {0xa13,-1},
+	{0xa29,1}, {0xa2a,-1}, {0xa31,1}, {0xa32,-1}, {0xa34,1}, {0xa35,-1}, {0xa37,1},
+	{0xa38,-1}, {0xa3a,1}, {0xa3c,-1}, {0xa3d,0}, {0xa3e,-1}, {0xa41,1}, {0xa43,0},
+	{0xa47,-1}, {0xa49,0}, {0xa4b,-1}, {0xa4e,0}, {0xa51,-1}, {0xa52,0},
+	{0xa59,-1}, {0xa5d,1}, {0xa5e,-1}, {0xa5f,1}, {0xa66,-1}, {0xa70,1}, {0xa72,0},
+	{0xa75,1}, {0xa76,0}, {0xa77,1}, {0xa81,-1}, {0xa83,0}, {0xa84,1}, {0xa85,-1},
+	{0xa8e,1}, {0xa8f,-1}, {0xa92,1}, {0xa93,-1}, {0xaa9,1}, {0xaaa,-1}, {0xab1,1},
+	{0xab2,-1}, {0xab4,1}, {0xab5,-1}, {0xaba,1}, {0xabc,-1}, {0xabd,0}, {0xac1,1},
+	{0xac6,0}, {0xac7,-1}, {0xac9,0}, {0xaca,1}, {0xacb,-1}, {0xacd,1}, {0xace,0},
+	{0xad0,-1}, {0xad1,1}, {0xae0,-1}, {0xae2,1}, {0xae4,0}, {0xae6,-1}, {0xaf2,1},
+	{0xaf9,-1}, {0xafa,1}, {0xb00,0}, {0xb01,-1}, {0xb02,0}, {0xb04,1}, {0xb05,-1},
+	{0xb0d,1}, {0xb0f,-1}, {0xb11,1}, {0xb13,-1}, {0xb29,1}, {0xb2a,-1}, {0xb31,1},
+	{0xb32,-1}, {0xb34,1}, {0xb35,-1}, {0xb3a,1}, {0xb3c,-1}, {0xb3d,0}, {0xb3f,1},
+	{0xb40,0}, {0xb41,1}, {0xb45,0}, {0xb47,-1}, {0xb49,1}, {0xb4b,-1}, {0xb4d,1},
+	{0xb4e,0}, {0xb55,-1}, {0xb57,0}, {0xb58,1}, {0xb5c,-1}, {0xb5e,1}, {0xb5f,-1},
+	{0xb62,1}, {0xb64,0}, {0xb66,-1}, {0xb78,1}, {0xb82,-1}, {0xb83,0}, {0xb84,1},
+	{0xb85,-1}, {0xb8b,1}, {0xb8e,-1}, {0xb91,1}, {0xb92,-1}, {0xb96,1},
+	{0xb99,-1}, {0xb9b,1}, {0xb9c,-1}, {0xb9d,1}, {0xb9e,-1}, {0xba0,1},
+	{0xba3,-1}, {0xba5,1}, {0xba8,-1}, {0xbab,1}, {0xbae,-1}, {0xbba,1},
+	{0xbbe,-1}, {0xbc0,1}, {0xbc1,0}, {0xbc3,1}, {0xbc6,-1}, {0xbc9,1}, {0xbca,-1},
+	{0xbcd,1}, {0xbce,0}, {0xbd0,-1}, {0xbd1,1}, {0xbd7,-1}, {0xbd8,1}, {0xbe6,-1},
+	{0xbfb,1}, {0xc00,-1}, {0xc01,0}, {0xc04,1}, {0xc05,0}, {0xc0d,1}, {0xc0e,-1},
+	{0xc11,1}, {0xc12,-1}, {0xc29,1}, {0xc2a,-1}, {0xc3a,1}, {0xc3c,-1}, {0xc3d,0},
+	{0xc3e,1}, {0xc41,0}, {0xc45,1}, {0xc46,-1}, {0xc49,0}, {0xc4a,-1}, {0xc4e,0},
+	{0xc55,-1}, {0xc57,0}, {0xc58,-1}, {0xc5b,1}, {0xc5d,-1}, {0xc5e,1},
+	{0xc60,-1}, {0xc62,1}, {0xc64,0}, {0xc66,-1}, {0xc70,1}, {0xc77,-1}, {0xc81,1},
+	{0xc82,0}, {0xc8d,1}, {0xc8e,-1}, {0xc91,1}, {0xc92,-1}, {0xca9,1}, {0xcaa,-1},
+	{0xcb4,1}, {0xcb5,-1}, {0xcba,1}, {0xcbc,-1}, {0xcbd,0}, {0xcbf,1}, {0xcc0,0},
+	{0xcc5,1}, {0xcc6,-1}, {0xcc7,0}, {0xcc9,1}, {0xcca,-1}, {0xccc,1}, {0xcce,0},
+	{0xcd5,-1}, {0xcd7,1}, {0xcdd,-1}, {0xcdf,1}, {0xce0,-1}, {0xce2,1}, {0xce4,0},
+	{0xce6,-1}, {0xcf0,1}, {0xcf1,-1}, {0xcf3,1}, {0xd00,-1}, {0xd02,0}, {0xd0d,1},
+	{0xd0e,-1}, {0xd11,1}, {0xd12,-1}, {0xd3b,1}, {0xd3d,0}, {0xd41,1}, {0xd45,0},
+	{0xd46,-1}, {0xd49,1}, {0xd4a,-1}, {0xd4d,1}, {0xd4e,0}, {0xd50,1}, {0xd54,-1},
+	{0xd62,1}, {0xd64,0}, {0xd66,-1}, {0xd80,1}, {0xd81,-1}, {0xd82,0}, {0xd84,1},
+	{0xd85,-1}, {0xd97,1}, {0xd9a,-1}, {0xdb2,1}, {0xdb3,-1}, {0xdbc,1},
+	{0xdbd,-1}, {0xdbe,1}, {0xdc0,-1}, {0xdc7,1}, {0xdca,-1}, {0xdcb,0},
+	{0xdcf,-1}, {0xdd2,1}, {0xdd5,0}, {0xdd6,-1}, {0xdd7,0}, {0xdd8,-1}, {0xde0,1},
+	{0xde6,-1}, {0xdf0,1}, {0xdf2,-1}, {0xdf5,1}, {0xe01,-1}, {0xe31,1}, {0xe32,0},
+	{0xe34,1}, {0xe3b,0}, {0xe3f,-1}, {0xe47,1}, {0xe4f,0}, {0xe5c,1}, {0xe81,-1},
+	{0xe83,1}, {0xe84,-1}, {0xe85,1}, {0xe86,-1}, {0xe8b,1}, {0xe8c,-1}, {0xea4,1},
+	{0xea5,-1}, {0xea6,1}, {0xea7,-1}, {0xeb1,1}, {0xeb2,0}, {0xeb4,1}, {0xebd,0},
+	{0xebe,1}, {0xec0,-1}, {0xec5,1}, {0xec6,-1}, {0xec7,1}, {0xec8,-1}, {0xece,0},
+	{0xed0,-1}, {0xeda,1}, {0xedc,-1}, {0xee0,1}, {0xf00,-1}, {0xf18,1}, {0xf1a,0},
+	{0xf35,1}, {0xf36,0}, {0xf37,1}, {0xf38,0}, {0xf39,1}, {0xf3a,0}, {0xf48,1},
+	{0xf49,-1}, {0xf6d,1}, {0xf71,-1}, {0xf7f,0}, {0xf80,1}, {0xf85,0}, {0xf86,1},
+	{0xf88,0}, {0xf8d,1}, {0xf98,0}, {0xf99,-1}, {0xfbd,0}, {0xfbe,-1}, {0xfc6,1},
+	{0xfc7,0}, {0xfcd,1}, {0xfce,-1}, {0xfdb,1}, {0x1000,-1}, {0x102d,1},
+	{0x1031,0}, {0x1032,1}, {0x1038,0}, {0x1039,1}, {0x103b,0}, {0x103d,1},
+	{0x103f,0}, {0x1058,1}, {0x105a,0}, {0x105e,1}, {0x1061,0}, {0x1071,1},
+	{0x1075,0}, {0x1082,1}, {0x1083,0}, {0x1085,1}, {0x1087,0}, {0x108d,1},
+	{0x108e,0}, {0x109d,1}, {0x109e,0}, {0x10c6,1}, {0x10c7,-1}, {0x10c8,1},
+	{0x10cd,-1}, {0x10ce,1}, {0x10d0,-1}, {0x1100,1}, {0x1160,2}, {0x1200,0},
+	{0x1249,1}, {0x124a,-1}, {0x124e,1}, {0x1250,-1}, {0x1257,1}, {0x1258,-1},
+	{0x1259,1}, {0x125a,-1}, {0x125e,1}, {0x1260,-1}, {0x1289,1}, {0x128a,-1},
+	{0x128e,1}, {0x1290,-1}, {0x12b1,1}, {0x12b2,-1}, {0x12b6,1}, {0x12b8,-1},
+	{0x12bf,1}, {0x12c0,-1}, {0x12c1,1}, {0x12c2,-1}, {0x12c6,1}, {0x12c8,-1},
+	{0x12d7,1}, {0x12d8,-1}, {0x1311,1}, {0x1312,-1}, {0x1316,1}, {0x1318,-1},
+	{0x135b,1}, {0x135d,-1}, {0x1360,0}, {0x137d,1}, {0x1380,-1}, {0x139a,1},
+	{0x13a0,-1}, {0x13f6,1}, {0x13f8,-1}, {0x13fe,1}, {0x1400,-1}, {0x169d,1},
+	{0x16a0,-1}, {0x16f9,1}, {0x1700,-1}, {0x1712,1}, {0x1715,0}, {0x1716,1},
+	{0x171f,-1}, {0x1732,1}, {0x1734,0}, {0x1737,1}, {0x1740,-1}, {0x1752,1},
+	{0x1754,0}, {0x1760,-1}, {0x176d,1}, {0x176e,-1}, {0x1771,1}, {0x1772,-1},
+	{0x1774,0}, {0x1780,-1}, {0x17b4,1}, {0x17b6,0}, {0x17b7,1}, {0x17be,0},
+	{0x17c6,1}, {0x17c7,0}, {0x17c9,1}, {0x17d4,0}, {0x17dd,1}, {0x17de,0},
+	{0x17e0,-1}, {0x17ea,1}, {0x17f0,-1}, {0x17fa,1}, {0x1800,-1}, {0x180b,1},
+	{0x1810,0}, {0x181a,1}, {0x1820,-1}, {0x1879,1}, {0x1880,-1}, {0x1885,1},
+	{0x1887,0}, {0x18a9,1}, {0x18aa,0}, {0x18ab,1}, {0x18b0,-1}, {0x18f6,1},
+	{0x1900,-1}, {0x191f,1}, {0x1920,-1}, {0x1923,0}, {0x1927,1}, {0x1929,0},
+	{0x192c,1}, {0x1930,-1}, {0x1932,1}, {0x1933,0}, {0x1939,1}, {0x193c,0},
+	{0x1940,-1}, {0x1941,1}, {0x1944,-1}, {0x196e,1}, {0x1970,-1}, {0x1975,1},
+	{0x1980,-1}, {0x19ac,1}, {0x19b0,-1}, {0x19ca,1}, {0x19d0,-1}, {0x19db,1},
+	{0x19de,-1}, {0x1a17,1}, {0x1a19,0}, {0x1a1b,1}, {0x1a1c,0}, {0x1a1e,-1},
+	{0x1a56,1}, {0x1a57,0}, {0x1a58,1}, {0x1a5f,0}, {0x1a60,-1}, {0x1a61,0},
+	{0x1a62,1}, {0x1a63,0}, {0x1a65,1}, {0x1a6d,0}, {0x1a73,1}, {0x1a7d,0},
+	{0x1a7f,-1}, {0x1a80,0}, {0x1a8a,1}, {0x1a90,-1}, {0x1a9a,1}, {0x1aa0,-1},
+	{0x1aae,1}, {0x1ab0,-1}, {0x1acf,0}, {0x1b00,-1}, {0x1b04,0}, {0x1b34,1},
+	{0x1b35,0}, {0x1b36,1}, {0x1b3b,0}, {0x1b3c,1}, {0x1b3d,0}, {0x1b42,1},
+	{0x1b43,0}, {0x1b4d,1}, {0x1b50,-1}, {0x1b6b,1}, {0x1b74,0}, {0x1b7f,1},
+	{0x1b80,-1}, {0x1b82,0}, {0x1ba2,1}, {0x1ba6,0}, {0x1ba8,1}, {0x1baa,0},
+	{0x1bab,1}, {0x1bae,0}, {0x1be6,1}, {0x1be7,0}, {0x1be8,1}, {0x1bea,0},
+	{0x1bed,1}, {0x1bee,0}, {0x1bef,1}, {0x1bf2,0}, {0x1bf4,1}, {0x1bfc,-1},
+	{0x1c2c,1}, {0x1c34,0}, {0x1c36,1}, {0x1c38,0}, {0x1c3b,-1}, {0x1c4a,1},
+	{0x1c4d,-1}, {0x1c89,1}, {0x1c90,-1}, {0x1cbb,1}, {0x1cbd,-1}, {0x1cc8,1},
+	{0x1cd0,-1}, {0x1cd3,0}, {0x1cd4,1}, {0x1ce1,0}, {0x1ce2,1}, {0x1ce9,0},
+	{0x1ced,1}, {0x1cee,0}, {0x1cf4,1}, {0x1cf5,0}, {0x1cf8,1}, {0x1cfa,0},
+	{0x1cfb,1}, {0x1d00,-1}, {0x1dc0,1}, {0x1e00,0}, {0x1f16,1}, {0x1f18,-1},
+	{0x1f1e,1}, {0x1f20,-1}, {0x1f46,1}, {0x1f48,-1}, {0x1f4e,1}, {0x1f50,-1},
+	{0x1f58,1}, {0x1f59,-1}, {0x1f5a,1}, {0x1f5b,-1}, {0x1f5c,1}, {0x1f5d,-1},
+	{0x1f5e,1}, {0x1f5f,-1}, {0x1f7e,1}, {0x1f80,-1}, {0x1fb5,1}, {0x1fb6,-1},
+	{0x1fc5,1}, {0x1fc6,-1}, {0x1fd4,1}, {0x1fd6,-1}, {0x1fdc,1}, {0x1fdd,-1},
+	{0x1ff0,1}, {0x1ff2,-1}, {0x1ff5,1}, {0x1ff6,-1}, {0x1fff,1}, {0x2000,-1},
+	{0x200b,1}, {0x2010,0}, {0x202a,1}, {0x202f,0}, {0x2060,1}, {0x2065,0},
+	{0x2066,-1}, {0x2070,0}, {0x2072,1}, {0x2074,-1}, {0x208f,1}, {0x2090,-1},
+	{0x209d,1}, {0x20a0,-1}, {0x20c1,1}, {0x20d0,-1}, {0x20f1,0}, {0x2100,-1},
+	{0x218c,1}, {0x2190,-1}, {0x231a,1}, {0x231c,2}, {0x2329,1}, {0x232b,2},
+	{0x23e9,1}, {0x23ed,2}, {0x23f0,1}, {0x23f1,2}, {0x23f3,1}, {0x23f4,2},
+	{0x2427,1}, {0x2440,-1}, {0x244b,1}, {0x2460,-1}, {0x25fd,1}, {0x25ff,2},
+	{0x2614,1}, {0x2616,2}, {0x2648,1}, {0x2654,2}, {0x267f,1}, {0x2680,2},
+	{0x2693,1}, {0x2694,2}, {0x26a1,1}, {0x26a2,2}, {0x26aa,1}, {0x26ac,2},
+	{0x26bd,1}, {0x26bf,2}, {0x26c4,1}, {0x26c6,2}, {0x26ce,1}, {0x26cf,2},
+	{0x26d4,1}, {0x26d5,2}, {0x26ea,1}, {0x26eb,2}, {0x26f2,1}, {0x26f4,2},
+	{0x26f5,1}, {0x26f6,2}, {0x26fa,1}, {0x26fb,2}, {0x26fd,1}, {0x26fe,2},
+	{0x2705,1}, {0x2706,2}, {0x270a,1}, {0x270c,2}, {0x2728,1}, {0x2729,2},
+	{0x274c,1}, {0x274d,2}, {0x274e,1}, {0x274f,2}, {0x2753,1}, {0x2756,2},
+	{0x2757,1}, {0x2758,2}, {0x2795,1}, {0x2798,2}, {0x27b0,1}, {0x27b1,2},
+	{0x27bf,1}, {0x27c0,2}, {0x2b1b,1}, {0x2b1d,2}, {0x2b50,1}, {0x2b51,2},
+	{0x2b55,1}, {0x2b56,2}, {0x2b74,1}, {0x2b76,-1}, {0x2b96,1}, {0x2b97,-1},
+	{0x2cef,1}, {0x2cf2,0}, {0x2cf4,1}, {0x2cf9,-1}, {0x2d26,1}, {0x2d27,-1},
+	{0x2d28,1}, {0x2d2d,-1}, {0x2d2e,1}, {0x2d30,-1}, {0x2d68,1}, {0x2d6f,-1},
+	{0x2d71,1}, {0x2d7f,-1}, {0x2d80,0}, {0x2d97,1}, {0x2da0,-1}, {0x2da7,1},
+	{0x2da8,-1}, {0x2daf,1}, {0x2db0,-1}, {0x2db7,1}, {0x2db8,-1}, {0x2dbf,1},
+	{0x2dc0,-1}, {0x2dc7,1}, {0x2dc8,-1}, {0x2dcf,1}, {0x2dd0,-1}, {0x2dd7,1},
+	{0x2dd8,-1}, {0x2ddf,1}, {0x2de0,-1}, {0x2e00,0}, {0x2e5e,1}, {0x2e80,-1},
+	{0x2e9a,2}, {0x2e9b,-1}, {0x2ef4,2}, {0x2f00,-1}, {0x2fd6,2}, {0x2ff0,-1},
+	{0x2ffc,2}, {0x3000,-1}, {0x302a,2}, {0x302e,0}, {0x303f,2}, {0x3040,1},
+	{0x3041,-1}, {0x3097,2}, {0x3099,-1}, {0x309b,0}, {0x3100,2}, {0x3105,-1},
+	{0x3130,2}, {0x3131,-1}, {0x318f,2}, {0x3190,-1}, {0x31e4,2}, {0x31f0,-1},
+	{0x321f,2}, {0x3220,-1}, {0x3248,2}, {0x3250,1}, {0x4dc0,2}, {0x4e00,1},
+	{0xa48d,2}, {0xa490,-1}, {0xa4c7,2}, {0xa4d0,-1}, {0xa62c,1}, {0xa640,-1},
+	{0xa66f,1}, {0xa673,0}, {0xa674,1}, {0xa67e,0}, {0xa69e,1}, {0xa6a0,0},
+	{0xa6f0,1}, {0xa6f2,0}, {0xa6f8,1}, {0xa700,-1}, {0xa7cb,1}, {0xa7d0,-1},
+	{0xa7d2,1}, {0xa7d3,-1}, {0xa7d4,1}, {0xa7d5,-1}, {0xa7da,1}, {0xa7f2,-1},
+	{0xa802,1}, {0xa803,0}, {0xa806,1}, {0xa807,0}, {0xa80b,1}, {0xa80c,0},
+	{0xa825,1}, {0xa827,0}, {0xa82c,1}, {0xa82d,0}, {0xa830,-1}, {0xa83a,1},
+	{0xa840,-1}, {0xa878,1}, {0xa880,-1}, {0xa8c4,1}, {0xa8c6,0}, {0xa8ce,-1},
+	{0xa8da,1}, {0xa8e0,-1}, {0xa8f2,0}, {0xa8ff,1}, {0xa900,0}, {0xa926,1},
+	{0xa92e,0}, {0xa947,1}, {0xa952,0}, {0xa954,1}, {0xa95f,-1}, {0xa960,1},
+	{0xa97d,2}, {0xa980,-1}, {0xa983,0}, {0xa9b3,1}, {0xa9b4,0}, {0xa9b6,1},
+	{0xa9ba,0}, {0xa9bc,1}, {0xa9be,0}, {0xa9ce,1}, {0xa9cf,-1}, {0xa9da,1},
+	{0xa9de,-1}, {0xa9e5,1}, {0xa9e6,0}, {0xa9ff,1}, {0xaa00,-1}, {0xaa29,1},
+	{0xaa2f,0}, {0xaa31,1}, {0xaa33,0}, {0xaa35,1}, {0xaa37,0}, {0xaa40,-1},
+	{0xaa43,1}, {0xaa44,0}, {0xaa4c,1}, {0xaa4d,0}, {0xaa4e,1}, {0xaa50,-1},
+	{0xaa5a,1}, {0xaa5c,-1}, {0xaa7c,1}, {0xaa7d,0}, {0xaab0,1}, {0xaab1,0},
+	{0xaab2,1}, {0xaab5,0}, {0xaab7,1}, {0xaab9,0}, {0xaabe,1}, {0xaac0,0},
+	{0xaac1,1}, {0xaac2,0}, {0xaac3,1}, {0xaadb,-1}, {0xaaec,1}, {0xaaee,0},
+	{0xaaf6,1}, {0xaaf7,0}, {0xab01,-1}, {0xab07,1}, {0xab09,-1}, {0xab0f,1},
+	{0xab11,-1}, {0xab17,1}, {0xab20,-1}, {0xab27,1}, {0xab28,-1}, {0xab2f,1},
+	{0xab30,-1}, {0xab6c,1}, {0xab70,-1}, {0xabe5,1}, {0xabe6,0}, {0xabe8,1},
+	{0xabe9,0}, {0xabed,1}, {0xabee,0}, {0xabf0,-1}, {0xabfa,1}, {0xac00,-1},
+	{0xd7a4,2}, {0xd7b0,-1}, {0xd7c7,1}, {0xd7cb,-1}, {0xd7fc,1}, {0xe000,-1},
+	{0xf900,1}, {0xfb00,2}, {0xfb07,1}, {0xfb13,-1}, {0xfb18,1}, {0xfb1d,-1},
+	{0xfb1e,1}, {0xfb1f,0}, {0xfb37,1}, {0xfb38,-1}, {0xfb3d,1}, {0xfb3e,-1},
+	{0xfb3f,1}, {0xfb40,-1}, {0xfb42,1}, {0xfb43,-1}, {0xfb45,1}, {0xfb46,-1},
+	{0xfbc3,1}, {0xfbd3,-1}, {0xfd90,1}, {0xfd92,-1}, {0xfdc8,1}, {0xfdcf,-1},
+	{0xfdd0,1}, {0xfdf0,-1}, {0xfe00,1}, {0xfe10,0}, {0xfe1a,2}, {0xfe20,-1},
+	{0xfe30,0}, {0xfe53,2}, {0xfe54,-1}, {0xfe67,2}, {0xfe68,-1}, {0xfe6c,2},
+	{0xfe70,-1}, {0xfe75,1}, {0xfe76,-1}, {0xfefd,1}, {0xfeff,-1}, {0xff00,0},
+	{0xff01,-1}, {0xff61,2}, {0xffbf,1}, {0xffc2,-1}, {0xffc8,1}, {0xffca,-1},
+	{0xffd0,1}, {0xffd2,-1}, {0xffd8,1}, {0xffda,-1}, {0xffdd,1}, {0xffe0,-1},
+	{0xffe7,2}, {0xffe8,-1}, {0xffef,1}, {0xfff9,-1}, {0xfffc,0}, {0xfffe,1},
+	{0x10000,-1}, {0x1000c,1}, {0x1000d,-1}, {0x10027,1}, {0x10028,-1},
+	{0x1003b,1}, {0x1003c,-1}, {0x1003e,1}, {0x1003f,-1}, {0x1004e,1},
+	{0x10050,-1}, {0x1005e,1}, {0x10080,-1}, {0x100fb,1}, {0x10100,-1},
+	{0x10103,1}, {0x10107,-1}, {0x10134,1}, {0x10137,-1}, {0x1018f,1},
+	{0x10190,-1}, {0x1019d,1}, {0x101a0,-1}, {0x101a1,1}, {0x101d0,-1},
+	{0x101fd,1}, {0x101fe,0}, {0x10280,-1}, {0x1029d,1}, {0x102a0,-1}, {0x102d1,1},
+	{0x102e0,-1}, {0x102e1,0}, {0x102fc,1}, {0x10300,-1}, {0x10324,1},
+	{0x1032d,-1}, {0x1034b,1}, {0x10350,-1}, {0x10376,1}, {0x1037b,0},
+	{0x10380,-1}, {0x1039e,1}, {0x1039f,-1}, {0x103c4,1}, {0x103c8,-1},
+	{0x103d6,1}, {0x10400,-1}, {0x1049e,1}, {0x104a0,-1}, {0x104aa,1},
+	{0x104b0,-1}, {0x104d4,1}, {0x104d8,-1}, {0x104fc,1}, {0x10500,-1},
+	{0x10528,1}, {0x10530,-1}, {0x10564,1}, {0x1056f,-1}, {0x1057b,1},
+	{0x1057c,-1}, {0x1058b,1}, {0x1058c,-1}, {0x10593,1}, {0x10594,-1},
+	{0x10596,1}, {0x10597,-1}, {0x105a2,1}, {0x105a3,-1}, {0x105b2,1},
+	{0x105b3,-1}, {0x105ba,1}, {0x105bb,-1}, {0x105bd,1}, {0x10600,-1},
+	{0x10737,1}, {0x10740,-1}, {0x10756,1}, {0x10760,-1}, {0x10768,1},
+	{0x10780,-1}, {0x10786,1}, {0x10787,-1}, {0x107b1,1}, {0x107b2,-1},
+	{0x107bb,1}, {0x10800,-1}, {0x10806,1}, {0x10808,-1}, {0x10809,1},
+	{0x1080a,-1}, {0x10836,1}, {0x10837,-1}, {0x10839,1}, {0x1083c,-1},
+	{0x1083d,1}, {0x1083f,-1}, {0x10856,1}, {0x10857,-1}, {0x1089f,1},
+	{0x108a7,-1}, {0x108b0,1}, {0x108e0,-1}, {0x108f3,1}, {0x108f4,-1},
+	{0x108f6,1}, {0x108fb,-1}, {0x1091c,1}, {0x1091f,-1}, {0x1093a,1},
+	{0x1093f,-1}, {0x10940,1}, {0x10980,-1}, {0x109b8,1}, {0x109bc,-1},
+	{0x109d0,1}, {0x109d2,-1}, {0x10a01,1}, {0x10a04,0}, {0x10a05,-1}, {0x10a07,0},
+	{0x10a0c,-1}, {0x10a10,0}, {0x10a14,1}, {0x10a15,-1}, {0x10a18,1},
+	{0x10a19,-1}, {0x10a36,1}, {0x10a38,-1}, {0x10a3b,0}, {0x10a3f,-1},
+	{0x10a40,0}, {0x10a49,1}, {0x10a50,-1}, {0x10a59,1}, {0x10a60,-1}, {0x10aa0,1},
+	{0x10ac0,-1}, {0x10ae5,1}, {0x10ae7,0}, {0x10aeb,-1}, {0x10af7,1},
+	{0x10b00,-1}, {0x10b36,1}, {0x10b39,-1}, {0x10b56,1}, {0x10b58,-1},
+	{0x10b73,1}, {0x10b78,-1}, {0x10b92,1}, {0x10b99,-1}, {0x10b9d,1},
+	{0x10ba9,-1}, {0x10bb0,1}, {0x10c00,-1}, {0x10c49,1}, {0x10c80,-1},
+	{0x10cb3,1}, {0x10cc0,-1}, {0x10cf3,1}, {0x10cfa,-1}, {0x10d24,1}, {0x10d28,0},
+	{0x10d30,-1}, {0x10d3a,1}, {0x10e60,-1}, {0x10e7f,1}, {0x10e80,-1},
+	{0x10eaa,1}, {0x10eab,-1}, {0x10ead,0}, {0x10eae,1}, {0x10eb0,-1}, {0x10eb2,1},
+	{0x10f00,-1}, {0x10f28,1}, {0x10f30,-1}, {0x10f46,1}, {0x10f51,0}, {0x10f5a,1},
+	{0x10f70,-1}, {0x10f82,1}, {0x10f86,0}, {0x10f8a,1}, {0x10fb0,-1}, {0x10fcc,1},
+	{0x10fe0,-1}, {0x10ff7,1}, {0x11000,-1}, {0x11001,1}, {0x11002,0}, {0x11038,1},
+	{0x11047,0}, {0x1104e,1}, {0x11052,-1}, {0x11070,1}, {0x11071,0}, {0x11073,1},
+	{0x11075,0}, {0x11076,1}, {0x1107f,-1}, {0x11082,0}, {0x110b3,1}, {0x110b7,0},
+	{0x110b9,1}, {0x110bb,0}, {0x110bd,1}, {0x110be,0}, {0x110c2,1}, {0x110c3,0},
+	{0x110cd,-1}, {0x110ce,0}, {0x110d0,-1}, {0x110e9,1}, {0x110f0,-1},
+	{0x110fa,1}, {0x11100,-1}, {0x11103,0}, {0x11127,1}, {0x1112c,0}, {0x1112d,1},
+	{0x11135,0}, {0x11136,-1}, {0x11148,1}, {0x11150,-1}, {0x11173,1}, {0x11174,0},
+	{0x11177,1}, {0x11180,-1}, {0x11182,0}, {0x111b6,1}, {0x111bf,0}, {0x111c9,1},
+	{0x111cd,0}, {0x111cf,1}, {0x111d0,0}, {0x111e0,1}, {0x111e1,-1}, {0x111f5,1},
+	{0x11200,-1}, {0x11212,1}, {0x11213,-1}, {0x1122f,1}, {0x11232,0}, {0x11234,1},
+	{0x11235,0}, {0x11236,1}, {0x11238,0}, {0x1123e,1}, {0x1123f,0}, {0x11280,-1},
+	{0x11287,1}, {0x11288,-1}, {0x11289,1}, {0x1128a,-1}, {0x1128e,1},
+	{0x1128f,-1}, {0x1129e,1}, {0x1129f,-1}, {0x112aa,1}, {0x112b0,-1},
+	{0x112df,1}, {0x112e0,0}, {0x112e3,1}, {0x112eb,0}, {0x112f0,-1}, {0x112fa,1},
+	{0x11300,-1}, {0x11302,0}, {0x11304,1}, {0x11305,-1}, {0x1130d,1},
+	{0x1130f,-1}, {0x11311,1}, {0x11313,-1}, {0x11329,1}, {0x1132a,-1},
+	{0x11331,1}, {0x11332,-1}, {0x11334,1}, {0x11335,-1}, {0x1133a,1},
+	{0x1133b,-1}, {0x1133d,0}, {0x11340,1}, {0x11341,0}, {0x11345,1}, {0x11347,-1},
+	{0x11349,1}, {0x1134b,-1}, {0x1134e,1}, {0x11350,-1}, {0x11351,1},
+	{0x11357,-1}, {0x11358,1}, {0x1135d,-1}, {0x11364,1}, {0x11366,-1},
+	{0x1136d,0}, {0x11370,-1}, {0x11375,0}, {0x11400,-1}, {0x11438,1}, {0x11440,0},
+	{0x11442,1}, {0x11445,0}, {0x11446,1}, {0x11447,0}, {0x1145c,1}, {0x1145d,-1},
+	{0x1145e,1}, {0x1145f,0}, {0x11462,1}, {0x11480,-1}, {0x114b3,1}, {0x114b9,0},
+	{0x114ba,1}, {0x114bb,0}, {0x114bf,1}, {0x114c1,0}, {0x114c2,1}, {0x114c4,0},
+	{0x114c8,1}, {0x114d0,-1}, {0x114da,1}, {0x11580,-1}, {0x115b2,1}, {0x115b6,0},
+	{0x115b8,-1}, {0x115bc,1}, {0x115be,0}, {0x115bf,1}, {0x115c1,0}, {0x115dc,1},
+	{0x115de,0}, {0x11600,-1}, {0x11633,1}, {0x1163b,0}, {0x1163d,1}, {0x1163e,0},
+	{0x1163f,1}, {0x11641,0}, {0x11645,1}, {0x11650,-1}, {0x1165a,1}, {0x11660,-1},
+	{0x1166d,1}, {0x11680,-1}, {0x116ab,1}, {0x116ac,0}, {0x116ad,1}, {0x116ae,0},
+	{0x116b0,1}, {0x116b6,0}, {0x116b7,1}, {0x116b8,0}, {0x116ba,1}, {0x116c0,-1},
+	{0x116ca,1}, {0x11700,-1}, {0x1171b,1}, {0x1171d,-1}, {0x11720,0}, {0x11722,1},
+	{0x11726,0}, {0x11727,1}, {0x1172c,0}, {0x11730,-1}, {0x11747,1}, {0x11800,-1},
+	{0x1182f,1}, {0x11838,0}, {0x11839,1}, {0x1183b,0}, {0x1183c,1}, {0x118a0,-1},
+	{0x118f3,1}, {0x118ff,-1}, {0x11907,1}, {0x11909,-1}, {0x1190a,1},
+	{0x1190c,-1}, {0x11914,1}, {0x11915,-1}, {0x11917,1}, {0x11918,-1},
+	{0x11936,1}, {0x11937,-1}, {0x11939,1}, {0x1193b,-1}, {0x1193d,0}, {0x1193e,1},
+	{0x1193f,0}, {0x11943,1}, {0x11944,0}, {0x11947,1}, {0x11950,-1}, {0x1195a,1},
+	{0x119a0,-1}, {0x119a8,1}, {0x119aa,-1}, {0x119d4,1}, {0x119d8,0},
+	{0x119da,-1}, {0x119dc,0}, {0x119e0,1}, {0x119e1,0}, {0x119e5,1}, {0x11a00,-1},
+	{0x11a01,1}, {0x11a0b,0}, {0x11a33,1}, {0x11a39,0}, {0x11a3b,1}, {0x11a3f,0},
+	{0x11a47,1}, {0x11a48,0}, {0x11a50,-1}, {0x11a51,1}, {0x11a57,0}, {0x11a59,1},
+	{0x11a5c,0}, {0x11a8a,1}, {0x11a97,0}, {0x11a98,1}, {0x11a9a,0}, {0x11aa3,1},
+	{0x11ab0,-1}, {0x11af9,1}, {0x11c00,-1}, {0x11c09,1}, {0x11c0a,-1},
+	{0x11c30,1}, {0x11c37,0}, {0x11c38,-1}, {0x11c3e,0}, {0x11c3f,1}, {0x11c40,0},
+	{0x11c46,1}, {0x11c50,-1}, {0x11c6d,1}, {0x11c70,-1}, {0x11c90,1},
+	{0x11c92,-1}, {0x11ca8,0}, {0x11ca9,-1}, {0x11caa,1}, {0x11cb1,0}, {0x11cb2,1},
+	{0x11cb4,0}, {0x11cb5,1}, {0x11cb7,0}, {0x11d00,-1}, {0x11d07,1}, {0x11d08,-1},
+	{0x11d0a,1}, {0x11d0b,-1}, {0x11d31,1}, {0x11d37,0}, {0x11d3a,-1}, {0x11d3b,0},
+	{0x11d3c,-1}, {0x11d3e,0}, {0x11d3f,-1}, {0x11d46,0}, {0x11d47,1}, {0x11d48,0},
+	{0x11d50,-1}, {0x11d5a,1}, {0x11d60,-1}, {0x11d66,1}, {0x11d67,-1},
+	{0x11d69,1}, {0x11d6a,-1}, {0x11d8f,1}, {0x11d90,-1}, {0x11d92,0},
+	{0x11d93,-1}, {0x11d95,1}, {0x11d96,0}, {0x11d97,1}, {0x11d98,0}, {0x11d99,1},
+	{0x11da0,-1}, {0x11daa,1}, {0x11ee0,-1}, {0x11ef3,1}, {0x11ef5,0}, {0x11ef9,1},
+	{0x11fb0,-1}, {0x11fb1,1}, {0x11fc0,-1}, {0x11ff2,1}, {0x11fff,-1},
+	{0x1239a,1}, {0x12400,-1}, {0x1246f,1}, {0x12470,-1}, {0x12475,1},
+	{0x12480,-1}, {0x12544,1}, {0x12f90,-1}, {0x12ff3,1}, {0x13000,-1},
+	{0x1342f,1}, {0x13430,-1}, {0x13439,0}, {0x14400,-1}, {0x14647,1},
+	{0x16800,-1}, {0x16a39,1}, {0x16a40,-1}, {0x16a5f,1}, {0x16a60,-1},
+	{0x16a6a,1}, {0x16a6e,-1}, {0x16abf,1}, {0x16ac0,-1}, {0x16aca,1},
+	{0x16ad0,-1}, {0x16aee,1}, {0x16af0,-1}, {0x16af5,0}, {0x16af6,1},
+	{0x16b00,-1}, {0x16b30,1}, {0x16b37,0}, {0x16b46,1}, {0x16b50,-1}, {0x16b5a,1},
+	{0x16b5b,-1}, {0x16b62,1}, {0x16b63,-1}, {0x16b78,1}, {0x16b7d,-1},
+	{0x16b90,1}, {0x16e40,-1}, {0x16e9b,1}, {0x16f00,-1}, {0x16f4b,1},
+	{0x16f4f,-1}, {0x16f50,0}, {0x16f88,1}, {0x16f8f,-1}, {0x16f93,0}, {0x16fa0,1},
+	{0x16fe0,-1}, {0x16fe4,2}, {0x16fe5,0}, {0x16ff0,-1}, {0x16ff2,2},
+	{0x17000,-1}, {0x187f8,2}, {0x18800,-1}, {0x18cd6,2}, {0x18d00,-1},
+	{0x18d09,2}, {0x1aff0,-1}, {0x1aff4,2}, {0x1aff5,-1}, {0x1affc,2},
+	{0x1affd,-1}, {0x1afff,2}, {0x1b000,-1}, {0x1b123,2}, {0x1b150,-1},
+	{0x1b153,2}, {0x1b164,-1}, {0x1b168,2}, {0x1b170,-1}, {0x1b2fc,2},
+	{0x1bc00,-1}, {0x1bc6b,1}, {0x1bc70,-1}, {0x1bc7d,1}, {0x1bc80,-1},
+	{0x1bc89,1}, {0x1bc90,-1}, {0x1bc9a,1}, {0x1bc9c,-1}, {0x1bc9d,1}, {0x1bc9f,0},
+	{0x1bca0,1}, {0x1bca4,0}, {0x1cf00,-1}, {0x1cf2e,0}, {0x1cf30,-1}, {0x1cf47,0},
+	{0x1cf50,-1}, {0x1cfc4,1}, {0x1d000,-1}, {0x1d0f6,1}, {0x1d100,-1},
+	{0x1d127,1}, {0x1d129,-1}, {0x1d167,1}, {0x1d16a,0}, {0x1d173,1}, {0x1d183,0},
+	{0x1d185,1}, {0x1d18c,0}, {0x1d1aa,1}, {0x1d1ae,0}, {0x1d1eb,1}, {0x1d200,-1},
+	{0x1d242,1}, {0x1d245,0}, {0x1d246,1}, {0x1d2e0,-1}, {0x1d2f4,1}, {0x1d300,-1},
+	{0x1d357,1}, {0x1d360,-1}, {0x1d379,1}, {0x1d400,-1}, {0x1d455,1},
+	{0x1d456,-1}, {0x1d49d,1}, {0x1d49e,-1}, {0x1d4a0,1}, {0x1d4a2,-1},
+	{0x1d4a3,1}, {0x1d4a5,-1}, {0x1d4a7,1}, {0x1d4a9,-1}, {0x1d4ad,1},
+	{0x1d4ae,-1}, {0x1d4ba,1}, {0x1d4bb,-1}, {0x1d4bc,1}, {0x1d4bd,-1},
+	{0x1d4c4,1}, {0x1d4c5,-1}, {0x1d506,1}, {0x1d507,-1}, {0x1d50b,1},
+	{0x1d50d,-1}, {0x1d515,1}, {0x1d516,-1}, {0x1d51d,1}, {0x1d51e,-1},
+	{0x1d53a,1}, {0x1d53b,-1}, {0x1d53f,1}, {0x1d540,-1}, {0x1d545,1},
+	{0x1d546,-1}, {0x1d547,1}, {0x1d54a,-1}, {0x1d551,1}, {0x1d552,-1},
+	{0x1d6a6,1}, {0x1d6a8,-1}, {0x1d7cc,1}, {0x1d7ce,-1}, {0x1da00,1}, {0x1da37,0},
+	{0x1da3b,1}, {0x1da6d,0}, {0x1da75,1}, {0x1da76,0}, {0x1da84,1}, {0x1da85,0},
+	{0x1da8c,1}, {0x1da9b,-1}, {0x1daa0,0}, {0x1daa1,-1}, {0x1dab0,0},
+	{0x1df00,-1}, {0x1df1f,1}, {0x1e000,-1}, {0x1e007,0}, {0x1e008,-1},
+	{0x1e019,0}, {0x1e01b,-1}, {0x1e022,0}, {0x1e023,-1}, {0x1e025,0},
+	{0x1e026,-1}, {0x1e02b,0}, {0x1e100,-1}, {0x1e12d,1}, {0x1e130,-1},
+	{0x1e137,0}, {0x1e13e,1}, {0x1e140,-1}, {0x1e14a,1}, {0x1e14e,-1}, {0x1e150,1},
+	{0x1e290,-1}, {0x1e2ae,1}, {0x1e2af,0}, {0x1e2c0,-1}, {0x1e2ec,1}, {0x1e2f0,0},
+	{0x1e2fa,1}, {0x1e2ff,-1}, {0x1e300,1}, {0x1e7e0,-1}, {0x1e7e7,1},
+	{0x1e7e8,-1}, {0x1e7ec,1}, {0x1e7ed,-1}, {0x1e7ef,1}, {0x1e7f0,-1},
+	{0x1e7ff,1}, {0x1e800,-1}, {0x1e8c5,1}, {0x1e8c7,-1}, {0x1e8d0,1}, {0x1e8d7,0},
+	{0x1e900,-1}, {0x1e944,1}, {0x1e94b,0}, {0x1e94c,1}, {0x1e950,-1}, {0x1e95a,1},
+	{0x1e95e,-1}, {0x1e960,1}, {0x1ec71,-1}, {0x1ecb5,1}, {0x1ed01,-1},
+	{0x1ed3e,1}, {0x1ee00,-1}, {0x1ee04,1}, {0x1ee05,-1}, {0x1ee20,1},
+	{0x1ee21,-1}, {0x1ee23,1}, {0x1ee24,-1}, {0x1ee25,1}, {0x1ee27,-1},
+	{0x1ee28,1}, {0x1ee29,-1}, {0x1ee33,1}, {0x1ee34,-1}, {0x1ee38,1},
+	{0x1ee39,-1}, {0x1ee3a,1}, {0x1ee3b,-1}, {0x1ee3c,1}, {0x1ee42,-1},
+	{0x1ee43,1}, {0x1ee47,-1}, {0x1ee48,1}, {0x1ee49,-1}, {0x1ee4a,1},
+	{0x1ee4b,-1}, {0x1ee4c,1}, {0x1ee4d,-1}, {0x1ee50,1}, {0x1ee51,-1},
+	{0x1ee53,1}, {0x1ee54,-1}, {0x1ee55,1}, {0x1ee57,-1}, {0x1ee58,1},
+	{0x1ee59,-1}, {0x1ee5a,1}, {0x1ee5b,-1}, {0x1ee5c,1}, {0x1ee5d,-1},
+	{0x1ee5e,1}, {0x1ee5f,-1}, {0x1ee60,1}, {0x1ee61,-1}, {0x1ee63,1},
+	{0x1ee64,-1}, {0x1ee65,1}, {0x1ee67,-1}, {0x1ee6b,1}, {0x1ee6c,-1},
+	{0x1ee73,1}, {0x1ee74,-1}, {0x1ee78,1}, {0x1ee79,-1}, {0x1ee7d,1},
+	{0x1ee7e,-1}, {0x1ee7f,1}, {0x1ee80,-1}, {0x1ee8a,1}, {0x1ee8b,-1},
+	{0x1ee9c,1}, {0x1eea1,-1}, {0x1eea4,1}, {0x1eea5,-1}, {0x1eeaa,1},
+	{0x1eeab,-1}, {0x1eebc,1}, {0x1eef0,-1}, {0x1eef2,1}, {0x1f000,-1},
+	{0x1f004,1}, {0x1f005,2}, {0x1f02c,1}, {0x1f030,-1}, {0x1f094,1}, {0x1f0a0,-1},
+	{0x1f0af,1}, {0x1f0b1,-1}, {0x1f0c0,1}, {0x1f0c1,-1}, {0x1f0cf,1}, {0x1f0d0,2},
+	{0x1f0d1,-1}, {0x1f0f6,1}, {0x1f100,-1}, {0x1f18e,1}, {0x1f18f,2}, {0x1f191,1},
+	{0x1f19b,2}, {0x1f1ae,1}, {0x1f1e6,-1}, {0x1f200,1}, {0x1f203,2}, {0x1f210,-1},
+	{0x1f23c,2}, {0x1f240,-1}, {0x1f249,2}, {0x1f250,-1}, {0x1f252,2},
+	{0x1f260,-1}, {0x1f266,2}, {0x1f300,-1}, {0x1f321,2}, {0x1f32d,1}, {0x1f336,2},
+	{0x1f337,1}, {0x1f37d,2}, {0x1f37e,1}, {0x1f394,2}, {0x1f3a0,1}, {0x1f3cb,2},
+	{0x1f3cf,1}, {0x1f3d4,2}, {0x1f3e0,1}, {0x1f3f1,2}, {0x1f3f4,1}, {0x1f3f5,2},
+	{0x1f3f8,1}, {0x1f43f,2}, {0x1f440,1}, {0x1f441,2}, {0x1f442,1}, {0x1f4fd,2},
+	{0x1f4ff,1}, {0x1f53e,2}, {0x1f54b,1}, {0x1f54f,2}, {0x1f550,1}, {0x1f568,2},
+	{0x1f57a,1}, {0x1f57b,2}, {0x1f595,1}, {0x1f597,2}, {0x1f5a4,1}, {0x1f5a5,2},
+	{0x1f5fb,1}, {0x1f650,2}, {0x1f680,1}, {0x1f6c6,2}, {0x1f6cc,1}, {0x1f6cd,2},
+	{0x1f6d0,1}, {0x1f6d3,2}, {0x1f6d5,1}, {0x1f6d8,2}, {0x1f6dd,-1}, {0x1f6e0,2},
+	{0x1f6eb,1}, {0x1f6ed,2}, {0x1f6f0,-1}, {0x1f6f4,1}, {0x1f6fd,2}, {0x1f700,-1},
+	{0x1f774,1}, {0x1f780,-1}, {0x1f7d9,1}, {0x1f7e0,-1}, {0x1f7ec,2},
+	{0x1f7f0,-1}, {0x1f7f1,2}, {0x1f800,-1}, {0x1f80c,1}, {0x1f810,-1},
+	{0x1f848,1}, {0x1f850,-1}, {0x1f85a,1}, {0x1f860,-1}, {0x1f888,1},
+	{0x1f890,-1}, {0x1f8ae,1}, {0x1f8b0,-1}, {0x1f8b2,1}, {0x1f900,-1},
+	{0x1f90c,1}, {0x1f93b,2}, {0x1f93c,1}, {0x1f946,2}, {0x1f947,1}, {0x1fa00,2},
+	{0x1fa54,1}, {0x1fa60,-1}, {0x1fa6e,1}, {0x1fa70,-1}, {0x1fa75,2},
+	{0x1fa78,-1}, {0x1fa7d,2}, {0x1fa80,-1}, {0x1fa87,2}, {0x1fa90,-1},
+	{0x1faad,2}, {0x1fab0,-1}, {0x1fabb,2}, {0x1fac0,-1}, {0x1fac6,2},
+	{0x1fad0,-1}, {0x1fada,2}, {0x1fae0,-1}, {0x1fae8,2}, {0x1faf0,-1},
+	{0x1faf7,2}, {0x1fb00,-1}, {0x1fb93,1}, {0x1fb94,-1}, {0x1fbcb,1},
+	{0x1fbf0,-1}, {0x1fbfa,1}, {0x20000,-1}, {0x2fffe,2}, {0x30000,-1},
+	{0x3fffe,2}, {0xe0001,-1}, {0xe0002,0}, {0xe0020,-1}, {0xe0080,0},
+	{0xe0100,-1}, {0xe01f0,0}, {0xf0000,-1}, {0xffffe,1}, {0x100000,-1},
+	{0x10fffe,1}, {0x110000,-1},
+};
+
 int wcwidth(wchar_t wc) {
 	if (wc == 0) return 0;
 	else if (wc < 0x20) return -1;
 	else if (wc < 0x7f) return 1;
-	else if (wc < 0xa0) return -1;
-	else if (wc < 0x300) return 1;
-	else if (wc < 0x370) return 0;
-	else if (wc < 0x378) return 1;
-	else if (wc < 0x37a) return -1;
-	else if (wc < 0x380) return 1;
-	else if (wc < 0x384) return -1;
-	else if (wc < 0x38b) return 1;
-	else if (wc < 0x38c) return -1;
-	else if (wc < 0x38d) return 1;
-	else if (wc < 0x38e) return -1;
-	else if (wc < 0x3a2) return 1;
-	else if (wc < 0x3a3) return -1;
-	else if (wc < 0x483) return 1;
-	else if (wc < 0x48a) return 0;
-	else if (wc < 0x530) return 1;
-	else if (wc < 0x531) return -1;
-	else if (wc < 0x557) return 1;
-	else if (wc < 0x559) return -1;
-	else if (wc < 0x58b) return 1;
-	else if (wc < 0x58d) return -1;
-	else if (wc < 0x590) return 1;
-	else if (wc < 0x591) return -1;
-	else if (wc < 0x5be) return 0;
-	else if (wc < 0x5bf) return 1;
-	else if (wc < 0x5c0) return 0;
-	else if (wc < 0x5c1) return 1;
-	else if (wc < 0x5c3) return 0;
-	else if (wc < 0x5c4) return 1;
-	else if (wc < 0x5c6) return 0;
-	else if (wc < 0x5c7) return 1;
-	else if (wc < 0x5c8) return 0;
-	else if (wc < 0x5d0) return -1;
-	else if (wc < 0x5eb) return 1;
-	else if (wc < 0x5ef) return -1;
-	else if (wc < 0x5f5) return 1;
-	else if (wc < 0x600) return -1;
-	else if (wc < 0x606) return 0;
-	else if (wc < 0x610) return 1;
-	else if (wc < 0x61b) return 0;
-	else if (wc < 0x61c) return 1;
-	else if (wc < 0x61d) return 0;
-	else if (wc < 0x64b) return 1;
-	else if (wc < 0x660) return 0;
-	else if (wc < 0x670) return 1;
-	else if (wc < 0x671) return 0;
-	else if (wc < 0x6d6) return 1;
-	else if (wc < 0x6de) return 0;
-	else if (wc < 0x6df) return 1;
-	else if (wc < 0x6e5) return 0;
-	else if (wc < 0x6e7) return 1;
-	else if (wc < 0x6e9) return 0;
-	else if (wc < 0x6ea) return 1;
-	else if (wc < 0x6ee) return 0;
-	else if (wc < 0x70e) return 1;
-	else if (wc < 0x70f) return -1;
-	else if (wc < 0x710) return 0;
-	else if (wc < 0x711) return 1;
-	else if (wc < 0x712) return 0;
-	else if (wc < 0x730) return 1;
-	else if (wc < 0x74b) return 0;
-	else if (wc < 0x74d) return -1;
-	else if (wc < 0x7a6) return 1;
-	else if (wc < 0x7b1) return 0;
-	else if (wc < 0x7b2) return 1;
-	else if (wc < 0x7c0) return -1;
-	else if (wc < 0x7eb) return 1;
-	else if (wc < 0x7f4) return 0;
-	else if (wc < 0x7fb) return 1;
-	else if (wc < 0x7fd) return -1;
-	else if (wc < 0x7fe) return 0;
-	else if (wc < 0x816) return 1;
-	else if (wc < 0x81a) return 0;
-	else if (wc < 0x81b) return 1;
-	else if (wc < 0x824) return 0;
-	else if (wc < 0x825) return 1;
-	else if (wc < 0x828) return 0;
-	else if (wc < 0x829) return 1;
-	else if (wc < 0x82e) return 0;
-	else if (wc < 0x830) return -1;
-	else if (wc < 0x83f) return 1;
-	else if (wc < 0x840) return -1;
-	else if (wc < 0x859) return 1;
-	else if (wc < 0x85c) return 0;
-	else if (wc < 0x85e) return -1;
-	else if (wc < 0x85f) return 1;
-	else if (wc < 0x860) return -1;
-	else if (wc < 0x86b) return 1;
-	else if (wc < 0x870) return -1;
-	else if (wc < 0x88f) return 1;
-	else if (wc < 0x890) return -1;
-	else if (wc < 0x892) return 0;
-	else if (wc < 0x898) return -1;
-	else if (wc < 0x8a0) return 0;
-	else if (wc < 0x8ca) return 1;
-	else if (wc < 0x903) return 0;
-	else if (wc < 0x93a) return 1;
-	else if (wc < 0x93b) return 0;
-	else if (wc < 0x93c) return 1;
-	else if (wc < 0x93d) return 0;
-	else if (wc < 0x941) return 1;
-	else if (wc < 0x949) return 0;
-	else if (wc < 0x94d) return 1;
-	else if (wc < 0x94e) return 0;
-	else if (wc < 0x951) return 1;
-	else if (wc < 0x958) return 0;
-	else if (wc < 0x962) return 1;
-	else if (wc < 0x964) return 0;
-	else if (wc < 0x981) return 1;
-	else if (wc < 0x982) return 0;
-	else if (wc < 0x984) return 1;
-	else if (wc < 0x985) return -1;
-	else if (wc < 0x98d) return 1;
-	else if (wc < 0x98f) return -1;
-	else if (wc < 0x991) return 1;
-	else if (wc < 0x993) return -1;
-	else if (wc < 0x9a9) return 1;
-	else if (wc < 0x9aa) return -1;
-	else if (wc < 0x9b1) return 1;
-	else if (wc < 0x9b2) return -1;
-	else if (wc < 0x9b3) return 1;
-	else if (wc < 0x9b6) return -1;
-	else if (wc < 0x9ba) return 1;
-	else if (wc < 0x9bc) return -1;
-	else if (wc < 0x9bd) return 0;
-	else if (wc < 0x9c1) return 1;
-	else if (wc < 0x9c5) return 0;
-	else if (wc < 0x9c7) return -1;
-	else if (wc < 0x9c9) return 1;
-	else if (wc < 0x9cb) return -1;
-	else if (wc < 0x9cd) return 1;
-	else if (wc < 0x9ce) return 0;
-	else if (wc < 0x9cf) return 1;
-	else if (wc < 0x9d7) return -1;
-	else if (wc < 0x9d8) return 1;
-	else if (wc < 0x9dc) return -1;
-	else if (wc < 0x9de) return 1;
-	else if (wc < 0x9df) return -1;
-	else if (wc < 0x9e2) return 1;
-	else if (wc < 0x9e4) return 0;
-	else if (wc < 0x9e6) return -1;
-	else if (wc < 0x9fe) return 1;
-	else if (wc < 0x9ff) return 0;
-	else if (wc < 0xa01) return -1;
-	else if (wc < 0xa03) return 0;
-	else if (wc < 0xa04) return 1;
-	else if (wc < 0xa05) return -1;
-	else if (wc < 0xa0b) return 1;
-	else if (wc < 0xa0f) return -1;
-	else if (wc < 0xa11) return 1;
-	else if (wc < 0xa13) return -1;
-	else if (wc < 0xa29) return 1;
-	else if (wc < 0xa2a) return -1;
-	else if (wc < 0xa31) return 1;
-	else if (wc < 0xa32) return -1;
-	else if (wc < 0xa34) return 1;
-	else if (wc < 0xa35) return -1;
-	else if (wc < 0xa37) return 1;
-	else if (wc < 0xa38) return -1;
-	else if (wc < 0xa3a) return 1;
-	else if (wc < 0xa3c) return -1;
-	else if (wc < 0xa3d) return 0;
-	else if (wc < 0xa3e) return -1;
-	else if (wc < 0xa41) return 1;
-	else if (wc < 0xa43) return 0;
-	else if (wc < 0xa47) return -1;
-	else if (wc < 0xa49) return 0;
-	else if (wc < 0xa4b) return -1;
-	else if (wc < 0xa4e) return 0;
-	else if (wc < 0xa51) return -1;
-	else if (wc < 0xa52) return 0;
-	else if (wc < 0xa59) return -1;
-	else if (wc < 0xa5d) return 1;
-	else if (wc < 0xa5e) return -1;
-	else if (wc < 0xa5f) return 1;
-	else if (wc < 0xa66) return -1;
-	else if (wc < 0xa70) return 1;
-	else if (wc < 0xa72) return 0;
-	else if (wc < 0xa75) return 1;
-	else if (wc < 0xa76) return 0;
-	else if (wc < 0xa77) return 1;
-	else if (wc < 0xa81) return -1;
-	else if (wc < 0xa83) return 0;
-	else if (wc < 0xa84) return 1;
-	else if (wc < 0xa85) return -1;
-	else if (wc < 0xa8e) return 1;
-	else if (wc < 0xa8f) return -1;
-	else if (wc < 0xa92) return 1;
-	else if (wc < 0xa93) return -1;
-	else if (wc < 0xaa9) return 1;
-	else if (wc < 0xaaa) return -1;
-	else if (wc < 0xab1) return 1;
-	else if (wc < 0xab2) return -1;
-	else if (wc < 0xab4) return 1;
-	else if (wc < 0xab5) return -1;
-	else if (wc < 0xaba) return 1;
-	else if (wc < 0xabc) return -1;
-	else if (wc < 0xabd) return 0;
-	else if (wc < 0xac1) return 1;
-	else if (wc < 0xac6) return 0;
-	else if (wc < 0xac7) return -1;
-	else if (wc < 0xac9) return 0;
-	else if (wc < 0xaca) return 1;
-	else if (wc < 0xacb) return -1;
-	else if (wc < 0xacd) return 1;
-	else if (wc < 0xace) return 0;
-	else if (wc < 0xad0) return -1;
-	else if (wc < 0xad1) return 1;
-	else if (wc < 0xae0) return -1;
-	else if (wc < 0xae2) return 1;
-	else if (wc < 0xae4) return 0;
-	else if (wc < 0xae6) return -1;
-	else if (wc < 0xaf2) return 1;
-	else if (wc < 0xaf9) return -1;
-	else if (wc < 0xafa) return 1;
-	else if (wc < 0xb00) return 0;
-	else if (wc < 0xb01) return -1;
-	else if (wc < 0xb02) return 0;
-	else if (wc < 0xb04) return 1;
-	else if (wc < 0xb05) return -1;
-	else if (wc < 0xb0d) return 1;
-	else if (wc < 0xb0f) return -1;
-	else if (wc < 0xb11) return 1;
-	else if (wc < 0xb13) return -1;
-	else if (wc < 0xb29) return 1;
-	else if (wc < 0xb2a) return -1;
-	else if (wc < 0xb31) return 1;
-	else if (wc < 0xb32) return -1;
-	else if (wc < 0xb34) return 1;
-	else if (wc < 0xb35) return -1;
-	else if (wc < 0xb3a) return 1;
-	else if (wc < 0xb3c) return -1;
-	else if (wc < 0xb3d) return 0;
-	else if (wc < 0xb3f) return 1;
-	else if (wc < 0xb40) return 0;
-	else if (wc < 0xb41) return 1;
-	else if (wc < 0xb45) return 0;
-	else if (wc < 0xb47) return -1;
-	else if (wc < 0xb49) return 1;
-	else if (wc < 0xb4b) return -1;
-	else if (wc < 0xb4d) return 1;
-	else if (wc < 0xb4e) return 0;
-	else if (wc < 0xb55) return -1;
-	else if (wc < 0xb57) return 0;
-	else if (wc < 0xb58) return 1;
-	else if (wc < 0xb5c) return -1;
-	else if (wc < 0xb5e) return 1;
-	else if (wc < 0xb5f) return -1;
-	else if (wc < 0xb62) return 1;
-	else if (wc < 0xb64) return 0;
-	else if (wc < 0xb66) return -1;
-	else if (wc < 0xb78) return 1;
-	else if (wc < 0xb82) return -1;
-	else if (wc < 0xb83) return 0;
-	else if (wc < 0xb84) return 1;
-	else if (wc < 0xb85) return -1;
-	else if (wc < 0xb8b) return 1;
-	else if (wc < 0xb8e) return -1;
-	else if (wc < 0xb91) return 1;
-	else if (wc < 0xb92) return -1;
-	else if (wc < 0xb96) return 1;
-	else if (wc < 0xb99) return -1;
-	else if (wc < 0xb9b) return 1;
-	else if (wc < 0xb9c) return -1;
-	else if (wc < 0xb9d) return 1;
-	else if (wc < 0xb9e) return -1;
-	else if (wc < 0xba0) return 1;
-	else if (wc < 0xba3) return -1;
-	else if (wc < 0xba5) return 1;
-	else if (wc < 0xba8) return -1;
-	else if (wc < 0xbab) return 1;
-	else if (wc < 0xbae) return -1;
-	else if (wc < 0xbba) return 1;
-	else if (wc < 0xbbe) return -1;
-	else if (wc < 0xbc0) return 1;
-	else if (wc < 0xbc1) return 0;
-	else if (wc < 0xbc3) return 1;
-	else if (wc < 0xbc6) return -1;
-	else if (wc < 0xbc9) return 1;
-	else if (wc < 0xbca) return -1;
-	else if (wc < 0xbcd) return 1;
-	else if (wc < 0xbce) return 0;
-	else if (wc < 0xbd0) return -1;
-	else if (wc < 0xbd1) return 1;
-	else if (wc < 0xbd7) return -1;
-	else if (wc < 0xbd8) return 1;
-	else if (wc < 0xbe6) return -1;
-	else if (wc < 0xbfb) return 1;
-	else if (wc < 0xc00) return -1;
-	else if (wc < 0xc01) return 0;
-	else if (wc < 0xc04) return 1;
-	else if (wc < 0xc05) return 0;
-	else if (wc < 0xc0d) return 1;
-	else if (wc < 0xc0e) return -1;
-	else if (wc < 0xc11) return 1;
-	else if (wc < 0xc12) return -1;
-	else if (wc < 0xc29) return 1;
-	else if (wc < 0xc2a) return -1;
-	else if (wc < 0xc3a) return 1;
-	else if (wc < 0xc3c) return -1;
-	else if (wc < 0xc3d) return 0;
-	else if (wc < 0xc3e) return 1;
-	else if (wc < 0xc41) return 0;
-	else if (wc < 0xc45) return 1;
-	else if (wc < 0xc46) return -1;
-	else if (wc < 0xc49) return 0;
-	else if (wc < 0xc4a) return -1;
-	else if (wc < 0xc4e) return 0;
-	else if (wc < 0xc55) return -1;
-	else if (wc < 0xc57) return 0;
-	else if (wc < 0xc58) return -1;
-	else if (wc < 0xc5b) return 1;
-	else if (wc < 0xc5d) return -1;
-	else if (wc < 0xc5e) return 1;
-	else if (wc < 0xc60) return -1;
-	else if (wc < 0xc62) return 1;
-	else if (wc < 0xc64) return 0;
-	else if (wc < 0xc66) return -1;
-	else if (wc < 0xc70) return 1;
-	else if (wc < 0xc77) return -1;
-	else if (wc < 0xc81) return 1;
-	else if (wc < 0xc82) return 0;
-	else if (wc < 0xc8d) return 1;
-	else if (wc < 0xc8e) return -1;
-	else if (wc < 0xc91) return 1;
-	else if (wc < 0xc92) return -1;
-	else if (wc < 0xca9) return 1;
-	else if (wc < 0xcaa) return -1;
-	else if (wc < 0xcb4) return 1;
-	else if (wc < 0xcb5) return -1;
-	else if (wc < 0xcba) return 1;
-	else if (wc < 0xcbc) return -1;
-	else if (wc < 0xcbd) return 0;
-	else if (wc < 0xcbf) return 1;
-	else if (wc < 0xcc0) return 0;
-	else if (wc < 0xcc5) return 1;
-	else if (wc < 0xcc6) return -1;
-	else if (wc < 0xcc7) return 0;
-	else if (wc < 0xcc9) return 1;
-	else if (wc < 0xcca) return -1;
-	else if (wc < 0xccc) return 1;
-	else if (wc < 0xcce) return 0;
-	else if (wc < 0xcd5) return -1;
-	else if (wc < 0xcd7) return 1;
-	else if (wc < 0xcdd) return -1;
-	else if (wc < 0xcdf) return 1;
-	else if (wc < 0xce0) return -1;
-	else if (wc < 0xce2) return 1;
-	else if (wc < 0xce4) return 0;
-	else if (wc < 0xce6) return -1;
-	else if (wc < 0xcf0) return 1;
-	else if (wc < 0xcf1) return -1;
-	else if (wc < 0xcf3) return 1;
-	else if (wc < 0xd00) return -1;
-	else if (wc < 0xd02) return 0;
-	else if (wc < 0xd0d) return 1;
-	else if (wc < 0xd0e) return -1;
-	else if (wc < 0xd11) return 1;
-	else if (wc < 0xd12) return -1;
-	else if (wc < 0xd3b) return 1;
-	else if (wc < 0xd3d) return 0;
-	else if (wc < 0xd41) return 1;
-	else if (wc < 0xd45) return 0;
-	else if (wc < 0xd46) return -1;
-	else if (wc < 0xd49) return 1;
-	else if (wc < 0xd4a) return -1;
-	else if (wc < 0xd4d) return 1;
-	else if (wc < 0xd4e) return 0;
-	else if (wc < 0xd50) return 1;
-	else if (wc < 0xd54) return -1;
-	else if (wc < 0xd62) return 1;
-	else if (wc < 0xd64) return 0;
-	else if (wc < 0xd66) return -1;
-	else if (wc < 0xd80) return 1;
-	else if (wc < 0xd81) return -1;
-	else if (wc < 0xd82) return 0;
-	else if (wc < 0xd84) return 1;
-	else if (wc < 0xd85) return -1;
-	else if (wc < 0xd97) return 1;
-	else if (wc < 0xd9a) return -1;
-	else if (wc < 0xdb2) return 1;
-	else if (wc < 0xdb3) return -1;
-	else if (wc < 0xdbc) return 1;
-	else if (wc < 0xdbd) return -1;
-	else if (wc < 0xdbe) return 1;
-	else if (wc < 0xdc0) return -1;
-	else if (wc < 0xdc7) return 1;
-	else if (wc < 0xdca) return -1;
-	else if (wc < 0xdcb) return 0;
-	else if (wc < 0xdcf) return -1;
-	else if (wc < 0xdd2) return 1;
-	else if (wc < 0xdd5) return 0;
-	else if (wc < 0xdd6) return -1;
-	else if (wc < 0xdd7) return 0;
-	else if (wc < 0xdd8) return -1;
-	else if (wc < 0xde0) return 1;
-	else if (wc < 0xde6) return -1;
-	else if (wc < 0xdf0) return 1;
-	else if (wc < 0xdf2) return -1;
-	else if (wc < 0xdf5) return 1;
-	else if (wc < 0xe01) return -1;
-	else if (wc < 0xe31) return 1;
-	else if (wc < 0xe32) return 0;
-	else if (wc < 0xe34) return 1;
-	else if (wc < 0xe3b) return 0;
-	else if (wc < 0xe3f) return -1;
-	else if (wc < 0xe47) return 1;
-	else if (wc < 0xe4f) return 0;
-	else if (wc < 0xe5c) return 1;
-	else if (wc < 0xe81) return -1;
-	else if (wc < 0xe83) return 1;
-	else if (wc < 0xe84) return -1;
-	else if (wc < 0xe85) return 1;
-	else if (wc < 0xe86) return -1;
-	else if (wc < 0xe8b) return 1;
-	else if (wc < 0xe8c) return -1;
-	else if (wc < 0xea4) return 1;
-	else if (wc < 0xea5) return -1;
-	else if (wc < 0xea6) return 1;
-	else if (wc < 0xea7) return -1;
-	else if (wc < 0xeb1) return 1;
-	else if (wc < 0xeb2) return 0;
-	else if (wc < 0xeb4) return 1;
-	else if (wc < 0xebd) return 0;
-	else if (wc < 0xebe) return 1;
-	else if (wc < 0xec0) return -1;
-	else if (wc < 0xec5) return 1;
-	else if (wc < 0xec6) return -1;
-	else if (wc < 0xec7) return 1;
-	else if (wc < 0xec8) return -1;
-	else if (wc < 0xece) return 0;
-	else if (wc < 0xed0) return -1;
-	else if (wc < 0xeda) return 1;
-	else if (wc < 0xedc) return -1;
-	else if (wc < 0xee0) return 1;
-	else if (wc < 0xf00) return -1;
-	else if (wc < 0xf18) return 1;
-	else if (wc < 0xf1a) return 0;
-	else if (wc < 0xf35) return 1;
-	else if (wc < 0xf36) return 0;
-	else if (wc < 0xf37) return 1;
-	else if (wc < 0xf38) return 0;
-	else if (wc < 0xf39) return 1;
-	else if (wc < 0xf3a) return 0;
-	else if (wc < 0xf48) return 1;
-	else if (wc < 0xf49) return -1;
-	else if (wc < 0xf6d) return 1;
-	else if (wc < 0xf71) return -1;
-	else if (wc < 0xf7f) return 0;
-	else if (wc < 0xf80) return 1;
-	else if (wc < 0xf85) return 0;
-	else if (wc < 0xf86) return 1;
-	else if (wc < 0xf88) return 0;
-	else if (wc < 0xf8d) return 1;
-	else if (wc < 0xf98) return 0;
-	else if (wc < 0xf99) return -1;
-	else if (wc < 0xfbd) return 0;
-	else if (wc < 0xfbe) return -1;
-	else if (wc < 0xfc6) return 1;
-	else if (wc < 0xfc7) return 0;
-	else if (wc < 0xfcd) return 1;
-	else if (wc < 0xfce) return -1;
-	else if (wc < 0xfdb) return 1;
-	else if (wc < 0x1000) return -1;
-	else if (wc < 0x102d) return 1;
-	else if (wc < 0x1031) return 0;
-	else if (wc < 0x1032) return 1;
-	else if (wc < 0x1038) return 0;
-	else if (wc < 0x1039) return 1;
-	else if (wc < 0x103b) return 0;
-	else if (wc < 0x103d) return 1;
-	else if (wc < 0x103f) return 0;
-	else if (wc < 0x1058) return 1;
-	else if (wc < 0x105a) return 0;
-	else if (wc < 0x105e) return 1;
-	else if (wc < 0x1061) return 0;
-	else if (wc < 0x1071) return 1;
-	else if (wc < 0x1075) return 0;
-	else if (wc < 0x1082) return 1;
-	else if (wc < 0x1083) return 0;
-	else if (wc < 0x1085) return 1;
-	else if (wc < 0x1087) return 0;
-	else if (wc < 0x108d) return 1;
-	else if (wc < 0x108e) return 0;
-	else if (wc < 0x109d) return 1;
-	else if (wc < 0x109e) return 0;
-	else if (wc < 0x10c6) return 1;
-	else if (wc < 0x10c7) return -1;
-	else if (wc < 0x10c8) return 1;
-	else if (wc < 0x10cd) return -1;
-	else if (wc < 0x10ce) return 1;
-	else if (wc < 0x10d0) return -1;
-	else if (wc < 0x1100) return 1;
-	else if (wc < 0x1160) return 2;
-	else if (wc < 0x1200) return 0;
-	else if (wc < 0x1249) return 1;
-	else if (wc < 0x124a) return -1;
-	else if (wc < 0x124e) return 1;
-	else if (wc < 0x1250) return -1;
-	else if (wc < 0x1257) return 1;
-	else if (wc < 0x1258) return -1;
-	else if (wc < 0x1259) return 1;
-	else if (wc < 0x125a) return -1;
-	else if (wc < 0x125e) return 1;
-	else if (wc < 0x1260) return -1;
-	else if (wc < 0x1289) return 1;
-	else if (wc < 0x128a) return -1;
-	else if (wc < 0x128e) return 1;
-	else if (wc < 0x1290) return -1;
-	else if (wc < 0x12b1) return 1;
-	else if (wc < 0x12b2) return -1;
-	else if (wc < 0x12b6) return 1;
-	else if (wc < 0x12b8) return -1;
-	else if (wc < 0x12bf) return 1;
-	else if (wc < 0x12c0) return -1;
-	else if (wc < 0x12c1) return 1;
-	else if (wc < 0x12c2) return -1;
-	else if (wc < 0x12c6) return 1;
-	else if (wc < 0x12c8) return -1;
-	else if (wc < 0x12d7) return 1;
-	else if (wc < 0x12d8) return -1;
-	else if (wc < 0x1311) return 1;
-	else if (wc < 0x1312) return -1;
-	else if (wc < 0x1316) return 1;
-	else if (wc < 0x1318) return -1;
-	else if (wc < 0x135b) return 1;
-	else if (wc < 0x135d) return -1;
-	else if (wc < 0x1360) return 0;
-	else if (wc < 0x137d) return 1;
-	else if (wc < 0x1380) return -1;
-	else if (wc < 0x139a) return 1;
-	else if (wc < 0x13a0) return -1;
-	else if (wc < 0x13f6) return 1;
-	else if (wc < 0x13f8) return -1;
-	else if (wc < 0x13fe) return 1;
-	else if (wc < 0x1400) return -1;
-	else if (wc < 0x169d) return 1;
-	else if (wc < 0x16a0) return -1;
-	else if (wc < 0x16f9) return 1;
-	else if (wc < 0x1700) return -1;
-	else if (wc < 0x1712) return 1;
-	else if (wc < 0x1715) return 0;
-	else if (wc < 0x1716) return 1;
-	else if (wc < 0x171f) return -1;
-	else if (wc < 0x1732) return 1;
-	else if (wc < 0x1734) return 0;
-	else if (wc < 0x1737) return 1;
-	else if (wc < 0x1740) return -1;
-	else if (wc < 0x1752) return 1;
-	else if (wc < 0x1754) return 0;
-	else if (wc < 0x1760) return -1;
-	else if (wc < 0x176d) return 1;
-	else if (wc < 0x176e) return -1;
-	else if (wc < 0x1771) return 1;
-	else if (wc < 0x1772) return -1;
-	else if (wc < 0x1774) return 0;
-	else if (wc < 0x1780) return -1;
-	else if (wc < 0x17b4) return 1;
-	else if (wc < 0x17b6) return 0;
-	else if (wc < 0x17b7) return 1;
-	else if (wc < 0x17be) return 0;
-	else if (wc < 0x17c6) return 1;
-	else if (wc < 0x17c7) return 0;
-	else if (wc < 0x17c9) return 1;
-	else if (wc < 0x17d4) return 0;
-	else if (wc < 0x17dd) return 1;
-	else if (wc < 0x17de) return 0;
-	else if (wc < 0x17e0) return -1;
-	else if (wc < 0x17ea) return 1;
-	else if (wc < 0x17f0) return -1;
-	else if (wc < 0x17fa) return 1;
-	else if (wc < 0x1800) return -1;
-	else if (wc < 0x180b) return 1;
-	else if (wc < 0x1810) return 0;
-	else if (wc < 0x181a) return 1;
-	else if (wc < 0x1820) return -1;
-	else if (wc < 0x1879) return 1;
-	else if (wc < 0x1880) return -1;
-	else if (wc < 0x1885) return 1;
-	else if (wc < 0x1887) return 0;
-	else if (wc < 0x18a9) return 1;
-	else if (wc < 0x18aa) return 0;
-	else if (wc < 0x18ab) return 1;
-	else if (wc < 0x18b0) return -1;
-	else if (wc < 0x18f6) return 1;
-	else if (wc < 0x1900) return -1;
-	else if (wc < 0x191f) return 1;
-	else if (wc < 0x1920) return -1;
-	else if (wc < 0x1923) return 0;
-	else if (wc < 0x1927) return 1;
-	else if (wc < 0x1929) return 0;
-	else if (wc < 0x192c) return 1;
-	else if (wc < 0x1930) return -1;
-	else if (wc < 0x1932) return 1;
-	else if (wc < 0x1933) return 0;
-	else if (wc < 0x1939) return 1;
-	else if (wc < 0x193c) return 0;
-	else if (wc < 0x1940) return -1;
-	else if (wc < 0x1941) return 1;
-	else if (wc < 0x1944) return -1;
-	else if (wc < 0x196e) return 1;
-	else if (wc < 0x1970) return -1;
-	else if (wc < 0x1975) return 1;
-	else if (wc < 0x1980) return -1;
-	else if (wc < 0x19ac) return 1;
-	else if (wc < 0x19b0) return -1;
-	else if (wc < 0x19ca) return 1;
-	else if (wc < 0x19d0) return -1;
-	else if (wc < 0x19db) return 1;
-	else if (wc < 0x19de) return -1;
-	else if (wc < 0x1a17) return 1;
-	else if (wc < 0x1a19) return 0;
-	else if (wc < 0x1a1b) return 1;
-	else if (wc < 0x1a1c) return 0;
-	else if (wc < 0x1a1e) return -1;
-	else if (wc < 0x1a56) return 1;
-	else if (wc < 0x1a57) return 0;
-	else if (wc < 0x1a58) return 1;
-	else if (wc < 0x1a5f) return 0;
-	else if (wc < 0x1a60) return -1;
-	else if (wc < 0x1a61) return 0;
-	else if (wc < 0x1a62) return 1;
-	else if (wc < 0x1a63) return 0;
-	else if (wc < 0x1a65) return 1;
-	else if (wc < 0x1a6d) return 0;
-	else if (wc < 0x1a73) return 1;
-	else if (wc < 0x1a7d) return 0;
-	else if (wc < 0x1a7f) return -1;
-	else if (wc < 0x1a80) return 0;
-	else if (wc < 0x1a8a) return 1;
-	else if (wc < 0x1a90) return -1;
-	else if (wc < 0x1a9a) return 1;
-	else if (wc < 0x1aa0) return -1;
-	else if (wc < 0x1aae) return 1;
-	else if (wc < 0x1ab0) return -1;
-	else if (wc < 0x1acf) return 0;
-	else if (wc < 0x1b00) return -1;
-	else if (wc < 0x1b04) return 0;
-	else if (wc < 0x1b34) return 1;
-	else if (wc < 0x1b35) return 0;
-	else if (wc < 0x1b36) return 1;
-	else if (wc < 0x1b3b) return 0;
-	else if (wc < 0x1b3c) return 1;
-	else if (wc < 0x1b3d) return 0;
-	else if (wc < 0x1b42) return 1;
-	else if (wc < 0x1b43) return 0;
-	else if (wc < 0x1b4d) return 1;
-	else if (wc < 0x1b50) return -1;
-	else if (wc < 0x1b6b) return 1;
-	else if (wc < 0x1b74) return 0;
-	else if (wc < 0x1b7f) return 1;
-	else if (wc < 0x1b80) return -1;
-	else if (wc < 0x1b82) return 0;
-	else if (wc < 0x1ba2) return 1;
-	else if (wc < 0x1ba6) return 0;
-	else if (wc < 0x1ba8) return 1;
-	else if (wc < 0x1baa) return 0;
-	else if (wc < 0x1bab) return 1;
-	else if (wc < 0x1bae) return 0;
-	else if (wc < 0x1be6) return 1;
-	else if (wc < 0x1be7) return 0;
-	else if (wc < 0x1be8) return 1;
-	else if (wc < 0x1bea) return 0;
-	else if (wc < 0x1bed) return 1;
-	else if (wc < 0x1bee) return 0;
-	else if (wc < 0x1bef) return 1;
-	else if (wc < 0x1bf2) return 0;
-	else if (wc < 0x1bf4) return 1;
-	else if (wc < 0x1bfc) return -1;
-	else if (wc < 0x1c2c) return 1;
-	else if (wc < 0x1c34) return 0;
-	else if (wc < 0x1c36) return 1;
-	else if (wc < 0x1c38) return 0;
-	else if (wc < 0x1c3b) return -1;
-	else if (wc < 0x1c4a) return 1;
-	else if (wc < 0x1c4d) return -1;
-	else if (wc < 0x1c89) return 1;
-	else if (wc < 0x1c90) return -1;
-	else if (wc < 0x1cbb) return 1;
-	else if (wc < 0x1cbd) return -1;
-	else if (wc < 0x1cc8) return 1;
-	else if (wc < 0x1cd0) return -1;
-	else if (wc < 0x1cd3) return 0;
-	else if (wc < 0x1cd4) return 1;
-	else if (wc < 0x1ce1) return 0;
-	else if (wc < 0x1ce2) return 1;
-	else if (wc < 0x1ce9) return 0;
-	else if (wc < 0x1ced) return 1;
-	else if (wc < 0x1cee) return 0;
-	else if (wc < 0x1cf4) return 1;
-	else if (wc < 0x1cf5) return 0;
-	else if (wc < 0x1cf8) return 1;
-	else if (wc < 0x1cfa) return 0;
-	else if (wc < 0x1cfb) return 1;
-	else if (wc < 0x1d00) return -1;
-	else if (wc < 0x1dc0) return 1;
-	else if (wc < 0x1e00) return 0;
-	else if (wc < 0x1f16) return 1;
-	else if (wc < 0x1f18) return -1;
-	else if (wc < 0x1f1e) return 1;
-	else if (wc < 0x1f20) return -1;
-	else if (wc < 0x1f46) return 1;
-	else if (wc < 0x1f48) return -1;
-	else if (wc < 0x1f4e) return 1;
-	else if (wc < 0x1f50) return -1;
-	else if (wc < 0x1f58) return 1;
-	else if (wc < 0x1f59) return -1;
-	else if (wc < 0x1f5a) return 1;
-	else if (wc < 0x1f5b) return -1;
-	else if (wc < 0x1f5c) return 1;
-	else if (wc < 0x1f5d) return -1;
-	else if (wc < 0x1f5e) return 1;
-	else if (wc < 0x1f5f) return -1;
-	else if (wc < 0x1f7e) return 1;
-	else if (wc < 0x1f80) return -1;
-	else if (wc < 0x1fb5) return 1;
-	else if (wc < 0x1fb6) return -1;
-	else if (wc < 0x1fc5) return 1;
-	else if (wc < 0x1fc6) return -1;
-	else if (wc < 0x1fd4) return 1;
-	else if (wc < 0x1fd6) return -1;
-	else if (wc < 0x1fdc) return 1;
-	else if (wc < 0x1fdd) return -1;
-	else if (wc < 0x1ff0) return 1;
-	else if (wc < 0x1ff2) return -1;
-	else if (wc < 0x1ff5) return 1;
-	else if (wc < 0x1ff6) return -1;
-	else if (wc < 0x1fff) return 1;
-	else if (wc < 0x2000) return -1;
-	else if (wc < 0x200b) return 1;
-	else if (wc < 0x2010) return 0;
-	else if (wc < 0x202a) return 1;
-	else if (wc < 0x202f) return 0;
-	else if (wc < 0x2060) return 1;
-	else if (wc < 0x2065) return 0;
-	else if (wc < 0x2066) return -1;
-	else if (wc < 0x2070) return 0;
-	else if (wc < 0x2072) return 1;
-	else if (wc < 0x2074) return -1;
-	else if (wc < 0x208f) return 1;
-	else if (wc < 0x2090) return -1;
-	else if (wc < 0x209d) return 1;
-	else if (wc < 0x20a0) return -1;
-	else if (wc < 0x20c1) return 1;
-	else if (wc < 0x20d0) return -1;
-	else if (wc < 0x20f1) return 0;
-	else if (wc < 0x2100) return -1;
-	else if (wc < 0x218c) return 1;
-	else if (wc < 0x2190) return -1;
-	else if (wc < 0x231a) return 1;
-	else if (wc < 0x231c) return 2;
-	else if (wc < 0x2329) return 1;
-	else if (wc < 0x232b) return 2;
-	else if (wc < 0x23e9) return 1;
-	else if (wc < 0x23ed) return 2;
-	else if (wc < 0x23f0) return 1;
-	else if (wc < 0x23f1) return 2;
-	else if (wc < 0x23f3) return 1;
-	else if (wc < 0x23f4) return 2;
-	else if (wc < 0x2427) return 1;
-	else if (wc < 0x2440) return -1;
-	else if (wc < 0x244b) return 1;
-	else if (wc < 0x2460) return -1;
-	else if (wc < 0x25fd) return 1;
-	else if (wc < 0x25ff) return 2;
-	else if (wc < 0x2614) return 1;
-	else if (wc < 0x2616) return 2;
-	else if (wc < 0x2648) return 1;
-	else if (wc < 0x2654) return 2;
-	else if (wc < 0x267f) return 1;
-	else if (wc < 0x2680) return 2;
-	else if (wc < 0x2693) return 1;
-	else if (wc < 0x2694) return 2;
-	else if (wc < 0x26a1) return 1;
-	else if (wc < 0x26a2) return 2;
-	else if (wc < 0x26aa) return 1;
-	else if (wc < 0x26ac) return 2;
-	else if (wc < 0x26bd) return 1;
-	else if (wc < 0x26bf) return 2;
-	else if (wc < 0x26c4) return 1;
-	else if (wc < 0x26c6) return 2;
-	else if (wc < 0x26ce) return 1;
-	else if (wc < 0x26cf) return 2;
-	else if (wc < 0x26d4) return 1;
-	else if (wc < 0x26d5) return 2;
-	else if (wc < 0x26ea) return 1;
-	else if (wc < 0x26eb) return 2;
-	else if (wc < 0x26f2) return 1;
-	else if (wc < 0x26f4) return 2;
-	else if (wc < 0x26f5) return 1;
-	else if (wc < 0x26f6) return 2;
-	else if (wc < 0x26fa) return 1;
-	else if (wc < 0x26fb) return 2;
-	else if (wc < 0x26fd) return 1;
-	else if (wc < 0x26fe) return 2;
-	else if (wc < 0x2705) return 1;
-	else if (wc < 0x2706) return 2;
-	else if (wc < 0x270a) return 1;
-	else if (wc < 0x270c) return 2;
-	else if (wc < 0x2728) return 1;
-	else if (wc < 0x2729) return 2;
-	else if (wc < 0x274c) return 1;
-	else if (wc < 0x274d) return 2;
-	else if (wc < 0x274e) return 1;
-	else if (wc < 0x274f) return 2;
-	else if (wc < 0x2753) return 1;
-	else if (wc < 0x2756) return 2;
-	else if (wc < 0x2757) return 1;
-	else if (wc < 0x2758) return 2;
-	else if (wc < 0x2795) return 1;
-	else if (wc < 0x2798) return 2;
-	else if (wc < 0x27b0) return 1;
-	else if (wc < 0x27b1) return 2;
-	else if (wc < 0x27bf) return 1;
-	else if (wc < 0x27c0) return 2;
-	else if (wc < 0x2b1b) return 1;
-	else if (wc < 0x2b1d) return 2;
-	else if (wc < 0x2b50) return 1;
-	else if (wc < 0x2b51) return 2;
-	else if (wc < 0x2b55) return 1;
-	else if (wc < 0x2b56) return 2;
-	else if (wc < 0x2b74) return 1;
-	else if (wc < 0x2b76) return -1;
-	else if (wc < 0x2b96) return 1;
-	else if (wc < 0x2b97) return -1;
-	else if (wc < 0x2cef) return 1;
-	else if (wc < 0x2cf2) return 0;
-	else if (wc < 0x2cf4) return 1;
-	else if (wc < 0x2cf9) return -1;
-	else if (wc < 0x2d26) return 1;
-	else if (wc < 0x2d27) return -1;
-	else if (wc < 0x2d28) return 1;
-	else if (wc < 0x2d2d) return -1;
-	else if (wc < 0x2d2e) return 1;
-	else if (wc < 0x2d30) return -1;
-	else if (wc < 0x2d68) return 1;
-	else if (wc < 0x2d6f) return -1;
-	else if (wc < 0x2d71) return 1;
-	else if (wc < 0x2d7f) return -1;
-	else if (wc < 0x2d80) return 0;
-	else if (wc < 0x2d97) return 1;
-	else if (wc < 0x2da0) return -1;
-	else if (wc < 0x2da7) return 1;
-	else if (wc < 0x2da8) return -1;
-	else if (wc < 0x2daf) return 1;
-	else if (wc < 0x2db0) return -1;
-	else if (wc < 0x2db7) return 1;
-	else if (wc < 0x2db8) return -1;
-	else if (wc < 0x2dbf) return 1;
-	else if (wc < 0x2dc0) return -1;
-	else if (wc < 0x2dc7) return 1;
-	else if (wc < 0x2dc8) return -1;
-	else if (wc < 0x2dcf) return 1;
-	else if (wc < 0x2dd0) return -1;
-	else if (wc < 0x2dd7) return 1;
-	else if (wc < 0x2dd8) return -1;
-	else if (wc < 0x2ddf) return 1;
-	else if (wc < 0x2de0) return -1;
-	else if (wc < 0x2e00) return 0;
-	else if (wc < 0x2e5e) return 1;
-	else if (wc < 0x2e80) return -1;
-	else if (wc < 0x2e9a) return 2;
-	else if (wc < 0x2e9b) return -1;
-	else if (wc < 0x2ef4) return 2;
-	else if (wc < 0x2f00) return -1;
-	else if (wc < 0x2fd6) return 2;
-	else if (wc < 0x2ff0) return -1;
-	else if (wc < 0x2ffc) return 2;
-	else if (wc < 0x3000) return -1;
-	else if (wc < 0x302a) return 2;
-	else if (wc < 0x302e) return 0;
-	else if (wc < 0x303f) return 2;
-	else if (wc < 0x3040) return 1;
-	else if (wc < 0x3041) return -1;
-	else if (wc < 0x3097) return 2;
-	else if (wc < 0x3099) return -1;
-	else if (wc < 0x309b) return 0;
-	else if (wc < 0x3100) return 2;
-	else if (wc < 0x3105) return -1;
-	else if (wc < 0x3130) return 2;
-	else if (wc < 0x3131) return -1;
-	else if (wc < 0x318f) return 2;
-	else if (wc < 0x3190) return -1;
-	else if (wc < 0x31e4) return 2;
-	else if (wc < 0x31f0) return -1;
-	else if (wc < 0x321f) return 2;
-	else if (wc < 0x3220) return -1;
-	else if (wc < 0x3248) return 2;
-	else if (wc < 0x3250) return 1;
-	else if (wc < 0x4dc0) return 2;
-	else if (wc < 0x4e00) return 1;
-	else if (wc < 0xa48d) return 2;
-	else if (wc < 0xa490) return -1;
-	else if (wc < 0xa4c7) return 2;
-	else if (wc < 0xa4d0) return -1;
-	else if (wc < 0xa62c) return 1;
-	else if (wc < 0xa640) return -1;
-	else if (wc < 0xa66f) return 1;
-	else if (wc < 0xa673) return 0;
-	else if (wc < 0xa674) return 1;
-	else if (wc < 0xa67e) return 0;
-	else if (wc < 0xa69e) return 1;
-	else if (wc < 0xa6a0) return 0;
-	else if (wc < 0xa6f0) return 1;
-	else if (wc < 0xa6f2) return 0;
-	else if (wc < 0xa6f8) return 1;
-	else if (wc < 0xa700) return -1;
-	else if (wc < 0xa7cb) return 1;
-	else if (wc < 0xa7d0) return -1;
-	else if (wc < 0xa7d2) return 1;
-	else if (wc < 0xa7d3) return -1;
-	else if (wc < 0xa7d4) return 1;
-	else if (wc < 0xa7d5) return -1;
-	else if (wc < 0xa7da) return 1;
-	else if (wc < 0xa7f2) return -1;
-	else if (wc < 0xa802) return 1;
-	else if (wc < 0xa803) return 0;
-	else if (wc < 0xa806) return 1;
-	else if (wc < 0xa807) return 0;
-	else if (wc < 0xa80b) return 1;
-	else if (wc < 0xa80c) return 0;
-	else if (wc < 0xa825) return 1;
-	else if (wc < 0xa827) return 0;
-	else if (wc < 0xa82c) return 1;
-	else if (wc < 0xa82d) return 0;
-	else if (wc < 0xa830) return -1;
-	else if (wc < 0xa83a) return 1;
-	else if (wc < 0xa840) return -1;
-	else if (wc < 0xa878) return 1;
-	else if (wc < 0xa880) return -1;
-	else if (wc < 0xa8c4) return 1;
-	else if (wc < 0xa8c6) return 0;
-	else if (wc < 0xa8ce) return -1;
-	else if (wc < 0xa8da) return 1;
-	else if (wc < 0xa8e0) return -1;
-	else if (wc < 0xa8f2) return 0;
-	else if (wc < 0xa8ff) return 1;
-	else if (wc < 0xa900) return 0;
-	else if (wc < 0xa926) return 1;
-	else if (wc < 0xa92e) return 0;
-	else if (wc < 0xa947) return 1;
-	else if (wc < 0xa952) return 0;
-	else if (wc < 0xa954) return 1;
-	else if (wc < 0xa95f) return -1;
-	else if (wc < 0xa960) return 1;
-	else if (wc < 0xa97d) return 2;
-	else if (wc < 0xa980) return -1;
-	else if (wc < 0xa983) return 0;
-	else if (wc < 0xa9b3) return 1;
-	else if (wc < 0xa9b4) return 0;
-	else if (wc < 0xa9b6) return 1;
-	else if (wc < 0xa9ba) return 0;
-	else if (wc < 0xa9bc) return 1;
-	else if (wc < 0xa9be) return 0;
-	else if (wc < 0xa9ce) return 1;
-	else if (wc < 0xa9cf) return -1;
-	else if (wc < 0xa9da) return 1;
-	else if (wc < 0xa9de) return -1;
-	else if (wc < 0xa9e5) return 1;
-	else if (wc < 0xa9e6) return 0;
-	else if (wc < 0xa9ff) return 1;
-	else if (wc < 0xaa00) return -1;
-	else if (wc < 0xaa29) return 1;
-	else if (wc < 0xaa2f) return 0;
-	else if (wc < 0xaa31) return 1;
-	else if (wc < 0xaa33) return 0;
-	else if (wc < 0xaa35) return 1;
-	else if (wc < 0xaa37) return 0;
-	else if (wc < 0xaa40) return -1;
-	else if (wc < 0xaa43) return 1;
-	else if (wc < 0xaa44) return 0;
-	else if (wc < 0xaa4c) return 1;
-	else if (wc < 0xaa4d) return 0;
-	else if (wc < 0xaa4e) return 1;
-	else if (wc < 0xaa50) return -1;
-	else if (wc < 0xaa5a) return 1;
-	else if (wc < 0xaa5c) return -1;
-	else if (wc < 0xaa7c) return 1;
-	else if (wc < 0xaa7d) return 0;
-	else if (wc < 0xaab0) return 1;
-	else if (wc < 0xaab1) return 0;
-	else if (wc < 0xaab2) return 1;
-	else if (wc < 0xaab5) return 0;
-	else if (wc < 0xaab7) return 1;
-	else if (wc < 0xaab9) return 0;
-	else if (wc < 0xaabe) return 1;
-	else if (wc < 0xaac0) return 0;
-	else if (wc < 0xaac1) return 1;
-	else if (wc < 0xaac2) return 0;
-	else if (wc < 0xaac3) return 1;
-	else if (wc < 0xaadb) return -1;
-	else if (wc < 0xaaec) return 1;
-	else if (wc < 0xaaee) return 0;
-	else if (wc < 0xaaf6) return 1;
-	else if (wc < 0xaaf7) return 0;
-	else if (wc < 0xab01) return -1;
-	else if (wc < 0xab07) return 1;
-	else if (wc < 0xab09) return -1;
-	else if (wc < 0xab0f) return 1;
-	else if (wc < 0xab11) return -1;
-	else if (wc < 0xab17) return 1;
-	else if (wc < 0xab20) return -1;
-	else if (wc < 0xab27) return 1;
-	else if (wc < 0xab28) return -1;
-	else if (wc < 0xab2f) return 1;
-	else if (wc < 0xab30) return -1;
-	else if (wc < 0xab6c) return 1;
-	else if (wc < 0xab70) return -1;
-	else if (wc < 0xabe5) return 1;
-	else if (wc < 0xabe6) return 0;
-	else if (wc < 0xabe8) return 1;
-	else if (wc < 0xabe9) return 0;
-	else if (wc < 0xabed) return 1;
-	else if (wc < 0xabee) return 0;
-	else if (wc < 0xabf0) return -1;
-	else if (wc < 0xabfa) return 1;
-	else if (wc < 0xac00) return -1;
-	else if (wc < 0xd7a4) return 2;
-	else if (wc < 0xd7b0) return -1;
-	else if (wc < 0xd7c7) return 1;
-	else if (wc < 0xd7cb) return -1;
-	else if (wc < 0xd7fc) return 1;
-	else if (wc < 0xe000) return -1;
-	else if (wc < 0xf900) return 1;
-	else if (wc < 0xfb00) return 2;
-	else if (wc < 0xfb07) return 1;
-	else if (wc < 0xfb13) return -1;
-	else if (wc < 0xfb18) return 1;
-	else if (wc < 0xfb1d) return -1;
-	else if (wc < 0xfb1e) return 1;
-	else if (wc < 0xfb1f) return 0;
-	else if (wc < 0xfb37) return 1;
-	else if (wc < 0xfb38) return -1;
-	else if (wc < 0xfb3d) return 1;
-	else if (wc < 0xfb3e) return -1;
-	else if (wc < 0xfb3f) return 1;
-	else if (wc < 0xfb40) return -1;
-	else if (wc < 0xfb42) return 1;
-	else if (wc < 0xfb43) return -1;
-	else if (wc < 0xfb45) return 1;
-	else if (wc < 0xfb46) return -1;
-	else if (wc < 0xfbc3) return 1;
-	else if (wc < 0xfbd3) return -1;
-	else if (wc < 0xfd90) return 1;
-	else if (wc < 0xfd92) return -1;
-	else if (wc < 0xfdc8) return 1;
-	else if (wc < 0xfdcf) return -1;
-	else if (wc < 0xfdd0) return 1;
-	else if (wc < 0xfdf0) return -1;
-	else if (wc < 0xfe00) return 1;
-	else if (wc < 0xfe10) return 0;
-	else if (wc < 0xfe1a) return 2;
-	else if (wc < 0xfe20) return -1;
-	else if (wc < 0xfe30) return 0;
-	else if (wc < 0xfe53) return 2;
-	else if (wc < 0xfe54) return -1;
-	else if (wc < 0xfe67) return 2;
-	else if (wc < 0xfe68) return -1;
-	else if (wc < 0xfe6c) return 2;
-	else if (wc < 0xfe70) return -1;
-	else if (wc < 0xfe75) return 1;
-	else if (wc < 0xfe76) return -1;
-	else if (wc < 0xfefd) return 1;
-	else if (wc < 0xfeff) return -1;
-	else if (wc < 0xff00) return 0;
-	else if (wc < 0xff01) return -1;
-	else if (wc < 0xff61) return 2;
-	else if (wc < 0xffbf) return 1;
-	else if (wc < 0xffc2) return -1;
-	else if (wc < 0xffc8) return 1;
-	else if (wc < 0xffca) return -1;
-	else if (wc < 0xffd0) return 1;
-	else if (wc < 0xffd2) return -1;
-	else if (wc < 0xffd8) return 1;
-	else if (wc < 0xffda) return -1;
-	else if (wc < 0xffdd) return 1;
-	else if (wc < 0xffe0) return -1;
-	else if (wc < 0xffe7) return 2;
-	else if (wc < 0xffe8) return -1;
-	else if (wc < 0xffef) return 1;
-	else if (wc < 0xfff9) return -1;
-	else if (wc < 0xfffc) return 0;
-	else if (wc < 0xfffe) return 1;
-	else if (wc < 0x10000) return -1;
-	else if (wc < 0x1000c) return 1;
-	else if (wc < 0x1000d) return -1;
-	else if (wc < 0x10027) return 1;
-	else if (wc < 0x10028) return -1;
-	else if (wc < 0x1003b) return 1;
-	else if (wc < 0x1003c) return -1;
-	else if (wc < 0x1003e) return 1;
-	else if (wc < 0x1003f) return -1;
-	else if (wc < 0x1004e) return 1;
-	else if (wc < 0x10050) return -1;
-	else if (wc < 0x1005e) return 1;
-	else if (wc < 0x10080) return -1;
-	else if (wc < 0x100fb) return 1;
-	else if (wc < 0x10100) return -1;
-	else if (wc < 0x10103) return 1;
-	else if (wc < 0x10107) return -1;
-	else if (wc < 0x10134) return 1;
-	else if (wc < 0x10137) return -1;
-	else if (wc < 0x1018f) return 1;
-	else if (wc < 0x10190) return -1;
-	else if (wc < 0x1019d) return 1;
-	else if (wc < 0x101a0) return -1;
-	else if (wc < 0x101a1) return 1;
-	else if (wc < 0x101d0) return -1;
-	else if (wc < 0x101fd) return 1;
-	else if (wc < 0x101fe) return 0;
-	else if (wc < 0x10280) return -1;
-	else if (wc < 0x1029d) return 1;
-	else if (wc < 0x102a0) return -1;
-	else if (wc < 0x102d1) return 1;
-	else if (wc < 0x102e0) return -1;
-	else if (wc < 0x102e1) return 0;
-	else if (wc < 0x102fc) return 1;
-	else if (wc < 0x10300) return -1;
-	else if (wc < 0x10324) return 1;
-	else if (wc < 0x1032d) return -1;
-	else if (wc < 0x1034b) return 1;
-	else if (wc < 0x10350) return -1;
-	else if (wc < 0x10376) return 1;
-	else if (wc < 0x1037b) return 0;
-	else if (wc < 0x10380) return -1;
-	else if (wc < 0x1039e) return 1;
-	else if (wc < 0x1039f) return -1;
-	else if (wc < 0x103c4) return 1;
-	else if (wc < 0x103c8) return -1;
-	else if (wc < 0x103d6) return 1;
-	else if (wc < 0x10400) return -1;
-	else if (wc < 0x1049e) return 1;
-	else if (wc < 0x104a0) return -1;
-	else if (wc < 0x104aa) return 1;
-	else if (wc < 0x104b0) return -1;
-	else if (wc < 0x104d4) return 1;
-	else if (wc < 0x104d8) return -1;
-	else if (wc < 0x104fc) return 1;
-	else if (wc < 0x10500) return -1;
-	else if (wc < 0x10528) return 1;
-	else if (wc < 0x10530) return -1;
-	else if (wc < 0x10564) return 1;
-	else if (wc < 0x1056f) return -1;
-	else if (wc < 0x1057b) return 1;
-	else if (wc < 0x1057c) return -1;
-	else if (wc < 0x1058b) return 1;
-	else if (wc < 0x1058c) return -1;
-	else if (wc < 0x10593) return 1;
-	else if (wc < 0x10594) return -1;
-	else if (wc < 0x10596) return 1;
-	else if (wc < 0x10597) return -1;
-	else if (wc < 0x105a2) return 1;
-	else if (wc < 0x105a3) return -1;
-	else if (wc < 0x105b2) return 1;
-	else if (wc < 0x105b3) return -1;
-	else if (wc < 0x105ba) return 1;
-	else if (wc < 0x105bb) return -1;
-	else if (wc < 0x105bd) return 1;
-	else if (wc < 0x10600) return -1;
-	else if (wc < 0x10737) return 1;
-	else if (wc < 0x10740) return -1;
-	else if (wc < 0x10756) return 1;
-	else if (wc < 0x10760) return -1;
-	else if (wc < 0x10768) return 1;
-	else if (wc < 0x10780) return -1;
-	else if (wc < 0x10786) return 1;
-	else if (wc < 0x10787) return -1;
-	else if (wc < 0x107b1) return 1;
-	else if (wc < 0x107b2) return -1;
-	else if (wc < 0x107bb) return 1;
-	else if (wc < 0x10800) return -1;
-	else if (wc < 0x10806) return 1;
-	else if (wc < 0x10808) return -1;
-	else if (wc < 0x10809) return 1;
-	else if (wc < 0x1080a) return -1;
-	else if (wc < 0x10836) return 1;
-	else if (wc < 0x10837) return -1;
-	else if (wc < 0x10839) return 1;
-	else if (wc < 0x1083c) return -1;
-	else if (wc < 0x1083d) return 1;
-	else if (wc < 0x1083f) return -1;
-	else if (wc < 0x10856) return 1;
-	else if (wc < 0x10857) return -1;
-	else if (wc < 0x1089f) return 1;
-	else if (wc < 0x108a7) return -1;
-	else if (wc < 0x108b0) return 1;
-	else if (wc < 0x108e0) return -1;
-	else if (wc < 0x108f3) return 1;
-	else if (wc < 0x108f4) return -1;
-	else if (wc < 0x108f6) return 1;
-	else if (wc < 0x108fb) return -1;
-	else if (wc < 0x1091c) return 1;
-	else if (wc < 0x1091f) return -1;
-	else if (wc < 0x1093a) return 1;
-	else if (wc < 0x1093f) return -1;
-	else if (wc < 0x10940) return 1;
-	else if (wc < 0x10980) return -1;
-	else if (wc < 0x109b8) return 1;
-	else if (wc < 0x109bc) return -1;
-	else if (wc < 0x109d0) return 1;
-	else if (wc < 0x109d2) return -1;
-	else if (wc < 0x10a01) return 1;
-	else if (wc < 0x10a04) return 0;
-	else if (wc < 0x10a05) return -1;
-	else if (wc < 0x10a07) return 0;
-	else if (wc < 0x10a0c) return -1;
-	else if (wc < 0x10a10) return 0;
-	else if (wc < 0x10a14) return 1;
-	else if (wc < 0x10a15) return -1;
-	else if (wc < 0x10a18) return 1;
-	else if (wc < 0x10a19) return -1;
-	else if (wc < 0x10a36) return 1;
-	else if (wc < 0x10a38) return -1;
-	else if (wc < 0x10a3b) return 0;
-	else if (wc < 0x10a3f) return -1;
-	else if (wc < 0x10a40) return 0;
-	else if (wc < 0x10a49) return 1;
-	else if (wc < 0x10a50) return -1;
-	else if (wc < 0x10a59) return 1;
-	else if (wc < 0x10a60) return -1;
-	else if (wc < 0x10aa0) return 1;
-	else if (wc < 0x10ac0) return -1;
-	else if (wc < 0x10ae5) return 1;
-	else if (wc < 0x10ae7) return 0;
-	else if (wc < 0x10aeb) return -1;
-	else if (wc < 0x10af7) return 1;
-	else if (wc < 0x10b00) return -1;
-	else if (wc < 0x10b36) return 1;
-	else if (wc < 0x10b39) return -1;
-	else if (wc < 0x10b56) return 1;
-	else if (wc < 0x10b58) return -1;
-	else if (wc < 0x10b73) return 1;
-	else if (wc < 0x10b78) return -1;
-	else if (wc < 0x10b92) return 1;
-	else if (wc < 0x10b99) return -1;
-	else if (wc < 0x10b9d) return 1;
-	else if (wc < 0x10ba9) return -1;
-	else if (wc < 0x10bb0) return 1;
-	else if (wc < 0x10c00) return -1;
-	else if (wc < 0x10c49) return 1;
-	else if (wc < 0x10c80) return -1;
-	else if (wc < 0x10cb3) return 1;
-	else if (wc < 0x10cc0) return -1;
-	else if (wc < 0x10cf3) return 1;
-	else if (wc < 0x10cfa) return -1;
-	else if (wc < 0x10d24) return 1;
-	else if (wc < 0x10d28) return 0;
-	else if (wc < 0x10d30) return -1;
-	else if (wc < 0x10d3a) return 1;
-	else if (wc < 0x10e60) return -1;
-	else if (wc < 0x10e7f) return 1;
-	else if (wc < 0x10e80) return -1;
-	else if (wc < 0x10eaa) return 1;
-	else if (wc < 0x10eab) return -1;
-	else if (wc < 0x10ead) return 0;
-	else if (wc < 0x10eae) return 1;
-	else if (wc < 0x10eb0) return -1;
-	else if (wc < 0x10eb2) return 1;
-	else if (wc < 0x10f00) return -1;
-	else if (wc < 0x10f28) return 1;
-	else if (wc < 0x10f30) return -1;
-	else if (wc < 0x10f46) return 1;
-	else if (wc < 0x10f51) return 0;
-	else if (wc < 0x10f5a) return 1;
-	else if (wc < 0x10f70) return -1;
-	else if (wc < 0x10f82) return 1;
-	else if (wc < 0x10f86) return 0;
-	else if (wc < 0x10f8a) return 1;
-	else if (wc < 0x10fb0) return -1;
-	else if (wc < 0x10fcc) return 1;
-	else if (wc < 0x10fe0) return -1;
-	else if (wc < 0x10ff7) return 1;
-	else if (wc < 0x11000) return -1;
-	else if (wc < 0x11001) return 1;
-	else if (wc < 0x11002) return 0;
-	else if (wc < 0x11038) return 1;
-	else if (wc < 0x11047) return 0;
-	else if (wc < 0x1104e) return 1;
-	else if (wc < 0x11052) return -1;
-	else if (wc < 0x11070) return 1;
-	else if (wc < 0x11071) return 0;
-	else if (wc < 0x11073) return 1;
-	else if (wc < 0x11075) return 0;
-	else if (wc < 0x11076) return 1;
-	else if (wc < 0x1107f) return -1;
-	else if (wc < 0x11082) return 0;
-	else if (wc < 0x110b3) return 1;
-	else if (wc < 0x110b7) return 0;
-	else if (wc < 0x110b9) return 1;
-	else if (wc < 0x110bb) return 0;
-	else if (wc < 0x110bd) return 1;
-	else if (wc < 0x110be) return 0;
-	else if (wc < 0x110c2) return 1;
-	else if (wc < 0x110c3) return 0;
-	else if (wc < 0x110cd) return -1;
-	else if (wc < 0x110ce) return 0;
-	else if (wc < 0x110d0) return -1;
-	else if (wc < 0x110e9) return 1;
-	else if (wc < 0x110f0) return -1;
-	else if (wc < 0x110fa) return 1;
-	else if (wc < 0x11100) return -1;
-	else if (wc < 0x11103) return 0;
-	else if (wc < 0x11127) return 1;
-	else if (wc < 0x1112c) return 0;
-	else if (wc < 0x1112d) return 1;
-	else if (wc < 0x11135) return 0;
-	else if (wc < 0x11136) return -1;
-	else if (wc < 0x11148) return 1;
-	else if (wc < 0x11150) return -1;
-	else if (wc < 0x11173) return 1;
-	else if (wc < 0x11174) return 0;
-	else if (wc < 0x11177) return 1;
-	else if (wc < 0x11180) return -1;
-	else if (wc < 0x11182) return 0;
-	else if (wc < 0x111b6) return 1;
-	else if (wc < 0x111bf) return 0;
-	else if (wc < 0x111c9) return 1;
-	else if (wc < 0x111cd) return 0;
-	else if (wc < 0x111cf) return 1;
-	else if (wc < 0x111d0) return 0;
-	else if (wc < 0x111e0) return 1;
-	else if (wc < 0x111e1) return -1;
-	else if (wc < 0x111f5) return 1;
-	else if (wc < 0x11200) return -1;
-	else if (wc < 0x11212) return 1;
-	else if (wc < 0x11213) return -1;
-	else if (wc < 0x1122f) return 1;
-	else if (wc < 0x11232) return 0;
-	else if (wc < 0x11234) return 1;
-	else if (wc < 0x11235) return 0;
-	else if (wc < 0x11236) return 1;
-	else if (wc < 0x11238) return 0;
-	else if (wc < 0x1123e) return 1;
-	else if (wc < 0x1123f) return 0;
-	else if (wc < 0x11280) return -1;
-	else if (wc < 0x11287) return 1;
-	else if (wc < 0x11288) return -1;
-	else if (wc < 0x11289) return 1;
-	else if (wc < 0x1128a) return -1;
-	else if (wc < 0x1128e) return 1;
-	else if (wc < 0x1128f) return -1;
-	else if (wc < 0x1129e) return 1;
-	else if (wc < 0x1129f) return -1;
-	else if (wc < 0x112aa) return 1;
-	else if (wc < 0x112b0) return -1;
-	else if (wc < 0x112df) return 1;
-	else if (wc < 0x112e0) return 0;
-	else if (wc < 0x112e3) return 1;
-	else if (wc < 0x112eb) return 0;
-	else if (wc < 0x112f0) return -1;
-	else if (wc < 0x112fa) return 1;
-	else if (wc < 0x11300) return -1;
-	else if (wc < 0x11302) return 0;
-	else if (wc < 0x11304) return 1;
-	else if (wc < 0x11305) return -1;
-	else if (wc < 0x1130d) return 1;
-	else if (wc < 0x1130f) return -1;
-	else if (wc < 0x11311) return 1;
-	else if (wc < 0x11313) return -1;
-	else if (wc < 0x11329) return 1;
-	else if (wc < 0x1132a) return -1;
-	else if (wc < 0x11331) return 1;
-	else if (wc < 0x11332) return -1;
-	else if (wc < 0x11334) return 1;
-	else if (wc < 0x11335) return -1;
-	else if (wc < 0x1133a) return 1;
-	else if (wc < 0x1133b) return -1;
-	else if (wc < 0x1133d) return 0;
-	else if (wc < 0x11340) return 1;
-	else if (wc < 0x11341) return 0;
-	else if (wc < 0x11345) return 1;
-	else if (wc < 0x11347) return -1;
-	else if (wc < 0x11349) return 1;
-	else if (wc < 0x1134b) return -1;
-	else if (wc < 0x1134e) return 1;
-	else if (wc < 0x11350) return -1;
-	else if (wc < 0x11351) return 1;
-	else if (wc < 0x11357) return -1;
-	else if (wc < 0x11358) return 1;
-	else if (wc < 0x1135d) return -1;
-	else if (wc < 0x11364) return 1;
-	else if (wc < 0x11366) return -1;
-	else if (wc < 0x1136d) return 0;
-	else if (wc < 0x11370) return -1;
-	else if (wc < 0x11375) return 0;
-	else if (wc < 0x11400) return -1;
-	else if (wc < 0x11438) return 1;
-	else if (wc < 0x11440) return 0;
-	else if (wc < 0x11442) return 1;
-	else if (wc < 0x11445) return 0;
-	else if (wc < 0x11446) return 1;
-	else if (wc < 0x11447) return 0;
-	else if (wc < 0x1145c) return 1;
-	else if (wc < 0x1145d) return -1;
-	else if (wc < 0x1145e) return 1;
-	else if (wc < 0x1145f) return 0;
-	else if (wc < 0x11462) return 1;
-	else if (wc < 0x11480) return -1;
-	else if (wc < 0x114b3) return 1;
-	else if (wc < 0x114b9) return 0;
-	else if (wc < 0x114ba) return 1;
-	else if (wc < 0x114bb) return 0;
-	else if (wc < 0x114bf) return 1;
-	else if (wc < 0x114c1) return 0;
-	else if (wc < 0x114c2) return 1;
-	else if (wc < 0x114c4) return 0;
-	else if (wc < 0x114c8) return 1;
-	else if (wc < 0x114d0) return -1;
-	else if (wc < 0x114da) return 1;
-	else if (wc < 0x11580) return -1;
-	else if (wc < 0x115b2) return 1;
-	else if (wc < 0x115b6) return 0;
-	else if (wc < 0x115b8) return -1;
-	else if (wc < 0x115bc) return 1;
-	else if (wc < 0x115be) return 0;
-	else if (wc < 0x115bf) return 1;
-	else if (wc < 0x115c1) return 0;
-	else if (wc < 0x115dc) return 1;
-	else if (wc < 0x115de) return 0;
-	else if (wc < 0x11600) return -1;
-	else if (wc < 0x11633) return 1;
-	else if (wc < 0x1163b) return 0;
-	else if (wc < 0x1163d) return 1;
-	else if (wc < 0x1163e) return 0;
-	else if (wc < 0x1163f) return 1;
-	else if (wc < 0x11641) return 0;
-	else if (wc < 0x11645) return 1;
-	else if (wc < 0x11650) return -1;
-	else if (wc < 0x1165a) return 1;
-	else if (wc < 0x11660) return -1;
-	else if (wc < 0x1166d) return 1;
-	else if (wc < 0x11680) return -1;
-	else if (wc < 0x116ab) return 1;
-	else if (wc < 0x116ac) return 0;
-	else if (wc < 0x116ad) return 1;
-	else if (wc < 0x116ae) return 0;
-	else if (wc < 0x116b0) return 1;
-	else if (wc < 0x116b6) return 0;
-	else if (wc < 0x116b7) return 1;
-	else if (wc < 0x116b8) return 0;
-	else if (wc < 0x116ba) return 1;
-	else if (wc < 0x116c0) return -1;
-	else if (wc < 0x116ca) return 1;
-	else if (wc < 0x11700) return -1;
-	else if (wc < 0x1171b) return 1;
-	else if (wc < 0x1171d) return -1;
-	else if (wc < 0x11720) return 0;
-	else if (wc < 0x11722) return 1;
-	else if (wc < 0x11726) return 0;
-	else if (wc < 0x11727) return 1;
-	else if (wc < 0x1172c) return 0;
-	else if (wc < 0x11730) return -1;
-	else if (wc < 0x11747) return 1;
-	else if (wc < 0x11800) return -1;
-	else if (wc < 0x1182f) return 1;
-	else if (wc < 0x11838) return 0;
-	else if (wc < 0x11839) return 1;
-	else if (wc < 0x1183b) return 0;
-	else if (wc < 0x1183c) return 1;
-	else if (wc < 0x118a0) return -1;
-	else if (wc < 0x118f3) return 1;
-	else if (wc < 0x118ff) return -1;
-	else if (wc < 0x11907) return 1;
-	else if (wc < 0x11909) return -1;
-	else if (wc < 0x1190a) return 1;
-	else if (wc < 0x1190c) return -1;
-	else if (wc < 0x11914) return 1;
-	else if (wc < 0x11915) return -1;
-	else if (wc < 0x11917) return 1;
-	else if (wc < 0x11918) return -1;
-	else if (wc < 0x11936) return 1;
-	else if (wc < 0x11937) return -1;
-	else if (wc < 0x11939) return 1;
-	else if (wc < 0x1193b) return -1;
-	else if (wc < 0x1193d) return 0;
-	else if (wc < 0x1193e) return 1;
-	else if (wc < 0x1193f) return 0;
-	else if (wc < 0x11943) return 1;
-	else if (wc < 0x11944) return 0;
-	else if (wc < 0x11947) return 1;
-	else if (wc < 0x11950) return -1;
-	else if (wc < 0x1195a) return 1;
-	else if (wc < 0x119a0) return -1;
-	else if (wc < 0x119a8) return 1;
-	else if (wc < 0x119aa) return -1;
-	else if (wc < 0x119d4) return 1;
-	else if (wc < 0x119d8) return 0;
-	else if (wc < 0x119da) return -1;
-	else if (wc < 0x119dc) return 0;
-	else if (wc < 0x119e0) return 1;
-	else if (wc < 0x119e1) return 0;
-	else if (wc < 0x119e5) return 1;
-	else if (wc < 0x11a00) return -1;
-	else if (wc < 0x11a01) return 1;
-	else if (wc < 0x11a0b) return 0;
-	else if (wc < 0x11a33) return 1;
-	else if (wc < 0x11a39) return 0;
-	else if (wc < 0x11a3b) return 1;
-	else if (wc < 0x11a3f) return 0;
-	else if (wc < 0x11a47) return 1;
-	else if (wc < 0x11a48) return 0;
-	else if (wc < 0x11a50) return -1;
-	else if (wc < 0x11a51) return 1;
-	else if (wc < 0x11a57) return 0;
-	else if (wc < 0x11a59) return 1;
-	else if (wc < 0x11a5c) return 0;
-	else if (wc < 0x11a8a) return 1;
-	else if (wc < 0x11a97) return 0;
-	else if (wc < 0x11a98) return 1;
-	else if (wc < 0x11a9a) return 0;
-	else if (wc < 0x11aa3) return 1;
-	else if (wc < 0x11ab0) return -1;
-	else if (wc < 0x11af9) return 1;
-	else if (wc < 0x11c00) return -1;
-	else if (wc < 0x11c09) return 1;
-	else if (wc < 0x11c0a) return -1;
-	else if (wc < 0x11c30) return 1;
-	else if (wc < 0x11c37) return 0;
-	else if (wc < 0x11c38) return -1;
-	else if (wc < 0x11c3e) return 0;
-	else if (wc < 0x11c3f) return 1;
-	else if (wc < 0x11c40) return 0;
-	else if (wc < 0x11c46) return 1;
-	else if (wc < 0x11c50) return -1;
-	else if (wc < 0x11c6d) return 1;
-	else if (wc < 0x11c70) return -1;
-	else if (wc < 0x11c90) return 1;
-	else if (wc < 0x11c92) return -1;
-	else if (wc < 0x11ca8) return 0;
-	else if (wc < 0x11ca9) return -1;
-	else if (wc < 0x11caa) return 1;
-	else if (wc < 0x11cb1) return 0;
-	else if (wc < 0x11cb2) return 1;
-	else if (wc < 0x11cb4) return 0;
-	else if (wc < 0x11cb5) return 1;
-	else if (wc < 0x11cb7) return 0;
-	else if (wc < 0x11d00) return -1;
-	else if (wc < 0x11d07) return 1;
-	else if (wc < 0x11d08) return -1;
-	else if (wc < 0x11d0a) return 1;
-	else if (wc < 0x11d0b) return -1;
-	else if (wc < 0x11d31) return 1;
-	else if (wc < 0x11d37) return 0;
-	else if (wc < 0x11d3a) return -1;
-	else if (wc < 0x11d3b) return 0;
-	else if (wc < 0x11d3c) return -1;
-	else if (wc < 0x11d3e) return 0;
-	else if (wc < 0x11d3f) return -1;
-	else if (wc < 0x11d46) return 0;
-	else if (wc < 0x11d47) return 1;
-	else if (wc < 0x11d48) return 0;
-	else if (wc < 0x11d50) return -1;
-	else if (wc < 0x11d5a) return 1;
-	else if (wc < 0x11d60) return -1;
-	else if (wc < 0x11d66) return 1;
-	else if (wc < 0x11d67) return -1;
-	else if (wc < 0x11d69) return 1;
-	else if (wc < 0x11d6a) return -1;
-	else if (wc < 0x11d8f) return 1;
-	else if (wc < 0x11d90) return -1;
-	else if (wc < 0x11d92) return 0;
-	else if (wc < 0x11d93) return -1;
-	else if (wc < 0x11d95) return 1;
-	else if (wc < 0x11d96) return 0;
-	else if (wc < 0x11d97) return 1;
-	else if (wc < 0x11d98) return 0;
-	else if (wc < 0x11d99) return 1;
-	else if (wc < 0x11da0) return -1;
-	else if (wc < 0x11daa) return 1;
-	else if (wc < 0x11ee0) return -1;
-	else if (wc < 0x11ef3) return 1;
-	else if (wc < 0x11ef5) return 0;
-	else if (wc < 0x11ef9) return 1;
-	else if (wc < 0x11fb0) return -1;
-	else if (wc < 0x11fb1) return 1;
-	else if (wc < 0x11fc0) return -1;
-	else if (wc < 0x11ff2) return 1;
-	else if (wc < 0x11fff) return -1;
-	else if (wc < 0x1239a) return 1;
-	else if (wc < 0x12400) return -1;
-	else if (wc < 0x1246f) return 1;
-	else if (wc < 0x12470) return -1;
-	else if (wc < 0x12475) return 1;
-	else if (wc < 0x12480) return -1;
-	else if (wc < 0x12544) return 1;
-	else if (wc < 0x12f90) return -1;
-	else if (wc < 0x12ff3) return 1;
-	else if (wc < 0x13000) return -1;
-	else if (wc < 0x1342f) return 1;
-	else if (wc < 0x13430) return -1;
-	else if (wc < 0x13439) return 0;
-	else if (wc < 0x14400) return -1;
-	else if (wc < 0x14647) return 1;
-	else if (wc < 0x16800) return -1;
-	else if (wc < 0x16a39) return 1;
-	else if (wc < 0x16a40) return -1;
-	else if (wc < 0x16a5f) return 1;
-	else if (wc < 0x16a60) return -1;
-	else if (wc < 0x16a6a) return 1;
-	else if (wc < 0x16a6e) return -1;
-	else if (wc < 0x16abf) return 1;
-	else if (wc < 0x16ac0) return -1;
-	else if (wc < 0x16aca) return 1;
-	else if (wc < 0x16ad0) return -1;
-	else if (wc < 0x16aee) return 1;
-	else if (wc < 0x16af0) return -1;
-	else if (wc < 0x16af5) return 0;
-	else if (wc < 0x16af6) return 1;
-	else if (wc < 0x16b00) return -1;
-	else if (wc < 0x16b30) return 1;
-	else if (wc < 0x16b37) return 0;
-	else if (wc < 0x16b46) return 1;
-	else if (wc < 0x16b50) return -1;
-	else if (wc < 0x16b5a) return 1;
-	else if (wc < 0x16b5b) return -1;
-	else if (wc < 0x16b62) return 1;
-	else if (wc < 0x16b63) return -1;
-	else if (wc < 0x16b78) return 1;
-	else if (wc < 0x16b7d) return -1;
-	else if (wc < 0x16b90) return 1;
-	else if (wc < 0x16e40) return -1;
-	else if (wc < 0x16e9b) return 1;
-	else if (wc < 0x16f00) return -1;
-	else if (wc < 0x16f4b) return 1;
-	else if (wc < 0x16f4f) return -1;
-	else if (wc < 0x16f50) return 0;
-	else if (wc < 0x16f88) return 1;
-	else if (wc < 0x16f8f) return -1;
-	else if (wc < 0x16f93) return 0;
-	else if (wc < 0x16fa0) return 1;
-	else if (wc < 0x16fe0) return -1;
-	else if (wc < 0x16fe4) return 2;
-	else if (wc < 0x16fe5) return 0;
-	else if (wc < 0x16ff0) return -1;
-	else if (wc < 0x16ff2) return 2;
-	else if (wc < 0x17000) return -1;
-	else if (wc < 0x187f8) return 2;
-	else if (wc < 0x18800) return -1;
-	else if (wc < 0x18cd6) return 2;
-	else if (wc < 0x18d00) return -1;
-	else if (wc < 0x18d09) return 2;
-	else if (wc < 0x1aff0) return -1;
-	else if (wc < 0x1aff4) return 2;
-	else if (wc < 0x1aff5) return -1;
-	else if (wc < 0x1affc) return 2;
-	else if (wc < 0x1affd) return -1;
-	else if (wc < 0x1afff) return 2;
-	else if (wc < 0x1b000) return -1;
-	else if (wc < 0x1b123) return 2;
-	else if (wc < 0x1b150) return -1;
-	else if (wc < 0x1b153) return 2;
-	else if (wc < 0x1b164) return -1;
-	else if (wc < 0x1b168) return 2;
-	else if (wc < 0x1b170) return -1;
-	else if (wc < 0x1b2fc) return 2;
-	else if (wc < 0x1bc00) return -1;
-	else if (wc < 0x1bc6b) return 1;
-	else if (wc < 0x1bc70) return -1;
-	else if (wc < 0x1bc7d) return 1;
-	else if (wc < 0x1bc80) return -1;
-	else if (wc < 0x1bc89) return 1;
-	else if (wc < 0x1bc90) return -1;
-	else if (wc < 0x1bc9a) return 1;
-	else if (wc < 0x1bc9c) return -1;
-	else if (wc < 0x1bc9d) return 1;
-	else if (wc < 0x1bc9f) return 0;
-	else if (wc < 0x1bca0) return 1;
-	else if (wc < 0x1bca4) return 0;
-	else if (wc < 0x1cf00) return -1;
-	else if (wc < 0x1cf2e) return 0;
-	else if (wc < 0x1cf30) return -1;
-	else if (wc < 0x1cf47) return 0;
-	else if (wc < 0x1cf50) return -1;
-	else if (wc < 0x1cfc4) return 1;
-	else if (wc < 0x1d000) return -1;
-	else if (wc < 0x1d0f6) return 1;
-	else if (wc < 0x1d100) return -1;
-	else if (wc < 0x1d127) return 1;
-	else if (wc < 0x1d129) return -1;
-	else if (wc < 0x1d167) return 1;
-	else if (wc < 0x1d16a) return 0;
-	else if (wc < 0x1d173) return 1;
-	else if (wc < 0x1d183) return 0;
-	else if (wc < 0x1d185) return 1;
-	else if (wc < 0x1d18c) return 0;
-	else if (wc < 0x1d1aa) return 1;
-	else if (wc < 0x1d1ae) return 0;
-	else if (wc < 0x1d1eb) return 1;
-	else if (wc < 0x1d200) return -1;
-	else if (wc < 0x1d242) return 1;
-	else if (wc < 0x1d245) return 0;
-	else if (wc < 0x1d246) return 1;
-	else if (wc < 0x1d2e0) return -1;
-	else if (wc < 0x1d2f4) return 1;
-	else if (wc < 0x1d300) return -1;
-	else if (wc < 0x1d357) return 1;
-	else if (wc < 0x1d360) return -1;
-	else if (wc < 0x1d379) return 1;
-	else if (wc < 0x1d400) return -1;
-	else if (wc < 0x1d455) return 1;
-	else if (wc < 0x1d456) return -1;
-	else if (wc < 0x1d49d) return 1;
-	else if (wc < 0x1d49e) return -1;
-	else if (wc < 0x1d4a0) return 1;
-	else if (wc < 0x1d4a2) return -1;
-	else if (wc < 0x1d4a3) return 1;
-	else if (wc < 0x1d4a5) return -1;
-	else if (wc < 0x1d4a7) return 1;
-	else if (wc < 0x1d4a9) return -1;
-	else if (wc < 0x1d4ad) return 1;
-	else if (wc < 0x1d4ae) return -1;
-	else if (wc < 0x1d4ba) return 1;
-	else if (wc < 0x1d4bb) return -1;
-	else if (wc < 0x1d4bc) return 1;
-	else if (wc < 0x1d4bd) return -1;
-	else if (wc < 0x1d4c4) return 1;
-	else if (wc < 0x1d4c5) return -1;
-	else if (wc < 0x1d506) return 1;
-	else if (wc < 0x1d507) return -1;
-	else if (wc < 0x1d50b) return 1;
-	else if (wc < 0x1d50d) return -1;
-	else if (wc < 0x1d515) return 1;
-	else if (wc < 0x1d516) return -1;
-	else if (wc < 0x1d51d) return 1;
-	else if (wc < 0x1d51e) return -1;
-	else if (wc < 0x1d53a) return 1;
-	else if (wc < 0x1d53b) return -1;
-	else if (wc < 0x1d53f) return 1;
-	else if (wc < 0x1d540) return -1;
-	else if (wc < 0x1d545) return 1;
-	else if (wc < 0x1d546) return -1;
-	else if (wc < 0x1d547) return 1;
-	else if (wc < 0x1d54a) return -1;
-	else if (wc < 0x1d551) return 1;
-	else if (wc < 0x1d552) return -1;
-	else if (wc < 0x1d6a6) return 1;
-	else if (wc < 0x1d6a8) return -1;
-	else if (wc < 0x1d7cc) return 1;
-	else if (wc < 0x1d7ce) return -1;
-	else if (wc < 0x1da00) return 1;
-	else if (wc < 0x1da37) return 0;
-	else if (wc < 0x1da3b) return 1;
-	else if (wc < 0x1da6d) return 0;
-	else if (wc < 0x1da75) return 1;
-	else if (wc < 0x1da76) return 0;
-	else if (wc < 0x1da84) return 1;
-	else if (wc < 0x1da85) return 0;
-	else if (wc < 0x1da8c) return 1;
-	else if (wc < 0x1da9b) return -1;
-	else if (wc < 0x1daa0) return 0;
-	else if (wc < 0x1daa1) return -1;
-	else if (wc < 0x1dab0) return 0;
-	else if (wc < 0x1df00) return -1;
-	else if (wc < 0x1df1f) return 1;
-	else if (wc < 0x1e000) return -1;
-	else if (wc < 0x1e007) return 0;
-	else if (wc < 0x1e008) return -1;
-	else if (wc < 0x1e019) return 0;
-	else if (wc < 0x1e01b) return -1;
-	else if (wc < 0x1e022) return 0;
-	else if (wc < 0x1e023) return -1;
-	else if (wc < 0x1e025) return 0;
-	else if (wc < 0x1e026) return -1;
-	else if (wc < 0x1e02b) return 0;
-	else if (wc < 0x1e100) return -1;
-	else if (wc < 0x1e12d) return 1;
-	else if (wc < 0x1e130) return -1;
-	else if (wc < 0x1e137) return 0;
-	else if (wc < 0x1e13e) return 1;
-	else if (wc < 0x1e140) return -1;
-	else if (wc < 0x1e14a) return 1;
-	else if (wc < 0x1e14e) return -1;
-	else if (wc < 0x1e150) return 1;
-	else if (wc < 0x1e290) return -1;
-	else if (wc < 0x1e2ae) return 1;
-	else if (wc < 0x1e2af) return 0;
-	else if (wc < 0x1e2c0) return -1;
-	else if (wc < 0x1e2ec) return 1;
-	else if (wc < 0x1e2f0) return 0;
-	else if (wc < 0x1e2fa) return 1;
-	else if (wc < 0x1e2ff) return -1;
-	else if (wc < 0x1e300) return 1;
-	else if (wc < 0x1e7e0) return -1;
-	else if (wc < 0x1e7e7) return 1;
-	else if (wc < 0x1e7e8) return -1;
-	else if (wc < 0x1e7ec) return 1;
-	else if (wc < 0x1e7ed) return -1;
-	else if (wc < 0x1e7ef) return 1;
-	else if (wc < 0x1e7f0) return -1;
-	else if (wc < 0x1e7ff) return 1;
-	else if (wc < 0x1e800) return -1;
-	else if (wc < 0x1e8c5) return 1;
-	else if (wc < 0x1e8c7) return -1;
-	else if (wc < 0x1e8d0) return 1;
-	else if (wc < 0x1e8d7) return 0;
-	else if (wc < 0x1e900) return -1;
-	else if (wc < 0x1e944) return 1;
-	else if (wc < 0x1e94b) return 0;
-	else if (wc < 0x1e94c) return 1;
-	else if (wc < 0x1e950) return -1;
-	else if (wc < 0x1e95a) return 1;
-	else if (wc < 0x1e95e) return -1;
-	else if (wc < 0x1e960) return 1;
-	else if (wc < 0x1ec71) return -1;
-	else if (wc < 0x1ecb5) return 1;
-	else if (wc < 0x1ed01) return -1;
-	else if (wc < 0x1ed3e) return 1;
-	else if (wc < 0x1ee00) return -1;
-	else if (wc < 0x1ee04) return 1;
-	else if (wc < 0x1ee05) return -1;
-	else if (wc < 0x1ee20) return 1;
-	else if (wc < 0x1ee21) return -1;
-	else if (wc < 0x1ee23) return 1;
-	else if (wc < 0x1ee24) return -1;
-	else if (wc < 0x1ee25) return 1;
-	else if (wc < 0x1ee27) return -1;
-	else if (wc < 0x1ee28) return 1;
-	else if (wc < 0x1ee29) return -1;
-	else if (wc < 0x1ee33) return 1;
-	else if (wc < 0x1ee34) return -1;
-	else if (wc < 0x1ee38) return 1;
-	else if (wc < 0x1ee39) return -1;
-	else if (wc < 0x1ee3a) return 1;
-	else if (wc < 0x1ee3b) return -1;
-	else if (wc < 0x1ee3c) return 1;
-	else if (wc < 0x1ee42) return -1;
-	else if (wc < 0x1ee43) return 1;
-	else if (wc < 0x1ee47) return -1;
-	else if (wc < 0x1ee48) return 1;
-	else if (wc < 0x1ee49) return -1;
-	else if (wc < 0x1ee4a) return 1;
-	else if (wc < 0x1ee4b) return -1;
-	else if (wc < 0x1ee4c) return 1;
-	else if (wc < 0x1ee4d) return -1;
-	else if (wc < 0x1ee50) return 1;
-	else if (wc < 0x1ee51) return -1;
-	else if (wc < 0x1ee53) return 1;
-	else if (wc < 0x1ee54) return -1;
-	else if (wc < 0x1ee55) return 1;
-	else if (wc < 0x1ee57) return -1;
-	else if (wc < 0x1ee58) return 1;
-	else if (wc < 0x1ee59) return -1;
-	else if (wc < 0x1ee5a) return 1;
-	else if (wc < 0x1ee5b) return -1;
-	else if (wc < 0x1ee5c) return 1;
-	else if (wc < 0x1ee5d) return -1;
-	else if (wc < 0x1ee5e) return 1;
-	else if (wc < 0x1ee5f) return -1;
-	else if (wc < 0x1ee60) return 1;
-	else if (wc < 0x1ee61) return -1;
-	else if (wc < 0x1ee63) return 1;
-	else if (wc < 0x1ee64) return -1;
-	else if (wc < 0x1ee65) return 1;
-	else if (wc < 0x1ee67) return -1;
-	else if (wc < 0x1ee6b) return 1;
-	else if (wc < 0x1ee6c) return -1;
-	else if (wc < 0x1ee73) return 1;
-	else if (wc < 0x1ee74) return -1;
-	else if (wc < 0x1ee78) return 1;
-	else if (wc < 0x1ee79) return -1;
-	else if (wc < 0x1ee7d) return 1;
-	else if (wc < 0x1ee7e) return -1;
-	else if (wc < 0x1ee7f) return 1;
-	else if (wc < 0x1ee80) return -1;
-	else if (wc < 0x1ee8a) return 1;
-	else if (wc < 0x1ee8b) return -1;
-	else if (wc < 0x1ee9c) return 1;
-	else if (wc < 0x1eea1) return -1;
-	else if (wc < 0x1eea4) return 1;
-	else if (wc < 0x1eea5) return -1;
-	else if (wc < 0x1eeaa) return 1;
-	else if (wc < 0x1eeab) return -1;
-	else if (wc < 0x1eebc) return 1;
-	else if (wc < 0x1eef0) return -1;
-	else if (wc < 0x1eef2) return 1;
-	else if (wc < 0x1f000) return -1;
-	else if (wc < 0x1f004) return 1;
-	else if (wc < 0x1f005) return 2;
-	else if (wc < 0x1f02c) return 1;
-	else if (wc < 0x1f030) return -1;
-	else if (wc < 0x1f094) return 1;
-	else if (wc < 0x1f0a0) return -1;
-	else if (wc < 0x1f0af) return 1;
-	else if (wc < 0x1f0b1) return -1;
-	else if (wc < 0x1f0c0) return 1;
-	else if (wc < 0x1f0c1) return -1;
-	else if (wc < 0x1f0cf) return 1;
-	else if (wc < 0x1f0d0) return 2;
-	else if (wc < 0x1f0d1) return -1;
-	else if (wc < 0x1f0f6) return 1;
-	else if (wc < 0x1f100) return -1;
-	else if (wc < 0x1f18e) return 1;
-	else if (wc < 0x1f18f) return 2;
-	else if (wc < 0x1f191) return 1;
-	else if (wc < 0x1f19b) return 2;
-	else if (wc < 0x1f1ae) return 1;
-	else if (wc < 0x1f1e6) return -1;
-	else if (wc < 0x1f200) return 1;
-	else if (wc < 0x1f203) return 2;
-	else if (wc < 0x1f210) return -1;
-	else if (wc < 0x1f23c) return 2;
-	else if (wc < 0x1f240) return -1;
-	else if (wc < 0x1f249) return 2;
-	else if (wc < 0x1f250) return -1;
-	else if (wc < 0x1f252) return 2;
-	else if (wc < 0x1f260) return -1;
-	else if (wc < 0x1f266) return 2;
-	else if (wc < 0x1f300) return -1;
-	else if (wc < 0x1f321) return 2;
-	else if (wc < 0x1f32d) return 1;
-	else if (wc < 0x1f336) return 2;
-	else if (wc < 0x1f337) return 1;
-	else if (wc < 0x1f37d) return 2;
-	else if (wc < 0x1f37e) return 1;
-	else if (wc < 0x1f394) return 2;
-	else if (wc < 0x1f3a0) return 1;
-	else if (wc < 0x1f3cb) return 2;
-	else if (wc < 0x1f3cf) return 1;
-	else if (wc < 0x1f3d4) return 2;
-	else if (wc < 0x1f3e0) return 1;
-	else if (wc < 0x1f3f1) return 2;
-	else if (wc < 0x1f3f4) return 1;
-	else if (wc < 0x1f3f5) return 2;
-	else if (wc < 0x1f3f8) return 1;
-	else if (wc < 0x1f43f) return 2;
-	else if (wc < 0x1f440) return 1;
-	else if (wc < 0x1f441) return 2;
-	else if (wc < 0x1f442) return 1;
-	else if (wc < 0x1f4fd) return 2;
-	else if (wc < 0x1f4ff) return 1;
-	else if (wc < 0x1f53e) return 2;
-	else if (wc < 0x1f54b) return 1;
-	else if (wc < 0x1f54f) return 2;
-	else if (wc < 0x1f550) return 1;
-	else if (wc < 0x1f568) return 2;
-	else if (wc < 0x1f57a) return 1;
-	else if (wc < 0x1f57b) return 2;
-	else if (wc < 0x1f595) return 1;
-	else if (wc < 0x1f597) return 2;
-	else if (wc < 0x1f5a4) return 1;
-	else if (wc < 0x1f5a5) return 2;
-	else if (wc < 0x1f5fb) return 1;
-	else if (wc < 0x1f650) return 2;
-	else if (wc < 0x1f680) return 1;
-	else if (wc < 0x1f6c6) return 2;
-	else if (wc < 0x1f6cc) return 1;
-	else if (wc < 0x1f6cd) return 2;
-	else if (wc < 0x1f6d0) return 1;
-	else if (wc < 0x1f6d3) return 2;
-	else if (wc < 0x1f6d5) return 1;
-	else if (wc < 0x1f6d8) return 2;
-	else if (wc < 0x1f6dd) return -1;
-	else if (wc < 0x1f6e0) return 2;
-	else if (wc < 0x1f6eb) return 1;
-	else if (wc < 0x1f6ed) return 2;
-	else if (wc < 0x1f6f0) return -1;
-	else if (wc < 0x1f6f4) return 1;
-	else if (wc < 0x1f6fd) return 2;
-	else if (wc < 0x1f700) return -1;
-	else if (wc < 0x1f774) return 1;
-	else if (wc < 0x1f780) return -1;
-	else if (wc < 0x1f7d9) return 1;
-	else if (wc < 0x1f7e0) return -1;
-	else if (wc < 0x1f7ec) return 2;
-	else if (wc < 0x1f7f0) return -1;
-	else if (wc < 0x1f7f1) return 2;
-	else if (wc < 0x1f800) return -1;
-	else if (wc < 0x1f80c) return 1;
-	else if (wc < 0x1f810) return -1;
-	else if (wc < 0x1f848) return 1;
-	else if (wc < 0x1f850) return -1;
-	else if (wc < 0x1f85a) return 1;
-	else if (wc < 0x1f860) return -1;
-	else if (wc < 0x1f888) return 1;
-	else if (wc < 0x1f890) return -1;
-	else if (wc < 0x1f8ae) return 1;
-	else if (wc < 0x1f8b0) return -1;
-	else if (wc < 0x1f8b2) return 1;
-	else if (wc < 0x1f900) return -1;
-	else if (wc < 0x1f90c) return 1;
-	else if (wc < 0x1f93b) return 2;
-	else if (wc < 0x1f93c) return 1;
-	else if (wc < 0x1f946) return 2;
-	else if (wc < 0x1f947) return 1;
-	else if (wc < 0x1fa00) return 2;
-	else if (wc < 0x1fa54) return 1;
-	else if (wc < 0x1fa60) return -1;
-	else if (wc < 0x1fa6e) return 1;
-	else if (wc < 0x1fa70) return -1;
-	else if (wc < 0x1fa75) return 2;
-	else if (wc < 0x1fa78) return -1;
-	else if (wc < 0x1fa7d) return 2;
-	else if (wc < 0x1fa80) return -1;
-	else if (wc < 0x1fa87) return 2;
-	else if (wc < 0x1fa90) return -1;
-	else if (wc < 0x1faad) return 2;
-	else if (wc < 0x1fab0) return -1;
-	else if (wc < 0x1fabb) return 2;
-	else if (wc < 0x1fac0) return -1;
-	else if (wc < 0x1fac6) return 2;
-	else if (wc < 0x1fad0) return -1;
-	else if (wc < 0x1fada) return 2;
-	else if (wc < 0x1fae0) return -1;
-	else if (wc < 0x1fae8) return 2;
-	else if (wc < 0x1faf0) return -1;
-	else if (wc < 0x1faf7) return 2;
-	else if (wc < 0x1fb00) return -1;
-	else if (wc < 0x1fb93) return 1;
-	else if (wc < 0x1fb94) return -1;
-	else if (wc < 0x1fbcb) return 1;
-	else if (wc < 0x1fbf0) return -1;
-	else if (wc < 0x1fbfa) return 1;
-	else if (wc < 0x20000) return -1;
-	else if (wc < 0x2fffe) return 2;
-	else if (wc < 0x30000) return -1;
-	else if (wc < 0x3fffe) return 2;
-	else if (wc < 0xe0001) return -1;
-	else if (wc < 0xe0002) return 0;
-	else if (wc < 0xe0020) return -1;
-	else if (wc < 0xe0080) return 0;
-	else if (wc < 0xe0100) return -1;
-	else if (wc < 0xe01f0) return 0;
-	else if (wc < 0xf0000) return -1;
-	else if (wc < 0xffffe) return 1;
-	else if (wc < 0x100000) return -1;
-	else if (wc < 0x10fffe) return 1;
-	else if (wc < 0x110000) return -1;
-	return -1;
+	else if ((uint32_t)wc >= 0x110000) return -1;
+
+	size_t lo = 0;
+	size_t hi = sizeof(_ranges) / sizeof(*_ranges) - 1;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if ((uint32_t)wc < _ranges[mid].upper) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+	return _ranges[lo].width;
+}
+
+int wcswidth(const wchar_t * s, size_t n) {
+	int out = 0;
+	while (n && *s) {
+		int w = wcwidth(*s);
+		if (w < 0) return -1;
+		out += w;
+		s++;
+		n--;
+	}
+	return out;
 }
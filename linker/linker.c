@@ -7,11 +7,9 @@
  *
  * As of writing, this is a simplistic and not-fully-compliant
  * implementation of ELF dynamic linking. It suffers from a number
- * of issues, including not actually sharing libraries (there
- * isn't a sufficient mechanism in the kernel at the moment for
- * doing that - we need something with copy-on-write, preferably
- * an mmap-file mechanism), as well as not handling symbol
- * resolution correctly.
+ * of issues, including not handling symbol resolution correctly.
+ * Clean pages of page-aligned segments are shared between processes
+ * through the kernel's file mappings; the rest are still copied.
  *
  * However, it's sufficient for our purposes, and works well enough
  * to load Python C modules.
@@ -27,11 +25,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/sysfunc.h>
 
 #include <kernel/elf.h>
+#include <toaru/ldcache.h>
 
 void * (*_malloc)(size_t size) = malloc;
 void (*_free)(void * ptr) = free;
@@ -43,6 +43,8 @@ void (*_free)(void * ptr) = free;
 
 uintptr_t _malloc_minimum = 0;
 
+extern int __malloc_tls_ready;
+
 static void * malloc(size_t size) {
 	return _malloc(size);
 }
@@ -85,6 +87,9 @@ static char * last_error = NULL;
 
 static int _target_is_suid = 0;
 
+/* Bind PLT entries on first call rather than at load; LD_BIND_NOW opts out. */
+static int _ld_lazy = 1;
+
 typedef struct elf_object {
 	FILE * file;
 
@@ -99,6 +104,12 @@ typedef struct elf_object {
 
 	Elf64_Dyn * dynamic;
 	Elf64_Word * dyn_hash;
+	Elf64_Word * dyn_gnu_hash;
+
+	Elf64_Rela * plt_rela;
+	size_t plt_rela_size;
+	uintptr_t * plt_got;
+	int bind_now;
 
 	void (*init)(void);
 	void (**init_array)(void);
@@ -114,18 +125,65 @@ typedef struct elf_object {
 
 static elf_t * _main_obj = NULL;
 
-/* Locate library for LD_LIBRARY PATH */
-static char * find_lib(const char * file) {
+/* The mmap'd /etc/ld.so.cache, if there is one; see ldconfig. */
+static struct ld_cache_header * _ld_cache = NULL;
 
-	/* If it was an absolute path, there's no need to find it. */
-	if (strchr(file, '/')) return strdup(file);
+static void load_ld_cache(void) {
+	static int tried = 0;
+	if (tried) return;
+	tried = 1;
 
-	/* Collect the environment variable. */
-	char * path = _target_is_suid ? NULL : getenv("LD_LIBRARY_PATH");
-	if (!path) {
-		/* Not set - this is the default state. Should probably read from config file? */
-		path = "/lib:/usr/lib";
+	FILE * f = fopen(LD_CACHE_PATH, "r");
+	if (!f) return;
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	if (size < (long)sizeof(struct ld_cache_header)) {
+		fclose(f);
+		return;
+	}
+
+	/* Read-only shared: every process maps the same physical copy. */
+	void * cache = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(f), 0);
+	fclose(f);
+	if (cache == MAP_FAILED) return;
+
+	struct ld_cache_header * header = cache;
+	if (memcmp(header->magic, LD_CACHE_MAGIC, 8)) return;
+	if (header->version != LD_CACHE_VERSION) return;
+	if (sizeof(struct ld_cache_header) +
+	    header->nbuckets * sizeof(uint32_t) +
+	    header->nentries * sizeof(struct ld_cache_entry) +
+	    header->strings_size > (size_t)size) return;
+
+	_ld_cache = header;
+}
+
+/* Look a library name up in the cache. */
+static char * find_lib_cache(const char * file) {
+	load_ld_cache();
+	if (!_ld_cache) return NULL;
+
+	uint32_t * buckets = (uint32_t *)(_ld_cache + 1);
+	struct ld_cache_entry * entries = (struct ld_cache_entry *)&buckets[_ld_cache->nbuckets];
+	char * strings = (char *)&entries[_ld_cache->nentries];
+
+	uint32_t i = buckets[hashmap_string_hash((void *)file) % _ld_cache->nbuckets];
+	for (; i != LD_CACHE_NONE; i = entries[i].next) {
+		if (!strcmp(strings + entries[i].name, file)) {
+			/* A stale entry falls back to the directory probe. */
+			struct stat stat_buf;
+			if (!stat(strings + entries[i].path, &stat_buf)) {
+				return strdup(strings + entries[i].path);
+			}
+			return NULL;
+		}
 	}
+	return NULL;
+}
+
+/* Probe each directory of a colon-separated path for the library. */
+static char * search_lib_path(const char * file, const char * path) {
 
 	/* Duplicate so we can tokenize without editing */
 	char * xpath = strdup(path);
@@ -159,6 +217,27 @@ static char * find_lib(const char * file) {
 	return NULL;
 }
 
+/* Locate a library by name. */
+static char * find_lib(const char * file) {
+
+	/* If it was an absolute path, there's no need to find it. */
+	if (strchr(file, '/')) return strdup(file);
+
+	/* LD_LIBRARY_PATH takes precedence over the cache. */
+	char * path = _target_is_suid ? NULL : getenv("LD_LIBRARY_PATH");
+	if (path) {
+		char * found = search_lib_path(file, path);
+		if (found) return found;
+	}
+
+	/* The common case: one hashed lookup, no failed opens. */
+	char * found = find_lib_cache(file);
+	if (found) return found;
+
+	/* No cache, or not in it; probe the default directories. */
+	return search_lib_path(file, "/lib:/usr/lib");
+}
+
 /* Open an object file */
 static elf_t * open_object(const char * path) {
 
@@ -290,24 +369,48 @@ static uintptr_t object_load(elf_t * object, uintptr_t base) {
 		switch (phdr.p_type) {
 			case PT_LOAD:
 				{
-					/* Request memory to load this PHDR into */
-					char * args[] = {(char *)(base + phdr.p_vaddr), (char *)phdr.p_memsz};
-					sysfunc(TOARU_SYS_FUNC_MMAP, args);
+					uintptr_t seg_base = base + phdr.p_vaddr;
+					size_t file_pages = phdr.p_filesz & ~(size_t)0xFFF;
+					int writable = phdr.p_flags & PF_W;
+
+					/* When the segment is page-congruent with the file, map
+					 * its full pages out of the kernel page cache. Writable
+					 * segments map copy-on-write, so relocations only dirty
+					 * the pages they touch; read-execute segments map shared
+					 * outright, so every process runs the same physical copy
+					 * of the library's code. */
+					if (file_pages && !((seg_base | phdr.p_offset) & 0xFFF) &&
+					    mmap((void *)seg_base, file_pages,
+					         writable ? (PROT_READ | PROT_WRITE | PROT_EXEC) : (PROT_READ | PROT_EXEC),
+					         (writable ? MAP_PRIVATE : MAP_SHARED) | MAP_FIXED,
+					         fileno(object->file), phdr.p_offset) != MAP_FAILED) {
+						/* Mapped; the tail is copied below. */
+					} else {
+						file_pages = 0;
+					}
 
-					/* Copy the code into memory */
-					fseek(object->file, phdr.p_offset, SEEK_SET);
-					fread((void *)(base + phdr.p_vaddr), phdr.p_filesz, 1, object->file);
+					/* Request memory for whatever the mapping didn't cover */
+					if (phdr.p_memsz > file_pages) {
+						char * args[] = {(char *)(seg_base + file_pages), (char *)(phdr.p_memsz - file_pages)};
+						sysfunc(TOARU_SYS_FUNC_MMAP, args);
+					}
+
+					/* Copy the unmapped part of the code into memory */
+					if (phdr.p_filesz > file_pages) {
+						fseek(object->file, phdr.p_offset + file_pages, SEEK_SET);
+						fread((void *)(seg_base + file_pages), phdr.p_filesz - file_pages, 1, object->file);
+					}
 
 					/* Zero the remaining area */
 					size_t r = phdr.p_filesz;
 					while (r < phdr.p_memsz) {
-						*(char *)(phdr.p_vaddr + base + r) = 0;
+						*(char *)(seg_base + r) = 0;
 						r++;
 					}
 
 					/* If this expands our end address, be sure to update it */
-					if (end_addr < phdr.p_vaddr + base + phdr.p_memsz) {
-						end_addr = phdr.p_vaddr + base + phdr.p_memsz;
+					if (end_addr < seg_base + phdr.p_memsz) {
+						end_addr = seg_base + phdr.p_memsz;
 					}
 				}
 				break;
@@ -342,6 +445,21 @@ static int object_postload(elf_t * object) {
 					object->dyn_hash = (Elf64_Word *)(object->base + table->d_un.d_ptr);
 					object->dyn_symbol_table_size = object->dyn_hash[1];
 					break;
+				case DT_GNU_HASH:
+					object->dyn_gnu_hash = (Elf64_Word *)(object->base + table->d_un.d_ptr);
+					break;
+				case DT_PLTRELSZ:
+					object->plt_rela_size = table->d_un.d_val;
+					break;
+				case DT_PLTGOT:
+					object->plt_got = (uintptr_t *)(object->base + table->d_un.d_ptr);
+					break;
+				case DT_JMPREL:
+					object->plt_rela = (Elf64_Rela *)(object->base + table->d_un.d_ptr);
+					break;
+				case DT_BIND_NOW:
+					object->bind_now = 1;
+					break;
 				case DT_STRTAB:
 					object->dyn_string_table = (char *)(object->base + table->d_un.d_ptr);
 					break;
@@ -364,6 +482,28 @@ static int object_postload(elf_t * object) {
 			table++;
 		}
 
+		/*
+		 * With only a GNU hash table there is no direct symbol count;
+		 * recover it by finding the highest index reachable from the
+		 * buckets and walking its chain to the end marker.
+		 */
+		if (object->dyn_gnu_hash && !object->dyn_symbol_table_size) {
+			Elf64_Word * gh = object->dyn_gnu_hash;
+			Elf64_Word nbuckets = gh[0];
+			Elf64_Word symoffset = gh[1];
+			uint64_t * bloom = (uint64_t *)&gh[4];
+			Elf64_Word * buckets = (Elf64_Word *)&bloom[gh[2]];
+			Elf64_Word * chains = &buckets[nbuckets];
+			Elf64_Word max = 0;
+			for (Elf64_Word b = 0; b < nbuckets; ++b) {
+				Elf64_Word i = buckets[b];
+				if (i < symoffset) continue;
+				while (!(chains[i - symoffset] & 1)) i++;
+				if (i > max) max = i;
+			}
+			object->dyn_symbol_table_size = max ? max + 1 : symoffset;
+		}
+
 		/*
 		 * Read through dependencies
 		 * We have to do this separately from the above to make sure
@@ -400,9 +540,85 @@ static int need_symbol_for_type(unsigned char type) {
 	}
 }
 
+/*
+ * First-call binding for a PLT entry. The trampoline below hands us the
+ * object (from GOT[1]) and the index the PLT entry pushed; we look the
+ * symbol up, patch the GOT slot so later calls go direct, and return
+ * the target for the trampoline to jump to.
+ */
+uintptr_t _ld_resolve(elf_t * object, uintptr_t idx) {
+	Elf64_Rela * table = &object->plt_rela[idx];
+	Elf64_Sym * sym = &object->dyn_symbol_table[ELF64_R_SYM(table->r_info)];
+	char * symname = (char *)((uintptr_t)object->dyn_string_table + sym->st_name);
+
+	uintptr_t x = (uintptr_t)hashmap_get(dumb_symbol_table, symname);
+	if (!x) {
+		fprintf(stderr, "ld.so: unresolved symbol '%s' in lazy binding\n", symname);
+		exit(1);
+	}
+
+	memcpy((void *)(table->r_offset + object->base), &x, sizeof(uintptr_t));
+	return x;
+}
+
+/*
+ * Entered from unbound PLT slots via GOT[2]. On arrival the PLT has
+ * pushed the relocation index and then GOT[1] (the object). Everything
+ * the caller's arguments might live in has to survive the resolver.
+ */
+extern void _ld_resolve_stub(void);
+__asm__(
+	".global _ld_resolve_stub\n"
+	"_ld_resolve_stub:\n"
+	"	pushq %rax\n"
+	"	pushq %rcx\n"
+	"	pushq %rdx\n"
+	"	pushq %rsi\n"
+	"	pushq %rdi\n"
+	"	pushq %r8\n"
+	"	pushq %r9\n"
+	"	subq $128, %rsp\n"
+	"	movaps %xmm0, 0(%rsp)\n"
+	"	movaps %xmm1, 16(%rsp)\n"
+	"	movaps %xmm2, 32(%rsp)\n"
+	"	movaps %xmm3, 48(%rsp)\n"
+	"	movaps %xmm4, 64(%rsp)\n"
+	"	movaps %xmm5, 80(%rsp)\n"
+	"	movaps %xmm6, 96(%rsp)\n"
+	"	movaps %xmm7, 112(%rsp)\n"
+	"	movq 184(%rsp), %rdi\n" /* object */
+	"	movq 192(%rsp), %rsi\n" /* relocation index */
+	"	call _ld_resolve\n"
+	"	movq %rax, %r11\n"
+	"	movaps 0(%rsp), %xmm0\n"
+	"	movaps 16(%rsp), %xmm1\n"
+	"	movaps 32(%rsp), %xmm2\n"
+	"	movaps 48(%rsp), %xmm3\n"
+	"	movaps 64(%rsp), %xmm4\n"
+	"	movaps 80(%rsp), %xmm5\n"
+	"	movaps 96(%rsp), %xmm6\n"
+	"	movaps 112(%rsp), %xmm7\n"
+	"	addq $128, %rsp\n"
+	"	popq %r9\n"
+	"	popq %r8\n"
+	"	popq %rdi\n"
+	"	popq %rsi\n"
+	"	popq %rdx\n"
+	"	popq %rcx\n"
+	"	popq %rax\n"
+	"	addq $16, %rsp\n" /* drop object and index */
+	"	jmp *%r11\n"
+);
+
 /* Apply ELF relocations */
 static int object_relocate(elf_t * object) {
 
+	int lazy = _ld_lazy && !object->bind_now && object->plt_rela && object->plt_got;
+	if (lazy) {
+		object->plt_got[1] = (uintptr_t)object;
+		object->plt_got[2] = (uintptr_t)_ld_resolve_stub;
+	}
+
 	/* If there is a dynamic symbol table, load symbols */
 	if (object->dyn_symbol_table) {
 		Elf64_Sym * table = object->dyn_symbol_table;
@@ -439,6 +655,17 @@ static int object_relocate(elf_t * object) {
 				unsigned int type = ELF64_R_TYPE(table->r_info);
 				Elf64_Sym * sym = &object->dyn_symbol_table[symbol];
 
+				if (lazy && type == R_X86_64_JUMP_SLOT &&
+				    table >= object->plt_rela &&
+				    table < (Elf64_Rela *)((uintptr_t)object->plt_rela + object->plt_rela_size)) {
+					/* Leave the slot pointing into the PLT push sequence,
+					 * adjusted for where we actually loaded; the first call
+					 * lands in _ld_resolve_stub and binds it. */
+					*(uintptr_t *)(table->r_offset + object->base) += object->base;
+					table++;
+					continue;
+				}
+
 				/* If we need symbol for this, get it. */
 				char * symname = NULL;
 				uintptr_t x = sym->st_value + object->base;
@@ -580,6 +807,25 @@ static void object_find_copy_relocations(elf_t * object) {
 	}
 }
 
+static uint32_t gnu_hash(const char * name) {
+	uint32_t h = 5381;
+	for (; *name; name++) {
+		h = (h << 5) + h + (unsigned char)*name;
+	}
+	return h;
+}
+
+static uint32_t sysv_hash(const char * name) {
+	uint32_t h = 0;
+	for (; *name; name++) {
+		h = (h << 4) + (unsigned char)*name;
+		uint32_t g = h & 0xF0000000;
+		if (g) h ^= g >> 24;
+		h &= ~g;
+	}
+	return h;
+}
+
 /* Find a symbol in a specific object. */
 static void * object_find_symbol(elf_t * object, const char * symbol_name) {
 
@@ -588,14 +834,57 @@ static void * object_find_symbol(elf_t * object, const char * symbol_name) {
 		return NULL;
 	}
 
-	Elf64_Sym * table = object->dyn_symbol_table;
-	size_t i = 0;
-	while (i < object->dyn_symbol_table_size) {
-		if (!strcmp(symbol_name, (char *)((uintptr_t)object->dyn_string_table + table->st_name))) {
-			return (void *)(table->st_value + object->base);
+	if (object->dyn_gnu_hash) {
+		Elf64_Word * gh = object->dyn_gnu_hash;
+		Elf64_Word nbuckets = gh[0];
+		Elf64_Word symoffset = gh[1];
+		Elf64_Word bloom_size = gh[2];
+		Elf64_Word bloom_shift = gh[3];
+		uint64_t * bloom = (uint64_t *)&gh[4];
+		Elf64_Word * buckets = (Elf64_Word *)&bloom[bloom_size];
+		Elf64_Word * chains = &buckets[nbuckets];
+
+		uint32_t h = gnu_hash(symbol_name);
+
+		/* Two bits of the hash index a bloom filter over the object's
+		 * exports; most misses are rejected right here. */
+		uint64_t word = bloom[(h / 64) % bloom_size];
+		uint64_t mask = (1UL << (h % 64)) | (1UL << ((h >> bloom_shift) % 64));
+		if ((word & mask) == mask) {
+			Elf64_Word i = buckets[h % nbuckets];
+			if (i >= symoffset) {
+				for (;;) {
+					Elf64_Word ch = chains[i - symoffset];
+					if ((ch | 1) == (h | 1) &&
+					    !strcmp(symbol_name, (char *)((uintptr_t)object->dyn_string_table + object->dyn_symbol_table[i].st_name))) {
+						return (void *)(object->dyn_symbol_table[i].st_value + object->base);
+					}
+					if (ch & 1) break;
+					i++;
+				}
+			}
+		}
+	} else if (object->dyn_hash) {
+		Elf64_Word * ht = object->dyn_hash;
+		Elf64_Word nbucket = ht[0];
+		Elf64_Word * buckets = &ht[2];
+		Elf64_Word * chains = &buckets[nbucket];
+
+		for (Elf64_Word i = buckets[sysv_hash(symbol_name) % nbucket]; i; i = chains[i]) {
+			if (!strcmp(symbol_name, (char *)((uintptr_t)object->dyn_string_table + object->dyn_symbol_table[i].st_name))) {
+				return (void *)(object->dyn_symbol_table[i].st_value + object->base);
+			}
+		}
+	} else {
+		Elf64_Sym * table = object->dyn_symbol_table;
+		size_t i = 0;
+		while (i < object->dyn_symbol_table_size) {
+			if (!strcmp(symbol_name, (char *)((uintptr_t)object->dyn_string_table + table->st_name))) {
+				return (void *)(table->st_value + object->base);
+			}
+			table++;
+			i++;
 		}
-		table++;
-		i++;
 	}
 
 	last_error = "symbol not found in library";
@@ -620,11 +909,13 @@ static void * do_actual_load(const char * filename, elf_t * lib, int flags) {
 	}
 
 	/*
-	 * Allocate space to load the library
-	 * This is where we should really be loading things into COW
-	 * but we don't have the functionality available.
+	 * Allocate space to load the library. The load base is rounded up
+	 * to a page boundary so that page-congruent segments can be mapped
+	 * copy-on-write from the page cache in object_load rather than
+	 * copied.
 	 */
-	uintptr_t load_addr = (uintptr_t)malloc(lib_size);
+	uintptr_t load_region = (uintptr_t)malloc(lib_size + 0xFFF);
+	uintptr_t load_addr = (load_region + 0xFFF) & ~(uintptr_t)0xFFF;
 	object_load(lib, load_addr);
 
 	/* Perform cleanup steps */
@@ -639,7 +930,7 @@ static void * do_actual_load(const char * filename, elf_t * lib, int flags) {
 		if (!_lib) {
 			/* Missing dependencies are fatal to this process, but
 			 * not to the entire application. */
-			free((void *)load_addr);
+			free((void *)load_region);
 			last_error = "Failed to load a dependency.";
 			lib->loaded = 0;
 			TRACE_LD("Failed to load object: %s", item->value);
@@ -822,12 +1113,24 @@ int main(int argc, char * argv[]) {
 
 	_argv_value = argv+arg_offset;
 
+	/* Our statically-linked malloc must not use its per-thread magazines:
+	 * dlopen() re-enters this code from application threads long after
+	 * the libc.so in the target has replaced the thread pointer we were
+	 * started with, so our thread-local arena pointer is meaningless. */
+	__malloc_tls_ready = 0;
+
 	/* Enable tracing if requested */
 	char * trace_ld_env = getenv("LD_DEBUG");
 	if (trace_ld_env && (!strcmp(trace_ld_env,"1") || !strcmp(trace_ld_env,"yes"))) {
 		__trace_ld = 1;
 	}
 
+	/* Latency-critical things can ask for everything up front. */
+	char * bind_now_env = getenv("LD_BIND_NOW");
+	if (bind_now_env && *bind_now_env && strcmp(bind_now_env,"0")) {
+		_ld_lazy = 0;
+	}
+
 	/* Initialize hashmaps for symbols, GLOB_DATs, and objects */
 	dumb_symbol_table = hashmap_create(100);
 	glob_dat = hashmap_create(10);
@@ -869,6 +1172,19 @@ int main(int argc, char * argv[]) {
 	object_postload(main_obj);
 	object_find_copy_relocations(main_obj);
 
+	/* Static TLS offsets we hand out for shared-object thread locals must
+	 * start past the executable's own PT_TLS block, whose (negative)
+	 * offsets from the thread pointer were fixed by the static linker. */
+	for (size_t i = 0; i < main_obj->header.e_phnum; ++i) {
+		Elf64_Phdr phdr;
+		fseek(main_obj->file, main_obj->header.e_phoff + main_obj->header.e_phentsize * i, SEEK_SET);
+		fread(&phdr, main_obj->header.e_phentsize, 1, main_obj->file);
+		if (phdr.p_type == PT_TLS) {
+			current_tls_offset = (phdr.p_memsz + 15) & ~(size_t)15;
+			break;
+		}
+	}
+
 	/* Load library dependencies */
 	hashmap_t * libs = hashmap_create(10);
 
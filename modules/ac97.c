@@ -52,7 +52,8 @@
 /* Bus mastering misc */
 /* Buffer descriptor list constants */
 #define AC97_BDL_LEN              32                    /* Buffer descriptor list length */
-#define AC97_BDL_BUFFER_LEN       0x1000                /* Length of buffer in BDL */
+#define AC97_BDL_BUFFER_LEN       0x1000                /* Maximum length of buffer in BDL, in samples */
+#define AC97_PERIOD_MIN           0x100                 /* Minimum period, in samples (~1.3ms) */
 #define AC97_CL_GET_LENGTH(cl)    ((cl) & 0xFFFF)       /* Decode length from cl */
 #define AC97_CL_SET_LENGTH(cl, v) ((cl) = (v) & 0xFFFF) /* Encode length to cl */
 #define AC97_CL_BUP               ((uint32_t)1 << 30)             /* Buffer underrun policy in cl */
@@ -101,6 +102,7 @@ typedef struct {
 	uint16_t * bufs[AC97_BDL_LEN];  /* Virtual addresses for buffers in BDL */
 	uint32_t bdl_p;
 	uint32_t mask;
+	uint16_t period_samples;        /* Samples per BDL entry; one interrupt each */
 } ac97_device_t;
 
 static ac97_device_t _device;
@@ -120,6 +122,8 @@ static snd_knob_t _knobs[] = {
 
 static int ac97_mixer_read(uint32_t knob_id, uint32_t *val);
 static int ac97_mixer_write(uint32_t knob_id, uint32_t val);
+static int ac97_set_period(struct snd_device * dev, uint32_t frames);
+static uint32_t ac97_get_position(struct snd_device * dev);
 
 static snd_device_t _snd = {
 	.name            = AC97_SND_NAME,
@@ -132,6 +136,11 @@ static snd_device_t _snd = {
 
 	.mixer_read  = ac97_mixer_read,
 	.mixer_write = ac97_mixer_write,
+
+	.period_frames = AC97_BDL_BUFFER_LEN / 2,
+	.period_count  = 2,
+	.set_period    = ac97_set_period,
+	.get_position  = ac97_get_position,
 };
 
 /* 
@@ -149,15 +158,15 @@ static void find_ac97(uint32_t device, uint16_t vendorid, uint16_t deviceid, voi
 
 }
 
-#define DIVISION 0x1000
 static int ac97_irq_handler(struct regs * regs) {
 	uint16_t sr = inports(_device.nabmbar + AC97_PO_SR);
 	if (sr & AC97_X_SR_BCIS) {
+		/* One period completed; refill the descriptor two ahead of the
+		 * engine, so there is always one full period queued behind it. */
 		uint16_t current_buffer = inportb(_device.nabmbar + AC97_PO_CIV);
 		uint16_t last_valid = ((current_buffer+2) & (AC97_BDL_LEN-1));
-		snd_request_buf(&_snd, 0x1000, (uint8_t *)_device.bufs[last_valid]);
+		snd_request_buf(&_snd, _device.period_samples * 2, (uint8_t *)_device.bufs[last_valid]);
 		outportb(_device.nabmbar + AC97_PO_LVI, last_valid);
-		snd_request_buf(&_snd, 0x1000, (uint8_t *)_device.bufs[last_valid]+0x1000);
 		outports(_device.nabmbar + AC97_PO_SR, AC97_X_SR_BCIS);
 	} else if (sr & AC97_X_SR_LVBCI) {
 		outports(_device.nabmbar + AC97_PO_SR, AC97_X_SR_LVBCI);
@@ -243,6 +252,48 @@ static int ac97_mixer_write(uint32_t knob_id, uint32_t val) {
 	return 0;
 }
 
+/**
+ * Reconfigure the DMA period. Smaller periods mean more interrupts but
+ * less latency: output is always at most period_count periods behind
+ * the writer. The engine is halted while descriptor lengths change and
+ * the two periods ahead of it are refilled at the new size.
+ */
+static int ac97_set_period(struct snd_device * dev, uint32_t frames) {
+	uint32_t samples = frames * 2; /* 16-bit stereo: two samples per frame */
+	if (samples < AC97_PERIOD_MIN || samples > AC97_BDL_BUFFER_LEN) return -EINVAL;
+	if (samples & 0x3F) return -EINVAL; /* Keep descriptors FIFO-aligned */
+
+	uint8_t cr = inportb(_device.nabmbar + AC97_PO_CR);
+	outportb(_device.nabmbar + AC97_PO_CR, cr & ~AC97_X_CR_RPBM);
+
+	_device.period_samples = samples;
+	for (int i = 0; i < AC97_BDL_LEN; i++) {
+		AC97_CL_SET_LENGTH(_device.bdl[i].cl, samples);
+		_device.bdl[i].cl |= AC97_CL_IOC;
+	}
+	dev->period_frames = frames;
+
+	uint16_t civ = inportb(_device.nabmbar + AC97_PO_CIV);
+	for (int i = 1; i <= 2; i++) {
+		uint16_t idx = (civ + i) & (AC97_BDL_LEN - 1);
+		snd_request_buf(&_snd, samples * 2, (uint8_t *)_device.bufs[idx]);
+	}
+	outportb(_device.nabmbar + AC97_PO_LVI, (civ + 2) & (AC97_BDL_LEN - 1));
+	outportb(_device.nabmbar + AC97_PO_CR, cr | AC97_X_CR_RPBM);
+	return 0;
+}
+
+/**
+ * Current playback position within the descriptor ring, in sample
+ * frames: whole periods before CIV plus the consumed part of the
+ * current one (PICB counts samples the engine has left to fetch).
+ */
+static uint32_t ac97_get_position(struct snd_device * dev) {
+	uint8_t civ = inportb(_device.nabmbar + AC97_PO_CIV);
+	uint16_t picb = inports(_device.nabmbar + AC97_PO_PICB);
+	return ((uint32_t)civ * _device.period_samples + (_device.period_samples - picb)) / 2;
+}
+
 static int ac97_install(int argc, char * argv[]) {
 	//debug_print(NOTICE, "Initializing AC97");
 	pci_scan(&find_ac97, -1, &_device);
@@ -267,11 +318,12 @@ static int ac97_install(int argc, char * argv[]) {
 	_device.bdl   = mmu_map_from_physical(_device.bdl_p);
 	memset(_device.bdl, 0, AC97_BDL_LEN * sizeof(*_device.bdl));
 
+	_device.period_samples = AC97_BDL_BUFFER_LEN;
 	for (int i = 0; i < AC97_BDL_LEN; i++) {
 		_device.bdl[i].pointer = mmu_allocate_n_frames(2) << 12;
 		_device.bufs[i] = mmu_map_from_physical(_device.bdl[i].pointer);
 		memset(_device.bufs[i], 0, AC97_BDL_BUFFER_LEN * sizeof(*_device.bufs[0]));
-		AC97_CL_SET_LENGTH(_device.bdl[i].cl, AC97_BDL_BUFFER_LEN);
+		AC97_CL_SET_LENGTH(_device.bdl[i].cl, _device.period_samples);
 		/* Set all buffers to interrupt */
 		_device.bdl[i].cl |= AC97_CL_IOC;
 
@@ -179,6 +179,7 @@ struct ata_device {
 	int control;
 	int slave;
 	int is_atapi;
+	int use_dma;
 	ata_identify_t identity;
 	prdt_t * dma_prdt;
 	uintptr_t dma_prdt_phys;
@@ -201,10 +202,15 @@ static spin_lock_t atapi_cmd_lock = { 0 };
 #define ATA_CACHE_SIZE  4096
 #define SECTORS_PER_CACHE_BLOCK 8
 
+/* One command can move up to the size of the DMA staging buffer. */
+#define ATA_DMA_BUFFER_SIZE 0x10000
+#define ATA_MAX_SECTORS (ATA_DMA_BUFFER_SIZE / ATA_SECTOR_SIZE)
+
 static void ata_device_read_sector(struct ata_device * dev, uint64_t lba, uint8_t * buf);
+static void ata_device_read_range(struct ata_device * dev, uint64_t lba, size_t count, uint8_t * buf);
 static void ata_device_read_sector_atapi(struct ata_device * dev, uint64_t lba, uint8_t * buf);
 static void ata_device_write_sector(struct ata_device * dev, uint64_t lba, uint8_t * buf);
-static void ata_device_write_sector_actual(struct ata_device * dev, uint64_t lba);
+static void ata_device_write_actual(struct ata_device * dev, uint64_t lba, size_t count);
 
 struct CacheEntry {
 	struct ata_device * dev;
@@ -287,9 +293,20 @@ static ssize_t read_ata(fs_node_t *node, off_t offset, size_t size, uint8_t *buf
 	}
 
 	while (start_block <= end_block) {
-		ata_device_read_sector(dev, start_block, (uint8_t *)((uintptr_t)buffer + x_offset));
-		x_offset += ATA_CACHE_SIZE;
-		start_block++;
+		unsigned int run = end_block - start_block + 1;
+		if (run > ATA_MAX_SECTORS / SECTORS_PER_CACHE_BLOCK) run = ATA_MAX_SECTORS / SECTORS_PER_CACHE_BLOCK;
+		if (run > 1) {
+			/* Aligned bulk of a big read: one multi-sector command,
+			 * instead of one command per 4KiB block. */
+			ata_device_read_range(dev, (uint64_t)start_block * SECTORS_PER_CACHE_BLOCK,
+				run * SECTORS_PER_CACHE_BLOCK, (uint8_t *)((uintptr_t)buffer + x_offset));
+			x_offset += run * ATA_CACHE_SIZE;
+			start_block += run;
+		} else {
+			ata_device_read_sector(dev, start_block, (uint8_t *)((uintptr_t)buffer + x_offset));
+			x_offset += ATA_CACHE_SIZE;
+			start_block++;
+		}
 	}
 
 	return size;
@@ -421,7 +438,7 @@ static int ioctl_ata(fs_node_t * node, unsigned long request, void * argp) {
 				if (cache_entries[i].dev == dev && cache_entries[i].flags & 1) {
 					eviction_count++;
 					memcpy(cache_entries[i].dev->dma_start, cache_blocks + i * ATA_CACHE_SIZE, ATA_CACHE_SIZE);
-					ata_device_write_sector_actual(cache_entries[i].dev, cache_entries[i].lba);
+					ata_device_write_actual(cache_entries[i].dev, cache_entries[i].lba, SECTORS_PER_CACHE_BLOCK);
 					cache_entries[i].flags = 0;
 				}
 			}
@@ -572,8 +589,11 @@ static void ata_device_init(struct ata_device * dev) {
 	}
 
 	dev->is_atapi = 0;
+	/* The staging buffer is physically contiguous, so one PRD entry
+	 * covers a whole multi-sector transfer; per-command setup fills in
+	 * the byte count. */
 	dev->dma_prdt  = (void *)kvmalloc_p(4096, &dev->dma_prdt_phys);
-	dev->dma_start = (void *)kvmalloc_p(4096, &dev->dma_start_phys);
+	dev->dma_start = (void *)kvmalloc_p(ATA_DMA_BUFFER_SIZE, &dev->dma_start_phys);
 	dev->dma_prdt[0].offset = dev->dma_start_phys;
 	dev->dma_prdt[0].bytes = ATA_CACHE_SIZE;
 	dev->dma_prdt[0].last = 0x8000;
@@ -589,8 +609,10 @@ static void ata_device_init(struct ata_device * dev) {
 
 	if (dev->bar4 & 0x00000001) {
 		dev->bar4 = dev->bar4 & 0xFFFFFFFC;
+		dev->use_dma = 1;
 	} else {
-		return; /* No DMA because we're not sure what to do here */
+		/* No busmaster interface; transfers fall back to PIO. */
+		dev->use_dma = 0;
 	}
 }
 
@@ -753,18 +775,53 @@ static int ata_device_detect(struct ata_device * dev) {
 	return 0;
 }
 
-static void ata_device_read_sector_actual(struct ata_device * dev, uint64_t lba) {
+/* Program the taskfile for an LBA48 transfer of @p count sectors. */
+static void ata_set_lba48(struct ata_device * dev, uint64_t lba, size_t count) {
+	uint16_t bus = dev->io_base;
+
+	outportb(bus + ATA_REG_SECCOUNT0, (count >> 8) & 0xFF);
+	outportb(bus + ATA_REG_LBA0, (lba & 0xff000000) >> 24);
+	outportb(bus + ATA_REG_LBA1, (lba & 0xff00000000) >> 32);
+	outportb(bus + ATA_REG_LBA2, (lba & 0xff0000000000) >> 40);
+
+	outportb(bus + ATA_REG_SECCOUNT0, count & 0xFF);
+	outportb(bus + ATA_REG_LBA0, (lba & 0x000000ff) >>  0);
+	outportb(bus + ATA_REG_LBA1, (lba & 0x0000ff00) >>  8);
+	outportb(bus + ATA_REG_LBA2, (lba & 0x00ff0000) >> 16);
+}
+
+static void ata_device_read_actual(struct ata_device * dev, uint64_t lba, size_t count) {
 	uint16_t bus = dev->io_base;
 	uint8_t slave = dev->slave;
 
 	if (dev->is_atapi) return;
+	if (count > ATA_MAX_SECTORS) return;
 
 	ata_wait(dev, 0);
 
+	if (!dev->use_dma) {
+		/* PIO fallback for controllers without a busmaster interface;
+		 * interrupts masked, polled transfer into the staging buffer. */
+		outportb(bus + ATA_REG_CONTROL, 0x02);
+		outportb(bus + ATA_REG_HDDEVSEL, 0xe0 | slave << 4);
+		ata_io_wait(dev);
+		outportb(bus + ATA_REG_FEATURES, 0x00);
+		ata_set_lba48(dev, lba, count);
+		outportb(bus + ATA_REG_COMMAND, ATA_CMD_READ_PIO_EXT);
+		for (size_t s = 0; s < count; ++s) {
+			if (ata_wait(dev, 1)) break;
+			inportsm(bus, dev->dma_start + s * ATA_SECTOR_SIZE, ATA_SECTOR_SIZE / 2);
+		}
+		return;
+	}
+
 	/* Stop */
 	outportb(dev->bar4, 0x00);
 
-	/* Set the PRDT */
+	/* Set the PRDT; a byte count of zero means a full 64KiB. */
+	dev->dma_prdt[0].offset = dev->dma_start_phys;
+	dev->dma_prdt[0].bytes = (count * ATA_SECTOR_SIZE) & 0xFFFF;
+	dev->dma_prdt[0].last = 0x8000;
 	outportl(dev->bar4 + 0x04, dev->dma_prdt_phys);
 
 	/* Enable error, irq status */
@@ -783,15 +840,7 @@ static void ata_device_read_sector_actual(struct ata_device * dev, uint64_t lba)
 	ata_io_wait(dev);
 	outportb(bus + ATA_REG_FEATURES, 0x00);
 
-	outportb(bus + ATA_REG_SECCOUNT0, 0);
-	outportb(bus + ATA_REG_LBA0, (lba & 0xff000000) >> 24);
-	outportb(bus + ATA_REG_LBA1, (lba & 0xff00000000) >> 32);
-	outportb(bus + ATA_REG_LBA2, (lba & 0xff0000000000) >> 40);
-
-	outportb(bus + ATA_REG_SECCOUNT0, SECTORS_PER_CACHE_BLOCK);
-	outportb(bus + ATA_REG_LBA0, (lba & 0x000000ff) >>  0);
-	outportb(bus + ATA_REG_LBA1, (lba & 0x0000ff00) >>  8);
-	outportb(bus + ATA_REG_LBA2, (lba & 0x00ff0000) >> 16);
+	ata_set_lba48(dev, lba, count);
 
 	while (1) {
 		uint8_t status = inportb(dev->io_base + ATA_REG_STATUS);
@@ -890,12 +939,35 @@ atapi_timeout:
 	return;
 }
 
-static void ata_device_write_sector_actual(struct ata_device * dev, uint64_t lba) {
+static void ata_device_write_actual(struct ata_device * dev, uint64_t lba, size_t count) {
 	uint16_t bus = dev->io_base;
 	uint8_t slave = dev->slave;
 
+	if (count > ATA_MAX_SECTORS) return;
+
 	ata_wait(dev, 0);
+
+	if (!dev->use_dma) {
+		/* PIO fallback, writing out of the staging buffer. */
+		outportb(bus + ATA_REG_CONTROL, 0x02);
+		outportb(bus + ATA_REG_HDDEVSEL, 0xe0 | slave << 4);
+		ata_io_wait(dev);
+		outportb(bus + ATA_REG_FEATURES, 0x00);
+		ata_set_lba48(dev, lba, count);
+		outportb(bus + ATA_REG_COMMAND, ATA_CMD_WRITE_PIO_EXT);
+		for (size_t s = 0; s < count; ++s) {
+			if (ata_wait(dev, 1)) break;
+			outportsm(bus, dev->dma_start + s * ATA_SECTOR_SIZE, ATA_SECTOR_SIZE / 2);
+		}
+		outportb(bus + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH_EXT);
+		ata_wait(dev, 0);
+		return;
+	}
+
 	outportb(dev->bar4, 0x00);
+	dev->dma_prdt[0].offset = dev->dma_start_phys;
+	dev->dma_prdt[0].bytes = (count * ATA_SECTOR_SIZE) & 0xFFFF;
+	dev->dma_prdt[0].last = 0x8000;
 	outportl(dev->bar4 + 0x04, dev->dma_prdt_phys);
 	outportb(dev->bar4 + 0x2, inportb(dev->bar4 + 0x02) | 0x04 | 0x02);
 
@@ -912,15 +984,7 @@ static void ata_device_write_sector_actual(struct ata_device * dev, uint64_t lba
 	ata_wait(dev, 0);
 	outportb(bus + ATA_REG_FEATURES, 0x00);
 
-	outportb(bus + ATA_REG_SECCOUNT0, 0);
-	outportb(bus + ATA_REG_LBA0, (lba & 0xff000000) >> 24);
-	outportb(bus + ATA_REG_LBA1, (lba & 0xff00000000) >> 32);
-	outportb(bus + ATA_REG_LBA2, (lba & 0xff0000000000) >> 40);
-
-	outportb(bus + ATA_REG_SECCOUNT0, SECTORS_PER_CACHE_BLOCK);
-	outportb(bus + ATA_REG_LBA0, (lba & 0x000000ff) >>  0);
-	outportb(bus + ATA_REG_LBA1, (lba & 0x0000ff00) >>  8);
-	outportb(bus + ATA_REG_LBA2, (lba & 0x00ff0000) >> 16);
+	ata_set_lba48(dev, lba, count);
 
 	while (1) {
 		uint8_t status = inportb(dev->io_base + ATA_REG_STATUS);
@@ -934,18 +998,7 @@ static void ata_device_write_sector_actual(struct ata_device * dev, uint64_t lba
 	outportb(dev->bar4, 0x00 | 0x01);
 	sleep_on_unlocking(atapi_waiter, &atapi_cmd_lock);
 
-	#if 0
-	ata_wait(dev, 0);
-	int size = ATA_SECTOR_SIZE / 2;
-	outportsm(bus,buf,size);
-	#endif
-
 	outportb(dev->bar4 + 0x2, inportb(dev->bar4 + 0x02) | 0x04 | 0x02);
-
-#if 0
-	outportb(bus + 0x07, ATA_CMD_CACHE_FLUSH);
-	ata_wait(dev, 0);
-#endif
 }
 
 static void ata_device_read_sector(struct ata_device * dev, uint64_t lba, uint8_t * buf) {
@@ -975,9 +1028,9 @@ static void ata_device_read_sector(struct ata_device * dev, uint64_t lba, uint8_
 		if (cache_entries[oldest].dev && cache_entries[oldest].flags & 1) {
 			eviction_count++;
 			memcpy(cache_entries[oldest].dev->dma_start, cache_blocks + oldest * ATA_CACHE_SIZE, ATA_CACHE_SIZE);
-			ata_device_write_sector_actual(cache_entries[oldest].dev, cache_entries[oldest].lba);
+			ata_device_write_actual(cache_entries[oldest].dev, cache_entries[oldest].lba, SECTORS_PER_CACHE_BLOCK);
 		}
-		ata_device_read_sector_actual(dev, lba);
+		ata_device_read_actual(dev, lba, SECTORS_PER_CACHE_BLOCK);
 		cache_entries[oldest].dev = dev;
 		cache_entries[oldest].lba = lba;
 		cache_entries[oldest].flags = 0;
@@ -988,6 +1041,29 @@ static void ata_device_read_sector(struct ata_device * dev, uint64_t lba, uint8_
 	mutex_release(ata_mutex);
 }
 
+/**
+ * Bulk read of @p count sectors in one (or one DMA-buffer-sized) command,
+ * bypassing the block cache for the data itself. Cached blocks in the
+ * range are overlaid on top of the transfer afterwards so that dirty,
+ * not-yet-evicted writes remain visible. Large streaming reads do not
+ * populate the cache - that would just flush it.
+ */
+static void ata_device_read_range(struct ata_device * dev, uint64_t lba, size_t count, uint8_t * buf) {
+	mutex_acquire(ata_mutex);
+	ata_device_read_actual(dev, lba, count);
+	memcpy(buf, dev->dma_start, count * ATA_SECTOR_SIZE);
+	for (int i = 0; i < CACHE_COUNT; ++i) {
+		if (cache_entries[i].dev == dev &&
+			cache_entries[i].lba >= lba &&
+			cache_entries[i].lba + SECTORS_PER_CACHE_BLOCK <= lba + count) {
+			memcpy(buf + (cache_entries[i].lba - lba) * ATA_SECTOR_SIZE,
+				cache_blocks + i * ATA_CACHE_SIZE, ATA_CACHE_SIZE);
+			cache_entries[i].last_use = counter++;
+		}
+	}
+	mutex_release(ata_mutex);
+}
+
 static void ata_device_write_sector(struct ata_device * dev, uint64_t lba, uint8_t * buf) {
 	lba *= SECTORS_PER_CACHE_BLOCK;
 	mutex_acquire(ata_mutex);
@@ -1014,7 +1090,7 @@ static void ata_device_write_sector(struct ata_device * dev, uint64_t lba, uint8
 		if (cache_entries[oldest].dev && cache_entries[oldest].flags & 1) {
 			eviction_count++;
 			memcpy(cache_entries[oldest].dev->dma_start, cache_blocks + oldest * ATA_CACHE_SIZE, ATA_CACHE_SIZE);
-			ata_device_write_sector_actual(cache_entries[oldest].dev, cache_entries[oldest].lba);
+			ata_device_write_actual(cache_entries[oldest].dev, cache_entries[oldest].lba, SECTORS_PER_CACHE_BLOCK);
 		}
 		cache_entries[oldest].dev = dev;
 		cache_entries[oldest].lba = lba;
@@ -1,8 +1,10 @@
 /**
  * @file modules/dospart.c
- * @brief DOS MBR partition table mapper
+ * @brief DOS MBR and GPT partition table mapper
  *
- * Provides partition entries for disks.
+ * Provides partition entries for disks. A protective MBR (single 0xEE
+ * partition) hands over to the GPT parser; otherwise the classic four
+ * MBR slots are mapped.
  *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
@@ -14,6 +16,7 @@
 #include <kernel/vfs.h>
 #include <kernel/printf.h>
 #include <kernel/tokenize.h>
+#include <kernel/blockcache.h>
 
 #define SECTORSIZE      512
 
@@ -32,37 +35,64 @@ typedef struct {
 	uint8_t     signature[2];
 } __attribute__((packed)) mbr_t;
 
+typedef struct {
+	char     signature[8];  /* "EFI PART" */
+	uint32_t revision;
+	uint32_t header_size;
+	uint32_t crc32;
+	uint32_t _reserved;
+	uint64_t current_lba;
+	uint64_t backup_lba;
+	uint64_t first_usable;
+	uint64_t last_usable;
+	uint8_t  disk_guid[16];
+	uint64_t entries_lba;
+	uint32_t entry_count;
+	uint32_t entry_size;
+	uint32_t entries_crc32;
+} __attribute__((packed)) gpt_header_t;
+
+typedef struct {
+	uint8_t  type_guid[16]; /* All zeros = unused entry */
+	uint8_t  part_guid[16];
+	uint64_t first_lba;
+	uint64_t last_lba;      /* Inclusive */
+	uint64_t attributes;
+	uint16_t name[36];
+} __attribute__((packed)) gpt_entry_t;
+
 struct dos_partition_entry {
 	fs_node_t * device;
-	partition_t partition;
+	uint64_t first_sector;
+	uint64_t sector_count;
 };
 
 static ssize_t read_part(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
 	struct dos_partition_entry * device = (struct dos_partition_entry *)node->device;
 
-	if ((size_t)offset > device->partition.sector_count * SECTORSIZE) {
+	if ((size_t)offset > device->sector_count * SECTORSIZE) {
 		return 0;
 	}
 
-	if (offset + size > device->partition.sector_count * SECTORSIZE) {
-		size = device->partition.sector_count * SECTORSIZE - offset;
+	if (offset + size > device->sector_count * SECTORSIZE) {
+		size = device->sector_count * SECTORSIZE - offset;
 	}
 
-	return read_fs(device->device, offset + device->partition.lba_first_sector * SECTORSIZE, size, buffer);
+	return read_fs(device->device, offset + device->first_sector * SECTORSIZE, size, buffer);
 }
 
 static ssize_t write_part(fs_node_t *node, off_t offset, size_t size, uint8_t *buffer) {
 	struct dos_partition_entry * device = (struct dos_partition_entry *)node->device;
 
-	if ((size_t)offset > device->partition.sector_count * SECTORSIZE) {
+	if ((size_t)offset > device->sector_count * SECTORSIZE) {
 		return 0;
 	}
 
-	if (offset + size > device->partition.sector_count * SECTORSIZE) {
-		size = device->partition.sector_count * SECTORSIZE - offset;
+	if (offset + size > device->sector_count * SECTORSIZE) {
+		size = device->sector_count * SECTORSIZE - offset;
 	}
 
-	return write_fs(device->device, offset + device->partition.lba_first_sector * SECTORSIZE, size, buffer);
+	return write_fs(device->device, offset + device->first_sector * SECTORSIZE, size, buffer);
 }
 
 static void open_part(fs_node_t * node, unsigned int flags) {
@@ -73,12 +103,13 @@ static void close_part(fs_node_t * node) {
 	return;
 }
 
-static fs_node_t * dospart_device_create(int i, fs_node_t * dev, mbr_t * mbr, int id) {
+static fs_node_t * dospart_device_create(int i, fs_node_t * dev, uint64_t first_sector, uint64_t sector_count) {
 
 	vfs_lock(dev);
 
 	struct dos_partition_entry * device = malloc(sizeof(struct dos_partition_entry));
-	memcpy(&device->partition, &mbr->partitions[id], sizeof(partition_t));
+	device->first_sector = first_sector;
+	device->sector_count = sector_count;
 	device->device = dev;
 
 	fs_node_t * fnode = malloc(sizeof(fs_node_t));
@@ -89,7 +120,7 @@ static fs_node_t * dospart_device_create(int i, fs_node_t * dev, mbr_t * mbr, in
 	fnode->uid = 0;
 	fnode->gid = 0;
 	fnode->mask    = 0660;
-	fnode->length  = device->partition.sector_count * SECTORSIZE; /* TODO */
+	fnode->length  = sector_count * SECTORSIZE;
 	fnode->flags   = FS_BLOCKDEVICE;
 	fnode->read    = read_part;
 	fnode->write   = write_part;
@@ -98,6 +129,10 @@ static fs_node_t * dospart_device_create(int i, fs_node_t * dev, mbr_t * mbr, in
 	fnode->readdir = NULL;
 	fnode->finddir = NULL;
 	fnode->ioctl   = NULL; /* TODO, identify, etc? */
+	/* Async requests route straight onto the disk's queue with the
+	 * window offset folded in - no per-request work in this layer. */
+	fnode->passthrough_device = dev;
+	fnode->passthrough_base = first_sector * SECTORSIZE;
 	return fnode;
 }
 
@@ -111,16 +146,46 @@ static fs_node_t * dospart_map(const char * device, const char * mount_path) {
 		return NULL;
 	}
 
+	/* Partition data reads stay a passthrough - the filesystem mounted
+	 * on the partition node caches above us, and caching here as well
+	 * would just hold every block twice. The MBR itself can sit in the
+	 * shared block cache, though. */
 	mbr_t mbr;
-	read_fs(dev, 0, SECTORSIZE, (uint8_t *)&mbr);
+	blockcache_read(dev, 0, SECTORSIZE, (uint8_t *)&mbr);
 
 	if (mbr.signature[0] == 0x55 && mbr.signature[1] == 0xAA) {
-		for (int i = 0; i < 4; ++i) {
-			if (mbr.partitions[i].status & 0x80) {
-				fs_node_t * node = dospart_device_create(i, dev, &mbr, i);
-				char tmp[64];
-				snprintf(tmp, 20, "%s%d", device, i);
-				vfs_mount(tmp, node);
+		if (mbr.partitions[0].type == 0xEE) {
+			/* Protective MBR; the real table is GPT at LBA 1. */
+			gpt_header_t gpt;
+			blockcache_read(dev, SECTORSIZE, sizeof(gpt_header_t), (uint8_t *)&gpt);
+			if (!memcmp(gpt.signature, "EFI PART", 8) && gpt.entry_size >= sizeof(gpt_entry_t)) {
+				uint8_t * entry_buf = malloc(gpt.entry_size);
+				int mapped = 0;
+				for (uint32_t i = 0; i < gpt.entry_count && mapped < 16; ++i) {
+					blockcache_read(dev, gpt.entries_lba * SECTORSIZE + (uint64_t)i * gpt.entry_size,
+						gpt.entry_size, entry_buf);
+					gpt_entry_t * entry = (gpt_entry_t *)entry_buf;
+					int used = 0;
+					for (int b = 0; b < 16; ++b) if (entry->type_guid[b]) used = 1;
+					if (!used) continue;
+					fs_node_t * node = dospart_device_create(mapped, dev,
+						entry->first_lba, entry->last_lba - entry->first_lba + 1);
+					char tmp[64];
+					snprintf(tmp, 20, "%s%d", device, mapped);
+					vfs_mount(tmp, node);
+					mapped++;
+				}
+				free(entry_buf);
+			}
+		} else {
+			for (int i = 0; i < 4; ++i) {
+				if (mbr.partitions[i].status & 0x80) {
+					fs_node_t * node = dospart_device_create(i, dev,
+						mbr.partitions[i].lba_first_sector, mbr.partitions[i].sector_count);
+					char tmp[64];
+					snprintf(tmp, 20, "%s%d", device, i);
+					vfs_mount(tmp, node);
+				}
 			}
 		}
 	}
@@ -19,6 +19,7 @@
 #include <kernel/tokenize.h>
 #include <kernel/module.h>
 #include <kernel/mutex.h>
+#include <kernel/blockcache.h>
 
 #include <sys/ioctl.h>
 
@@ -203,13 +204,58 @@ typedef struct {
 	uint8_t                   bgd_offset;
 	unsigned int              inode_size;
 
-	uint8_t *                 cache_data;
+	uint8_t                 * block_bitmaps;       /* In-memory copy of every group's block bitmap */
+	uint8_t                 * inode_bitmaps;       /* In-memory copy of every group's inode bitmap */
+	unsigned int              last_alloc_group;    /* Group of the most recent block allocation */
+	unsigned int              last_alloc_offset;   /* Bit just past the most recent block allocation */
+
+	struct ext2_map_run     * map_cache;           /* Cached logical->physical block runs */
+	uint64_t                  map_counter;         /* LRU clock for the mapping cache */
+	spin_lock_t               map_lock;
+
+	struct ext2_inode_cache_ent * inode_cache;     /* Recently used inode table entries */
+	uint64_t                  inode_counter;       /* LRU clock for the inode cache */
+	spin_lock_t               inode_cache_lock;
 
 	int flags;
 
 	sched_mutex_t *           mutex;
 } ext2_fs_t;
 
+/**
+ * Cached run of contiguous logical->physical block mappings for one inode.
+ *
+ * Resolving a logical block normally means walking the (up to triple)
+ * indirect chains from the inode for every block. Sequential file data is
+ * usually physically contiguous, so successful resolutions are remembered
+ * as run-length-coalesced extents: streaming a large file does each
+ * indirect walk once and then hits a single cache entry per run.
+ */
+#define EXT2_MAP_CACHE_SIZE 64
+struct ext2_map_run {
+	uint32_t inode;    /* 0 = unused slot */
+	uint32_t lblock;
+	uint32_t pblock;
+	uint32_t count;
+	uint64_t last_use;
+};
+
+/**
+ * Cached copy of an inode table entry.
+ *
+ * Nearly every operation starts with refresh_inode(), which otherwise
+ * reads a whole inode table block to extract one entry. The cache keeps
+ * the decoded entries themselves so directory scans and stat-heavy
+ * workloads stop touching the table blocks. Entries are written through
+ * on write_inode(), so the copies never go stale.
+ */
+#define EXT2_INODE_CACHE_SIZE 128
+struct ext2_inode_cache_ent {
+	uint32_t inode;    /* 0 = unused slot */
+	uint64_t last_use;
+	ext2_inodetable_t * data;
+};
+
 #define EXT2_FLAG_READWRITE 0x0002
 #define EXT2_FLAG_LOUD      0x0004
 
@@ -245,7 +291,7 @@ static size_t allocate_block(ext2_fs_t * this);
  * so we need to special-case it.
  */
 static int rewrite_superblock(ext2_fs_t * this) {
-	write_fs(this->block_device, 1024, sizeof(ext2_superblock_t), (uint8_t *)SB);
+	blockcache_write(this->block_device, 1024, sizeof(ext2_superblock_t), (uint8_t *)SB);
 	return E_SUCCESS;
 }
 
@@ -264,8 +310,8 @@ static int read_block(ext2_fs_t * this, unsigned int block_no, uint8_t * buf) {
 		return E_BADBLOCK;
 	}
 
-	/* In such cases, we read directly from the block device */
-	read_fs(this->block_device, block_no * this->block_size, this->block_size, (uint8_t *)buf);
+	/* Reads go through the shared kernel block cache. */
+	blockcache_read(this->block_device, block_no * this->block_size, this->block_size, (uint8_t *)buf);
 
 	/* And return SUCCESS */
 	return E_SUCCESS;
@@ -286,12 +332,130 @@ static int write_block(ext2_fs_t * this, unsigned int block_no, uint8_t *buf) {
 	}
 
 	/* This operation requires the filesystem lock */
-	write_fs(this->block_device, block_no * this->block_size, this->block_size, buf);
+	blockcache_write(this->block_device, block_no * this->block_size, this->block_size, buf);
 
 	/* We're done. */
 	return E_SUCCESS;
 }
 
+/**
+ * Look up a logical block in the mapping cache.
+ *
+ * @returns The physical block number, or 0 on a miss.
+ */
+static unsigned int map_cache_lookup(ext2_fs_t * this, unsigned int inode_no, unsigned int iblock) {
+	unsigned int out = 0;
+	spin_lock(this->map_lock);
+	for (int i = 0; i < EXT2_MAP_CACHE_SIZE; ++i) {
+		struct ext2_map_run * run = &this->map_cache[i];
+		if (run->inode == inode_no && iblock >= run->lblock && iblock < run->lblock + run->count) {
+			out = run->pblock + (iblock - run->lblock);
+			run->last_use = this->map_counter++;
+			break;
+		}
+	}
+	spin_unlock(this->map_lock);
+	return out;
+}
+
+/**
+ * Remember a resolved mapping, extending an adjacent cached run when the
+ * physical block continues it, otherwise evicting the oldest slot.
+ */
+static void map_cache_insert(ext2_fs_t * this, unsigned int inode_no, unsigned int iblock, unsigned int rblock) {
+	if (!rblock) return;
+	spin_lock(this->map_lock);
+	int oldest = 0;
+	uint64_t lu = UINT64_MAX;
+	for (int i = 0; i < EXT2_MAP_CACHE_SIZE; ++i) {
+		struct ext2_map_run * run = &this->map_cache[i];
+		if (run->inode == inode_no && iblock == run->lblock + run->count && rblock == run->pblock + run->count) {
+			run->count++;
+			run->last_use = this->map_counter++;
+			spin_unlock(this->map_lock);
+			return;
+		}
+		if (run->inode == 0) {
+			oldest = i;
+			lu = 0;
+		} else if (run->last_use < lu) {
+			oldest = i;
+			lu = run->last_use;
+		}
+	}
+	this->map_cache[oldest].inode  = inode_no;
+	this->map_cache[oldest].lblock = iblock;
+	this->map_cache[oldest].pblock = rblock;
+	this->map_cache[oldest].count  = 1;
+	this->map_cache[oldest].last_use = this->map_counter++;
+	spin_unlock(this->map_lock);
+}
+
+/**
+ * Drop any cached run for @p inode_no that covers @p iblock; called when
+ * a mapping is (re)written.
+ */
+static void map_cache_invalidate(ext2_fs_t * this, unsigned int inode_no, unsigned int iblock) {
+	spin_lock(this->map_lock);
+	for (int i = 0; i < EXT2_MAP_CACHE_SIZE; ++i) {
+		struct ext2_map_run * run = &this->map_cache[i];
+		if (run->inode == inode_no && iblock >= run->lblock && iblock < run->lblock + run->count) {
+			run->inode = 0;
+			run->count = 0;
+		}
+	}
+	spin_unlock(this->map_lock);
+}
+
+/**
+ * Copy a cached inode table entry into @p inodet.
+ *
+ * @returns 1 on a hit, 0 on a miss.
+ */
+static int inode_cache_lookup(ext2_fs_t * this, ext2_inodetable_t * inodet, size_t inode) {
+	int hit = 0;
+	spin_lock(this->inode_cache_lock);
+	for (int i = 0; i < EXT2_INODE_CACHE_SIZE; ++i) {
+		struct ext2_inode_cache_ent * ent = &this->inode_cache[i];
+		if (ent->inode == inode) {
+			memcpy(inodet, ent->data, this->inode_size);
+			ent->last_use = this->inode_counter++;
+			hit = 1;
+			break;
+		}
+	}
+	spin_unlock(this->inode_cache_lock);
+	return hit;
+}
+
+/**
+ * Remember (or refresh) the cached copy of an inode table entry,
+ * evicting the least recently used slot if needed.
+ */
+static void inode_cache_store(ext2_fs_t * this, ext2_inodetable_t * inodet, size_t inode) {
+	spin_lock(this->inode_cache_lock);
+	int oldest = 0;
+	uint64_t lu = UINT64_MAX;
+	for (int i = 0; i < EXT2_INODE_CACHE_SIZE; ++i) {
+		struct ext2_inode_cache_ent * ent = &this->inode_cache[i];
+		if (ent->inode == inode) {
+			oldest = i;
+			break;
+		}
+		if (ent->inode == 0) {
+			oldest = i;
+			lu = 0;
+		} else if (ent->last_use < lu) {
+			oldest = i;
+			lu = ent->last_use;
+		}
+	}
+	memcpy(this->inode_cache[oldest].data, inodet, this->inode_size);
+	this->inode_cache[oldest].inode = inode;
+	this->inode_cache[oldest].last_use = this->inode_counter++;
+	spin_unlock(this->inode_cache_lock);
+}
+
 /**
  * ext2->set_block_number Set the "real" block number for a given "inode" block number.
  *
@@ -302,6 +466,8 @@ static int write_block(ext2_fs_t * this, unsigned int block_no, uint8_t *buf) {
  */
 static unsigned int set_block_number(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int inode_no, unsigned int iblock, unsigned int rblock) {
 
+	map_cache_invalidate(this, inode_no, iblock);
+
 	unsigned int p = this->pointers_per_block;
 
 	/* We're going to do some crazy math in a bit... */
@@ -413,13 +579,16 @@ no_space_free:
 }
 
 /**
- * ext2->get_block_number Given an inode block number, get the real block number.
+ * ext2->get_block_number_raw Given an inode block number, get the real block number.
+ *
+ * Walks the indirect chains from the inode; callers go through
+ * get_block_number(), which consults the mapping cache first.
  *
  * @param inode   Inode to operate on
  * @param iblock  Block offset within the inode
  * @returns Real block number
  */
-static unsigned int get_block_number(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int iblock) {
+static unsigned int get_block_number_raw(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int iblock) {
 
 	unsigned int p = this->pointers_per_block;
 
@@ -481,11 +650,32 @@ static unsigned int get_block_number(ext2_fs_t * this, ext2_inodetable_t * inode
 	return 0;
 }
 
+/**
+ * ext2->get_block_number Cached logical->physical block resolution.
+ *
+ * Direct blocks come straight from the inode; indirect blocks hit the
+ * per-filesystem run cache before falling back to the chain walk.
+ */
+static unsigned int get_block_number(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int inode_no, unsigned int iblock) {
+	if (iblock < EXT2_DIRECT_BLOCKS) {
+		return inode->block[iblock];
+	}
+	unsigned int out = map_cache_lookup(this, inode_no, iblock);
+	if (out) return out;
+	out = get_block_number_raw(this, inode, iblock);
+	map_cache_insert(this, inode_no, iblock, out);
+	return out;
+}
+
 static int write_inode(ext2_fs_t * this, ext2_inodetable_t *inode, size_t index) {
 	if (!index) {
 		dprintf("ext2: Attempt to write inode 0\n");
 		return E_BADBLOCK;
 	}
+
+	/* Write through the inode cache so later reads see this version. */
+	inode_cache_store(this, inode, index);
+
 	index--;
 
 	size_t group = index / this->inodes_per_group;
@@ -512,34 +702,43 @@ static size_t allocate_block(ext2_fs_t * this) {
 	size_t block_no     = 0;
 	size_t block_offset = 0;
 	size_t group        = 0;
-	uint8_t * bg_buffer = malloc(this->block_size);
 
 	mutex_acquire(this->mutex);
 
-	for (unsigned int i = 0; i < BGDS; ++i) {
-		if (BGD[i].free_blocks_count > 0) {
-			read_block(this, BGD[i].block_bitmap, (uint8_t *)bg_buffer);
-			while (BLOCKBIT(block_offset)) {
-				++block_offset;
+	/* Scan starting from the cursor left by the previous allocation, so
+	 * sequential writes get runs of adjacent blocks; if the cursor group
+	 * fills up we continue into the following groups and finally rescan
+	 * the cursor group from the top, hence the extra pass. */
+	for (unsigned int j = 0; j <= BGDS && !block_no; ++j) {
+		unsigned int i = (this->last_alloc_group + j) % BGDS;
+		if (BGD[i].free_blocks_count == 0) continue;
+		uint8_t * bg_buffer = this->block_bitmaps + i * this->block_size;
+		block_offset = (j == 0) ? this->last_alloc_offset : 0;
+		while (block_offset < SB->blocks_per_group) {
+			if (!BLOCKBIT(block_offset)) {
+				block_no = block_offset + SB->blocks_per_group * i;
+				group = i;
+				break;
 			}
-			block_no = block_offset + SB->blocks_per_group * i;
-			group = i;
-			break;
+			++block_offset;
 		}
 	}
 
 	if (!block_no) {
 		mutex_release(this->mutex);
 		debug_print(CRITICAL, "No available blocks, disk is out of space!");
-		free(bg_buffer);
 		return 0;
 	}
 
 	debug_print(WARNING, "allocating block #%zu (group %zu)", block_no, group);
 
+	uint8_t * bg_buffer = this->block_bitmaps + group * this->block_size;
 	BLOCKBYTE(block_offset) |= SETBIT(block_offset);
 	write_block(this, BGD[group].block_bitmap, (uint8_t *)bg_buffer);
 
+	this->last_alloc_group = group;
+	this->last_alloc_offset = block_offset + 1;
+
 	BGD[group].free_blocks_count--;
 	for (int i = 0; i < this->bgd_block_span; ++i) {
 		write_block(this, this->bgd_offset + i, (uint8_t *)((uintptr_t)BGD + this->block_size * i));
@@ -548,13 +747,13 @@ static size_t allocate_block(ext2_fs_t * this) {
 	SB->free_blocks_count--;
 	rewrite_superblock(this);
 
-	memset(bg_buffer, 0x00, this->block_size);
-	write_block(this, block_no, bg_buffer);
+	uint8_t * empty = malloc(this->block_size);
+	memset(empty, 0x00, this->block_size);
+	write_block(this, block_no, empty);
+	free(empty);
 
 	mutex_release(this->mutex);
 
-	free(bg_buffer);
-
 	return block_no;
 
 }
@@ -595,7 +794,7 @@ static int allocate_inode_block(ext2_fs_t * this, ext2_inodetable_t * inode, uns
  * @parma buf
  * @returns Real block number for reference.
  */
-static unsigned int inode_read_block(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int block, uint8_t * buf) {
+static unsigned int inode_read_block(ext2_fs_t * this, ext2_inodetable_t * inode, unsigned int inode_no, unsigned int block, uint8_t * buf) {
 
 	if (block >= inode->blocks / (this->block_size / 512)) {
 		memset(buf, 0x00, this->block_size);
@@ -603,7 +802,7 @@ static unsigned int inode_read_block(ext2_fs_t * this, ext2_inodetable_t * inode
 		return 0;
 	}
 
-	unsigned int real_block = get_block_number(this, inode, block);
+	unsigned int real_block = get_block_number(this, inode, inode_no, block);
 	read_block(this, real_block, buf);
 
 	return real_block;
@@ -628,7 +827,7 @@ static unsigned int inode_write_block(ext2_fs_t * this, ext2_inodetable_t * inod
 	if (empty) free(empty);
 	debug_print(WARNING, "... done");
 
-	unsigned int real_block = get_block_number(this, inode, block);
+	unsigned int real_block = get_block_number(this, inode, inode_no, block);
 	debug_print(WARNING, "Writing virtual block %d for inode %d maps to real block %d", block, inode_no, real_block);
 
 	write_block(this, real_block, buf);
@@ -675,12 +874,12 @@ static int create_entry(fs_node_t * parent, char * name, uint32_t inode) {
 	int modify_or_replace = 0;
 	ext2_dir_t *previous;
 
-	inode_read_block(this, pinode, block_nr, block);
+	inode_read_block(this, pinode, parent->inode, block_nr, block);
 	while (total_offset < pinode->size) {
 		if (dir_offset >= this->block_size) {
 			block_nr++;
 			dir_offset -= this->block_size;
-			inode_read_block(this, pinode, block_nr, block);
+			inode_read_block(this, pinode, parent->inode, block_nr, block);
 		}
 		ext2_dir_t *d_ent = (ext2_dir_t *)((uintptr_t)block + dir_offset);
 
@@ -767,14 +966,14 @@ static unsigned int allocate_inode(ext2_fs_t * this) {
 	uint32_t node_no     = 0;
 	uint32_t node_offset = 0;
 	uint32_t group       = 0;
-	uint8_t * bg_buffer  = malloc(this->block_size);
+	uint8_t * bg_buffer  = NULL;
 
 	mutex_acquire(this->mutex);
 
 	for (unsigned int i = 0; i < BGDS; ++i) {
 		if (BGD[i].free_inodes_count > 0) {
 			debug_print(NOTICE, "Group %d has %d free inodes.", i, BGD[i].free_inodes_count);
-			read_block(this, BGD[i].inode_bitmap, (uint8_t *)bg_buffer);
+			bg_buffer = this->inode_bitmaps + i * this->block_size;
 
 			/* Sorry for the weird loops */
 			while (1) {
@@ -810,10 +1009,10 @@ static unsigned int allocate_inode(ext2_fs_t * this) {
 		return 0;
 	}
 
+	bg_buffer = this->inode_bitmaps + group * this->block_size;
 	BLOCKBYTE(node_offset) |= SETBIT(node_offset);
 
 	write_block(this, BGD[group].inode_bitmap, (uint8_t *)bg_buffer);
-	free(bg_buffer);
 
 	BGD[group].free_inodes_count--;
 	for (int i = 0; i < this->bgd_block_span; ++i) {
@@ -1001,7 +1200,7 @@ static int chmod_ext2(fs_node_t * node, mode_t mode) {
 static ext2_dir_t * direntry_ext2(ext2_fs_t * this, ext2_inodetable_t * inode, uint32_t no, uint32_t index) {
 	uint8_t *block = malloc(this->block_size);
 	uint8_t block_nr = 0;
-	inode_read_block(this, inode, block_nr, block);
+	inode_read_block(this, inode, no, block_nr, block);
 	uint32_t dir_offset = 0;
 	uint32_t total_offset = 0;
 	uint32_t dir_index = 0;
@@ -1026,7 +1225,7 @@ static ext2_dir_t * direntry_ext2(ext2_fs_t * this, ext2_inodetable_t * inode, u
 		if (dir_offset >= this->block_size) {
 			block_nr++;
 			dir_offset -= this->block_size;
-			inode_read_block(this, inode, block_nr, block);
+			inode_read_block(this, inode, no, block_nr, block);
 		}
 	}
 
@@ -1046,7 +1245,7 @@ static fs_node_t * finddir_ext2(fs_node_t *node, char *name) {
 	uint8_t * block = malloc(this->block_size);
 	ext2_dir_t *direntry = NULL;
 	uint8_t block_nr = 0;
-	inode_read_block(this, inode, block_nr, block);
+	inode_read_block(this, inode, node->inode, block_nr, block);
 	uint32_t dir_offset = 0;
 	uint32_t total_offset = 0;
 
@@ -1054,7 +1253,7 @@ static fs_node_t * finddir_ext2(fs_node_t *node, char *name) {
 		if (dir_offset >= this->block_size) {
 			block_nr++;
 			dir_offset -= this->block_size;
-			inode_read_block(this, inode, block_nr, block);
+			inode_read_block(this, inode, node->inode, block_nr, block);
 		}
 		ext2_dir_t *d_ent = (ext2_dir_t *)((uintptr_t)block + dir_offset);
 
@@ -1109,7 +1308,7 @@ static int unlink_ext2(fs_node_t * node, char * name) {
 	uint8_t * block = malloc(this->block_size);
 	ext2_dir_t *direntry = NULL;
 	uint8_t block_nr = 0;
-	inode_read_block(this, inode, block_nr, block);
+	inode_read_block(this, inode, node->inode, block_nr, block);
 	uint32_t dir_offset = 0;
 	uint32_t total_offset = 0;
 
@@ -1117,7 +1316,7 @@ static int unlink_ext2(fs_node_t * node, char * name) {
 		if (dir_offset >= this->block_size) {
 			block_nr++;
 			dir_offset -= this->block_size;
-			inode_read_block(this, inode, block_nr, block);
+			inode_read_block(this, inode, node->inode, block_nr, block);
 		}
 		ext2_dir_t *d_ent = (ext2_dir_t *)((uintptr_t)block + dir_offset);
 
@@ -1176,6 +1375,10 @@ static void refresh_inode(ext2_fs_t * this, ext2_inodetable_t * inodet,  size_t
 		dprintf("ext2: Attempt to read inode 0\n");
 		return;
 	}
+
+	if (inode_cache_lookup(this, inodet, inode)) return;
+
+	size_t inode_no = inode;
 	inode--;
 
 	uint32_t group = inode / this->inodes_per_group;
@@ -1195,6 +1398,8 @@ static void refresh_inode(ext2_fs_t * this, ext2_inodetable_t * inodet,  size_t
 
 	memcpy(inodet, (uint8_t *)((uintptr_t)inodes + offset_in_block * this->inode_size), this->inode_size);
 
+	inode_cache_store(this, inodet, inode_no);
+
 	free(buf);
 }
 
@@ -1224,22 +1429,22 @@ static ssize_t read_ext2(fs_node_t *node, off_t offset, size_t size, uint8_t *bu
 
 	uint8_t * buf = malloc(this->block_size);
 	if (start_block == end_block) {
-		inode_read_block(this, inode, start_block, buf);
+		inode_read_block(this, inode, node->inode, start_block, buf);
 		memcpy(buffer, (uint8_t *)(((uintptr_t)buf) + ((uintptr_t)offset % this->block_size)), size_to_read);
 	} else {
 		uint32_t block_offset;
 		uint32_t blocks_read = 0;
 		for (block_offset = start_block; block_offset < end_block; block_offset++, blocks_read++) {
 			if (block_offset == start_block) {
-				inode_read_block(this, inode, block_offset, buf);
+				inode_read_block(this, inode, node->inode, block_offset, buf);
 				memcpy(buffer, (uint8_t *)(((uintptr_t)buf) + ((uintptr_t)offset % this->block_size)), this->block_size - (offset % this->block_size));
 			} else {
-				inode_read_block(this, inode, block_offset, buf);
+				inode_read_block(this, inode, node->inode, block_offset, buf);
 				memcpy(buffer + this->block_size * blocks_read - (offset % this->block_size), buf, this->block_size);
 			}
 		}
 		if (end_size) {
-			inode_read_block(this, inode, end_block, buf);
+			inode_read_block(this, inode, node->inode, end_block, buf);
 			memcpy(buffer + this->block_size * blocks_read - (offset % this->block_size), buf, end_size);
 		}
 	}
@@ -1261,7 +1466,7 @@ static ssize_t write_inode_buffer(ext2_fs_t * this, ext2_inodetable_t * inode, u
 	uint32_t size_to_read = end - offset;
 	uint8_t * buf = malloc(this->block_size);
 	if (start_block == end_block) {
-		inode_read_block(this, inode, start_block, buf);
+		inode_read_block(this, inode, inode_number, start_block, buf);
 		memcpy((uint8_t *)(((uintptr_t)buf) + ((uintptr_t)offset % this->block_size)), buffer, size_to_read);
 		inode_write_block(this, inode, inode_number, start_block, buf);
 	} else {
@@ -1269,14 +1474,14 @@ static ssize_t write_inode_buffer(ext2_fs_t * this, ext2_inodetable_t * inode, u
 		uint32_t blocks_read = 0;
 		for (block_offset = start_block; block_offset < end_block; block_offset++, blocks_read++) {
 			if (block_offset == start_block) {
-				int b = inode_read_block(this, inode, block_offset, buf);
+				int b = inode_read_block(this, inode, inode_number, block_offset, buf);
 				memcpy((uint8_t *)(((uintptr_t)buf) + ((uintptr_t)offset % this->block_size)), buffer, this->block_size - (offset % this->block_size));
 				inode_write_block(this, inode, inode_number, block_offset, buf);
 				if (!b) {
 					refresh_inode(this, inode, inode_number);
 				}
 			} else {
-				int b = inode_read_block(this, inode, block_offset, buf);
+				int b = inode_read_block(this, inode, inode_number, block_offset, buf);
 				memcpy(buf, buffer + this->block_size * blocks_read - (offset % this->block_size), this->block_size);
 				inode_write_block(this, inode, inode_number, block_offset, buf);
 				if (!b) {
@@ -1285,7 +1490,7 @@ static ssize_t write_inode_buffer(ext2_fs_t * this, ext2_inodetable_t * inode, u
 			}
 		}
 		if (end_size) {
-			inode_read_block(this, inode, end_block, buf);
+			inode_read_block(this, inode, inode_number, end_block, buf);
 			memcpy(buf, buffer + this->block_size * blocks_read - (offset % this->block_size), end_size);
 			inode_write_block(this, inode, inode_number, end_block, buf);
 		}
@@ -1643,6 +1848,24 @@ static fs_node_t * mount_ext2(fs_node_t * block_device, int flags) {
 		read_block(this, this->bgd_offset + i, (uint8_t *)((uintptr_t)BGD + this->block_size * i));
 	}
 
+	/* Pull every group's allocation bitmaps in once; the allocators work
+	 * against these copies and write through on change, rather than
+	 * re-reading a bitmap from the device for each allocation. */
+	this->block_bitmaps = malloc(this->block_size * BGDS);
+	this->inode_bitmaps = malloc(this->block_size * BGDS);
+	this->map_cache = malloc(sizeof(struct ext2_map_run) * EXT2_MAP_CACHE_SIZE);
+	memset(this->map_cache, 0x00, sizeof(struct ext2_map_run) * EXT2_MAP_CACHE_SIZE);
+	this->inode_cache = malloc(sizeof(struct ext2_inode_cache_ent) * EXT2_INODE_CACHE_SIZE);
+	memset(this->inode_cache, 0x00, sizeof(struct ext2_inode_cache_ent) * EXT2_INODE_CACHE_SIZE);
+	uint8_t * inode_slab = malloc(this->inode_size * EXT2_INODE_CACHE_SIZE);
+	for (int i = 0; i < EXT2_INODE_CACHE_SIZE; ++i) {
+		this->inode_cache[i].data = (ext2_inodetable_t *)(inode_slab + i * this->inode_size);
+	}
+	for (uint32_t i = 0; i < BGDS; ++i) {
+		read_block(this, BGD[i].block_bitmap, this->block_bitmaps + i * this->block_size);
+		read_block(this, BGD[i].inode_bitmap, this->inode_bitmaps + i * this->block_size);
+	}
+
 	dprintf("ext2: %u BGDs, %u inodes, %u inodes per group\n",
 		BGDS, SB->inodes_count, this->inodes_per_group);
 
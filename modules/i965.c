@@ -7,6 +7,10 @@
  * for the panel on one particular model of Lenovo ThinkPad and then sets
  * a handful of registers to get the framebuffer into the right resolution.
  *
+ * In the same bitbanged spirit, it also brings up the command ring and
+ * exposes the 2D engine's rectangle fill and screen-to-screen copy over
+ * new /dev/fb0 ioctls (IO_VID_BLIT_FILL / IO_VID_BLIT_COPY).
+ *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
  * of the NCSA / University of Illinois License - see LICENSE.md
@@ -30,10 +34,42 @@
 #define REG_DSPASTRIDE    0x70188
 #define REG_DSPASURF      0x7019c
 
+/* Render command streamer ring registers */
+#define REG_RING_TAIL     0x02030
+#define REG_RING_HEAD     0x02034
+#define REG_RING_START    0x02038
+#define REG_RING_CTL      0x0203C
+#define  RING_CTL_ENABLE  1
+#define  RING_HEAD_MASK   0x001FFFFC
+
+/* 2D commands, submitted through the render ring on this generation */
+#define MI_NOOP           0
+#define MI_FLUSH          (0x04 << 23)
+#define XY_COLOR_BLT      ((0x2 << 29) | (0x50 << 22) | 4)
+#define XY_SRC_COPY_BLT   ((0x2 << 29) | (0x53 << 22) | 6)
+#define  BLT_WRITE_ALPHA  (1 << 21)
+#define  BLT_WRITE_RGB    (1 << 20)
+#define  BR13_8888        (0x3 << 24)
+#define  ROP_PATCOPY      (0xF0 << 16)
+#define  ROP_SRCCOPY      (0xCC << 16)
+
+#define RING_DWORDS       (0x1000 / 4)
+
 extern uint32_t lfb_resolution_s;
+extern size_t lfb_memsize;
 extern fs_node_t * lfb_device;
 static uintptr_t ctrl_regs = 0;
 
+/* Blitter ring state; the ring lives in the top page of the aperture
+ * so it already has a graphics address without us touching the GTT. */
+static volatile uint32_t * ring = NULL;
+static uint32_t ring_gtt_offset = 0;
+static uint32_t ring_tail = 0;
+static int blt_alive = 0;
+
+/* The old /dev/fb0 ioctl handler, for everything we don't accelerate */
+static int (*lfb_ioctl)(fs_node_t *, unsigned long, void *) = NULL;
+
 static uint32_t i965_mmio_read(uint32_t reg) {
 	return *(volatile uint32_t*)(ctrl_regs + reg);
 }
@@ -75,6 +111,135 @@ static void i965_modeset(uint16_t x, uint16_t y) {
 
 }
 
+extern void ptr_validate(void * ptr, const char * syscall);
+#define validate(o) ptr_validate(o,"ioctl")
+
+static void ring_emit(uint32_t dword) {
+	ring[ring_tail] = dword;
+	ring_tail = (ring_tail + 1) % RING_DWORDS;
+}
+
+/**
+ * Make sure a whole command fits before the ring wraps; the
+ * streamer doesn't parse commands across the wrap point.
+ */
+static void ring_space(uint32_t dwords) {
+	if (ring_tail + dwords > RING_DWORDS) {
+		while (ring_tail) ring_emit(MI_NOOP);
+	}
+}
+
+/**
+ * Kick the streamer and wait for it to drain. We only ever submit
+ * tiny batches, so synchronous completion keeps the bookkeeping
+ * (and the userspace contract: the pixels are there on return)
+ * simple. A stuck engine permanently disables acceleration rather
+ * than hanging callers.
+ */
+static int ring_kick(void) {
+	i965_mmio_write(REG_RING_TAIL, ring_tail * 4);
+	for (uint64_t timeout = 0; timeout < 100000000UL; ++timeout) {
+		if ((i965_mmio_read(REG_RING_HEAD) & RING_HEAD_MASK) == ring_tail * 4) return 0;
+	}
+	blt_alive = 0;
+	return -EIO;
+}
+
+static int i965_blt_fill(struct vid_blit * blit) {
+	ring_space(8);
+	ring_emit(XY_COLOR_BLT | BLT_WRITE_ALPHA | BLT_WRITE_RGB);
+	ring_emit(BR13_8888 | ROP_PATCOPY | lfb_resolution_s);
+	ring_emit((blit->dst_y << 16) | blit->dst_x);
+	ring_emit(((blit->dst_y + blit->height) << 16) | (blit->dst_x + blit->width));
+	ring_emit(0); /* scanout surface is at graphics address 0 */
+	ring_emit(blit->color);
+	ring_emit(MI_FLUSH);
+	ring_emit(MI_NOOP);
+	return ring_kick();
+}
+
+static int i965_blt_copy(struct vid_blit * blit) {
+	ring_space(10);
+	ring_emit(XY_SRC_COPY_BLT | BLT_WRITE_ALPHA | BLT_WRITE_RGB);
+	ring_emit(BR13_8888 | ROP_SRCCOPY | lfb_resolution_s);
+	ring_emit((blit->dst_y << 16) | blit->dst_x);
+	ring_emit(((blit->dst_y + blit->height) << 16) | (blit->dst_x + blit->width));
+	ring_emit(0);
+	ring_emit((blit->src_y << 16) | blit->src_x);
+	ring_emit(lfb_resolution_s);
+	ring_emit(0);
+	ring_emit(MI_FLUSH);
+	ring_emit(MI_NOOP);
+	return ring_kick();
+}
+
+/**
+ * Reject rectangles that fall outside the visible framebuffer;
+ * the blitter would happily scribble over the rest of the aperture.
+ */
+static int blit_is_bounded(struct vid_blit * blit, int copy) {
+	if (!blit->width || !blit->height) return 0;
+	if (blit->width > 0x7FFF || blit->height > 0x7FFF) return 0;
+	if (blit->dst_x + blit->width > lfb_resolution_x) return 0;
+	if (blit->dst_y + blit->height > lfb_resolution_y) return 0;
+	if (copy) {
+		if (blit->src_x + blit->width > lfb_resolution_x) return 0;
+		if (blit->src_y + blit->height > lfb_resolution_y) return 0;
+	}
+	return 1;
+}
+
+static int ioctl_i965(fs_node_t * node, unsigned long request, void * argp) {
+	switch (request) {
+		case IO_VID_BLIT_FILL:
+			if (!blt_alive) return -EINVAL;
+			validate(argp);
+			if (!blit_is_bounded(argp, 0)) return -EINVAL;
+			return i965_blt_fill(argp);
+		case IO_VID_BLIT_COPY:
+			if (!blt_alive) return -EINVAL;
+			validate(argp);
+			if (!blit_is_bounded(argp, 1)) return -EINVAL;
+			return i965_blt_copy(argp);
+		default:
+			return lfb_ioctl(node, request, argp);
+	}
+}
+
+/**
+ * Bring up the command ring for 2D acceleration.
+ *
+ * The ring is carved out of the top page of the aperture, which the
+ * firmware GTT already maps linearly, so its graphics address is just
+ * its offset - same trick the framebuffer itself relies on.
+ */
+static void setup_engine(void) {
+	extern uint8_t * lfb_vid_memory;
+
+	if (lfb_memsize < 0x10000) return;
+	ring_gtt_offset = (lfb_memsize - 0x1000) & ~0xFFF;
+	ring = (volatile uint32_t *)(lfb_vid_memory + ring_gtt_offset);
+	ring_tail = 0;
+
+	i965_mmio_write(REG_RING_CTL, 0);
+	i965_mmio_write(REG_RING_START, ring_gtt_offset);
+	i965_mmio_write(REG_RING_HEAD, 0);
+	i965_mmio_write(REG_RING_TAIL, 0);
+	i965_mmio_write(REG_RING_CTL, ((0x1000 / 0x1000 - 1) << 12) | RING_CTL_ENABLE);
+
+	blt_alive = 1;
+
+	/* A fill of nothing much, to prove the engine executes at all */
+	struct vid_blit probe = { .dst_x = 0, .dst_y = 0, .width = 1, .height = 1, .color = 0xFF000000 };
+	if (i965_blt_fill(&probe)) {
+		dprintf("i965: blitter did not respond, acceleration disabled\n");
+		return;
+	}
+
+	lfb_ioctl = lfb_device->ioctl;
+	lfb_device->ioctl = ioctl_i965;
+}
+
 static void setup_framebuffer(uint32_t pcidev) {
 	/* Map BAR space for the control registers */
 	uint32_t ctrl_space = pci_read_field(pcidev, PCI_BAR0, 4);
@@ -87,6 +252,8 @@ static void setup_framebuffer(uint32_t pcidev) {
 
 	lfb_resolution_impl = i965_modeset;
 	lfb_set_resolution(1440,900);
+
+	setup_engine();
 }
 
 static void find_intel(uint32_t device, uint16_t v, uint16_t d, void * extra) {
@@ -14,7 +14,7 @@
 #include <kernel/args.h>
 #include <kernel/tokenize.h>
 #include <kernel/time.h>
-#include <kernel/list.h>
+#include <kernel/blockcache.h>
 #include <kernel/hashmap.h>
 
 #define ISO_SECTOR_SIZE 2048
@@ -29,10 +29,17 @@
 typedef struct {
 	fs_node_t * block_device;
 	uint32_t block_size;
-	hashmap_t * cache;
-	list_t * lru;
+	int use_cache;
+	hashmap_t * dir_index; /* "<sector>:<offset>:<name>" -> record location */
 } iso_9660_fs_t;
 
+/* Where a directory record lives on the disc; values of the mount-time
+ * name index. */
+struct iso_dir_loc {
+	uint32_t sector;
+	uint32_t offset;
+};
+
 typedef struct {
 	char year[4];
 	char month[2];
@@ -137,39 +144,17 @@ typedef struct {
 
 static void file_from_dir_entry(iso_9660_fs_t * this, size_t sector, iso_9660_directory_entry_t * dir, size_t offset, fs_node_t * fs);
 
-#define CACHE_SIZE 64
-
 static int read_sector(iso_9660_fs_t * this, uint32_t sector_id, char * buffer) {
-	if (this->cache) {
-		void * sector_id_v = (void *)(uintptr_t)sector_id;
-		if (hashmap_has(this->cache, sector_id_v)) {
-			memcpy(buffer,hashmap_get(this->cache, sector_id_v), this->block_size);
-			node_t * me = list_find(this->lru, sector_id_v);
-			list_delete(this->lru, me);
-			list_append(this->lru, me);
-			return 0;
-		} else {
-			if (this->lru->length > CACHE_SIZE) {
-				node_t * l = list_dequeue(this->lru);
-				free(hashmap_get(this->cache, l->value));
-				hashmap_remove(this->cache, l->value);
-				free(l);
-			}
-			int result = read_fs(this->block_device, sector_id * this->block_size, this->block_size, (uint8_t *)buffer);
-			if (result < 0) return result;
-			if (result == 0) return 1;
-			char * buf = malloc(this->block_size);
-			memcpy(buf, buffer, this->block_size);
-			hashmap_set(this->cache, sector_id_v, buf);
-			list_insert(this->lru, sector_id_v);
-			return 0;
-		}
+	int result;
+	if (this->use_cache) {
+		/* Sector caching is handled by the shared kernel block cache. */
+		result = blockcache_read(this->block_device, sector_id * this->block_size, this->block_size, (uint8_t *)buffer);
 	} else {
-		int result = read_fs(this->block_device, sector_id * this->block_size, this->block_size, (uint8_t *)buffer);
-		if (result < 0) return result;
-		if (result == 0) return 1;
-		return 0;
+		result = read_fs(this->block_device, sector_id * this->block_size, this->block_size, (uint8_t *)buffer);
 	}
+	if (result < 0) return result;
+	if (result == 0) return 1;
+	return 0;
 }
 
 static void inplace_lower(char * string) {
@@ -289,6 +274,23 @@ static ssize_t read_iso(fs_node_t * node, off_t offset, size_t size, uint8_t * b
 
 static fs_node_t * finddir_iso(fs_node_t *node, char *name) {
 	iso_9660_fs_t * this = node->device;
+
+	/* The mount-time index resolves most names directly. */
+	if (this->dir_index) {
+		char key[300];
+		snprintf(key, 300, "%zu:%zu:%s", (size_t)node->inode, (size_t)node->impl, name);
+		struct iso_dir_loc * loc = hashmap_get(this->dir_index, key);
+		if (loc) {
+			char * sec = malloc(this->block_size);
+			read_sector(this, loc->sector, sec);
+			fs_node_t * out = malloc(sizeof(fs_node_t));
+			memset(out, 0, sizeof(fs_node_t));
+			file_from_dir_entry(this, loc->sector, (iso_9660_directory_entry_t *)(sec + loc->offset), loc->offset, out);
+			free(sec);
+			return out;
+		}
+	}
+
 	char * buffer = malloc(this->block_size);
 	read_sector(this, node->inode, buffer);
 	iso_9660_directory_entry_t * root_entry = (iso_9660_directory_entry_t *)(buffer + node->impl);
@@ -398,6 +400,80 @@ static void file_from_dir_entry(iso_9660_fs_t * this, size_t sector, iso_9660_di
 	fs->close = close_iso;
 }
 
+/**
+ * Recursively index the directory record at @p rec_sector / @p rec_offset.
+ *
+ * Each visible child is recorded under "<sector>:<offset>:<name>" of its
+ * parent record, using the same name normalization finddir matches
+ * against, so lookups become a single hash probe instead of a scan of
+ * the directory extent. Directory extents are each read exactly once,
+ * at mount.
+ */
+static void index_directory(iso_9660_fs_t * this, uint32_t rec_sector, uint32_t rec_offset) {
+	char * buffer = malloc(this->block_size);
+	read_sector(this, rec_sector, buffer);
+	iso_9660_directory_entry_t * self = (iso_9660_directory_entry_t *)(buffer + rec_offset);
+
+	uint8_t * data = malloc(self->extent_length_LSB);
+	uint8_t * offset = data;
+	size_t extent_start = self->extent_start_LSB;
+	size_t extent_length = self->extent_length_LSB;
+	size_t sector_offset = 0;
+	size_t length_to_read = extent_length;
+	while (length_to_read) {
+		read_sector(this, extent_start + sector_offset, (char*)offset);
+		if (length_to_read >= this->block_size) {
+			offset += this->block_size;
+			sector_offset += 1;
+			length_to_read -= this->block_size;
+		} else {
+			break;
+		}
+	}
+
+	free(buffer);
+
+	offset = data;
+	fs_node_t * tmp = malloc(sizeof(fs_node_t));
+	while (1) {
+		iso_9660_directory_entry_t * dir = (iso_9660_directory_entry_t *)offset;
+		if (dir->length == 0) {
+			if ((size_t)(offset - data) < extent_length) {
+				offset += 1;
+				goto try_next_index;
+			}
+			break;
+		}
+		/* The first two records are the directory itself and its parent. */
+		if (!(dir->flags & FLAG_HIDDEN) && !(dir->name_len == 1 && (dir->name[0] == 0 || dir->name[0] == 1))) {
+			uint32_t child_sector = extent_start + (offset - data) / this->block_size;
+			uint32_t child_offset = (offset - data) % this->block_size;
+
+			memset(tmp, 0, sizeof(fs_node_t));
+			file_from_dir_entry(this, child_sector, dir, child_offset, tmp);
+
+			char key[300];
+			snprintf(key, 300, "%u:%u:%s", rec_sector, rec_offset, tmp->name);
+			if (!hashmap_has(this->dir_index, key)) {
+				struct iso_dir_loc * loc = malloc(sizeof(struct iso_dir_loc));
+				loc->sector = child_sector;
+				loc->offset = child_offset;
+				hashmap_set(this->dir_index, key, loc);
+
+				if (dir->flags & FLAG_DIRECTORY) {
+					index_directory(this, child_sector, child_offset);
+				}
+			}
+		}
+		offset += dir->length;
+try_next_index:
+		if ((size_t)(offset - data) >= extent_length) break;
+	}
+
+	free(tmp);
+	free(data);
+}
+
 static fs_node_t * iso_fs_mount(const char * device, const char * mount_path) {
 	char * arg = strdup(device);
 	char * argv[10];
@@ -424,14 +500,7 @@ static fs_node_t * iso_fs_mount(const char * device, const char * mount_path) {
 	iso_9660_fs_t * this = malloc(sizeof(iso_9660_fs_t));
 	this->block_device = dev;
 	this->block_size = ISO_SECTOR_SIZE;
-	if (cache) {
-		this->cache = hashmap_create_int(10);
-		this->lru = list_create("iso9660 lru cache", this);
-	} else {
-		this->cache = NULL;
-	}
-
-	/* Probably want to put a block cache on this like EXT2 driver does; or do that in the ATAPI layer... */
+	this->use_cache = cache;
 
 	/* Read the volume descriptors */
 	uint8_t * tmp = malloc(ISO_SECTOR_SIZE);
@@ -467,6 +536,11 @@ static fs_node_t * iso_fs_mount(const char * device, const char * mount_path) {
 	memset(fs, 0, sizeof(fs_node_t));
 	file_from_dir_entry(this, i, root_entry, 156, fs);
 
+	/* Index every directory up front; the disc is read-only, so the
+	 * index never needs invalidating. */
+	this->dir_index = hashmap_create(64);
+	index_directory(this, i, 156);
+
 	free(arg);
 	return fs;
 }
@@ -25,6 +25,8 @@
 #include <kernel/mouse.h>
 #include <kernel/args.h>
 #include <kernel/module.h>
+#include <kernel/misc.h>
+#include <kernel/time.h>
 
 #include <kernel/arch/x86_64/regs.h>
 #include <kernel/arch/x86_64/ports.h>
@@ -187,6 +189,7 @@ static void vbox_do_mouse(void) {
 	packet.x_difference = x;
 	packet.y_difference = y;
 	packet.buttons = 0;
+	packet.timestamp = arch_perf_timer() / arch_cpu_mhz();
 
 	mouse_device_packet_t bitbucket;
 	while (pipe_size(mouse_pipe) > (int)(DISCARD_POINT * sizeof(packet))) {
@@ -287,6 +290,444 @@ static void * kvmalloc_p(size_t size, uint32_t * outphys) {
 	return mmu_map_from_physical(index);
 }
 
+/*
+ * HGCM (Host-Guest Control Manager) client and Shared Folders {{{
+ *
+ * HGCM requests live in shared guest pages like the other VMMDev
+ * traffic: we fill in a request, hand its physical address to the
+ * request port, and the host completes it in place and sets the DONE
+ * flag. Bulk data moves by physical-address parameter, so file reads
+ * land directly in our pages instead of bouncing through a small
+ * per-call buffer.
+ */
+#define VMM_HGCMConnect    60
+#define VMM_HGCMCall64     63
+
+#define VBOX_HGCM_REQ_DONE (1 << 0)
+
+struct vbox_hgcm_header {
+	struct vbox_header header;
+	uint32_t flags;
+	int32_t result;
+};
+
+struct vbox_hgcm_connect {
+	struct vbox_hgcm_header hgcm;
+	uint32_t loctype; /* 2: existing service on the host */
+	char location[128];
+	uint32_t client_id;
+};
+
+#define HGCM_PARM_32BIT    1
+#define HGCM_PARM_64BIT    2
+#define HGCM_PARM_PHYSADDR 3
+
+struct vbox_hgcm_parm {
+	uint32_t type;
+	union {
+		uint64_t value;
+		struct {
+			uint32_t size;
+			uint64_t phys;
+		} __attribute__((packed)) ptr;
+	} u;
+} __attribute__((packed));
+
+struct vbox_hgcm_call {
+	struct vbox_hgcm_header hgcm;
+	uint32_t client_id;
+	uint32_t function;
+	uint32_t parm_count;
+	struct vbox_hgcm_parm parms[];
+};
+
+/* Shared Folders service functions */
+#define SHFL_FN_QUERY_MAPPINGS 1
+#define SHFL_FN_QUERY_MAP_NAME 2
+#define SHFL_FN_CREATE         3
+#define SHFL_FN_CLOSE          4
+#define SHFL_FN_READ           5
+#define SHFL_FN_WRITE          6
+#define SHFL_FN_LIST           8
+#define SHFL_FN_SET_UTF8       16
+#define SHFL_FN_MAP_FOLDER     17
+
+#define SHFL_CF_LOOKUP            0x00000001
+#define SHFL_CF_DIRECTORY         0x00000004
+#define SHFL_CF_ACT_FAIL_IF_NEW   0x00000100
+#define SHFL_CF_ACCESS_READ       0x00001000
+#define SHFL_CF_ACCESS_WRITE      0x00002000
+
+#define SHFL_HANDLE_NIL ((uint64_t)~0UL)
+
+struct shfl_string {
+	uint16_t size;   /* Buffer size including nul */
+	uint16_t length; /* String length without nul */
+	char data[];
+} __attribute__((packed));
+
+struct shfl_fsobjinfo {
+	uint64_t size;
+	uint64_t allocated;
+	uint64_t atime;
+	uint64_t mtime;
+	uint64_t ctime;
+	uint64_t btime;
+	uint32_t mode;       /* Unix bits in the low 12, type in 0xF000 */
+	uint32_t additional;
+	uint8_t  attr_union[36];
+} __attribute__((packed));
+
+struct shfl_createparms {
+	uint64_t handle;
+	uint32_t result;
+	uint32_t createflags;
+	struct shfl_fsobjinfo info;
+} __attribute__((packed));
+
+struct shfl_dirinfo {
+	struct shfl_fsobjinfo info;
+	uint16_t short_len;
+	uint16_t short_name[14];
+	struct shfl_string name;
+} __attribute__((packed));
+
+#define SHFL_BUF_SIZE 0x10000 /* 16-page data window for read/write/list */
+#define SHFL_MAX_PATH 1024
+
+static spin_lock_t hgcm_lock = {0};
+static struct vbox_hgcm_call * hgcm_req = NULL;
+static uint32_t hgcm_phys;
+static uint8_t * shfl_aux;       /* Strings and create parms */
+static uint32_t shfl_aux_phys;
+static uint8_t * shfl_buf;       /* Bulk data window */
+static uint32_t shfl_buf_phys;
+static uint32_t shfl_client;
+
+/* Per-node state; node->device points here. */
+struct shfl_obj {
+	uint32_t root;
+	uint64_t handle;
+	char path[SHFL_MAX_PATH];
+};
+
+static int hgcm_finish(struct vbox_hgcm_header * h) {
+	uint64_t timeout = 100000000UL;
+	while (!(h->flags & VBOX_HGCM_REQ_DONE) && --timeout);
+	if (!timeout) return -5; /* The host went away; treat as I/O error */
+	if (h->header.rc < 0) return h->header.rc;
+	return h->result;
+}
+
+static void hgcm_parm_32(int i, uint32_t value) {
+	hgcm_req->parms[i].type = HGCM_PARM_32BIT;
+	hgcm_req->parms[i].u.value = value;
+}
+
+static void hgcm_parm_64(int i, uint64_t value) {
+	hgcm_req->parms[i].type = HGCM_PARM_64BIT;
+	hgcm_req->parms[i].u.value = value;
+}
+
+static void hgcm_parm_ptr(int i, uint32_t phys, uint32_t size) {
+	hgcm_req->parms[i].type = HGCM_PARM_PHYSADDR;
+	hgcm_req->parms[i].u.ptr.size = size;
+	hgcm_req->parms[i].u.ptr.phys = phys;
+}
+
+/* Caller holds hgcm_lock and has filled in the parameters. */
+static int hgcm_call(uint32_t function, uint32_t parm_count) {
+	struct vbox_hgcm_call * c = hgcm_req;
+	c->hgcm.header.size = sizeof(struct vbox_hgcm_call) + parm_count * sizeof(struct vbox_hgcm_parm);
+	c->hgcm.header.version = VBOX_REQUEST_HEADER_VERSION;
+	c->hgcm.header.requestType = VMM_HGCMCall64;
+	c->hgcm.header.rc = 0;
+	c->hgcm.header.reserved1 = 0;
+	c->hgcm.header.reserved2 = 0;
+	c->hgcm.flags = 0;
+	c->hgcm.result = 0;
+	c->client_id = shfl_client;
+	c->function = function;
+	c->parm_count = parm_count;
+	outportl(vbox_port, hgcm_phys);
+	return hgcm_finish(&c->hgcm);
+}
+
+static int hgcm_connect(const char * service, uint32_t * client_out) {
+	struct vbox_hgcm_connect * c = (void*)hgcm_req;
+	memset(c, 0, sizeof(struct vbox_hgcm_connect));
+	c->hgcm.header.size = sizeof(struct vbox_hgcm_connect);
+	c->hgcm.header.version = VBOX_REQUEST_HEADER_VERSION;
+	c->hgcm.header.requestType = VMM_HGCMConnect;
+	c->loctype = 2;
+	snprintf(c->location, 128, "%s", service);
+	outportl(vbox_port, hgcm_phys);
+	int rc = hgcm_finish(&c->hgcm);
+	if (rc < 0) return rc;
+	*client_out = c->client_id;
+	return 0;
+}
+
+/* Write a path into the aux page as a SHFLSTRING; returns its physical address. */
+static uint32_t shfl_put_string(size_t offset, const char * str, uint32_t * size_out) {
+	struct shfl_string * out = (struct shfl_string *)(shfl_aux + offset);
+	size_t len = strlen(str);
+	out->size = len + 1;
+	out->length = len;
+	memcpy(out->data, str, len + 1);
+	*size_out = sizeof(struct shfl_string) + len + 1;
+	return shfl_aux_phys + offset;
+}
+
+#define SHFL_AUX_CREATEPARMS 0x800
+
+/* CREATE does double duty: with SHFL_CF_LOOKUP it is a stat. */
+static int shfl_create(uint32_t root, const char * path, uint32_t flags, struct shfl_createparms * out) {
+	spin_lock(hgcm_lock);
+	uint32_t str_size;
+	uint32_t str_phys = shfl_put_string(0, path[0] ? path : "/", &str_size);
+	struct shfl_createparms * parms = (struct shfl_createparms *)(shfl_aux + SHFL_AUX_CREATEPARMS);
+	memset(parms, 0, sizeof(struct shfl_createparms));
+	parms->handle = SHFL_HANDLE_NIL;
+	parms->createflags = flags;
+	hgcm_parm_32(0, root);
+	hgcm_parm_ptr(1, str_phys, str_size);
+	hgcm_parm_ptr(2, shfl_aux_phys + SHFL_AUX_CREATEPARMS, sizeof(struct shfl_createparms));
+	int rc = hgcm_call(SHFL_FN_CREATE, 3);
+	if (rc >= 0) memcpy(out, parms, sizeof(struct shfl_createparms));
+	spin_unlock(hgcm_lock);
+	return rc;
+}
+
+static int shfl_close(uint32_t root, uint64_t handle) {
+	spin_lock(hgcm_lock);
+	hgcm_parm_32(0, root);
+	hgcm_parm_64(1, handle);
+	int rc = hgcm_call(SHFL_FN_CLOSE, 2);
+	spin_unlock(hgcm_lock);
+	return rc;
+}
+
+static void open_shfl(fs_node_t * node, unsigned int flags) {
+	struct shfl_obj * obj = node->device;
+	struct shfl_createparms parms;
+	if (shfl_create(obj->root, obj->path,
+			SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ | SHFL_CF_ACCESS_WRITE, &parms) < 0 ||
+			parms.handle == SHFL_HANDLE_NIL) {
+		/* Read-only share, probably; fall back */
+		if (shfl_create(obj->root, obj->path,
+				SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ, &parms) < 0) return;
+	}
+	obj->handle = parms.handle;
+	node->length = parms.info.size;
+}
+
+static void close_shfl(fs_node_t * node) {
+	struct shfl_obj * obj = node->device;
+	if (obj->handle != SHFL_HANDLE_NIL) {
+		shfl_close(obj->root, obj->handle);
+		obj->handle = SHFL_HANDLE_NIL;
+	}
+}
+
+static ssize_t read_shfl(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	struct shfl_obj * obj = node->device;
+	if (obj->handle == SHFL_HANDLE_NIL) return -EBADF;
+	size_t total = 0;
+	while (total < size) {
+		uint32_t chunk = (size - total) > SHFL_BUF_SIZE ? SHFL_BUF_SIZE : (size - total);
+		spin_lock(hgcm_lock);
+		hgcm_parm_32(0, obj->root);
+		hgcm_parm_64(1, obj->handle);
+		hgcm_parm_64(2, offset + total);
+		hgcm_parm_32(3, chunk);
+		hgcm_parm_ptr(4, shfl_buf_phys, chunk);
+		int rc = hgcm_call(SHFL_FN_READ, 5);
+		uint32_t got = hgcm_req->parms[3].u.value;
+		if (rc >= 0 && got) memcpy(buffer + total, shfl_buf, got);
+		spin_unlock(hgcm_lock);
+		if (rc < 0) return total ? (ssize_t)total : -EIO;
+		if (!got) break;
+		total += got;
+	}
+	return total;
+}
+
+static ssize_t write_shfl(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
+	struct shfl_obj * obj = node->device;
+	if (obj->handle == SHFL_HANDLE_NIL) return -EBADF;
+	size_t total = 0;
+	while (total < size) {
+		uint32_t chunk = (size - total) > SHFL_BUF_SIZE ? SHFL_BUF_SIZE : (size - total);
+		spin_lock(hgcm_lock);
+		memcpy(shfl_buf, buffer + total, chunk);
+		hgcm_parm_32(0, obj->root);
+		hgcm_parm_64(1, obj->handle);
+		hgcm_parm_64(2, offset + total);
+		hgcm_parm_32(3, chunk);
+		hgcm_parm_ptr(4, shfl_buf_phys, chunk);
+		int rc = hgcm_call(SHFL_FN_WRITE, 5);
+		uint32_t put = hgcm_req->parms[3].u.value;
+		spin_unlock(hgcm_lock);
+		if (rc < 0) return total ? (ssize_t)total : -EIO;
+		if (!put) break;
+		total += put;
+	}
+	if ((size_t)offset + total > node->length) node->length = offset + total;
+	return total;
+}
+
+static struct dirent * readdir_shfl(fs_node_t * node, unsigned long index);
+static fs_node_t * finddir_shfl(fs_node_t * node, char * name);
+
+static fs_node_t * shfl_node_from_info(uint32_t root, const char * path, const char * name, struct shfl_fsobjinfo * info) {
+	fs_node_t * fnode = calloc(sizeof(fs_node_t), 1);
+	struct shfl_obj * obj = calloc(sizeof(struct shfl_obj), 1);
+	obj->root = root;
+	obj->handle = SHFL_HANDLE_NIL;
+	snprintf(obj->path, SHFL_MAX_PATH, "%s", path);
+	snprintf(fnode->name, 100, "%s", name);
+	fnode->device = obj;
+	fnode->mask = info->mode & 07777;
+	fnode->length = info->size;
+	fnode->open = open_shfl;
+	fnode->close = close_shfl;
+	if ((info->mode & 0xF000) == 0x4000) {
+		fnode->flags = FS_DIRECTORY;
+		fnode->readdir = readdir_shfl;
+		fnode->finddir = finddir_shfl;
+	} else {
+		fnode->flags = FS_FILE;
+		fnode->read = read_shfl;
+		fnode->write = write_shfl;
+	}
+	return fnode;
+}
+
+/**
+ * List a directory into the shared window and walk to the requested
+ * entry. The host fills SHFLDIRINFO records back to back; each is
+ * advanced past by the embedded string size. Relisting per index is
+ * wasteful but matches how little state the VFS hands us.
+ */
+static struct dirent * readdir_shfl(fs_node_t * node, unsigned long index) {
+	struct shfl_obj * obj = node->device;
+	struct shfl_createparms parms;
+	if (shfl_create(obj->root, obj->path,
+			SHFL_CF_DIRECTORY | SHFL_CF_ACT_FAIL_IF_NEW | SHFL_CF_ACCESS_READ, &parms) < 0 ||
+			parms.handle == SHFL_HANDLE_NIL) return NULL;
+
+	char pattern[SHFL_MAX_PATH];
+	snprintf(pattern, SHFL_MAX_PATH, "%s/*", obj->path);
+
+	spin_lock(hgcm_lock);
+	uint32_t str_size;
+	uint32_t str_phys = shfl_put_string(0, pattern, &str_size);
+	hgcm_parm_32(0, obj->root);
+	hgcm_parm_64(1, parms.handle);
+	hgcm_parm_32(2, 0); /* flags: list everything */
+	hgcm_parm_32(3, SHFL_BUF_SIZE);
+	hgcm_parm_ptr(4, str_phys, str_size);
+	hgcm_parm_ptr(5, shfl_buf_phys, SHFL_BUF_SIZE);
+	hgcm_parm_32(6, 0); /* resume point */
+	hgcm_parm_32(7, 0); /* file count, out */
+	int rc = hgcm_call(SHFL_FN_LIST, 8);
+	uint32_t count = hgcm_req->parms[7].u.value;
+
+	struct dirent * out = NULL;
+	if (rc >= 0 && index < count) {
+		uint8_t * p = shfl_buf;
+		for (unsigned long i = 0; i < index; ++i) {
+			struct shfl_dirinfo * e = (struct shfl_dirinfo *)p;
+			p += __builtin_offsetof(struct shfl_dirinfo, name.data) + e->name.size;
+		}
+		struct shfl_dirinfo * e = (struct shfl_dirinfo *)p;
+		out = malloc(sizeof(struct dirent));
+		memset(out, 0, sizeof(struct dirent));
+		size_t len = e->name.length < 255 ? e->name.length : 255;
+		memcpy(out->d_name, e->name.data, len);
+		out->d_name[len] = '\0';
+		out->d_ino = index;
+	}
+	spin_unlock(hgcm_lock);
+	shfl_close(obj->root, parms.handle);
+	return out;
+}
+
+static fs_node_t * finddir_shfl(fs_node_t * node, char * name) {
+	struct shfl_obj * obj = node->device;
+	char path[SHFL_MAX_PATH];
+	snprintf(path, SHFL_MAX_PATH, "%s/%s", obj->path, name);
+	struct shfl_createparms parms;
+	if (shfl_create(obj->root, path, SHFL_CF_LOOKUP, &parms) < 0) return NULL;
+	if (parms.result != 1) return NULL; /* SHFL_FILE_EXISTS */
+	return shfl_node_from_info(obj->root, path, name, &parms.info);
+}
+
+/**
+ * Connect to the shared folders service, map every folder the host
+ * offers, and mount each one under /shared/<name>.
+ */
+static void vbox_shfl_install(void) {
+	hgcm_req = (void*)kvmalloc_p(0x1000, &hgcm_phys);
+	shfl_aux = (void*)kvmalloc_p(0x1000, &shfl_aux_phys);
+	shfl_buf = (void*)kvmalloc_p(SHFL_BUF_SIZE, &shfl_buf_phys);
+
+	if (hgcm_connect("VBoxSharedFolders", &shfl_client) < 0) {
+		printf("vbox: no shared folders service\n");
+		return;
+	}
+
+	spin_lock(hgcm_lock);
+	hgcm_call(SHFL_FN_SET_UTF8, 0);
+
+	/* Available folders: (status, root) pairs into the aux page */
+	uint32_t * mappings = (uint32_t *)(shfl_aux + SHFL_AUX_CREATEPARMS);
+	hgcm_parm_32(0, 0);
+	hgcm_parm_32(1, 16);
+	hgcm_parm_ptr(2, shfl_aux_phys + SHFL_AUX_CREATEPARMS, 16 * 8);
+	int rc = hgcm_call(SHFL_FN_QUERY_MAPPINGS, 3);
+	uint32_t count = hgcm_req->parms[1].u.value;
+	spin_unlock(hgcm_lock);
+	if (rc < 0) return;
+
+	for (uint32_t i = 0; i < count && i < 16; ++i) {
+		spin_lock(hgcm_lock);
+		/* Folder name for this mapping... */
+		struct shfl_string * str = (struct shfl_string *)shfl_aux;
+		str->size = 256;
+		str->length = 0;
+		hgcm_parm_32(0, mappings[i * 2 + 1]);
+		hgcm_parm_ptr(1, shfl_aux_phys, sizeof(struct shfl_string) + 256);
+		rc = hgcm_call(SHFL_FN_QUERY_MAP_NAME, 2);
+		char name[100];
+		snprintf(name, 100, "%s", str->data);
+		spin_unlock(hgcm_lock);
+		if (rc < 0) continue;
+
+		/* ... then map it to get a root handle for file operations. */
+		spin_lock(hgcm_lock);
+		uint32_t str_size;
+		uint32_t str_phys = shfl_put_string(0, name, &str_size);
+		hgcm_parm_ptr(0, str_phys, str_size);
+		hgcm_parm_32(1, 0);   /* root, out */
+		hgcm_parm_32(2, '/'); /* path delimiter */
+		hgcm_parm_32(3, 1);   /* case sensitive */
+		rc = hgcm_call(SHFL_FN_MAP_FOLDER, 4);
+		uint32_t root = hgcm_req->parms[1].u.value;
+		spin_unlock(hgcm_lock);
+		if (rc < 0) continue;
+
+		struct shfl_fsobjinfo info = { .mode = 0x4000 | 0755 };
+		fs_node_t * fnode = shfl_node_from_info(root, "", name, &info);
+		char mountpoint[120];
+		snprintf(mountpoint, 120, "/shared/%s", name);
+		vfs_mount(mountpoint, fnode);
+		printf("vbox: mounted shared folder '%s' at %s\n", name, mountpoint);
+	}
+}
+/* }}} */
+
 static int vbox_install(int argc, char * argv[]) {
 	if (args_present("novbox")) return -ENODEV;
 	pci_scan(vbox_scan_pci, -1, &vbox_device);
@@ -468,6 +909,11 @@ static int vbox_install(int argc, char * argv[]) {
 
 	vbox_vmmdev[3] = 0xFFFFFFFF; /* Enable all for now */
 
+	/* Shared folders, if the host offers any */
+	if (!args_present("novboxshares")) {
+		vbox_shfl_install();
+	}
+
 	return 0;
 }
 
@@ -31,6 +31,7 @@
 #include <kernel/process.h>
 #include <kernel/mouse.h>
 #include <kernel/time.h>
+#include <kernel/misc.h>
 #include <kernel/args.h>
 #include <kernel/module.h>
 #include <kernel/arch/x86_64/ports.h>
@@ -206,6 +207,7 @@ static void vmware_mouse(uint8_t byte) {
 	packet.x_difference = x;
 	packet.y_difference = y;
 	packet.buttons = 0;
+	packet.timestamp = arch_perf_timer() / arch_cpu_mhz();
 
 	/* The particular bits for the buttons seem weird, but okay... */
 	if (buttons & 0x20) {
@@ -2,7 +2,8 @@
  * @brief xHCI Host Controller Driver
  * @file modules/xhci.c
  *
- * @warning This is a stub driver.
+ * @warning This is a stub driver: it brings the controller up and
+ *          provides ring management, but does not enumerate devices.
  *
  * @copyright
  * This file is part of ToaruOS and is released under the terms
@@ -18,6 +19,11 @@
 #include <kernel/args.h>
 #include <kernel/procfs.h>
 #include <kernel/syscall.h>
+#include <kernel/process.h>
+#include <kernel/list.h>
+#include <kernel/spinlock.h>
+
+#include <kernel/arch/x86_64/irq.h>
 
 struct xhci_cap_regs {
 	volatile uint32_t cap_caplen_version;
@@ -43,14 +49,194 @@ struct xhci_op_regs {
 	volatile uint32_t op_config;
 } __attribute__((packed));
 
+/* Interrupter register set; an array of these lives at RTSOFF + 0x20. */
+struct xhci_ir_regs {
+	volatile uint32_t ir_iman;
+	volatile uint32_t ir_imod;
+	volatile uint32_t ir_erstsz;
+	volatile uint32_t ir__pad;
+	volatile uint32_t ir_erstba_lo;
+	volatile uint32_t ir_erstba_hi;
+	volatile uint32_t ir_erdp_lo;
+	volatile uint32_t ir_erdp_hi;
+} __attribute__((packed));
+
+/* Transfer Request Block; all four rings are arrays of these. */
+struct xhci_trb {
+	volatile uint32_t param_lo;
+	volatile uint32_t param_hi;
+	volatile uint32_t status;
+	volatile uint32_t control;
+} __attribute__((packed));
+
+#define XHCI_TRB_CYCLE    (1 << 0)
+#define XHCI_TRB_TC       (1 << 1)  /* Toggle Cycle, link TRBs only */
+#define XHCI_TRB_IOC      (1 << 5)  /* Interrupt On Completion */
+#define XHCI_TRB_TYPE(t)  ((t) << 10)
+#define XHCI_TRB_TYPE_OF(control) (((control) >> 10) & 0x3F)
+
+/* TRB types we queue or receive */
+#define TRB_NORMAL        1   /* Bulk/interrupt data stage */
+#define TRB_LINK          6
+#define TRB_ENABLE_SLOT   9
+#define TRB_NOOP_CMD      23
+#define TRB_EV_TRANSFER   32
+#define TRB_EV_CMD_DONE   33
+#define TRB_EV_PORT_CHANGE 34
+
+/* One page of TRBs per ring. */
+#define XHCI_RING_TRBS    (0x1000 / sizeof(struct xhci_trb))
+
+/**
+ * A producer or consumer TRB ring. Producer rings (command, transfer)
+ * end in a link TRB back to the start with the toggle-cycle bit, so
+ * the hardware chases our cycle state around the ring; the event ring
+ * is plain and the consumer cycle flips at the wrap instead.
+ */
+struct xhci_ring {
+	struct xhci_trb * trbs;
+	uintptr_t phys;
+	size_t enqueue;
+	size_t dequeue;
+	uint8_t cycle;
+};
+
 struct XHCIControllerData {
 	uintptr_t mmio;
 	uint32_t device;
 	struct xhci_cap_regs * cregs;
 	struct xhci_op_regs * oregs;
+	struct xhci_ir_regs * ir;       /* Interrupter 0 */
+	volatile uint32_t * doorbells;
+	uint64_t * dcbaa;
+
+	struct xhci_ring cmd_ring;
+	struct xhci_ring event_ring;
+
+	size_t irq;
+	list_t * cmd_waiters;
+	spin_lock_t cmd_lock;
+	int cmd_pending;
+	uint32_t cmd_result;            /* Completion code from the last command event */
+	uint32_t port_changes;          /* Port status change events seen */
+	uint32_t transfer_events;       /* Transfer events seen */
 };
 
 static int _counter = 0;
+static struct XHCIControllerData * _controllers[4];
+
+/**
+ * Allocate a one-page ring. Producer rings get a terminating link TRB
+ * pointing back at the start, so enqueues just walk the array and the
+ * cycle bit flips each lap.
+ */
+static void xhci_ring_alloc(struct xhci_ring * ring, int producer) {
+	ring->phys = mmu_allocate_n_frames(1) << 12;
+	ring->trbs = mmu_map_from_physical(ring->phys);
+	memset((void*)ring->trbs, 0, 0x1000);
+	ring->enqueue = 0;
+	ring->dequeue = 0;
+	ring->cycle = 1;
+	if (producer) {
+		struct xhci_trb * link = &ring->trbs[XHCI_RING_TRBS - 1];
+		link->param_lo = ring->phys & 0xFFFFFFFF;
+		link->param_hi = ring->phys >> 32;
+		link->control  = XHCI_TRB_TYPE(TRB_LINK) | XHCI_TRB_TC;
+	}
+}
+
+/**
+ * Queue one TRB on a producer ring. Several can be queued back to back
+ * before the doorbell rings - the hardware consumes everything whose
+ * cycle bit matches, which is what makes chained bulk transfers one
+ * doorbell instead of one setup per TRB.
+ */
+static void xhci_ring_queue(struct xhci_ring * ring, uint32_t param_lo, uint32_t param_hi, uint32_t status, uint32_t control) {
+	struct xhci_trb * trb = &ring->trbs[ring->enqueue];
+	trb->param_lo = param_lo;
+	trb->param_hi = param_hi;
+	trb->status   = status;
+	/* The cycle bit is written last so the controller never sees a
+	 * half-written TRB as valid. */
+	trb->control  = (control & ~XHCI_TRB_CYCLE) | (ring->cycle ? XHCI_TRB_CYCLE : 0);
+	ring->enqueue++;
+	if (ring->enqueue == XHCI_RING_TRBS - 1) {
+		/* Hand the link TRB over to the hardware and wrap. */
+		struct xhci_trb * link = &ring->trbs[ring->enqueue];
+		link->control = (link->control & ~XHCI_TRB_CYCLE) | (ring->cycle ? XHCI_TRB_CYCLE : 0);
+		ring->enqueue = 0;
+		ring->cycle ^= 1;
+	}
+}
+
+/**
+ * Drain the event ring. Runs from the interrupt handler; consumes
+ * every event whose cycle bit matches ours, then writes the new
+ * dequeue pointer back with the event-handler-busy bit cleared.
+ */
+static void xhci_handle_events(struct XHCIControllerData * c) {
+	while (1) {
+		struct xhci_trb * e = &c->event_ring.trbs[c->event_ring.dequeue];
+		if (!!(e->control & XHCI_TRB_CYCLE) != c->event_ring.cycle) break;
+		switch (XHCI_TRB_TYPE_OF(e->control)) {
+			case TRB_EV_CMD_DONE:
+				c->cmd_result = e->status >> 24;
+				c->cmd_pending = 0;
+				wakeup_queue(c->cmd_waiters);
+				break;
+			case TRB_EV_PORT_CHANGE:
+				c->port_changes++;
+				break;
+			case TRB_EV_TRANSFER:
+				/* No endpoints are configured yet; count them so the
+				 * procfs node shows life once enumeration exists. */
+				c->transfer_events++;
+				break;
+			default:
+				break;
+		}
+		c->event_ring.dequeue++;
+		if (c->event_ring.dequeue == XHCI_RING_TRBS) {
+			c->event_ring.dequeue = 0;
+			c->event_ring.cycle ^= 1;
+		}
+	}
+	uint64_t erdp = c->event_ring.phys + c->event_ring.dequeue * sizeof(struct xhci_trb);
+	c->ir->ir_erdp_lo = (erdp & 0xFFFFFFFF) | (1 << 3); /* EHB */
+	c->ir->ir_erdp_hi = erdp >> 32;
+}
+
+static int xhci_irq_handler(struct regs * r) {
+	int handled = 0;
+	for (int i = 0; i < _counter; ++i) {
+		struct XHCIControllerData * c = _controllers[i];
+		if (!c) continue;
+		uint32_t sts = c->oregs->op_usbsts;
+		if (!(sts & (1 << 3))) continue; /* EINT */
+		c->oregs->op_usbsts = (1 << 3);
+		c->ir->ir_iman |= 1; /* clear IP */
+		spin_lock(c->cmd_lock);
+		xhci_handle_events(c);
+		spin_unlock(c->cmd_lock);
+		irq_ack(c->irq);
+		handled = 1;
+	}
+	return handled;
+}
+
+/**
+ * Queue a command TRB, ring the command doorbell, and sleep until the
+ * interrupt handler sees the completion event. Returns the completion
+ * code (1 = success).
+ */
+static int xhci_command(struct XHCIControllerData * c, uint32_t param_lo, uint32_t param_hi, uint32_t status, uint32_t control) {
+	spin_lock(c->cmd_lock);
+	xhci_ring_queue(&c->cmd_ring, param_lo, param_hi, status, control);
+	c->cmd_pending = 1;
+	c->doorbells[0] = 0;
+	sleep_on_unlocking(c->cmd_waiters, &c->cmd_lock);
+	return c->cmd_result;
+}
 
 static ssize_t xhci_procfs_callback(fs_node_t * node, off_t offset, size_t size, uint8_t * buffer) {
 	struct XHCIControllerData * controller = node->device;
@@ -67,6 +253,9 @@ static ssize_t xhci_procfs_callback(fs_node_t * node, off_t offset, size_t size,
 		"DBOFF      0x%08x\n"
 		"RTSOFF     0x%08x\n"
 		"HCCPARAMS2 0x%08x\n"
+		"cmd ring   enq %zu cycle %d\n"
+		"event ring deq %zu cycle %d\n"
+		"port changes %u, transfer events %u\n"
 		,
 		controller->device,
 		(uintptr_t)controller->mmio,
@@ -77,7 +266,10 @@ static ssize_t xhci_procfs_callback(fs_node_t * node, off_t offset, size_t size,
 		controller->cregs->cap_hccparams1,
 		controller->cregs->cap_dboff,
 		controller->cregs->cap_rtsoff,
-		controller->cregs->cap_hccparams2
+		controller->cregs->cap_hccparams2,
+		controller->cmd_ring.enqueue, controller->cmd_ring.cycle,
+		controller->event_ring.dequeue, controller->event_ring.cycle,
+		controller->port_changes, controller->transfer_events
 	);
 
 	if ((size_t)offset > _bsize) return 0;
@@ -118,8 +310,9 @@ static void find_xhci(uint32_t device, uint16_t v, uint16_t d, void * extra) {
 	struct XHCIControllerData * controller = calloc(sizeof(struct XHCIControllerData), 1);
 	controller->device = device;
 
-	/* Map mmio space... */
-	uintptr_t xhci_regs = (uintptr_t)mmu_map_mmio_region(mmio_addr, 0x1000 * 4); /* I don't know. */
+	/* Map mmio space... the doorbell array and runtime registers can sit
+	 * tens of KB past the capability registers, so map generously. */
+	uintptr_t xhci_regs = (uintptr_t)mmu_map_mmio_region(mmio_addr, 0x1000 * 16);
 	controller->mmio  = mmio_addr;
 	controller->cregs = (struct xhci_cap_regs*)xhci_regs;
 	controller->oregs = (struct xhci_op_regs*)(xhci_regs + (controller->cregs->cap_caplen_version & 0xFF));
@@ -153,14 +346,65 @@ static void find_xhci(uint32_t device, uint16_t v, uint16_t d, void * extra) {
 
 	char * baseCtx = mmu_map_mmio_region(dcbaap, 0x1000);
 	memset(baseCtx, 0, 0x1000);
+	controller->dcbaa = (uint64_t *)baseCtx;
 
 	controller->oregs->op_dcbaap_lo = dcbaap & 0xFFFFFFFF;
 	controller->oregs->op_dcbaap_hi = dcbaap >> 32UL;
-	controller->oregs->op_dcbaap_lo = dcbaap & 0xFFFFFFFF;
-	controller->oregs->op_dcbaap_hi = dcbaap >> 32UL;
 
-	
+	/* Scratchpad buffers: slot 0 of the DCBAA points at an array of
+	 * pages the controller gets for its own bookkeeping. */
+	uint32_t hcs2 = controller->cregs->cap_hcsparams2;
+	uint32_t scratch = (((hcs2 >> 21) & 0x1F) << 5) | ((hcs2 >> 27) & 0x1F);
+	if (scratch) {
+		fprintf(stderr, "xhci: %u scratchpad buffers\n", scratch);
+		uintptr_t array_phys = mmu_allocate_n_frames(1) << 12;
+		uint64_t * array = mmu_map_from_physical(array_phys);
+		memset(array, 0, 0x1000);
+		for (uint32_t i = 0; i < scratch && i < 512; ++i) {
+			array[i] = mmu_allocate_n_frames(1) << 12;
+		}
+		controller->dcbaa[0] = array_phys;
+	}
+
+	/* Command ring */
+	xhci_ring_alloc(&controller->cmd_ring, 1);
+	/* CRCR is 64 bits wide even though the struct splits it */
+	controller->oregs->op_crcr = (controller->cmd_ring.phys & 0xFFFFFFFF) | 1; /* RCS */
+	controller->oregs->op__pad2[0] = controller->cmd_ring.phys >> 32;
+
+	/* Event ring: one segment, registered with interrupter 0 */
+	xhci_ring_alloc(&controller->event_ring, 0);
+	uintptr_t erst_phys = mmu_allocate_n_frames(1) << 12;
+	uint64_t * erst = mmu_map_from_physical(erst_phys);
+	memset(erst, 0, 0x1000);
+	erst[0] = controller->event_ring.phys;
+	erst[1] = XHCI_RING_TRBS;
+
+	controller->doorbells = (volatile uint32_t *)(xhci_regs + (controller->cregs->cap_dboff & ~0x3UL));
+	controller->ir = (struct xhci_ir_regs *)(xhci_regs + (controller->cregs->cap_rtsoff & ~0x1FUL) + 0x20);
+	controller->ir->ir_erstsz = 1;
+	controller->ir->ir_erdp_lo = (controller->event_ring.phys & 0xFFFFFFFF) | (1 << 3);
+	controller->ir->ir_erdp_hi = controller->event_ring.phys >> 32;
+	controller->ir->ir_erstba_lo = erst_phys & 0xFFFFFFFF;
+	controller->ir->ir_erstba_hi = erst_phys >> 32;
+	controller->ir->ir_imod = 0; /* No moderation; we want completions immediately */
+	controller->ir->ir_iman = 3; /* Clear pending, enable */
+
+	controller->cmd_waiters = list_create("xhci command waiters", controller);
+	controller->irq = pci_get_interrupt(device);
+	irq_install_handler(controller->irq, xhci_irq_handler, "xhci");
+	_controllers[_counter] = controller;
+
+	/* Start the controller with interrupts on */
+	controller->oregs->op_usbcmd = (1 << 0) | (1 << 2); /* RS | INTE */
+	while (controller->oregs->op_usbsts & (1 << 0));
+	fprintf(stderr, "xhci: controller is running\n");
 
+	/* Round-trip a no-op command to prove the command ring, event ring,
+	 * and interrupt path all work before anything depends on them. */
+	int cc = xhci_command(controller, 0, 0, 0, XHCI_TRB_TYPE(TRB_NOOP_CMD));
+	fprintf(stderr, "xhci: no-op command completion code %d %s\n", cc,
+		cc == 1 ? "(success)" : "(unexpected)");
 
 	char devName[20] = "/dev/xhciN";
 	snprintf(devName, 19, "/dev/xhci%d", _counter);
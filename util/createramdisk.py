@@ -48,7 +48,7 @@ def file_filter(tarinfo):
 
     return tarinfo
 
-with tarfile.open('ramdisk.igz','w:gz') as ramdisk:
+def build(ramdisk):
     ramdisk.add('base',arcname='/',filter=file_filter)
 
     ramdisk.add('.',arcname='/src',filter=file_filter,recursive=False) # Add a src directory
@@ -64,4 +64,22 @@ with tarfile.open('ramdisk.igz','w:gz') as ramdisk:
     ramdisk.add('util/auto-dep.krk',arcname='/bin/auto-dep.krk',filter=file_filter)
     ramdisk.add('kuroko/src/kuroko',arcname='/usr/include/kuroko',filter=file_filter)
 
+# RAMDISK_FORMAT=lz4 trades a slightly larger image for much faster
+# decompression in the kernel; needs the python 'lz4' package. The
+# output name stays ramdisk.igz either way - the kernel sniffs the
+# magic bytes to pick a decompressor.
+if os.environ.get('RAMDISK_FORMAT') == 'lz4':
+    import io
+    import lz4.frame
+    buffer = io.BytesIO()
+    with tarfile.open(fileobj=buffer,mode='w') as ramdisk:
+        build(ramdisk)
+    with open('ramdisk.igz','wb') as out:
+        out.write(lz4.frame.compress(buffer.getvalue(),
+            compression_level=lz4.frame.COMPRESSIONLEVEL_MINHC,
+            content_size=True))
+else:
+    with tarfile.open('ramdisk.igz','w:gz') as ramdisk:
+        build(ramdisk)
+
 
@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+# Generates the 5^q table in libc/stdlib/strtod.c for the Eisel-Lemire
+# float parser: the most significant 128 bits of 5^q for q in [-342,308].
+# Positive powers are truncated; negative ones are computed from an
+# over-approximation of 1/5^-q so the parser's error is one-sided.
+
+def entry(q):
+    if q >= 0:
+        c = 5 ** q
+        while c >= (1 << 128):
+            c //= 2
+    else:
+        power5 = 5 ** -q
+        z = power5.bit_length()
+        if q >= -27:
+            c = 2 ** (z + 127) // power5 + 1
+        else:
+            c = 2 ** (2 * z + 128) // power5 + 1
+            while c >= (1 << 128):
+                c //= 2
+    while c < (1 << 127):
+        c *= 2
+    return c
+
+print('static const unsigned long long _pow5_128[651][2] = {')
+for q in range(-342, 309):
+    m = entry(q)
+    assert m.bit_length() == 128
+    print('\t{0x%016xULL,0x%016xULL},' % (m >> 64, m & ((1 << 64) - 1)))
+print('};')